@@ -9,6 +9,23 @@
 #include "src/arc_reader.h"
 #include "src/arc_stream.h"
 #include "src/arc_filter.h"
+#include "src/arc_tree.h"
+#include "src/arc_reader_cache.h"
+#include "src/arc_entry.h"
+#include "src/arc_grep.h"
+#include "src/arc_hash.h"
+#include "src/arc_diff.h"
+#include "src/arc_test.h"
+#include "src/arc_zip_writer.h"
+#include "src/arc_tar_writer.h"
+#include "src/arc_writer.h"
+#include "src/arc_transcode.h"
+#include "src/arc_shard.h"
+#include "src/arc_shuffle.h"
+#include "src/arc_match.h"
+#include "src/arc_sink.h"
+#include "src/arc_codec.h"
+#include "src/arc_bgzf.h"
 
 #endif // CUPIDARCHIVE_H
 
@@ -2,6 +2,7 @@
 #include "arc_7z.h"
 #include "arc_base.h"
 #include "arc_stream.h"
+#include "arc_codec.h"
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
@@ -49,6 +50,8 @@ typedef struct SevenZFolderInfo {
     uint64_t coder_id;
     uint8_t *coder_props;
     size_t coder_props_size;
+    uint32_t unpack_crc;      // CRC-32 of the unpacked data (valid if has_crc)
+    bool has_crc;
 } SevenZFolderInfo;
 
 typedef struct SevenZReader {
@@ -62,20 +65,10 @@ typedef struct SevenZReader {
     uint64_t coder_id;
     uint8_t *coder_props;
     size_t coder_props_size;
+    uint32_t unpack_crc;
+    bool has_crc;
 } SevenZReader;
 
-typedef struct LzmaFilterData {
-    ArcStream *underlying;
-    lzma_stream strm;
-    uint8_t *in_buf;
-    size_t in_buf_size;
-    bool eof;
-    bool initialized;
-    lzma_filter filters[2];
-    lzma_options_lzma lzma_opts;
-    void *opts_alloc;
-} LzmaFilterData;
-
 static uint64_t read_le64_buf(const uint8_t *data) {
     return ((uint64_t)data[0]) |
            ((uint64_t)data[1] << 8) |
@@ -87,97 +80,19 @@ static uint64_t read_le64_buf(const uint8_t *data) {
            ((uint64_t)data[7] << 56);
 }
 
-static ssize_t lzma_filter_read(ArcStream *stream, void *buf, size_t n) {
-    LzmaFilterData *data = (LzmaFilterData *)stream->user_data;
-    if (!data->initialized) {
-        data->strm = (lzma_stream)LZMA_STREAM_INIT;
-        if (lzma_raw_decoder(&data->strm, data->filters) != LZMA_OK) {
-            return -1;
-        }
-        data->initialized = true;
-    }
-    if (data->eof) {
+// 7z coder -> decompressor backend codec (arc_codec.h)
+static int sevenz_codec(uint64_t coder_id, size_t props_size, ArcCodec *codec) {
+    if (coder_id == SEVENZ_METHOD_LZMA2 && props_size == 1) {
+        *codec = ARC_CODEC_LZMA2;
         return 0;
     }
-
-    if (stream->byte_limit > 0) {
-        int64_t remaining = stream->byte_limit - stream->bytes_read;
-        if (remaining <= 0) {
-            return 0;
-        }
-        if ((int64_t)n > remaining) {
-            n = (size_t)remaining;
-        }
-    }
-
-    data->strm.next_out = (uint8_t *)buf;
-    data->strm.avail_out = n;
-
-    while (data->strm.avail_out > 0 && !data->eof) {
-        if (data->strm.avail_in == 0) {
-            ssize_t in_read = arc_stream_read(data->underlying, data->in_buf, data->in_buf_size);
-            if (in_read < 0) {
-                return -1;
-            }
-            if (in_read == 0) {
-                lzma_ret ret = lzma_code(&data->strm, LZMA_FINISH);
-                if (ret == LZMA_STREAM_END || ret == LZMA_BUF_ERROR) {
-                    data->eof = true;
-                    break;
-                }
-                return -1;
-            }
-            data->strm.next_in = data->in_buf;
-            data->strm.avail_in = (size_t)in_read;
-        }
-
-        lzma_ret ret = lzma_code(&data->strm, LZMA_RUN);
-        if (ret == LZMA_STREAM_END) {
-            data->eof = true;
-            break;
-        }
-        if (ret != LZMA_OK && ret != LZMA_BUF_ERROR) {
-            return -1;
-        }
+    if (coder_id == SEVENZ_METHOD_LZMA && props_size == 5) {
+        *codec = ARC_CODEC_LZMA;
+        return 0;
     }
-
-    size_t out = n - data->strm.avail_out;
-    stream->bytes_read += out;
-    return (ssize_t)out;
-}
-
-static int lzma_filter_seek(ArcStream *stream, int64_t off, int whence) {
-    (void)stream;
-    (void)off;
-    (void)whence;
-    errno = ESPIPE;
     return -1;
 }
 
-static int64_t lzma_filter_tell(ArcStream *stream) {
-    return stream->bytes_read;
-}
-
-static void lzma_filter_close(ArcStream *stream) {
-    LzmaFilterData *data = (LzmaFilterData *)stream->user_data;
-    if (data) {
-        if (data->initialized) {
-            lzma_end(&data->strm);
-        }
-        free(data->opts_alloc);
-        free(data->in_buf);
-        free(data);
-    }
-    free(stream);
-}
-
-static const struct ArcStreamVtable lzma_filter_vtable = {
-    .read = lzma_filter_read,
-    .seek = lzma_filter_seek,
-    .tell = lzma_filter_tell,
-    .close = lzma_filter_close
-};
-
 static int read_byte(const uint8_t *buf, size_t size, size_t *pos, uint8_t *out) {
     if (*pos >= size) {
         return -1;
@@ -232,35 +147,46 @@ static int skip_7z_data(const uint8_t *buf, size_t size, size_t *pos, uint64_t l
     return 0;
 }
 
-static int read_7z_crc_list(const uint8_t *buf, size_t size, size_t *pos, uint64_t num_items) {
+/**
+ * Read a digests record: an "all defined" byte, an optional bitset of
+ * defined items, then a CRC-32 for each defined item. The first max_out
+ * items are stored in crcs/defined (either may be NULL to skip them).
+ */
+static int read_7z_crc_list(const uint8_t *buf, size_t size, size_t *pos, uint64_t num_items,
+                            uint32_t *crcs, bool *defined, size_t max_out) {
     uint8_t all_defined = 0;
     if (read_byte(buf, size, pos, &all_defined) < 0) {
         return -1;
     }
 
-    uint64_t num_defined = num_items;
+    size_t bitset_pos = *pos;
     if (all_defined == 0) {
         size_t bitset_bytes = (size_t)((num_items + 7) / 8);
         if (*pos + bitset_bytes > size) {
             return -1;
         }
-        num_defined = 0;
-        for (size_t i = 0; i < bitset_bytes; i++) {
-            uint8_t bits = buf[*pos + i];
-            for (int b = 0; b < 8; b++) {
-                if ((i * 8 + b) >= num_items) {
-                    break;
-                }
-                if (bits & (1u << b)) {
-                    num_defined++;
-                }
-            }
-        }
         *pos += bitset_bytes;
     }
 
-    if (skip_7z_data(buf, size, pos, num_defined * 4) < 0) {
-        return -1;
+    // Bits are stored most significant first
+    for (uint64_t i = 0; i < num_items; i++) {
+        bool is_defined = all_defined != 0 || (buf[bitset_pos + i / 8] & (0x80u >> (i % 8))) != 0;
+        uint32_t crc = 0;
+        if (is_defined) {
+            uint8_t le[4];
+            if (read_bytes(buf, size, pos, le, sizeof(le)) < 0) {
+                return -1;
+            }
+            crc = (uint32_t)le[0] | ((uint32_t)le[1] << 8) | ((uint32_t)le[2] << 16) | ((uint32_t)le[3] << 24);
+        }
+        if (i < max_out) {
+            if (crcs) {
+                crcs[i] = crc;
+            }
+            if (defined) {
+                defined[i] = is_defined;
+            }
+        }
     }
     return 0;
 }
@@ -350,7 +276,8 @@ static int parse_streams_info(const uint8_t *buf, size_t size, size_t *pos, Seve
         return -1;
     }
     if (id == kCRC) {
-        if (read_7z_crc_list(buf, size, pos, num_pack_streams) < 0) {
+        // Packed-stream CRCs: the unpacked data is what gets verified
+        if (read_7z_crc_list(buf, size, pos, num_pack_streams, NULL, NULL, 0) < 0) {
             return -1;
         }
         if (read_byte(buf, size, pos, &id) < 0) {
@@ -402,7 +329,7 @@ static int parse_streams_info(const uint8_t *buf, size_t size, size_t *pos, Seve
         return -1;
     }
     if (id == kCRC) {
-        if (read_7z_crc_list(buf, size, pos, num_folders) < 0) {
+        if (read_7z_crc_list(buf, size, pos, num_folders, &info->unpack_crc, &info->has_crc, 1) < 0) {
             return -1;
         }
         if (read_byte(buf, size, pos, &id) < 0) {
@@ -413,7 +340,7 @@ static int parse_streams_info(const uint8_t *buf, size_t size, size_t *pos, Seve
         return -1;
     }
 
-    // Optional SubStreamsInfo (skip)
+    // Optional SubStreamsInfo
     if (read_byte(buf, size, pos, &id) < 0) {
         return -1;
     }
@@ -428,7 +355,7 @@ static int parse_streams_info(const uint8_t *buf, size_t size, size_t *pos, Seve
             return -1;
         }
     } else {
-        // Skip until End
+        uint64_t num_substreams = 1;
         for (;;) {
             if (read_byte(buf, size, pos, &id) < 0) {
                 return -1;
@@ -436,25 +363,44 @@ static int parse_streams_info(const uint8_t *buf, size_t size, size_t *pos, Seve
             if (id == kEnd) {
                 break;
             }
-            if (id == kNumUnpackStream || id == kSize || id == kCRC) {
-                // Skip using size fields
-                uint64_t n = 0;
-                if (read_7z_uint64(buf, size, pos, &n) < 0) {
+            if (id == kNumUnpackStream) {
+                if (read_7z_uint64(buf, size, pos, &num_substreams) < 0) {
                     return -1;
                 }
-                if (id == kCRC) {
-                    if (skip_7z_data(buf, size, pos, 4 * n) < 0) {
-                        return -1;
-                    }
-                } else {
-                    if (skip_7z_data(buf, size, pos, n) < 0) {
+            } else if (id == kSize) {
+                // Sizes of all but the last substream
+                for (uint64_t i = 1; i < num_substreams; i++) {
+                    uint64_t ignored;
+                    if (read_7z_uint64(buf, size, pos, &ignored) < 0) {
                         return -1;
                     }
                 }
+            } else if (id == kCRC) {
+                // A lone substream reuses the folder CRC when there is one
+                if (num_substreams == 1 && info->has_crc) {
+                    continue;
+                }
+                uint32_t crc = 0;
+                bool defined = false;
+                if (read_7z_crc_list(buf, size, pos, num_substreams, &crc, &defined, 1) < 0) {
+                    return -1;
+                }
+                if (num_substreams == 1) {
+                    info->unpack_crc = crc;
+                    info->has_crc = defined;
+                }
             } else {
                 return -1;
             }
         }
+        // The single-file reader only serves the first substream
+        if (num_substreams != 1) {
+            info->has_crc = false;
+        }
+        // End of StreamsInfo
+        if (read_byte(buf, size, pos, &id) < 0 || id != kEnd) {
+            return -1;
+        }
     }
 
     return 0;
@@ -482,12 +428,9 @@ static char *decode_7z_name(const uint8_t *data, size_t size) {
     return out;
 }
 
+// Parses the FilesInfo body; the caller has already consumed the kFilesInfo id
 static int parse_files_info(const uint8_t *buf, size_t size, size_t *pos, char **name_out, uint64_t *num_files_out) {
     uint8_t id;
-    if (read_byte(buf, size, pos, &id) < 0 || id != kFilesInfo) {
-        return -1;
-    }
-
     uint64_t num_files = 0;
     if (read_7z_uint64(buf, size, pos, &num_files) < 0) {
         return -1;
@@ -572,70 +515,33 @@ static int decode_header_if_needed(const uint8_t *buf, size_t size, const ArcLim
         return -1;
     }
 
-    lzma_stream strm = LZMA_STREAM_INIT;
-    lzma_filter filters[2];
-    memset(filters, 0, sizeof(filters));
-
-    lzma_options_lzma lzma_opts;
-    lzma_filter filter = {0};
-
-    if (folder_out->coder_id == SEVENZ_METHOD_LZMA2 && folder_out->coder_props_size == 1) {
-        uint8_t prop = folder_out->coder_props[0];
-        if (prop > 40) {
-            free(decoded);
-            return -1;
-        }
-        uint32_t dict = 1u << (prop / 2 + 11);
-        if (prop % 2) {
-            dict += dict / 2;
-        }
-        memset(&lzma_opts, 0, sizeof(lzma_opts));
-        lzma_opts.dict_size = dict;
-        filter.id = LZMA_FILTER_LZMA2;
-        filter.options = &lzma_opts;
-        filters[0] = filter;
-        filters[1].id = LZMA_VLI_UNKNOWN;
-
-        if (lzma_raw_decoder(&strm, filters) != LZMA_OK) {
-            free(decoded);
-            return -1;
-        }
-    } else if (folder_out->coder_id == SEVENZ_METHOD_LZMA && folder_out->coder_props_size == 5) {
-        filter.id = LZMA_FILTER_LZMA1;
-        filter.options = &lzma_opts;
-        if (lzma_properties_decode(&filter, NULL, folder_out->coder_props, folder_out->coder_props_size) != LZMA_OK) {
-            free(decoded);
-            return -1;
-        }
-        filters[0] = filter;
-        filters[1].id = LZMA_VLI_UNKNOWN;
-
-        if (lzma_raw_decoder(&strm, filters) != LZMA_OK) {
+    if (folder_out->coder_id == SEVENZ_METHOD_COPY) {
+        if (packed_size != folder_out->unpack_size) {
             free(decoded);
             return -1;
         }
-    } else if (folder_out->coder_id == SEVENZ_METHOD_COPY) {
-        if (packed_size != folder_out->unpack_size) {
+        memcpy(decoded, packed, packed_size);
+        if (folder_out->has_crc && lzma_crc32(decoded, packed_size, 0) != folder_out->unpack_crc) {
             free(decoded);
             return -1;
         }
-        memcpy(decoded, packed, packed_size);
         *decoded_out = decoded;
         *decoded_size_out = packed_size;
         return 0;
-    } else {
+    }
+
+    ArcCodec codec;
+    size_t decoded_len = 0;
+    if (sevenz_codec(folder_out->coder_id, folder_out->coder_props_size, &codec) < 0 ||
+        arc_codec_decode_buffer(codec, folder_out->coder_props, folder_out->coder_props_size,
+                                packed, packed_size, decoded, (size_t)folder_out->unpack_size,
+                                &decoded_len) < 0 ||
+        decoded_len != folder_out->unpack_size) {
         free(decoded);
         return -1;
     }
-
-    strm.next_in = packed;
-    strm.avail_in = packed_size;
-    strm.next_out = decoded;
-    strm.avail_out = (size_t)folder_out->unpack_size;
-
-    lzma_ret ret = lzma_code(&strm, LZMA_FINISH);
-    lzma_end(&strm);
-    if (ret != LZMA_STREAM_END) {
+    // Check the header's own CRC before parsing it
+    if (folder_out->has_crc && lzma_crc32(decoded, (size_t)folder_out->unpack_size, 0) != folder_out->unpack_crc) {
         free(decoded);
         return -1;
     }
@@ -709,80 +615,13 @@ static ArcStream *create_lzma_stream(ArcStream *packed, uint64_t coder_id,
     if (!packed) {
         return NULL;
     }
-
-    // Simple LZMA/LZMA2 decoder stream using liblzma
-
-    ArcStream *stream = calloc(1, sizeof(*stream));
-    if (!stream) {
-        return NULL;
-    }
-
-    LzmaFilterData *data = calloc(1, sizeof(*data));
-    if (!data) {
-        free(stream);
-        return NULL;
-    }
-
-    data->underlying = packed;
-    data->in_buf_size = 64 * 1024;
-    data->in_buf = malloc(data->in_buf_size);
-    if (!data->in_buf) {
-        free(data);
-        free(stream);
+    ArcCodec codec;
+    if (sevenz_codec(coder_id, props_size, &codec) < 0) {
+        errno = ENOTSUP;
         return NULL;
     }
-
-    data->filters[0].options = NULL;
-    data->filters[1].id = LZMA_VLI_UNKNOWN;
-
-    if (coder_id == SEVENZ_METHOD_LZMA2 && props_size == 1) {
-        uint8_t prop = props[0];
-        if (prop > 40) {
-            free(data->in_buf);
-            free(data);
-            free(stream);
-            return NULL;
-        }
-        uint32_t dict = 1u << (prop / 2 + 11);
-        if (prop % 2) {
-            dict += dict / 2;
-        }
-        lzma_options_lzma *lzma2_opts = malloc(sizeof(*lzma2_opts));
-        if (!lzma2_opts) {
-            free(data->in_buf);
-            free(data);
-            free(stream);
-            return NULL;
-        }
-        memset(lzma2_opts, 0, sizeof(*lzma2_opts));
-        lzma2_opts->dict_size = dict;
-        data->filters[0].id = LZMA_FILTER_LZMA2;
-        data->filters[0].options = lzma2_opts;
-        data->opts_alloc = lzma2_opts;
-    } else if (coder_id == SEVENZ_METHOD_LZMA && props_size == 5) {
-        lzma_filter filter = {0};
-        filter.id = LZMA_FILTER_LZMA1;
-        filter.options = &data->lzma_opts;
-        if (lzma_properties_decode(&filter, NULL, props, props_size) != LZMA_OK) {
-            free(data->in_buf);
-            free(data);
-            free(stream);
-            return NULL;
-        }
-        data->filters[0].id = LZMA_FILTER_LZMA1;
-        data->filters[0].options = &data->lzma_opts;
-    } else {
-        free(data->in_buf);
-        free(data);
-        free(stream);
-        return NULL;
-    }
-
-    stream->vtable = &lzma_filter_vtable;
-    stream->byte_limit = out_limit;
-    stream->bytes_read = 0;
-    stream->user_data = data;
-    return stream;
+    // The filter owns `packed` so the entry stream can be closed on its own
+    return arc_codec_filter(packed, codec, props, props_size, out_limit, true);
 }
 
 static void free_folder_info(SevenZFolderInfo *info) {
@@ -882,9 +721,9 @@ ArcReader *arc_7z_open_ex(ArcStream *stream, const ArcLimits *limits) {
         return NULL;
     }
 
-    reader->base.format = 3; // ARC_FORMAT_7Z
+    reader->base.format = ARC_FORMAT_7Z;
     reader->base.stream = stream;
-    reader->base.limits = limits;
+    arc_reader_set_limits(&reader->base, limits);
     reader->entry_valid = true;
     reader->entry_returned = false;
     reader->data_offset = base_offset + (int64_t)main_folder.pack_pos;
@@ -893,6 +732,8 @@ ArcReader *arc_7z_open_ex(ArcStream *stream, const ArcLimits *limits) {
     reader->coder_id = main_folder.coder_id;
     reader->coder_props = main_folder.coder_props;
     reader->coder_props_size = main_folder.coder_props_size;
+    reader->unpack_crc = main_folder.unpack_crc;
+    reader->has_crc = main_folder.has_crc;
 
     reader->current_entry.path = name ? name : strdup("file");
     reader->current_entry.size = main_folder.unpack_size;
@@ -972,6 +813,20 @@ ArcStream *arc_7z_open_data(ArcReader *reader) {
     return decompressed;
 }
 
+int arc_7z_entry_crc(ArcReader *reader, uint32_t *crc_out) {
+    if (!reader || !crc_out) {
+        errno = EINVAL;
+        return -1;
+    }
+    SevenZReader *seven = (SevenZReader *)reader;
+    if (!seven->has_crc) {
+        errno = ENOENT;
+        return -1;
+    }
+    *crc_out = seven->unpack_crc;
+    return 0;
+}
+
 int arc_7z_skip_data(ArcReader *reader) {
     if (!reader) {
         return -1;
@@ -22,6 +22,14 @@ ArcReader *arc_7z_open_ex(ArcStream *stream, const ArcLimits *limits);
 int arc_7z_next(ArcReader *reader, ArcEntry *entry);
 ArcStream *arc_7z_open_data(ArcReader *reader);
 int arc_7z_skip_data(ArcReader *reader);
+
+/**
+ * CRC-32 of the entry's unpacked data, from the folder or substream
+ * digests in the header.
+ *
+ * @return 0 on success, -1 if the archive stores no CRC (ENOENT)
+ */
+int arc_7z_entry_crc(ArcReader *reader, uint32_t *crc_out);
 void arc_7z_close(ArcReader *reader);
 
 #endif // ARC_7Z_H
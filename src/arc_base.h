@@ -2,8 +2,42 @@
 #define ARC_BASE_H
 
 #include "arc_stream.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Archive formats (ArcReaderBase.format, ArcEntryLocation.format)
+#define ARC_FORMAT_TAR        0
+#define ARC_FORMAT_ZIP        1
+#define ARC_FORMAT_COMPRESSED 2
+#define ARC_FORMAT_7Z         3
+#define ARC_FORMAT_CACHED     4  // Listing served from the persistent cache (arc_cache.c)
+
+// ZIP compression methods and general purpose flags (ArcEntryLocation.method, .flags)
+#define ZIP_METHOD_STORE         0
+#define ZIP_METHOD_DEFLATE       8
+#define ZIP_FLAG_ENCRYPTED       0x0001
+#define ZIP_FLAG_DATA_DESCRIPTOR 0x0008
 
 typedef struct ArcLimits ArcLimits;
+typedef struct ArcReader ArcReader;
+struct ArcListingRecorder;
+
+/**
+ * Where an entry's data lives, independent of the reader's cursor.
+ * Filled in by the format layer so an entry can be reopened later
+ * (listing cache, positional reads) without walking the archive again.
+ */
+typedef struct ArcEntryLocation {
+    int      format;       // Archive format (ARC_FORMAT_*)
+    int      compression;  // Whole-archive compression (ARC_COMPRESSED_*), -1 if none
+    uint16_t method;       // ZIP compression method (0 for other formats)
+    uint16_t flags;        // ZIP general purpose flags (0 for other formats)
+    int64_t  offset;       // TAR: data offset in the (decompressed) stream; ZIP: local header offset
+    uint64_t stored_size;  // Bytes stored in the archive (compressed size for ZIP)
+    uint64_t size;         // Uncompressed size
+    uint32_t crc32;        // Stored CRC-32 (valid if has_crc)
+    bool     has_crc;
+} ArcEntryLocation;
 
 /**
  * Base structure for all archive readers.
@@ -15,13 +49,35 @@ typedef struct ArcReaderBase {
     ArcStream *stream;        // The stream the format reads from
     ArcStream *owned_stream;  // For closing (optional)
     const ArcLimits *limits;  // Safety/resource limits (may be NULL => defaults)
+    ArcLimits limits_copy;    // Storage behind limits (see arc_reader_set_limits())
+    struct ArcListingRecorder *recorder; // Listing cache recorder (optional, see arc_cache.c)
+    uint32_t nesting;         // Archive nesting depth (0 = top level, see arc_open_nested())
 } ArcReaderBase;
 
+/**
+ * Give a reader its own copy of `limits`, so the caller's struct (often on
+ * its stack) need not outlive the reader and readers opened on different
+ * threads never share one.
+ *
+ * @param base Reader
+ * @param limits Limits to copy, or NULL for defaults
+ */
+static inline void arc_reader_set_limits(ArcReaderBase *base, const ArcLimits *limits) {
+    if (!limits) {
+        base->limits = NULL;
+        return;
+    }
+    if (limits != &base->limits_copy) {
+        base->limits_copy = *limits;
+    }
+    base->limits = &base->limits_copy;
+}
+
 /**
  * Safe accessor to get the format from any reader.
  * This function is safe because all reader structs embed ArcReaderBase
  * as their first member.
- * 
+ *
  * @param r Pointer to any reader struct
  * @return Format identifier, or -1 if r is NULL
  */
@@ -30,5 +86,13 @@ static inline int arc_reader_format(const void *r) {
     return ((const ArcReaderBase*)r)->format;
 }
 
-#endif // ARC_BASE_H
+/**
+ * Describe where the current entry's data lives.
+ * Only valid after a successful arc_next() call.
+ * Dispatches to the format layer (implemented in arc_reader.c).
+ *
+ * @return 0 on success, -1 if the format cannot describe its entries
+ */
+int arc_reader_entry_location(ArcReader *reader, ArcEntryLocation *loc);
 
+#endif // ARC_BASE_H
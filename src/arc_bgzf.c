@@ -0,0 +1,745 @@
+#define _POSIX_C_SOURCE 200809L
+#include "arc_bgzf.h"
+#include "arc_filter.h"
+#include "arc_codec.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define MAX_THREADS 64
+#define BLOCKS_PER_THREAD 4       // Blocks read ahead per worker
+
+// Block headers
+
+static uint16_t le16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t le64(const uint8_t *p) {
+    return (uint64_t)le32(p) | ((uint64_t)le32(p + 4) << 32);
+}
+
+bool arc_bgzf_detect(const uint8_t *buf, size_t len, size_t *block_size) {
+    // ID1 ID2 CM FLG(FEXTRA) MTIME(4) XFL OS XLEN(2)
+    if (!buf || len < 12 || buf[0] != 0x1f || buf[1] != 0x8b || buf[2] != 8 || !(buf[3] & 0x04)) {
+        return false;
+    }
+    size_t xlen = le16(buf + 10);
+    size_t end = 12 + xlen;
+    if (end > len) {
+        end = len;
+    }
+    for (size_t p = 12; p + 4 <= end;) {
+        size_t slen = le16(buf + p + 2);
+        if (buf[p] == 'B' && buf[p + 1] == 'C' && slen == 2 && p + 6 <= end) {
+            size_t size = (size_t)le16(buf + p + 4) + 1;
+            if (size < 12 + xlen + 10) {
+                return false;
+            }
+            if (block_size) {
+                *block_size = size;
+            }
+            return true;
+        }
+        p += 4 + slen;
+    }
+    return false;
+}
+
+// Read exactly n bytes; returns n, 0 at a clean EOF, -1 on error or short data
+static ssize_t read_full(ArcStream *s, uint8_t *buf, size_t n) {
+    size_t have = 0;
+    while (have < n) {
+        ssize_t got = arc_stream_read(s, buf + have, n - have);
+        if (got < 0) {
+            return -1;
+        }
+        if (got == 0) {
+            if (have == 0) {
+                return 0;
+            }
+            errno = EINVAL;  // Truncated block
+            return -1;
+        }
+        have += (size_t)got;
+    }
+    return (ssize_t)n;
+}
+
+// Read one block's header into buf (ARC_BGZF_MAX_BLOCK bytes) and return
+// the block's total size, 0 at EOF, -1 on error
+static ssize_t read_block_header(ArcStream *s, uint8_t *buf, size_t *header_len) {
+    ssize_t got = read_full(s, buf, 12);
+    if (got <= 0) {
+        return got;
+    }
+    size_t xlen = le16(buf + 10);
+    // The whole block, trailer included, must fit in ARC_BGZF_MAX_BLOCK
+    if (xlen < 6 || xlen > ARC_BGZF_MAX_BLOCK - 20 || read_full(s, buf + 12, xlen) <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    size_t size = 0;
+    if (!arc_bgzf_detect(buf, 12 + xlen, &size) || size > ARC_BGZF_MAX_BLOCK) {
+        errno = EINVAL;
+        return -1;
+    }
+    *header_len = 12 + xlen;
+    return (ssize_t)size;
+}
+
+// Index
+
+ArcBgzfIndex *arc_bgzf_index_new(void) {
+    ArcBgzfIndex *index = calloc(1, sizeof(*index));
+    if (!index) {
+        return NULL;
+    }
+    index->capacity = 64;
+    index->blocks = calloc(index->capacity, sizeof(*index->blocks));
+    if (!index->blocks) {
+        free(index);
+        return NULL;
+    }
+    index->count = 1;  // {0, 0}
+    return index;
+}
+
+void arc_bgzf_index_free(ArcBgzfIndex *index) {
+    if (!index) {
+        return;
+    }
+    free(index->blocks);
+    free(index);
+}
+
+static int index_append(ArcBgzfIndex *index, uint64_t in, uint64_t out) {
+    const ArcBgzfBlock *last = &index->blocks[index->count - 1];
+    if (in <= last->in) {
+        return 0;  // Already known
+    }
+    if (out < last->out) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (index->count == index->capacity) {
+        size_t cap = index->capacity * 2;
+        ArcBgzfBlock *grown = realloc(index->blocks, cap * sizeof(*grown));
+        if (!grown) {
+            errno = ENOMEM;
+            return -1;
+        }
+        index->blocks = grown;
+        index->capacity = cap;
+    }
+    index->blocks[index->count].in = in;
+    index->blocks[index->count].out = out;
+    index->count++;
+    return 0;
+}
+
+// The data ends at `in`: an entry recorded there is no block start
+static void index_finish(ArcBgzfIndex *index, uint64_t in, uint64_t out) {
+    if (index->count > 1 && index->blocks[index->count - 1].in >= in) {
+        index->count--;
+    }
+    index->complete = true;
+    index->in_size = in;
+    index->out_size = out;
+}
+
+static ArcBgzfIndex *index_copy(const ArcBgzfIndex *src) {
+    ArcBgzfIndex *index = calloc(1, sizeof(*index));
+    if (!index) {
+        return NULL;
+    }
+    *index = *src;
+    index->capacity = src->count;
+    index->blocks = malloc(src->count * sizeof(*index->blocks));
+    if (!index->blocks) {
+        free(index);
+        return NULL;
+    }
+    memcpy(index->blocks, src->blocks, src->count * sizeof(*index->blocks));
+    return index;
+}
+
+// Walk block headers from the last indexed block until `stop` (uncompressed)
+// is covered or the file ends
+static int index_extend(ArcBgzfIndex *index, ArcStream *s, uint64_t stop) {
+    uint8_t header[ARC_BGZF_MAX_BLOCK];
+    while (!index->complete) {
+        const ArcBgzfBlock last = index->blocks[index->count - 1];
+        if (last.out > stop) {
+            break;
+        }
+        if (arc_stream_seek(s, (int64_t)last.in, SEEK_SET) < 0) {
+            return -1;
+        }
+        size_t header_len = 0;
+        ssize_t size = read_block_header(s, header, &header_len);
+        if (size < 0) {
+            return -1;
+        }
+        if (size == 0) {
+            index_finish(index, last.in, last.out);
+            break;
+        }
+        uint8_t trailer[4];
+        if (arc_stream_seek(s, (int64_t)(last.in + (uint64_t)size - 4), SEEK_SET) < 0 ||
+            read_full(s, trailer, 4) <= 0) {
+            return -1;
+        }
+        uint32_t isize = le32(trailer);
+        if (isize > ARC_BGZF_MAX_BLOCK) {
+            errno = EINVAL;
+            return -1;
+        }
+        if (index_append(index, last.in + (uint64_t)size, last.out + isize) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+ArcBgzfIndex *arc_bgzf_index_build(ArcStream *compressed) {
+    if (!compressed) {
+        errno = EINVAL;
+        return NULL;
+    }
+    ArcBgzfIndex *index = arc_bgzf_index_new();
+    if (!index) {
+        return NULL;
+    }
+    if (index_extend(index, compressed, UINT64_MAX) < 0) {
+        int saved = errno;
+        arc_bgzf_index_free(index);
+        errno = saved;
+        return NULL;
+    }
+    return index;
+}
+
+ArcBgzfIndex *arc_bgzf_index_parse(const uint8_t *buf, size_t size) {
+    if (!buf || size < 8) {
+        errno = EINVAL;
+        return NULL;
+    }
+    uint64_t n = le64(buf);
+    if (n > (size - 8) / 16 || 8 + n * 16 != size) {
+        errno = EINVAL;
+        return NULL;
+    }
+    ArcBgzfIndex *index = arc_bgzf_index_new();
+    if (!index) {
+        return NULL;
+    }
+    for (uint64_t i = 0; i < n; i++) {
+        uint64_t in = le64(buf + 8 + i * 16);
+        uint64_t out = le64(buf + 16 + i * 16);
+        const ArcBgzfBlock *last = &index->blocks[index->count - 1];
+        if (in <= last->in || out < last->out || out - last->out > ARC_BGZF_MAX_BLOCK ||
+            index_append(index, in, out) < 0) {
+            arc_bgzf_index_free(index);
+            errno = EINVAL;
+            return NULL;
+        }
+    }
+    return index;
+}
+
+ArcBgzfIndex *arc_bgzf_index_load(const char *path) {
+    if (!path) {
+        errno = EINVAL;
+        return NULL;
+    }
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+    uint8_t *buf = NULL;
+    size_t len = 0;
+    size_t cap = 0;
+    for (;;) {
+        if (len == cap) {
+            cap = cap ? cap * 2 : 4096;
+            uint8_t *grown = realloc(buf, cap);
+            if (!grown) {
+                free(buf);
+                fclose(f);
+                errno = ENOMEM;
+                return NULL;
+            }
+            buf = grown;
+        }
+        size_t got = fread(buf + len, 1, cap - len, f);
+        len += got;
+        if (got == 0) {
+            break;
+        }
+    }
+    bool failed = ferror(f);
+    fclose(f);
+    ArcBgzfIndex *index = failed ? (errno = EIO, NULL) : arc_bgzf_index_parse(buf, len);
+    free(buf);
+    return index;
+}
+
+static int put_le64(FILE *out, uint64_t v) {
+    uint8_t b[8];
+    for (int i = 0; i < 8; i++) {
+        b[i] = (uint8_t)(v >> (8 * i));
+    }
+    return fwrite(b, 1, 8, out) == 8 ? 0 : -1;
+}
+
+int arc_bgzf_index_write(const ArcBgzfIndex *index, FILE *out) {
+    if (!index || !out || index->count == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (put_le64(out, (uint64_t)index->count - 1) < 0) {
+        return -1;
+    }
+    for (size_t i = 1; i < index->count; i++) {
+        if (put_le64(out, index->blocks[i].in) < 0 || put_le64(out, index->blocks[i].out) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+const ArcBgzfBlock *arc_bgzf_index_lookup(const ArcBgzfIndex *index, uint64_t offset) {
+    if (!index || index->count == 0) {
+        return NULL;
+    }
+    // Last block with out <= offset (empty blocks share an offset with the next one)
+    size_t lo = 0;
+    size_t hi = index->count;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (index->blocks[mid].out <= offset) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return &index->blocks[lo];
+}
+
+int arc_bgzf_virtual_offset(const ArcBgzfIndex *index, uint64_t offset, uint64_t *virtual_offset) {
+    const ArcBgzfBlock *b = arc_bgzf_index_lookup(index, offset);
+    if (!b || !virtual_offset) {
+        errno = EINVAL;
+        return -1;
+    }
+    uint64_t within = offset - b->out;
+    bool last = b == &index->blocks[index->count - 1];
+    if (within >= ARC_BGZF_MAX_BLOCK || (index->complete && offset > index->out_size) ||
+        (last && !index->complete && within > 0) || b->in >= (1ULL << 48)) {
+        errno = ERANGE;
+        return -1;
+    }
+    *virtual_offset = (b->in << 16) | within;
+    return 0;
+}
+
+// Parallel block filter
+
+typedef struct BgzfJob {
+    uint8_t in[ARC_BGZF_MAX_BLOCK];
+    size_t in_len;
+    uint8_t out[ARC_BGZF_MAX_BLOCK];
+    size_t out_len;              // ISIZE from the trailer, checked by the decode
+    uint64_t out_off;            // Uncompressed offset of the block
+    int error;
+    bool done;
+    struct BgzfJob *next;
+} BgzfJob;
+
+typedef struct BgzfData {
+    ArcStream *underlying;
+    ArcBgzfIndex *index;         // Block starts seen or loaded so far
+
+    // Workers
+    unsigned thread_count;
+    pthread_t threads[MAX_THREADS];
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t finished;
+    BgzfJob *head;
+    BgzfJob *tail;
+    bool shutdown;
+
+    // Blocks [first, next) are in flight, in ring slots by sequence % ring_size
+    BgzfJob *ring;
+    unsigned ring_size;
+    uint64_t first;
+    uint64_t next;
+    size_t serve_off;            // Offset into block `first`
+
+    uint64_t in_pos;             // Compressed offset of the next block to read
+    uint64_t out_pos;            // Uncompressed offset of the next block to read
+    bool in_eof;
+    uint64_t pos;                // Stream position (uncompressed)
+    int error;                   // Sticky errno once decoding failed
+} BgzfData;
+
+static void job_decode(BgzfJob *job) {
+    size_t len = 0;
+    size_t isize = job->out_len;
+    job->error = 0;
+    if (arc_codec_decode_buffer(ARC_CODEC_GZIP, NULL, 0, job->in, job->in_len,
+                                job->out, sizeof(job->out), &len) < 0) {
+        job->error = errno ? errno : EINVAL;
+    } else if (len != isize) {
+        job->error = EINVAL;
+    }
+}
+
+static void *worker_main(void *arg) {
+    BgzfData *d = arg;
+    pthread_mutex_lock(&d->lock);
+    for (;;) {
+        while (!d->head && !d->shutdown) {
+            pthread_cond_wait(&d->work, &d->lock);
+        }
+        if (d->shutdown) {
+            break;
+        }
+        BgzfJob *job = d->head;
+        d->head = job->next;
+        if (!d->head) {
+            d->tail = NULL;
+        }
+        pthread_mutex_unlock(&d->lock);
+        job_decode(job);
+        pthread_mutex_lock(&d->lock);
+        job->done = true;
+        pthread_cond_broadcast(&d->finished);
+    }
+    pthread_mutex_unlock(&d->lock);
+    return NULL;
+}
+
+// Read the next block and hand it to a worker (or decode it here)
+static int dispatch_block(BgzfData *d) {
+    BgzfJob *job = &d->ring[d->next % d->ring_size];
+    size_t header_len = 0;
+    ssize_t size = read_block_header(d->underlying, job->in, &header_len);
+    if (size < 0) {
+        return -1;
+    }
+    if (size == 0) {
+        d->in_eof = true;
+        index_finish(d->index, d->in_pos, d->out_pos);
+        return 0;
+    }
+    if (read_full(d->underlying, job->in + header_len, (size_t)size - header_len) <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    job->in_len = (size_t)size;
+    job->out_len = le32(job->in + size - 4);
+    if (job->out_len > ARC_BGZF_MAX_BLOCK) {
+        errno = EINVAL;
+        return -1;
+    }
+    job->out_off = d->out_pos;
+    job->done = false;
+    job->next = NULL;
+    if (index_append(d->index, d->in_pos, d->out_pos) < 0) {
+        return -1;
+    }
+    d->in_pos += (uint64_t)size;
+    d->out_pos += job->out_len;
+    d->next++;
+
+    if (d->thread_count == 0) {
+        job_decode(job);
+        job->done = true;
+        return 0;
+    }
+    pthread_mutex_lock(&d->lock);
+    if (d->tail) {
+        d->tail->next = job;
+    } else {
+        d->head = job;
+    }
+    d->tail = job;
+    pthread_cond_signal(&d->work);
+    pthread_mutex_unlock(&d->lock);
+    return 0;
+}
+
+static void wait_job(BgzfData *d, BgzfJob *job) {
+    pthread_mutex_lock(&d->lock);
+    while (!job->done) {
+        pthread_cond_wait(&d->finished, &d->lock);
+    }
+    pthread_mutex_unlock(&d->lock);
+}
+
+// Drop every block in flight (queued ones are unlinked, running ones awaited)
+static void drain(BgzfData *d) {
+    pthread_mutex_lock(&d->lock);
+    for (BgzfJob *job = d->head; job; job = job->next) {
+        job->done = true;  // Never reaches a worker
+    }
+    d->head = NULL;
+    d->tail = NULL;
+    for (uint64_t i = d->first; i < d->next; i++) {
+        BgzfJob *job = &d->ring[i % d->ring_size];
+        while (!job->done) {
+            pthread_cond_wait(&d->finished, &d->lock);
+        }
+    }
+    pthread_mutex_unlock(&d->lock);
+    d->first = d->next;
+    d->serve_off = 0;
+}
+
+static ssize_t bgzf_read(ArcStream *stream, void *buf, size_t n) {
+    BgzfData *d = (BgzfData *)stream->user_data;
+    if (d->error) {
+        errno = d->error;
+        return -1;
+    }
+    // The byte limit caps the readable range
+    if (stream->byte_limit > 0) {
+        if ((int64_t)d->pos >= stream->byte_limit) {
+            return 0;
+        }
+        if ((int64_t)n > stream->byte_limit - (int64_t)d->pos) {
+            n = (size_t)(stream->byte_limit - (int64_t)d->pos);
+        }
+    }
+
+    uint8_t *out = buf;
+    size_t done = 0;
+    while (done < n) {
+        while (!d->in_eof && d->next - d->first < d->ring_size) {
+            if (dispatch_block(d) < 0) {
+                goto fail;
+            }
+        }
+        if (d->first == d->next) {
+            break;  // EOF
+        }
+        BgzfJob *job = &d->ring[d->first % d->ring_size];
+        wait_job(d, job);
+        if (job->error) {
+            errno = job->error;
+            goto fail;
+        }
+        size_t take = job->out_len - d->serve_off;
+        if (take > n - done) {
+            take = n - done;
+        }
+        memcpy(out + done, job->out + d->serve_off, take);
+        done += take;
+        d->serve_off += take;
+        if (d->serve_off == job->out_len) {
+            d->first++;
+            d->serve_off = 0;
+        }
+    }
+    d->pos += done;
+    stream->bytes_read += (int64_t)done;
+    return (ssize_t)done;
+
+fail:
+    d->error = errno ? errno : EIO;
+    if (done > 0) {
+        d->pos += done;
+        stream->bytes_read += (int64_t)done;
+        return (ssize_t)done;  // Report the error on the next call
+    }
+    errno = d->error;
+    return -1;
+}
+
+static int bgzf_seek(ArcStream *stream, int64_t off, int whence) {
+    BgzfData *d = (BgzfData *)stream->user_data;
+    int64_t base;
+    switch (whence) {
+    case SEEK_SET:
+        base = 0;
+        break;
+    case SEEK_CUR:
+        base = (int64_t)d->pos;
+        break;
+    case SEEK_END:
+        drain(d);
+        if (index_extend(d->index, d->underlying, UINT64_MAX) < 0) {
+            d->error = errno;
+            return -1;
+        }
+        base = (int64_t)d->index->out_size;
+        break;
+    default:
+        errno = EINVAL;
+        return -1;
+    }
+    if ((off > 0 && base > INT64_MAX - off) || base + off < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    uint64_t target = (uint64_t)(base + off);
+
+    // Within the block being served: just move inside it
+    if (d->first < d->next && whence != SEEK_END) {
+        BgzfJob *job = &d->ring[d->first % d->ring_size];
+        wait_job(d, job);
+        if (!job->error && target >= job->out_off && target < job->out_off + job->out_len) {
+            d->serve_off = (size_t)(target - job->out_off);
+            d->pos = target;
+            return 0;
+        }
+    }
+
+    drain(d);
+    if (index_extend(d->index, d->underlying, target) < 0) {
+        d->error = errno;
+        return -1;
+    }
+    const ArcBgzfBlock *b = arc_bgzf_index_lookup(d->index, target);
+    if (d->index->complete && target >= d->index->out_size) {
+        // At or past the end: reads return 0
+        d->in_pos = d->index->in_size;
+        d->out_pos = d->index->out_size;
+        d->in_eof = true;
+        d->pos = target;
+        d->error = 0;
+        return 0;
+    }
+    if (arc_stream_seek(d->underlying, (int64_t)b->in, SEEK_SET) < 0) {
+        return -1;
+    }
+    d->in_pos = b->in;
+    d->out_pos = b->out;
+    d->in_eof = false;
+    d->error = 0;
+
+    // Skip to the target inside its block
+    uint64_t skip = target - b->out;
+    d->pos = b->out;
+    while (skip > 0) {
+        if (dispatch_block(d) < 0) {
+            d->error = errno;
+            return -1;
+        }
+        if (d->first == d->next) {
+            break;
+        }
+        BgzfJob *job = &d->ring[d->first % d->ring_size];
+        wait_job(d, job);
+        if (job->error) {
+            errno = d->error = job->error;
+            return -1;
+        }
+        if (skip < job->out_len) {
+            d->serve_off = (size_t)skip;
+            break;
+        }
+        skip -= job->out_len;  // Empty or shorter blocks before the target
+        d->first++;
+    }
+    d->pos = target;
+    return 0;
+}
+
+static int64_t bgzf_tell(ArcStream *stream) {
+    return (int64_t)((BgzfData *)stream->user_data)->pos;
+}
+
+static void bgzf_free(BgzfData *d) {
+    pthread_mutex_lock(&d->lock);
+    d->shutdown = true;
+    pthread_cond_broadcast(&d->work);
+    pthread_mutex_unlock(&d->lock);
+    for (unsigned i = 0; i < d->thread_count; i++) {
+        pthread_join(d->threads[i], NULL);
+    }
+    free(d->ring);
+    arc_bgzf_index_free(d->index);
+    pthread_mutex_destroy(&d->lock);
+    pthread_cond_destroy(&d->work);
+    pthread_cond_destroy(&d->finished);
+    free(d);
+}
+
+static void bgzf_close(ArcStream *stream) {
+    bgzf_free((BgzfData *)stream->user_data);
+    free(stream);
+}
+
+static const struct ArcStreamVtable bgzf_vtable = {
+    .read = bgzf_read,
+    .seek = bgzf_seek,
+    .tell = bgzf_tell,
+    .close = bgzf_close,
+};
+
+ArcStream *arc_filter_bgzf(ArcStream *underlying, int64_t byte_limit, const ArcBgzfOptions *opts) {
+    if (!underlying) {
+        errno = EINVAL;
+        return NULL;
+    }
+    BgzfData *d = calloc(1, sizeof(*d));
+    ArcStream *stream = calloc(1, sizeof(*stream));
+    if (!d || !stream) {
+        free(d);
+        free(stream);
+        errno = ENOMEM;
+        return NULL;
+    }
+    d->underlying = underlying;
+    pthread_mutex_init(&d->lock, NULL);
+    pthread_cond_init(&d->work, NULL);
+    pthread_cond_init(&d->finished, NULL);
+
+    long threads = opts && opts->threads ? (long)opts->threads : sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (threads > MAX_THREADS) {
+        threads = MAX_THREADS;
+    }
+    d->ring_size = (unsigned)threads * BLOCKS_PER_THREAD;
+    d->ring = calloc(d->ring_size, sizeof(*d->ring));
+    d->index = opts && opts->index ? index_copy(opts->index) : arc_bgzf_index_new();
+    if (!d->ring || !d->index) {
+        bgzf_free(d);
+        free(stream);
+        errno = ENOMEM;
+        return NULL;
+    }
+    // One thread decodes on the caller's thread, without a pool
+    for (long i = 0; threads > 1 && i < threads; i++) {
+        if (pthread_create(&d->threads[d->thread_count], NULL, worker_main, d) != 0) {
+            break;
+        }
+        d->thread_count++;
+    }
+
+    stream->vtable = &bgzf_vtable;
+    stream->byte_limit = byte_limit;
+    stream->bytes_read = 0;
+    stream->user_data = d;
+    return stream;
+}
+
+const ArcBgzfIndex *arc_filter_bgzf_index(ArcStream *stream) {
+    if (!stream || stream->vtable != &bgzf_vtable) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return ((BgzfData *)stream->user_data)->index;
+}
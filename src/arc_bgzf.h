@@ -0,0 +1,102 @@
+#ifndef ARC_BGZF_H
+#define ARC_BGZF_H
+
+#include "arc_stream.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/**
+ * BGZF (blocked gzip, as written by bgzip/htslib).
+ *
+ * A BGZF file is a run of ordinary gzip members, each holding at most
+ * 64 KiB of data and carrying its own compressed size in a "BC" FEXTRA
+ * subfield. Every member decodes on its own, so blocks can be inflated in
+ * parallel and decoding can start at any block boundary. The block index
+ * maps block starts between compressed and uncompressed offsets; it is the
+ * in-memory form of a `.gzi` file.
+ */
+
+#define ARC_BGZF_MAX_BLOCK 65536
+
+typedef struct ArcBgzfBlock {
+    uint64_t in;   // Compressed offset of the block's gzip header
+    uint64_t out;  // Uncompressed offset of the block's first byte
+} ArcBgzfBlock;
+
+typedef struct ArcBgzfIndex {
+    ArcBgzfBlock *blocks;  // Every block start from offset 0 on, sorted (blocks[0] = {0, 0})
+    size_t count;
+    size_t capacity;
+    bool complete;         // Blocks run to the end of the file; sizes below are valid
+    uint64_t in_size;      // Compressed size
+    uint64_t out_size;     // Uncompressed size
+} ArcBgzfIndex;
+
+/**
+ * Check whether `buf` starts with a BGZF block header.
+ *
+ * @param buf Start of the gzip member (18 bytes suffice for bgzip output)
+ * @param len Bytes available in buf
+ * @param block_size Output: total size of the block in bytes (may be NULL)
+ * @return true for a gzip header with a "BC" extra subfield
+ */
+bool arc_bgzf_detect(const uint8_t *buf, size_t len, size_t *block_size);
+
+/**
+ * Create an index holding only the first block.
+ *
+ * @return New index, or NULL on allocation failure
+ */
+ArcBgzfIndex *arc_bgzf_index_new(void);
+
+void arc_bgzf_index_free(ArcBgzfIndex *index);
+
+/**
+ * Build a complete index by walking the block headers and ISIZE trailers
+ * of a seekable BGZF stream (nothing is inflated). The stream position is
+ * left unspecified.
+ *
+ * @return New index, or NULL on error (errno = EINVAL for data that isn't BGZF)
+ */
+ArcBgzfIndex *arc_bgzf_index_build(ArcStream *compressed);
+
+/**
+ * Parse a `.gzi` file (little-endian entry count followed by
+ * compressed/uncompressed offset pairs, the first block omitted).
+ *
+ * @return New index (not complete), or NULL on error (errno = EINVAL for malformed data)
+ */
+ArcBgzfIndex *arc_bgzf_index_parse(const uint8_t *buf, size_t size);
+
+/**
+ * Read and parse a `.gzi` file.
+ *
+ * @return New index, or NULL on error
+ */
+ArcBgzfIndex *arc_bgzf_index_load(const char *path);
+
+/**
+ * Write an index in `.gzi` format.
+ *
+ * @return 0 on success, -1 on error
+ */
+int arc_bgzf_index_write(const ArcBgzfIndex *index, FILE *out);
+
+/**
+ * Find the last block starting at or before an uncompressed offset.
+ *
+ * @return Block, or NULL if index is NULL
+ */
+const ArcBgzfBlock *arc_bgzf_index_lookup(const ArcBgzfIndex *index, uint64_t offset);
+
+/**
+ * Translate an uncompressed offset into a BGZF virtual offset
+ * (block compressed offset << 16 | offset within the block).
+ *
+ * @return 0 on success, -1 with errno = ERANGE if the index doesn't reach the offset
+ */
+int arc_bgzf_virtual_offset(const ArcBgzfIndex *index, uint64_t offset, uint64_t *virtual_offset);
+
+#endif // ARC_BGZF_H
@@ -0,0 +1,796 @@
+#define _POSIX_C_SOURCE 200809L
+#include "arc_cache.h"
+#include "arc_reader.h"
+#include "arc_base.h"
+#include "arc_stream.h"
+#include "arc_filter.h"
+#include "arc_index.h"
+#include "arc_zip.h"
+#include "arc_compressed.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define CACHE_MAGIC "CARCLS01"
+#define CACHE_MAGIC_SIZE 8
+
+// Cache directory (NULL = disabled)
+static char *g_cache_dir = NULL;
+
+int arc_listing_cache_enable(const char *dir) {
+    if (!dir || !*dir) {
+        errno = EINVAL;
+        return -1;
+    }
+    struct stat st;
+    if (stat(dir, &st) < 0) {
+        return -1;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        errno = ENOTDIR;
+        return -1;
+    }
+    char *copy = strdup(dir);
+    if (!copy) {
+        return -1;
+    }
+    free(g_cache_dir);
+    g_cache_dir = copy;
+    return 0;
+}
+
+void arc_listing_cache_disable(void) {
+    free(g_cache_dir);
+    g_cache_dir = NULL;
+}
+
+// File identity stored in (and checked against) the cache file
+typedef struct CacheKey {
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+} CacheKey;
+
+static void cache_key_from_stat(CacheKey *key, const struct stat *st) {
+    key->dev = (uint64_t)st->st_dev;
+    key->ino = (uint64_t)st->st_ino;
+    key->size = (uint64_t)st->st_size;
+    key->mtime_sec = (int64_t)st->st_mtim.tv_sec;
+    key->mtime_nsec = (int64_t)st->st_mtim.tv_nsec;
+}
+
+static char *cache_file_path(const CacheKey *key) {
+    if (!g_cache_dir) {
+        return NULL;
+    }
+    size_t len = strlen(g_cache_dir) + 64;
+    char *path = malloc(len);
+    if (!path) {
+        return NULL;
+    }
+    snprintf(path, len, "%s/%llx-%llx.arcls", g_cache_dir,
+             (unsigned long long)key->dev, (unsigned long long)key->ino);
+    return path;
+}
+
+static int entry_copy(ArcEntry *dst, const ArcEntry *src) {
+    *dst = *src;
+    dst->path = NULL;
+    dst->link_target = NULL;
+    if (src->path && !(dst->path = strdup(src->path))) {
+        return -1;
+    }
+    if (src->link_target && !(dst->link_target = strdup(src->link_target))) {
+        free(dst->path);
+        dst->path = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+static void entries_free(ArcEntry *entries, size_t count) {
+    if (!entries) {
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        arc_entry_free(&entries[i]);
+    }
+    free(entries);
+}
+
+// Recorder: collects a full listing pass
+struct ArcListingRecorder {
+    CacheKey key;
+    int format;
+    int compression;
+    ArcEntry *entries;
+    ArcEntryLocation *locs;
+    size_t count;
+    size_t capacity;
+    ArcInflateIndex *index;  // Filled by the gzip filter (owned)
+};
+
+static void recorder_free(struct ArcListingRecorder *rec) {
+    if (!rec) {
+        return;
+    }
+    entries_free(rec->entries, rec->count);
+    free(rec->locs);
+    arc_inflate_index_free(rec->index);
+    free(rec);
+}
+
+void arc_cache_detach_recorder(ArcReader *reader) {
+    if (!reader) {
+        return;
+    }
+    ArcReaderBase *base = (ArcReaderBase *)reader;
+    struct ArcListingRecorder *rec = base->recorder;
+    if (!rec) {
+        return;
+    }
+    if (rec->index) {
+        // The filter only borrows the index
+        arc_filter_gzip_set_index(base->stream, NULL);
+    }
+    base->recorder = NULL;
+    recorder_free(rec);
+}
+
+void arc_cache_attach_recorder(ArcReader *reader, const struct stat *st, int compression) {
+    if (!reader || !st || !g_cache_dir) {
+        return;
+    }
+    ArcReaderBase *base = (ArcReaderBase *)reader;
+    if (base->format != ARC_FORMAT_TAR && base->format != ARC_FORMAT_ZIP) {
+        return;
+    }
+    if (base->format == ARC_FORMAT_ZIP && compression >= 0) {
+        return; // Compressed ZIP streams have no stable offsets
+    }
+
+    if (arc_filter_bgzf_index(base->stream)) {
+        return; // BGZF can't be reopened through a checkpoint index; it seeks on its own
+    }
+
+    struct ArcListingRecorder *rec = calloc(1, sizeof(*rec));
+    if (!rec) {
+        return; // Caching is best effort
+    }
+    cache_key_from_stat(&rec->key, st);
+    rec->format = base->format;
+    rec->compression = compression;
+
+    if (base->format == ARC_FORMAT_TAR && compression == ARC_COMPRESSED_GZIP) {
+        rec->index = arc_inflate_index_new(ARC_INFLATE_GZIP, 0);
+        if (rec->index && arc_filter_gzip_set_index(base->stream, rec->index) < 0) {
+            arc_inflate_index_free(rec->index);
+            rec->index = NULL;
+        }
+    }
+    base->recorder = rec;
+}
+
+// Little-endian writers
+static int put_u8(FILE *out, uint8_t v) {
+    return fputc(v, out) == EOF ? -1 : 0;
+}
+
+static int put_u16(FILE *out, uint16_t v) {
+    uint8_t b[2] = { (uint8_t)v, (uint8_t)(v >> 8) };
+    return fwrite(b, 1, sizeof(b), out) == sizeof(b) ? 0 : -1;
+}
+
+static int put_u32(FILE *out, uint32_t v) {
+    uint8_t b[4] = { (uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24) };
+    return fwrite(b, 1, sizeof(b), out) == sizeof(b) ? 0 : -1;
+}
+
+static int put_u64(FILE *out, uint64_t v) {
+    if (put_u32(out, (uint32_t)v) < 0) return -1;
+    return put_u32(out, (uint32_t)(v >> 32));
+}
+
+static int put_str(FILE *out, const char *s) {
+    uint32_t len = s ? (uint32_t)strlen(s) : 0;
+    if (put_u32(out, s ? len : UINT32_MAX) < 0) return -1;
+    return (len == 0 || fwrite(s, 1, len, out) == len) ? 0 : -1;
+}
+
+static int recorder_write_body(const struct ArcListingRecorder *rec, FILE *out) {
+    if (fwrite(CACHE_MAGIC, 1, CACHE_MAGIC_SIZE, out) != CACHE_MAGIC_SIZE ||
+        put_u64(out, rec->key.dev) < 0 ||
+        put_u64(out, rec->key.ino) < 0 ||
+        put_u64(out, rec->key.size) < 0 ||
+        put_u64(out, (uint64_t)rec->key.mtime_sec) < 0 ||
+        put_u64(out, (uint64_t)rec->key.mtime_nsec) < 0 ||
+        put_u32(out, (uint32_t)rec->format) < 0 ||
+        put_u32(out, (uint32_t)rec->compression) < 0 ||
+        put_u64(out, (uint64_t)rec->count) < 0) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < rec->count; i++) {
+        const ArcEntry *e = &rec->entries[i];
+        const ArcEntryLocation *loc = &rec->locs[i];
+        if (put_str(out, e->path) < 0 ||
+            put_str(out, e->link_target) < 0 ||
+            put_u64(out, e->size) < 0 ||
+            put_u32(out, e->mode) < 0 ||
+            put_u64(out, e->mtime) < 0 ||
+            put_u8(out, e->type) < 0 ||
+            put_u32(out, e->uid) < 0 ||
+            put_u32(out, e->gid) < 0 ||
+            put_u16(out, loc->method) < 0 ||
+            put_u16(out, loc->flags) < 0 ||
+            put_u64(out, (uint64_t)loc->offset) < 0 ||
+            put_u64(out, loc->stored_size) < 0 ||
+            put_u64(out, loc->size) < 0 ||
+            put_u8(out, loc->has_crc ? 1 : 0) < 0 ||
+            put_u32(out, loc->crc32) < 0) {
+            return -1;
+        }
+    }
+
+    bool has_index = rec->index && rec->index->count > 0;
+    if (put_u8(out, has_index ? 1 : 0) < 0) {
+        return -1;
+    }
+    if (has_index && arc_inflate_index_write(rec->index, out) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+// Write to a temporary file and rename, so readers never see a partial cache file
+static int recorder_write(const struct ArcListingRecorder *rec) {
+    char *path = cache_file_path(&rec->key);
+    if (!path) {
+        return -1;
+    }
+    size_t tmp_len = strlen(path) + 32;
+    char *tmp = malloc(tmp_len);
+    if (!tmp) {
+        free(path);
+        return -1;
+    }
+    snprintf(tmp, tmp_len, "%s.tmp.%ld", path, (long)getpid());
+
+    FILE *out = fopen(tmp, "wb");
+    if (!out) {
+        free(tmp);
+        free(path);
+        return -1;
+    }
+    int ret = recorder_write_body(rec, out);
+    if (fclose(out) != 0) {
+        ret = -1;
+    }
+    if (ret == 0 && rename(tmp, path) < 0) {
+        ret = -1;
+    }
+    if (ret < 0) {
+        unlink(tmp);
+    }
+    free(tmp);
+    free(path);
+    return ret;
+}
+
+static int recorder_append(struct ArcListingRecorder *rec, const ArcEntry *entry, const ArcEntryLocation *loc) {
+    if (rec->count >= rec->capacity) {
+        size_t new_capacity = rec->capacity == 0 ? 64 : rec->capacity * 2;
+        ArcEntry *entries = realloc(rec->entries, new_capacity * sizeof(*entries));
+        if (!entries) {
+            return -1;
+        }
+        rec->entries = entries;
+        ArcEntryLocation *locs = realloc(rec->locs, new_capacity * sizeof(*locs));
+        if (!locs) {
+            return -1;
+        }
+        rec->locs = locs;
+        rec->capacity = new_capacity;
+    }
+    if (entry_copy(&rec->entries[rec->count], entry) < 0) {
+        return -1;
+    }
+    rec->locs[rec->count] = *loc;
+    rec->count++;
+    return 0;
+}
+
+void arc_cache_record(ArcReader *reader, const ArcEntry *entry, int ret) {
+    if (!reader) {
+        return;
+    }
+    ArcReaderBase *base = (ArcReaderBase *)reader;
+    struct ArcListingRecorder *rec = base->recorder;
+    if (!rec) {
+        return;
+    }
+
+    if (ret == 0) {
+        ArcEntryLocation loc;
+        if (arc_reader_entry_location(reader, &loc) < 0) {
+            arc_cache_detach_recorder(reader);
+            return;
+        }
+        loc.compression = rec->compression;
+        if (recorder_append(rec, entry, &loc) < 0) {
+            arc_cache_detach_recorder(reader);
+        }
+        return;
+    }
+
+    if (ret == 1) {
+        // Complete pass: persist it (failures only cost the next open a re-scan)
+        recorder_write(rec);
+    }
+    arc_cache_detach_recorder(reader);
+}
+
+// Cached reader
+typedef struct CachedReader {
+    ArcReaderBase base;  // Must be first member for safe dispatch
+    int source_format;   // ARC_FORMAT_TAR or ARC_FORMAT_ZIP
+    int compression;     // ARC_COMPRESSED_* or -1
+    ArcEntry *entries;
+    ArcEntryLocation *locs;
+    size_t count;
+    size_t next_index;   // Index of the entry the next arc_next() returns
+    bool entry_valid;
+    ArcInflateIndex *index;
+} CachedReader;
+
+// Bounds-checked little-endian cursor over the cache file
+typedef struct CacheCursor {
+    const uint8_t *p;
+    size_t left;
+    bool bad;
+} CacheCursor;
+
+static const uint8_t *cursor_take(CacheCursor *c, size_t n) {
+    if (c->bad || c->left < n) {
+        c->bad = true;
+        return NULL;
+    }
+    const uint8_t *p = c->p;
+    c->p += n;
+    c->left -= n;
+    return p;
+}
+
+static uint8_t get_u8(CacheCursor *c) {
+    const uint8_t *p = cursor_take(c, 1);
+    return p ? p[0] : 0;
+}
+
+static uint16_t get_u16(CacheCursor *c) {
+    const uint8_t *p = cursor_take(c, 2);
+    return p ? (uint16_t)(p[0] | (p[1] << 8)) : 0;
+}
+
+static uint32_t get_u32(CacheCursor *c) {
+    const uint8_t *p = cursor_take(c, 4);
+    if (!p) return 0;
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t get_u64(CacheCursor *c) {
+    uint64_t lo = get_u32(c);
+    uint64_t hi = get_u32(c);
+    return lo | (hi << 32);
+}
+
+static char *get_str(CacheCursor *c, bool *ok) {
+    uint32_t len = get_u32(c);
+    if (c->bad) {
+        *ok = false;
+        return NULL;
+    }
+    if (len == UINT32_MAX) {
+        return NULL; // Absent
+    }
+    const uint8_t *p = cursor_take(c, len);
+    char *s = p ? malloc((size_t)len + 1) : NULL;
+    if (!s) {
+        *ok = false;
+        return NULL;
+    }
+    memcpy(s, p, len);
+    s[len] = '\0';
+    return s;
+}
+
+static uint8_t *read_whole_file(const char *path, size_t *size_out) {
+    FILE *in = fopen(path, "rb");
+    if (!in) {
+        return NULL;
+    }
+    uint8_t *buf = NULL;
+    if (fseek(in, 0, SEEK_END) == 0) {
+        long size = ftell(in);
+        if (size > 0 && fseek(in, 0, SEEK_SET) == 0) {
+            buf = malloc((size_t)size);
+            if (buf && fread(buf, 1, (size_t)size, in) != (size_t)size) {
+                free(buf);
+                buf = NULL;
+            }
+            *size_out = (size_t)size;
+        }
+    }
+    fclose(in);
+    return buf;
+}
+
+static void cached_reader_free(CachedReader *cr) {
+    entries_free(cr->entries, cr->count);
+    free(cr->locs);
+    arc_inflate_index_free(cr->index);
+    free(cr);
+}
+
+static CachedReader *cache_parse(const uint8_t *buf, size_t size, const CacheKey *key) {
+    CacheCursor c = { buf, size, false };
+    const uint8_t *magic = cursor_take(&c, CACHE_MAGIC_SIZE);
+    if (!magic || memcmp(magic, CACHE_MAGIC, CACHE_MAGIC_SIZE) != 0) {
+        return NULL;
+    }
+    CacheKey stored;
+    stored.dev = get_u64(&c);
+    stored.ino = get_u64(&c);
+    stored.size = get_u64(&c);
+    stored.mtime_sec = (int64_t)get_u64(&c);
+    stored.mtime_nsec = (int64_t)get_u64(&c);
+    if (c.bad || memcmp(&stored, key, sizeof(stored)) != 0) {
+        return NULL; // Stale: the file changed since the listing was recorded
+    }
+
+    CachedReader *cr = calloc(1, sizeof(*cr));
+    if (!cr) {
+        return NULL;
+    }
+    cr->source_format = (int)get_u32(&c);
+    cr->compression = (int)get_u32(&c);
+    uint64_t count = get_u64(&c);
+    // Every entry takes at least 60 bytes, which bounds the allocation
+    if (c.bad || count > c.left / 60 ||
+        (cr->source_format != ARC_FORMAT_TAR && cr->source_format != ARC_FORMAT_ZIP)) {
+        free(cr);
+        return NULL;
+    }
+
+    cr->entries = calloc(count ? count : 1, sizeof(*cr->entries));
+    cr->locs = calloc(count ? count : 1, sizeof(*cr->locs));
+    if (!cr->entries || !cr->locs) {
+        cached_reader_free(cr);
+        return NULL;
+    }
+
+    for (uint64_t i = 0; i < count; i++) {
+        ArcEntry *e = &cr->entries[i];
+        ArcEntryLocation *loc = &cr->locs[i];
+        bool ok = true;
+        cr->count = i + 1; // So partially parsed entries are freed on error
+        e->path = get_str(&c, &ok);
+        e->link_target = get_str(&c, &ok);
+        e->size = get_u64(&c);
+        e->mode = get_u32(&c);
+        e->mtime = get_u64(&c);
+        e->type = get_u8(&c);
+        e->uid = get_u32(&c);
+        e->gid = get_u32(&c);
+        loc->format = cr->source_format;
+        loc->compression = cr->compression;
+        loc->method = get_u16(&c);
+        loc->flags = get_u16(&c);
+        loc->offset = (int64_t)get_u64(&c);
+        loc->stored_size = get_u64(&c);
+        loc->size = get_u64(&c);
+        loc->has_crc = get_u8(&c) != 0;
+        loc->crc32 = get_u32(&c);
+        if (!ok || c.bad || !e->path || loc->offset < 0) {
+            cached_reader_free(cr);
+            return NULL;
+        }
+    }
+
+    if (get_u8(&c) != 0) {
+        size_t consumed = 0;
+        cr->index = arc_inflate_index_parse(c.p, c.left, &consumed);
+        if (!cr->index) {
+            cached_reader_free(cr);
+            return NULL;
+        }
+    }
+    if (c.bad) {
+        cached_reader_free(cr);
+        return NULL;
+    }
+    return cr;
+}
+
+/**
+ * Whether a cached listing stays within the caller's entry count and name
+ * length limits. It was recorded under whatever limits the recording reader
+ * had, so a stricter caller gets the real reader and its checks instead.
+ */
+static bool within_limits(const CachedReader *cr, const ArcLimits *limits) {
+    if (!limits) {
+        return true;
+    }
+    if (limits->max_entries > 0 && cr->count > limits->max_entries) {
+        return false;
+    }
+    for (size_t i = 0; limits->max_name > 0 && i < cr->count; i++) {
+        if (strlen(cr->entries[i].path) > limits->max_name) {
+            return false;
+        }
+    }
+    return true;
+}
+
+ArcReader *arc_cache_open(ArcStream *stream, const struct stat *st, const ArcLimits *limits) {
+    if (!stream || !st || !g_cache_dir) {
+        return NULL;
+    }
+    CacheKey key;
+    memset(&key, 0, sizeof(key));
+    cache_key_from_stat(&key, st);
+
+    char *path = cache_file_path(&key);
+    if (!path) {
+        return NULL;
+    }
+    size_t size = 0;
+    uint8_t *buf = read_whole_file(path, &size);
+    free(path);
+    if (!buf) {
+        return NULL;
+    }
+    CachedReader *cr = cache_parse(buf, size, &key);
+    free(buf);
+    if (!cr) {
+        return NULL;
+    }
+
+    arc_reader_set_limits(&cr->base, limits);
+    if (!within_limits(cr, cr->base.limits)) {
+        cached_reader_free(cr);
+        return NULL;
+    }
+    cr->base.format = ARC_FORMAT_CACHED;
+    cr->base.stream = stream;
+    cr->base.owned_stream = NULL;
+    return (ArcReader *)cr;
+}
+
+int arc_cached_next(ArcReader *reader, ArcEntry *entry) {
+    if (!reader || !entry) {
+        return -1;
+    }
+    CachedReader *cr = (CachedReader *)reader;
+    cr->entry_valid = false;
+    if (cr->next_index >= cr->count) {
+        return 1; // Done
+    }
+    if (entry_copy(entry, &cr->entries[cr->next_index]) < 0) {
+        return -1;
+    }
+    cr->next_index++;
+    cr->entry_valid = true;
+    return 0;
+}
+
+int arc_cached_entry_location(ArcReader *reader, ArcEntryLocation *loc) {
+    if (!reader || !loc) {
+        return -1;
+    }
+    CachedReader *cr = (CachedReader *)reader;
+    if (!cr->entry_valid) {
+        errno = EINVAL;
+        return -1;
+    }
+    *loc = cr->locs[cr->next_index - 1];
+    return 0;
+}
+
+// Decompress from the start of the archive and discard up to the entry
+// (bzip2/xz have no restart points). Owns the filter it reads from.
+struct SkipStreamData {
+    ArcStream *inner;
+    int64_t skip;
+};
+
+static ssize_t skip_read(ArcStream *stream, void *buf, size_t n) {
+    struct SkipStreamData *data = (struct SkipStreamData *)stream->user_data;
+
+    // Enforce byte limit
+    if (stream->byte_limit > 0) {
+        int64_t remaining = stream->byte_limit - stream->bytes_read;
+        if (remaining <= 0) {
+            return 0; // EOF (limit reached)
+        }
+        if ((int64_t)n > remaining) {
+            n = (size_t)remaining;
+        }
+    }
+    if (n == 0) {
+        return 0;
+    }
+
+    while (data->skip > 0) {
+        size_t chunk = (data->skip < (int64_t)n) ? (size_t)data->skip : n;
+        ssize_t got = arc_stream_read(data->inner, buf, chunk);
+        if (got <= 0) {
+            return got;
+        }
+        data->skip -= got;
+    }
+
+    ssize_t got = arc_stream_read(data->inner, buf, n);
+    if (got > 0) {
+        stream->bytes_read += got;
+    }
+    return got;
+}
+
+static int skip_seek(ArcStream *stream, int64_t off, int whence) {
+    (void)stream;
+    (void)off;
+    (void)whence;
+    errno = ESPIPE;
+    return -1;
+}
+
+static int64_t skip_tell(ArcStream *stream) {
+    return stream->bytes_read;
+}
+
+static void skip_close(ArcStream *stream) {
+    struct SkipStreamData *data = (struct SkipStreamData *)stream->user_data;
+    if (data) {
+        arc_stream_close(data->inner);
+        free(data);
+    }
+    free(stream);
+}
+
+static const struct ArcStreamVtable skip_vtable = {
+    .read = skip_read,
+    .seek = skip_seek,
+    .tell = skip_tell,
+    .close = skip_close,
+};
+
+static ArcStream *open_filtered_at(ArcStream *file, int compression, int64_t offset, int64_t length) {
+    if (arc_stream_seek(file, 0, SEEK_SET) < 0) {
+        return NULL;
+    }
+    ArcStream *inner = NULL;
+    if (compression == ARC_COMPRESSED_BZIP2) {
+        inner = arc_filter_bzip2(file, offset + length);
+    } else if (compression == ARC_COMPRESSED_XZ) {
+        inner = arc_filter_xz(file, offset + length);
+    } else if (compression == ARC_COMPRESSED_LZ4) {
+        inner = arc_filter_lz4(file, offset + length, NULL);
+    } else {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!inner) {
+        return NULL;
+    }
+
+    ArcStream *stream = calloc(1, sizeof(*stream));
+    struct SkipStreamData *data = calloc(1, sizeof(*data));
+    if (!stream || !data) {
+        free(stream);
+        free(data);
+        arc_stream_close(inner);
+        return NULL;
+    }
+    data->inner = inner;
+    data->skip = offset;
+    stream->vtable = &skip_vtable;
+    stream->byte_limit = length;
+    stream->bytes_read = 0;
+    stream->user_data = data;
+    return stream;
+}
+
+ArcStream *arc_cached_open_data(ArcReader *reader) {
+    if (!reader) {
+        return NULL;
+    }
+    CachedReader *cr = (CachedReader *)reader;
+    if (!cr->entry_valid) {
+        return NULL;
+    }
+    const ArcEntryLocation *loc = &cr->locs[cr->next_index - 1];
+    if (loc->stored_size == 0) {
+        return NULL;
+    }
+
+    if (cr->source_format == ARC_FORMAT_ZIP) {
+        return arc_zip_open_location(cr->base.stream, loc, cr->base.limits);
+    }
+
+    // TAR: offsets are in the decompressed stream
+    switch (cr->compression) {
+        case -1:
+            return arc_stream_substream(cr->base.stream, loc->offset, (int64_t)loc->stored_size);
+        case ARC_COMPRESSED_GZIP:
+            return arc_inflate_index_open(cr->index, ARC_INFLATE_GZIP, cr->base.stream, 0,
+                                          loc->offset, (int64_t)loc->stored_size);
+        default:
+            return open_filtered_at(cr->base.stream, cr->compression, loc->offset, (int64_t)loc->stored_size);
+    }
+}
+
+int arc_cached_skip_data(ArcReader *reader) {
+    if (!reader) {
+        return -1;
+    }
+    CachedReader *cr = (CachedReader *)reader;
+    if (!cr->entry_valid) {
+        return -1;
+    }
+    cr->entry_valid = false;
+    return 0;
+}
+
+int arc_cached_rewind(ArcReader *reader) {
+    if (!reader) {
+        return -1;
+    }
+    CachedReader *cr = (CachedReader *)reader;
+    // Resets the file stream's byte budget for the new pass
+    if (arc_stream_seek(cr->base.stream, 0, SEEK_SET) < 0) {
+        return -1;
+    }
+    cr->next_index = 0;
+    cr->entry_valid = false;
+    return 0;
+}
+
+void arc_cached_close(ArcReader *reader) {
+    if (!reader) {
+        return;
+    }
+    CachedReader *cr = (CachedReader *)reader;
+    if (cr->base.stream) {
+        arc_stream_close(cr->base.stream);
+    }
+    if (cr->base.owned_stream && cr->base.owned_stream != cr->base.stream) {
+        arc_stream_close(cr->base.owned_stream);
+    }
+    cached_reader_free(cr);
+}
+
+int arc_cached_list(ArcReader *reader, ArcEntry **entries_out, size_t *count_out) {
+    CachedReader *cr = (CachedReader *)reader;
+    size_t remaining = cr->count - cr->next_index;
+    ArcEntry *entries = calloc(remaining ? remaining : 1, sizeof(*entries));
+    if (!entries) {
+        return -1;
+    }
+    for (size_t i = 0; i < remaining; i++) {
+        if (entry_copy(&entries[i], &cr->entries[cr->next_index + i]) < 0) {
+            entries_free(entries, i);
+            return -1;
+        }
+    }
+    cr->next_index = cr->count;
+    cr->entry_valid = false;
+    *entries_out = entries;
+    *count_out = remaining;
+    return 0;
+}
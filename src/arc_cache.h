@@ -0,0 +1,73 @@
+#ifndef ARC_CACHE_H
+#define ARC_CACHE_H
+
+#include "arc_reader.h"
+#include "arc_stream.h"
+#include "arc_base.h"
+#include <sys/stat.h>
+
+/**
+ * Persistent listing cache.
+ *
+ * When enabled with arc_listing_cache_enable(), a full arc_next() pass over
+ * an archive opened by path is recorded (entry metadata plus data locations,
+ * and inflate checkpoints for .tar.gz) into <dir>/<dev>-<ino>.arcls.
+ * The next arc_open_path_ex() on the same file (same dev, inode, size and
+ * mtime) serves the listing from that file instead of re-reading headers,
+ * and opens entry data directly from the recorded offsets.
+ *
+ * Only TAR (plain or compressed) and ZIP archives are cached.
+ */
+
+/**
+ * Internal function to open a cached reader for a file.
+ * Called by arc_open_path_ex() after fstat().
+ *
+ * @param stream File stream (the reader takes ownership on success)
+ * @param st File identity
+ * @param limits Limits for the reader
+ * @return Cached reader, or NULL on a miss (stale, missing or malformed cache
+ *         file, or a listing beyond limits->max_entries or max_name, so a
+ *         hit never lets through what the real reader would reject)
+ */
+ArcReader *arc_cache_open(ArcStream *stream, const struct stat *st, const ArcLimits *limits);
+
+/**
+ * Start recording a freshly opened reader so that a complete listing pass
+ * can be stored. Does nothing when the cache is disabled or the format is
+ * not cacheable.
+ *
+ * @param reader Reader returned by create_reader()
+ * @param st File identity
+ * @param compression Whole-archive compression (ARC_COMPRESSED_*), -1 if none
+ */
+void arc_cache_attach_recorder(ArcReader *reader, const struct stat *st, int compression);
+
+/**
+ * Feed the result of the format's next() to the recorder.
+ * Writes the cache file when ret == 1 (end of archive) and drops the
+ * recorder on error.
+ */
+void arc_cache_record(ArcReader *reader, const ArcEntry *entry, int ret);
+
+/**
+ * Drop a reader's recorder without writing anything.
+ */
+void arc_cache_detach_recorder(ArcReader *reader);
+
+/**
+ * Internal cached reader functions (exposed for arc_reader.c).
+ */
+int arc_cached_next(ArcReader *reader, ArcEntry *entry);
+ArcStream *arc_cached_open_data(ArcReader *reader);
+int arc_cached_skip_data(ArcReader *reader);
+int arc_cached_rewind(ArcReader *reader);
+void arc_cached_close(ArcReader *reader);
+int arc_cached_entry_location(ArcReader *reader, ArcEntryLocation *loc);
+
+/**
+ * Copy all remaining entries of a cached reader in one go.
+ */
+int arc_cached_list(ArcReader *reader, ArcEntry **entries_out, size_t *count_out);
+
+#endif // ARC_CACHE_H
@@ -0,0 +1,978 @@
+#define _POSIX_C_SOURCE 200809L
+#include "arc_codec.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <zlib.h>
+#include <bzlib.h>
+
+#ifndef HAVE_LZMA
+#  if defined(__has_include)
+#    if __has_include(<lzma.h>)
+#      include <lzma.h>
+#      define HAVE_LZMA 1
+#    else
+#      define HAVE_LZMA 0
+#    endif
+#  else
+#    include <lzma.h>
+#    define HAVE_LZMA 1
+#  endif
+#elif HAVE_LZMA
+#  include <lzma.h>
+#endif
+
+#ifdef ARC_HAVE_LIBDEFLATE
+#include <libdeflate.h>
+#endif
+
+#define ARC_CODEC_MAX_BACKENDS 8
+#define ARC_CODEC_POOL_SIZE 4
+#define ARC_CODEC_IN_BUF_SIZE (64 * 1024)
+
+static const char *const codec_names[ARC_CODEC_COUNT] = {
+    [ARC_CODEC_GZIP] = "gzip",
+    [ARC_CODEC_DEFLATE] = "deflate",
+    [ARC_CODEC_BZIP2] = "bzip2",
+    [ARC_CODEC_XZ] = "xz",
+    [ARC_CODEC_LZMA] = "lzma",
+    [ARC_CODEC_LZMA2] = "lzma2",
+};
+
+// zlib (gzip, raw deflate)
+
+static void *zlib_init(int window_bits) {
+    z_stream *zs = calloc(1, sizeof(*zs));
+    if (!zs) {
+        return NULL;
+    }
+    int ret = inflateInit2(zs, window_bits);
+    if (ret != Z_OK) {
+        free(zs);
+        errno = ret == Z_MEM_ERROR ? ENOMEM : EINVAL;
+        return NULL;
+    }
+    return zs;
+}
+
+static void *zlib_gzip_init(const uint8_t *props, size_t props_len) {
+    (void)props;
+    (void)props_len;
+    return zlib_init(16 + MAX_WBITS);
+}
+
+static void *zlib_deflate_init(const uint8_t *props, size_t props_len) {
+    (void)props;
+    (void)props_len;
+    // -MAX_WBITS: raw deflate, no zlib/gzip wrapper
+    return zlib_init(-MAX_WBITS);
+}
+
+static int zlib_decode(void *state, ArcCodecIo *io, bool finish) {
+    (void)finish;
+    z_stream *zs = (z_stream *)state;
+    uInt in = io->avail_in > UINT_MAX ? UINT_MAX : (uInt)io->avail_in;
+    uInt out = io->avail_out > UINT_MAX ? UINT_MAX : (uInt)io->avail_out;
+    zs->next_in = (Bytef *)io->next_in;
+    zs->avail_in = in;
+    zs->next_out = io->next_out;
+    zs->avail_out = out;
+
+    int ret = inflate(zs, Z_NO_FLUSH);
+
+    io->next_in += in - zs->avail_in;
+    io->avail_in -= in - zs->avail_in;
+    io->next_out += out - zs->avail_out;
+    io->avail_out -= out - zs->avail_out;
+
+    switch (ret) {
+    case Z_STREAM_END:
+        return ARC_CODEC_END;
+    case Z_OK:
+    case Z_BUF_ERROR:  // No progress possible; the caller decides if that is truncation
+        return ARC_CODEC_OK;
+    case Z_MEM_ERROR:
+        errno = ENOMEM;
+        return -1;
+    default:
+        errno = EINVAL;
+        return -1;
+    }
+}
+
+static int zlib_reset(void *state) {
+    return inflateReset((z_stream *)state) == Z_OK ? 0 : -1;
+}
+
+static void zlib_end(void *state) {
+    inflateEnd((z_stream *)state);
+    free(state);
+}
+
+static const ArcCodecBackend zlib_gzip_backend = {
+    .name = "zlib",
+    .codec = ARC_CODEC_GZIP,
+    .init = zlib_gzip_init,
+    .decode = zlib_decode,
+    .reset = zlib_reset,
+    .end = zlib_end,
+};
+
+static const ArcCodecBackend zlib_deflate_backend = {
+    .name = "zlib",
+    .codec = ARC_CODEC_DEFLATE,
+    .init = zlib_deflate_init,
+    .decode = zlib_decode,
+    .reset = zlib_reset,
+    .end = zlib_end,
+};
+
+// libbz2
+
+static void *bzip2_init(const uint8_t *props, size_t props_len) {
+    (void)props;
+    (void)props_len;
+    bz_stream *bzs = calloc(1, sizeof(*bzs));
+    if (!bzs) {
+        return NULL;
+    }
+    if (BZ2_bzDecompressInit(bzs, 0, 0) != BZ_OK) {
+        free(bzs);
+        errno = ENOMEM;
+        return NULL;
+    }
+    return bzs;
+}
+
+static int bzip2_decode(void *state, ArcCodecIo *io, bool finish) {
+    (void)finish;
+    bz_stream *bzs = (bz_stream *)state;
+    unsigned int in = io->avail_in > UINT_MAX ? UINT_MAX : (unsigned int)io->avail_in;
+    unsigned int out = io->avail_out > UINT_MAX ? UINT_MAX : (unsigned int)io->avail_out;
+    bzs->next_in = (char *)io->next_in;
+    bzs->avail_in = in;
+    bzs->next_out = (char *)io->next_out;
+    bzs->avail_out = out;
+
+    int ret = BZ2_bzDecompress(bzs);
+
+    io->next_in += in - bzs->avail_in;
+    io->avail_in -= in - bzs->avail_in;
+    io->next_out += out - bzs->avail_out;
+    io->avail_out -= out - bzs->avail_out;
+
+    switch (ret) {
+    case BZ_STREAM_END:
+        return ARC_CODEC_END;
+    case BZ_OK:
+        return ARC_CODEC_OK;
+    case BZ_MEM_ERROR:
+        errno = ENOMEM;
+        return -1;
+    default:
+        errno = EINVAL;
+        return -1;
+    }
+}
+
+static int bzip2_reset(void *state) {
+    // libbz2 has no reset; tear down and start over in place
+    bz_stream *bzs = (bz_stream *)state;
+    BZ2_bzDecompressEnd(bzs);
+    memset(bzs, 0, sizeof(*bzs));
+    return BZ2_bzDecompressInit(bzs, 0, 0) == BZ_OK ? 0 : -1;
+}
+
+static void bzip2_end(void *state) {
+    BZ2_bzDecompressEnd((bz_stream *)state);
+    free(state);
+}
+
+static const ArcCodecBackend bzip2_backend = {
+    .name = "libbz2",
+    .codec = ARC_CODEC_BZIP2,
+    .init = bzip2_init,
+    .decode = bzip2_decode,
+    .reset = bzip2_reset,
+    .end = bzip2_end,
+};
+
+// liblzma (xz container, raw LZMA1/LZMA2 as used by 7z)
+
+#if HAVE_LZMA
+
+typedef struct LzmaState {
+    lzma_stream strm;
+    lzma_filter filters[2];  // Raw decoders only; options allocated by lzma_properties_decode
+    bool raw;
+} LzmaState;
+
+static int lzma_errno(lzma_ret ret) {
+    return (ret == LZMA_MEM_ERROR || ret == LZMA_MEMLIMIT_ERROR) ? ENOMEM : EINVAL;
+}
+
+static int lzma_start(LzmaState *s) {
+    lzma_ret ret = s->raw ? lzma_raw_decoder(&s->strm, s->filters)
+                          : lzma_stream_decoder(&s->strm, UINT64_MAX, LZMA_CONCATENATED | LZMA_TELL_NO_CHECK);
+    if (ret != LZMA_OK) {
+        errno = lzma_errno(ret);
+        return -1;
+    }
+    return 0;
+}
+
+static void lzma_state_free(LzmaState *s) {
+    lzma_end(&s->strm);
+    free(s->filters[0].options);
+    free(s);
+}
+
+static void *lzma_init_common(lzma_vli filter_id, const uint8_t *props, size_t props_len) {
+    LzmaState *s = calloc(1, sizeof(*s));
+    if (!s) {
+        return NULL;
+    }
+    s->strm = (lzma_stream)LZMA_STREAM_INIT;
+    if (filter_id != LZMA_VLI_UNKNOWN) {
+        s->raw = true;
+        s->filters[0].id = filter_id;
+        s->filters[1].id = LZMA_VLI_UNKNOWN;
+        if (!props || lzma_properties_decode(&s->filters[0], NULL, props, props_len) != LZMA_OK) {
+            free(s);
+            errno = EINVAL;
+            return NULL;
+        }
+    }
+    if (lzma_start(s) < 0) {
+        int saved = errno;
+        lzma_state_free(s);
+        errno = saved;
+        return NULL;
+    }
+    return s;
+}
+
+static void *xz_init(const uint8_t *props, size_t props_len) {
+    (void)props;
+    (void)props_len;
+    return lzma_init_common(LZMA_VLI_UNKNOWN, NULL, 0);
+}
+
+static void *lzma1_init(const uint8_t *props, size_t props_len) {
+    if (props_len != 5) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return lzma_init_common(LZMA_FILTER_LZMA1, props, props_len);
+}
+
+static void *lzma2_init(const uint8_t *props, size_t props_len) {
+    if (props_len != 1) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return lzma_init_common(LZMA_FILTER_LZMA2, props, props_len);
+}
+
+static int lzma_decode(void *state, ArcCodecIo *io, bool finish) {
+    LzmaState *s = (LzmaState *)state;
+    s->strm.next_in = io->next_in;
+    s->strm.avail_in = io->avail_in;
+    s->strm.next_out = io->next_out;
+    s->strm.avail_out = io->avail_out;
+
+    lzma_ret ret = lzma_code(&s->strm, finish ? LZMA_FINISH : LZMA_RUN);
+
+    bool progress = s->strm.avail_in != io->avail_in || s->strm.avail_out != io->avail_out;
+    io->next_in = s->strm.next_in;
+    io->avail_in = s->strm.avail_in;
+    io->next_out = s->strm.next_out;
+    io->avail_out = s->strm.avail_out;
+
+    switch (ret) {
+    case LZMA_STREAM_END:
+        return ARC_CODEC_END;
+    case LZMA_OK:
+    case LZMA_NO_CHECK:
+    case LZMA_BUF_ERROR:
+        // Raw LZMA from 7z usually has no end marker: the data simply ends
+        // where the input does
+        if (s->raw && finish && !progress) {
+            return ARC_CODEC_END;
+        }
+        return ARC_CODEC_OK;
+    default:
+        errno = lzma_errno(ret);
+        return -1;
+    }
+}
+
+static int lzma_reset(void *state) {
+    // The decoder init functions reuse an existing lzma_stream's allocations
+    return lzma_start((LzmaState *)state);
+}
+
+static void lzma_backend_end(void *state) {
+    lzma_state_free((LzmaState *)state);
+}
+
+static const ArcCodecBackend xz_backend = {
+    .name = "liblzma",
+    .codec = ARC_CODEC_XZ,
+    .init = xz_init,
+    .decode = lzma_decode,
+    .reset = lzma_reset,
+    .end = lzma_backend_end,
+};
+
+static const ArcCodecBackend lzma1_backend = {
+    .name = "liblzma",
+    .codec = ARC_CODEC_LZMA,
+    .init = lzma1_init,
+    .decode = lzma_decode,
+    .reset = lzma_reset,
+    .end = lzma_backend_end,
+};
+
+static const ArcCodecBackend lzma2_backend = {
+    .name = "liblzma",
+    .codec = ARC_CODEC_LZMA2,
+    .init = lzma2_init,
+    .decode = lzma_decode,
+    .reset = lzma_reset,
+    .end = lzma_backend_end,
+};
+
+#endif // HAVE_LZMA
+
+// libdeflate (whole-buffer inflate only; build with LIBDEFLATE=1)
+
+#ifdef ARC_HAVE_LIBDEFLATE
+
+static int libdeflate_decode(bool gzip, const uint8_t *in, size_t in_len,
+                             uint8_t *out, size_t out_cap, size_t *out_len) {
+    struct libdeflate_decompressor *d = libdeflate_alloc_decompressor();
+    if (!d) {
+        errno = ENOMEM;
+        return -1;
+    }
+    size_t actual = 0;
+    enum libdeflate_result r = gzip
+        ? libdeflate_gzip_decompress(d, in, in_len, out, out_cap, &actual)
+        : libdeflate_deflate_decompress(d, in, in_len, out, out_cap, &actual);
+    libdeflate_free_decompressor(d);
+    if (r != LIBDEFLATE_SUCCESS) {
+        errno = r == LIBDEFLATE_INSUFFICIENT_SPACE ? ENOBUFS : EINVAL;
+        return -1;
+    }
+    *out_len = actual;
+    return 0;
+}
+
+static int libdeflate_gzip_buffer(const uint8_t *props, size_t props_len,
+                                  const uint8_t *in, size_t in_len,
+                                  uint8_t *out, size_t out_cap, size_t *out_len) {
+    (void)props;
+    (void)props_len;
+    return libdeflate_decode(true, in, in_len, out, out_cap, out_len);
+}
+
+static int libdeflate_deflate_buffer(const uint8_t *props, size_t props_len,
+                                     const uint8_t *in, size_t in_len,
+                                     uint8_t *out, size_t out_cap, size_t *out_len) {
+    (void)props;
+    (void)props_len;
+    return libdeflate_decode(false, in, in_len, out, out_cap, out_len);
+}
+
+static const ArcCodecBackend libdeflate_gzip_backend = {
+    .name = "libdeflate",
+    .codec = ARC_CODEC_GZIP,
+    .flags = ARC_CODEC_PREFER_ONESHOT,
+    .decode_buffer = libdeflate_gzip_buffer,
+};
+
+static const ArcCodecBackend libdeflate_deflate_backend = {
+    .name = "libdeflate",
+    .codec = ARC_CODEC_DEFLATE,
+    .flags = ARC_CODEC_PREFER_ONESHOT,
+    .decode_buffer = libdeflate_deflate_buffer,
+};
+
+// Whole ZIP entries are where libdeflate pays off
+#ifndef ARC_CODEC_DEFAULTS
+#define ARC_CODEC_DEFAULTS "deflate=libdeflate"
+#endif
+
+#endif // ARC_HAVE_LIBDEFLATE
+
+// Registry
+
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t registry_once = PTHREAD_ONCE_INIT;
+static const ArcCodecBackend *registry[ARC_CODEC_COUNT][ARC_CODEC_MAX_BACKENDS];
+static size_t registry_count[ARC_CODEC_COUNT];
+static const ArcCodecBackend *selected[ARC_CODEC_COUNT];
+
+// Reset decoder states kept for reuse (codecs without props only)
+typedef struct PooledState {
+    const ArcCodecBackend *backend;
+    void *state;
+} PooledState;
+
+static PooledState state_pool[ARC_CODEC_COUNT][ARC_CODEC_POOL_SIZE];
+
+static const ArcCodecBackend *find_locked(ArcCodec codec, const char *name) {
+    for (size_t i = 0; i < registry_count[codec]; i++) {
+        if (strcmp(registry[codec][i]->name, name) == 0) {
+            return registry[codec][i];
+        }
+    }
+    return NULL;
+}
+
+static int register_locked(const ArcCodecBackend *backend) {
+    ArcCodec codec = backend->codec;
+    if (find_locked(codec, backend->name)) {
+        errno = EEXIST;
+        return -1;
+    }
+    if (registry_count[codec] >= ARC_CODEC_MAX_BACKENDS) {
+        errno = ENOSPC;
+        return -1;
+    }
+    registry[codec][registry_count[codec]++] = backend;
+    if (!selected[codec]) {
+        selected[codec] = backend;
+    }
+    return 0;
+}
+
+// Apply "codec=name,codec=name"; unknown codecs or backends are ignored
+static void apply_selection(const char *spec) {
+    while (spec && *spec) {
+        const char *end = strchr(spec, ',');
+        size_t len = end ? (size_t)(end - spec) : strlen(spec);
+        const char *eq = memchr(spec, '=', len);
+        if (eq) {
+            size_t codec_len = (size_t)(eq - spec);
+            size_t name_len = len - codec_len - 1;
+            char name[64];
+            if (name_len < sizeof(name)) {
+                memcpy(name, eq + 1, name_len);
+                name[name_len] = '\0';
+                for (int c = 0; c < ARC_CODEC_COUNT; c++) {
+                    if (strlen(codec_names[c]) == codec_len && memcmp(codec_names[c], spec, codec_len) == 0) {
+                        const ArcCodecBackend *b = find_locked((ArcCodec)c, name);
+                        if (b) {
+                            selected[c] = b;
+                        }
+                    }
+                }
+            }
+        }
+        spec = end ? end + 1 : NULL;
+    }
+}
+
+static void registry_init(void) {
+    pthread_mutex_lock(&registry_lock);
+    register_locked(&zlib_gzip_backend);
+    register_locked(&zlib_deflate_backend);
+    register_locked(&bzip2_backend);
+#if HAVE_LZMA
+    register_locked(&xz_backend);
+    register_locked(&lzma1_backend);
+    register_locked(&lzma2_backend);
+#endif
+#ifdef ARC_HAVE_LIBDEFLATE
+    register_locked(&libdeflate_gzip_backend);
+    register_locked(&libdeflate_deflate_backend);
+#endif
+#ifdef ARC_CODEC_DEFAULTS
+    apply_selection(ARC_CODEC_DEFAULTS);
+#endif
+    apply_selection(getenv("CUPIDARCHIVE_CODECS"));
+    pthread_mutex_unlock(&registry_lock);
+}
+
+static bool codec_valid(ArcCodec codec) {
+    return (int)codec >= 0 && codec < ARC_CODEC_COUNT;
+}
+
+int arc_codec_register(const ArcCodecBackend *backend) {
+    if (!backend || !backend->name || !codec_valid(backend->codec) ||
+        (!backend->decode_buffer && !(backend->init && backend->decode && backend->end))) {
+        errno = EINVAL;
+        return -1;
+    }
+    pthread_once(&registry_once, registry_init);
+    pthread_mutex_lock(&registry_lock);
+    int ret = register_locked(backend);
+    pthread_mutex_unlock(&registry_lock);
+    return ret;
+}
+
+const ArcCodecBackend *arc_codec_find(ArcCodec codec, const char *name) {
+    if (!codec_valid(codec) || !name) {
+        errno = EINVAL;
+        return NULL;
+    }
+    pthread_once(&registry_once, registry_init);
+    pthread_mutex_lock(&registry_lock);
+    const ArcCodecBackend *b = find_locked(codec, name);
+    pthread_mutex_unlock(&registry_lock);
+    if (!b) {
+        errno = ENOENT;
+    }
+    return b;
+}
+
+int arc_codec_select(ArcCodec codec, const char *name) {
+    if (!codec_valid(codec) || !name) {
+        errno = EINVAL;
+        return -1;
+    }
+    pthread_once(&registry_once, registry_init);
+    pthread_mutex_lock(&registry_lock);
+    const ArcCodecBackend *b = find_locked(codec, name);
+    if (b) {
+        selected[codec] = b;
+    }
+    pthread_mutex_unlock(&registry_lock);
+    if (!b) {
+        errno = ENOENT;
+        return -1;
+    }
+    return 0;
+}
+
+const ArcCodecBackend *arc_codec_selected(ArcCodec codec) {
+    if (!codec_valid(codec)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    pthread_once(&registry_once, registry_init);
+    pthread_mutex_lock(&registry_lock);
+    const ArcCodecBackend *b = selected[codec];
+    pthread_mutex_unlock(&registry_lock);
+    if (!b) {
+        errno = ENOSYS;
+    }
+    return b;
+}
+
+const char *arc_codec_name(ArcCodec codec) {
+    return codec_valid(codec) ? codec_names[codec] : NULL;
+}
+
+size_t arc_codec_list(ArcCodec codec, const ArcCodecBackend **out, size_t max) {
+    if (!codec_valid(codec)) {
+        return 0;
+    }
+    pthread_once(&registry_once, registry_init);
+    pthread_mutex_lock(&registry_lock);
+    size_t count = registry_count[codec];
+    for (size_t i = 0; i < count && i < max; i++) {
+        out[i] = registry[codec][i];
+    }
+    pthread_mutex_unlock(&registry_lock);
+    return count;
+}
+
+// Backend that can stream `codec`: the selected one, else the built-in
+static const ArcCodecBackend *streaming_backend(ArcCodec codec) {
+    pthread_once(&registry_once, registry_init);
+    pthread_mutex_lock(&registry_lock);
+    const ArcCodecBackend *b = selected[codec];
+    if (b && !b->init) {
+        b = registry_count[codec] > 0 ? registry[codec][0] : NULL;
+    }
+    pthread_mutex_unlock(&registry_lock);
+    if (!b || !b->init) {
+        errno = ENOSYS;
+        return NULL;
+    }
+    return b;
+}
+
+static void *state_acquire(const ArcCodecBackend *b, const uint8_t *props, size_t props_len) {
+    if (props_len == 0) {
+        pthread_mutex_lock(&registry_lock);
+        PooledState *pool = state_pool[b->codec];
+        for (size_t i = 0; i < ARC_CODEC_POOL_SIZE; i++) {
+            if (pool[i].state && pool[i].backend == b) {
+                void *state = pool[i].state;
+                pool[i].state = NULL;
+                pthread_mutex_unlock(&registry_lock);
+                return state;
+            }
+        }
+        pthread_mutex_unlock(&registry_lock);
+    }
+    return b->init(props, props_len);
+}
+
+static void state_release(const ArcCodecBackend *b, void *state, size_t props_len) {
+    if (!state) {
+        return;
+    }
+    if (props_len == 0 && b->reset && b->reset(state) == 0) {
+        pthread_mutex_lock(&registry_lock);
+        PooledState *pool = state_pool[b->codec];
+        for (size_t i = 0; i < ARC_CODEC_POOL_SIZE; i++) {
+            if (!pool[i].state) {
+                pool[i].backend = b;
+                pool[i].state = state;
+                pthread_mutex_unlock(&registry_lock);
+                return;
+            }
+        }
+        pthread_mutex_unlock(&registry_lock);
+    }
+    b->end(state);
+}
+
+// Drive a streaming backend over a whole buffer
+static int stream_decode_buffer(const ArcCodecBackend *b, const uint8_t *props, size_t props_len,
+                                const uint8_t *in, size_t in_len,
+                                uint8_t *out, size_t out_cap, size_t *out_len) {
+    void *state = state_acquire(b, props, props_len);
+    if (!state) {
+        return -1;
+    }
+    ArcCodecIo io = { .next_in = in, .avail_in = in_len, .next_out = out, .avail_out = out_cap };
+    int ret;
+    for (;;) {
+        size_t in_before = io.avail_in;
+        size_t out_before = io.avail_out;
+        ret = b->decode(state, &io, true);
+        if (ret < 0 || ret == ARC_CODEC_END) {
+            break;
+        }
+        if (io.avail_in == in_before && io.avail_out == out_before) {
+            errno = io.avail_out == 0 ? ENOBUFS : EINVAL;
+            ret = -1;
+            break;
+        }
+    }
+    if (ret < 0) {
+        int saved = errno;
+        b->end(state);
+        errno = saved;
+        return -1;
+    }
+    state_release(b, state, props_len);
+    *out_len = out_cap - io.avail_out;
+    return 0;
+}
+
+int arc_codec_decode_buffer(ArcCodec codec, const uint8_t *props, size_t props_len,
+                            const uint8_t *in, size_t in_len,
+                            uint8_t *out, size_t out_cap, size_t *out_len) {
+    if (!codec_valid(codec) || (!in && in_len) || (!out && out_cap) || !out_len) {
+        errno = EINVAL;
+        return -1;
+    }
+    const ArcCodecBackend *b = arc_codec_selected(codec);
+    if (!b) {
+        return -1;
+    }
+    if (b->decode_buffer) {
+        return b->decode_buffer(props, props_len, in, in_len, out, out_cap, out_len);
+    }
+    return stream_decode_buffer(b, props, props_len, in, in_len, out, out_cap, out_len);
+}
+
+// Streaming filter
+
+typedef struct CodecFilterData {
+    ArcStream *underlying;
+    const ArcCodecBackend *backend;
+    void *state;
+    uint8_t *props;
+    size_t props_len;
+    uint8_t *in_buf;
+    ArcCodecIo io;
+    bool input_eof;
+    bool eof;
+    bool owns_underlying;
+} CodecFilterData;
+
+// After a gzip member ends: reset the decoder if another member follows,
+// so concatenated members decode as one stream (as with gzip -d). Returns 1
+// to continue, 0 at the end of the data, -1 on error.
+static int codec_filter_next_member(CodecFilterData *data) {
+    ArcCodecIo *io = &data->io;
+    if (data->backend->codec != ARC_CODEC_GZIP || !data->backend->reset) {
+        return 0;
+    }
+    while (io->avail_in < 2 && !data->input_eof) {
+        size_t have = io->avail_in;
+        if (have > 0) {
+            memmove(data->in_buf, io->next_in, have);
+        }
+        ssize_t in_read = arc_stream_read(data->underlying, data->in_buf + have, ARC_CODEC_IN_BUF_SIZE - have);
+        if (in_read < 0) {
+            return -1;
+        }
+        data->input_eof = in_read == 0;
+        io->next_in = data->in_buf;
+        io->avail_in = have + (size_t)in_read;
+    }
+    if (io->avail_in < 2 || io->next_in[0] != 0x1f || io->next_in[1] != 0x8b) {
+        return 0;  // Trailing bytes that aren't a member are ignored
+    }
+    return data->backend->reset(data->state) == 0 ? 1 : -1;
+}
+
+static ssize_t codec_filter_read(ArcStream *stream, void *buf, size_t n) {
+    CodecFilterData *data = (CodecFilterData *)stream->user_data;
+
+    if (!data->state) {
+        data->state = state_acquire(data->backend, data->props, data->props_len);
+        if (!data->state) {
+            return -1;
+        }
+    }
+
+    if (data->eof) {
+        return 0;
+    }
+
+    // Enforce byte limit
+    if (stream->byte_limit > 0) {
+        int64_t remaining = stream->byte_limit - stream->bytes_read;
+        if (remaining <= 0) {
+            return 0; // EOF (limit reached)
+        }
+        if ((int64_t)n > remaining) {
+            n = (size_t)remaining;
+        }
+    }
+
+    ArcCodecIo *io = &data->io;
+    io->next_out = (uint8_t *)buf;
+    io->avail_out = n;
+
+    while (io->avail_out > 0 && !data->eof) {
+        if (io->avail_in == 0 && !data->input_eof) {
+            ssize_t in_read = arc_stream_read(data->underlying, data->in_buf, ARC_CODEC_IN_BUF_SIZE);
+            if (in_read < 0) {
+                return -1;
+            }
+            data->input_eof = in_read == 0;
+            io->next_in = data->in_buf;
+            io->avail_in = (size_t)in_read;
+        }
+
+        size_t in_before = io->avail_in;
+        size_t out_before = io->avail_out;
+        int ret = data->backend->decode(data->state, io, data->input_eof);
+        if (ret < 0) {
+            return -1;
+        }
+        if (ret == ARC_CODEC_END) {
+            int more = codec_filter_next_member(data);
+            if (more < 0) {
+                return -1;
+            }
+            if (more == 0) {
+                data->eof = true;
+                break;
+            }
+            continue;
+        }
+        if (data->input_eof && io->avail_in == in_before && io->avail_out == out_before) {
+            // Input exhausted before the end of the compressed stream
+            errno = EINVAL;
+            return -1;
+        }
+    }
+
+    size_t decompressed = n - io->avail_out;
+    stream->bytes_read += decompressed;
+    return (ssize_t)decompressed;
+}
+
+static int codec_filter_seek(ArcStream *stream, int64_t off, int whence) {
+    // Streaming decompression can't seek
+    (void)stream;
+    (void)off;
+    (void)whence;
+    errno = ESPIPE;
+    return -1;
+}
+
+static int64_t codec_filter_tell(ArcStream *stream) {
+    return stream->bytes_read;
+}
+
+static void codec_filter_close(ArcStream *stream) {
+    CodecFilterData *data = (CodecFilterData *)stream->user_data;
+    state_release(data->backend, data->state, data->props_len);
+    if (data->owns_underlying) {
+        arc_stream_close(data->underlying);
+    }
+    free(data->in_buf);
+    free(data->props);
+    free(data);
+    free(stream);
+}
+
+static const struct ArcStreamVtable codec_filter_vtable = {
+    .read = codec_filter_read,
+    .seek = codec_filter_seek,
+    .tell = codec_filter_tell,
+    .close = codec_filter_close,
+};
+
+ArcStream *arc_codec_filter(ArcStream *underlying, ArcCodec codec,
+                            const uint8_t *props, size_t props_len,
+                            int64_t byte_limit, bool owned) {
+    if (!underlying || !codec_valid(codec) || (!props && props_len)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    const ArcCodecBackend *backend = streaming_backend(codec);
+    if (!backend) {
+        return NULL;
+    }
+
+    ArcStream *stream = calloc(1, sizeof(ArcStream));
+    CodecFilterData *data = calloc(1, sizeof(CodecFilterData));
+    if (!stream || !data) {
+        free(stream);
+        free(data);
+        return NULL;
+    }
+    data->in_buf = malloc(ARC_CODEC_IN_BUF_SIZE);
+    if (props_len > 0) {
+        data->props = malloc(props_len);
+    }
+    if (!data->in_buf || (props_len > 0 && !data->props)) {
+        free(data->in_buf);
+        free(data->props);
+        free(data);
+        free(stream);
+        return NULL;
+    }
+    if (props_len > 0) {
+        memcpy(data->props, props, props_len);
+    }
+    data->props_len = props_len;
+    data->underlying = underlying;
+    data->backend = backend;
+    data->owns_underlying = owned;
+
+    stream->vtable = &codec_filter_vtable;
+    stream->byte_limit = byte_limit;
+    stream->bytes_read = 0;
+    stream->user_data = data;
+    return stream;
+}
+
+// One-shot decode into an owned memory stream
+
+typedef struct OneshotData {
+    ArcStream *mem;
+    uint8_t *buf;
+} OneshotData;
+
+static ssize_t oneshot_read(ArcStream *stream, void *buf, size_t n) {
+    OneshotData *data = (OneshotData *)stream->user_data;
+    ssize_t got = arc_stream_read(data->mem, buf, n);
+    if (got > 0) {
+        stream->bytes_read += got;
+    }
+    return got;
+}
+
+static int oneshot_seek(ArcStream *stream, int64_t off, int whence) {
+    OneshotData *data = (OneshotData *)stream->user_data;
+    return arc_stream_seek(data->mem, off, whence);
+}
+
+static int64_t oneshot_tell(ArcStream *stream) {
+    OneshotData *data = (OneshotData *)stream->user_data;
+    return arc_stream_tell(data->mem);
+}
+
+static void oneshot_close(ArcStream *stream) {
+    OneshotData *data = (OneshotData *)stream->user_data;
+    arc_stream_close(data->mem);
+    free(data->buf);
+    free(data);
+    free(stream);
+}
+
+static const struct ArcStreamVtable oneshot_vtable = {
+    .read = oneshot_read,
+    .seek = oneshot_seek,
+    .tell = oneshot_tell,
+    .close = oneshot_close,
+};
+
+ArcStream *arc_codec_oneshot(ArcStream *underlying, ArcCodec codec,
+                             const uint8_t *props, size_t props_len,
+                             size_t in_size, size_t out_size, bool owned) {
+    if (!underlying || !codec_valid(codec) || in_size == 0 || in_size > SIZE_MAX / 2) {
+        errno = EINVAL;
+        return NULL;
+    }
+    uint8_t *in = malloc(in_size);
+    uint8_t *out = malloc(out_size > 0 ? out_size : 1);
+    if (!in || !out) {
+        free(in);
+        free(out);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    size_t have = 0;
+    while (have < in_size) {
+        ssize_t got = arc_stream_read(underlying, in + have, in_size - have);
+        if (got <= 0) {
+            if (got == 0) {
+                errno = EINVAL; // Shorter than announced
+            }
+            free(in);
+            free(out);
+            return NULL;
+        }
+        have += (size_t)got;
+    }
+
+    size_t out_len = 0;
+    int ret = arc_codec_decode_buffer(codec, props, props_len, in, in_size, out, out_size, &out_len);
+    free(in);
+    if (ret < 0) {
+        free(out);
+        return NULL;
+    }
+
+    ArcStream *stream = calloc(1, sizeof(ArcStream));
+    OneshotData *data = calloc(1, sizeof(OneshotData));
+    ArcStream *mem = arc_stream_from_memory(out, out_len, 0);
+    if (!stream || !data || !mem) {
+        arc_stream_close(mem);
+        free(data);
+        free(stream);
+        free(out);
+        errno = ENOMEM;
+        return NULL;
+    }
+    data->mem = mem;
+    data->buf = out;
+    stream->vtable = &oneshot_vtable;
+    stream->byte_limit = 0;
+    stream->bytes_read = 0;
+    stream->user_data = data;
+
+    if (owned) {
+        arc_stream_close(underlying);
+    }
+    return stream;
+}
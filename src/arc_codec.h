@@ -0,0 +1,180 @@
+#ifndef ARC_CODEC_H
+#define ARC_CODEC_H
+
+#include "arc_stream.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Decompressor backend registry.
+ *
+ * Every compression codec the readers understand is decoded through a
+ * backend: a small vtable around one decompression library. The built-in
+ * backends wrap zlib, libbz2 and liblzma; other implementations (zlib-ng,
+ * libdeflate, a bundled inflate) register under the same codec and are
+ * picked per codec at build time, from the environment, or with
+ * arc_codec_select().
+ *
+ * Build-time defaults come from the ARC_CODEC_DEFAULTS macro and runtime
+ * overrides from the CUPIDARCHIVE_CODECS environment variable, both in the
+ * form "deflate=libdeflate,gzip=zlib". The environment wins.
+ */
+
+typedef enum ArcCodec {
+    ARC_CODEC_GZIP,     // gzip (RFC 1952); only arc_codec_filter() joins concatenated members
+    ARC_CODEC_DEFLATE,  // Raw deflate (RFC 1951), as stored in ZIP
+    ARC_CODEC_BZIP2,    // bzip2 stream
+    ARC_CODEC_XZ,       // .xz container, concatenated streams joined
+    ARC_CODEC_LZMA,     // Raw LZMA1 (props: 5-byte lc/lp/pb + dictionary size, as in 7z)
+    ARC_CODEC_LZMA2,    // Raw LZMA2 (props: 1-byte dictionary size, as in 7z)
+    ARC_CODEC_COUNT
+} ArcCodec;
+
+// Return values of ArcCodecBackend.decode (errors return -1 and set errno)
+#define ARC_CODEC_OK  0  // Progress made (or input needed)
+#define ARC_CODEC_END 1  // End of the compressed stream reached
+
+// Backend flags
+#define ARC_CODEC_PREFER_ONESHOT 0x1u  // decode_buffer is much faster than streaming; use it when sizes are known
+
+/**
+ * Input/output window handed to a streaming decode call. The backend
+ * advances next_in/next_out and lowers avail_in/avail_out by what it
+ * consumed and produced.
+ */
+typedef struct ArcCodecIo {
+    const uint8_t *next_in;
+    size_t avail_in;
+    uint8_t *next_out;
+    size_t avail_out;
+} ArcCodecIo;
+
+typedef struct ArcCodecBackend {
+    const char *name;   // Unique per codec ("zlib", "libdeflate", ...)
+    ArcCodec codec;
+    unsigned flags;     // ARC_CODEC_* flags
+
+    /**
+     * Create a streaming decoder state.
+     * NULL for backends that only decode whole buffers.
+     *
+     * @return State, or NULL with errno set (EINVAL for bad props)
+     */
+    void *(*init)(const uint8_t *props, size_t props_len);
+
+    /**
+     * Decode from io->next_in into io->next_out.
+     * `finish` is true once the caller has no more input than io->avail_in.
+     * A call that neither consumes nor produces anything while `finish` is
+     * set means the stream is truncated.
+     *
+     * @return ARC_CODEC_OK, ARC_CODEC_END, or -1 with errno (EINVAL = corrupt data)
+     */
+    int (*decode)(void *state, ArcCodecIo *io, bool finish);
+
+    /**
+     * Return a state to its freshly initialised condition so it can decode
+     * another stream with the same props (optional).
+     *
+     * @return 0 on success, -1 if the state must be discarded
+     */
+    int (*reset)(void *state);
+
+    void (*end)(void *state);
+
+    /**
+     * One-shot decode of a complete compressed buffer (optional).
+     * Without it arc_codec_decode_buffer() drives init/decode/end.
+     *
+     * @return 0 with *out_len set, or -1 with errno (ENOBUFS = out too small, EINVAL = corrupt)
+     */
+    int (*decode_buffer)(const uint8_t *props, size_t props_len,
+                         const uint8_t *in, size_t in_len,
+                         uint8_t *out, size_t out_cap, size_t *out_len);
+} ArcCodecBackend;
+
+/**
+ * Largest entry the readers decode in one shot when the selected backend
+ * sets ARC_CODEC_PREFER_ONESHOT (compressed + decoded sizes are held in memory).
+ */
+#define ARC_CODEC_ONESHOT_MAX (64 * 1024 * 1024)
+
+/**
+ * Register a backend. The struct is not copied and must stay valid for the
+ * life of the process. Registering does not select it.
+ *
+ * @return 0 on success, -1 with errno (EEXIST = name taken for this codec, ENOSPC = registry full)
+ */
+int arc_codec_register(const ArcCodecBackend *backend);
+
+/**
+ * Look up a registered backend by name.
+ *
+ * @return Backend, or NULL with errno = ENOENT
+ */
+const ArcCodecBackend *arc_codec_find(ArcCodec codec, const char *name);
+
+/**
+ * Make `name` the backend used for `codec` by every filter and reader
+ * opened afterwards. Streams already open keep their backend.
+ *
+ * @return 0 on success, -1 with errno = ENOENT if no such backend
+ */
+int arc_codec_select(ArcCodec codec, const char *name);
+
+/**
+ * Backend currently selected for `codec` (the built-in one unless changed),
+ * or NULL if the codec has no backend in this build.
+ */
+const ArcCodecBackend *arc_codec_selected(ArcCodec codec);
+
+/**
+ * Short name of a codec ("gzip", "deflate", "bzip2", "xz", "lzma", "lzma2"),
+ * as used in ARC_CODEC_DEFAULTS and CUPIDARCHIVE_CODECS.
+ */
+const char *arc_codec_name(ArcCodec codec);
+
+/**
+ * Fill `out` with the backends registered for `codec`, built-in first.
+ *
+ * @return Total number registered (may exceed max)
+ */
+size_t arc_codec_list(ArcCodec codec, const ArcCodecBackend **out, size_t max);
+
+/**
+ * Decode a complete compressed buffer with the selected backend.
+ *
+ * @return 0 with *out_len set, or -1 with errno (ENOBUFS = out too small, EINVAL = corrupt or truncated)
+ */
+int arc_codec_decode_buffer(ArcCodec codec, const uint8_t *props, size_t props_len,
+                            const uint8_t *in, size_t in_len,
+                            uint8_t *out, size_t out_cap, size_t *out_len);
+
+/**
+ * Create a decompression filter for `codec` on top of `underlying` using
+ * the selected backend (the built-in one if the selected backend cannot stream).
+ *
+ * @param underlying Stream to decompress
+ * @param props Codec properties (copied; NULL for codecs without props)
+ * @param byte_limit Maximum decompressed bytes to allow (0 = unlimited)
+ * @param owned Close `underlying` when the filter is closed
+ * @return New stream, or NULL on error
+ */
+ArcStream *arc_codec_filter(ArcStream *underlying, ArcCodec codec,
+                            const uint8_t *props, size_t props_len,
+                            int64_t byte_limit, bool owned);
+
+/**
+ * Read `in_size` compressed bytes from `underlying`, decode them in one
+ * shot into `out_size` bytes and return a seekable memory stream over the
+ * result. `underlying` is closed if `owned` and the call succeeds; on
+ * failure it is left open (its position is unspecified).
+ *
+ * @return New stream, or NULL with errno set
+ */
+ArcStream *arc_codec_oneshot(ArcStream *underlying, ArcCodec codec,
+                             const uint8_t *props, size_t props_len,
+                             size_t in_size, size_t out_size, bool owned);
+
+#endif // ARC_CODEC_H
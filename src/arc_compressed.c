@@ -25,11 +25,6 @@
 #  endif
 #endif
 
-// Format types (must match arc_reader.c)
-#define ARC_FORMAT_TAR 0
-#define ARC_FORMAT_ZIP 1
-#define ARC_FORMAT_COMPRESSED 2
-
 // Compressed file reader structure
 typedef struct CompressedReader {
     ArcReaderBase base;  // Must be first member for safe dispatch
@@ -41,7 +36,7 @@ typedef struct CompressedReader {
     bool entry_valid;              // Whether entry data is available
     bool entry_returned;           // Whether we've returned the entry
     char *original_path;           // Original file path (for filename extraction)
-    int compression_type;          // ARC_COMPRESSED_GZIP or ARC_COMPRESSED_BZIP2
+    int compression_type;          // ARC_COMPRESSED_*
     uint64_t uncompressed_size;    // Uncompressed size (if known, 0 = unknown)
 } CompressedReader;
 
@@ -75,6 +70,8 @@ static char *extract_base_filename(const char *path) {
         result[len - 4] = '\0';
     } else if (len >= 3 && strcmp(result + len - 3, ".xz") == 0) {
         result[len - 3] = '\0';
+    } else if (len >= 4 && strcmp(result + len - 4, ".lz4") == 0) {
+        result[len - 4] = '\0';
     }
     
     return result;
@@ -124,6 +121,41 @@ static uint64_t extract_gzip_isize(ArcStream *original_stream) {
     return (uint64_t)isize;
 }
 
+/**
+ * Read the content size from the first LZ4 frame descriptor (only present
+ * when the encoder was asked for it, e.g. `lz4 --content-size`).
+ * Returns 0 if size cannot be determined.
+ */
+static uint64_t extract_lz4_content_size(ArcStream *original_stream) {
+    if (!original_stream) {
+        return 0;
+    }
+
+    int64_t current_pos = arc_stream_tell(original_stream);
+    if (current_pos < 0) {
+        return 0;
+    }
+
+    // Magic, FLG, BD, then the 8-byte content size when FLG bit 3 is set
+    uint8_t header[14];
+    if (arc_stream_seek(original_stream, 0, SEEK_SET) < 0) {
+        arc_stream_seek(original_stream, current_pos, SEEK_SET);
+        return 0;
+    }
+    ssize_t n = arc_stream_read(original_stream, header, sizeof(header));
+    arc_stream_seek(original_stream, current_pos, SEEK_SET);
+    if (n != (ssize_t)sizeof(header) || memcmp(header, "\x04\x22\x4D\x18", 4) != 0 ||
+        !(header[4] & 0x08)) {
+        return 0;
+    }
+
+    uint64_t size = 0;
+    for (int i = 7; i >= 0; i--) {
+        size = (size << 8) | header[6 + i];
+    }
+    return size;
+}
+
 #if HAVE_LZMA
 /**
  * Extract uncompressed size from an .xz stream by decoding the Index.
@@ -330,10 +362,13 @@ ArcStream *arc_compressed_open_data(ArcReader *reader) {
         return NULL;
     }
     
-    // Return the decompressed stream directly
-    // Note: We don't create a substream because we don't know the size
-    // The stream will naturally end when decompression is complete
-    return comp->decompressed;
+    // Hand the decompressed stream over directly: we don't know the size, so
+    // no substream, and the stream naturally ends when decompression does.
+    // Callers close the data stream, so the reader gives up ownership of it.
+    ArcStream *data = comp->decompressed;
+    comp->decompressed = NULL;
+    comp->base.stream = NULL;
+    return data;
 }
 
 int arc_compressed_skip_data(ArcReader *reader) {
@@ -369,6 +404,13 @@ void arc_compressed_set_original_stream(ArcReader *reader, ArcStream *original_s
         }
     }
     // Note: bzip2 doesn't store uncompressed size in the file footer
+    if (original_stream && comp->compression_type == ARC_COMPRESSED_LZ4) {
+        uint64_t size = extract_lz4_content_size(original_stream);
+        if (size > 0) {
+            comp->uncompressed_size = size;
+            comp->current_entry.size = size;
+        }
+    }
 #if HAVE_LZMA
     if (original_stream && comp->compression_type == ARC_COMPRESSED_XZ) {
         uint64_t usize = extract_xz_usize(original_stream);
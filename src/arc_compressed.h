@@ -10,6 +10,8 @@
  * Supports:
  * - Gzip (.gz) - single compressed files
  * - Bzip2 (.bz2) - single compressed files
+ * - XZ (.xz) - single compressed files
+ * - LZ4 (.lz4) - single compressed files (LZ4 frame format)
  * 
  * These are not archives, but compressed single files.
  * The reader presents them as a single "virtual" entry with the
@@ -43,6 +45,7 @@ void arc_compressed_set_original_stream(ArcReader *reader, ArcStream *original_s
 #define ARC_COMPRESSED_GZIP  0
 #define ARC_COMPRESSED_BZIP2 1
 #define ARC_COMPRESSED_XZ    2
+#define ARC_COMPRESSED_LZ4   3
 
 #endif // ARC_COMPRESSED_H
 
@@ -0,0 +1,250 @@
+#define _POSIX_C_SOURCE 200809L
+#include "arc_deflate_pool.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <zlib.h>
+
+#define POOL_MAX_THREADS 64
+
+struct ArcDeflatePool {
+    int level;
+    unsigned thread_count;
+    pthread_t threads[POOL_MAX_THREADS];
+    pthread_mutex_t lock;
+    pthread_cond_t work;       // Signalled when a block is queued or on shutdown
+    pthread_cond_t finished;   // Signalled when a block is done
+    ArcDeflateBlock *head;     // FIFO of queued blocks
+    ArcDeflateBlock *tail;
+    bool shutdown;
+    z_stream inline_zs;        // For thread_count == 0
+    bool inline_ready;
+};
+
+static int ensure_capacity(uint8_t **buf, size_t *capacity, size_t needed) {
+    if (*capacity >= needed) {
+        return 0;
+    }
+    uint8_t *grown = realloc(*buf, needed);
+    if (!grown) {
+        return -1;
+    }
+    *buf = grown;
+    *capacity = needed;
+    return 0;
+}
+
+/**
+ * Compress one block with a (reset) raw deflate stream.
+ */
+static int compress_block(z_stream *zs, ArcDeflateBlock *b) {
+    b->crc = (uint32_t)crc32(crc32(0L, Z_NULL, 0), b->in, (uInt)b->in_len);
+    b->out_len = 0;
+
+    if (b->store) {
+        if (ensure_capacity(&b->out, &b->out_capacity, b->in_len ? b->in_len : 1) < 0) {
+            return ENOMEM;
+        }
+        memcpy(b->out, b->in, b->in_len);
+        b->out_len = b->in_len;
+        return 0;
+    }
+
+    if (deflateReset(zs) != Z_OK) {
+        return EIO;
+    }
+    if (b->dict_len > 0 && deflateSetDictionary(zs, b->dict, (uInt)b->dict_len) != Z_OK) {
+        return EIO;
+    }
+    // deflateBound() covers Z_FINISH; a sync flush adds at most a few bytes
+    size_t bound = deflateBound(zs, (uLong)b->in_len) + 16;
+    if (ensure_capacity(&b->out, &b->out_capacity, bound) < 0) {
+        return ENOMEM;
+    }
+    zs->next_in = b->in;
+    zs->avail_in = (uInt)b->in_len;
+    zs->next_out = b->out;
+    zs->avail_out = (uInt)b->out_capacity;
+    int ret = deflate(zs, b->last ? Z_FINISH : Z_SYNC_FLUSH);
+    if ((b->last && ret != Z_STREAM_END) || (!b->last && ret != Z_OK) || zs->avail_in != 0) {
+        return EIO;
+    }
+    b->out_len = b->out_capacity - zs->avail_out;
+    return 0;
+}
+
+static int init_stream(z_stream *zs, int level) {
+    memset(zs, 0, sizeof(*zs));
+    // Negative window bits: raw deflate, framed by the caller (ZIP or gzip)
+    return deflateInit2(zs, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK ? 0 : -1;
+}
+
+static void *pool_worker(void *arg) {
+    ArcDeflatePool *pool = arg;
+    z_stream zs;
+    bool ready = init_stream(&zs, pool->level) == 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->head && !pool->shutdown) {
+            pthread_cond_wait(&pool->work, &pool->lock);
+        }
+        if (!pool->head) {
+            break;
+        }
+        ArcDeflateBlock *b = pool->head;
+        pool->head = b->next;
+        if (!pool->head) {
+            pool->tail = NULL;
+        }
+        pthread_mutex_unlock(&pool->lock);
+
+        int error = ready ? compress_block(&zs, b) : ENOMEM;
+
+        pthread_mutex_lock(&pool->lock);
+        b->error = error;
+        b->done = true;
+        pthread_cond_broadcast(&pool->finished);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    if (ready) {
+        deflateEnd(&zs);
+    }
+    return NULL;
+}
+
+unsigned arc_deflate_default_threads(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1) {
+        return 1;
+    }
+    return n > POOL_MAX_THREADS ? POOL_MAX_THREADS : (unsigned)n;
+}
+
+ArcDeflatePool *arc_deflate_pool_new(unsigned threads, int level) {
+    if (level < -1 || level > 9) {
+        errno = EINVAL;
+        return NULL;
+    }
+    ArcDeflatePool *pool = calloc(1, sizeof(ArcDeflatePool));
+    if (!pool) {
+        return NULL;
+    }
+    pool->level = level;
+    if (threads > POOL_MAX_THREADS) {
+        threads = POOL_MAX_THREADS;
+    }
+    if (threads == 0) {
+        if (init_stream(&pool->inline_zs, level) < 0) {
+            free(pool);
+            errno = ENOMEM;
+            return NULL;
+        }
+        pool->inline_ready = true;
+        return pool;
+    }
+
+    if (pthread_mutex_init(&pool->lock, NULL) != 0) {
+        free(pool);
+        return NULL;
+    }
+    pthread_cond_init(&pool->work, NULL);
+    pthread_cond_init(&pool->finished, NULL);
+    for (unsigned i = 0; i < threads; i++) {
+        if (pthread_create(&pool->threads[i], NULL, pool_worker, pool) != 0) {
+            break;
+        }
+        pool->thread_count++;
+    }
+    if (pool->thread_count == 0) {
+        arc_deflate_pool_free(pool);
+        errno = EAGAIN;
+        return NULL;
+    }
+    return pool;
+}
+
+void arc_deflate_pool_submit(ArcDeflatePool *pool, ArcDeflateBlock *block) {
+    block->done = false;
+    block->error = 0;
+    block->next = NULL;
+    if (pool->inline_ready) {
+        block->error = compress_block(&pool->inline_zs, block);
+        block->done = true;
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    if (pool->tail) {
+        pool->tail->next = block;
+    } else {
+        pool->head = block;
+    }
+    pool->tail = block;
+    pthread_cond_signal(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+int arc_deflate_pool_wait(ArcDeflatePool *pool, ArcDeflateBlock *block) {
+    if (!pool->inline_ready) {
+        pthread_mutex_lock(&pool->lock);
+        while (!block->done) {
+            pthread_cond_wait(&pool->finished, &pool->lock);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+    if (block->error) {
+        errno = block->error;
+        return -1;
+    }
+    return 0;
+}
+
+void arc_deflate_block_chain(const ArcDeflateBlock *prev, ArcDeflateBlock *next) {
+    if (prev->in_len >= ARC_DEFLATE_DICT_SIZE) {
+        memcpy(next->dict, prev->in + prev->in_len - ARC_DEFLATE_DICT_SIZE, ARC_DEFLATE_DICT_SIZE);
+        next->dict_len = ARC_DEFLATE_DICT_SIZE;
+        return;
+    }
+    // Short block: keep the end of its own dictionary in front of it
+    size_t keep = ARC_DEFLATE_DICT_SIZE - prev->in_len;
+    if (keep > prev->dict_len) {
+        keep = prev->dict_len;
+    }
+    memmove(next->dict, prev->dict + prev->dict_len - keep, keep);
+    memcpy(next->dict + keep, prev->in, prev->in_len);
+    next->dict_len = keep + prev->in_len;
+}
+
+void arc_deflate_block_release(ArcDeflateBlock *block) {
+    free(block->in);
+    free(block->out);
+    block->in = NULL;
+    block->out = NULL;
+    block->in_len = block->in_capacity = 0;
+    block->out_len = block->out_capacity = 0;
+}
+
+void arc_deflate_pool_free(ArcDeflatePool *pool) {
+    if (!pool) {
+        return;
+    }
+    if (pool->inline_ready) {
+        deflateEnd(&pool->inline_zs);
+        free(pool);
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+    for (unsigned i = 0; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pthread_cond_destroy(&pool->work);
+    pthread_cond_destroy(&pool->finished);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
@@ -0,0 +1,93 @@
+#ifndef ARC_DEFLATE_POOL_H
+#define ARC_DEFLATE_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * Parallel block compressor shared by the writers (internal).
+ *
+ * The caller cuts its input into blocks and submits them in order; worker
+ * threads turn each one into raw deflate data independently, and the
+ * caller collects them in the same order. A block that continues the
+ * previous one is primed with that block's last 32 KiB as a preset
+ * dictionary and ends in a sync flush, so the outputs of consecutive blocks
+ * concatenate into one valid deflate stream (the pigz technique). Each
+ * block also carries the CRC-32 of its input, for crc32_combine().
+ *
+ * With zero threads, blocks are compressed by arc_deflate_pool_submit()
+ * on the calling thread.
+ */
+
+#define ARC_DEFLATE_DICT_SIZE (32 * 1024)
+
+typedef struct ArcDeflatePool ArcDeflatePool;
+
+typedef struct ArcDeflateBlock {
+    // Input, set by the caller
+    uint8_t *in;
+    size_t in_len;
+    size_t in_capacity;
+    uint8_t dict[ARC_DEFLATE_DICT_SIZE];  // Tail of the previous block's input
+    size_t dict_len;                      // 0 for the first block of a stream
+    bool last;                            // Finish the deflate stream after this block
+    bool store;                           // Copy input to output without compressing
+
+    // Output, valid after arc_deflate_pool_wait()
+    uint8_t *out;
+    size_t out_len;
+    size_t out_capacity;
+    uint32_t crc;                         // CRC-32 of the input
+    int error;                            // errno, 0 on success
+
+    // Pool bookkeeping
+    bool done;
+    struct ArcDeflateBlock *next;
+} ArcDeflateBlock;
+
+/**
+ * Create a pool.
+ *
+ * @param threads Worker threads (0 = compress on the submitting thread)
+ * @param level zlib compression level (0-9, or -1 for the default)
+ * @return New pool, or NULL on error
+ */
+ArcDeflatePool *arc_deflate_pool_new(unsigned threads, int level);
+
+/**
+ * Queue a block for compression. The block must stay alive, untouched,
+ * until arc_deflate_pool_wait() returns for it.
+ */
+void arc_deflate_pool_submit(ArcDeflatePool *pool, ArcDeflateBlock *block);
+
+/**
+ * Wait for a submitted block.
+ *
+ * @return 0 on success, -1 if compressing it failed (errno set)
+ */
+int arc_deflate_pool_wait(ArcDeflatePool *pool, ArcDeflateBlock *block);
+
+/**
+ * Record the last ARC_DEFLATE_DICT_SIZE bytes of prev's input as next's
+ * dictionary.
+ */
+void arc_deflate_block_chain(const ArcDeflateBlock *prev, ArcDeflateBlock *next);
+
+/**
+ * Free a block's buffers (not the block itself).
+ */
+void arc_deflate_block_release(ArcDeflateBlock *block);
+
+/**
+ * Stop the workers and free the pool. Every submitted block must have
+ * been waited for.
+ */
+void arc_deflate_pool_free(ArcDeflatePool *pool);
+
+/**
+ * Online CPUs, for a thread count of 0 ("auto") in the public options.
+ */
+unsigned arc_deflate_default_threads(void);
+
+#endif // ARC_DEFLATE_POOL_H
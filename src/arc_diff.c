@@ -0,0 +1,270 @@
+#define _POSIX_C_SOURCE 200809L
+#include "arc_diff.h"
+#include "arc_base.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <zlib.h>
+
+#define DIFF_CRC_BUFFER_SIZE (64 * 1024)
+
+typedef struct DiffRecord {
+    ArcDiffEntry entry;
+    size_t seq;             // Listing order, to keep the last of duplicate paths
+} DiffRecord;
+
+typedef struct DiffListing {
+    DiffRecord *records;
+    size_t count;
+    size_t capacity;
+} DiffListing;
+
+static void listing_free(DiffListing *listing) {
+    for (size_t i = 0; i < listing->count; i++) {
+        free((char *)listing->records[i].entry.path);
+        free((char *)listing->records[i].entry.link_target);
+    }
+    free(listing->records);
+    memset(listing, 0, sizeof(*listing));
+}
+
+/**
+ * CRC-32 the current entry's data.
+ */
+static int checksum_data(ArcReader *reader, uint32_t *crc_out) {
+    ArcStream *data = arc_open_data(reader);
+    if (!data) {
+        return -1;
+    }
+    uint8_t *buf = malloc(DIFF_CRC_BUFFER_SIZE);
+    if (!buf) {
+        arc_stream_close(data);
+        return -1;
+    }
+    uLong crc = crc32(0L, Z_NULL, 0);
+    ssize_t n;
+    while ((n = arc_stream_read(data, buf, DIFF_CRC_BUFFER_SIZE)) > 0) {
+        crc = crc32(crc, buf, (uInt)n);
+    }
+    free(buf);
+    arc_stream_close(data);
+    if (n < 0) {
+        return -1;
+    }
+    *crc_out = (uint32_t)crc;
+    return 0;
+}
+
+/**
+ * Normalize a path in place so spellings of the same member compare equal:
+ * repeated slashes are collapsed, and leading "./" and trailing slashes
+ * are stripped. The root ("./", which the TAR reader already lists as "")
+ * comes out empty.
+ */
+static void normalize_path(char *path) {
+    size_t out = 0;
+    for (size_t in = 0; path[in]; in++) {
+        if (path[in] == '/' && out > 0 && path[out - 1] == '/') {
+            continue;
+        }
+        path[out++] = path[in];
+    }
+    path[out] = '\0';
+
+    size_t skip = 0;
+    while (path[skip] == '.' && path[skip + 1] == '/') {
+        skip += 2;
+    }
+    size_t len = out - skip;
+    memmove(path, path + skip, len + 1);
+    while (len > 1 && path[len - 1] == '/') {
+        path[--len] = '\0';
+    }
+}
+
+/**
+ * List the remaining entries of a reader. Paths and link targets are taken
+ * over from the ArcEntry, with paths normalized by normalize_path().
+ */
+static int list_archive(ArcReader *reader, int flags, DiffListing *listing) {
+    ArcEntry entry;
+    int rc;
+    while ((rc = arc_next(reader, &entry)) == 0) {
+        if (listing->count == listing->capacity) {
+            size_t capacity = listing->capacity ? listing->capacity * 2 : 256;
+            DiffRecord *records = realloc(listing->records, capacity * sizeof(DiffRecord));
+            if (!records) {
+                arc_entry_free(&entry);
+                return -1;
+            }
+            listing->records = records;
+            listing->capacity = capacity;
+        }
+
+        normalize_path(entry.path);
+        if (!entry.path[0]) {
+            char *root = strdup(".");
+            if (!root) {
+                arc_entry_free(&entry);
+                return -1;
+            }
+            free(entry.path);
+            entry.path = root;
+        }
+
+        DiffRecord *rec = &listing->records[listing->count];
+        memset(rec, 0, sizeof(*rec));
+        rec->seq = listing->count;
+        rec->entry.path = entry.path;
+        rec->entry.link_target = entry.link_target;
+        rec->entry.size = entry.size;
+        rec->entry.mtime = entry.mtime;
+        rec->entry.mode = entry.mode;
+        rec->entry.type = entry.type;
+        listing->count++;
+
+        ArcEntryLocation loc;
+        if (arc_reader_entry_location(reader, &loc) == 0 && loc.has_crc) {
+            rec->entry.crc32 = loc.crc32;
+            rec->entry.has_crc = true;
+        } else if (entry.type == ARC_ENTRY_FILE && entry.size == 0) {
+            rec->entry.crc32 = 0;
+            rec->entry.has_crc = true;
+        } else if (entry.type == ARC_ENTRY_FILE && (flags & ARC_DIFF_CHECKSUM_DATA)) {
+            if (checksum_data(reader, &rec->entry.crc32) < 0) {
+                return -1;
+            }
+            rec->entry.has_crc = true;
+        }
+    }
+    return rc < 0 ? -1 : 0;
+}
+
+static int compare_records(const void *x, const void *y) {
+    const DiffRecord *a = x;
+    const DiffRecord *b = y;
+    int c = strcmp(a->entry.path, b->entry.path);
+    if (c != 0) {
+        return c;
+    }
+    return a->seq < b->seq ? -1 : a->seq > b->seq;
+}
+
+/**
+ * Sort by path and drop all but the last entry of each path.
+ */
+static void sort_listing(DiffListing *listing) {
+    if (listing->count == 0) {
+        return;
+    }
+    qsort(listing->records, listing->count, sizeof(DiffRecord), compare_records);
+    size_t out = 0;
+    for (size_t i = 0; i < listing->count; i++) {
+        if (i + 1 < listing->count &&
+            strcmp(listing->records[i].entry.path, listing->records[i + 1].entry.path) == 0) {
+            free((char *)listing->records[i].entry.path);
+            free((char *)listing->records[i].entry.link_target);
+            continue;
+        }
+        listing->records[out++] = listing->records[i];
+    }
+    listing->count = out;
+}
+
+static bool same_string(const char *a, const char *b) {
+    if (!a || !b) {
+        return a == b;
+    }
+    return strcmp(a, b) == 0;
+}
+
+static unsigned compare_entries(const ArcDiffEntry *a, const ArcDiffEntry *b, int flags) {
+    unsigned changes = 0;
+    if (a->type != b->type) {
+        changes |= ARC_DIFF_TYPE;
+    }
+    if (a->size != b->size) {
+        changes |= ARC_DIFF_SIZE;
+    }
+    // ZIP entries written on non-Unix hosts carry no mode: nothing to compare
+    if (!(flags & ARC_DIFF_IGNORE_MODE) && a->mode != 0 && b->mode != 0 &&
+        (a->mode & 07777) != (b->mode & 07777)) {
+        changes |= ARC_DIFF_MODE;
+    }
+    if (!(flags & ARC_DIFF_IGNORE_MTIME) && a->mtime != b->mtime) {
+        changes |= ARC_DIFF_MTIME;
+    }
+    if (!same_string(a->link_target, b->link_target)) {
+        changes |= ARC_DIFF_LINK;
+    }
+    if (a->type == ARC_ENTRY_FILE && b->type == ARC_ENTRY_FILE && a->size == b->size &&
+        a->has_crc && b->has_crc && a->crc32 != b->crc32) {
+        changes |= ARC_DIFF_CONTENT;
+    }
+    return changes;
+}
+
+int64_t arc_diff(ArcReader *a, ArcReader *b, const ArcDiffOptions *opts, ArcDiffCallback callback, void *user) {
+    if (!a || !b || !callback) {
+        errno = EINVAL;
+        return -1;
+    }
+    int flags = opts ? opts->flags : 0;
+
+    DiffListing la, lb;
+    memset(&la, 0, sizeof(la));
+    memset(&lb, 0, sizeof(lb));
+    if (list_archive(a, flags, &la) < 0 || list_archive(b, flags, &lb) < 0) {
+        int saved = errno;
+        listing_free(&la);
+        listing_free(&lb);
+        errno = saved;
+        return -1;
+    }
+    sort_listing(&la);
+    sort_listing(&lb);
+
+    // Merge-join the two sorted listings
+    int64_t reported = 0;
+    size_t i = 0, j = 0;
+    while (i < la.count || j < lb.count) {
+        ArcDiffItem item;
+        memset(&item, 0, sizeof(item));
+        int c;
+        if (i == la.count) {
+            c = 1;
+        } else if (j == lb.count) {
+            c = -1;
+        } else {
+            c = strcmp(la.records[i].entry.path, lb.records[j].entry.path);
+        }
+
+        if (c < 0) {
+            item.kind = ARC_DIFF_REMOVED;
+            item.a = &la.records[i++].entry;
+            item.path = item.a->path;
+        } else if (c > 0) {
+            item.kind = ARC_DIFF_ADDED;
+            item.b = &lb.records[j++].entry;
+            item.path = item.b->path;
+        } else {
+            item.a = &la.records[i++].entry;
+            item.b = &lb.records[j++].entry;
+            item.changes = compare_entries(item.a, item.b, flags);
+            if (item.changes == 0) {
+                continue;
+            }
+            item.kind = ARC_DIFF_MODIFIED;
+            item.path = item.a->path;
+        }
+
+        reported++;
+        if (callback(&item, user) != 0) {
+            break;
+        }
+    }
+
+    listing_free(&la);
+    listing_free(&lb);
+    return reported;
+}
@@ -0,0 +1,94 @@
+#ifndef ARC_DIFF_H
+#define ARC_DIFF_H
+
+#include "arc_reader.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * Metadata-only archive comparison.
+ *
+ * Both archives are listed once (no entry data is decompressed), each
+ * listing is sorted by path, and the two sorted arrays are merge-joined.
+ * Entries present on both sides are compared on type, size, mode, mtime,
+ * link target and CRC-32: the stored CRC from the ZIP central directory
+ * (or a listing cache), or, for formats that store none (TAR, 7z), a CRC
+ * computed while listing when ARC_DIFF_CHECKSUM_DATA is set. Reading a
+ * compressed TAR to list it decodes the data anyway, so checksumming it
+ * costs no extra decompression.
+ *
+ * Without a CRC on both sides, equal size and mtime count as unchanged
+ * (the same quick check rsync makes).
+ */
+
+// ArcDiffItem.kind
+#define ARC_DIFF_ADDED    0  // Only in b
+#define ARC_DIFF_REMOVED  1  // Only in a
+#define ARC_DIFF_MODIFIED 2  // In both, with ArcDiffItem.changes set
+
+// ArcDiffItem.changes
+#define ARC_DIFF_TYPE    0x01
+#define ARC_DIFF_SIZE    0x02
+#define ARC_DIFF_MODE    0x04
+#define ARC_DIFF_MTIME   0x08
+#define ARC_DIFF_LINK    0x10  // Symlink / hardlink target
+#define ARC_DIFF_CONTENT 0x20  // CRC-32 differs
+
+// ArcDiffOptions.flags
+#define ARC_DIFF_CHECKSUM_DATA 0x1  // CRC the data of entries without a stored CRC while listing
+#define ARC_DIFF_IGNORE_MTIME  0x2  // Don't compare mtimes
+#define ARC_DIFF_IGNORE_MODE   0x4  // Don't compare permission bits
+
+typedef struct ArcDiffOptions {
+    int flags;  // ARC_DIFF_CHECKSUM_DATA, ARC_DIFF_IGNORE_*
+} ArcDiffOptions;
+
+/**
+ * One side of a difference, valid for the duration of the callback.
+ */
+typedef struct ArcDiffEntry {
+    const char *path;
+    const char *link_target;  // NULL unless a link
+    uint64_t size;
+    uint64_t mtime;
+    uint32_t mode;
+    uint32_t crc32;           // Valid if has_crc
+    bool has_crc;
+    uint8_t type;             // ARC_ENTRY_*
+} ArcDiffEntry;
+
+typedef struct ArcDiffItem {
+    int kind;                 // ARC_DIFF_ADDED / REMOVED / MODIFIED
+    unsigned changes;         // ARC_DIFF_TYPE... bits (MODIFIED only)
+    const char *path;
+    const ArcDiffEntry *a;    // NULL for ADDED
+    const ArcDiffEntry *b;    // NULL for REMOVED
+} ArcDiffItem;
+
+/**
+ * Difference callback.
+ *
+ * @return 0 to continue, non-zero to stop
+ */
+typedef int (*ArcDiffCallback)(const ArcDiffItem *item, void *user);
+
+/**
+ * Compare two archives and report differences in path order.
+ *
+ * Both readers are iterated from their current position to the end, so
+ * pass freshly opened readers. If an archive lists the same path twice,
+ * the last entry wins (as it would on extraction). Paths are matched
+ * without leading "./", repeated slashes or trailing slashes.
+ *
+ * @param a Old archive
+ * @param b New archive
+ * @param opts Options (NULL = defaults)
+ * @param callback Called for each difference
+ * @param user Passed to the callback
+ * @return Number of differences reported (fewer if the callback stopped
+ *         early), or -1 on error
+ */
+int64_t arc_diff(ArcReader *a, ArcReader *b, const ArcDiffOptions *opts, ArcDiffCallback callback, void *user);
+
+#endif // ARC_DIFF_H
@@ -0,0 +1,522 @@
+#define _POSIX_C_SOURCE 200809L
+#include "arc_entry.h"
+#include "arc_reader.h"
+#include "arc_base.h"
+#include "arc_stream.h"
+#include "arc_filter.h"
+#include "arc_index.h"
+#include "arc_bgzf.h"
+#include "arc_zip.h"
+#include "arc_compressed.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+// How a handle maps entry offsets to archive bytes
+#define HANDLE_STORED  0  // Direct: in_base + offset in the file
+#define HANDLE_INFLATE 1  // Deflate/gzip, resumed from checkpoints
+#define HANDLE_DECODE  2  // bzip2/xz: decoded from the start of the archive
+#define HANDLE_BGZF    3  // BGZF .tar.gz: decoded from the block holding the offset
+
+// Checkpoint spacing: dense enough for range requests, but at most
+// ~MAX_CHECKPOINTS windows (32 KB each) per entry
+#define MIN_SPAN (1024 * 1024)
+#define MAX_CHECKPOINTS 256
+
+#define IO_CHUNK (64 * 1024)
+
+struct ArcEntryHandle {
+    int fd;                  // Private descriptor (only used with pread)
+    int mode;                // HANDLE_*
+    int container;           // ARC_INFLATE_* (HANDLE_INFLATE)
+    int compression;         // ARC_COMPRESSED_* (HANDLE_DECODE)
+    int64_t in_base;         // Stored: data offset; otherwise start of the compressed data
+    int64_t in_end;          // End of the compressed data
+    int64_t out_base;        // Entry offset in the decompressed stream (TAR inside .tar.gz)
+    uint64_t size;
+    ArcInflateIndex *index;  // Immutable once the handle is open
+    ArcBgzfIndex *bgzf;      // Block index (HANDLE_BGZF), immutable too
+};
+
+// Whole-archive compression of a file, from its magic bytes
+static int sniff_compression(int fd) {
+    uint8_t magic[6];
+    ssize_t n = pread(fd, magic, sizeof(magic), 0);
+    if (n >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+        return ARC_COMPRESSED_GZIP;
+    }
+    if (n >= 3 && magic[0] == 'B' && magic[1] == 'Z' && magic[2] == 'h') {
+        return ARC_COMPRESSED_BZIP2;
+    }
+    if (n >= 6 && memcmp(magic, "\xFD" "7zXZ" "\x00", 6) == 0) {
+        return ARC_COMPRESSED_XZ;
+    }
+    if (n >= 4 && memcmp(magic, "\x04\x22\x4D\x18", 4) == 0) {
+        return ARC_COMPRESSED_LZ4;
+    }
+    return -1;
+}
+
+// Input for build_index: positional reads of the compressed range
+typedef struct {
+    ArcEntryHandle *h;
+    z_stream *zs;
+    uint8_t *in;
+    int64_t in_pos;
+} IndexInput;
+
+static ssize_t index_refill(void *user) {
+    IndexInput *input = user;
+    z_stream *zs = input->zs;
+    size_t have = zs->avail_in;
+    if (have > 0) {
+        memmove(input->in, zs->next_in, have);
+    }
+    int64_t left = input->h->in_end - input->in_pos;
+    size_t room = IO_CHUNK - have;
+    ssize_t n = left > 0 ? pread(input->h->fd, input->in + have, left < (int64_t)room ? (size_t)left : room,
+                                 input->in_pos)
+                         : 0;
+    if (n < 0) {
+        return -1;
+    }
+    input->in_pos += n;
+    zs->next_in = input->in;
+    zs->avail_in = (uInt)(have + (size_t)n);
+    return n;
+}
+
+// First pass: decode up to the end of the entry once, keeping the
+// checkpoints that can serve reads inside it
+static int build_index(ArcEntryHandle *h) {
+    int64_t span = (int64_t)(h->size / MAX_CHECKPOINTS);
+    if (span < MIN_SPAN) {
+        span = MIN_SPAN;
+    }
+    h->index = arc_inflate_index_new(h->container, span);
+    uint8_t *in = malloc(IO_CHUNK);
+    uint8_t *out = malloc(IO_CHUNK);
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    int wbits = h->container == ARC_INFLATE_GZIP ? 16 + MAX_WBITS : -MAX_WBITS;
+    if (!h->index || !in || !out || inflateInit2(&zs, wbits) != Z_OK) {
+        free(in);
+        free(out);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    int64_t out_end = h->out_base + (int64_t)h->size;
+    IndexInput input = { .h = h, .zs = &zs, .in = in, .in_pos = h->in_base };
+    int ret = Z_OK;
+    int result = 0;
+    while ((int64_t)zs.total_out < out_end) {
+        if (zs.avail_in == 0 && index_refill(&input) <= 0) {
+            result = -1;
+            break;
+        }
+        zs.next_out = out;
+        zs.avail_out = IO_CHUNK;
+        ret = inflate(&zs, Z_BLOCK);
+        if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+            result = -1;
+            break;
+        }
+        if (arc_inflate_index_note(h->index, &zs, h->in_base) < 0) {
+            result = -1;
+            break;
+        }
+        // Checkpoints before the entry are only useful as its starting point
+        if ((int64_t)zs.total_out <= h->out_base && h->index->count > 1) {
+            arc_inflate_index_trim(h->index, h->out_base);
+        }
+        if (ret == Z_STREAM_END) {
+            int more = h->container == ARC_INFLATE_GZIP ? arc_inflate_next_member(&zs, false, index_refill, &input)
+                                                        : 0;
+            if (more <= 0) {
+                result = more;
+                break;
+            }
+        }
+    }
+    if (result == 0 && (int64_t)zs.total_out < out_end) {
+        result = -1; // Archive ends inside the entry
+    }
+    inflateEnd(&zs);
+    free(in);
+    free(out);
+    if (result < 0) {
+        errno = EIO;
+        return -1;
+    }
+    arc_inflate_index_trim(h->index, h->out_base);
+    return 0;
+}
+
+ArcEntryHandle *arc_entry_open_current(ArcReader *reader) {
+    if (!reader) {
+        errno = EINVAL;
+        return NULL;
+    }
+    ArcEntryLocation loc;
+    if (arc_reader_entry_location(reader, &loc) < 0) {
+        return NULL;
+    }
+    return arc_entry_open_location(reader, &loc);
+}
+
+ArcEntryHandle *arc_entry_open_location(ArcReader *reader, const ArcEntryLocation *location) {
+    if (!reader || !location) {
+        errno = EINVAL;
+        return NULL;
+    }
+    ArcEntryLocation loc = *location;
+
+    // Archive file descriptor: the reader's own stream, or the file under its filter
+    ArcReaderBase *base = (ArcReaderBase *)reader;
+    bool filtered = false;
+    int fd = arc_stream_fd(base->stream);
+    if (fd < 0) {
+        fd = arc_stream_fd(base->owned_stream);
+        filtered = fd >= 0;
+    }
+    if (fd < 0) {
+        errno = ENOTSUP; // Not file-backed
+        return NULL;
+    }
+
+    ArcEntryHandle *h = calloc(1, sizeof(ArcEntryHandle));
+    if (!h) {
+        return NULL;
+    }
+    h->fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    struct stat st;
+    if (h->fd < 0 || fstat(h->fd, &st) < 0) {
+        arc_entry_close(h);
+        return NULL;
+    }
+    h->size = loc.size;
+    h->in_end = st.st_size;
+
+    if (loc.format == ARC_FORMAT_ZIP) {
+        if (loc.flags & ZIP_FLAG_ENCRYPTED) {
+            arc_entry_close(h);
+            errno = ENOTSUP;
+            return NULL;
+        }
+        ArcStream *file = arc_stream_pread(h->fd, 0, st.st_size);
+        int64_t data_offset = file ? arc_zip_data_offset(file, &loc) : -1;
+        arc_stream_close(file);
+        if (data_offset < 0) {
+            arc_entry_close(h);
+            return NULL;
+        }
+        h->in_base = data_offset;
+        if (loc.method == ZIP_METHOD_STORE) {
+            h->mode = HANDLE_STORED;
+        } else if (loc.method == ZIP_METHOD_DEFLATE) {
+            h->mode = HANDLE_INFLATE;
+            h->container = ARC_INFLATE_RAW;
+            h->in_end = data_offset + (int64_t)loc.stored_size;
+        } else {
+            arc_entry_close(h);
+            errno = ENOTSUP;
+            return NULL;
+        }
+    } else if (loc.format == ARC_FORMAT_TAR) {
+        int compression = loc.compression;
+        if (compression < 0 && filtered) {
+            compression = sniff_compression(h->fd);
+        }
+        if (compression < 0) {
+            h->mode = HANDLE_STORED;
+            h->in_base = loc.offset;
+        } else {
+            h->mode = compression == ARC_COMPRESSED_GZIP ? HANDLE_INFLATE : HANDLE_DECODE;
+            h->container = ARC_INFLATE_GZIP;
+            h->compression = compression;
+            h->in_base = 0;
+            h->out_base = loc.offset;
+            // BGZF is a run of gzip members: index the blocks (headers only)
+            // instead of inflating up to the entry
+            uint8_t header[18];
+            if (compression == ARC_COMPRESSED_GZIP &&
+                pread(h->fd, header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+                arc_bgzf_detect(header, sizeof(header), NULL)) {
+                ArcStream *file = arc_stream_pread(h->fd, 0, st.st_size);
+                h->bgzf = file ? arc_bgzf_index_build(file) : NULL;
+                arc_stream_close(file);
+                if (!h->bgzf) {
+                    int saved = errno;
+                    arc_entry_close(h);
+                    errno = saved;
+                    return NULL;
+                }
+                h->mode = HANDLE_BGZF;
+            }
+        }
+    } else {
+        arc_entry_close(h);
+        errno = ENOTSUP;
+        return NULL;
+    }
+
+    if (h->mode == HANDLE_INFLATE && build_index(h) < 0) {
+        int saved = errno;
+        arc_entry_close(h);
+        errno = saved;
+        return NULL;
+    }
+    return h;
+}
+
+// Iterate from the start (when possible) to the entry matching path or index
+static ArcEntryHandle *open_matching(ArcReader *reader, const char *path, size_t index) {
+    if (!reader) {
+        errno = EINVAL;
+        return NULL;
+    }
+    // Best effort: readers that can't rewind search from where they are
+    arc_rewind(reader);
+
+    ArcEntry entry;
+    size_t i = 0;
+    int ret;
+    while ((ret = arc_next(reader, &entry)) == 0) {
+        bool match = path ? strcmp(entry.path, path) == 0 : i == index;
+        uint8_t type = entry.type;
+        arc_entry_free(&entry);
+        if (match) {
+            if (type != ARC_ENTRY_FILE) {
+                errno = type == ARC_ENTRY_DIR ? EISDIR : EINVAL;
+                return NULL;
+            }
+            return arc_entry_open_current(reader);
+        }
+        i++;
+    }
+    if (ret == 1) {
+        errno = ENOENT;
+    }
+    return NULL;
+}
+
+ArcEntryHandle *arc_entry_open(ArcReader *reader, const char *path) {
+    if (!path) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return open_matching(reader, path, 0);
+}
+
+ArcEntryHandle *arc_entry_open_index(ArcReader *reader, size_t index) {
+    return open_matching(reader, NULL, index);
+}
+
+// Read exactly n bytes from a stream unless it ends first
+static ssize_t read_full(ArcStream *stream, uint8_t *buf, size_t n) {
+    size_t done = 0;
+    while (done < n) {
+        ssize_t got = arc_stream_read(stream, buf + done, n - done);
+        if (got < 0) {
+            return -1;
+        }
+        if (got == 0) {
+            break;
+        }
+        done += (size_t)got;
+    }
+    return (ssize_t)done;
+}
+
+// Stream returned by arc_entry_open_range() for decoded data
+static ssize_t range_read(ArcStream *stream, void *buf, size_t n);
+static int range_seek(ArcStream *stream, int64_t off, int whence);
+static int64_t range_tell(ArcStream *stream);
+static void range_close(ArcStream *stream);
+
+static const struct ArcStreamVtable range_vtable = {
+    .read = range_read,
+    .seek = range_seek,
+    .tell = range_tell,
+    .close = range_close,
+};
+
+typedef struct RangeData {
+    ArcStream *compressed;  // Positional view of the archive file
+    ArcStream *data;        // Decoder positioned at the start of the range
+} RangeData;
+
+static ssize_t range_read(ArcStream *stream, void *buf, size_t n) {
+    RangeData *range = (RangeData *)stream->user_data;
+    int64_t remaining = stream->byte_limit - stream->bytes_read;
+    if (remaining <= 0) {
+        return 0;
+    }
+    if ((int64_t)n > remaining) {
+        n = (size_t)remaining;
+    }
+    ssize_t got = arc_stream_read(range->data, buf, n);
+    if (got > 0) {
+        stream->bytes_read += got;
+    }
+    return got;
+}
+
+static int range_seek(ArcStream *stream, int64_t off, int whence) {
+    (void)stream;
+    (void)off;
+    (void)whence;
+    errno = ESPIPE;
+    return -1;
+}
+
+static int64_t range_tell(ArcStream *stream) {
+    return stream->bytes_read;
+}
+
+static void range_close(ArcStream *stream) {
+    RangeData *range = (RangeData *)stream->user_data;
+    arc_stream_close(range->data);
+    arc_stream_close(range->compressed);
+    free(range);
+    free(stream);
+}
+
+// Decoder over the archive, positioned at `start` in the decompressed data
+static ArcStream *open_decoder(ArcEntryHandle *handle, ArcStream *compressed, int64_t start, int64_t length) {
+    if (handle->mode == HANDLE_INFLATE) {
+        return arc_inflate_index_open(handle->index, handle->container, compressed, handle->in_base,
+                                      start, length);
+    }
+    if (handle->mode == HANDLE_BGZF) {
+        ArcBgzfOptions opts = { .threads = 1, .index = handle->bgzf };
+        ArcStream *data = arc_filter_bgzf(compressed, 0, &opts);
+        if (data && arc_stream_seek(data, start, SEEK_SET) < 0) {
+            arc_stream_close(data);
+            return NULL;
+        }
+        return data;
+    }
+    ArcStream *data = handle->compression == ARC_COMPRESSED_BZIP2 ? arc_filter_bzip2(compressed, 0)
+                      : handle->compression == ARC_COMPRESSED_LZ4 ? arc_filter_lz4(compressed, 0, NULL)
+                                                                   : arc_filter_xz(compressed, 0);
+    if (!data) {
+        return NULL;
+    }
+    uint8_t discard[8192];
+    int64_t skip = start;
+    while (skip > 0) {
+        ssize_t got = arc_stream_read(data, discard, skip < (int64_t)sizeof(discard) ? (size_t)skip : sizeof(discard));
+        if (got <= 0) {
+            if (got == 0) {
+                errno = EIO; // Archive ends before the entry
+            }
+            arc_stream_close(data);
+            return NULL;
+        }
+        skip -= got;
+    }
+    return data;
+}
+
+ArcStream *arc_entry_open_range(ArcEntryHandle *handle, uint64_t offset, uint64_t length) {
+    if (!handle) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (offset > handle->size) {
+        offset = handle->size;
+    }
+    if (length > handle->size - offset) {
+        length = handle->size - offset;
+    }
+    if (handle->mode == HANDLE_STORED) {
+        return arc_stream_pread(handle->fd, handle->in_base + (int64_t)offset, (int64_t)length);
+    }
+
+    ArcStream *stream = calloc(1, sizeof(ArcStream));
+    RangeData *range = calloc(1, sizeof(RangeData));
+    // Per-range streams keep concurrent readers independent
+    ArcStream *compressed = stream && range ? arc_stream_pread(handle->fd, 0, handle->in_end) : NULL;
+    ArcStream *data = compressed ? open_decoder(handle, compressed, handle->out_base + (int64_t)offset,
+                                                (int64_t)length)
+                                 : NULL;
+    if (!data) {
+        int saved = errno;
+        arc_stream_close(compressed);
+        free(range);
+        free(stream);
+        errno = saved;
+        return NULL;
+    }
+    range->compressed = compressed;
+    range->data = data;
+    stream->vtable = &range_vtable;
+    stream->byte_limit = (int64_t)length;
+    stream->bytes_read = 0;
+    stream->user_data = range;
+    return stream;
+}
+
+ssize_t arc_entry_pread(ArcEntryHandle *handle, void *buf, size_t n, uint64_t offset) {
+    if (!handle || (!buf && n > 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (offset >= handle->size || n == 0) {
+        return 0;
+    }
+    if (n > handle->size - offset) {
+        n = (size_t)(handle->size - offset);
+    }
+    uint8_t *out = buf;
+
+    if (handle->mode == HANDLE_STORED) {
+        size_t done = 0;
+        while (done < n) {
+            ssize_t got = pread(handle->fd, out + done, n - done,
+                                (off_t)(handle->in_base + (int64_t)(offset + done)));
+            if (got < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return -1;
+            }
+            if (got == 0) {
+                break; // File truncated since the handle was opened
+            }
+            done += (size_t)got;
+        }
+        return (ssize_t)done;
+    }
+
+    ArcStream *range = arc_entry_open_range(handle, offset, n);
+    if (!range) {
+        return -1;
+    }
+    ssize_t result = read_full(range, out, n);
+    arc_stream_close(range);
+    return result;
+}
+
+uint64_t arc_entry_handle_size(const ArcEntryHandle *handle) {
+    return handle ? handle->size : 0;
+}
+
+void arc_entry_close(ArcEntryHandle *handle) {
+    if (!handle) {
+        return;
+    }
+    if (handle->fd >= 0) {
+        close(handle->fd);
+    }
+    arc_inflate_index_free(handle->index);
+    arc_bgzf_index_free(handle->bgzf);
+    free(handle);
+}
@@ -0,0 +1,102 @@
+#ifndef ARC_ENTRY_H
+#define ARC_ENTRY_H
+
+#include "arc_reader.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/**
+ * Positional (random access) reads of a single archive entry.
+ *
+ * arc_open_data() gives a forward-only stream, so serving a byte range from
+ * the middle of a compressed entry means decoding it from byte zero every
+ * time. An entry handle instead supports pread()-style access:
+ *
+ * - Stored data (plain TAR, ZIP method 0) is a direct offset translation.
+ * - Deflate (ZIP method 8) and .tar.gz are decoded once when the handle is
+ *   opened, recording inflate checkpoints (see arc_index.h); each read then
+ *   resumes from the nearest checkpoint before the requested offset.
+ * - BGZF .tar.gz is indexed by walking its block headers; each read
+ *   decodes from the block holding the requested offset.
+ * - .tar.bz2 / .tar.xz have no restart points and decode from the start of
+ *   the archive on every read.
+ *
+ * A handle has its own file descriptor and is independent of the reader it
+ * was opened from. It is immutable after opening, so arc_entry_pread() may
+ * be called concurrently from several threads, on the same or different
+ * handles.
+ */
+
+typedef struct ArcEntryHandle ArcEntryHandle;
+
+struct ArcEntryLocation;
+
+/**
+ * Open a handle on the entry with the given path.
+ *
+ * The reader is rewound and iterated until the entry is found, leaving its
+ * cursor on that entry. Readers that can't rewind (.tar.gz, .tar.bz2,
+ * .tar.xz) search from their current position, so open them fresh.
+ *
+ * @param reader Reader opened with arc_open_path() (the archive must be a file)
+ * @param path Entry path as returned by arc_next()
+ * @return New handle, or NULL on error (ENOENT if not found, EISDIR for
+ *         directories, EINVAL for links, ENOTSUP for 7z / single
+ *         compressed files / encrypted ZIP entries)
+ */
+ArcEntryHandle *arc_entry_open(ArcReader *reader, const char *path);
+
+/**
+ * Open a handle on the entry at a position in listing order (0-based).
+ * Same rewind rules as arc_entry_open().
+ */
+ArcEntryHandle *arc_entry_open_index(ArcReader *reader, size_t index);
+
+/**
+ * Open a handle on the reader's current entry (after a successful arc_next()).
+ */
+ArcEntryHandle *arc_entry_open_current(ArcReader *reader);
+
+/**
+ * Open a handle from a location recorded during a listing pass (internal,
+ * see arc_base.h), without iterating to the entry again. A TAR location may
+ * span the whole decompressed archive, so that one handle (and one
+ * checkpoint index) serves every entry; see arc_shuffle.c.
+ */
+ArcEntryHandle *arc_entry_open_location(ArcReader *reader, const struct ArcEntryLocation *loc);
+
+/**
+ * Read up to n bytes of the entry's data starting at offset.
+ *
+ * @param handle The entry handle
+ * @param buf Output buffer
+ * @param n Bytes to read
+ * @param offset Offset in the uncompressed entry data
+ * @return Bytes read (short only at the end of the entry), 0 at or past the
+ *         end, -1 on error
+ */
+ssize_t arc_entry_pread(ArcEntryHandle *handle, void *buf, size_t n, uint64_t offset);
+
+/**
+ * Open a forward-only stream over `length` bytes of the entry's data from
+ * `offset` (both clamped to the entry). Decoding resumes at the nearest
+ * restart point, as with arc_entry_pread(), then continues sequentially,
+ * so a long range costs one restart instead of one per read. Each stream
+ * has its own state, like arc_entry_pread() calls.
+ *
+ * @return New stream (close with arc_stream_close()), or NULL on error
+ */
+ArcStream *arc_entry_open_range(ArcEntryHandle *handle, uint64_t offset, uint64_t length);
+
+/**
+ * Uncompressed size of the entry.
+ */
+uint64_t arc_entry_handle_size(const ArcEntryHandle *handle);
+
+/**
+ * Close a handle.
+ */
+void arc_entry_close(ArcEntryHandle *handle);
+
+#endif // ARC_ENTRY_H
@@ -1,12 +1,17 @@
-#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE  // realpath(), fallocate()
 #include "arc_reader.h"
 #include "arc_stream.h"
 #include "arc_base.h"
+#include "arc_hash.h"
+#include "arc_match.h"
+#include "arc_zip.h"
+#include "arc_sink.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <fcntl.h>
 #include <errno.h>
@@ -15,12 +20,21 @@
 #include <time.h>  // For futimens
 #include <limits.h>
 #include <libgen.h>
+#include <pthread.h>
+#ifdef __linux__
+#include <sys/xattr.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
 
 #ifndef PATH_MAX
 #define PATH_MAX 4096
 #endif
 
 #define EXTRACT_BUFFER_SIZE (64 * 1024) // 64KB buffer
+#define EXTRACT_MMAP_THRESHOLD (1024 * 1024)     // Decode larger files straight into a mapping
+#define EXTRACT_MMAP_WINDOW (64 * 1024 * 1024)   // Bytes mapped at a time
+#define DIGEST_XATTR_PREFIX "user.cupidarchive."
 
 /**
  * Validate archive entry path for security (prevent Zip-Slip attacks).
@@ -226,23 +240,506 @@ static int mkdir_p_at(int dirfd, const char *path, mode_t mode) {
     return 0;
 }
 
+/**
+ * Store each digest as a user.cupidarchive.<algo> xattr (lower-case hex).
+ *
+ * @param fd Open file descriptor
+ * @param digests Digests to store
+ * @return 0 on success, -1 on error (ENOTSUP where xattrs are unavailable)
+ */
+static int set_digest_xattrs(int fd, const ArcDigests *digests) {
+#ifdef __linux__
+    static const unsigned algorithms[] = { ARC_HASH_SHA256, ARC_HASH_BLAKE3, ARC_HASH_XXH3 };
+    for (size_t i = 0; i < sizeof(algorithms) / sizeof(algorithms[0]); i++) {
+        char hex[2 * ARC_SHA256_SIZE + 1];
+        size_t len = arc_digest_hex(digests, algorithms[i], hex, sizeof(hex));
+        if (len == 0) {
+            continue;
+        }
+        char name[64];
+        snprintf(name, sizeof(name), DIGEST_XATTR_PREFIX "%s", arc_hash_name(algorithms[i]));
+        if (fsetxattr(fd, name, hex, len, 0) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+#else
+    (void)fd;
+    (void)digests;
+    errno = ENOTSUP;
+    return -1;
+#endif
+}
+
+// Deduplication
+
+#define DEDUP_SPOOL_MAX (8 * 1024 * 1024)   // Larger files are written without dedup
+
+typedef struct DedupRecord {
+    uint8_t digest[ARC_BLAKE3_SIZE];
+    uint64_t size;
+    char *path;             // Absolute
+} DedupRecord;
+
+/**
+ * Digest -> path map of one extraction, optionally loaded from and saved to
+ * a persistent index.
+ */
+typedef struct ExtractDedup {
+    unsigned mode;          // ARC_DEDUP_*
+    char *root;             // Destination directory, resolved
+    DedupRecord *records;
+    size_t count;
+    size_t capacity;
+    size_t *slots;          // Open-addressing table of record index + 1 (0 = empty)
+    size_t slot_count;      // Power of two
+    bool dirty;             // Records changed since loading
+    uint8_t *spool;         // File data held back until its digest is known
+    size_t spool_capacity;
+    size_t files;
+    uint64_t bytes;
+} ExtractDedup;
+
+static size_t *dedup_slot(const ExtractDedup *d, const uint8_t *digest, uint64_t size) {
+    uint64_t h;
+    memcpy(&h, digest, sizeof(h));     // Already uniformly distributed
+    size_t pos = (size_t)(h ^ size) & (d->slot_count - 1);
+    while (d->slots[pos]) {
+        const DedupRecord *r = &d->records[d->slots[pos] - 1];
+        if (r->size == size && memcmp(r->digest, digest, sizeof(r->digest)) == 0) {
+            break;
+        }
+        pos = (pos + 1) & (d->slot_count - 1);
+    }
+    return &d->slots[pos];
+}
+
+static DedupRecord *dedup_find(ExtractDedup *d, const uint8_t *digest, uint64_t size) {
+    if (d->count == 0) {
+        return NULL;
+    }
+    size_t *slot = dedup_slot(d, digest, size);
+    return *slot ? &d->records[*slot - 1] : NULL;
+}
+
+/**
+ * Record where contents live, replacing an older path for the same digest.
+ */
+static int dedup_insert(ExtractDedup *d, const uint8_t *digest, uint64_t size, const char *path) {
+    if (strchr(path, '\n')) {
+        return 0;   // Can't be written to the index
+    }
+    if ((d->count + 1) * 2 > d->slot_count) {
+        size_t slot_count = d->slot_count ? d->slot_count * 2 : 256;
+        size_t *slots = calloc(slot_count, sizeof(*slots));
+        if (!slots) {
+            return -1;
+        }
+        free(d->slots);
+        d->slots = slots;
+        d->slot_count = slot_count;
+        for (size_t i = 0; i < d->count; i++) {
+            *dedup_slot(d, d->records[i].digest, d->records[i].size) = i + 1;
+        }
+    }
+    char *copy = strdup(path);
+    if (!copy) {
+        return -1;
+    }
+    size_t *slot = dedup_slot(d, digest, size);
+    if (*slot) {
+        free(d->records[*slot - 1].path);
+        d->records[*slot - 1].path = copy;
+        d->dirty = true;
+        return 0;
+    }
+    if (d->count == d->capacity) {
+        size_t capacity = d->capacity ? d->capacity * 2 : 64;
+        DedupRecord *records = realloc(d->records, capacity * sizeof(*records));
+        if (!records) {
+            free(copy);
+            return -1;
+        }
+        d->records = records;
+        d->capacity = capacity;
+    }
+    DedupRecord *r = &d->records[d->count];
+    memcpy(r->digest, digest, sizeof(r->digest));
+    r->size = size;
+    r->path = copy;
+    *slot = ++d->count;
+    d->dirty = true;
+    return 0;
+}
+
+static int hex_value(int c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+/**
+ * Load a persistent index; a missing file is an empty index and malformed
+ * lines are ignored.
+ */
+static int dedup_load(ExtractDedup *d, const char *index_path) {
+    FILE *f = fopen(index_path, "r");
+    if (!f) {
+        return errno == ENOENT ? 0 : -1;
+    }
+    char *line = NULL;
+    size_t line_size = 0;
+    ssize_t len;
+    int result = 0;
+    while ((len = getline(&line, &line_size, f)) > 0) {
+        if (line[len - 1] == '\n') {
+            line[--len] = '\0';
+        }
+        uint8_t digest[ARC_BLAKE3_SIZE];
+        size_t i = 0;
+        for (; i < sizeof(digest); i++) {
+            int hi = hex_value(line[2 * i]);
+            int lo = hi < 0 ? -1 : hex_value(line[2 * i + 1]);
+            if (lo < 0) {
+                break;
+            }
+            digest[i] = (uint8_t)(hi << 4 | lo);
+        }
+        char *end = NULL;
+        const char *p = line + 2 * sizeof(digest);
+        if (i < sizeof(digest) || *p != ' ' || p[1] < '0' || p[1] > '9') {
+            continue;
+        }
+        unsigned long long size = strtoull(p + 1, &end, 10);
+        if (*end != ' ' || end[1] != '/') {
+            continue;
+        }
+        if (dedup_insert(d, digest, size, end + 1) < 0) {
+            result = -1;
+            break;
+        }
+    }
+    free(line);
+    fclose(f);
+    d->dirty = false;
+    return result;
+}
+
+/**
+ * Write the index back atomically (temporary file + rename).
+ */
+static int dedup_save(const ExtractDedup *d, const char *index_path) {
+    size_t tmp_size = strlen(index_path) + sizeof(".tmp-XXXXXX");
+    char *tmp = malloc(tmp_size);
+    if (!tmp) {
+        return -1;
+    }
+    snprintf(tmp, tmp_size, "%s.tmp-XXXXXX", index_path);
+    int fd = mkstemp(tmp);
+    FILE *f = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (!f) {
+        int saved = errno;
+        if (fd >= 0) {
+            close(fd);
+            unlink(tmp);
+        }
+        free(tmp);
+        errno = saved;
+        return -1;
+    }
+    for (size_t i = 0; i < d->count; i++) {
+        const DedupRecord *r = &d->records[i];
+        for (size_t j = 0; j < sizeof(r->digest); j++) {
+            fprintf(f, "%02x", r->digest[j]);
+        }
+        fprintf(f, " %llu %s\n", (unsigned long long)r->size, r->path);
+    }
+    int result = (fflush(f) == 0 && fsync(fd) == 0) ? 0 : -1;
+    if (fclose(f) != 0) {
+        result = -1;
+    }
+    if (result == 0) {
+        result = rename(tmp, index_path);
+    }
+    int saved = errno;
+    if (result < 0) {
+        unlink(tmp);
+    }
+    free(tmp);
+    errno = saved;
+    return result;
+}
+
+static void dedup_free(ExtractDedup *d) {
+    if (!d) {
+        return;
+    }
+    for (size_t i = 0; i < d->count; i++) {
+        free(d->records[i].path);
+    }
+    free(d->records);
+    free(d->slots);
+    free(d->spool);
+    free(d->root);
+    free(d);
+}
+
+/**
+ * Read a whole entry into the spool.
+ *
+ * @return 1 if it all fit, 0 if the spool filled up first (spooled bytes
+ *         are still to be written), -1 on error
+ */
+static int dedup_spool(ExtractDedup *d, ArcStream *input, size_t *spooled) {
+    *spooled = 0;
+    for (;;) {
+        if (*spooled == d->spool_capacity) {
+            if (d->spool_capacity > DEDUP_SPOOL_MAX) {
+                return 0;
+            }
+            // One byte past the limit tells a file of exactly DEDUP_SPOOL_MAX
+            // bytes (the next read hits EOF) from a larger one
+            size_t capacity = d->spool_capacity ? d->spool_capacity * 2 : EXTRACT_BUFFER_SIZE;
+            if (capacity > DEDUP_SPOOL_MAX) {
+                capacity = DEDUP_SPOOL_MAX + 1;
+            }
+            uint8_t *spool = realloc(d->spool, capacity);
+            if (!spool) {
+                return -1;
+            }
+            d->spool = spool;
+            d->spool_capacity = capacity;
+        }
+        ssize_t n = arc_stream_read(input, d->spool + *spooled, d->spool_capacity - *spooled);
+        if (n < 0) {
+            return -1;
+        }
+        if (n == 0) {
+            return 1;
+        }
+        *spooled += (size_t)n;
+    }
+}
+
+/**
+ * Whether an open file holds exactly these bytes.
+ */
+static bool dedup_same_contents(int fd, const uint8_t *data, size_t size) {
+    uint8_t buffer[EXTRACT_BUFFER_SIZE];
+    size_t pos = 0;
+    for (;;) {
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return n == 0 && pos == size;
+        }
+        if ((size_t)n > size - pos || memcmp(buffer, data + pos, (size_t)n) != 0) {
+            return false;
+        }
+        pos += (size_t)n;
+    }
+}
+
+/**
+ * Materialise filename from an earlier copy of the same contents.
+ *
+ * @param fd Receives a descriptor of the new file on success
+ * @return 1 if cloned or linked, 0 if the data must be written, -1 on error
+ */
+static int dedup_link(ExtractDedup *d, int dirfd, const char *filename, const ArcEntry *entry,
+                      const ArcExtractOptions *opts, const DedupRecord *record,
+                      const uint8_t *data, size_t size, int *fd) {
+    // The record may be stale (rewritten path, old persistent index): only
+    // trust a byte-for-byte match
+    int src = open(record->path, O_RDONLY | O_NOFOLLOW);
+    if (src < 0) {
+        return 0;
+    }
+    struct stat st;
+    if (fstat(src, &st) < 0 || !S_ISREG(st.st_mode) || (uint64_t)st.st_size != size ||
+        !dedup_same_contents(src, data, size)) {
+        close(src);
+        return 0;
+    }
+    if (unlinkat(dirfd, filename, 0) < 0 && errno != ENOENT) {
+        close(src);
+        return -1;
+    }
+
+#if defined(__linux__) && defined(FICLONE)
+    if (d->mode & ARC_DEDUP_REFLINK) {
+        *fd = openat(dirfd, filename, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW,
+                     opts->preserve_permissions ? entry->mode : 0644);
+        if (*fd < 0) {
+            close(src);
+            return -1;
+        }
+        if (ioctl(*fd, FICLONE, src) == 0) {
+            close(src);
+            return 1;
+        }
+        // No reflinks here (EOPNOTSUPP, EXDEV, ...): drop the empty file
+        close(*fd);
+        *fd = -1;
+        unlinkat(dirfd, filename, 0);
+    }
+#endif
+
+    // A hard link shares the inode, so it must already carry the
+    // attributes this entry would get
+    bool same_attrs = (!opts->preserve_permissions || entry->mode == 0 ||
+                       (st.st_mode & 0777) == (entry->mode & 0777)) &&
+                      (!opts->preserve_timestamps || entry->mtime == 0 ||
+                       st.st_mtime == (time_t)entry->mtime);
+    if (!(d->mode & ARC_DEDUP_HARDLINK) || !same_attrs ||
+        linkat(AT_FDCWD, record->path, dirfd, filename, 0) < 0) {
+        close(src);
+        return 0;
+    }
+    // linkat() goes by path, which may have been replaced since the compare:
+    // keep the link only if it is the inode that was compared
+    *fd = openat(dirfd, filename, O_RDONLY | O_NOFOLLOW);
+    struct stat linked;
+    if (*fd < 0 || fstat(*fd, &linked) < 0 || linked.st_dev != st.st_dev || linked.st_ino != st.st_ino) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+        close(src);
+        return unlinkat(dirfd, filename, 0) < 0 && errno != ENOENT ? -1 : 0;
+    }
+    close(src);
+    return 1;
+}
+
+/**
+ * Decode a file of known size straight into a shared mapping of the
+ * destination, a window at a time, so decompressors write into the page
+ * cache with no bounce buffer and no write() copy.
+ *
+ * The space is allocated up front: a full disk fails here, cleanly, rather
+ * than as SIGBUS on a store into the mapping.
+ *
+ * @param fd Destination, open for reading and writing, empty
+ * @param input Entry data
+ * @param expected Size from the entry header
+ * @param size Receives the number of bytes written
+ * @return 1 if the entry ended, 0 to go on with write() from *size (the
+ *         mapping couldn't be set up, or the data is longer than expected),
+ *         -1 on read error
+ */
+static int extract_file_mapped(int fd, ArcStream *input, uint64_t expected, uint64_t *size) {
+    if ((uint64_t)(off_t)expected != expected) {
+        return 0;
+    }
+#ifdef __linux__
+    if (fallocate(fd, 0, 0, (off_t)expected) < 0) {
+        return 0;   // EOPNOTSUPP, ENOSPC, ...
+    }
+#else
+    if (posix_fallocate(fd, 0, (off_t)expected) != 0) {
+        return 0;
+    }
+#endif
+
+    uint64_t pos = 0;
+    while (pos < expected) {
+        size_t window = (expected - pos < EXTRACT_MMAP_WINDOW) ? (size_t)(expected - pos) : EXTRACT_MMAP_WINDOW;
+        uint8_t *map = mmap(NULL, window, PROT_READ | PROT_WRITE, MAP_SHARED, fd, (off_t)pos);
+        if (map == MAP_FAILED) {
+            break;
+        }
+        size_t filled = 0;
+        while (filled < window) {
+            ssize_t n = arc_stream_read(input, map + filled, window - filled);
+            if (n < 0) {
+                munmap(map, window);
+                return -1;
+            }
+            if (n == 0) {
+                break;
+            }
+            filled += (size_t)n;
+        }
+        munmap(map, window);
+        pos += filled;
+        *size = pos;
+        if (filled < window) {
+            // Shorter than its header said: drop the unused allocation
+            return ftruncate(fd, (off_t)pos) == 0 ? 1 : -1;
+        }
+    }
+
+    // Anything past the mapped part (or all of it if mmap() failed) is written
+    if (ftruncate(fd, (off_t)pos) < 0 || lseek(fd, (off_t)pos, SEEK_SET) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
 /**
  * Extract a single file entry using openat() for security.
  * 
  * @param reader Archive reader
  * @param dirfd Destination directory file descriptor
  * @param filename Filename relative to dirfd (must be validated)
- * @param mode File mode
- * @param preserve_permissions Whether to preserve permissions
+ * @param entry The entry being extracted
+ * @param opts Extraction options (permissions, digests)
+ * @param dedup Digest map for deduplication (NULL = write every file)
+ * @param digests Receives the digests of the written data (if opts asks for any)
+ * @param size Receives the number of bytes written
  * @return 0 on success, -1 on error
  */
-static int extract_file_at(ArcReader *reader, int dirfd, const char *filename, mode_t mode, bool preserve_permissions) {
+static int extract_file_at(ArcReader *reader, int dirfd, const char *filename, const ArcEntry *entry,
+                           const ArcExtractOptions *opts, ExtractDedup *dedup, ArcDigests *digests,
+                           uint64_t *size) {
     ArcStream *data = arc_open_data(reader);
+    if (!data && entry->size == 0) {
+        // Readers have no data stream for empty entries
+        data = arc_stream_from_memory("", 0, 0);
+    }
     if (!data) {
         errno = EIO;
         return -1;
     }
+
+    // Hash in the same pass: the tee feeds every decompressed chunk to the
+    // hasher on its way to write()
+    ArcHasher *hasher = NULL;
+    ArcStream *input = data;
+    unsigned algorithms = opts->hash_algorithms | (dedup ? ARC_HASH_BLAKE3 : 0);
+    if (algorithms) {
+        hasher = arc_hasher_new(algorithms);
+        input = hasher ? arc_stream_hash(data, hasher) : NULL;
+        if (!input) {
+            arc_hasher_free(hasher);
+            arc_stream_close(data);
+            return -1;
+        }
+    }
     
+    int result = -1;
+    int fd = -1;
+    bool finished = false;
+    ArcDigests all;
+    memset(&all, 0, sizeof(all));
+
+    // Dedup: hold small files back until their digest is known
+    size_t spooled = 0;
+    int whole = 0;
+    if (dedup && entry->size <= DEDUP_SPOOL_MAX) {
+        whole = dedup_spool(dedup, input, &spooled);
+        if (whole < 0) {
+            goto done;
+        }
+    }
+
     // Create parent directories if needed
     char *last_slash = strrchr(filename, '/');
     if (last_slash) {
@@ -250,50 +747,119 @@ static int extract_file_at(ArcReader *reader, int dirfd, const char *filename, m
         size_t parent_len = last_slash - filename;
         char parent[PATH_MAX];
         if (parent_len >= sizeof(parent)) {
-            arc_stream_close(data);
             errno = ENAMETOOLONG;
-            return -1;
+            goto done;
         }
         strncpy(parent, filename, parent_len);
         parent[parent_len] = '\0';
         
         if (mkdir_p_at(dirfd, parent, 0755) < 0) {
-            arc_stream_close(data);
-            return -1;
+            goto done;
+        }
+    }
+
+    if (whole == 1) {
+        arc_hasher_final(hasher, &all);
+        finished = true;
+        DedupRecord *record = dedup_find(dedup, all.blake3, spooled);
+        int linked = record ? dedup_link(dedup, dirfd, filename, entry, opts, record, dedup->spool, spooled, &fd) : 0;
+        if (linked < 0) {
+            goto done;
+        }
+        if (linked == 1) {
+            *size = spooled;
+            dedup->files++;
+            dedup->bytes += spooled;
+            goto written;
+        }
+    }
+    if (dedup) {
+        // Replace rather than truncate: the old file may be linked elsewhere
+        if (unlinkat(dirfd, filename, 0) < 0 && errno != ENOENT) {
+            goto done;
         }
     }
     
     // Open destination file with O_NOFOLLOW to prevent symlink attacks
-    int fd = openat(dirfd, filename, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW, 
-                    preserve_permissions ? mode : 0644);
+    // Read access too, for mmap()
+    fd = openat(dirfd, filename, O_RDWR | O_CREAT | O_TRUNC | O_NOFOLLOW, 
+                opts->preserve_permissions ? entry->mode : 0644);
     if (fd < 0) {
-        arc_stream_close(data);
-        return -1;
+        goto done;
+    }
+    if (spooled > 0) {
+        if (write(fd, dedup->spool, spooled) != (ssize_t)spooled) {
+            goto done;
+        }
+        *size = spooled;
     }
     
+    // Large files of known size are decoded into a mapping of the file
+    if (!finished && spooled == 0 && entry->size >= EXTRACT_MMAP_THRESHOLD) {
+        int ended = extract_file_mapped(fd, input, entry->size, size);
+        if (ended < 0) {
+            goto done;
+        }
+        if (ended == 1) {
+            if (hasher) {
+                arc_hasher_final(hasher, &all);
+            }
+            finished = true;
+        }
+    }
+
     // Copy data
-    char buffer[EXTRACT_BUFFER_SIZE];
-    ssize_t n;
-    while ((n = arc_stream_read(data, buffer, sizeof(buffer))) > 0) {
-        ssize_t written = write(fd, buffer, n);
-        if (written != n) {
-            close(fd);
-            arc_stream_close(data);
-            return -1;
+    if (!finished) {
+        char buffer[EXTRACT_BUFFER_SIZE];
+        ssize_t n;
+        while ((n = arc_stream_read(input, buffer, sizeof(buffer))) > 0) {
+            ssize_t written = write(fd, buffer, n);
+            if (written != n) {
+                goto done;
+            }
+            *size += (uint64_t)n;
+        }
+        
+        if (n < 0) {
+            goto done; // Read error
+        }
+        if (hasher) {
+            arc_hasher_final(hasher, &all);
         }
     }
-    
-    if (n < 0) {
+    if (whole == 1) {
+        char path[PATH_MAX];
+        if (snprintf(path, sizeof(path), "%s/%s", dedup->root, filename) < (int)sizeof(path) &&
+            dedup_insert(dedup, all.blake3, spooled, path) < 0) {
+            goto done;
+        }
+    }
+
+written:
+    if (opts->hash_algorithms) {
+        // Only the digests that were asked for
+        *digests = all;
+        if (!(opts->hash_algorithms & ARC_HASH_BLAKE3)) {
+            digests->algorithms &= ~ARC_HASH_BLAKE3;
+            memset(digests->blake3, 0, sizeof(digests->blake3));
+        }
+        if (opts->hash_xattrs && set_digest_xattrs(fd, digests) < 0) {
+            goto done;
+        }
+    }
+    result = 0;
+
+done:
+    // Attributes are set separately using openat
+    if (fd >= 0) {
         close(fd);
-        arc_stream_close(data);
-        return -1; // Read error
     }
-    
-    // Close fd - attributes will be set separately using openat
-    close(fd);
+    if (input != data) {
+        arc_stream_close(input);
+    }
     arc_stream_close(data);
-    
-    return 0;
+    arc_hasher_free(hasher);
+    return result;
 }
 
 /**
@@ -375,11 +941,30 @@ static int set_file_attributes_fd(int fd, const ArcEntry *entry, bool preserve_p
     return 0;
 }
 
-int arc_extract_entry(ArcReader *reader, const ArcEntry *entry, const char *dest_dir, bool preserve_permissions, bool preserve_timestamps) {
-    if (!reader || !entry || !dest_dir) {
+/**
+ * Extract one entry; digests and size describe the data written for file
+ * entries (zeroed otherwise). Returns 1 for entries the matcher leaves out.
+ * Files are deduplicated against dedup unless it is NULL.
+ */
+static int extract_entry(ArcReader *reader, const ArcEntry *entry, const char *dest_dir,
+                         const ArcExtractOptions *opts, ArcMatcher *matcher, ExtractDedup *dedup,
+                         ArcDigests *digests, uint64_t *size) {
+    memset(digests, 0, sizeof(*digests));
+    *size = 0;
+    if (!reader || !entry || !dest_dir || !opts) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (opts->hash_algorithms & ~ARC_HASH_ALL) {
         errno = EINVAL;
         return -1;
     }
+
+    // Entries left out by the patterns are skipped before any data is read
+    if (matcher && !arc_matcher_match(matcher, entry->path)) {
+        arc_skip_data(reader);
+        return 1;
+    }
     
     const ArcLimits *limits = ((ArcReaderBase *)reader)->limits;
 
@@ -405,7 +990,7 @@ int arc_extract_entry(ArcReader *reader, const ArcEntry *entry, const char *dest
     
     switch (entry->type) {
         case ARC_ENTRY_FILE:
-            result = extract_file_at(reader, dirfd, filename, entry->mode, preserve_permissions);
+            result = extract_file_at(reader, dirfd, filename, entry, opts, dedup, digests, size);
             if (result == 0) {
                 // Open file again to set attributes (with O_NOFOLLOW)
                 file_fd = openat(dirfd, filename, O_RDWR | O_NOFOLLOW);
@@ -432,7 +1017,7 @@ int arc_extract_entry(ArcReader *reader, const ArcEntry *entry, const char *dest
         case ARC_ENTRY_HARDLINK:
             // Hard links are tricky - we'd need to track inode mappings
             // For now, treat as regular file (extract the data)
-            result = extract_file_at(reader, dirfd, filename, entry->mode, preserve_permissions);
+            result = extract_file_at(reader, dirfd, filename, entry, opts, dedup, digests, size);
             if (result == 0) {
                 file_fd = openat(dirfd, filename, O_RDWR | O_NOFOLLOW);
             }
@@ -450,7 +1035,7 @@ int arc_extract_entry(ArcReader *reader, const ArcEntry *entry, const char *dest
     
     // Set attributes if extraction succeeded and we have a file descriptor
     if (result == 0 && file_fd >= 0 && entry->type != ARC_ENTRY_SYMLINK) {
-        set_file_attributes_fd(file_fd, entry, preserve_permissions, preserve_timestamps);
+        set_file_attributes_fd(file_fd, entry, opts->preserve_permissions, opts->preserve_timestamps);
         close(file_fd);
     }
     
@@ -458,8 +1043,76 @@ int arc_extract_entry(ArcReader *reader, const ArcEntry *entry, const char *dest
     return result;
 }
 
+int arc_extract_entry(ArcReader *reader, const ArcEntry *entry, const char *dest_dir, bool preserve_permissions, bool preserve_timestamps) {
+    ArcExtractOptions opts;
+    memset(&opts, 0, sizeof(opts));
+    opts.preserve_permissions = preserve_permissions;
+    opts.preserve_timestamps = preserve_timestamps;
+    return arc_extract_entry_ex(reader, entry, dest_dir, &opts, NULL);
+}
+
+int arc_extract_entry_ex(ArcReader *reader, const ArcEntry *entry, const char *dest_dir,
+                         const ArcExtractOptions *opts, ArcDigests *digests) {
+    ArcDigests scratch;
+    uint64_t size = 0;
+    ArcMatcher *matcher = NULL;
+    if (opts && (opts->include_count || opts->exclude_count)) {
+        matcher = arc_matcher_new(opts->include, opts->include_count, opts->exclude, opts->exclude_count);
+        if (!matcher) {
+            return -1;
+        }
+    }
+    int result = extract_entry(reader, entry, dest_dir, opts, matcher, NULL, digests ? digests : &scratch, &size);
+    int saved = errno;
+    arc_matcher_free(matcher);
+    errno = saved;
+    return result > 0 ? 0 : result;
+}
+
 int arc_extract_to_path(ArcReader *reader, const char *dest_dir, bool preserve_permissions, bool preserve_timestamps) {
-    if (!reader || !dest_dir) {
+    ArcExtractOptions opts;
+    memset(&opts, 0, sizeof(opts));
+    opts.preserve_permissions = preserve_permissions;
+    opts.preserve_timestamps = preserve_timestamps;
+    return arc_extract_to_path_ex(reader, dest_dir, &opts, NULL);
+}
+
+static bool zip_select(const char *name, void *user) {
+    return arc_matcher_match(user, name);
+}
+
+/**
+ * Append an extracted file to a report.
+ */
+static int report_add(ArcExtractReport *report, const char *path, uint64_t size, const ArcDigests *digests) {
+    if (report->count == report->capacity) {
+        size_t capacity = report->capacity ? report->capacity * 2 : 16;
+        ArcExtractedFile *files = realloc(report->files, capacity * sizeof(ArcExtractedFile));
+        if (!files) {
+            return -1;
+        }
+        report->files = files;
+        report->capacity = capacity;
+    }
+    char *copy = strdup(path);
+    if (!copy) {
+        return -1;
+    }
+    ArcExtractedFile *file = &report->files[report->count++];
+    file->path = copy;
+    file->size = size;
+    file->digests = *digests;
+    report->total_bytes += size;
+    return 0;
+}
+
+int arc_extract_to_path_ex(ArcReader *reader, const char *dest_dir, const ArcExtractOptions *opts,
+                           ArcExtractReport *report) {
+    if (report) {
+        memset(report, 0, sizeof(*report));
+    }
+    if (!reader || !dest_dir || !opts || (opts->dedup & ~(ARC_DEDUP_REFLINK | ARC_DEDUP_HARDLINK)) ||
+        (opts->hash_algorithms & ~ARC_HASH_ALL)) {
         errno = EINVAL;
         return -1;
     }
@@ -482,24 +1135,448 @@ int arc_extract_to_path(ArcReader *reader, const char *dest_dir, bool preserve_p
         return -1;
     }
     
+    // Compile the patterns once for the whole archive
+    ArcMatcher *matcher = NULL;
+    if (opts->include_count || opts->exclude_count) {
+        matcher = arc_matcher_new(opts->include, opts->include_count, opts->exclude, opts->exclude_count);
+        if (!matcher) {
+            int saved = errno;
+            close(dirfd);
+            errno = saved;
+            return -1;
+        }
+    }
+    ExtractDedup *dedup = NULL;
+    if (opts->dedup) {
+        dedup = calloc(1, sizeof(ExtractDedup));
+        if (!dedup || !(dedup->root = realpath(dest_dir, NULL)) ||
+            (opts->dedup_index && dedup_load(dedup, opts->dedup_index) < 0)) {
+            int saved = dedup ? errno : ENOMEM;
+            dedup_free(dedup);
+            arc_matcher_free(matcher);
+            close(dirfd);
+            errno = saved;
+            return -1;
+        }
+        dedup->mode = opts->dedup;
+    }
+    // ZIP: drop unselected entries while walking the central directory (a
+    // listing recorder must see every entry, so not while one is attached)
+    bool zip_filter = matcher && arc_reader_format(reader) == ARC_FORMAT_ZIP &&
+                      !((ArcReaderBase *)reader)->recorder &&
+                      arc_zip_set_filter(reader, zip_select, matcher) == 0;
+
     // Extract all entries
     ArcEntry entry;
-    int error_count = 0;
+    size_t error_count = 0;
     
     while (arc_next(reader, &entry) == 0) {
         // Use the single-entry extraction function (it will open its own dirfd)
         // We could optimize by reusing dirfd, but for simplicity we let each
         // extraction open its own to ensure it's still valid
-        int result = arc_extract_entry(reader, &entry, dest_dir, preserve_permissions, preserve_timestamps);
+        ArcDigests digests;
+        uint64_t size;
+        int result = extract_entry(reader, &entry, dest_dir, opts, matcher, dedup, &digests, &size);
         
         if (result < 0) {
             error_count++;
+        } else if (result == 0 && report && (entry.type == ARC_ENTRY_FILE || entry.type == ARC_ENTRY_HARDLINK)) {
+            if (report_add(report, entry.path, size, &digests) < 0) {
+                error_count++;
+            }
         }
         
         arc_entry_free(&entry);
     }
     
+    if (zip_filter) {
+        arc_zip_set_filter(reader, NULL, NULL);
+    }
+    arc_matcher_free(matcher);
+    if (dedup) {
+        if (opts->dedup_index && dedup->dirty && dedup_save(dedup, opts->dedup_index) < 0) {
+            error_count++;
+        }
+        if (report) {
+            report->dedup_files = dedup->files;
+            report->dedup_bytes = dedup->bytes;
+        }
+        dedup_free(dedup);
+    }
+    if (report) {
+        report->errors = error_count;
+    }
     close(dirfd);
     return (error_count > 0) ? -1 : 0;
 }
 
+void arc_extract_report_free(ArcExtractReport *report) {
+    if (!report) {
+        return;
+    }
+    for (size_t i = 0; i < report->count; i++) {
+        free(report->files[i].path);
+    }
+    free(report->files);
+    memset(report, 0, sizeof(*report));
+}
+
+// Extraction into sinks
+
+#define SINK_POOL_BUFFERS 8
+
+// Copy buffers reused across extractions (and threads)
+static pthread_mutex_t sink_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static void *sink_pool[SINK_POOL_BUFFERS];
+static size_t sink_pool_count;
+
+static void *sink_buffer_get(void) {
+    void *buf = NULL;
+    pthread_mutex_lock(&sink_pool_lock);
+    if (sink_pool_count > 0) {
+        buf = sink_pool[--sink_pool_count];
+    }
+    pthread_mutex_unlock(&sink_pool_lock);
+    return buf ? buf : malloc(EXTRACT_BUFFER_SIZE);
+}
+
+static void sink_buffer_put(void *buf) {
+    if (!buf) {
+        return;
+    }
+    pthread_mutex_lock(&sink_pool_lock);
+    if (sink_pool_count < SINK_POOL_BUFFERS) {
+        sink_pool[sink_pool_count++] = buf;
+        buf = NULL;
+    }
+    pthread_mutex_unlock(&sink_pool_lock);
+    free(buf);
+}
+
+/**
+ * Stream the current entry's data into a new sink file.
+ */
+static int sink_file(ArcReader *reader, ArcSink *sink, const char *path, const ArcEntry *entry,
+                     const ArcExtractOptions *opts, unsigned what, void *buffer,
+                     ArcDigests *digests, uint64_t *size) {
+    ArcStream *data = arc_open_data(reader);
+    if (!data && entry->size == 0) {
+        // Readers have no data stream for empty entries
+        data = arc_stream_from_memory("", 0, 0);
+    }
+    if (!data) {
+        errno = EIO;
+        return -1;
+    }
+    ArcHasher *hasher = NULL;
+    ArcStream *input = data;
+    if (opts->hash_algorithms) {
+        hasher = arc_hasher_new(opts->hash_algorithms);
+        input = hasher ? arc_stream_hash(data, hasher) : NULL;
+        if (!input) {
+            arc_hasher_free(hasher);
+            arc_stream_close(data);
+            return -1;
+        }
+    }
+
+    int result = -1;
+    void *file = sink->vtable->open_file(sink, path, entry);
+    if (file) {
+        ssize_t n;
+        while ((n = arc_stream_read(input, buffer, EXTRACT_BUFFER_SIZE)) > 0) {
+            if (sink->vtable->write(sink, file, buffer, (size_t)n) < 0) {
+                break;
+            }
+            *size += (uint64_t)n;
+        }
+        if (n == 0 && (!what || !sink->vtable->set_attrs ||
+                       sink->vtable->set_attrs(sink, path, file, entry, what) == 0)) {
+            result = 0;
+        }
+        int saved = errno;
+        if (sink->vtable->close(sink, file, result == 0) < 0 && result == 0) {
+            saved = errno;
+            result = -1;
+        }
+        errno = saved;
+    }
+    if (result == 0 && hasher) {
+        arc_hasher_final(hasher, digests);
+    }
+    if (input != data) {
+        arc_stream_close(input);
+    }
+    arc_stream_close(data);
+    arc_hasher_free(hasher);
+    return result;
+}
+
+/**
+ * Write one entry into a sink.
+ *
+ * @return 0 if written, 1 if left out (patterns, unsupported type), -1 on error
+ */
+static int sink_entry(ArcReader *reader, ArcSink *sink, const ArcEntry *entry, const ArcExtractOptions *opts,
+                      ArcMatcher *matcher, void *buffer, ArcDigests *digests, uint64_t *size) {
+    memset(digests, 0, sizeof(*digests));
+    *size = 0;
+    if (matcher && !arc_matcher_match(matcher, entry->path)) {
+        arc_skip_data(reader);
+        return 1;
+    }
+    if (validate_entry_path(entry->path, ((ArcReaderBase *)reader)->limits) < 0) {
+        return -1;
+    }
+
+    // Sinks see "dir/file", never "./dir/file" or "dir/"
+    const char *p = entry->path;
+    while (p[0] == '.' && p[1] == '/') {
+        p += 2;
+    }
+    size_t len = strlen(p);
+    while (len > 0 && p[len - 1] == '/') {
+        len--;
+    }
+    if (len == 0 || (len == 1 && p[0] == '.')) {
+        arc_skip_data(reader);
+        return 1;  // The archive root itself
+    }
+    char *path = strndup(p, len);
+    if (!path) {
+        return -1;
+    }
+
+    unsigned what = (opts->preserve_permissions ? ARC_SINK_ATTR_MODE : 0) |
+                    (opts->preserve_timestamps ? ARC_SINK_ATTR_MTIME : 0);
+    int result;
+    switch (entry->type) {
+        case ARC_ENTRY_FILE:
+        case ARC_ENTRY_HARDLINK:
+            result = sink_file(reader, sink, path, entry, opts, what, buffer, digests, size);
+            break;
+        case ARC_ENTRY_DIR:
+            result = sink->vtable->mkdir(sink, path, entry);
+            if (result == 0 && what && sink->vtable->set_attrs) {
+                result = sink->vtable->set_attrs(sink, path, NULL, entry, what);
+            }
+            break;
+        case ARC_ENTRY_SYMLINK:
+            if (!sink->vtable->symlink) {
+                result = 1;
+            } else if (!entry->link_target) {
+                errno = EINVAL;
+                result = -1;
+            } else {
+                result = sink->vtable->symlink(sink, path, entry->link_target, entry);
+            }
+            break;
+        default:
+            arc_skip_data(reader);
+            result = 1;
+            break;
+    }
+    int saved = errno;
+    free(path);
+    errno = saved;
+    return result;
+}
+
+int arc_extract_to_sink(ArcReader *reader, ArcSink *sink, const ArcExtractOptions *opts,
+                        ArcExtractReport *report) {
+    if (report) {
+        memset(report, 0, sizeof(*report));
+    }
+    ArcExtractOptions defaults;
+    memset(&defaults, 0, sizeof(defaults));
+    if (!opts) {
+        opts = &defaults;
+    }
+    if (!reader || !sink || !sink->vtable || (opts->hash_algorithms & ~ARC_HASH_ALL)) {
+        errno = EINVAL;
+        return -1;
+    }
+    ArcMatcher *matcher = NULL;
+    if (opts->include_count || opts->exclude_count) {
+        matcher = arc_matcher_new(opts->include, opts->include_count, opts->exclude, opts->exclude_count);
+        if (!matcher) {
+            return -1;
+        }
+    }
+    bool zip_filter = matcher && arc_reader_format(reader) == ARC_FORMAT_ZIP &&
+                      !((ArcReaderBase *)reader)->recorder &&
+                      arc_zip_set_filter(reader, zip_select, matcher) == 0;
+    void *buffer = sink_buffer_get();
+    if (!buffer) {
+        arc_matcher_free(matcher);
+        return -1;
+    }
+
+    ArcEntry entry;
+    size_t error_count = 0;
+    int rc;
+    while ((rc = arc_next(reader, &entry)) == 0) {
+        ArcDigests digests;
+        uint64_t size;
+        int result = sink_entry(reader, sink, &entry, opts, matcher, buffer, &digests, &size);
+        if (result < 0) {
+            error_count++;
+        } else if (result == 0 && report && (entry.type == ARC_ENTRY_FILE || entry.type == ARC_ENTRY_HARDLINK)) {
+            if (report_add(report, entry.path, size, &digests) < 0) {
+                error_count++;
+            }
+        }
+        arc_entry_free(&entry);
+    }
+    if (rc < 0) {
+        error_count++;
+    }
+
+    sink_buffer_put(buffer);
+    if (zip_filter) {
+        arc_zip_set_filter(reader, NULL, NULL);
+    }
+    arc_matcher_free(matcher);
+    if (report) {
+        report->errors = error_count;
+    }
+    return (error_count > 0) ? -1 : 0;
+}
+
+// Local directory sink
+
+typedef struct FsSink {
+    ArcSink base;
+    int dirfd;
+} FsSink;
+
+typedef struct FsSinkFile {
+    int fd;
+    char *path;     // For removing a discarded file
+} FsSinkFile;
+
+static int fs_sink_parent(int dirfd, const char *path) {
+    const char *slash = strrchr(path, '/');
+    if (!slash) {
+        return 0;
+    }
+    char parent[PATH_MAX];
+    size_t len = (size_t)(slash - path);
+    if (len >= sizeof(parent)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memcpy(parent, path, len);
+    parent[len] = '\0';
+    return mkdir_p_at(dirfd, parent, 0755);
+}
+
+static int fs_sink_mkdir(ArcSink *sink, const char *path, const ArcEntry *entry) {
+    (void)entry;
+    return mkdir_p_at(((FsSink *)sink)->dirfd, path, 0755);
+}
+
+static void *fs_sink_open_file(ArcSink *sink, const char *path, const ArcEntry *entry) {
+    (void)entry;
+    FsSink *fs = (FsSink *)sink;
+    if (fs_sink_parent(fs->dirfd, path) < 0) {
+        return NULL;
+    }
+    FsSinkFile *file = calloc(1, sizeof(FsSinkFile));
+    if (!file || !(file->path = strdup(path))) {
+        free(file);
+        errno = ENOMEM;
+        return NULL;
+    }
+    file->fd = openat(fs->dirfd, path, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW, 0644);
+    if (file->fd < 0) {
+        int saved = errno;
+        free(file->path);
+        free(file);
+        errno = saved;
+        return NULL;
+    }
+    return file;
+}
+
+static int fs_sink_write(ArcSink *sink, void *file, const void *buf, size_t n) {
+    (void)sink;
+    const uint8_t *p = buf;
+    while (n > 0) {
+        ssize_t written = write(((FsSinkFile *)file)->fd, p, n);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += written;
+        n -= (size_t)written;
+    }
+    return 0;
+}
+
+static int fs_sink_set_attrs(ArcSink *sink, const char *path, void *file, const ArcEntry *entry, unsigned what) {
+    bool mode = (what & ARC_SINK_ATTR_MODE) != 0;
+    bool mtime = (what & ARC_SINK_ATTR_MTIME) != 0;
+    if (file) {
+        return set_file_attributes_fd(((FsSinkFile *)file)->fd, entry, mode, mtime);
+    }
+    int fd = openat(((FsSink *)sink)->dirfd, path, O_DIRECTORY | O_NOFOLLOW | O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    int result = set_file_attributes_fd(fd, entry, mode, mtime);
+    close(fd);
+    return result;
+}
+
+static int fs_sink_close(ArcSink *sink, void *file, bool ok) {
+    FsSinkFile *f = file;
+    int result = close(f->fd);
+    if (!ok) {
+        unlinkat(((FsSink *)sink)->dirfd, f->path, 0);
+    }
+    free(f->path);
+    free(f);
+    return result;
+}
+
+static int fs_sink_symlink(ArcSink *sink, const char *path, const char *target, const ArcEntry *entry) {
+    (void)entry;
+    return extract_symlink_at(((FsSink *)sink)->dirfd, path, target);
+}
+
+static void fs_sink_free(ArcSink *sink) {
+    close(((FsSink *)sink)->dirfd);
+    free(sink);
+}
+
+static const struct ArcSinkVtable fs_sink_vtable = {
+    .mkdir = fs_sink_mkdir,
+    .open_file = fs_sink_open_file,
+    .write = fs_sink_write,
+    .set_attrs = fs_sink_set_attrs,
+    .close = fs_sink_close,
+    .symlink = fs_sink_symlink,
+    .free = fs_sink_free,
+};
+
+ArcSink *arc_sink_fs_new(const char *dest_dir) {
+    if (!dest_dir) {
+        errno = EINVAL;
+        return NULL;
+    }
+    int dirfd = open(dest_dir, O_DIRECTORY | O_NOFOLLOW | O_RDONLY);
+    if (dirfd < 0) {
+        return NULL;
+    }
+    FsSink *fs = calloc(1, sizeof(FsSink));
+    if (!fs) {
+        close(dirfd);
+        return NULL;
+    }
+    fs->base.vtable = &fs_sink_vtable;
+    fs->dirfd = dirfd;
+    return &fs->base;
+}
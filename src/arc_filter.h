@@ -2,6 +2,8 @@
 #define ARC_FILTER_H
 
 #include "arc_stream.h"
+#include "arc_index.h"
+#include "arc_bgzf.h"
 
 /**
  * Decompression filter layer.
@@ -12,6 +14,8 @@
 
 /**
  * Create a gzip decompression filter.
+ * Concatenated members (`cat a.gz b.gz`) decode as one stream, as with
+ * gzip -d; trailing bytes that don't start a member are ignored.
  * 
  * @param underlying Stream to decompress (must remain valid for filter lifetime)
  * @param byte_limit Maximum decompressed bytes to allow (0 = unlimited, not recommended)
@@ -19,6 +23,17 @@
  */
 ArcStream *arc_filter_gzip(ArcStream *underlying, int64_t byte_limit);
 
+/**
+ * Attach a checkpoint index to a gzip filter.
+ * While the filter decodes, a checkpoint is added to the index roughly every
+ * index->span uncompressed bytes (see arc_index.h).
+ * 
+ * @param stream Filter created by arc_filter_gzip() (nothing read from it yet)
+ * @param index Index to fill (not owned, must outlive the filter), or NULL to detach
+ * @return 0 on success, -1 if stream is not a fresh gzip filter
+ */
+int arc_filter_gzip_set_index(ArcStream *stream, ArcInflateIndex *index);
+
 /**
  * Create a bzip2 decompression filter.
  * 
@@ -50,5 +65,168 @@ ArcStream *arc_filter_xz(ArcStream *underlying, int64_t byte_limit);
  */
 ArcStream *arc_filter_deflate(ArcStream *underlying, int64_t byte_limit);
 
+/**
+ * Same as arc_filter_deflate(), but the filter takes ownership of
+ * `underlying` and closes it when the filter is closed (for substreams
+ * created just to feed the filter).
+ */
+ArcStream *arc_filter_deflate_owned(ArcStream *underlying, int64_t byte_limit);
+
+/**
+ * Options for the parallel inflate filters. A zeroed struct (or NULL) uses
+ * one worker per online CPU and 4 MiB compressed chunks.
+ */
+typedef struct ArcParallelInflateOptions {
+    unsigned threads;   // Worker threads (0 = one per online CPU)
+    size_t chunk_size;  // Compressed bytes per speculative chunk (0 = 4 MiB)
+} ArcParallelInflateOptions;
+
+/**
+ * Compressed size from which the readers switch a single gzip or deflate
+ * stream to the parallel filters (see arc_parallel_inflate_worthwhile()).
+ */
+#define ARC_PARALLEL_INFLATE_MIN (16 * 1024 * 1024)
+
+/**
+ * Online CPUs needed before the readers pick the parallel filters. The
+ * speculative decoder runs at about 0.4x zlib per worker, so it only pulls
+ * ahead of the serial filter from about three workers.
+ */
+#define ARC_PARALLEL_INFLATE_MIN_CPUS 4
+
+/**
+ * Create a gzip decompression filter that inflates one large stream on
+ * several threads.
+ *
+ * The compressed data is split into chunks; workers locate the first
+ * deflate block in each chunk and decode it speculatively, standing in
+ * markers for the unknown 32 KiB window, and the reading thread resolves
+ * the markers and stitches chunks in order. Chunks that cannot be used
+ * (no block found, misaligned guess) are decoded serially with zlib, so
+ * the output is always exact. Multi-member files are decoded member after
+ * member and each member's CRC-32 and size are verified.
+ *
+ * The underlying stream is only read sequentially from the calling thread.
+ * Memory grows with threads * chunk_size (compressed and decoded).
+ *
+ * @param underlying Stream to decompress (must remain valid for filter lifetime)
+ * @param byte_limit Maximum decompressed bytes to allow (0 = unlimited, not recommended)
+ * @param opts Options (NULL = defaults)
+ * @return New stream that decompresses gzip data, or NULL on error
+ */
+ArcStream *arc_filter_gzip_parallel(ArcStream *underlying, int64_t byte_limit,
+                                    const ArcParallelInflateOptions *opts);
+
+/**
+ * Raw deflate counterpart of arc_filter_gzip_parallel() (for ZIP entries).
+ */
+ArcStream *arc_filter_deflate_parallel(ArcStream *underlying, int64_t byte_limit,
+                                       const ArcParallelInflateOptions *opts);
+
+/**
+ * Same as arc_filter_deflate_parallel(), but the filter takes ownership of
+ * `underlying` and closes it when the filter is closed.
+ */
+ArcStream *arc_filter_deflate_parallel_owned(ArcStream *underlying, int64_t byte_limit,
+                                             const ArcParallelInflateOptions *opts);
+
+/**
+ * Whether a stream of `compressed_size` bytes is worth the parallel filters:
+ * at least ARC_PARALLEL_INFLATE_MIN and ARC_PARALLEL_INFLATE_MIN_CPUS online
+ * CPUs.
+ */
+bool arc_parallel_inflate_worthwhile(int64_t compressed_size);
+
+/**
+ * arc_parallel_inflate_worthwhile() for a given number of online CPUs.
+ */
+bool arc_parallel_inflate_worthwhile_on(int64_t compressed_size, long cpus);
+
+/**
+ * Options for arc_filter_bgzf(). A zeroed struct (or NULL) uses one worker
+ * per online CPU and collects the block index while reading.
+ */
+typedef struct ArcBgzfOptions {
+    unsigned threads;            // Worker threads (0 = one per online CPU, 1 = calling thread only)
+    const ArcBgzfIndex *index;   // Known blocks, e.g. from a .gzi file (copied; NULL = none yet)
+} ArcBgzfOptions;
+
+/**
+ * Create a BGZF decompression filter (see arc_bgzf.h).
+ *
+ * Blocks are read ahead and inflated on a pool of threads, each checked
+ * against its CRC-32 and ISIZE, and served in order. Unlike the other
+ * filters this one can seek: block starts are indexed as they are read (or
+ * taken from opts->index), and a seek past the known blocks walks the
+ * remaining block headers without inflating them, which needs a seekable
+ * `underlying`.
+ *
+ * @param underlying BGZF data, positioned at the first block (must remain valid for filter lifetime)
+ * @param byte_limit Maximum uncompressed offset to read up to (0 = unlimited, not recommended)
+ * @param opts Options (NULL = defaults)
+ * @return New stream, or NULL on error
+ */
+ArcStream *arc_filter_bgzf(ArcStream *underlying, int64_t byte_limit, const ArcBgzfOptions *opts);
+
+/**
+ * Block index collected so far by a BGZF filter (complete once the filter
+ * hit the end of the data or served a SEEK_END), e.g. to write a .gzi file.
+ *
+ * @return Index owned by the filter, or NULL if stream is not a BGZF filter
+ */
+const ArcBgzfIndex *arc_filter_bgzf_index(ArcStream *stream);
+
+/**
+ * Options for arc_filter_lz4(). A zeroed struct (or NULL) uses one worker
+ * per online CPU.
+ */
+typedef struct ArcLz4Options {
+    unsigned threads;  // Worker threads (0 = one per online CPU, 1 = calling thread only)
+} ArcLz4Options;
+
+/**
+ * Create an LZ4 frame decompression filter (magic 04 22 4D 18).
+ *
+ * Concatenated frames are decoded one after the other and skippable frames
+ * are skipped. The header, block and content checksums and the content size
+ * are verified when the frame carries them; frames that need an external
+ * dictionary fail with ENOTSUP. Frames written with independent blocks (the
+ * lz4 tool's default) are read ahead and decoded on a pool of threads, each
+ * block in its own buffer; linked blocks decode on the calling thread.
+ * Memory grows with threads * the frame's block size (up to 4 MiB).
+ *
+ * @param underlying Stream to decompress (must remain valid for filter lifetime)
+ * @param byte_limit Maximum decompressed bytes to allow (0 = unlimited, not recommended)
+ * @param opts Options (NULL = defaults)
+ * @return New stream that decompresses LZ4 frames, or NULL on error
+ */
+ArcStream *arc_filter_lz4(ArcStream *underlying, int64_t byte_limit, const ArcLz4Options *opts);
+
+/**
+ * Options for arc_filter_gzip_write(). A zeroed struct (or NULL) compresses
+ * at zlib's default level on one thread per online CPU.
+ */
+typedef struct ArcGzipWriteOptions {
+    int level;          // Deflate level 1-9 (0 = zlib default)
+    unsigned threads;   // Compression threads (0 = one per online CPU, 1 = calling thread only)
+    size_t block_size;  // Input bytes per parallel block (0 = 128 KiB)
+} ArcGzipWriteOptions;
+
+/**
+ * Create a gzip compression filter (the write-side counterpart of
+ * arc_filter_gzip()).
+ * 
+ * Input is cut into blocks that a pool of threads deflates in parallel,
+ * pigz-style: each block is primed with the previous block's last 32 KiB
+ * as a dictionary and ends in a sync flush, so the blocks join into one
+ * ordinary gzip member whose CRC-32 is combined with crc32_combine().
+ * arc_out_stream_finish() writes the last block and the trailer.
+ * 
+ * @param underlying Stream to write the gzip data to (not finished or closed by the filter)
+ * @param opts Options (NULL = defaults)
+ * @return New output stream, or NULL on error
+ */
+ArcOutStream *arc_filter_gzip_write(ArcOutStream *underlying, const ArcGzipWriteOptions *opts);
+
 #endif // ARC_FILTER_H
 
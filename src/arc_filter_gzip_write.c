@@ -0,0 +1,250 @@
+#define _POSIX_C_SOURCE 200809L
+#include "arc_filter.h"
+#include "arc_stream.h"
+#include "arc_deflate_pool.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <zlib.h>
+
+#define DEFAULT_BLOCK_SIZE (128 * 1024)
+#define MIN_BLOCK_SIZE (4 * 1024)
+#define MAX_BLOCK_SIZE (64 * 1024 * 1024)
+
+#define GZIP_OS_UNIX 3
+
+struct GzipWriteData {
+    ArcOutStream *underlying;
+    ArcDeflatePool *pool;
+    int level;
+    size_t block_size;
+
+    ArcDeflateBlock *blocks;  // Ring: in_flight submitted blocks from head, then the one being filled
+    size_t block_count;
+    size_t head;
+    size_t in_flight;
+    ArcDeflateBlock *filling;  // NULL until the first byte (or finish)
+
+    bool header_written;
+    uint32_t crc;
+    uint64_t total_in;
+    int error;                 // Sticky errno
+};
+
+static int gzip_write_fail(struct GzipWriteData *data, int error) {
+    if (!data->error) {
+        data->error = error ? error : EIO;
+    }
+    errno = data->error;
+    return -1;
+}
+
+static int write_header(struct GzipWriteData *data) {
+    uint8_t header[10] = { 0x1f, 0x8b, Z_DEFLATED, 0, 0, 0, 0, 0, 0, GZIP_OS_UNIX };
+    // XFL: 2 = maximum compression, 4 = fastest
+    header[8] = data->level == 9 ? 2 : (data->level == 1 ? 4 : 0);
+    if (arc_out_stream_write(data->underlying, header, sizeof(header)) < 0) {
+        return gzip_write_fail(data, errno);
+    }
+    data->header_written = true;
+    return 0;
+}
+
+/**
+ * Wait for the oldest submitted block and write it out.
+ */
+static int retire_block(struct GzipWriteData *data) {
+    ArcDeflateBlock *b = &data->blocks[data->head];
+    data->head = (data->head + 1) % data->block_count;
+    data->in_flight--;
+
+    if (arc_deflate_pool_wait(data->pool, b) < 0) {
+        return gzip_write_fail(data, errno);
+    }
+    if (data->error) {
+        errno = data->error;
+        return -1;
+    }
+    if (!data->header_written && write_header(data) < 0) {
+        return -1;
+    }
+    if (arc_out_stream_write(data->underlying, b->out, b->out_len) < 0) {
+        return gzip_write_fail(data, errno);
+    }
+    data->crc = (uint32_t)crc32_combine(data->crc, b->crc, (z_off_t)b->in_len);
+    data->total_in += b->in_len;
+    return 0;
+}
+
+/**
+ * Take the slot after the submitted blocks for filling, writing out the
+ * oldest block first if every other slot is busy.
+ */
+static ArcDeflateBlock *claim_block(struct GzipWriteData *data) {
+    if (data->in_flight + 1 == data->block_count && retire_block(data) < 0) {
+        return NULL;
+    }
+    ArcDeflateBlock *b = &data->blocks[(data->head + data->in_flight) % data->block_count];
+    if (!b->in) {
+        b->in = malloc(data->block_size);
+        if (!b->in) {
+            gzip_write_fail(data, ENOMEM);
+            return NULL;
+        }
+        b->in_capacity = data->block_size;
+    }
+    b->in_len = 0;
+    b->dict_len = 0;
+    b->last = false;
+    b->store = false;
+    return b;
+}
+
+static int gzip_write_write(ArcOutStream *stream, const void *buf, size_t n) {
+    struct GzipWriteData *data = (struct GzipWriteData *)stream->user_data;
+    if (data->error) {
+        errno = data->error;
+        return -1;
+    }
+    const uint8_t *p = buf;
+    while (n > 0) {
+        if (!data->filling) {
+            data->filling = claim_block(data);
+            if (!data->filling) {
+                return -1;
+            }
+        }
+        ArcDeflateBlock *b = data->filling;
+        if (b->in_len == b->in_capacity) {
+            // More input follows, so the full block is not the last one.
+            // Its input stays untouched after submission (and after it is
+            // written out), so the next block can take its dictionary late.
+            arc_deflate_pool_submit(data->pool, b);
+            data->in_flight++;
+            data->filling = claim_block(data);
+            if (!data->filling) {
+                return -1;
+            }
+            arc_deflate_block_chain(b, data->filling);
+            continue;
+        }
+        size_t take = b->in_capacity - b->in_len;
+        if (take > n) {
+            take = n;
+        }
+        memcpy(b->in + b->in_len, p, take);
+        b->in_len += take;
+        p += take;
+        n -= take;
+    }
+    return 0;
+}
+
+static int gzip_write_finish(ArcOutStream *stream) {
+    struct GzipWriteData *data = (struct GzipWriteData *)stream->user_data;
+    if (data->error) {
+        errno = data->error;
+        return -1;
+    }
+    if (!data->filling) {
+        // No input at all: one empty final block
+        data->filling = claim_block(data);
+        if (!data->filling) {
+            return -1;
+        }
+    }
+    data->filling->last = true;
+    arc_deflate_pool_submit(data->pool, data->filling);
+    data->filling = NULL;
+    data->in_flight++;
+    while (data->in_flight > 0) {
+        if (retire_block(data) < 0) {
+            return -1;
+        }
+    }
+
+    uint8_t trailer[8];
+    for (int i = 0; i < 4; i++) {
+        trailer[i] = (uint8_t)(data->crc >> (8 * i));
+        trailer[4 + i] = (uint8_t)(data->total_in >> (8 * i));  // ISIZE: length mod 2^32
+    }
+    if (arc_out_stream_write(data->underlying, trailer, sizeof(trailer)) < 0) {
+        return gzip_write_fail(data, errno);
+    }
+    // Anything written after this starts a new member
+    data->header_written = false;
+    data->crc = 0;
+    data->total_in = 0;
+    return 0;
+}
+
+static void gzip_write_close(ArcOutStream *stream) {
+    struct GzipWriteData *data = (struct GzipWriteData *)stream->user_data;
+    if (data) {
+        // Blocks still on the pool must finish before their buffers go away
+        while (data->in_flight > 0) {
+            arc_deflate_pool_wait(data->pool, &data->blocks[data->head]);
+            data->head = (data->head + 1) % data->block_count;
+            data->in_flight--;
+        }
+        arc_deflate_pool_free(data->pool);
+        for (size_t i = 0; i < data->block_count; i++) {
+            arc_deflate_block_release(&data->blocks[i]);
+        }
+        free(data->blocks);
+        free(data);
+    }
+    free(stream);
+}
+
+static const struct ArcOutStreamVtable gzip_write_vtable = {
+    .write = gzip_write_write,
+    .finish = gzip_write_finish,
+    .close = gzip_write_close,
+};
+
+ArcOutStream *arc_filter_gzip_write(ArcOutStream *underlying, const ArcGzipWriteOptions *opts) {
+    if (!underlying || (opts && (opts->level < 0 || opts->level > 9))) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    ArcOutStream *stream = calloc(1, sizeof(ArcOutStream));
+    if (!stream) {
+        return NULL;
+    }
+    struct GzipWriteData *data = calloc(1, sizeof(struct GzipWriteData));
+    if (!data) {
+        free(stream);
+        return NULL;
+    }
+    data->underlying = underlying;
+    data->level = opts && opts->level ? opts->level : Z_DEFAULT_COMPRESSION;
+    data->block_size = opts && opts->block_size ? opts->block_size : DEFAULT_BLOCK_SIZE;
+    if (data->block_size < MIN_BLOCK_SIZE) {
+        data->block_size = MIN_BLOCK_SIZE;
+    } else if (data->block_size > MAX_BLOCK_SIZE) {
+        data->block_size = MAX_BLOCK_SIZE;
+    }
+    unsigned threads = opts && opts->threads ? opts->threads : arc_deflate_default_threads();
+
+    // Two blocks per thread keep the workers busy while one is written,
+    // plus the one being filled
+    data->block_count = threads > 1 ? 2 * (size_t)threads + 1 : 2;
+    data->blocks = calloc(data->block_count, sizeof(ArcDeflateBlock));
+    data->pool = data->blocks ? arc_deflate_pool_new(threads > 1 ? threads : 0, data->level) : NULL;
+    if (!data->pool) {
+        int saved = errno ? errno : ENOMEM;
+        free(data->blocks);
+        free(data);
+        free(stream);
+        errno = saved;
+        return NULL;
+    }
+
+    stream->vtable = &gzip_write_vtable;
+    stream->bytes_written = 0;
+    stream->user_data = data;
+    return stream;
+}
@@ -0,0 +1,1477 @@
+#define _POSIX_C_SOURCE 200809L
+#include "arc_filter.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <zlib.h>
+
+/*
+ * Speculative parallel inflate (after rapidgzip).
+ *
+ * The compressed input is cut into fixed-size chunks. A worker thread
+ * searches each chunk for the first bit offset that parses as a deflate
+ * block header (dynamic Huffman with valid code trees, or stored with a
+ * matching LEN/NLEN) and decodes from there without knowing the 32 KiB
+ * window that precedes it: back-references into that unknown window are
+ * emitted as 16-bit marker symbols naming the window slot. Once 32 KiB of
+ * marker-free output has been produced nothing later can reach a marker,
+ * so decoding drops to plain bytes. A chunk stops at the first block
+ * boundary at or past the start of the next chunk.
+ *
+ * The reading thread stitches chunks in order. A chunk is only used if it
+ * began exactly where the previous one ended; its markers are then
+ * replaced from the known window. Otherwise (false positive, a run of
+ * fixed-Huffman blocks the finder does not look for, a gzip member
+ * boundary, a chunk that inflates too far) that stretch is decoded
+ * serially with zlib, primed with the window and the partial first byte.
+ * Either way the output is exact, and gzip members are still checked
+ * against their CRC-32 and ISIZE trailers.
+ */
+
+#define WINDOW_SIZE 32768
+#define MARKER_BASE 256                    // Wide symbols >= this stand for window slot (sym - MARKER_BASE)
+#define DEFAULT_CHUNK_SIZE (4u << 20)
+#define MIN_CHUNK_SIZE 4096
+#define MAX_THREADS 64
+#define SPEC_MAX_RATIO 32                  // Speculative output cap, in multiples of the chunk size...
+#define SPEC_MIN_LIMIT (8u << 20)          // ...but never below this (one block can inflate past it)
+#define RAW_READ_SIZE (1u << 20)
+#define TAIL_MARGIN (256u << 10)           // Minimum input past a chunk's end handed to its worker
+#define FAST_BITS 10
+
+// Bit-level inflate with unknown-window markers
+
+typedef struct BitReader {
+    const uint8_t *data;
+    size_t size;
+    size_t pos;       // Next byte to load (may run past size: zeros are loaded)
+    uint64_t buf;
+    unsigned count;
+} BitReader;
+
+static void br_init(BitReader *br, const uint8_t *data, size_t size, uint64_t bit) {
+    br->data = data;
+    br->size = size;
+    br->pos = (size_t)(bit >> 3);
+    br->buf = 0;
+    br->count = 0;
+    unsigned skip = (unsigned)(bit & 7);
+    if (skip) {
+        br->buf = br->pos < size ? (uint64_t)(data[br->pos] >> skip) : 0;
+        br->count = 8 - skip;
+        br->pos++;
+    }
+}
+
+static inline uint64_t br_tell(const BitReader *br) {
+    return (uint64_t)br->pos * 8 - br->count;
+}
+
+static inline void br_refill(BitReader *br) {
+    if (br->pos + 8 <= br->size) {
+        uint64_t word;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        memcpy(&word, br->data + br->pos, 8);
+#else
+        word = 0;
+        for (unsigned i = 0; i < 8; i++) {
+            word |= (uint64_t)br->data[br->pos + i] << (8 * i);
+        }
+#endif
+        unsigned take = (63 - br->count) >> 3;
+        br->buf |= word << br->count;
+        br->pos += take;
+        br->count += take * 8;
+        br->buf &= (1ull << br->count) - 1;
+        return;
+    }
+    while (br->count <= 56) {
+        uint64_t byte = br->pos < br->size ? br->data[br->pos] : 0;
+        br->buf |= byte << br->count;
+        br->pos++;
+        br->count += 8;
+    }
+}
+
+static inline bool br_overrun(const BitReader *br) {
+    return br_tell(br) > (uint64_t)br->size * 8;
+}
+
+// Callers refill first; at most 32 bits per call
+static inline uint32_t br_bits(BitReader *br, unsigned n) {
+    uint32_t v = (uint32_t)(br->buf & ((1ull << n) - 1));
+    br->buf >>= n;
+    br->count -= n;
+    return v;
+}
+
+typedef struct Huffman {
+    uint16_t fast[1 << FAST_BITS];  // (symbol << 4) | length, 0 = longer code or unused
+    uint16_t count[16];
+    uint16_t symbol[288];
+} Huffman;
+
+/**
+ * Build a canonical Huffman decoder. Follows zlib's acceptance rules:
+ * over-subscribed codes are rejected, incomplete ones only pass when they
+ * consist of a single one-bit code (or no code at all, where allowed).
+ */
+static int huffman_build(Huffman *h, const uint8_t *lengths, unsigned n, bool complete_only) {
+    memset(h->count, 0, sizeof(h->count));
+    for (unsigned s = 0; s < n; s++) {
+        h->count[lengths[s]]++;
+    }
+    h->count[0] = 0;
+    int left = 1;
+    unsigned max = 0;
+    for (unsigned len = 1; len < 16; len++) {
+        left <<= 1;
+        left -= h->count[len];
+        if (left < 0) {
+            return -1;
+        }
+        if (h->count[len]) {
+            max = len;
+        }
+    }
+    if (max == 0) {
+        if (complete_only) {
+            return -1;
+        }
+    } else if (left > 0 && (complete_only || max != 1)) {
+        return -1;
+    }
+
+    uint16_t offs[16];
+    uint16_t next_code[16];
+    offs[1] = 0;
+    for (unsigned len = 1; len < 15; len++) {
+        offs[len + 1] = offs[len] + h->count[len];
+    }
+    unsigned code = 0;
+    for (unsigned len = 1; len < 16; len++) {
+        code = (code + h->count[len - 1]) << 1;
+        next_code[len] = (uint16_t)code;
+    }
+
+    memset(h->fast, 0, sizeof(h->fast));
+    for (unsigned s = 0; s < n; s++) {
+        unsigned len = lengths[s];
+        if (!len) {
+            continue;
+        }
+        h->symbol[offs[len]++] = (uint16_t)s;
+        unsigned c = next_code[len]++;
+        if (len <= FAST_BITS) {
+            unsigned rev = 0;
+            for (unsigned i = 0; i < len; i++) {
+                rev |= ((c >> i) & 1u) << (len - 1 - i);
+            }
+            for (unsigned i = rev; i < (1u << FAST_BITS); i += 1u << len) {
+                h->fast[i] = (uint16_t)((s << 4) | len);
+            }
+        }
+    }
+    return 0;
+}
+
+// Callers refill first. Returns the symbol, or -1 for an unused code.
+static inline int huffman_decode(BitReader *br, const Huffman *h) {
+    uint16_t e = h->fast[br->buf & ((1u << FAST_BITS) - 1)];
+    if (e) {
+        br_bits(br, e & 15);
+        return e >> 4;
+    }
+    int code = 0, first = 0, index = 0;
+    uint64_t bits = br->buf;
+    for (unsigned len = 1; len < 16; len++) {
+        code |= (int)(bits & 1);
+        bits >>= 1;
+        int count = h->count[len];
+        if (code - count < first) {
+            br_bits(br, len);
+            return h->symbol[index + (code - first)];
+        }
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+static const uint16_t length_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t length_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t dist_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const uint8_t codelen_order[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+typedef struct BlockTables {
+    Huffman lit;
+    Huffman dist;
+} BlockTables;
+
+static void build_fixed(BlockTables *t) {
+    uint8_t lengths[320];
+    unsigned s = 0;
+    for (; s < 144; s++) lengths[s] = 8;
+    for (; s < 256; s++) lengths[s] = 9;
+    for (; s < 280; s++) lengths[s] = 7;
+    for (; s < 288; s++) lengths[s] = 8;
+    for (; s < 320; s++) lengths[s] = 5;
+    huffman_build(&t->lit, lengths, 288, false);
+    huffman_build(&t->dist, lengths + 288, 32, false);  // 30 and 31 decode but are rejected
+}
+
+/**
+ * Read a dynamic block header (after the three type bits) into tables.
+ * Returns 0, or -1 if it is not a valid header.
+ */
+static int read_dynamic_header(BitReader *br, BlockTables *t) {
+    br_refill(br);
+    unsigned hlit = br_bits(br, 5) + 257;
+    unsigned hdist = br_bits(br, 5) + 1;
+    unsigned hclen = br_bits(br, 4) + 4;
+    if (hlit > 286 || hdist > 30) {
+        return -1;
+    }
+    uint8_t cl_lengths[19] = {0};
+    for (unsigned i = 0; i < hclen; i++) {
+        if (i % 16 == 0) {
+            br_refill(br);  // Up to 57 bits: more than one refill guarantees
+        }
+        cl_lengths[codelen_order[i]] = (uint8_t)br_bits(br, 3);
+    }
+    Huffman cl;
+    if (huffman_build(&cl, cl_lengths, 19, true) < 0) {
+        return -1;
+    }
+
+    uint8_t lengths[316];
+    unsigned n = 0;
+    while (n < hlit + hdist) {
+        br_refill(br);
+        int sym = huffman_decode(br, &cl);
+        if (sym < 0) {
+            return -1;
+        }
+        if (sym < 16) {
+            lengths[n++] = (uint8_t)sym;
+            continue;
+        }
+        uint8_t value = 0;
+        unsigned repeat;
+        if (sym == 16) {
+            if (n == 0) {
+                return -1;
+            }
+            value = lengths[n - 1];
+            repeat = 3 + br_bits(br, 2);
+        } else if (sym == 17) {
+            repeat = 3 + br_bits(br, 3);
+        } else {
+            repeat = 11 + br_bits(br, 7);
+        }
+        if (n + repeat > hlit + hdist) {
+            return -1;
+        }
+        memset(lengths + n, value, repeat);
+        n += repeat;
+    }
+    if (br_overrun(br) || lengths[256] == 0) {
+        return -1;
+    }
+    if (huffman_build(&t->lit, lengths, hlit, false) < 0 ||
+        huffman_build(&t->dist, lengths + hlit, hdist, false) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Output of one speculative chunk: `wide` symbols (bytes or markers) first,
+ * then plain bytes from bytes[bytes_off]. Plain mode starts with the last
+ * 32 KiB of wide output (all literal by then) as a prefix for matches.
+ */
+typedef struct SpecOutput {
+    uint16_t *wide;
+    size_t wide_len;
+    size_t wide_cap;
+    size_t clean_from;   // Index just past the last marker in wide
+    uint8_t *bytes;
+    size_t bytes_len;
+    size_t bytes_cap;
+    size_t bytes_off;
+    bool narrow;
+    size_t limit;        // Maximum symbols (wide + plain)
+} SpecOutput;
+
+static int spec_reserve(SpecOutput *o) {
+    const size_t need = 258;
+    if (!o->narrow) {
+        if (o->wide_cap - o->wide_len >= need) {
+            return 0;
+        }
+        if (o->wide_len > o->limit) {
+            return ENOBUFS;
+        }
+        size_t cap = o->wide_cap ? o->wide_cap * 2 : 65536;
+        uint16_t *grown = realloc(o->wide, cap * sizeof(uint16_t));
+        if (!grown) {
+            return ENOMEM;
+        }
+        o->wide = grown;
+        o->wide_cap = cap;
+        return 0;
+    }
+    if (o->bytes_cap - o->bytes_len >= need) {
+        return 0;
+    }
+    if (o->wide_len + (o->bytes_len - o->bytes_off) > o->limit) {
+        return ENOBUFS;
+    }
+    size_t cap = o->bytes_cap ? o->bytes_cap * 2 : (1u << 20);
+    uint8_t *grown = realloc(o->bytes, cap);
+    if (!grown) {
+        return ENOMEM;
+    }
+    o->bytes = grown;
+    o->bytes_cap = cap;
+    return 0;
+}
+
+// Leave wide mode once the last 32 KiB are marker-free
+static int spec_maybe_narrow(SpecOutput *o) {
+    if (o->narrow || o->wide_len - o->clean_from < WINDOW_SIZE) {
+        return 0;
+    }
+    o->bytes_cap = (size_t)WINDOW_SIZE * 4;
+    o->bytes = malloc(o->bytes_cap);
+    if (!o->bytes) {
+        return ENOMEM;
+    }
+    const uint16_t *tail = o->wide + o->wide_len - WINDOW_SIZE;
+    for (size_t i = 0; i < WINDOW_SIZE; i++) {
+        o->bytes[i] = (uint8_t)tail[i];
+    }
+    o->bytes_len = WINDOW_SIZE;
+    o->bytes_off = WINDOW_SIZE;
+    o->narrow = true;
+    return 0;
+}
+
+// Plain-byte variant of spec_block_body() below: the bulk of every chunk
+static int plain_block_body(BitReader *br, const BlockTables *t, SpecOutput *o) {
+    size_t n = o->bytes_len;
+    for (;;) {
+        if (o->bytes_cap - n < 258) {
+            o->bytes_len = n;
+            int err = spec_reserve(o);
+            if (err) {
+                return err;
+            }
+        }
+        uint8_t *out = o->bytes;
+        br_refill(br);
+        int sym = huffman_decode(br, &t->lit);
+        if (sym < 256) {
+            if (sym < 0) {
+                return EINVAL;
+            }
+            out[n++] = (uint8_t)sym;
+            continue;
+        }
+        if (sym == 256) {
+            // Garbage running off the input is also bounded by the output limit
+            o->bytes_len = n;
+            return br_overrun(br) ? ENODATA : 0;
+        }
+        sym -= 257;
+        if (sym >= 29) {
+            return EINVAL;
+        }
+        unsigned len = length_base[sym] + br_bits(br, length_extra[sym]);
+        int dsym = huffman_decode(br, &t->dist);
+        if (dsym < 0 || dsym >= 30) {
+            return EINVAL;
+        }
+        size_t dist = dist_base[dsym] + br_bits(br, dist_extra[dsym]);
+        if (dist > n) {
+            return EINVAL;
+        }
+        uint8_t *dst = out + n;
+        const uint8_t *src = dst - dist;
+        if (dist >= len) {
+            memcpy(dst, src, len);
+        } else {
+            for (unsigned i = 0; i < len; i++) {
+                dst[i] = src[i];
+            }
+        }
+        n += len;
+    }
+}
+
+/**
+ * Decode one block body. `markers` permits references before the chunk
+ * start (speculative decode); without it they are errors (known start).
+ * Switches to plain_block_body() once the window is marker-free.
+ * Returns 0 at end-of-block, else an errno-style code.
+ */
+static int spec_block_body(BitReader *br, const BlockTables *t, SpecOutput *o, bool markers) {
+    while (!o->narrow) {
+        int err = spec_reserve(o);
+        if (err) {
+            return err;
+        }
+        br_refill(br);
+        int sym = huffman_decode(br, &t->lit);
+        if (sym < 0) {
+            return EINVAL;
+        }
+        if (sym < 256) {
+            o->wide[o->wide_len++] = (uint16_t)sym;
+        } else if (sym == 256) {
+            return br_overrun(br) ? ENODATA : 0;
+        } else {
+            sym -= 257;
+            if (sym >= 29) {
+                return EINVAL;
+            }
+            unsigned len = length_base[sym] + br_bits(br, length_extra[sym]);
+            int dsym = huffman_decode(br, &t->dist);
+            if (dsym < 0 || dsym >= 30) {
+                return EINVAL;
+            }
+            size_t dist = dist_base[dsym] + br_bits(br, dist_extra[dsym]);
+            size_t pos = o->wide_len;
+            if (dist > pos && (!markers || dist > pos + WINDOW_SIZE)) {
+                return EINVAL;
+            }
+            for (unsigned i = 0; i < len; i++) {
+                uint16_t v;
+                if (dist > pos + i) {
+                    v = (uint16_t)(MARKER_BASE + WINDOW_SIZE - (dist - pos - i));
+                } else {
+                    v = o->wide[pos + i - dist];
+                }
+                if (v >= MARKER_BASE) {
+                    o->clean_from = pos + i + 1;
+                }
+                o->wide[pos + i] = v;
+            }
+            o->wide_len += len;
+        }
+        if (br_overrun(br)) {
+            return ENODATA;
+        }
+        err = spec_maybe_narrow(o);
+        if (err) {
+            return err;
+        }
+    }
+    return plain_block_body(br, t, o);
+}
+
+static int spec_stored_body(BitReader *br, SpecOutput *o) {
+    uint64_t bit = (br_tell(br) + 7) & ~(uint64_t)7;
+    size_t at = (size_t)(bit >> 3);
+    if (at + 4 > br->size) {
+        return ENODATA;
+    }
+    unsigned len = br->data[at] | (br->data[at + 1] << 8);
+    unsigned nlen = br->data[at + 2] | (br->data[at + 3] << 8);
+    if (len != (~nlen & 0xffffu)) {
+        return EINVAL;
+    }
+    at += 4;
+    if (at + len > br->size) {
+        return ENODATA;
+    }
+    const uint8_t *src = br->data + at;
+    for (unsigned done = 0; done < len;) {
+        int err = spec_reserve(o);
+        if (err) {
+            return err;
+        }
+        unsigned take = len - done < 258 ? len - done : 258;
+        if (o->narrow) {
+            memcpy(o->bytes + o->bytes_len, src + done, take);
+            o->bytes_len += take;
+        } else {
+            for (unsigned i = 0; i < take; i++) {
+                o->wide[o->wide_len++] = src[done + i];
+            }
+            err = spec_maybe_narrow(o);
+            if (err) {
+                return err;
+            }
+        }
+        done += take;
+    }
+    br_init(br, br->data, br->size, (uint64_t)(at + len) * 8);
+    return 0;
+}
+
+/**
+ * Decode blocks from `start` until a block boundary at or past `stop`
+ * (relative bits) or the end of the final block.
+ */
+static int spec_decode(const uint8_t *in, size_t in_len, uint64_t start, uint64_t stop,
+                       bool markers, SpecOutput *o, uint64_t *end, bool *final) {
+    BitReader br;
+    br_init(&br, in, in_len, start);
+    BlockTables *t = malloc(sizeof(*t));
+    if (!t) {
+        return ENOMEM;
+    }
+    int err = 0;
+    *final = false;
+    for (;;) {
+        if (br_tell(&br) >= stop) {
+            break;
+        }
+        br_refill(&br);
+        bool last = br_bits(&br, 1);
+        unsigned type = br_bits(&br, 2);
+        if (type == 0) {
+            err = spec_stored_body(&br, o);
+        } else if (type == 1) {
+            build_fixed(t);
+            err = spec_block_body(&br, t, o, markers);
+        } else if (type == 2) {
+            err = read_dynamic_header(&br, t) < 0 ? EINVAL : 0;
+            if (!err) {
+                err = spec_block_body(&br, t, o, markers);
+            }
+        } else {
+            err = EINVAL;
+        }
+        if (err) {
+            break;
+        }
+        if (last) {
+            *final = true;
+            break;
+        }
+    }
+    *end = br_tell(&br);
+    free(t);
+    return err;
+}
+
+/**
+ * Check whether a non-final block plausibly starts at relative bit `b`: a
+ * dynamic header with valid code trees, or a stored header whose LEN/NLEN
+ * match.
+ */
+static bool block_candidate(const uint8_t *in, size_t in_len, uint64_t b, BlockTables *scratch) {
+    BitReader br;
+    br_init(&br, in, in_len, b);
+    br_refill(&br);
+    uint64_t head = br.buf;
+    // A final block is at most one per stream; accepting them mostly admits noise
+    if (head & 1) {
+        return false;
+    }
+    unsigned type = (unsigned)(head >> 1) & 3;
+    if (type == 0) {
+        size_t at = (size_t)((b + 3 + 7) >> 3);
+        if (at + 4 > in_len) {
+            return false;
+        }
+        unsigned len = in[at] | (in[at + 1] << 8);
+        unsigned nlen = in[at + 2] | (in[at + 3] << 8);
+        return len == (~nlen & 0xffffu);
+    }
+    if (type != 2) {
+        return false;
+    }
+    // Cheap rejections before building anything: HLIT <= 29, HDIST <= 29
+    if (((head >> 3) & 31) > 29 || ((head >> 8) & 31) > 29) {
+        return false;
+    }
+    br_bits(&br, 3);
+    return read_dynamic_header(&br, scratch) == 0;
+}
+
+// Chunks and workers
+
+typedef struct InflateChunk {
+    struct InflateChunk *next;   // Work queue link
+    uint64_t index;
+    uint8_t *in;                 // Compressed bytes from `base` through a margin past the chunk
+    size_t in_len;
+    uint64_t base;               // Compressed offset of in[0]
+    uint64_t search_end;         // Relative bits: candidates are searched below this
+    uint64_t stop;               // Relative bits: first block boundary at or past this ends the chunk
+    bool known_start;            // Decode from search start bit 0 with an empty window
+    uint64_t known_bit;
+    size_t limit;
+    // Results
+    bool done;
+    int error;
+    uint64_t start;              // Relative bit where decoding began
+    uint64_t end;
+    bool final;
+    SpecOutput out;
+    uint32_t bytes_crc;          // CRC-32 of the plain part
+} InflateChunk;
+
+static void chunk_free(InflateChunk *c) {
+    if (!c) {
+        return;
+    }
+    free(c->in);
+    free(c->out.wide);
+    free(c->out.bytes);
+    free(c);
+}
+
+static void spec_reset(SpecOutput *o, size_t limit) {
+    free(o->wide);
+    free(o->bytes);
+    memset(o, 0, sizeof(*o));
+    o->limit = limit;
+}
+
+static void chunk_decode(InflateChunk *c) {
+    uint64_t end;
+    bool final;
+    if (c->known_start) {
+        spec_reset(&c->out, c->limit);
+        // A known start has an empty window: go straight to plain bytes
+        c->out.narrow = true;
+        c->error = spec_decode(c->in, c->in_len, c->known_bit, c->stop, false, &c->out, &end, &final);
+        c->start = c->known_bit;
+    } else {
+        BlockTables *scratch = malloc(sizeof(*scratch));
+        c->error = scratch ? ENOENT : ENOMEM;
+        uint64_t limit = c->search_end < (uint64_t)c->in_len * 8 ? c->search_end : (uint64_t)c->in_len * 8;
+        for (uint64_t b = 0; scratch && b < limit; b++) {
+            if (!block_candidate(c->in, c->in_len, b, scratch)) {
+                continue;
+            }
+            spec_reset(&c->out, c->limit);
+            int err = spec_decode(c->in, c->in_len, b, c->stop, true, &c->out, &end, &final);
+            if (err == 0) {
+                c->error = 0;
+                c->start = b;
+                break;
+            }
+            if (err == ENOMEM) {
+                c->error = err;
+                break;
+            }
+        }
+        free(scratch);
+    }
+    if (c->error == 0) {
+        c->end = end;
+        c->final = final;
+        if (c->out.narrow) {
+            c->bytes_crc = (uint32_t)crc32(0L, c->out.bytes + c->out.bytes_off,
+                                           (uInt)(c->out.bytes_len - c->out.bytes_off));
+        } else {
+            c->bytes_crc = 0;
+        }
+    } else {
+        spec_reset(&c->out, 0);
+    }
+    // The compressed copy is only needed by the worker
+    free(c->in);
+    c->in = NULL;
+}
+
+typedef struct ParallelInflateData {
+    ArcStream *underlying;
+    bool owns_underlying;
+    bool gzip;
+    size_t chunk_size;
+    unsigned inflight;           // Chunks dispatched ahead of the stitch position
+
+    // Workers
+    unsigned thread_count;
+    pthread_t threads[MAX_THREADS];
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t finished;
+    InflateChunk *head;
+    InflateChunk *tail;
+    bool shutdown;
+
+    // Compressed bytes [raw_base, raw_base + raw_len) read so far
+    uint8_t *raw;
+    size_t raw_len;
+    size_t raw_cap;
+    uint64_t raw_base;
+    bool raw_eof;
+
+    InflateChunk **ring;         // Dispatched chunks, by index % ring_size
+    unsigned ring_size;
+    uint64_t next_dispatch;
+    uint64_t first_chunk;        // Chunk holding the start of the first member
+
+    // Stitching
+    bool started;
+    bool eof;
+    bool member_ended;           // pos sits after a final block
+    uint64_t pos;                // Absolute bit offset of the next block
+    uint8_t window[WINDOW_SIZE]; // Circular: last window_len output bytes end at window_pos
+    size_t window_pos;
+    size_t window_len;
+    uint32_t crc;
+    uint64_t member_size;
+
+    // Serving a speculative chunk
+    InflateChunk *serving;
+    uint8_t *resolved;           // Wide part with markers replaced
+    size_t serve_off;
+
+    // Serial zlib decode of a stretch the speculation could not cover
+    bool serial;
+    bool zs_ready;
+    z_stream zs;
+    uint64_t serial_in;          // Absolute offset of the next byte to feed
+    uint64_t serial_target;      // Stop at the first boundary at or past this bit
+
+    int error;                   // Sticky errno once decoding failed
+} ParallelInflateData;
+
+static void *worker_main(void *arg) {
+    ParallelInflateData *d = arg;
+    pthread_mutex_lock(&d->lock);
+    for (;;) {
+        while (!d->head && !d->shutdown) {
+            pthread_cond_wait(&d->work, &d->lock);
+        }
+        if (d->shutdown) {
+            break;
+        }
+        InflateChunk *c = d->head;
+        d->head = c->next;
+        if (!d->head) {
+            d->tail = NULL;
+        }
+        pthread_mutex_unlock(&d->lock);
+        chunk_decode(c);
+        pthread_mutex_lock(&d->lock);
+        c->done = true;
+        pthread_cond_broadcast(&d->finished);
+    }
+    pthread_mutex_unlock(&d->lock);
+    return NULL;
+}
+
+// Stitching
+
+static int raw_fill(ParallelInflateData *d, uint64_t end) {
+    while (!d->raw_eof && d->raw_base + d->raw_len < end) {
+        if (d->raw_cap - d->raw_len < RAW_READ_SIZE) {
+            size_t cap = d->raw_cap ? d->raw_cap * 2 : d->chunk_size * 2 + RAW_READ_SIZE;
+            while (cap - d->raw_len < RAW_READ_SIZE) {
+                cap *= 2;
+            }
+            uint8_t *grown = realloc(d->raw, cap);
+            if (!grown) {
+                errno = ENOMEM;
+                return -1;
+            }
+            d->raw = grown;
+            d->raw_cap = cap;
+        }
+        ssize_t got = arc_stream_read(d->underlying, d->raw + d->raw_len, RAW_READ_SIZE);
+        if (got < 0) {
+            return -1;
+        }
+        if (got == 0) {
+            d->raw_eof = true;
+        }
+        d->raw_len += (size_t)got;
+    }
+    return 0;
+}
+
+static uint64_t raw_end(const ParallelInflateData *d) {
+    return d->raw_base + d->raw_len;
+}
+
+// Drop compressed bytes no longer needed by the stitcher or by dispatch
+static void raw_compact(ParallelInflateData *d) {
+    // One byte of slack: chunk_matches() may look at the header bits just before pos
+    uint64_t keep = d->pos >> 3 ? (d->pos >> 3) - 1 : 0;
+    uint64_t dispatch_start = d->next_dispatch * d->chunk_size;
+    if (dispatch_start < keep) {
+        keep = dispatch_start;
+    }
+    if (d->serial && d->serial_in < keep) {
+        keep = d->serial_in;
+    }
+    if (keep <= d->raw_base || keep - d->raw_base < d->chunk_size) {
+        return;
+    }
+    size_t drop = (size_t)(keep - d->raw_base);
+    if (drop > d->raw_len) {
+        drop = d->raw_len;
+    }
+    memmove(d->raw, d->raw + drop, d->raw_len - drop);
+    d->raw_len -= drop;
+    d->raw_base += drop;
+}
+
+static int dispatch_chunks(ParallelInflateData *d) {
+    uint64_t current = (d->pos >> 3) / d->chunk_size;
+    if (d->next_dispatch < current) {
+        d->next_dispatch = current;  // A long block jumped past undispatched chunks
+    }
+    while (d->next_dispatch < current + d->inflight) {
+        uint64_t k = d->next_dispatch;
+        uint64_t start = k * d->chunk_size;
+        uint64_t next = start + d->chunk_size;
+        // The last block may run well past the next chunk start
+        uint64_t tail = next + (d->chunk_size > TAIL_MARGIN ? d->chunk_size : TAIL_MARGIN);
+        if (raw_fill(d, tail) < 0) {
+            return -1;
+        }
+        bool known = k == d->first_chunk;
+        uint64_t base = known ? (d->pos >> 3) : start;
+        if (base >= raw_end(d)) {
+            break;  // Past the end of the input
+        }
+        uint64_t until = tail < raw_end(d) ? tail : raw_end(d);
+        bool last = next >= raw_end(d);
+
+        InflateChunk *c = calloc(1, sizeof(*c));
+        if (!c) {
+            errno = ENOMEM;
+            return -1;
+        }
+        c->index = k;
+        c->base = base;
+        c->in_len = (size_t)(until - base);
+        c->in = malloc(c->in_len ? c->in_len : 1);
+        if (!c->in) {
+            free(c);
+            errno = ENOMEM;
+            return -1;
+        }
+        memcpy(c->in, d->raw + (base - d->raw_base), c->in_len);
+        c->known_start = known;
+        c->known_bit = known ? (d->pos & 7) : 0;
+        c->search_end = (next - base) * 8;
+        c->stop = last ? UINT64_MAX : (next - base) * 8;
+        c->limit = d->chunk_size * SPEC_MAX_RATIO > SPEC_MIN_LIMIT ? d->chunk_size * SPEC_MAX_RATIO : SPEC_MIN_LIMIT;
+
+        d->ring[k % d->ring_size] = c;
+        d->next_dispatch++;
+        pthread_mutex_lock(&d->lock);
+        if (d->tail) {
+            d->tail->next = c;
+        } else {
+            d->head = c;
+        }
+        d->tail = c;
+        pthread_cond_signal(&d->work);
+        pthread_mutex_unlock(&d->lock);
+    }
+    raw_compact(d);
+    return 0;
+}
+
+static void wait_chunk(ParallelInflateData *d, InflateChunk *c) {
+    pthread_mutex_lock(&d->lock);
+    while (!c->done) {
+        pthread_cond_wait(&d->finished, &d->lock);
+    }
+    pthread_mutex_unlock(&d->lock);
+}
+
+// Release dispatched chunks that lie wholly before the stitch position
+static void retire_chunks(ParallelInflateData *d, uint64_t below) {
+    for (unsigned i = 0; i < d->ring_size; i++) {
+        InflateChunk *c = d->ring[i];
+        if (!c || c == d->serving || c->index >= below) {
+            continue;
+        }
+        // Still queued: unlink it rather than wait for a worker to pick it up
+        bool queued = false;
+        pthread_mutex_lock(&d->lock);
+        for (InflateChunk **link = &d->head, *prev = NULL; *link; prev = *link, link = &(*link)->next) {
+            if (*link == c) {
+                *link = c->next;
+                if (d->tail == c) {
+                    d->tail = prev;
+                }
+                queued = true;
+                break;
+            }
+        }
+        pthread_mutex_unlock(&d->lock);
+        if (!queued) {
+            wait_chunk(d, c);
+        }
+        chunk_free(c);
+        d->ring[i] = NULL;
+    }
+}
+
+static void window_push(ParallelInflateData *d, const uint8_t *data, size_t len) {
+    if (len >= WINDOW_SIZE) {
+        memcpy(d->window, data + len - WINDOW_SIZE, WINDOW_SIZE);
+        d->window_pos = 0;
+        d->window_len = WINDOW_SIZE;
+        return;
+    }
+    size_t first = WINDOW_SIZE - d->window_pos < len ? WINDOW_SIZE - d->window_pos : len;
+    memcpy(d->window + d->window_pos, data, first);
+    memcpy(d->window, data + first, len - first);
+    d->window_pos = (d->window_pos + len) % WINDOW_SIZE;
+    d->window_len = d->window_len + len > WINDOW_SIZE ? WINDOW_SIZE : d->window_len + len;
+}
+
+// Linear copy of the window; the last byte lands at out[WINDOW_SIZE - 1]
+static void window_linear(const ParallelInflateData *d, uint8_t *out) {
+    for (size_t i = 0; i < d->window_len; i++) {
+        size_t from = (d->window_pos + WINDOW_SIZE - d->window_len + i) % WINDOW_SIZE;
+        out[WINDOW_SIZE - d->window_len + i] = d->window[from];
+    }
+}
+
+static int raw_bit(ParallelInflateData *d, uint64_t bit) {
+    uint64_t at = bit >> 3;
+    if (raw_fill(d, at + 1) < 0 || at < d->raw_base || at >= raw_end(d)) {
+        return -1;
+    }
+    return (d->raw[at - d->raw_base] >> (bit & 7)) & 1;
+}
+
+/**
+ * Does chunk c reproduce the true decode from d->pos? Exact start match,
+ * or both start with the same stored block (which may hide behind a few
+ * ambiguous zero header/padding bits).
+ */
+static bool chunk_matches(ParallelInflateData *d, const InflateChunk *c) {
+    if (c->error) {
+        return false;
+    }
+    uint64_t start = c->base * 8 + c->start;
+    if (start == d->pos) {
+        return true;
+    }
+    if (c->known_start) {
+        return false;
+    }
+    uint64_t data_at = (start + 3 + 7) >> 3;
+    if (((d->pos + 3 + 7) >> 3) != data_at) {
+        return false;
+    }
+    // The finder only takes non-final headers, so pos must hold 000 too
+    for (uint64_t i = 0; i < 3; i++) {
+        if (raw_bit(d, start + i) != 0 || raw_bit(d, d->pos + i) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int start_serving(ParallelInflateData *d, InflateChunk *c) {
+    SpecOutput *o = &c->out;
+    uint8_t *resolved = NULL;
+    if (o->wide_len > 0) {
+        uint8_t linear[WINDOW_SIZE];
+        window_linear(d, linear);
+        size_t lowest = WINDOW_SIZE - d->window_len;
+        resolved = malloc(o->wide_len);
+        if (!resolved) {
+            errno = ENOMEM;
+            return -1;
+        }
+        for (size_t i = 0; i < o->wide_len; i++) {
+            uint16_t v = o->wide[i];
+            if (v < MARKER_BASE) {
+                resolved[i] = (uint8_t)v;
+            } else if ((size_t)(v - MARKER_BASE) >= lowest) {
+                resolved[i] = linear[v - MARKER_BASE];
+            } else {
+                free(resolved);
+                errno = EINVAL;  // Reference before the start of the stream
+                return -1;
+            }
+        }
+        uint32_t crc = (uint32_t)crc32(0L, resolved, (uInt)o->wide_len);
+        d->crc = (uint32_t)crc32_combine(d->crc, crc, (z_off_t)o->wide_len);
+        window_push(d, resolved, o->wide_len);
+    }
+    size_t plain = o->narrow ? o->bytes_len - o->bytes_off : 0;
+    if (plain > 0) {
+        d->crc = (uint32_t)crc32_combine(d->crc, c->bytes_crc, (z_off_t)plain);
+        window_push(d, o->bytes + o->bytes_off, plain);
+    }
+    d->member_size += o->wide_len + plain;
+    d->serving = c;
+    d->resolved = resolved;
+    d->serve_off = 0;
+    return 0;
+}
+
+static size_t serve(ParallelInflateData *d, uint8_t *out, size_t n) {
+    InflateChunk *c = d->serving;
+    SpecOutput *o = &c->out;
+    size_t plain = o->narrow ? o->bytes_len - o->bytes_off : 0;
+    size_t total = o->wide_len + plain;
+    size_t done = 0;
+    while (done < n && d->serve_off < total) {
+        size_t take;
+        if (d->serve_off < o->wide_len) {
+            take = o->wide_len - d->serve_off;
+            take = take < n - done ? take : n - done;
+            memcpy(out + done, d->resolved + d->serve_off, take);
+        } else {
+            size_t at = d->serve_off - o->wide_len;
+            take = plain - at;
+            take = take < n - done ? take : n - done;
+            memcpy(out + done, o->bytes + o->bytes_off + at, take);
+        }
+        done += take;
+        d->serve_off += take;
+    }
+    if (d->serve_off == total) {
+        d->pos = c->base * 8 + c->end;
+        d->member_ended = c->final;
+        free(d->resolved);
+        d->resolved = NULL;
+        d->serving = NULL;
+        d->ring[c->index % d->ring_size] = NULL;
+        chunk_free(c);
+    }
+    return done;
+}
+
+static int start_serial(ParallelInflateData *d, uint64_t target) {
+    if (!d->zs_ready) {
+        memset(&d->zs, 0, sizeof(d->zs));
+        if (inflateInit2(&d->zs, -MAX_WBITS) != Z_OK) {
+            errno = ENOMEM;
+            return -1;
+        }
+        d->zs_ready = true;
+    } else if (inflateReset(&d->zs) != Z_OK) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (d->window_len > 0) {
+        uint8_t linear[WINDOW_SIZE];
+        window_linear(d, linear);
+        inflateSetDictionary(&d->zs, linear + WINDOW_SIZE - d->window_len, (uInt)d->window_len);
+    }
+    uint64_t at = d->pos >> 3;
+    unsigned skip = (unsigned)(d->pos & 7);
+    if (skip) {
+        if (raw_fill(d, at + 1) < 0) {
+            return -1;
+        }
+        if (at >= raw_end(d)) {
+            errno = EINVAL;  // Truncated
+            return -1;
+        }
+        inflatePrime(&d->zs, (int)(8 - skip), d->raw[at - d->raw_base] >> skip);
+        at++;
+    }
+    d->serial_in = at;
+    d->serial_target = target;
+    d->serial = true;
+    return 0;
+}
+
+static ssize_t serial_step(ParallelInflateData *d, uint8_t *out, size_t n) {
+    z_stream *zs = &d->zs;
+    zs->next_out = out;
+    zs->avail_out = (uInt)(n > UINT32_MAX ? UINT32_MAX : n);
+    size_t room = zs->avail_out;
+    while (zs->avail_out > 0) {
+        if (d->serial_in >= raw_end(d)) {
+            if (raw_fill(d, d->serial_in + RAW_READ_SIZE) < 0) {
+                return -1;
+            }
+        }
+        size_t avail = (size_t)(raw_end(d) - d->serial_in);
+        zs->next_in = d->raw + (d->serial_in - d->raw_base);
+        zs->avail_in = (uInt)(avail > UINT32_MAX ? UINT32_MAX : avail);
+        uInt in_before = zs->avail_in;
+        int ret = inflate(zs, Z_BLOCK);
+        d->serial_in += in_before - zs->avail_in;
+        if (ret == Z_STREAM_END) {
+            d->pos = d->serial_in * 8;
+            d->member_ended = true;
+            d->serial = false;
+            break;
+        }
+        if (ret == Z_BUF_ERROR && avail == 0) {
+            errno = EINVAL;  // Input ended inside the deflate stream
+            return -1;
+        }
+        if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            errno = ret == Z_MEM_ERROR ? ENOMEM : EINVAL;
+            return -1;
+        }
+        if ((zs->data_type & 128) && !(zs->data_type & 64)) {
+            uint64_t bit = d->serial_in * 8 - (uint64_t)(zs->data_type & 7);
+            if (bit >= d->serial_target) {
+                d->pos = bit;
+                d->serial = false;
+                break;
+            }
+        }
+    }
+    size_t produced = room - zs->avail_out;
+    if (produced > 0) {
+        d->crc = (uint32_t)crc32(d->crc, out, (uInt)produced);
+        d->member_size += produced;
+        window_push(d, out, produced);
+    }
+    return (ssize_t)produced;
+}
+
+/**
+ * Parse a gzip member header at `at`. Returns 1 with *end set, 0 if no
+ * member starts there (end of input or trailing garbage), -1 on error.
+ */
+static int parse_member_header(ParallelInflateData *d, uint64_t at, uint64_t *end) {
+    if (raw_fill(d, at + 10) < 0) {
+        return -1;
+    }
+    if (at < d->raw_base || raw_end(d) < at + 10) {
+        return 0;
+    }
+    const uint8_t *h = d->raw + (at - d->raw_base);
+    if (h[0] != 0x1f || h[1] != 0x8b) {
+        return 0;
+    }
+    if (h[2] != 8 || (h[3] & 0xe0)) {
+        errno = EINVAL;
+        return -1;
+    }
+    unsigned flags = h[3];
+    uint64_t p = at + 10;
+    if (flags & 0x04) {  // FEXTRA
+        if (raw_fill(d, p + 2) < 0 || raw_end(d) < p + 2) {
+            errno = EINVAL;
+            return -1;
+        }
+        const uint8_t *x = d->raw + (p - d->raw_base);
+        p += 2 + (uint64_t)(x[0] | (x[1] << 8));
+    }
+    for (unsigned bit = 0x08; bit <= 0x10; bit <<= 1) {  // FNAME, FCOMMENT
+        if (!(flags & bit)) {
+            continue;
+        }
+        for (;;) {
+            if (raw_fill(d, p + 1) < 0 || raw_end(d) < p + 1) {
+                errno = EINVAL;
+                return -1;
+            }
+            if (d->raw[p++ - d->raw_base] == 0) {
+                break;
+            }
+        }
+    }
+    if (flags & 0x02) {  // FHCRC
+        p += 2;
+    }
+    if (raw_fill(d, p) < 0 || raw_end(d) < p) {
+        errno = EINVAL;
+        return -1;
+    }
+    *end = p;
+    return 1;
+}
+
+static void begin_member(ParallelInflateData *d, uint64_t bit) {
+    d->pos = bit;
+    d->crc = (uint32_t)crc32(0L, Z_NULL, 0);
+    d->member_size = 0;
+    d->window_len = 0;
+    d->window_pos = 0;
+    d->member_ended = false;
+}
+
+static int finish_member(ParallelInflateData *d) {
+    if (!d->gzip) {
+        d->eof = true;
+        return 0;
+    }
+    uint64_t at = (d->pos + 7) >> 3;
+    if (raw_fill(d, at + 8) < 0) {
+        return -1;
+    }
+    if (raw_end(d) < at + 8) {
+        errno = EINVAL;  // Truncated trailer
+        return -1;
+    }
+    const uint8_t *t = d->raw + (at - d->raw_base);
+    uint32_t crc = (uint32_t)t[0] | ((uint32_t)t[1] << 8) | ((uint32_t)t[2] << 16) | ((uint32_t)t[3] << 24);
+    uint32_t isize = (uint32_t)t[4] | ((uint32_t)t[5] << 8) | ((uint32_t)t[6] << 16) | ((uint32_t)t[7] << 24);
+    if (crc != d->crc || isize != (uint32_t)d->member_size) {
+        errno = EINVAL;
+        return -1;
+    }
+    uint64_t next;
+    int found = parse_member_header(d, at + 8, &next);
+    if (found < 0) {
+        return -1;
+    }
+    if (found == 0) {
+        d->eof = true;
+        return 0;
+    }
+    begin_member(d, next * 8);
+    return 0;
+}
+
+static int begin_stream(ParallelInflateData *d) {
+    uint64_t start = 0;
+    if (d->gzip) {
+        int found = parse_member_header(d, 0, &start);
+        if (found <= 0) {
+            if (found == 0) {
+                errno = EINVAL;
+            }
+            return -1;
+        }
+    }
+    begin_member(d, start * 8);
+    d->first_chunk = start / d->chunk_size;
+    d->next_dispatch = d->first_chunk;
+    d->started = true;
+    return 0;
+}
+
+// At a block boundary: use the speculative chunk if it lines up, else go serial
+static int advance(ParallelInflateData *d) {
+    uint64_t k = (d->pos >> 3) / d->chunk_size;
+    retire_chunks(d, k);
+    if (dispatch_chunks(d) < 0) {
+        return -1;
+    }
+    InflateChunk *c = d->ring[k % d->ring_size];
+    if (c && c->index == k) {
+        wait_chunk(d, c);
+        if (chunk_matches(d, c)) {
+            return start_serving(d, c);
+        }
+    }
+    uint64_t next = (k + 1) * d->chunk_size;
+    if (raw_fill(d, next + 1) < 0) {
+        return -1;
+    }
+    return start_serial(d, next < raw_end(d) ? next * 8 : UINT64_MAX);
+}
+
+static ssize_t pinflate_read(ArcStream *stream, void *buf, size_t n) {
+    ParallelInflateData *d = (ParallelInflateData *)stream->user_data;
+    if (d->error) {
+        errno = d->error;
+        return -1;
+    }
+    if (d->eof) {
+        return 0;
+    }
+    if (stream->byte_limit > 0) {
+        int64_t remaining = stream->byte_limit - stream->bytes_read;
+        if (remaining <= 0) {
+            return 0;  // EOF (limit reached)
+        }
+        if ((int64_t)n > remaining) {
+            n = (size_t)remaining;
+        }
+    }
+
+    uint8_t *out = buf;
+    size_t done = 0;
+    while (done < n && !d->eof) {
+        int rc = 0;
+        if (d->serving) {
+            done += serve(d, out + done, n - done);
+            continue;
+        }
+        if (d->serial) {
+            ssize_t got = serial_step(d, out + done, n - done);
+            if (got < 0) {
+                rc = -1;
+            } else {
+                done += (size_t)got;
+            }
+        } else if (!d->started) {
+            rc = begin_stream(d);
+        } else if (d->member_ended) {
+            rc = finish_member(d);
+        } else {
+            rc = advance(d);
+        }
+        if (rc < 0) {
+            d->error = errno ? errno : EIO;
+            if (done > 0) {
+                break;  // Report the error on the next call
+            }
+            errno = d->error;
+            return -1;
+        }
+    }
+    stream->bytes_read += (int64_t)done;
+    return (ssize_t)done;
+}
+
+static int pinflate_seek(ArcStream *stream, int64_t off, int whence) {
+    (void)stream;
+    (void)off;
+    (void)whence;
+    errno = ESPIPE;
+    return -1;
+}
+
+static int64_t pinflate_tell(ArcStream *stream) {
+    return stream->bytes_read;
+}
+
+static void pinflate_free(ParallelInflateData *d) {
+    pthread_mutex_lock(&d->lock);
+    d->shutdown = true;
+    pthread_cond_broadcast(&d->work);
+    pthread_mutex_unlock(&d->lock);
+    for (unsigned i = 0; i < d->thread_count; i++) {
+        pthread_join(d->threads[i], NULL);
+    }
+    if (d->ring) {
+        for (unsigned i = 0; i < d->ring_size; i++) {
+            chunk_free(d->ring[i]);
+        }
+    }
+    free(d->ring);
+    free(d->resolved);
+    if (d->zs_ready) {
+        inflateEnd(&d->zs);
+    }
+    free(d->raw);
+    pthread_mutex_destroy(&d->lock);
+    pthread_cond_destroy(&d->work);
+    pthread_cond_destroy(&d->finished);
+    if (d->owns_underlying) {
+        arc_stream_close(d->underlying);
+    }
+    free(d);
+}
+
+static void pinflate_close(ArcStream *stream) {
+    pinflate_free((ParallelInflateData *)stream->user_data);
+    free(stream);
+}
+
+static const struct ArcStreamVtable pinflate_vtable = {
+    .read = pinflate_read,
+    .seek = pinflate_seek,
+    .tell = pinflate_tell,
+    .close = pinflate_close,
+};
+
+static ArcStream *pinflate_new(ArcStream *underlying, int64_t byte_limit,
+                               const ArcParallelInflateOptions *opts, bool gzip, bool owned) {
+    if (!underlying) {
+        errno = EINVAL;
+        return NULL;
+    }
+    ParallelInflateData *d = calloc(1, sizeof(*d));
+    ArcStream *stream = calloc(1, sizeof(*stream));
+    if (!d || !stream) {
+        free(d);
+        free(stream);
+        errno = ENOMEM;
+        return NULL;
+    }
+    d->underlying = underlying;
+    d->gzip = gzip;
+    d->chunk_size = opts && opts->chunk_size ? opts->chunk_size : DEFAULT_CHUNK_SIZE;
+    if (d->chunk_size < MIN_CHUNK_SIZE) {
+        d->chunk_size = MIN_CHUNK_SIZE;
+    }
+    long threads = opts && opts->threads ? (long)opts->threads : sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (threads > MAX_THREADS) {
+        threads = MAX_THREADS;
+    }
+    d->inflight = (unsigned)threads + 1;
+    d->ring_size = d->inflight + 2;
+    d->ring = calloc(d->ring_size, sizeof(*d->ring));
+    pthread_mutex_init(&d->lock, NULL);
+    pthread_cond_init(&d->work, NULL);
+    pthread_cond_init(&d->finished, NULL);
+    if (!d->ring) {
+        pinflate_free(d);
+        free(stream);
+        errno = ENOMEM;
+        return NULL;
+    }
+    for (long i = 0; i < threads; i++) {
+        if (pthread_create(&d->threads[d->thread_count], NULL, worker_main, d) != 0) {
+            break;
+        }
+        d->thread_count++;
+    }
+    if (d->thread_count == 0) {
+        pinflate_free(d);
+        free(stream);
+        errno = EAGAIN;
+        return NULL;
+    }
+    d->owns_underlying = owned;
+
+    stream->vtable = &pinflate_vtable;
+    stream->byte_limit = byte_limit;
+    stream->bytes_read = 0;
+    stream->user_data = d;
+    return stream;
+}
+
+ArcStream *arc_filter_gzip_parallel(ArcStream *underlying, int64_t byte_limit,
+                                    const ArcParallelInflateOptions *opts) {
+    return pinflate_new(underlying, byte_limit, opts, true, false);
+}
+
+ArcStream *arc_filter_deflate_parallel(ArcStream *underlying, int64_t byte_limit,
+                                       const ArcParallelInflateOptions *opts) {
+    return pinflate_new(underlying, byte_limit, opts, false, false);
+}
+
+ArcStream *arc_filter_deflate_parallel_owned(ArcStream *underlying, int64_t byte_limit,
+                                             const ArcParallelInflateOptions *opts) {
+    return pinflate_new(underlying, byte_limit, opts, false, true);
+}
+
+bool arc_parallel_inflate_worthwhile_on(int64_t compressed_size, long cpus) {
+    return compressed_size >= ARC_PARALLEL_INFLATE_MIN && cpus >= ARC_PARALLEL_INFLATE_MIN_CPUS;
+}
+
+bool arc_parallel_inflate_worthwhile(int64_t compressed_size) {
+    if (compressed_size < ARC_PARALLEL_INFLATE_MIN) {
+        return false;
+    }
+    return arc_parallel_inflate_worthwhile_on(compressed_size, sysconf(_SC_NPROCESSORS_ONLN));
+}
@@ -0,0 +1,761 @@
+#define _POSIX_C_SOURCE 200809L
+#include "arc_filter.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define MAX_THREADS 64
+#define BLOCKS_PER_THREAD 2       // Blocks read ahead per worker (up to 4 MiB each)
+
+#define LZ4_FRAME_MAGIC      0x184D2204U
+#define LZ4_SKIPPABLE_MAGIC  0x184D2A50U  // Low nibble is free
+#define LZ4_SKIPPABLE_MASK   0xFFFFFFF0U
+#define LZ4_WINDOW           65536        // Match distance limit (history of linked blocks)
+
+// FLG bits of the frame descriptor
+#define FLG_VERSION_MASK     0xC0
+#define FLG_VERSION          0x40
+#define FLG_BLOCK_INDEP      0x20
+#define FLG_BLOCK_CHECKSUM   0x10
+#define FLG_CONTENT_SIZE     0x08
+#define FLG_CONTENT_CHECKSUM 0x04
+#define FLG_RESERVED         0x02
+#define FLG_DICT_ID          0x01
+
+static uint32_t le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t le64(const uint8_t *p) {
+    return (uint64_t)le32(p) | ((uint64_t)le32(p + 4) << 32);
+}
+
+// Read exactly n bytes; returns n, 0 at a clean EOF, -1 on error or short data
+static ssize_t read_full(ArcStream *s, uint8_t *buf, size_t n) {
+    size_t have = 0;
+    while (have < n) {
+        ssize_t got = arc_stream_read(s, buf + have, n - have);
+        if (got < 0) {
+            return -1;
+        }
+        if (got == 0) {
+            if (have == 0) {
+                return 0;
+            }
+            errno = EINVAL;  // Truncated frame
+            return -1;
+        }
+        have += (size_t)got;
+    }
+    return (ssize_t)n;
+}
+
+// XXH32 (frame descriptor, block and content checksums)
+
+#define XXH_PRIME32_1 0x9E3779B1U
+#define XXH_PRIME32_2 0x85EBCA77U
+#define XXH_PRIME32_3 0xC2B2AE3DU
+#define XXH_PRIME32_4 0x27D4EB2FU
+#define XXH_PRIME32_5 0x165667B1U
+
+typedef struct Xxh32 {
+    uint32_t v[4];
+    uint64_t total;
+    uint8_t buf[16];
+    size_t buf_len;
+} Xxh32;
+
+static inline uint32_t rotl32(uint32_t x, int r) {
+    return (x << r) | (x >> (32 - r));
+}
+
+static inline uint32_t xxh32_round(uint32_t acc, uint32_t input) {
+    acc += input * XXH_PRIME32_2;
+    return rotl32(acc, 13) * XXH_PRIME32_1;
+}
+
+static void xxh32_init(Xxh32 *h) {
+    memset(h, 0, sizeof(*h));
+    h->v[0] = XXH_PRIME32_1 + XXH_PRIME32_2;
+    h->v[1] = XXH_PRIME32_2;
+    h->v[2] = 0;
+    h->v[3] = 0U - XXH_PRIME32_1;
+}
+
+static void xxh32_update(Xxh32 *h, const uint8_t *p, size_t len) {
+    h->total += len;
+    if (h->buf_len + len < 16) {
+        memcpy(h->buf + h->buf_len, p, len);
+        h->buf_len += len;
+        return;
+    }
+    if (h->buf_len > 0) {
+        size_t fill = 16 - h->buf_len;
+        memcpy(h->buf + h->buf_len, p, fill);
+        for (int i = 0; i < 4; i++) {
+            h->v[i] = xxh32_round(h->v[i], le32(h->buf + 4 * i));
+        }
+        p += fill;
+        len -= fill;
+        h->buf_len = 0;
+    }
+    uint32_t v0 = h->v[0], v1 = h->v[1], v2 = h->v[2], v3 = h->v[3];
+    while (len >= 16) {
+        v0 = xxh32_round(v0, le32(p));
+        v1 = xxh32_round(v1, le32(p + 4));
+        v2 = xxh32_round(v2, le32(p + 8));
+        v3 = xxh32_round(v3, le32(p + 12));
+        p += 16;
+        len -= 16;
+    }
+    h->v[0] = v0;
+    h->v[1] = v1;
+    h->v[2] = v2;
+    h->v[3] = v3;
+    memcpy(h->buf, p, len);
+    h->buf_len = len;
+}
+
+static uint32_t xxh32_digest(const Xxh32 *h) {
+    uint32_t acc;
+    if (h->total >= 16) {
+        acc = rotl32(h->v[0], 1) + rotl32(h->v[1], 7) + rotl32(h->v[2], 12) + rotl32(h->v[3], 18);
+    } else {
+        acc = h->v[2] + XXH_PRIME32_5;
+    }
+    acc += (uint32_t)h->total;
+    const uint8_t *p = h->buf;
+    size_t len = h->buf_len;
+    while (len >= 4) {
+        acc += le32(p) * XXH_PRIME32_3;
+        acc = rotl32(acc, 17) * XXH_PRIME32_4;
+        p += 4;
+        len -= 4;
+    }
+    while (len > 0) {
+        acc += *p * XXH_PRIME32_5;
+        acc = rotl32(acc, 11) * XXH_PRIME32_1;
+        p++;
+        len--;
+    }
+    acc ^= acc >> 15;
+    acc *= XXH_PRIME32_2;
+    acc ^= acc >> 13;
+    acc *= XXH_PRIME32_3;
+    acc ^= acc >> 16;
+    return acc;
+}
+
+static uint32_t xxh32(const uint8_t *p, size_t len) {
+    Xxh32 h;
+    xxh32_init(&h);
+    xxh32_update(&h, p, len);
+    return xxh32_digest(&h);
+}
+
+// Block decoder
+
+/**
+ * Decode one LZ4 block into dst + prefix. The `prefix` bytes before it are
+ * history that matches may reach back into (the previous linked blocks).
+ * Every read and write is bounds-checked; malformed input gives EINVAL.
+ */
+static int decode_block(const uint8_t *src, size_t src_len, uint8_t *dst, size_t prefix,
+                        size_t cap, size_t *out_len) {
+    const uint8_t *ip = src;
+    const uint8_t *iend = src + src_len;
+    uint8_t *op = dst + prefix;
+    uint8_t *oend = dst + cap;
+
+    for (;;) {
+        if (ip >= iend) {
+            goto bad;
+        }
+        unsigned token = *ip++;
+
+        size_t literals = token >> 4;
+        if (literals == 15) {
+            unsigned b;
+            do {
+                if (ip >= iend) {
+                    goto bad;
+                }
+                b = *ip++;
+                literals += b;
+            } while (b == 255);
+        }
+        if (literals > (size_t)(iend - ip) || literals > (size_t)(oend - op)) {
+            goto bad;
+        }
+        memcpy(op, ip, literals);
+        op += literals;
+        ip += literals;
+        if (ip == iend) {
+            break;  // The last sequence has literals only
+        }
+
+        if (iend - ip < 2) {
+            goto bad;
+        }
+        size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst)) {
+            goto bad;
+        }
+        size_t length = token & 15;
+        if (length == 15) {
+            unsigned b;
+            do {
+                if (ip >= iend) {
+                    goto bad;
+                }
+                b = *ip++;
+                length += b;
+            } while (b == 255);
+        }
+        length += 4;
+        if (length > (size_t)(oend - op)) {
+            goto bad;
+        }
+        const uint8_t *match = op - offset;
+        if (offset == 1) {
+            memset(op, *match, length);
+            op += length;
+        } else if (offset >= length) {
+            memcpy(op, match, length);
+            op += length;
+        } else {
+            // Overlapping match: repeat the period `offset` bytes at a time
+            while (length > 0) {
+                size_t chunk = length < offset ? length : offset;
+                memcpy(op, match, chunk);
+                op += chunk;
+                length -= chunk;
+            }
+        }
+    }
+    *out_len = (size_t)(op - (dst + prefix));
+    return 0;
+
+bad:
+    errno = EINVAL;
+    return -1;
+}
+
+// Frame filter
+
+typedef struct Lz4Job {
+    uint8_t *in;                 // Block data, followed by its checksum if any
+    size_t in_len;
+    size_t in_cap;
+    uint8_t *out;
+    size_t out_cap;
+    const uint8_t *data;         // Decoded bytes to serve (out, in for stored blocks, or the window)
+    size_t data_len;
+    bool stored;                 // Block kept uncompressed by the encoder
+    bool checksum;               // Block checksum follows the data
+    bool hash;                   // Feeds the frame's content checksum
+
+    // End mark of a frame, checked once every block before it was served
+    bool end;
+    bool has_content_checksum;
+    uint32_t content_checksum;
+    bool has_content_size;
+    uint64_t content_size;
+
+    int error;
+    bool done;
+    struct Lz4Job *next;
+} Lz4Job;
+
+typedef struct Lz4Data {
+    ArcStream *underlying;
+
+    // Workers (independent blocks only)
+    unsigned thread_count;
+    pthread_t threads[MAX_THREADS];
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t finished;
+    Lz4Job *head;
+    Lz4Job *tail;
+    bool shutdown;
+
+    // Blocks [first, next) are in flight, in ring slots by sequence % ring_size
+    Lz4Job *ring;
+    unsigned ring_size;
+    uint64_t first;
+    uint64_t next;
+    size_t serve_off;            // Offset into block `first`
+
+    // Frame being read
+    bool frames_seen;
+    bool in_frame;
+    uint8_t flags;               // FLG byte
+    size_t block_max;
+    bool has_content_size;
+    uint64_t content_size;
+
+    // Linked blocks decode on the calling thread behind up to 64 KiB of history
+    uint8_t *window;
+    size_t window_cap;
+    size_t history;
+
+    // Frame being served
+    Xxh32 content_hash;
+    uint64_t frame_served;
+
+    bool in_eof;
+    uint64_t pos;                // Stream position (uncompressed)
+    int error;                   // Sticky errno once decoding failed
+} Lz4Data;
+
+static int check_block(const Lz4Job *job) {
+    if (job->checksum && xxh32(job->in, job->in_len) != le32(job->in + job->in_len)) {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+// Independent block: everything it needs is in the job
+static void job_decode(Lz4Job *job) {
+    job->error = 0;
+    if (check_block(job) < 0) {
+        job->error = errno;
+        return;
+    }
+    if (job->stored) {
+        job->data = job->in;
+        job->data_len = job->in_len;
+        return;
+    }
+    if (decode_block(job->in, job->in_len, job->out, 0, job->out_cap, &job->data_len) < 0) {
+        job->error = errno;
+        return;
+    }
+    job->data = job->out;
+}
+
+// Linked block: decoded behind the previous blocks' last 64 KiB
+static int linked_decode(Lz4Data *d, Lz4Job *job) {
+    job->error = 0;
+    if (check_block(job) < 0) {
+        return -1;
+    }
+    if (d->history > LZ4_WINDOW) {
+        memmove(d->window, d->window + d->history - LZ4_WINDOW, LZ4_WINDOW);
+        d->history = LZ4_WINDOW;
+    }
+    uint8_t *dst = d->window + d->history;
+    size_t len = job->in_len;
+    if (job->stored) {
+        memcpy(dst, job->in, len);
+    } else if (decode_block(job->in, job->in_len, d->window, d->history, d->window_cap, &len) < 0) {
+        return -1;
+    }
+    job->data = dst;
+    job->data_len = len;
+    d->history += len;
+    return 0;
+}
+
+static void *worker_main(void *arg) {
+    Lz4Data *d = arg;
+    pthread_mutex_lock(&d->lock);
+    for (;;) {
+        while (!d->head && !d->shutdown) {
+            pthread_cond_wait(&d->work, &d->lock);
+        }
+        if (d->shutdown) {
+            break;
+        }
+        Lz4Job *job = d->head;
+        d->head = job->next;
+        if (!d->head) {
+            d->tail = NULL;
+        }
+        pthread_mutex_unlock(&d->lock);
+        job_decode(job);
+        pthread_mutex_lock(&d->lock);
+        job->done = true;
+        pthread_cond_broadcast(&d->finished);
+    }
+    pthread_mutex_unlock(&d->lock);
+    return NULL;
+}
+
+static int grow(uint8_t **buf, size_t *cap, size_t need) {
+    if (*cap >= need) {
+        return 0;
+    }
+    uint8_t *p = realloc(*buf, need);
+    if (!p) {
+        errno = ENOMEM;
+        return -1;
+    }
+    *buf = p;
+    *cap = need;
+    return 0;
+}
+
+// Read frame headers up to the first block: 1 = in a frame, 0 = clean EOF, -1 on error
+static int read_frame_header(Lz4Data *d) {
+    for (;;) {
+        uint8_t buf[16];
+        ssize_t got = read_full(d->underlying, buf, 4);
+        if (got <= 0) {
+            if (got == 0 && !d->frames_seen) {
+                errno = EINVAL;  // Not even one frame
+                return -1;
+            }
+            return (int)got;
+        }
+        uint32_t magic = le32(buf);
+        if ((magic & LZ4_SKIPPABLE_MASK) == LZ4_SKIPPABLE_MAGIC) {
+            if (read_full(d->underlying, buf, 4) != 4) {
+                errno = EINVAL;
+                return -1;
+            }
+            uint32_t skip = le32(buf);
+            uint8_t discard[4096];
+            while (skip > 0) {
+                size_t chunk = skip < sizeof(discard) ? skip : sizeof(discard);
+                if (read_full(d->underlying, discard, chunk) != (ssize_t)chunk) {
+                    errno = EINVAL;
+                    return -1;
+                }
+                skip -= (uint32_t)chunk;
+            }
+            continue;
+        }
+        if (magic != LZ4_FRAME_MAGIC) {
+            errno = EINVAL;
+            return -1;
+        }
+
+        // Descriptor: FLG, BD, optional content size and dictionary ID, header checksum
+        if (read_full(d->underlying, buf, 2) != 2) {
+            errno = EINVAL;
+            return -1;
+        }
+        uint8_t flg = buf[0];
+        uint8_t bd = buf[1];
+        if ((flg & FLG_VERSION_MASK) != FLG_VERSION || (flg & FLG_RESERVED) || (bd & 0x8F)) {
+            errno = EINVAL;
+            return -1;
+        }
+        unsigned block_id = (bd >> 4) & 7;
+        if (block_id < 4) {
+            errno = EINVAL;
+            return -1;
+        }
+        size_t desc_len = 2 + ((flg & FLG_CONTENT_SIZE) ? 8 : 0) + ((flg & FLG_DICT_ID) ? 4 : 0);
+        if (read_full(d->underlying, buf + 2, desc_len - 2 + 1) != (ssize_t)(desc_len - 2 + 1)) {
+            errno = EINVAL;
+            return -1;
+        }
+        if (((xxh32(buf, desc_len) >> 8) & 0xFF) != buf[desc_len]) {
+            errno = EINVAL;
+            return -1;
+        }
+        if (flg & FLG_DICT_ID) {
+            errno = ENOTSUP;  // Needs the dictionary the frame was compressed with
+            return -1;
+        }
+        d->flags = flg;
+        d->block_max = (size_t)1 << (8 + 2 * block_id);
+        d->has_content_size = (flg & FLG_CONTENT_SIZE) != 0;
+        d->content_size = d->has_content_size ? le64(buf + 2) : 0;
+        if (!(flg & FLG_BLOCK_INDEP)) {
+            if (grow(&d->window, &d->window_cap, LZ4_WINDOW + d->block_max) < 0) {
+                return -1;
+            }
+            d->history = 0;
+        }
+        d->frames_seen = true;
+        d->in_frame = true;
+        return 1;
+    }
+}
+
+// Read the next block (or end mark) and hand it to a worker (or decode it here)
+static int dispatch_block(Lz4Data *d) {
+    if (!d->in_frame) {
+        int ret = read_frame_header(d);
+        if (ret <= 0) {
+            d->in_eof = ret == 0;
+            return ret;
+        }
+    }
+    Lz4Job *job = &d->ring[d->next % d->ring_size];
+    uint8_t word[4];
+    if (read_full(d->underlying, word, 4) != 4) {
+        errno = EINVAL;
+        return -1;
+    }
+    uint32_t size = le32(word);
+    job->end = size == 0;
+    job->error = 0;
+    job->done = false;
+    job->next = NULL;
+    job->data = NULL;
+    job->data_len = 0;
+    job->hash = (d->flags & FLG_CONTENT_CHECKSUM) != 0;
+
+    if (job->end) {
+        job->has_content_checksum = job->hash;
+        if (job->hash) {
+            if (read_full(d->underlying, word, 4) != 4) {
+                errno = EINVAL;
+                return -1;
+            }
+            job->content_checksum = le32(word);
+        }
+        job->has_content_size = d->has_content_size;
+        job->content_size = d->content_size;
+        job->done = true;
+        d->in_frame = false;
+        d->next++;
+        return 0;
+    }
+
+    job->stored = (size & 0x80000000U) != 0;
+    job->checksum = (d->flags & FLG_BLOCK_CHECKSUM) != 0;
+    job->in_len = size & 0x7FFFFFFFU;
+    if (job->in_len > d->block_max) {
+        errno = EINVAL;
+        return -1;
+    }
+    size_t want = job->in_len + (job->checksum ? 4 : 0);
+    if (grow(&job->in, &job->in_cap, d->block_max + 4) < 0) {
+        return -1;
+    }
+    if (read_full(d->underlying, job->in, want) != (ssize_t)want) {
+        errno = EINVAL;
+        return -1;
+    }
+    d->next++;
+
+    if (!(d->flags & FLG_BLOCK_INDEP)) {
+        if (linked_decode(d, job) < 0) {
+            return -1;
+        }
+        job->done = true;
+        return 0;
+    }
+    if (!job->stored && grow(&job->out, &job->out_cap, d->block_max) < 0) {
+        return -1;
+    }
+    if (d->thread_count == 0) {
+        job_decode(job);
+        job->done = true;
+        return 0;
+    }
+    pthread_mutex_lock(&d->lock);
+    if (d->tail) {
+        d->tail->next = job;
+    } else {
+        d->head = job;
+    }
+    d->tail = job;
+    pthread_cond_signal(&d->work);
+    pthread_mutex_unlock(&d->lock);
+    return 0;
+}
+
+static void wait_job(Lz4Data *d, Lz4Job *job) {
+    pthread_mutex_lock(&d->lock);
+    while (!job->done) {
+        pthread_cond_wait(&d->finished, &d->lock);
+    }
+    pthread_mutex_unlock(&d->lock);
+}
+
+// Blocks that may be in flight at once: linked blocks share the window
+static unsigned read_ahead(const Lz4Data *d) {
+    if (d->in_frame && !(d->flags & FLG_BLOCK_INDEP)) {
+        return 1;
+    }
+    return d->ring_size;
+}
+
+// Checks done when the serving side reaches the block `first`
+static int begin_job(Lz4Data *d, Lz4Job *job) {
+    if (job->end) {
+        if ((job->has_content_checksum && xxh32_digest(&d->content_hash) != job->content_checksum) ||
+            (job->has_content_size && d->frame_served != job->content_size)) {
+            errno = EINVAL;
+            return -1;
+        }
+        xxh32_init(&d->content_hash);
+        d->frame_served = 0;
+        return 0;
+    }
+    if (job->hash) {
+        xxh32_update(&d->content_hash, job->data, job->data_len);
+    }
+    d->frame_served += job->data_len;
+    return 0;
+}
+
+static ssize_t lz4_read(ArcStream *stream, void *buf, size_t n) {
+    Lz4Data *d = (Lz4Data *)stream->user_data;
+    if (d->error) {
+        errno = d->error;
+        return -1;
+    }
+    // The byte limit caps the readable range
+    if (stream->byte_limit > 0) {
+        if ((int64_t)d->pos >= stream->byte_limit) {
+            return 0;
+        }
+        if ((int64_t)n > stream->byte_limit - (int64_t)d->pos) {
+            n = (size_t)(stream->byte_limit - (int64_t)d->pos);
+        }
+    }
+
+    uint8_t *out = buf;
+    size_t done = 0;
+    while (done < n) {
+        while (!d->in_eof && d->next - d->first < read_ahead(d)) {
+            if (dispatch_block(d) < 0) {
+                goto fail;
+            }
+        }
+        if (d->first == d->next) {
+            break;  // EOF
+        }
+        Lz4Job *job = &d->ring[d->first % d->ring_size];
+        wait_job(d, job);
+        if (job->error) {
+            errno = job->error;
+            goto fail;
+        }
+        if (d->serve_off == 0 && begin_job(d, job) < 0) {
+            goto fail;
+        }
+        size_t take = job->data_len - d->serve_off;
+        if (take > n - done) {
+            take = n - done;
+        }
+        if (take > 0) {
+            memcpy(out + done, job->data + d->serve_off, take);
+        }
+        done += take;
+        d->serve_off += take;
+        if (d->serve_off == job->data_len) {
+            d->first++;
+            d->serve_off = 0;
+        }
+    }
+    d->pos += done;
+    stream->bytes_read += (int64_t)done;
+    return (ssize_t)done;
+
+fail:
+    d->error = errno ? errno : EIO;
+    if (done > 0) {
+        d->pos += done;
+        stream->bytes_read += (int64_t)done;
+        return (ssize_t)done;  // Report the error on the next call
+    }
+    errno = d->error;
+    return -1;
+}
+
+static int lz4_seek(ArcStream *stream, int64_t off, int whence) {
+    // Streaming decompression can't seek
+    (void)stream;
+    (void)off;
+    (void)whence;
+    errno = ESPIPE;
+    return -1;
+}
+
+static int64_t lz4_tell(ArcStream *stream) {
+    return (int64_t)((Lz4Data *)stream->user_data)->pos;
+}
+
+static void lz4_free(Lz4Data *d) {
+    pthread_mutex_lock(&d->lock);
+    d->shutdown = true;
+    pthread_cond_broadcast(&d->work);
+    pthread_mutex_unlock(&d->lock);
+    for (unsigned i = 0; i < d->thread_count; i++) {
+        pthread_join(d->threads[i], NULL);
+    }
+    for (unsigned i = 0; d->ring && i < d->ring_size; i++) {
+        free(d->ring[i].in);
+        free(d->ring[i].out);
+    }
+    free(d->ring);
+    free(d->window);
+    pthread_mutex_destroy(&d->lock);
+    pthread_cond_destroy(&d->work);
+    pthread_cond_destroy(&d->finished);
+    free(d);
+}
+
+static void lz4_close(ArcStream *stream) {
+    lz4_free((Lz4Data *)stream->user_data);
+    free(stream);
+}
+
+static const struct ArcStreamVtable lz4_vtable = {
+    .read = lz4_read,
+    .seek = lz4_seek,
+    .tell = lz4_tell,
+    .close = lz4_close,
+};
+
+ArcStream *arc_filter_lz4(ArcStream *underlying, int64_t byte_limit, const ArcLz4Options *opts) {
+    if (!underlying) {
+        errno = EINVAL;
+        return NULL;
+    }
+    Lz4Data *d = calloc(1, sizeof(*d));
+    ArcStream *stream = calloc(1, sizeof(*stream));
+    if (!d || !stream) {
+        free(d);
+        free(stream);
+        errno = ENOMEM;
+        return NULL;
+    }
+    d->underlying = underlying;
+    pthread_mutex_init(&d->lock, NULL);
+    pthread_cond_init(&d->work, NULL);
+    pthread_cond_init(&d->finished, NULL);
+    xxh32_init(&d->content_hash);
+
+    long threads = opts && opts->threads ? (long)opts->threads : sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (threads > MAX_THREADS) {
+        threads = MAX_THREADS;
+    }
+    // Without a pool there is nothing to read ahead for
+    d->ring_size = threads > 1 ? (unsigned)threads * BLOCKS_PER_THREAD : 1;
+    d->ring = calloc(d->ring_size, sizeof(*d->ring));
+    if (!d->ring) {
+        lz4_free(d);
+        free(stream);
+        errno = ENOMEM;
+        return NULL;
+    }
+    for (long i = 0; threads > 1 && i < threads; i++) {
+        if (pthread_create(&d->threads[d->thread_count], NULL, worker_main, d) != 0) {
+            break;
+        }
+        d->thread_count++;
+    }
+
+    stream->vtable = &lz4_vtable;
+    stream->byte_limit = byte_limit;
+    stream->bytes_read = 0;
+    stream->user_data = d;
+    return stream;
+}
@@ -0,0 +1,592 @@
+#define _POSIX_C_SOURCE 200809L
+#include "arc_grep.h"
+#include "arc_stream.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <fnmatch.h>
+#include <regex.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <tmmintrin.h>
+#define GREP_HAVE_SSSE3 1
+#endif
+
+// Teddy: literals are spread over 8 buckets; a position is a candidate when
+// its first TEDDY_MAX_FP bytes match the nibble masks of some bucket
+#define TEDDY_BUCKETS 8
+#define TEDDY_MAX_FP  3
+
+#define IO_CHUNK (64 * 1024)
+#define LINE_MAX_BYTES (2 * IO_CHUNK)  // Regex mode: longer lines are split
+
+typedef struct GrepLiteral {
+    uint8_t *bytes;
+    size_t len;
+} GrepLiteral;
+
+typedef struct Teddy {
+    uint8_t lo[TEDDY_MAX_FP][16];  // Bucket bits by low nibble of byte j
+    uint8_t hi[TEDDY_MAX_FP][16];  // Bucket bits by high nibble of byte j
+    size_t fp;                     // Fingerprint length (shortest literal, at most TEDDY_MAX_FP)
+    GrepLiteral *lits;
+    size_t count;
+    size_t max_len;
+    size_t *buckets[TEDDY_BUCKETS];  // Literal indexes per bucket
+    size_t bucket_count[TEDDY_BUCKETS];
+    bool icase;
+} Teddy;
+
+// Called for each verified literal match; nonzero stops the scan
+typedef int (*TeddyVisit)(void *ctx, size_t pos, size_t lit);
+
+static void teddy_add_byte(Teddy *t, size_t j, uint8_t c, uint8_t bit) {
+    t->lo[j][c & 0x0f] |= bit;
+    t->hi[j][c >> 4] |= bit;
+}
+
+static void teddy_free(Teddy *t) {
+    for (size_t i = 0; i < t->count; i++) {
+        free(t->lits[i].bytes);
+    }
+    free(t->lits);
+    for (size_t b = 0; b < TEDDY_BUCKETS; b++) {
+        free(t->buckets[b]);
+    }
+    memset(t, 0, sizeof(*t));
+}
+
+// Build the prefilter from '\n'-separated literals (empty ones are ignored)
+static int teddy_init(Teddy *t, const char *patterns, bool icase) {
+    memset(t, 0, sizeof(*t));
+    t->icase = icase;
+    size_t capacity = 0;
+    const char *p = patterns;
+    while (*p) {
+        const char *nl = strchr(p, '\n');
+        size_t len = nl ? (size_t)(nl - p) : strlen(p);
+        if (len > 0) {
+            if (t->count == capacity) {
+                capacity = capacity ? capacity * 2 : 8;
+                GrepLiteral *grown = realloc(t->lits, capacity * sizeof(*grown));
+                if (!grown) {
+                    teddy_free(t);
+                    return -1;
+                }
+                t->lits = grown;
+            }
+            uint8_t *bytes = malloc(len);
+            if (!bytes) {
+                teddy_free(t);
+                return -1;
+            }
+            memcpy(bytes, p, len);
+            t->lits[t->count].bytes = bytes;
+            t->lits[t->count].len = len;
+            t->count++;
+        }
+        p += len;
+        if (*p == '\n') {
+            p++;
+        }
+    }
+    if (t->count == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    t->fp = TEDDY_MAX_FP;
+    for (size_t i = 0; i < t->count; i++) {
+        if (t->lits[i].len < t->fp) {
+            t->fp = t->lits[i].len;
+        }
+        if (t->lits[i].len > t->max_len) {
+            t->max_len = t->lits[i].len;
+        }
+    }
+    for (size_t i = 0; i < t->count; i++) {
+        size_t b = i % TEDDY_BUCKETS;
+        uint8_t bit = (uint8_t)(1u << b);
+        for (size_t j = 0; j < t->fp; j++) {
+            uint8_t c = t->lits[i].bytes[j];
+            teddy_add_byte(t, j, c, bit);
+            if (icase) {
+                teddy_add_byte(t, j, (uint8_t)tolower(c), bit);
+                teddy_add_byte(t, j, (uint8_t)toupper(c), bit);
+            }
+        }
+        size_t *grown = realloc(t->buckets[b], (t->bucket_count[b] + 1) * sizeof(size_t));
+        if (!grown) {
+            teddy_free(t);
+            return -1;
+        }
+        t->buckets[b] = grown;
+        t->buckets[b][t->bucket_count[b]++] = i;
+    }
+    return 0;
+}
+
+static bool literal_equal(const Teddy *t, const uint8_t *data, const GrepLiteral *lit) {
+    if (!t->icase) {
+        return memcmp(data, lit->bytes, lit->len) == 0;
+    }
+    for (size_t i = 0; i < lit->len; i++) {
+        if (tolower(data[i]) != tolower(lit->bytes[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Check the literals of every bucket flagged for a candidate position
+static int teddy_verify(const Teddy *t, const uint8_t *data, size_t len, size_t pos, uint8_t bits,
+                        TeddyVisit visit, void *ctx) {
+    while (bits) {
+        unsigned b = 0;
+        while (!(bits & (1u << b))) {
+            b++;
+        }
+        bits &= (uint8_t)~(1u << b);
+        for (size_t k = 0; k < t->bucket_count[b]; k++) {
+            size_t i = t->buckets[b][k];
+            const GrepLiteral *lit = &t->lits[i];
+            if (pos + lit->len <= len && literal_equal(t, data + pos, lit)) {
+                if (visit(ctx, pos, i)) {
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+static uint8_t teddy_bits(const Teddy *t, const uint8_t *p) {
+    uint8_t bits = 0xff;
+    for (size_t j = 0; j < t->fp; j++) {
+        bits &= t->lo[j][p[j] & 0x0f] & t->hi[j][p[j] >> 4];
+    }
+    return bits;
+}
+
+#ifdef GREP_HAVE_SSSE3
+// 16 candidate positions per step: pshufb looks up both nibble tables for
+// every byte at once; a zero byte in the AND means no bucket can match
+__attribute__((target("ssse3")))
+static int teddy_scan_ssse3(const Teddy *t, const uint8_t *data, size_t len, size_t *pos_io, size_t end,
+                            TeddyVisit visit, void *ctx) {
+    __m128i lo[TEDDY_MAX_FP], hi[TEDDY_MAX_FP];
+    for (size_t j = 0; j < t->fp; j++) {
+        lo[j] = _mm_loadu_si128((const __m128i *)t->lo[j]);
+        hi[j] = _mm_loadu_si128((const __m128i *)t->hi[j]);
+    }
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    const __m128i zero = _mm_setzero_si128();
+    size_t pos = *pos_io;
+    while (pos + 16 <= end && pos + 16 + t->fp - 1 <= len) {
+        __m128i acc = _mm_set1_epi8((char)0xff);
+        for (size_t j = 0; j < t->fp; j++) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(data + pos + j));
+            __m128i l = _mm_shuffle_epi8(lo[j], _mm_and_si128(v, nibble));
+            __m128i h = _mm_shuffle_epi8(hi[j], _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+            acc = _mm_and_si128(acc, _mm_and_si128(l, h));
+        }
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(acc, zero)) ^ 0xffffu;
+        if (mask) {
+            uint8_t bits[16];
+            _mm_storeu_si128((__m128i *)bits, acc);
+            while (mask) {
+                unsigned i = (unsigned)__builtin_ctz(mask);
+                mask &= mask - 1;
+                if (teddy_verify(t, data, len, pos + i, bits[i], visit, ctx)) {
+                    *pos_io = pos + i + 1;
+                    return 1;
+                }
+            }
+        }
+        pos += 16;
+    }
+    *pos_io = pos;
+    return 0;
+}
+
+static bool have_ssse3(void) {
+    return __builtin_cpu_supports("ssse3");
+}
+#endif
+
+/**
+ * Report literal matches starting at positions [start, end) of data[0, len).
+ * A literal only matches if it fits before len.
+ *
+ * @return 1 if visit stopped the scan, 0 otherwise
+ */
+static int teddy_scan(const Teddy *t, const uint8_t *data, size_t len, size_t start, size_t end,
+                      TeddyVisit visit, void *ctx) {
+    size_t pos = start;
+#ifdef GREP_HAVE_SSSE3
+    if (have_ssse3() && teddy_scan_ssse3(t, data, len, &pos, end, visit, ctx)) {
+        return 1;
+    }
+#endif
+    for (; pos < end && pos + t->fp <= len; pos++) {
+        uint8_t bits = teddy_bits(t, data + pos);
+        if (bits && teddy_verify(t, data, len, pos, bits, visit, ctx)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void keep_longest(const char *run, size_t run_len, char *out, size_t cap, size_t *best) {
+    if (run_len > *best && run_len < cap) {
+        memcpy(out, run, run_len);
+        out[run_len] = '\0';
+        *best = run_len;
+    }
+}
+
+/**
+ * Longest literal run every match of an ERE must contain, for the
+ * prefilter. Conservative: top-level alternation gives up, while groups,
+ * bracket expressions, classes and optional atoms end the current run.
+ */
+static size_t regex_required_literal(const char *re, char *out, size_t cap) {
+    char run[256];
+    size_t run_len = 0;
+    size_t best = 0;
+    out[0] = '\0';
+    const char *p = re;
+    while (*p) {
+        // One atom: a literal byte, or something that isn't (lit < 0)
+        int lit = -1;
+        if (*p == '|') {
+            out[0] = '\0';
+            return 0;
+        } else if (*p == '\\' && p[1]) {
+            // \w, \b, \1 ... are classes, anchors or backreferences
+            if (!isalnum((unsigned char)p[1])) {
+                lit = (unsigned char)p[1];
+            }
+            p += 2;
+        } else if (*p == '[') {
+            p++;
+            if (*p == '^') {
+                p++;
+            }
+            if (*p == ']') {
+                p++;
+            }
+            while (*p && *p != ']') {
+                if (*p == '[' && (p[1] == ':' || p[1] == '.' || p[1] == '=')) {
+                    char delim = p[1];
+                    p += 2;
+                    while (*p && !(p[0] == delim && p[1] == ']')) {
+                        p++;
+                    }
+                    if (*p) {
+                        p++;
+                    }
+                }
+                if (*p) {
+                    p++;
+                }
+            }
+            if (*p) {
+                p++;
+            }
+        } else if (*p == '(') {
+            // Group contents may be optional or alternatives; skip them
+            int depth = 0;
+            do {
+                if (*p == '\\' && p[1]) {
+                    p++;
+                } else if (*p == '(') {
+                    depth++;
+                } else if (*p == ')') {
+                    depth--;
+                }
+                p++;
+            } while (*p && depth > 0);
+        } else {
+            if (!strchr(".^$)*+?{", *p)) {
+                lit = (unsigned char)*p;
+            }
+            p++;
+        }
+
+        // Quantifier: '*', '?' and '{' may drop the atom; '+' keeps it but
+        // what follows is no longer adjacent
+        bool optional = *p == '*' || *p == '?' || *p == '{';
+        bool repeat = *p == '+';
+        if (*p == '{') {
+            while (*p && *p != '}') {
+                p++;
+            }
+        }
+        if ((optional || repeat) && *p) {
+            p++;
+        }
+
+        if (lit >= 0 && !optional && run_len < sizeof(run)) {
+            run[run_len++] = (char)lit;
+        }
+        if (lit < 0 || optional || repeat) {
+            keep_longest(run, run_len, out, cap, &best);
+            run_len = 0;
+        }
+    }
+    keep_longest(run, run_len, out, cap, &best);
+    return best;
+}
+
+// Per-search state shared by the scan callbacks
+typedef struct GrepState {
+    const ArcGrepOptions *opts;
+    ArcGrepCallback callback;
+    void *user;
+    const Teddy *teddy;
+    ArcEntry *entry;
+    uint64_t base;           // Entry offset of buf[0]
+    size_t entry_matches;
+    int64_t total;
+    int status;              // 0 = go on, 1 = done with this entry, -1 = stop the search
+    size_t hit;              // Regex mode: position of the first prefilter hit
+} GrepState;
+
+static int report(GrepState *st, uint64_t offset, size_t length, size_t pattern_index) {
+    ArcGrepMatch match;
+    match.entry = st->entry;
+    match.offset = offset;
+    match.length = length;
+    match.pattern_index = pattern_index;
+    st->total++;
+    st->entry_matches++;
+    int ret = st->callback ? st->callback(&match, st->user) : 0;
+    if (ret < 0) {
+        st->status = -1;
+    } else if (ret > 0 || (st->opts->max_matches_per_entry > 0 &&
+                           st->entry_matches >= st->opts->max_matches_per_entry)) {
+        st->status = 1;
+    }
+    return st->status != 0;
+}
+
+static int visit_literal(void *ctx, size_t pos, size_t lit) {
+    GrepState *st = ctx;
+    return report(st, st->base + pos, st->teddy->lits[lit].len, lit);
+}
+
+static int visit_first(void *ctx, size_t pos, size_t lit) {
+    (void)lit;
+    ((GrepState *)ctx)->hit = pos;
+    return 1;
+}
+
+// Literal mode: the last max_len - 1 bytes of each chunk are carried over,
+// so every start position is scanned exactly once, with its whole literal
+static int grep_literals(GrepState *st, ArcStream *data, uint8_t *buf, size_t cap) {
+    size_t keep = st->teddy->max_len - 1;
+    size_t have = 0;
+    st->base = 0;
+    for (;;) {
+        ssize_t got = arc_stream_read(data, buf + have, cap - have);
+        if (got < 0) {
+            return -1;
+        }
+        have += (size_t)got;
+        bool eof = got == 0;
+        size_t end = eof ? have : (have > keep ? have - keep : 0);
+        if (teddy_scan(st->teddy, buf, have, 0, end, visit_literal, st) || eof) {
+            return 0;
+        }
+        memmove(buf, buf + end, have - end);
+        st->base += end;
+        have -= end;
+    }
+}
+
+static int regex_line(GrepState *st, const regex_t *re, uint8_t *buf, size_t start, size_t end) {
+    // The line ends at '\n' or at end (buf has a spare byte past the data)
+    uint8_t saved = buf[end];
+    buf[end] = '\0';
+    const char *s = (const char *)buf + start;
+    int eflags = 0;
+    regmatch_t m;
+    while (*s && regexec(re, s, 1, &m, eflags) == 0) {
+        size_t off = (size_t)(s - (const char *)buf) + (size_t)m.rm_so;
+        if (report(st, st->base + off, (size_t)(m.rm_eo - m.rm_so), 0)) {
+            break;
+        }
+        s += m.rm_eo > m.rm_so ? m.rm_eo : m.rm_so + 1;
+        eflags = REG_NOTBOL;
+    }
+    buf[end] = saved;
+    return st->status != 0;
+}
+
+// Regex mode: whole lines are matched; with a prefilter literal, only the
+// lines it hits are
+static int grep_regex(GrepState *st, const regex_t *re, ArcStream *data, uint8_t *buf, size_t cap) {
+    size_t have = 0;
+    st->base = 0;
+    for (;;) {
+        ssize_t got = arc_stream_read(data, buf + have, cap - have);
+        if (got < 0) {
+            return -1;
+        }
+        have += (size_t)got;
+        bool eof = got == 0;
+
+        // Complete lines end after the last '\n'; a full buffer is one long line
+        size_t region = have;
+        if (!eof) {
+            while (region > 0 && buf[region - 1] != '\n') {
+                region--;
+            }
+            if (region == 0 && have < cap) {
+                continue;
+            }
+            if (region == 0) {
+                region = have;
+            }
+        }
+
+        size_t line = 0;
+        while (line < region) {
+            if (st->teddy) {
+                st->hit = SIZE_MAX;
+                teddy_scan(st->teddy, buf, region, line, region, visit_first, st);
+                if (st->hit == SIZE_MAX) {
+                    break;
+                }
+                while (st->hit > line && buf[st->hit - 1] != '\n') {
+                    st->hit--;
+                }
+                line = st->hit;
+            }
+            size_t line_end = line;
+            while (line_end < region && buf[line_end] != '\n') {
+                line_end++;
+            }
+            if (regex_line(st, re, buf, line, line_end)) {
+                return 0;
+            }
+            line = line_end + 1;
+        }
+        if (eof) {
+            return 0;
+        }
+        memmove(buf, buf + region, have - region);
+        st->base += region;
+        have -= region;
+    }
+}
+
+static bool entry_selected(const ArcEntry *entry, const ArcGrepOptions *opts) {
+    uint32_t types = opts->type_mask ? opts->type_mask : ARC_GREP_TYPE(ARC_ENTRY_FILE);
+    if (entry->type >= 32 || !(types & ARC_GREP_TYPE(entry->type))) {
+        return false;
+    }
+    if (entry->size < opts->min_size || (opts->max_size > 0 && entry->size > opts->max_size)) {
+        return false;
+    }
+    return !opts->name_glob || fnmatch(opts->name_glob, entry->path, 0) == 0;
+}
+
+int64_t arc_grep(ArcReader *reader, const char *pattern, const ArcGrepOptions *opts_in,
+                 ArcGrepCallback callback, void *user) {
+    if (!reader || !pattern) {
+        errno = EINVAL;
+        return -1;
+    }
+    ArcGrepOptions defaults;
+    memset(&defaults, 0, sizeof(defaults));
+    const ArcGrepOptions *opts = opts_in ? opts_in : &defaults;
+    bool icase = (opts->flags & ARC_GREP_IGNORE_CASE) != 0;
+    bool regex_mode = (opts->flags & ARC_GREP_REGEX) != 0;
+
+    Teddy teddy;
+    memset(&teddy, 0, sizeof(teddy));
+    bool have_teddy = false;
+    regex_t re;
+    size_t cap;
+    if (regex_mode) {
+        int ret = regcomp(&re, pattern, REG_EXTENDED | REG_NEWLINE | (icase ? REG_ICASE : 0));
+        if (ret != 0) {
+            errno = ret == REG_ESPACE ? ENOMEM : EINVAL;
+            return -1;
+        }
+        char required[256];
+        if (regex_required_literal(pattern, required, sizeof(required)) > 0) {
+            if (teddy_init(&teddy, required, icase) < 0) {
+                regfree(&re);
+                return -1;
+            }
+            have_teddy = true;
+        }
+        cap = LINE_MAX_BYTES;
+    } else {
+        if (teddy_init(&teddy, pattern, icase) < 0) {
+            return -1;
+        }
+        have_teddy = true;
+        cap = IO_CHUNK + teddy.max_len;
+    }
+
+    uint8_t *buf = malloc(cap + 1); // +1: room to NUL-terminate a line
+    if (!buf) {
+        if (regex_mode) {
+            regfree(&re);
+        }
+        teddy_free(&teddy);
+        return -1;
+    }
+
+    GrepState st;
+    memset(&st, 0, sizeof(st));
+    st.opts = opts;
+    st.callback = callback;
+    st.user = user;
+    st.teddy = have_teddy ? &teddy : NULL;
+
+    int64_t result = 0;
+    ArcEntry entry;
+    int ret;
+    while ((ret = arc_next(reader, &entry)) == 0) {
+        if (!entry_selected(&entry, opts) || entry.size == 0) {
+            arc_entry_free(&entry);
+            continue; // Nothing to scan; arc_next() skips the unread data
+        }
+        ArcStream *data = arc_open_data(reader);
+        if (!data) {
+            arc_entry_free(&entry);
+            result = -1;
+            break;
+        }
+        st.entry = &entry;
+        st.entry_matches = 0;
+        st.status = 0;
+        int scan = regex_mode ? grep_regex(&st, &re, data, buf, cap) : grep_literals(&st, data, buf, cap);
+        arc_stream_close(data);
+        arc_entry_free(&entry);
+        if (scan < 0) {
+            result = -1;
+            break;
+        }
+        if (st.status < 0) {
+            break;
+        }
+    }
+    if (ret < 0) {
+        result = -1;
+    }
+
+    free(buf);
+    if (regex_mode) {
+        regfree(&re);
+    }
+    teddy_free(&teddy);
+    return result < 0 ? -1 : st.total;
+}
@@ -0,0 +1,81 @@
+#ifndef ARC_GREP_H
+#define ARC_GREP_H
+
+#include "arc_reader.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Streaming content search across archive entries.
+ *
+ * Each selected entry's data is decompressed chunk by chunk and scanned in
+ * memory; nothing is extracted. Candidate positions come from a
+ * multi-literal prefilter (Teddy: nibble masks for the first bytes of every
+ * literal, looked up 16 positions at a time with SSSE3 where available, one
+ * at a time otherwise) and only candidates are verified. In regex mode the
+ * prefilter looks for a literal the regex requires, and only lines
+ * containing it are handed to regexec().
+ *
+ * Name, size and type filters only need the entry header, so filtered-out
+ * entries are skipped without decompressing anything.
+ */
+
+// Pattern syntax
+#define ARC_GREP_LITERAL     0x0  // One or more literals, separated by '\n'
+#define ARC_GREP_REGEX       0x1  // POSIX extended regex, matched line by line
+#define ARC_GREP_IGNORE_CASE 0x2  // ASCII case-insensitive
+
+// Bit for an entry type (ARC_ENTRY_*) in ArcGrepOptions.type_mask
+#define ARC_GREP_TYPE(type) (1u << (type))
+
+/**
+ * Search options. A zeroed struct (or NULL) searches every regular file for
+ * literals and reports every match.
+ */
+typedef struct ArcGrepOptions {
+    int         flags;                 // ARC_GREP_*
+    const char *name_glob;             // fnmatch() pattern on the entry path (NULL = all)
+    uint64_t    min_size;              // Skip entries smaller than this
+    uint64_t    max_size;              // Skip entries larger than this (0 = no limit)
+    uint32_t    type_mask;             // ARC_GREP_TYPE() bits (0 = regular files only)
+    size_t      max_matches_per_entry; // Stop scanning an entry after this many (0 = no limit)
+} ArcGrepOptions;
+
+/**
+ * A match, valid for the duration of the callback.
+ */
+typedef struct ArcGrepMatch {
+    const ArcEntry *entry;
+    uint64_t offset;        // Match start in the entry's uncompressed data
+    size_t length;          // Match length in bytes
+    size_t pattern_index;   // Which literal matched (0 in regex mode)
+} ArcGrepMatch;
+
+/**
+ * Match callback.
+ *
+ * @return 0 to continue, 1 to skip the rest of the current entry, <0 to
+ *         stop the search
+ */
+typedef int (*ArcGrepCallback)(const ArcGrepMatch *match, void *user);
+
+/**
+ * Search the data of the remaining entries of an archive.
+ *
+ * Literal mode reports every (offset, literal) pair, including overlapping
+ * matches, in offset order. Regex mode is line oriented: lines longer than
+ * 128 KiB are split, and a line containing NUL bytes is only matched up to
+ * the first one.
+ *
+ * @param reader The archive reader (iterated from its current position)
+ * @param pattern Literal list or regex, per opts->flags
+ * @param opts Search options (NULL = defaults)
+ * @param callback Called for each match
+ * @param user Passed to the callback
+ * @return Number of matches reported (the search stops early if the callback
+ *         returns <0), or -1 on error (EINVAL for an invalid pattern)
+ */
+int64_t arc_grep(ArcReader *reader, const char *pattern, const ArcGrepOptions *opts,
+                 ArcGrepCallback callback, void *user);
+
+#endif // ARC_GREP_H
@@ -0,0 +1,977 @@
+#include "arc_hash.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdbool.h>
+
+// ARC_HASH_PORTABLE (make HASH_PORTABLE=1) leaves out the SHA-NI and SSE2
+// paths, so the scalar code also runs, and is tested, on x86-64
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(ARC_HASH_PORTABLE)
+#include <immintrin.h>
+#define HASH_HAVE_SHANI 1
+#endif
+
+#if defined(__SSE2__) && !defined(ARC_HASH_PORTABLE)
+#include <emmintrin.h>
+#define HASH_HAVE_SSE2 1
+#endif
+
+static inline uint32_t load32_le(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t load64_le(const uint8_t *p) {
+    return (uint64_t)load32_le(p) | ((uint64_t)load32_le(p + 4) << 32);
+}
+
+static inline uint32_t load32_be(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static inline void store32_be(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static inline void store32_le(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint32_t rotr32(uint32_t v, int n) {
+    return (v >> n) | (v << (32 - n));
+}
+
+// SHA-256 (FIPS 180-4)
+
+typedef struct Sha256 {
+    uint32_t state[8];
+    uint8_t buf[64];
+    size_t buffered;
+    uint64_t total;
+} Sha256;
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+// Also the BLAKE3 IV
+static const uint32_t sha256_iv[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+static void sha256_blocks_portable(uint32_t state[8], const uint8_t *data, size_t blocks) {
+    for (; blocks > 0; blocks--, data += 64) {
+        uint32_t w[64];
+        for (int i = 0; i < 16; i++) {
+            w[i] = load32_be(data + 4 * i);
+        }
+        for (int i = 16; i < 64; i++) {
+            uint32_t s0 = rotr32(w[i - 15], 7) ^ rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr32(w[i - 2], 17) ^ rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; i++) {
+            uint32_t t1 = h + (rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25)) + ((e & f) ^ (~e & g)) +
+                          sha256_k[i] + w[i];
+            uint32_t t2 = (rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+#ifdef HASH_HAVE_SHANI
+/**
+ * SHA-NI: four rounds per sha256rnds2 pair, message schedule with
+ * sha256msg1/msg2. The state lives in the ABEF/CDGH layout the
+ * instructions expect.
+ */
+__attribute__((target("sha,sse4.1")))
+static void sha256_blocks_shani(uint32_t state[8], const uint8_t *data, size_t blocks) {
+    const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    __m128i tmp = _mm_loadu_si128((const __m128i *)&state[0]);    // DCBA
+    __m128i state1 = _mm_loadu_si128((const __m128i *)&state[4]); // HGFE
+    tmp = _mm_shuffle_epi32(tmp, 0xB1);                             // CDAB
+    state1 = _mm_shuffle_epi32(state1, 0x1B);                       // EFGH
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);               // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);                    // CDGH
+
+    for (; blocks > 0; blocks--, data += 64) {
+        __m128i save0 = state0;
+        __m128i save1 = state1;
+        __m128i msgs[4];
+
+        for (int i = 0; i < 16; i++) {
+            if (i < 4) {
+                msgs[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16 * i)), bswap);
+            }
+            __m128i msg = _mm_add_epi32(msgs[i & 3], _mm_loadu_si128((const __m128i *)&sha256_k[4 * i]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            if (i >= 3 && i <= 14) {
+                __m128i t = _mm_alignr_epi8(msgs[i & 3], msgs[(i - 1) & 3], 4);
+                msgs[(i + 1) & 3] = _mm_sha256msg2_epu32(_mm_add_epi32(msgs[(i + 1) & 3], t), msgs[i & 3]);
+            }
+            msg = _mm_shuffle_epi32(msg, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+            if (i >= 1 && i <= 12) {
+                msgs[(i - 1) & 3] = _mm_sha256msg1_epu32(msgs[(i - 1) & 3], msgs[i & 3]);
+            }
+        }
+
+        state0 = _mm_add_epi32(state0, save0);
+        state1 = _mm_add_epi32(state1, save1);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);                          // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);                       // DCHG
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);                    // DCBA
+    state1 = _mm_alignr_epi8(state1, tmp, 8);                       // HGFE
+    _mm_storeu_si128((__m128i *)&state[0], state0);
+    _mm_storeu_si128((__m128i *)&state[4], state1);
+}
+
+static bool have_shani(void) {
+    return __builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1");
+}
+#endif
+
+static void sha256_blocks(uint32_t state[8], const uint8_t *data, size_t blocks) {
+#ifdef HASH_HAVE_SHANI
+    if (have_shani()) {
+        sha256_blocks_shani(state, data, blocks);
+        return;
+    }
+#endif
+    sha256_blocks_portable(state, data, blocks);
+}
+
+static void sha256_init(Sha256 *s) {
+    memcpy(s->state, sha256_iv, sizeof(s->state));
+    s->buffered = 0;
+    s->total = 0;
+}
+
+static void sha256_update(Sha256 *s, const uint8_t *data, size_t len) {
+    s->total += len;
+    if (s->buffered > 0) {
+        size_t take = 64 - s->buffered;
+        if (take > len) {
+            take = len;
+        }
+        memcpy(s->buf + s->buffered, data, take);
+        s->buffered += take;
+        data += take;
+        len -= take;
+        if (s->buffered < 64) {
+            return;
+        }
+        sha256_blocks(s->state, s->buf, 1);
+        s->buffered = 0;
+    }
+    if (len >= 64) {
+        sha256_blocks(s->state, data, len / 64);
+        data += len & ~(size_t)63;
+        len &= 63;
+    }
+    memcpy(s->buf, data, len);
+    s->buffered = len;
+}
+
+static void sha256_final(const Sha256 *s, uint8_t out[32]) {
+    uint32_t state[8];
+    uint8_t tail[128];
+    memcpy(state, s->state, sizeof(state));
+    memcpy(tail, s->buf, s->buffered);
+    memset(tail + s->buffered, 0, sizeof(tail) - s->buffered);
+    tail[s->buffered] = 0x80;
+
+    size_t tail_len = s->buffered < 56 ? 64 : 128;
+    uint64_t bits = s->total * 8;
+    for (int i = 0; i < 8; i++) {
+        tail[tail_len - 1 - i] = (uint8_t)(bits >> (8 * i));
+    }
+    sha256_blocks(state, tail, tail_len / 64);
+    for (int i = 0; i < 8; i++) {
+        store32_be(out + 4 * i, state[i]);
+    }
+}
+
+// BLAKE3 (hash mode, 32-byte output)
+
+#define B3_BLOCK_LEN 64
+#define B3_CHUNK_LEN 1024
+#define B3_MAX_DEPTH 54   // 2^54 chunks is 2^64 bytes
+
+#define B3_CHUNK_START 1u
+#define B3_CHUNK_END   2u
+#define B3_PARENT      4u
+#define B3_ROOT        8u
+
+static const uint8_t b3_schedule[7][16] = {
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    {  2,  6,  3, 10,  7,  0,  4, 13,  1, 11, 12,  5,  9, 14, 15,  8 },
+    {  3,  4, 10, 12, 13,  2,  7, 14,  6,  5,  9,  0, 11, 15,  8,  1 },
+    { 10,  7, 12,  9, 14,  3, 13, 15,  4,  0, 11,  2,  5,  8,  1,  6 },
+    { 12, 13,  9, 11, 15, 10, 14,  8,  7,  2,  5,  3,  0,  1,  6,  4 },
+    {  9, 14, 11,  5,  8, 12, 15,  1, 13,  3,  0, 10,  2,  6,  4,  7 },
+    { 11, 15,  5,  0,  1,  9,  8,  6, 14, 10,  2, 12,  3,  4,  7, 13 },
+};
+
+typedef struct Blake3 {
+    uint32_t cv[8];                     // Chaining value of the current chunk
+    uint64_t chunk_counter;
+    uint8_t block[B3_BLOCK_LEN];
+    size_t block_len;
+    size_t blocks_compressed;           // In the current chunk
+    uint32_t stack[B3_MAX_DEPTH][8];    // Completed subtree CVs
+    size_t stack_len;
+} Blake3;
+
+#define B3_G(v, a, b, c, d, x, y) do {          \
+    v[a] = v[a] + v[b] + (x);                   \
+    v[d] = rotr32(v[d] ^ v[a], 16);             \
+    v[c] = v[c] + v[d];                         \
+    v[b] = rotr32(v[b] ^ v[c], 12);             \
+    v[a] = v[a] + v[b] + (y);                   \
+    v[d] = rotr32(v[d] ^ v[a], 8);              \
+    v[c] = v[c] + v[d];                         \
+    v[b] = rotr32(v[b] ^ v[c], 7);              \
+} while (0)
+
+static void b3_compress(const uint32_t cv[8], const uint8_t block[B3_BLOCK_LEN], uint64_t counter,
+                        uint32_t block_len, uint32_t flags, uint32_t out[16]) {
+    uint32_t m[16];
+    uint32_t v[16];
+    for (int i = 0; i < 16; i++) {
+        m[i] = load32_le(block + 4 * i);
+    }
+    memcpy(v, cv, 8 * sizeof(uint32_t));
+    memcpy(v + 8, sha256_iv, 4 * sizeof(uint32_t));
+    v[12] = (uint32_t)counter;
+    v[13] = (uint32_t)(counter >> 32);
+    v[14] = block_len;
+    v[15] = flags;
+
+    for (int r = 0; r < 7; r++) {
+        const uint8_t *s = b3_schedule[r];
+        B3_G(v, 0, 4, 8, 12, m[s[0]], m[s[1]]);
+        B3_G(v, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+        B3_G(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+        B3_G(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+        B3_G(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+        B3_G(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+        B3_G(v, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+        B3_G(v, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+    }
+    for (int i = 0; i < 8; i++) {
+        out[i] = v[i] ^ v[i + 8];
+        out[i + 8] = v[i + 8] ^ cv[i];
+    }
+}
+
+/**
+ * Hash whole 1 KiB chunks (never the last chunk of the input) into their
+ * chaining values.
+ */
+static void b3_chunks_portable(const uint8_t *data, size_t chunks, uint64_t counter, uint32_t (*cvs)[8]) {
+    for (size_t c = 0; c < chunks; c++) {
+        uint32_t cv[8];
+        uint32_t out[16];
+        memcpy(cv, sha256_iv, sizeof(cv));
+        for (size_t b = 0; b < B3_CHUNK_LEN / B3_BLOCK_LEN; b++) {
+            uint32_t flags = (b == 0 ? B3_CHUNK_START : 0) |
+                             (b == B3_CHUNK_LEN / B3_BLOCK_LEN - 1 ? B3_CHUNK_END : 0);
+            b3_compress(cv, data + c * B3_CHUNK_LEN + b * B3_BLOCK_LEN, counter + c, B3_BLOCK_LEN, flags, out);
+            memcpy(cv, out, sizeof(cv));
+        }
+        memcpy(cvs[c], cv, sizeof(cv));
+    }
+}
+
+#ifdef HASH_HAVE_SSE2
+static inline __m128i rotr128(__m128i v, int n) {
+    return _mm_or_si128(_mm_srli_epi32(v, n), _mm_slli_epi32(v, 32 - n));
+}
+
+#define B3_G4(v, a, b, c, d, x, y) do {                          \
+    v[a] = _mm_add_epi32(_mm_add_epi32(v[a], v[b]), (x));        \
+    v[d] = rotr128(_mm_xor_si128(v[d], v[a]), 16);               \
+    v[c] = _mm_add_epi32(v[c], v[d]);                            \
+    v[b] = rotr128(_mm_xor_si128(v[b], v[c]), 12);               \
+    v[a] = _mm_add_epi32(_mm_add_epi32(v[a], v[b]), (y));        \
+    v[d] = rotr128(_mm_xor_si128(v[d], v[a]), 8);                \
+    v[c] = _mm_add_epi32(v[c], v[d]);                            \
+    v[b] = rotr128(_mm_xor_si128(v[b], v[c]), 7);                \
+} while (0)
+
+/**
+ * Four chunks at once: lane i of every vector belongs to chunk i, so the
+ * compression function runs unchanged on 4-wide words.
+ */
+static void b3_chunks4_sse2(const uint8_t *data, uint64_t counter, uint32_t (*cvs)[8]) {
+    __m128i cv[8];
+    for (int i = 0; i < 8; i++) {
+        cv[i] = _mm_set1_epi32((int)sha256_iv[i]);
+    }
+    const __m128i counter_lo = _mm_set_epi32((int)(uint32_t)(counter + 3), (int)(uint32_t)(counter + 2),
+                                             (int)(uint32_t)(counter + 1), (int)(uint32_t)counter);
+    const __m128i counter_hi = _mm_set_epi32((int)(uint32_t)((counter + 3) >> 32), (int)(uint32_t)((counter + 2) >> 32),
+                                             (int)(uint32_t)((counter + 1) >> 32), (int)(uint32_t)(counter >> 32));
+
+    for (size_t b = 0; b < B3_CHUNK_LEN / B3_BLOCK_LEN; b++) {
+        const uint8_t *p = data + b * B3_BLOCK_LEN;
+        __m128i m[16];
+        for (int i = 0; i < 16; i++) {
+            m[i] = _mm_set_epi32((int)load32_le(p + 3 * B3_CHUNK_LEN + 4 * i), (int)load32_le(p + 2 * B3_CHUNK_LEN + 4 * i),
+                                 (int)load32_le(p + B3_CHUNK_LEN + 4 * i), (int)load32_le(p + 4 * i));
+        }
+        uint32_t flags = (b == 0 ? B3_CHUNK_START : 0) | (b == B3_CHUNK_LEN / B3_BLOCK_LEN - 1 ? B3_CHUNK_END : 0);
+
+        __m128i v[16];
+        memcpy(v, cv, sizeof(cv));
+        for (int i = 0; i < 4; i++) {
+            v[8 + i] = _mm_set1_epi32((int)sha256_iv[i]);
+        }
+        v[12] = counter_lo;
+        v[13] = counter_hi;
+        v[14] = _mm_set1_epi32(B3_BLOCK_LEN);
+        v[15] = _mm_set1_epi32((int)flags);
+
+        for (int r = 0; r < 7; r++) {
+            const uint8_t *s = b3_schedule[r];
+            B3_G4(v, 0, 4, 8, 12, m[s[0]], m[s[1]]);
+            B3_G4(v, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+            B3_G4(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+            B3_G4(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+            B3_G4(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+            B3_G4(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+            B3_G4(v, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+            B3_G4(v, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+        }
+        for (int i = 0; i < 8; i++) {
+            cv[i] = _mm_xor_si128(v[i], v[i + 8]);
+        }
+    }
+
+    uint32_t words[8][4];
+    for (int i = 0; i < 8; i++) {
+        _mm_storeu_si128((__m128i *)words[i], cv[i]);
+    }
+    for (int lane = 0; lane < 4; lane++) {
+        for (int i = 0; i < 8; i++) {
+            cvs[lane][i] = words[i][lane];
+        }
+    }
+}
+#endif
+
+static void b3_chunks(const uint8_t *data, size_t chunks, uint64_t counter, uint32_t (*cvs)[8]) {
+#ifdef HASH_HAVE_SSE2
+    for (; chunks >= 4; chunks -= 4, data += 4 * B3_CHUNK_LEN, counter += 4, cvs += 4) {
+        b3_chunks4_sse2(data, counter, cvs);
+    }
+#endif
+    b3_chunks_portable(data, chunks, counter, cvs);
+}
+
+static void b3_parent_cv(const uint32_t left[8], const uint32_t right[8], uint32_t flags, uint32_t out[16]) {
+    uint8_t block[B3_BLOCK_LEN];
+    for (int i = 0; i < 8; i++) {
+        store32_le(block + 4 * i, left[i]);
+        store32_le(block + 32 + 4 * i, right[i]);
+    }
+    b3_compress(sha256_iv, block, 0, B3_BLOCK_LEN, B3_PARENT | flags, out);
+}
+
+static void b3_init(Blake3 *s) {
+    memcpy(s->cv, sha256_iv, sizeof(s->cv));
+    s->chunk_counter = 0;
+    s->block_len = 0;
+    s->blocks_compressed = 0;
+    s->stack_len = 0;
+}
+
+/**
+ * Merge a finished chunk into the tree. The number of completed subtrees
+ * equals the number of set bits in the chunk count, so pop once per
+ * trailing zero bit.
+ */
+static void b3_push_chunk(Blake3 *s, const uint32_t cv[8]) {
+    uint32_t node[16];
+    memcpy(node, cv, 8 * sizeof(uint32_t));
+    uint64_t total = ++s->chunk_counter;
+    while ((total & 1) == 0) {
+        s->stack_len--;
+        b3_parent_cv(s->stack[s->stack_len], node, 0, node);
+        total >>= 1;
+    }
+    memcpy(s->stack[s->stack_len++], node, 8 * sizeof(uint32_t));
+}
+
+static size_t b3_chunk_len(const Blake3 *s) {
+    return s->blocks_compressed * B3_BLOCK_LEN + s->block_len;
+}
+
+static void b3_update(Blake3 *s, const uint8_t *data, size_t len) {
+    while (len > 0) {
+        if (b3_chunk_len(s) == B3_CHUNK_LEN) {
+            // More input follows, so the buffered chunk isn't the root
+            uint32_t out[16];
+            b3_compress(s->cv, s->block, s->chunk_counter, B3_BLOCK_LEN,
+                        B3_CHUNK_END | (s->blocks_compressed == 0 ? B3_CHUNK_START : 0), out);
+            b3_push_chunk(s, out);
+            memcpy(s->cv, sha256_iv, sizeof(s->cv));
+            s->block_len = 0;
+            s->blocks_compressed = 0;
+        }
+
+        // Whole chunks straight from the input, as long as one more byte follows
+        if (b3_chunk_len(s) == 0 && len > B3_CHUNK_LEN) {
+            uint32_t cvs[16][8];
+            size_t chunks = (len - 1) / B3_CHUNK_LEN;
+            if (chunks > 16) {
+                chunks = 16;
+            }
+            b3_chunks(data, chunks, s->chunk_counter, cvs);
+            for (size_t i = 0; i < chunks; i++) {
+                b3_push_chunk(s, cvs[i]);
+            }
+            data += chunks * B3_CHUNK_LEN;
+            len -= chunks * B3_CHUNK_LEN;
+            continue;
+        }
+
+        if (s->block_len == B3_BLOCK_LEN) {
+            uint32_t out[16];
+            b3_compress(s->cv, s->block, s->chunk_counter, B3_BLOCK_LEN,
+                        s->blocks_compressed == 0 ? B3_CHUNK_START : 0, out);
+            memcpy(s->cv, out, sizeof(s->cv));
+            s->blocks_compressed++;
+            s->block_len = 0;
+        }
+        size_t take = B3_BLOCK_LEN - s->block_len;
+        if (take > len) {
+            take = len;
+        }
+        memcpy(s->block + s->block_len, data, take);
+        s->block_len += take;
+        data += take;
+        len -= take;
+    }
+}
+
+static void b3_final(const Blake3 *s, uint8_t out[32]) {
+    // The current chunk's last block, then parents up the stack; the last
+    // compression gets ROOT (with output block counter 0)
+    uint32_t cv[8];
+    uint8_t block[B3_BLOCK_LEN];
+    uint64_t counter = s->chunk_counter;
+    uint32_t block_len = (uint32_t)s->block_len;
+    uint32_t flags = B3_CHUNK_END | (s->blocks_compressed == 0 ? B3_CHUNK_START : 0);
+    memcpy(cv, s->cv, sizeof(cv));
+    memset(block, 0, sizeof(block));
+    memcpy(block, s->block, s->block_len);
+
+    uint32_t words[16];
+    for (size_t i = s->stack_len; i > 0; i--) {
+        b3_compress(cv, block, counter, block_len, flags, words);
+        for (int j = 0; j < 8; j++) {
+            store32_le(block + 4 * j, s->stack[i - 1][j]);
+            store32_le(block + 32 + 4 * j, words[j]);
+        }
+        memcpy(cv, sha256_iv, sizeof(cv));
+        counter = 0;
+        block_len = B3_BLOCK_LEN;
+        flags = B3_PARENT;
+    }
+    b3_compress(cv, block, 0, block_len, flags | B3_ROOT, words);
+    for (int i = 0; i < 8; i++) {
+        store32_le(out + 4 * i, words[i]);
+    }
+}
+
+// XXH3-64 (seed 0, default secret)
+
+#define XXH_PRIME32_1 0x9E3779B1U
+#define XXH_PRIME32_2 0x85EBCA77U
+#define XXH_PRIME32_3 0xC2B2AE3DU
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+
+#define XXH_SECRET_SIZE   192
+#define XXH_STRIPE_LEN    64
+#define XXH_SECRET_CONSUME_RATE 8
+#define XXH_STRIPES_PER_BLOCK ((XXH_SECRET_SIZE - XXH_STRIPE_LEN) / XXH_SECRET_CONSUME_RATE)
+#define XXH_MIDSIZE_MAX   240
+#define XXH_BUF_SIZE      256
+
+static const uint8_t xxh_secret[XXH_SECRET_SIZE] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+typedef struct Xxh3 {
+    uint64_t acc[8];
+    uint8_t buf[XXH_BUF_SIZE];
+    size_t buffered;        // Bytes in buf
+    size_t processed;       // Leading bytes of buf already accumulated (kept for the last stripe)
+    size_t stripes;         // Stripes accumulated in the current block
+    uint64_t total;
+} Xxh3;
+
+static inline uint64_t xxh_swap64(uint64_t x) {
+    return __builtin_bswap64(x);
+}
+
+static inline uint64_t xxh_rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t xxh_mul128_fold64(uint64_t a, uint64_t b) {
+    unsigned __int128 product = (unsigned __int128)a * b;
+    return (uint64_t)product ^ (uint64_t)(product >> 64);
+}
+
+static inline uint64_t xxh_xorshift64(uint64_t v, int shift) {
+    return v ^ (v >> shift);
+}
+
+static uint64_t xxh3_avalanche(uint64_t h) {
+    h = xxh_xorshift64(h, 37);
+    h *= 0x165667919E3779F9ULL;
+    return xxh_xorshift64(h, 32);
+}
+
+static uint64_t xxh64_avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    return h ^ (h >> 32);
+}
+
+static uint64_t xxh3_rrmxmx(uint64_t h, uint64_t len) {
+    h ^= xxh_rotl64(h, 49) ^ xxh_rotl64(h, 24);
+    h *= 0x9FB21C651E98DF25ULL;
+    h ^= (h >> 35) + len;
+    h *= 0x9FB21C651E98DF25ULL;
+    return xxh_xorshift64(h, 28);
+}
+
+static uint64_t xxh3_len_1to3(const uint8_t *in, size_t len) {
+    uint8_t c1 = in[0];
+    uint8_t c2 = in[len >> 1];
+    uint8_t c3 = in[len - 1];
+    uint32_t combined = ((uint32_t)c1 << 16) | ((uint32_t)c2 << 24) | ((uint32_t)c3 << 0) | ((uint32_t)len << 8);
+    uint64_t bitflip = (uint64_t)(load32_le(xxh_secret) ^ load32_le(xxh_secret + 4));
+    return xxh64_avalanche((uint64_t)combined ^ bitflip);
+}
+
+static uint64_t xxh3_len_4to8(const uint8_t *in, size_t len) {
+    uint32_t in1 = load32_le(in);
+    uint32_t in2 = load32_le(in + len - 4);
+    uint64_t bitflip = load64_le(xxh_secret + 8) ^ load64_le(xxh_secret + 16);
+    uint64_t in64 = (uint64_t)in2 + ((uint64_t)in1 << 32);
+    return xxh3_rrmxmx(in64 ^ bitflip, len);
+}
+
+static uint64_t xxh3_len_9to16(const uint8_t *in, size_t len) {
+    uint64_t bitflip1 = load64_le(xxh_secret + 24) ^ load64_le(xxh_secret + 32);
+    uint64_t bitflip2 = load64_le(xxh_secret + 40) ^ load64_le(xxh_secret + 48);
+    uint64_t lo = load64_le(in) ^ bitflip1;
+    uint64_t hi = load64_le(in + len - 8) ^ bitflip2;
+    uint64_t acc = len + xxh_swap64(lo) + hi + xxh_mul128_fold64(lo, hi);
+    return xxh3_avalanche(acc);
+}
+
+static inline uint64_t xxh3_mix16(const uint8_t *in, const uint8_t *secret) {
+    return xxh_mul128_fold64(load64_le(in) ^ load64_le(secret), load64_le(in + 8) ^ load64_le(secret + 8));
+}
+
+static uint64_t xxh3_len_17to128(const uint8_t *in, size_t len) {
+    uint64_t acc = len * XXH_PRIME64_1;
+    if (len > 32) {
+        if (len > 64) {
+            if (len > 96) {
+                acc += xxh3_mix16(in + 48, xxh_secret + 96);
+                acc += xxh3_mix16(in + len - 64, xxh_secret + 112);
+            }
+            acc += xxh3_mix16(in + 32, xxh_secret + 64);
+            acc += xxh3_mix16(in + len - 48, xxh_secret + 80);
+        }
+        acc += xxh3_mix16(in + 16, xxh_secret + 32);
+        acc += xxh3_mix16(in + len - 32, xxh_secret + 48);
+    }
+    acc += xxh3_mix16(in, xxh_secret);
+    acc += xxh3_mix16(in + len - 16, xxh_secret + 16);
+    return xxh3_avalanche(acc);
+}
+
+static uint64_t xxh3_len_129to240(const uint8_t *in, size_t len) {
+    uint64_t acc = len * XXH_PRIME64_1;
+    size_t rounds = len / 16;
+    for (size_t i = 0; i < 8; i++) {
+        acc += xxh3_mix16(in + 16 * i, xxh_secret + 16 * i);
+    }
+    acc = xxh3_avalanche(acc);
+    for (size_t i = 8; i < rounds; i++) {
+        acc += xxh3_mix16(in + 16 * i, xxh_secret + 16 * (i - 8) + 3);
+    }
+    acc += xxh3_mix16(in + len - 16, xxh_secret + 136 - 17);
+    return xxh3_avalanche(acc);
+}
+
+static uint64_t xxh3_short(const uint8_t *in, size_t len) {
+    if (len == 0) {
+        return xxh64_avalanche(load64_le(xxh_secret + 56) ^ load64_le(xxh_secret + 64));
+    }
+    if (len <= 3) {
+        return xxh3_len_1to3(in, len);
+    }
+    if (len <= 8) {
+        return xxh3_len_4to8(in, len);
+    }
+    if (len <= 16) {
+        return xxh3_len_9to16(in, len);
+    }
+    if (len <= 128) {
+        return xxh3_len_17to128(in, len);
+    }
+    return xxh3_len_129to240(in, len);
+}
+
+#ifdef HASH_HAVE_SSE2
+static void xxh3_accumulate_sse2(uint64_t acc[8], const uint8_t *in, const uint8_t *secret) {
+    for (int i = 0; i < 4; i++) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(acc + 2 * i));
+        __m128i data = _mm_loadu_si128((const __m128i *)(in + 16 * i));
+        __m128i key = _mm_xor_si128(data, _mm_loadu_si128((const __m128i *)(secret + 16 * i)));
+        __m128i key_hi = _mm_shuffle_epi32(key, _MM_SHUFFLE(0, 3, 0, 1));
+        __m128i product = _mm_mul_epu32(key, key_hi);
+        __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+        a = _mm_add_epi64(a, _mm_add_epi64(product, swapped));
+        _mm_storeu_si128((__m128i *)(acc + 2 * i), a);
+    }
+}
+
+static void xxh3_scramble_sse2(uint64_t acc[8], const uint8_t *secret) {
+    const __m128i prime = _mm_set1_epi32((int)XXH_PRIME32_1);
+    for (int i = 0; i < 4; i++) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(acc + 2 * i));
+        a = _mm_xor_si128(a, _mm_srli_epi64(a, 47));
+        a = _mm_xor_si128(a, _mm_loadu_si128((const __m128i *)(secret + 16 * i)));
+        __m128i a_hi = _mm_shuffle_epi32(a, _MM_SHUFFLE(0, 3, 0, 1));
+        __m128i lo = _mm_mul_epu32(a, prime);
+        __m128i hi = _mm_mul_epu32(a_hi, prime);
+        _mm_storeu_si128((__m128i *)(acc + 2 * i), _mm_add_epi64(lo, _mm_slli_epi64(hi, 32)));
+    }
+}
+#define xxh3_accumulate xxh3_accumulate_sse2
+#define xxh3_scramble xxh3_scramble_sse2
+#else
+static void xxh3_accumulate_portable(uint64_t acc[8], const uint8_t *in, const uint8_t *secret) {
+    for (int lane = 0; lane < 8; lane++) {
+        uint64_t data = load64_le(in + 8 * lane);
+        uint64_t key = data ^ load64_le(secret + 8 * lane);
+        acc[lane ^ 1] += data;
+        acc[lane] += (key & 0xFFFFFFFFULL) * (key >> 32);
+    }
+}
+
+static void xxh3_scramble_portable(uint64_t acc[8], const uint8_t *secret) {
+    for (int lane = 0; lane < 8; lane++) {
+        uint64_t a = xxh_xorshift64(acc[lane], 47) ^ load64_le(secret + 8 * lane);
+        acc[lane] = a * XXH_PRIME32_1;
+    }
+}
+#define xxh3_accumulate xxh3_accumulate_portable
+#define xxh3_scramble xxh3_scramble_portable
+#endif
+
+static void xxh3_init(Xxh3 *s) {
+    static const uint64_t init_acc[8] = {
+        XXH_PRIME32_3, XXH_PRIME64_1, XXH_PRIME64_2, XXH_PRIME64_3,
+        XXH_PRIME64_4, XXH_PRIME32_2, XXH_PRIME64_5, XXH_PRIME32_1,
+    };
+    memcpy(s->acc, init_acc, sizeof(s->acc));
+    s->buffered = 0;
+    s->processed = 0;
+    s->stripes = 0;
+    s->total = 0;
+}
+
+static void xxh3_update(Xxh3 *s, const uint8_t *data, size_t len) {
+    while (len > 0) {
+        size_t take = XXH_BUF_SIZE - s->buffered;
+        if (take > len) {
+            take = len;
+        }
+        memcpy(s->buf + s->buffered, data, take);
+        s->buffered += take;
+        s->total += take;
+        data += take;
+        len -= take;
+
+        // Inputs up to 240 bytes take the short path, which needs them whole
+        if (s->total <= XXH_MIDSIZE_MAX) {
+            continue;
+        }
+
+        // A stripe is accumulated once at least one byte follows it; the
+        // final stripe is handled by xxh3_final()
+        while (s->buffered - s->processed > XXH_STRIPE_LEN) {
+            xxh3_accumulate(s->acc, s->buf + s->processed, xxh_secret + s->stripes * XXH_SECRET_CONSUME_RATE);
+            s->processed += XXH_STRIPE_LEN;
+            if (++s->stripes == XXH_STRIPES_PER_BLOCK) {
+                xxh3_scramble(s->acc, xxh_secret + XXH_SECRET_SIZE - XXH_STRIPE_LEN);
+                s->stripes = 0;
+            }
+        }
+
+        // Keep the last 64 bytes: the final stripe may overlap accumulated data
+        if (s->buffered > XXH_STRIPE_LEN) {
+            memmove(s->buf, s->buf + s->buffered - XXH_STRIPE_LEN, XXH_STRIPE_LEN);
+            s->processed -= s->buffered - XXH_STRIPE_LEN;
+            s->buffered = XXH_STRIPE_LEN;
+        }
+    }
+}
+
+static uint64_t xxh3_final(const Xxh3 *s) {
+    if (s->total <= XXH_MIDSIZE_MAX) {
+        return xxh3_short(s->buf, (size_t)s->total);
+    }
+    uint64_t acc[8];
+    memcpy(acc, s->acc, sizeof(acc));
+    xxh3_accumulate(acc, s->buf + s->buffered - XXH_STRIPE_LEN, xxh_secret + XXH_SECRET_SIZE - XXH_STRIPE_LEN - 7);
+
+    uint64_t result = s->total * XXH_PRIME64_1;
+    for (int i = 0; i < 4; i++) {
+        result += xxh_mul128_fold64(acc[2 * i] ^ load64_le(xxh_secret + 11 + 16 * i),
+                                    acc[2 * i + 1] ^ load64_le(xxh_secret + 11 + 16 * i + 8));
+    }
+    return xxh3_avalanche(result);
+}
+
+// Hasher
+
+struct ArcHasher {
+    unsigned algorithms;
+    Sha256 sha256;
+    Blake3 blake3;
+    Xxh3 xxh3;
+};
+
+ArcHasher *arc_hasher_new(unsigned algorithms) {
+    if (algorithms == 0 || (algorithms & ~ARC_HASH_ALL)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    ArcHasher *hasher = calloc(1, sizeof(ArcHasher));
+    if (!hasher) {
+        return NULL;
+    }
+    hasher->algorithms = algorithms;
+    arc_hasher_reset(hasher);
+    return hasher;
+}
+
+void arc_hasher_reset(ArcHasher *hasher) {
+    if (!hasher) {
+        return;
+    }
+    sha256_init(&hasher->sha256);
+    b3_init(&hasher->blake3);
+    xxh3_init(&hasher->xxh3);
+}
+
+void arc_hasher_update(ArcHasher *hasher, const void *data, size_t len) {
+    if (!hasher || len == 0) {
+        return;
+    }
+    if (hasher->algorithms & ARC_HASH_SHA256) {
+        sha256_update(&hasher->sha256, data, len);
+    }
+    if (hasher->algorithms & ARC_HASH_BLAKE3) {
+        b3_update(&hasher->blake3, data, len);
+    }
+    if (hasher->algorithms & ARC_HASH_XXH3) {
+        xxh3_update(&hasher->xxh3, data, len);
+    }
+}
+
+void arc_hasher_final(const ArcHasher *hasher, ArcDigests *out) {
+    if (!out) {
+        return;
+    }
+    memset(out, 0, sizeof(*out));
+    if (!hasher) {
+        return;
+    }
+    out->algorithms = hasher->algorithms;
+    if (hasher->algorithms & ARC_HASH_SHA256) {
+        sha256_final(&hasher->sha256, out->sha256);
+    }
+    if (hasher->algorithms & ARC_HASH_BLAKE3) {
+        b3_final(&hasher->blake3, out->blake3);
+    }
+    if (hasher->algorithms & ARC_HASH_XXH3) {
+        uint64_t h = xxh3_final(&hasher->xxh3);
+        store32_be(out->xxh3, (uint32_t)(h >> 32));
+        store32_be(out->xxh3 + 4, (uint32_t)h);
+    }
+}
+
+void arc_hasher_free(ArcHasher *hasher) {
+    free(hasher);
+}
+
+const char *arc_hash_name(unsigned algorithm) {
+    switch (algorithm) {
+        case ARC_HASH_SHA256: return "sha256";
+        case ARC_HASH_BLAKE3: return "blake3";
+        case ARC_HASH_XXH3: return "xxh3";
+        default: return NULL;
+    }
+}
+
+size_t arc_digest_hex(const ArcDigests *digests, unsigned algorithm, char *out, size_t out_size) {
+    if (!digests || !out || !(digests->algorithms & algorithm)) {
+        return 0;
+    }
+    const uint8_t *bytes;
+    size_t len;
+    switch (algorithm) {
+        case ARC_HASH_SHA256: bytes = digests->sha256; len = ARC_SHA256_SIZE; break;
+        case ARC_HASH_BLAKE3: bytes = digests->blake3; len = ARC_BLAKE3_SIZE; break;
+        case ARC_HASH_XXH3: bytes = digests->xxh3; len = ARC_XXH3_SIZE; break;
+        default: return 0;
+    }
+    if (out_size < 2 * len + 1) {
+        return 0;
+    }
+    static const char hex[] = "0123456789abcdef";
+    for (size_t i = 0; i < len; i++) {
+        out[2 * i] = hex[bytes[i] >> 4];
+        out[2 * i + 1] = hex[bytes[i] & 0xF];
+    }
+    out[2 * len] = '\0';
+    return 2 * len;
+}
+
+// Hashing tee stream
+
+struct HashStreamData {
+    ArcStream *source;
+    ArcHasher *hasher;
+};
+
+static ssize_t hash_read(ArcStream *stream, void *buf, size_t n) {
+    struct HashStreamData *data = (struct HashStreamData *)stream->user_data;
+
+    // Enforce byte limit
+    if (stream->byte_limit > 0) {
+        int64_t remaining = stream->byte_limit - stream->bytes_read;
+        if (remaining <= 0) {
+            return 0; // EOF (limit reached)
+        }
+        if ((int64_t)n > remaining) {
+            n = (size_t)remaining;
+        }
+    }
+
+    ssize_t got = arc_stream_read(data->source, buf, n);
+    if (got > 0) {
+        arc_hasher_update(data->hasher, buf, (size_t)got);
+        stream->bytes_read += got;
+    }
+    return got;
+}
+
+static int hash_seek(ArcStream *stream, int64_t off, int whence) {
+    (void)stream;
+    (void)off;
+    (void)whence;
+    errno = ESPIPE;
+    return -1;
+}
+
+static int64_t hash_tell(ArcStream *stream) {
+    return stream->bytes_read;
+}
+
+static void hash_close(ArcStream *stream) {
+    free(stream->user_data);
+    free(stream);
+}
+
+static const struct ArcStreamVtable hash_vtable = {
+    .read = hash_read,
+    .seek = hash_seek,
+    .tell = hash_tell,
+    .close = hash_close,
+};
+
+ArcStream *arc_stream_hash(ArcStream *source, ArcHasher *hasher) {
+    if (!source || !hasher) {
+        errno = EINVAL;
+        return NULL;
+    }
+    ArcStream *stream = calloc(1, sizeof(ArcStream));
+    if (!stream) {
+        return NULL;
+    }
+    struct HashStreamData *data = calloc(1, sizeof(struct HashStreamData));
+    if (!data) {
+        free(stream);
+        return NULL;
+    }
+    data->source = source;
+    data->hasher = hasher;
+    stream->vtable = &hash_vtable;
+    stream->user_data = data;
+    return stream;
+}
@@ -0,0 +1,95 @@
+#ifndef ARC_HASH_H
+#define ARC_HASH_H
+
+#include "arc_stream.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Content digests computed in the same pass that reads the data.
+ *
+ * - SHA-256 (SHA-NI on x86 CPUs that have it)
+ * - BLAKE3, 256-bit output (chunks hashed four at a time with SSE2)
+ * - XXH3, 64-bit, seed 0 (SSE2 stripe accumulation)
+ *
+ * Each algorithm has a portable fallback; the SIMD paths are picked at
+ * compile time (SSE2) or run time (SHA-NI) and produce identical digests.
+ */
+
+#define ARC_HASH_SHA256 0x1u
+#define ARC_HASH_BLAKE3 0x2u
+#define ARC_HASH_XXH3   0x4u
+#define ARC_HASH_ALL    (ARC_HASH_SHA256 | ARC_HASH_BLAKE3 | ARC_HASH_XXH3)
+
+#define ARC_SHA256_SIZE 32
+#define ARC_BLAKE3_SIZE 32
+#define ARC_XXH3_SIZE   8
+
+typedef struct ArcDigests {
+    unsigned algorithms;              // ARC_HASH_* bits that are filled in
+    uint8_t  sha256[ARC_SHA256_SIZE];
+    uint8_t  blake3[ARC_BLAKE3_SIZE];
+    uint8_t  xxh3[ARC_XXH3_SIZE];     // Canonical (big-endian) form, as printed by xxhsum
+} ArcDigests;
+
+typedef struct ArcHasher ArcHasher;
+
+/**
+ * Create a hasher computing the given algorithms at once.
+ *
+ * @param algorithms ARC_HASH_* bits (at least one)
+ * @return New hasher, or NULL on error (EINVAL for no/unknown algorithms)
+ */
+ArcHasher *arc_hasher_new(unsigned algorithms);
+
+/**
+ * Feed data to every algorithm of the hasher.
+ */
+void arc_hasher_update(ArcHasher *hasher, const void *data, size_t len);
+
+/**
+ * Write the digests of everything fed since creation (or the last reset).
+ * The hasher keeps its state, so more data can't be added meaningfully
+ * until arc_hasher_reset().
+ */
+void arc_hasher_final(const ArcHasher *hasher, ArcDigests *out);
+
+/**
+ * Start over with the same algorithms.
+ */
+void arc_hasher_reset(ArcHasher *hasher);
+
+/**
+ * Free a hasher.
+ */
+void arc_hasher_free(ArcHasher *hasher);
+
+/**
+ * Lower-case name of one algorithm ("sha256", "blake3", "xxh3"), or NULL.
+ */
+const char *arc_hash_name(unsigned algorithm);
+
+/**
+ * Format one digest as lower-case hex.
+ *
+ * @param digests Digests from arc_hasher_final()
+ * @param algorithm One ARC_HASH_* bit
+ * @param out Output buffer (65 bytes is enough for any algorithm)
+ * @param out_size Size of out
+ * @return Number of hex characters written, or 0 if the digest is missing
+ *         or out is too small
+ */
+size_t arc_digest_hex(const ArcDigests *digests, unsigned algorithm, char *out, size_t out_size);
+
+/**
+ * Create a hashing tee: reads pass through from source unchanged and are
+ * fed to hasher on the way. Like the decompression filters it cannot seek,
+ * and closing it closes neither the source nor the hasher.
+ *
+ * @param source Stream to read from
+ * @param hasher Hasher to update (must outlive the stream)
+ * @return New stream, or NULL on error
+ */
+ArcStream *arc_stream_hash(ArcStream *source, ArcHasher *hasher);
+
+#endif // ARC_HASH_H
@@ -0,0 +1,513 @@
+#define _POSIX_C_SOURCE 200809L
+#include "arc_index.h"
+#include "arc_stream.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <zlib.h>
+
+#define ARC_INDEX_DEFAULT_SPAN (4LL * 1024 * 1024)
+#define ARC_INDEX_MAGIC 0x58444941u  // "AIDX"
+
+ArcInflateIndex *arc_inflate_index_new(int container, int64_t span) {
+    if (container != ARC_INFLATE_GZIP && container != ARC_INFLATE_RAW) {
+        errno = EINVAL;
+        return NULL;
+    }
+    ArcInflateIndex *index = calloc(1, sizeof(*index));
+    if (!index) {
+        return NULL;
+    }
+    index->container = container;
+    index->span = span > 0 ? span : ARC_INDEX_DEFAULT_SPAN;
+    return index;
+}
+
+void arc_inflate_index_free(ArcInflateIndex *index) {
+    if (!index) {
+        return;
+    }
+    for (size_t i = 0; i < index->count; i++) {
+        free(index->points[i].window);
+    }
+    free(index->points);
+    free(index);
+}
+
+static int index_append(ArcInflateIndex *index, int64_t out, int64_t in, int bits,
+                        uint8_t *window, uint32_t window_len) {
+    if (index->count >= index->capacity) {
+        size_t new_capacity = index->capacity == 0 ? 16 : index->capacity * 2;
+        ArcInflatePoint *points = realloc(index->points, new_capacity * sizeof(*points));
+        if (!points) {
+            return -1;
+        }
+        index->points = points;
+        index->capacity = new_capacity;
+    }
+    ArcInflatePoint *p = &index->points[index->count++];
+    p->out = out;
+    p->in = in;
+    p->bits = bits;
+    p->window = window;
+    p->window_len = window_len;
+    return 0;
+}
+
+int arc_inflate_index_note(ArcInflateIndex *index, void *zs_ptr, int64_t in_base) {
+    if (!index || !zs_ptr) {
+        return 0;
+    }
+    z_stream *zs = (z_stream *)zs_ptr;
+
+    // Only block boundaries are restartable, and never inside the last block
+    if (!(zs->data_type & 128) || (zs->data_type & 64)) {
+        return 0;
+    }
+
+    int64_t out = (int64_t)zs->total_out;
+    int64_t last = index->count > 0 ? index->points[index->count - 1].out : 0;
+    if (out - last < index->span) {
+        return 0;
+    }
+
+    uint8_t *window = malloc(ARC_INFLATE_WINDOW_SIZE);
+    if (!window) {
+        return -1;
+    }
+    uInt window_len = 0;
+    if (inflateGetDictionary(zs, window, &window_len) != Z_OK) {
+        free(window);
+        return 0; // Not fatal: this boundary just doesn't get a checkpoint
+    }
+
+    if (index_append(index, out, in_base + (int64_t)zs->total_in, zs->data_type & 7,
+                     window, (uint32_t)window_len) < 0) {
+        free(window);
+        return -1;
+    }
+    return 0;
+}
+
+void arc_inflate_index_trim(ArcInflateIndex *index, int64_t offset) {
+    if (!index) {
+        return;
+    }
+    const ArcInflatePoint *keep = arc_inflate_index_lookup(index, offset);
+    if (!keep) {
+        return;
+    }
+    size_t first = (size_t)(keep - index->points);
+    for (size_t i = 0; i < first; i++) {
+        free(index->points[i].window);
+    }
+    memmove(index->points, index->points + first, (index->count - first) * sizeof(ArcInflatePoint));
+    index->count -= first;
+}
+
+const ArcInflatePoint *arc_inflate_index_lookup(const ArcInflateIndex *index, int64_t offset) {
+    if (!index || index->count == 0) {
+        return NULL;
+    }
+    // Binary search for the last point with out <= offset
+    size_t lo = 0;
+    size_t hi = index->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (index->points[mid].out <= offset) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo == 0 ? NULL : &index->points[lo - 1];
+}
+
+int arc_inflate_next_member(void *zs_ptr, bool raw, ArcInflateRefill refill, void *user) {
+    z_stream *zs = (z_stream *)zs_ptr;
+    // A raw decode stops at the end of the deflate data, before the trailer
+    uInt trailer = raw ? 8 : 0;
+    while (zs->avail_in < trailer + 2) {
+        ssize_t got = refill(user);
+        if (got < 0) {
+            return -1;
+        }
+        if (got == 0) {
+            return 0;
+        }
+    }
+    zs->next_in += trailer;
+    zs->avail_in -= trailer;
+    zs->total_in += trailer;
+    if (zs->next_in[0] != 0x1f || zs->next_in[1] != 0x8b) {
+        return 0;
+    }
+    uLong total_in = zs->total_in;
+    uLong total_out = zs->total_out;
+    if (inflateReset2(zs, 16 + MAX_WBITS) != Z_OK) {
+        return -1;
+    }
+    zs->total_in = total_in;
+    zs->total_out = total_out;
+    return 1;
+}
+
+// Stream that inflates from a checkpoint and discards up to the requested offset
+static ssize_t indexed_read(ArcStream *stream, void *buf, size_t n);
+static int indexed_seek(ArcStream *stream, int64_t off, int whence);
+static int64_t indexed_tell(ArcStream *stream);
+static void indexed_close(ArcStream *stream);
+
+static const struct ArcStreamVtable indexed_vtable = {
+    .read = indexed_read,
+    .seek = indexed_seek,
+    .tell = indexed_tell,
+    .close = indexed_close,
+};
+
+struct IndexedInflateData {
+    ArcStream *compressed;
+    z_stream zs;
+    int container;      // ARC_INFLATE_*: gzip continues across members
+    bool raw;           // zs decodes raw deflate (started at a checkpoint)
+    bool initialized;
+    bool eof;
+    uint8_t *in_buf;
+    size_t in_buf_size;
+    int64_t in_pos;     // Next compressed offset to read (we seek before every refill)
+    int64_t skip;       // Output bytes still to discard before serving data
+};
+
+static ssize_t indexed_refill(void *user) {
+    struct IndexedInflateData *data = user;
+    size_t have = data->zs.avail_in;
+    if (have > 0) {
+        memmove(data->in_buf, data->zs.next_in, have);
+    }
+    if (arc_stream_seek(data->compressed, data->in_pos, SEEK_SET) < 0) {
+        return -1;
+    }
+    ssize_t got = arc_stream_read(data->compressed, data->in_buf + have, data->in_buf_size - have);
+    if (got < 0) {
+        return -1;
+    }
+    data->in_pos += got;
+    data->zs.next_in = data->in_buf;
+    data->zs.avail_in = (uInt)(have + (size_t)got);
+    return got;
+}
+
+static ssize_t indexed_inflate(struct IndexedInflateData *data, uint8_t *buf, size_t n) {
+    if (data->eof) {
+        return 0;
+    }
+    data->zs.next_out = buf;
+    data->zs.avail_out = (uInt)n;
+
+    while (data->zs.avail_out > 0 && !data->eof) {
+        if (data->zs.avail_in == 0) {
+            // The compressed stream may be shared with other cursors; never
+            // rely on its current position.
+            if (arc_stream_seek(data->compressed, data->in_pos, SEEK_SET) < 0) {
+                return -1;
+            }
+            ssize_t in_read = arc_stream_read(data->compressed, data->in_buf, data->in_buf_size);
+            if (in_read < 0) {
+                return -1;
+            }
+            if (in_read == 0) {
+                if (n - data->zs.avail_out > 0) {
+                    break; // Hand out what we have; the next call reports truncation
+                }
+                errno = EINVAL;
+                return -1;
+            }
+            data->in_pos += in_read;
+            data->zs.next_in = data->in_buf;
+            data->zs.avail_in = (uInt)in_read;
+        }
+
+        int ret = inflate(&data->zs, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END) {
+            int more = data->container == ARC_INFLATE_GZIP
+                           ? arc_inflate_next_member(&data->zs, data->raw, indexed_refill, data)
+                           : 0;
+            if (more < 0) {
+                return -1;
+            }
+            if (more == 0) {
+                data->eof = true;
+                break;
+            }
+            data->raw = false;
+            continue;
+        }
+        if (ret == Z_BUF_ERROR) {
+            continue; // Needs more input
+        }
+        if (ret != Z_OK) {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+
+    return (ssize_t)(n - data->zs.avail_out);
+}
+
+static ssize_t indexed_read(ArcStream *stream, void *buf, size_t n) {
+    struct IndexedInflateData *data = (struct IndexedInflateData *)stream->user_data;
+
+    // Enforce byte limit
+    if (stream->byte_limit > 0) {
+        int64_t remaining = stream->byte_limit - stream->bytes_read;
+        if (remaining <= 0) {
+            return 0; // EOF (limit reached)
+        }
+        if ((int64_t)n > remaining) {
+            n = (size_t)remaining;
+        }
+    }
+    if (n == 0) {
+        return 0;
+    }
+
+    // Discard output between the checkpoint and the requested offset
+    while (data->skip > 0) {
+        size_t chunk = (data->skip < (int64_t)n) ? (size_t)data->skip : n;
+        ssize_t got = indexed_inflate(data, buf, chunk);
+        if (got < 0) {
+            return -1;
+        }
+        if (got == 0) {
+            return 0; // Offset is past the end of the stream
+        }
+        data->skip -= got;
+    }
+
+    ssize_t got = indexed_inflate(data, buf, n);
+    if (got > 0) {
+        stream->bytes_read += got;
+    }
+    return got;
+}
+
+static int indexed_seek(ArcStream *stream, int64_t off, int whence) {
+    (void)stream;
+    (void)off;
+    (void)whence;
+    errno = ESPIPE;
+    return -1;
+}
+
+static int64_t indexed_tell(ArcStream *stream) {
+    return stream->bytes_read;
+}
+
+static void indexed_close(ArcStream *stream) {
+    struct IndexedInflateData *data = (struct IndexedInflateData *)stream->user_data;
+    if (data) {
+        if (data->initialized) {
+            inflateEnd(&data->zs);
+        }
+        free(data->in_buf);
+        // Note: We don't close the compressed stream - caller owns it
+        free(data);
+    }
+    free(stream);
+}
+
+ArcStream *arc_inflate_index_open(const ArcInflateIndex *index, int container,
+                                  ArcStream *compressed, int64_t in_base,
+                                  int64_t offset, int64_t length) {
+    if (!compressed || offset < 0 || length < 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (index) {
+        container = index->container;
+    }
+
+    struct IndexedInflateData *data = calloc(1, sizeof(*data));
+    if (!data) {
+        return NULL;
+    }
+    data->compressed = compressed;
+    data->in_buf_size = 64 * 1024;
+    data->in_buf = malloc(data->in_buf_size);
+    if (!data->in_buf) {
+        free(data);
+        return NULL;
+    }
+
+    const ArcInflatePoint *point = arc_inflate_index_lookup(index, offset);
+    int wbits = point ? -MAX_WBITS : (container == ARC_INFLATE_GZIP ? 16 + MAX_WBITS : -MAX_WBITS);
+    if (inflateInit2(&data->zs, wbits) != Z_OK) {
+        free(data->in_buf);
+        free(data);
+        return NULL;
+    }
+    data->initialized = true;
+    data->container = container;
+    data->raw = wbits < 0;
+
+    if (point) {
+        data->in_pos = point->in;
+        if (point->bits) {
+            // The boundary falls inside a byte: feed its remaining high bits first
+            uint8_t byte;
+            if (arc_stream_seek(compressed, point->in - 1, SEEK_SET) < 0 ||
+                arc_stream_read(compressed, &byte, 1) != 1 ||
+                inflatePrime(&data->zs, point->bits, byte >> (8 - point->bits)) != Z_OK) {
+                inflateEnd(&data->zs);
+                free(data->in_buf);
+                free(data);
+                errno = EIO;
+                return NULL;
+            }
+        }
+        if (point->window_len > 0 &&
+            inflateSetDictionary(&data->zs, point->window, point->window_len) != Z_OK) {
+            inflateEnd(&data->zs);
+            free(data->in_buf);
+            free(data);
+            errno = EINVAL;
+            return NULL;
+        }
+        data->skip = offset - point->out;
+    } else {
+        data->in_pos = in_base;
+        data->skip = offset;
+    }
+
+    ArcStream *stream = calloc(1, sizeof(*stream));
+    if (!stream) {
+        inflateEnd(&data->zs);
+        free(data->in_buf);
+        free(data);
+        return NULL;
+    }
+    stream->vtable = &indexed_vtable;
+    stream->byte_limit = length;
+    stream->bytes_read = 0;
+    stream->user_data = data;
+    return stream;
+}
+
+// Serialization helpers (little-endian, fixed width)
+static int put_u32(FILE *out, uint32_t v) {
+    uint8_t b[4] = { (uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24) };
+    return fwrite(b, 1, sizeof(b), out) == sizeof(b) ? 0 : -1;
+}
+
+static int put_u64(FILE *out, uint64_t v) {
+    if (put_u32(out, (uint32_t)v) < 0) return -1;
+    return put_u32(out, (uint32_t)(v >> 32));
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t get_u64(const uint8_t *p) {
+    return (uint64_t)get_u32(p) | ((uint64_t)get_u32(p + 4) << 32);
+}
+
+int arc_inflate_index_write(const ArcInflateIndex *index, FILE *out) {
+    if (!index || !out) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (put_u32(out, ARC_INDEX_MAGIC) < 0 ||
+        put_u32(out, (uint32_t)index->container) < 0 ||
+        put_u64(out, (uint64_t)index->span) < 0 ||
+        put_u64(out, (uint64_t)index->count) < 0) {
+        return -1;
+    }
+
+    uLongf bound = compressBound(ARC_INFLATE_WINDOW_SIZE);
+    uint8_t *zbuf = malloc(bound);
+    if (!zbuf) {
+        return -1;
+    }
+    for (size_t i = 0; i < index->count; i++) {
+        const ArcInflatePoint *p = &index->points[i];
+        uLongf zlen = bound;
+        if (compress2(zbuf, &zlen, p->window, p->window_len, Z_DEFAULT_COMPRESSION) != Z_OK) {
+            free(zbuf);
+            return -1;
+        }
+        if (put_u64(out, (uint64_t)p->out) < 0 ||
+            put_u64(out, (uint64_t)p->in) < 0 ||
+            put_u32(out, (uint32_t)p->bits) < 0 ||
+            put_u32(out, p->window_len) < 0 ||
+            put_u32(out, (uint32_t)zlen) < 0 ||
+            fwrite(zbuf, 1, zlen, out) != zlen) {
+            free(zbuf);
+            return -1;
+        }
+    }
+    free(zbuf);
+    return 0;
+}
+
+ArcInflateIndex *arc_inflate_index_parse(const uint8_t *buf, size_t size, size_t *consumed) {
+    size_t pos = 0;
+    if (!buf || size < 24 || get_u32(buf) != ARC_INDEX_MAGIC) {
+        errno = EINVAL;
+        return NULL;
+    }
+    int container = (int)get_u32(buf + 4);
+    int64_t span = (int64_t)get_u64(buf + 8);
+    uint64_t count = get_u64(buf + 16);
+    pos = 24;
+
+    ArcInflateIndex *index = arc_inflate_index_new(container, span);
+    if (!index) {
+        return NULL;
+    }
+
+    for (uint64_t i = 0; i < count; i++) {
+        if (size - pos < 28) {
+            goto malformed;
+        }
+        int64_t out = (int64_t)get_u64(buf + pos);
+        int64_t in = (int64_t)get_u64(buf + pos + 8);
+        uint32_t bits = get_u32(buf + pos + 16);
+        uint32_t window_len = get_u32(buf + pos + 20);
+        uint32_t zlen = get_u32(buf + pos + 24);
+        pos += 28;
+        if (bits > 7 || window_len > ARC_INFLATE_WINDOW_SIZE || zlen > size - pos || in < 0 ||
+            (index->count > 0 && out <= index->points[index->count - 1].out)) {
+            goto malformed;
+        }
+
+        uint8_t *window = malloc(window_len ? window_len : 1);
+        if (!window) {
+            arc_inflate_index_free(index);
+            return NULL;
+        }
+        uLongf wlen = window_len;
+        if (uncompress(window, &wlen, buf + pos, zlen) != Z_OK || wlen != window_len) {
+            free(window);
+            goto malformed;
+        }
+        pos += zlen;
+
+        if (index_append(index, out, in, (int)bits, window, window_len) < 0) {
+            free(window);
+            arc_inflate_index_free(index);
+            return NULL;
+        }
+    }
+
+    if (consumed) {
+        *consumed = pos;
+    }
+    return index;
+
+malformed:
+    arc_inflate_index_free(index);
+    errno = EINVAL;
+    return NULL;
+}
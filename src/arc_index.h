@@ -0,0 +1,147 @@
+#ifndef ARC_INDEX_H
+#define ARC_INDEX_H
+
+#include "arc_stream.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+/**
+ * Inflate checkpoint index (zran-style).
+ *
+ * A deflate stream can only be decoded from the start, because every block
+ * may reference the previous 32 KB of output. A checkpoint records the
+ * decoder state at a block boundary (compressed offset, pending bits and the
+ * 32 KB window) so decoding can restart there instead of at byte zero.
+ *
+ * Checkpoints are recorded while a stream is decoded anyway (see
+ * arc_filter_gzip_set_index()) and are used to open the uncompressed data at
+ * an arbitrary offset.
+ */
+
+#define ARC_INFLATE_WINDOW_SIZE 32768
+
+// Container the index was built over
+#define ARC_INFLATE_GZIP 0   // gzip wrapper (header parsed when starting at offset 0)
+#define ARC_INFLATE_RAW  1   // raw deflate (ZIP entries)
+
+typedef struct ArcInflatePoint {
+    int64_t out;        // Uncompressed offset of the checkpoint
+    int64_t in;         // Compressed offset of the first full byte after the boundary
+    int bits;           // Number of bits of the byte at in-1 still to be consumed (0-7)
+    uint32_t window_len;
+    uint8_t *window;    // Last window_len bytes of output before `out`
+} ArcInflatePoint;
+
+typedef struct ArcInflateIndex {
+    int container;            // ARC_INFLATE_GZIP or ARC_INFLATE_RAW
+    int64_t span;             // Minimum uncompressed distance between checkpoints
+    ArcInflatePoint *points;  // Sorted by `out`
+    size_t count;
+    size_t capacity;
+} ArcInflateIndex;
+
+/**
+ * Create an empty index.
+ *
+ * @param container ARC_INFLATE_GZIP or ARC_INFLATE_RAW
+ * @param span Minimum uncompressed distance between checkpoints (0 = 4 MiB)
+ * @return New index, or NULL on allocation failure
+ */
+ArcInflateIndex *arc_inflate_index_new(int container, int64_t span);
+
+/**
+ * Free an index and all of its windows.
+ */
+void arc_inflate_index_free(ArcInflateIndex *index);
+
+/**
+ * Record a checkpoint if the decoder sits on a block boundary and enough
+ * output has been produced since the last one.
+ *
+ * @param index Index to extend
+ * @param zs Pointer to the z_stream driving the decode (inflate must have been
+ *           called with Z_BLOCK so that it stops on block boundaries)
+ * @param in_base Compressed offset corresponding to zs->total_in == 0
+ * @return 0 on success (including "nothing recorded"), -1 on allocation failure
+ */
+int arc_inflate_index_note(ArcInflateIndex *index, void *zs, int64_t in_base);
+
+/**
+ * Find the checkpoint closest to (but not after) an uncompressed offset.
+ *
+ * @return Checkpoint, or NULL if decoding must start from the beginning
+ */
+const ArcInflatePoint *arc_inflate_index_lookup(const ArcInflateIndex *index, int64_t offset);
+
+/**
+ * Drop checkpoints before `offset` that arc_inflate_index_lookup() would
+ * never pick for reads at or after it (the last one before it is kept).
+ */
+void arc_inflate_index_trim(ArcInflateIndex *index, int64_t offset);
+
+/**
+ * Input callback for arc_inflate_next_member(): move the z_stream's unread
+ * input (next_in/avail_in) to the front of the caller's buffer, append more
+ * after it and point next_in/avail_in at the result.
+ *
+ * @return Bytes appended, 0 at the end of the input, -1 on error
+ */
+typedef ssize_t (*ArcInflateRefill)(void *user);
+
+/**
+ * Continue a gzip decode after a member ended (Z_STREAM_END).
+ *
+ * Multi-member files (`cat a.gz b.gz`, pigz/bgzip output) decode as the
+ * concatenation of their members, as with gzip -d. If the next input bytes
+ * start another gzip member, `zs` is reset to decode it in gzip mode;
+ * total_in and total_out keep counting from the first member, so offsets
+ * (and checkpoints noted with arc_inflate_index_note()) stay absolute.
+ * Anything else after a member ends the data, as gzip -d ignores trailing
+ * garbage.
+ *
+ * @param zs z_stream that returned Z_STREAM_END
+ * @param raw Whether zs decodes raw deflate (resumed from a checkpoint), so
+ *            the member's 8-byte trailer is still unread
+ * @param refill Fetches more input (see ArcInflateRefill)
+ * @param user Passed to refill
+ * @return 1 if another member follows, 0 at the end of the data, -1 on error
+ */
+int arc_inflate_next_member(void *zs, bool raw, ArcInflateRefill refill, void *user);
+
+/**
+ * Open the uncompressed data at `offset` using the nearest checkpoint.
+ * Gzip data continues across members (see arc_inflate_next_member()).
+ *
+ * @param index Checkpoints (may be NULL: decode from the start)
+ * @param container ARC_INFLATE_GZIP or ARC_INFLATE_RAW (used when index is NULL)
+ * @param compressed Seekable compressed stream (offsets are absolute in it;
+ *                   must remain valid for the returned stream's lifetime)
+ * @param in_base Compressed offset where the deflate/gzip data starts
+ * @param offset Uncompressed offset to start at
+ * @param length Maximum bytes the returned stream may produce
+ * @return Stream of uncompressed data, or NULL on error
+ */
+ArcStream *arc_inflate_index_open(const ArcInflateIndex *index, int container,
+                                  ArcStream *compressed, int64_t in_base,
+                                  int64_t offset, int64_t length);
+
+/**
+ * Serialize an index (windows are deflated to keep the file small).
+ *
+ * @return 0 on success, -1 on error
+ */
+int arc_inflate_index_write(const ArcInflateIndex *index, FILE *out);
+
+/**
+ * Deserialize an index from a memory buffer produced by arc_inflate_index_write().
+ *
+ * @param buf Buffer to parse
+ * @param size Buffer size
+ * @param consumed Output: bytes consumed from buf
+ * @return New index, or NULL on error (errno = EINVAL for malformed data)
+ */
+ArcInflateIndex *arc_inflate_index_parse(const uint8_t *buf, size_t size, size_t *consumed);
+
+#endif // ARC_INDEX_H
@@ -0,0 +1,573 @@
+#define _POSIX_C_SOURCE 200809L
+#include "arc_match.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+
+// Cached DFA states per pattern set; past this, matching falls back to the NFA
+#define MATCH_MAX_DFA_STATES 1024
+#define MATCH_DFA_SLOTS (2 * MATCH_MAX_DFA_STATES)
+
+// Glob tokens: token i is what NFA state i consumes next
+#define TOK_LITERAL 0
+#define TOK_ANY     1   // ?
+#define TOK_CLASS   2   // [...]
+#define TOK_STAR    3   // * (loops on itself, may also be skipped)
+#define TOK_END     4   // Pattern matched
+
+typedef struct MatchToken {
+    uint8_t type;
+    uint8_t c;          // TOK_LITERAL
+    uint32_t cls;       // TOK_CLASS: index into classes
+} MatchToken;
+
+typedef struct MatchClass {
+    uint64_t bits[4];
+} MatchClass;
+
+// Trie over literal patterns; node 0 is the root, 0 also means "none"
+typedef struct TrieNode {
+    uint32_t child;
+    uint32_t sibling;
+    uint8_t c;
+    bool terminal;
+} TrieNode;
+
+typedef struct PatternSet {
+    size_t count;           // Patterns in the set
+    bool match_all;         // An empty pattern ("", ".", "/") selects everything
+
+    TrieNode *trie;
+    size_t trie_count;
+
+    // All glob patterns as one NFA
+    MatchToken *tokens;
+    size_t token_count;
+    MatchClass *classes;
+    size_t class_count;
+    uint64_t *start;        // Closure of every pattern's first state
+    uint64_t *accept;       // TOK_END states
+    size_t words;           // uint64_t words per NFA state set
+
+    // Lazy DFA: state i is the NFA state set dfa_sets[i * words]
+    uint64_t *dfa_sets;
+    int32_t *dfa_next;      // [state * 256 + byte], -1 = not computed yet
+    bool *dfa_accept;
+    bool *dfa_dead;         // Empty set: nothing can match any more
+    size_t dfa_count;
+    int32_t *dfa_slots;     // Open-addressing table of state ids, -1 = empty
+    uint64_t *scratch;
+    uint64_t *scratch2;
+} PatternSet;
+
+struct ArcMatcher {
+    PatternSet include;
+    PatternSet exclude;
+};
+
+/**
+ * Skip leading "./" and "/", and drop trailing '/'.
+ */
+static const char *normalize(const char *path, size_t *len) {
+    for (;;) {
+        if (path[0] == '/') {
+            path++;
+        } else if (path[0] == '.' && path[1] == '/') {
+            path += 2;
+        } else {
+            break;
+        }
+    }
+    size_t n = strlen(path);
+    if (n == 1 && path[0] == '.') {
+        n = 0;
+    }
+    while (n > 0 && path[n - 1] == '/') {
+        n--;
+    }
+    *len = n;
+    return path;
+}
+
+static void *grow(void *array, size_t count, size_t *capacity, size_t size) {
+    if (count < *capacity) {
+        return array;
+    }
+    size_t grown = *capacity ? *capacity * 2 : 16;
+    void *p = realloc(array, grown * size);
+    if (p) {
+        *capacity = grown;
+    }
+    return p;
+}
+
+static int trie_insert(PatternSet *set, size_t *capacity, const char *literal, size_t len) {
+    if (set->trie_count == 0) {
+        set->trie = grow(set->trie, 0, capacity, sizeof(TrieNode));
+        if (!set->trie) {
+            return -1;
+        }
+        memset(&set->trie[0], 0, sizeof(TrieNode));
+        set->trie_count = 1;
+    }
+    uint32_t node = 0;
+    for (size_t i = 0; i < len; i++) {
+        uint8_t c = (uint8_t)literal[i];
+        uint32_t child = set->trie[node].child;
+        while (child && set->trie[child].c != c) {
+            child = set->trie[child].sibling;
+        }
+        if (!child) {
+            TrieNode *trie = grow(set->trie, set->trie_count, capacity, sizeof(TrieNode));
+            if (!trie) {
+                return -1;
+            }
+            set->trie = trie;
+            child = (uint32_t)set->trie_count++;
+            trie[child] = (TrieNode){ 0, trie[node].child, c, false };
+            trie[node].child = child;
+        }
+        node = child;
+    }
+    set->trie[node].terminal = true;
+    return 0;
+}
+
+/**
+ * Whether a path, or one of its leading directories, is a literal pattern.
+ */
+static bool trie_match(const PatternSet *set, const char *path, size_t len) {
+    if (set->trie_count == 0) {
+        return false;
+    }
+    uint32_t node = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (path[i] == '/' && node != 0 && set->trie[node].terminal) {
+            return true;
+        }
+        uint32_t child = set->trie[node].child;
+        while (child && set->trie[child].c != (uint8_t)path[i]) {
+            child = set->trie[child].sibling;
+        }
+        if (!child) {
+            return false;
+        }
+        node = child;
+    }
+    return set->trie[node].terminal;
+}
+
+/**
+ * Parse a [...] class starting at p[i] == '['.
+ *
+ * @return Index just past the closing ']', or 0 if the class isn't closed
+ */
+static size_t parse_class(const char *p, size_t len, size_t i, MatchClass *cls) {
+    memset(cls, 0, sizeof(*cls));
+    size_t j = i + 1;
+    bool negate = j < len && (p[j] == '!' || p[j] == '^');
+    if (negate) {
+        j++;
+    }
+    size_t first = j;
+    while (j < len && (p[j] != ']' || j == first)) {
+        uint8_t lo = (uint8_t)p[j];
+        if (p[j] == '\\' && j + 1 < len) {
+            lo = (uint8_t)p[++j];
+        }
+        uint8_t hi = lo;
+        if (j + 2 < len && p[j + 1] == '-' && p[j + 2] != ']') {
+            j += 2;
+            hi = (uint8_t)p[j];
+            if (p[j] == '\\' && j + 1 < len) {
+                hi = (uint8_t)p[++j];
+            }
+        }
+        for (unsigned c = lo; c <= hi; c++) {
+            cls->bits[c >> 6] |= 1ULL << (c & 63);
+        }
+        j++;
+    }
+    if (j >= len) {
+        return 0;
+    }
+    if (negate) {
+        for (int w = 0; w < 4; w++) {
+            cls->bits[w] = ~cls->bits[w];
+        }
+    }
+    return j + 1;
+}
+
+static bool is_glob(const char *p, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (p[i] == '\\') {
+            i++;
+        } else if (p[i] == '*' || p[i] == '?') {
+            return true;
+        } else if (p[i] == '[') {
+            MatchClass cls;
+            if (parse_class(p, len, i, &cls)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+typedef struct SetBuilder {
+    size_t trie_capacity;
+    size_t token_capacity;
+    size_t class_capacity;
+} SetBuilder;
+
+static int add_token(PatternSet *set, SetBuilder *b, uint8_t type, uint8_t c, uint32_t cls) {
+    MatchToken *tokens = grow(set->tokens, set->token_count, &b->token_capacity, sizeof(MatchToken));
+    if (!tokens) {
+        return -1;
+    }
+    set->tokens = tokens;
+    tokens[set->token_count++] = (MatchToken){ type, c, cls };
+    return 0;
+}
+
+static int compile_glob(PatternSet *set, SetBuilder *b, const char *p, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        int rc;
+        if (p[i] == '*') {
+            // Runs of stars are one star
+            bool run = i > 0 && p[i - 1] == '*' && set->tokens[set->token_count - 1].type == TOK_STAR;
+            rc = run ? 0 : add_token(set, b, TOK_STAR, 0, 0);
+        } else if (p[i] == '?') {
+            rc = add_token(set, b, TOK_ANY, 0, 0);
+        } else if (p[i] == '[') {
+            MatchClass cls;
+            size_t end = parse_class(p, len, i, &cls);
+            if (end) {
+                MatchClass *classes = grow(set->classes, set->class_count, &b->class_capacity, sizeof(MatchClass));
+                if (!classes) {
+                    return -1;
+                }
+                set->classes = classes;
+                classes[set->class_count] = cls;
+                rc = add_token(set, b, TOK_CLASS, 0, (uint32_t)set->class_count++);
+                i = end - 1;
+            } else {
+                rc = add_token(set, b, TOK_LITERAL, '[', 0);
+            }
+        } else {
+            if (p[i] == '\\' && i + 1 < len) {
+                i++;
+            }
+            rc = add_token(set, b, TOK_LITERAL, (uint8_t)p[i], 0);
+        }
+        if (rc < 0) {
+            return -1;
+        }
+    }
+    return add_token(set, b, TOK_END, 0, 0);
+}
+
+static void nfa_add(const PatternSet *set, uint64_t *bits, size_t state) {
+    for (;;) {
+        uint64_t bit = 1ULL << (state & 63);
+        if (bits[state >> 6] & bit) {
+            return;
+        }
+        bits[state >> 6] |= bit;
+        if (set->tokens[state].type != TOK_STAR) {
+            return;
+        }
+        state++;  // A star may match nothing
+    }
+}
+
+static void nfa_step(const PatternSet *set, const uint64_t *from, uint64_t *to, uint8_t c) {
+    memset(to, 0, set->words * sizeof(uint64_t));
+    for (size_t w = 0; w < set->words; w++) {
+        uint64_t x = from[w];
+        while (x) {
+            size_t state = w * 64 + (size_t)__builtin_ctzll(x);
+            x &= x - 1;
+            const MatchToken *t = &set->tokens[state];
+            switch (t->type) {
+                case TOK_LITERAL:
+                    if (t->c == c) {
+                        nfa_add(set, to, state + 1);
+                    }
+                    break;
+                case TOK_ANY:
+                    nfa_add(set, to, state + 1);
+                    break;
+                case TOK_CLASS:
+                    if (set->classes[t->cls].bits[c >> 6] & (1ULL << (c & 63))) {
+                        nfa_add(set, to, state + 1);
+                    }
+                    break;
+                case TOK_STAR:
+                    nfa_add(set, to, state);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+}
+
+static bool nfa_accepting(const PatternSet *set, const uint64_t *bits) {
+    for (size_t w = 0; w < set->words; w++) {
+        if (bits[w] & set->accept[w]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool nfa_empty(const PatternSet *set, const uint64_t *bits) {
+    for (size_t w = 0; w < set->words; w++) {
+        if (bits[w]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint64_t set_hash(const uint64_t *bits, size_t words) {
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t w = 0; w < words; w++) {
+        h ^= bits[w];
+        h *= 1099511628211ULL;
+        h ^= h >> 29;
+    }
+    return h;
+}
+
+/**
+ * DFA state for an NFA state set, created if needed.
+ *
+ * @return State id, or -1 if the cache is full (or out of memory)
+ */
+static int32_t dfa_state(PatternSet *set, const uint64_t *bits) {
+    size_t pos = (size_t)set_hash(bits, set->words) & (MATCH_DFA_SLOTS - 1);
+    while (set->dfa_slots[pos] >= 0) {
+        int32_t id = set->dfa_slots[pos];
+        if (memcmp(&set->dfa_sets[(size_t)id * set->words], bits, set->words * sizeof(uint64_t)) == 0) {
+            return id;
+        }
+        pos = (pos + 1) & (MATCH_DFA_SLOTS - 1);
+    }
+    if (set->dfa_count == MATCH_MAX_DFA_STATES) {
+        return -1;
+    }
+    size_t id = set->dfa_count;
+    if ((id & (id - 1)) == 0) {
+        // Power of two: double the per-state arrays
+        size_t capacity = id ? id * 2 : 1;
+        uint64_t *sets = realloc(set->dfa_sets, capacity * set->words * sizeof(uint64_t));
+        if (sets) {
+            set->dfa_sets = sets;
+        }
+        int32_t *next = realloc(set->dfa_next, capacity * 256 * sizeof(int32_t));
+        if (next) {
+            set->dfa_next = next;
+        }
+        bool *accept = realloc(set->dfa_accept, capacity * sizeof(bool));
+        if (accept) {
+            set->dfa_accept = accept;
+        }
+        bool *dead = realloc(set->dfa_dead, capacity * sizeof(bool));
+        if (dead) {
+            set->dfa_dead = dead;
+        }
+        if (!sets || !next || !accept || !dead) {
+            return -1;
+        }
+    }
+    memcpy(&set->dfa_sets[id * set->words], bits, set->words * sizeof(uint64_t));
+    for (size_t c = 0; c < 256; c++) {
+        set->dfa_next[id * 256 + c] = -1;
+    }
+    set->dfa_accept[id] = nfa_accepting(set, bits);
+    set->dfa_dead[id] = nfa_empty(set, bits);
+    set->dfa_slots[pos] = (int32_t)id;
+    set->dfa_count++;
+    return (int32_t)id;
+}
+
+/**
+ * Finish matching on NFA state sets once the DFA cache is full.
+ */
+static bool nfa_match(PatternSet *set, const char *path, size_t len) {
+    uint64_t *cur = set->scratch;
+    uint64_t *next = set->scratch2;
+    for (size_t i = 0; i < len; i++) {
+        if (path[i] == '/' && nfa_accepting(set, cur)) {
+            return true;
+        }
+        nfa_step(set, cur, next, (uint8_t)path[i]);
+        uint64_t *tmp = cur;
+        cur = next;
+        next = tmp;
+        if (nfa_empty(set, cur)) {
+            return false;
+        }
+    }
+    return nfa_accepting(set, cur);
+}
+
+static bool glob_match(PatternSet *set, const char *path, size_t len) {
+    if (set->token_count == 0) {
+        return false;
+    }
+    int32_t state = 0;  // The start state is interned first
+    for (size_t i = 0; i < len; i++) {
+        if (path[i] == '/' && set->dfa_accept[state]) {
+            return true;  // A leading directory matched
+        }
+        uint8_t c = (uint8_t)path[i];
+        int32_t next = set->dfa_next[(size_t)state * 256 + c];
+        if (next < 0) {
+            nfa_step(set, &set->dfa_sets[(size_t)state * set->words], set->scratch, c);
+            next = dfa_state(set, set->scratch);
+            if (next < 0) {
+                return nfa_match(set, path + i + 1, len - i - 1);
+            }
+            set->dfa_next[(size_t)state * 256 + c] = next;
+        }
+        state = next;
+        if (set->dfa_dead[state]) {
+            return false;
+        }
+    }
+    return set->dfa_accept[state];
+}
+
+static void set_free(PatternSet *set) {
+    free(set->trie);
+    free(set->tokens);
+    free(set->classes);
+    free(set->start);
+    free(set->accept);
+    free(set->dfa_sets);
+    free(set->dfa_next);
+    free(set->dfa_accept);
+    free(set->dfa_dead);
+    free(set->dfa_slots);
+    free(set->scratch);
+    free(set->scratch2);
+}
+
+static int set_compile(PatternSet *set, const char *const *patterns, size_t count) {
+    SetBuilder b = { 0, 0, 0 };
+    set->count = count;
+    for (size_t i = 0; i < count; i++) {
+        if (!patterns[i]) {
+            errno = EINVAL;
+            return -1;
+        }
+        size_t len;
+        const char *p = normalize(patterns[i], &len);
+        int rc = 0;
+        if (len == 0) {
+            set->match_all = true;
+        } else if (is_glob(p, len)) {
+            rc = compile_glob(set, &b, p, len);
+        } else {
+            // Literal: decode escapes into a copy for the trie
+            char *literal = malloc(len);
+            if (!literal) {
+                return -1;
+            }
+            size_t n = 0;
+            for (size_t j = 0; j < len; j++) {
+                if (p[j] == '\\' && j + 1 < len) {
+                    j++;
+                }
+                literal[n++] = p[j];
+            }
+            rc = trie_insert(set, &b.trie_capacity, literal, n);
+            free(literal);
+        }
+        if (rc < 0) {
+            return -1;
+        }
+    }
+    if (set->token_count == 0) {
+        return 0;
+    }
+
+    set->words = (set->token_count + 63) / 64;
+    set->start = calloc(set->words, sizeof(uint64_t));
+    set->accept = calloc(set->words, sizeof(uint64_t));
+    set->scratch = calloc(set->words, sizeof(uint64_t));
+    set->scratch2 = calloc(set->words, sizeof(uint64_t));
+    set->dfa_slots = malloc(MATCH_DFA_SLOTS * sizeof(int32_t));
+    if (!set->start || !set->accept || !set->scratch || !set->scratch2 || !set->dfa_slots) {
+        return -1;
+    }
+    for (size_t i = 0; i < MATCH_DFA_SLOTS; i++) {
+        set->dfa_slots[i] = -1;
+    }
+    // Every pattern starts right after the previous one's TOK_END
+    bool first = true;
+    for (size_t i = 0; i < set->token_count; i++) {
+        if (first) {
+            nfa_add(set, set->start, i);
+        }
+        first = set->tokens[i].type == TOK_END;
+        if (first) {
+            set->accept[i >> 6] |= 1ULL << (i & 63);
+        }
+    }
+    if (dfa_state(set, set->start) != 0) {
+        errno = ENOMEM;
+        return -1;
+    }
+    return 0;
+}
+
+static bool set_match(PatternSet *set, const char *path, size_t len) {
+    return set->match_all || trie_match(set, path, len) || glob_match(set, path, len);
+}
+
+ArcMatcher *arc_matcher_new(const char *const *include, size_t include_count,
+                            const char *const *exclude, size_t exclude_count) {
+    if ((!include && include_count) || (!exclude && exclude_count)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    ArcMatcher *matcher = calloc(1, sizeof(ArcMatcher));
+    if (!matcher) {
+        return NULL;
+    }
+    if (set_compile(&matcher->include, include, include_count) < 0 ||
+        set_compile(&matcher->exclude, exclude, exclude_count) < 0) {
+        int saved = errno ? errno : ENOMEM;
+        arc_matcher_free(matcher);
+        errno = saved;
+        return NULL;
+    }
+    return matcher;
+}
+
+bool arc_matcher_match(ArcMatcher *matcher, const char *path) {
+    if (!matcher || !path) {
+        return false;
+    }
+    size_t len;
+    path = normalize(path, &len);
+    if (matcher->include.count > 0 && !set_match(&matcher->include, path, len)) {
+        return false;
+    }
+    return !set_match(&matcher->exclude, path, len);
+}
+
+void arc_matcher_free(ArcMatcher *matcher) {
+    if (!matcher) {
+        return;
+    }
+    set_free(&matcher->include);
+    set_free(&matcher->exclude);
+    free(matcher);
+}
@@ -0,0 +1,53 @@
+#ifndef ARC_MATCH_H
+#define ARC_MATCH_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * Compiled include/exclude path patterns.
+ *
+ * A path is selected if it matches at least one include pattern (or there
+ * are none) and no exclude pattern. Patterns follow tar's wildcard rules:
+ *
+ * - `*` matches any run of characters, including '/'; `?` matches one
+ * - `[abc]`, `[a-z]`, `[!a-z]` (or `[^a-z]`) match one character of a class
+ * - `\` makes the next character literal
+ * - A pattern also selects everything below a directory it matches, so
+ *   "usr/bin" selects "usr/bin/ls"
+ *
+ * Leading "./" and "/" and trailing '/' are ignored in both patterns and
+ * paths. Patterns without wildcards go into a prefix trie; the others are
+ * compiled together into one NFA that is turned into a DFA lazily, one
+ * state per set of NFA states actually reached, so matching a path costs
+ * one table lookup per byte once the DFA is warm.
+ *
+ * A matcher caches DFA states as it matches, so it must not be used from
+ * several threads at once.
+ */
+
+typedef struct ArcMatcher ArcMatcher;
+
+/**
+ * Compile include and exclude patterns.
+ *
+ * @param include Include patterns (may be NULL if include_count is 0)
+ * @param include_count Number of include patterns (0 = include everything)
+ * @param exclude Exclude patterns (may be NULL if exclude_count is 0)
+ * @param exclude_count Number of exclude patterns
+ * @return New matcher, or NULL on error (EINVAL for NULL patterns)
+ */
+ArcMatcher *arc_matcher_new(const char *const *include, size_t include_count,
+                            const char *const *exclude, size_t exclude_count);
+
+/**
+ * Whether a path is selected.
+ */
+bool arc_matcher_match(ArcMatcher *matcher, const char *path);
+
+/**
+ * Free a matcher.
+ */
+void arc_matcher_free(ArcMatcher *matcher);
+
+#endif // ARC_MATCH_H
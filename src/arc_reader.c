@@ -5,6 +5,7 @@
 #include "arc_7z.h"
 #include "arc_filter.h"
 #include "arc_base.h"
+#include "arc_cache.h"
 
 // Compression type constants (from arc_compressed.h)
 #define ARC_COMPRESSED_GZIP  0
@@ -71,7 +72,8 @@ static bool path_looks_like_tar(const char *path) {
     if (strstr(path, ".tar.") != NULL ||
         strcmp(ext, ".tgz") == 0 ||
         strcmp(ext, ".tbz2") == 0 ||
-        strcmp(ext, ".txz") == 0) {
+        strcmp(ext, ".txz") == 0 ||
+        strcmp(ext, ".tlz4") == 0) {
         return true;
     }
     return false;
@@ -84,31 +86,79 @@ static const ArcLimits ARC_DEFAULT_LIMITS = {
     .max_extra = 65534ULL,
     .max_uncompressed_bytes = 1024ULL * 1024ULL * 1024ULL, // 1 GiB
     .max_nested_depth = 64ULL,
+    .max_archive_nesting = 8ULL,
+    .max_nested_spill = 64ULL * 1024ULL * 1024ULL, // 64 MiB
 };
 
 const ArcLimits *arc_default_limits(void) {
     return &ARC_DEFAULT_LIMITS;
 }
 
-static const ArcLimits *normalize_limits(const ArcLimits *in) {
+// Merges into the caller's `merged` (readers copy it, see arc_reader_set_limits())
+static const ArcLimits *normalize_limits(const ArcLimits *in, ArcLimits *merged_out) {
     const ArcLimits *d = arc_default_limits();
     if (!in) return d;
     // Treat 0 as "use default" per-field
-    static ArcLimits merged;
+    ArcLimits merged;
     merged.max_entries = in->max_entries ? in->max_entries : d->max_entries;
     merged.max_name = in->max_name ? in->max_name : d->max_name;
     merged.max_extra = in->max_extra ? in->max_extra : d->max_extra;
     merged.max_uncompressed_bytes = in->max_uncompressed_bytes ? in->max_uncompressed_bytes : d->max_uncompressed_bytes;
     merged.max_nested_depth = in->max_nested_depth ? in->max_nested_depth : d->max_nested_depth;
-    return &merged;
+    merged.max_archive_nesting = in->max_archive_nesting ? in->max_archive_nesting : d->max_archive_nesting;
+    merged.max_nested_spill = in->max_nested_spill ? in->max_nested_spill : d->max_nested_spill;
+    *merged_out = merged;
+    return merged_out;
 }
 
 
-// Format types (must match arc_tar.c, arc_zip.c, arc_compressed.c, arc_7z.c)
-#define ARC_FORMAT_TAR 0
-#define ARC_FORMAT_ZIP 1
-#define ARC_FORMAT_COMPRESSED 2
-#define ARC_FORMAT_7Z 3
+/**
+ * Gzip filter for a stream rewound to 0. BGZF data gets the block-parallel,
+ * seekable filter (with the `<path>.gzi` index when one sits next to the
+ * file); a large single .gz file is inflated in parallel when that pays
+ * off; compressed TAR otherwise keeps the serial filter, which the listing
+ * cache attaches its checkpoint index to.
+ */
+static ArcStream *open_gzip_filter(ArcStream *stream, int format, int64_t byte_limit, const char *path) {
+    uint8_t header[64];
+    ssize_t got = arc_stream_read(stream, header, sizeof(header));
+    if (arc_stream_seek(stream, 0, SEEK_SET) < 0) {
+        return NULL;
+    }
+    if (got > 0 && arc_bgzf_detect(header, (size_t)got, NULL)) {
+        ArcBgzfOptions opts = {0};
+        ArcBgzfIndex *index = NULL;
+        char *gzi = path ? malloc(strlen(path) + 5) : NULL;
+        if (gzi) {
+            strcpy(gzi, path);
+            strcat(gzi, ".gzi");
+            index = arc_bgzf_index_load(gzi);  // Optional; built while reading otherwise
+            free(gzi);
+        }
+        opts.index = index;
+        ArcStream *bgzf = arc_filter_bgzf(stream, byte_limit, &opts);
+        arc_bgzf_index_free(index);
+        if (bgzf) {
+            return bgzf;
+        }
+    }
+    if (format == ARC_FORMAT_COMPRESSED) {
+        int64_t size = -1;
+        if (arc_stream_seek(stream, 0, SEEK_END) == 0) {
+            size = arc_stream_tell(stream);
+        }
+        if (arc_stream_seek(stream, 0, SEEK_SET) < 0) {
+            return NULL;
+        }
+        if (arc_parallel_inflate_worthwhile(size)) {
+            ArcStream *parallel = arc_filter_gzip_parallel(stream, byte_limit, NULL);
+            if (parallel) {
+                return parallel;
+            }
+        }
+    }
+    return arc_filter_gzip(stream, byte_limit);
+}
 
 int arc_next(ArcReader *reader, ArcEntry *entry) {
     if (!reader || !entry) {
@@ -116,20 +166,98 @@ int arc_next(ArcReader *reader, ArcEntry *entry) {
     }
     // Check format field using safe accessor
     int format = arc_reader_format(reader);
+    int ret;
     switch (format) {
         case ARC_FORMAT_TAR:
-            return arc_tar_next(reader, entry);
+            ret = arc_tar_next(reader, entry);
+            break;
         case ARC_FORMAT_ZIP:
-            return arc_zip_next(reader, entry);
+            ret = arc_zip_next(reader, entry);
+            break;
         case ARC_FORMAT_COMPRESSED:
             return arc_compressed_next(reader, entry);
         case ARC_FORMAT_7Z:
             return arc_7z_next(reader, entry);
+        case ARC_FORMAT_CACHED:
+            return arc_cached_next(reader, entry);
+        default:
+            return -1;
+    }
+    if (((ArcReaderBase *)reader)->recorder) {
+        arc_cache_record(reader, entry, ret);
+    }
+    return ret;
+}
+
+int arc_reader_entry_location(ArcReader *reader, ArcEntryLocation *loc) {
+    if (!reader || !loc) {
+        return -1;
+    }
+    int format = arc_reader_format(reader);
+    switch (format) {
+        case ARC_FORMAT_TAR:
+            return arc_tar_entry_location(reader, loc);
+        case ARC_FORMAT_ZIP:
+            return arc_zip_entry_location(reader, loc);
+        case ARC_FORMAT_CACHED:
+            return arc_cached_entry_location(reader, loc);
         default:
+            errno = ENOTSUP;
             return -1;
     }
 }
 
+int arc_list_entries(ArcReader *reader, ArcEntry **entries_out, size_t *count_out) {
+    if (!reader || !entries_out || !count_out) {
+        errno = EINVAL;
+        return -1;
+    }
+    *entries_out = NULL;
+    *count_out = 0;
+
+    if (arc_reader_format(reader) == ARC_FORMAT_CACHED) {
+        return arc_cached_list(reader, entries_out, count_out);
+    }
+
+    ArcEntry *entries = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    for (;;) {
+        if (count >= capacity) {
+            size_t new_capacity = capacity == 0 ? 64 : capacity * 2;
+            ArcEntry *grown = realloc(entries, new_capacity * sizeof(*grown));
+            if (!grown) {
+                arc_entries_free(entries, count);
+                return -1;
+            }
+            entries = grown;
+            capacity = new_capacity;
+        }
+        int ret = arc_next(reader, &entries[count]);
+        if (ret == 1) {
+            break;
+        }
+        if (ret < 0) {
+            arc_entries_free(entries, count);
+            return -1;
+        }
+        count++;
+    }
+    *entries_out = entries;
+    *count_out = count;
+    return 0;
+}
+
+void arc_entries_free(ArcEntry *entries, size_t count) {
+    if (!entries) {
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        arc_entry_free(&entries[i]);
+    }
+    free(entries);
+}
+
 void arc_entry_free(ArcEntry *entry) {
     if (entry) {
         free(entry->path);
@@ -152,6 +280,8 @@ ArcStream *arc_open_data(ArcReader *reader) {
             return arc_compressed_open_data(reader);
         case ARC_FORMAT_7Z:
             return arc_7z_open_data(reader);
+        case ARC_FORMAT_CACHED:
+            return arc_cached_open_data(reader);
         default:
             return NULL;
     }
@@ -171,13 +301,38 @@ int arc_skip_data(ArcReader *reader) {
             return arc_compressed_skip_data(reader);
         case ARC_FORMAT_7Z:
             return arc_7z_skip_data(reader);
+        case ARC_FORMAT_CACHED:
+            return arc_cached_skip_data(reader);
         default:
             return -1;
     }
 }
 
+int arc_rewind(ArcReader *reader) {
+    if (!reader) {
+        errno = EINVAL;
+        return -1;
+    }
+    // The recorder only makes sense for a single uninterrupted pass
+    arc_cache_detach_recorder(reader);
+    int format = arc_reader_format(reader);
+    switch (format) {
+        case ARC_FORMAT_TAR:
+            return arc_tar_rewind(reader);
+        case ARC_FORMAT_ZIP:
+            return arc_zip_rewind(reader);
+        case ARC_FORMAT_CACHED:
+            return arc_cached_rewind(reader);
+        default:
+            errno = ENOTSUP;
+            return -1;
+    }
+}
+
 void arc_close(ArcReader *reader) {
     if (reader) {
+        // A listing pass that didn't reach the end is not worth caching
+        arc_cache_detach_recorder(reader);
         int format = arc_reader_format(reader);
         switch (format) {
             case ARC_FORMAT_TAR:
@@ -192,6 +347,9 @@ void arc_close(ArcReader *reader) {
         case ARC_FORMAT_7Z:
             arc_7z_close(reader);
             break;
+        case ARC_FORMAT_CACHED:
+            arc_cached_close(reader);
+            break;
             default:
                 // Unknown format, try all (one will fail gracefully)
                 arc_tar_close(reader);
@@ -210,7 +368,8 @@ ArcReader *arc_open_path_ex(const char *path, const ArcLimits *limits_in) {
     if (!path) {
         return NULL;
     }
-    const ArcLimits *limits = normalize_limits(limits_in);
+    ArcLimits merged;
+    const ArcLimits *limits = normalize_limits(limits_in, &merged);
     
     int fd = open(path, O_RDONLY);
     if (fd < 0) {
@@ -235,12 +394,21 @@ ArcReader *arc_open_path_ex(const char *path, const ArcLimits *limits_in) {
         return NULL;
     }
     
+    // Serve the listing from the persistent cache when the file is unchanged
+    ArcReader *cached = arc_cache_open(stream, &st, limits);
+    if (cached) {
+        return cached;
+    }
+    
     // Detect format and decompression
     ArcStream *decompressed = NULL;
     int compression_type = -1;
     int format = detect_format(stream, &decompressed, &compression_type, path);
     if (format < 0) {
+        int saved = errno;
+        arc_stream_close(decompressed);
         arc_stream_close(stream);
+        errno = saved;
         return NULL;
     }
     
@@ -264,11 +432,13 @@ ArcReader *arc_open_path_ex(const char *path, const ArcLimits *limits_in) {
         // Use a large byte limit (10x file size) to allow for decompression expansion
         // The underlying stream already has this limit set, so we pass 0 to use it
         if (compression_type == ARC_COMPRESSED_GZIP) {
-            decompressed = arc_filter_gzip(stream, (int64_t)limits->max_uncompressed_bytes);
+            decompressed = open_gzip_filter(stream, format, (int64_t)limits->max_uncompressed_bytes, path);
         } else if (compression_type == ARC_COMPRESSED_BZIP2) {
             decompressed = arc_filter_bzip2(stream, (int64_t)limits->max_uncompressed_bytes);
         } else if (compression_type == ARC_COMPRESSED_XZ) {
             decompressed = arc_filter_xz(stream, (int64_t)limits->max_uncompressed_bytes);
+        } else if (compression_type == ARC_COMPRESSED_LZ4) {
+            decompressed = arc_filter_lz4(stream, (int64_t)limits->max_uncompressed_bytes, NULL);
         }
         if (!decompressed) {
             arc_stream_close(stream);
@@ -302,6 +472,9 @@ ArcReader *arc_open_path_ex(const char *path, const ArcLimits *limits_in) {
         base->owned_stream = NULL;
     }
     
+    // Record this listing pass for the persistent cache (no-op when disabled)
+    arc_cache_attach_recorder(reader, &st, compression_type);
+    
     return reader;
 }
 
@@ -313,19 +486,139 @@ ArcReader *arc_open_stream_ex(ArcStream *stream, const ArcLimits *limits_in) {
     if (!stream) {
         return NULL;
     }
-    const ArcLimits *limits = normalize_limits(limits_in);
+    ArcLimits merged;
+    const ArcLimits *limits = normalize_limits(limits_in, &merged);
     
     // Detect format
     ArcStream *decompressed = NULL;
     int compression_type = -1;
     int format = detect_format(stream, &decompressed, &compression_type, NULL);
     if (format < 0) {
+        int saved = errno;
+        arc_stream_close(decompressed);
+        errno = saved;
         return NULL;
     }
     
+    // Same as arc_open_path_ex(): the detection filter has read ahead, so
+    // compressed TAR and single compressed files get a fresh filter from 0
+    if (compression_type >= 0 && (format == ARC_FORMAT_TAR || format == ARC_FORMAT_COMPRESSED)) {
+        if (decompressed) {
+            arc_stream_close(decompressed);
+            decompressed = NULL;
+        }
+        if (arc_stream_seek(stream, 0, SEEK_SET) < 0) {
+            errno = ESPIPE;
+            return NULL;
+        }
+        if (compression_type == ARC_COMPRESSED_GZIP) {
+            decompressed = open_gzip_filter(stream, format, (int64_t)limits->max_uncompressed_bytes, NULL);
+        } else if (compression_type == ARC_COMPRESSED_BZIP2) {
+            decompressed = arc_filter_bzip2(stream, (int64_t)limits->max_uncompressed_bytes);
+        } else if (compression_type == ARC_COMPRESSED_XZ) {
+            decompressed = arc_filter_xz(stream, (int64_t)limits->max_uncompressed_bytes);
+        } else if (compression_type == ARC_COMPRESSED_LZ4) {
+            decompressed = arc_filter_lz4(stream, (int64_t)limits->max_uncompressed_bytes, NULL);
+        }
+        if (!decompressed) {
+            return NULL;
+        }
+    }
+    
     ArcStream *final_stream = decompressed ? decompressed : stream;
     ArcStream *original_stream_for_compressed = (format == ARC_FORMAT_COMPRESSED) ? stream : NULL;
-    return create_reader(final_stream, format, NULL, compression_type, original_stream_for_compressed, limits);
+    ArcReader *reader = create_reader(final_stream, format, NULL, compression_type, original_stream_for_compressed, limits);
+    if (!reader) {
+        if (decompressed) {
+            arc_stream_close(decompressed);
+        }
+        return NULL;
+    }
+    // A TAR reader only closes its filter; it takes the stream it was given along
+    if (format == ARC_FORMAT_TAR && final_stream != stream) {
+        ((ArcReaderBase *)reader)->owned_stream = stream;
+    }
+    return reader;
+}
+
+// Bytes kept to detect a format that streams (TAR inside a compressed entry):
+// the magic, the first TAR header, and the detection filter's read-ahead
+#define NESTED_DETECT_WINDOW (256 * 1024)
+
+ArcReader *arc_open_nested(ArcReader *reader) {
+    if (!reader) {
+        errno = EINVAL;
+        return NULL;
+    }
+    ArcReaderBase *parent = (ArcReaderBase *)reader;
+    ArcLimits merged;
+    const ArcLimits *limits = normalize_limits(parent->limits, &merged);
+    if ((uint64_t)parent->nesting + 1 > limits->max_archive_nesting) {
+        errno = ELOOP;
+        return NULL;
+    }
+    ArcLimits nested_limits = *limits;
+    
+    ArcStream *data = arc_open_data(reader);
+    if (!data) {
+        return NULL;
+    }
+    
+    ArcStream *stream = data;
+    bool needs_seek = false;
+    if (arc_stream_is_seekable(data)) {
+        // The entry's read budget assumes one sequential pass; a seekable
+        // inner format re-reads parts of it (ZIP end records, central
+        // directory) and bounds its own output through the nested limits
+        data->byte_limit = 0;
+    } else {
+        // Peek at the magic to decide how much the inner format may seek back
+        uint8_t magic[6];
+        size_t n = 0;
+        while (n < sizeof(magic)) {
+            ssize_t got = arc_stream_read(data, magic + n, sizeof(magic) - n);
+            if (got < 0) {
+                int saved = errno;
+                arc_stream_close(data);
+                errno = saved;
+                return NULL;
+            }
+            if (got == 0) {
+                break;
+            }
+            n += (size_t)got;
+        }
+        needs_seek = (n >= 4 && magic[0] == 'P' && magic[1] == 'K' &&
+                           ((magic[2] == 3 && magic[3] == 4) || (magic[2] == 5 && magic[3] == 6))) ||
+                          (n >= 6 && memcmp(magic, "\x37\x7A\xBC\xAF\x27\x1C", 6) == 0);
+        size_t capacity = NESTED_DETECT_WINDOW;
+        if (needs_seek) {
+            capacity = nested_limits.max_nested_spill > SIZE_MAX ? SIZE_MAX : (size_t)nested_limits.max_nested_spill;
+        }
+        stream = arc_stream_spill(data, magic, n, capacity);
+        if (!stream) {
+            arc_stream_close(data);
+            return NULL;
+        }
+    }
+    
+    ArcReader *nested = arc_open_stream_ex(stream, &nested_limits);
+    if (!nested) {
+        int saved = errno;
+        arc_stream_close(stream);
+        // EFBIG: the inner format sought back past max_nested_spill
+        errno = saved == 0 ? EINVAL : saved;
+        return NULL;
+    }
+    if (needs_seek && !arc_stream_is_seekable(stream)) {
+        // Opened, but only after dropping bytes it will need (e.g. a ZIP
+        // falling back to streaming once its end records were out of reach)
+        arc_close(nested);
+        errno = EFBIG;
+        return NULL;
+    }
+    ((ArcReaderBase *)nested)->nesting = parent->nesting + 1;
+    return nested;
 }
 
 // Detect archive format and compression
@@ -407,6 +700,25 @@ static int detect_format(ArcStream *stream, ArcStream **decompressed, int *compr
             }
             return ARC_FORMAT_COMPRESSED;
         }
+    }
+    // Check for an LZ4 frame (magic bytes 04 22 4D 18)
+    else if (n >= 4 && magic[0] == 0x04 && magic[1] == 0x22 && magic[2] == 0x4D && magic[3] == 0x18) {
+        detected_compression = ARC_COMPRESSED_LZ4;
+        arc_stream_seek(original_stream, 0, SEEK_SET);
+        *decompressed = arc_filter_lz4(original_stream, 0, NULL);
+        if (!*decompressed) {
+            return -1;
+        }
+        stream = *decompressed;
+        n = arc_stream_read(stream, magic, sizeof(magic));
+        if (n < 2) {
+            *compression_type = detected_compression;
+            if (path_looks_like_tar(path)) {
+                errno = EINVAL;
+                return -1;
+            }
+            return ARC_FORMAT_COMPRESSED;
+        }
     } else {
         // No compression, reset position
         arc_stream_seek(stream, pos, SEEK_SET);
@@ -530,13 +842,13 @@ static ArcReader *create_reader(ArcStream *stream, int format, const char *path,
         case ARC_FORMAT_TAR:
         {
             ArcReader *r = arc_tar_open(stream);
-            if (r) ((ArcReaderBase *)r)->limits = limits;
+            if (r) arc_reader_set_limits((ArcReaderBase *)r, limits);
             return r;
         }
         case ARC_FORMAT_ZIP:
         {
             ArcReader *r = arc_zip_open_ex(stream, limits);
-            if (r) ((ArcReaderBase *)r)->limits = limits;
+            if (r) arc_reader_set_limits((ArcReaderBase *)r, limits);
             return r;
         }
         case ARC_FORMAT_COMPRESSED:
@@ -547,13 +859,13 @@ static ArcReader *create_reader(ArcStream *stream, int format, const char *path,
                 arc_compressed_set_original_stream(reader, original_stream);
             }
             if (reader) {
-                ((ArcReaderBase *)reader)->limits = limits;
+                arc_reader_set_limits((ArcReaderBase *)reader, limits);
             }
             return reader;
         case ARC_FORMAT_7Z:
         {
             ArcReader *r = arc_7z_open_ex(stream, limits);
-            if (r) ((ArcReaderBase *)r)->limits = limits;
+            if (r) arc_reader_set_limits((ArcReaderBase *)r, limits);
             return r;
         }
         default:
@@ -2,6 +2,7 @@
 #define ARC_READER_H
 
 #include "arc_stream.h"
+#include "arc_hash.h"
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
@@ -45,6 +46,8 @@ typedef struct ArcLimits {
     uint64_t max_extra;              // Max extra field bytes
     uint64_t max_uncompressed_bytes; // Max uncompressed bytes allowed (zip bombs)
     uint64_t max_nested_depth;       // Max path depth (components) during extraction
+    uint64_t max_archive_nesting;    // Max archive-in-archive depth (arc_open_nested())
+    uint64_t max_nested_spill;       // Max bytes buffered to make a nested archive seekable
 } ArcLimits;
 
 /**
@@ -82,6 +85,26 @@ ArcReader *arc_open_stream(ArcStream *stream);
  */
 ArcReader *arc_open_stream_ex(ArcStream *stream, const ArcLimits *limits);
 
+/**
+ * Open the current entry's data as an archive of its own (archive inside
+ * an archive), without extracting it to a temporary file.
+ * Only valid after a successful arc_next() call.
+ *
+ * The inner archive is read through arc_open_data(). Entries stored without
+ * compression in a file-backed archive are already seekable and cost
+ * nothing extra. Compressed entries are forward-only: formats that stream
+ * (TAR, compressed TAR) read straight through, while formats that need to
+ * seek (ZIP, 7z) are buffered in memory up to limits->max_nested_spill.
+ *
+ * The nested reader uses the parent's limits; opening deeper than
+ * limits->max_archive_nesting levels fails with ELOOP. The parent must
+ * outlive the nested reader and must not be advanced while it is open.
+ *
+ * @param reader The (outer) archive reader
+ * @return New reader (close with arc_close()), or NULL on error
+ */
+ArcReader *arc_open_nested(ArcReader *reader);
+
 /**
  * Get the next entry in the archive.
  * 
@@ -101,6 +124,22 @@ int arc_next(ArcReader *reader, ArcEntry *entry);
  */
 void arc_entry_free(ArcEntry *entry);
 
+/**
+ * Read all remaining entries in one call.
+ * Served directly from the listing cache when the archive was opened from it.
+ * 
+ * @param reader The archive reader
+ * @param entries_out Output: array of entries (free with arc_entries_free())
+ * @param count_out Output: number of entries
+ * @return 0 on success, <0 on error
+ */
+int arc_list_entries(ArcReader *reader, ArcEntry **entries_out, size_t *count_out);
+
+/**
+ * Free an array returned by arc_list_entries().
+ */
+void arc_entries_free(ArcEntry *entries, size_t count);
+
 /**
  * Open a stream for reading the current entry's data.
  * Only valid after a successful arc_next() call.
@@ -122,6 +161,16 @@ ArcStream *arc_open_data(ArcReader *reader);
  */
 int arc_skip_data(ArcReader *reader);
 
+/**
+ * Restart iteration from the first entry, reusing what the reader has
+ * already parsed (e.g. the ZIP central directory).
+ * 
+ * @param reader The archive reader
+ * @return 0 on success, <0 if the reader can't go back (compressed streams,
+ *         7z, single compressed files); reopen the archive in that case
+ */
+int arc_rewind(ArcReader *reader);
+
 /**
  * Close and free an archive reader.
  * 
@@ -129,6 +178,28 @@ int arc_skip_data(ArcReader *reader);
  */
 void arc_close(ArcReader *reader);
 
+/**
+ * Enable the persistent listing cache.
+ * 
+ * Archives opened with arc_open_path()/arc_open_path_ex() that are listed to
+ * the end are recorded in `dir`, keyed by (device, inode, size, mtime).
+ * Re-opening an unchanged file then serves arc_next() and arc_list_entries()
+ * from the cache file, and arc_open_data() seeks straight to the entry
+ * (using recorded inflate checkpoints for .tar.gz).
+ * 
+ * @param dir Existing directory to store cache files in
+ * @return 0 on success, <0 on error
+ * 
+ * Note: The setting is process-wide and not thread-safe to change while
+ *       archives are being opened.
+ */
+int arc_listing_cache_enable(const char *dir);
+
+/**
+ * Disable the persistent listing cache (cache files are left in place).
+ */
+void arc_listing_cache_disable(void);
+
 /**
  * Extract all entries from an archive to a destination directory.
  * 
@@ -158,5 +229,104 @@ int arc_extract_to_path(ArcReader *reader, const char *dest_dir, bool preserve_p
  */
 int arc_extract_entry(ArcReader *reader, const ArcEntry *entry, const char *dest_dir, bool preserve_permissions, bool preserve_timestamps);
 
+// Ways arc_extract_to_path_ex() may materialise a file whose contents were
+// already extracted (ArcExtractOptions.dedup); without one that works, the
+// data is written as usual
+#define ARC_DEDUP_REFLINK  0x1u     // ioctl(FICLONE): shared extents, independent files (btrfs, XFS)
+#define ARC_DEDUP_HARDLINK 0x2u     // link(): only when the attributes to preserve agree
+
+/**
+ * Extraction options. A zeroed struct behaves like the plain functions with
+ * both preserve flags false.
+ */
+typedef struct ArcExtractOptions {
+    bool preserve_permissions;
+    bool preserve_timestamps;
+    unsigned hash_algorithms;   // ARC_HASH_* digests computed while writing each file (0 = none)
+    bool hash_xattrs;           // Also store them as user.cupidarchive.<algo> xattrs (hex)
+    const char *const *include; // Extract only entries matching one of these globs (see arc_match.h)
+    size_t include_count;       // 0 = every entry
+    const char *const *exclude; // Never extract entries matching one of these globs
+    size_t exclude_count;
+    unsigned dedup;             // ARC_DEDUP_* ways to materialise duplicate files (0 = write every file)
+    const char *dedup_index;    // Digest index file kept across extractions (NULL = this extraction only)
+} ArcExtractOptions;
+
+/**
+ * A file written by arc_extract_to_path_ex().
+ */
+typedef struct ArcExtractedFile {
+    char *path;                 // Entry path (owned by the report)
+    uint64_t size;              // Bytes written
+    ArcDigests digests;         // Per ArcExtractOptions.hash_algorithms
+} ArcExtractedFile;
+
+/**
+ * What arc_extract_to_path_ex() did. Free with arc_extract_report_free().
+ */
+typedef struct ArcExtractReport {
+    ArcExtractedFile *files;    // Regular files and hard links, in archive order
+    size_t count;
+    size_t capacity;
+    uint64_t total_bytes;       // Sum of files[].size
+    size_t errors;              // Entries that failed to extract
+    size_t dedup_files;         // Files reflinked or hardlinked instead of written
+    uint64_t dedup_bytes;       // Data those files did not write
+} ArcExtractReport;
+
+/**
+ * Extract all entries, optionally hashing each file's data in the same pass
+ * that decompresses and writes it.
+ *
+ * Include/exclude patterns are compiled once and checked against each
+ * entry's path before its data is touched; unselected entries are skipped
+ * without decoding. For ZIP archives read through the central directory,
+ * unselected entries are filtered out of the directory and never visited.
+ *
+ * @param reader The archive reader
+ * @param dest_dir Destination directory path (must exist)
+ * @param opts Extraction options
+ * @param report Filled with the extracted files and their digests (may be NULL)
+ * @return 0 on success, <0 if any entry failed (the report still lists the
+ *         files that were written)
+ *
+ * Deduplication (opts->dedup): files up to 8 MiB are read into memory and
+ * hashed (BLAKE3) before anything is written. When a file with the same
+ * digest and size was extracted before, and its contents still compare
+ * equal, the new file is cloned from it or linked to it instead of written.
+ * Larger files are written as usual. With opts->dedup_index, the digests of
+ * this and earlier extractions are kept in that file (one
+ * "<hex> <size> <absolute path>" line each), so duplicates of files from
+ * other trees are found too.
+ *
+ * Note: With hash_xattrs, a file system without user xattrs (ENOTSUP) makes
+ *       every file entry fail after its data has been written.
+ */
+int arc_extract_to_path_ex(ArcReader *reader, const char *dest_dir, const ArcExtractOptions *opts,
+                           ArcExtractReport *report);
+
+/**
+ * Extract a single entry with options.
+ *
+ * @param reader The archive reader (must have current entry from arc_next())
+ * @param entry The entry to extract (from arc_next())
+ * @param dest_dir Destination directory path (must exist)
+ * @param opts Extraction options
+ * @param digests Receives the digests of a file entry's data (algorithms is 0
+ *                for other entry types); may be NULL
+ * @return 0 on success (including an entry left out by the patterns, whose
+ *         data is skipped), <0 on error
+ *
+ * Note: The patterns are compiled on every call; loops over many entries
+ *       should compile an ArcMatcher once and test paths with it instead.
+ */
+int arc_extract_entry_ex(ArcReader *reader, const ArcEntry *entry, const char *dest_dir,
+                         const ArcExtractOptions *opts, ArcDigests *digests);
+
+/**
+ * Free the contents of a report (the struct itself is the caller's).
+ */
+void arc_extract_report_free(ArcExtractReport *report);
+
 #endif // ARC_READER_H
 
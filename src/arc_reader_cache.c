@@ -0,0 +1,435 @@
+#define _POSIX_C_SOURCE 200809L
+#include "arc_reader_cache.h"
+#include "arc_reader.h"
+#include "arc_base.h"
+#include "arc_stream.h"
+#include "arc_zip.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define DEFAULT_MAX_OPEN_FDS 64
+#define DEFAULT_MAX_METADATA_BYTES (64u * 1024u * 1024u)
+
+// Rough per-reader cost for formats without an up-front index (buffers, state)
+#define READER_BASE_COST 4096
+
+// Attempts at opening a file that keeps changing underneath us
+#define OPEN_RETRIES 3
+
+// What "the same file" means: a rename-over or in-place rewrite changes one of these
+typedef struct FileIdentity {
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    int64_t mtime_sec;
+    long mtime_nsec;
+} FileIdentity;
+
+typedef struct CacheSlot {
+    char *path;
+    FileIdentity id;
+    ArcReader *reader;
+    size_t meta_bytes;
+    size_t dir_bytes;            // ZIP central directory charge included in meta_bytes
+    struct CacheSlot *dir_owner; // Clone: the slot carrying the charge for its directory
+    bool in_use;
+    bool stale;          // File changed while checked out: close on release
+    uint64_t last_used;  // LRU tick
+    struct CacheSlot *next;
+} CacheSlot;
+
+struct ArcReaderCache {
+    pthread_mutex_t lock;
+    CacheSlot *slots;
+    size_t max_open_fds;
+    size_t max_metadata_bytes;
+    ArcLimits limits;
+    uint64_t tick;
+    ArcReaderCacheStats stats;  // open_readers/idle_readers/metadata_bytes kept live
+};
+
+static FileIdentity identity_from_stat(const struct stat *st) {
+    FileIdentity id;
+    memset(&id, 0, sizeof(id));
+    id.dev = st->st_dev;
+    id.ino = st->st_ino;
+    id.size = st->st_size;
+    id.mtime_sec = (int64_t)st->st_mtim.tv_sec;
+    id.mtime_nsec = st->st_mtim.tv_nsec;
+    return id;
+}
+
+static bool identity_equal(const FileIdentity *a, const FileIdentity *b) {
+    return a->dev == b->dev && a->ino == b->ino && a->size == b->size &&
+           a->mtime_sec == b->mtime_sec && a->mtime_nsec == b->mtime_nsec;
+}
+
+// Clones share the central directory; it is counted once, on one slot of the group
+static size_t reader_dir_bytes(ArcReader *reader) {
+    return arc_reader_format(reader) == ARC_FORMAT_ZIP ? arc_zip_metadata_size(reader) : 0;
+}
+
+// Unlink a slot (caller holds the lock) onto `doomed`; close_doomed() closes
+// its reader once the lock is released
+static void slot_destroy(ArcReaderCache *cache, CacheSlot **link, CacheSlot **doomed) {
+    CacheSlot *slot = *link;
+    *link = slot->next;
+    cache->stats.open_readers--;
+    cache->stats.metadata_bytes -= slot->meta_bytes;
+    if (!slot->in_use) {
+        cache->stats.idle_readers--;
+    }
+    // Its clones keep the central directory alive: move the charge to one of them
+    CacheSlot *heir = NULL;
+    for (CacheSlot *other = slot->dir_bytes ? cache->slots : NULL; other; other = other->next) {
+        if (other->dir_owner != slot) {
+            continue;
+        }
+        if (heir) {
+            other->dir_owner = heir;
+            continue;
+        }
+        heir = other;
+        heir->dir_owner = NULL;
+        heir->dir_bytes = slot->dir_bytes;
+        heir->meta_bytes += slot->dir_bytes;
+        cache->stats.metadata_bytes += slot->dir_bytes;
+    }
+    slot->next = *doomed;
+    *doomed = slot;
+}
+
+// Close the readers of unlinked slots (without the lock: closing is I/O)
+static void close_doomed(CacheSlot *doomed) {
+    while (doomed) {
+        CacheSlot *next = doomed->next;
+        if (doomed->reader) {
+            arc_close(doomed->reader);
+        }
+        free(doomed->path);
+        free(doomed);
+        doomed = next;
+    }
+}
+
+// Find the link pointing at `slot` (caller holds the lock)
+static CacheSlot **slot_link(ArcReaderCache *cache, CacheSlot *slot) {
+    CacheSlot **link = &cache->slots;
+    while (*link && *link != slot) {
+        link = &(*link)->next;
+    }
+    return *link ? link : NULL;
+}
+
+// Close least recently used idle readers until within bounds (caller holds the lock)
+static void evict(ArcReaderCache *cache, CacheSlot **doomed) {
+    while (cache->stats.open_readers > cache->max_open_fds ||
+           cache->stats.metadata_bytes > cache->max_metadata_bytes) {
+        CacheSlot **victim = NULL;
+        for (CacheSlot **link = &cache->slots; *link; link = &(*link)->next) {
+            if (!(*link)->in_use && (!victim || (*link)->last_used < (*victim)->last_used)) {
+                victim = link;
+            }
+        }
+        if (!victim) {
+            return; // Everything left is checked out
+        }
+        slot_destroy(cache, victim, doomed);
+        cache->stats.evictions++;
+    }
+}
+
+// Link a new checked-out slot and account for it (caller holds the lock)
+static void slot_insert(ArcReaderCache *cache, CacheSlot *slot, CacheSlot **doomed) {
+    slot->last_used = ++cache->tick;
+    slot->next = cache->slots;
+    cache->slots = slot;
+    cache->stats.open_readers++;
+    cache->stats.metadata_bytes += slot->meta_bytes;
+    evict(cache, doomed);
+}
+
+// Drop readers for `path` whose file differs from `id` (NULL id = all of them)
+static void drop_path(ArcReaderCache *cache, const char *path, const FileIdentity *id, CacheSlot **doomed) {
+    CacheSlot **link = &cache->slots;
+    while (*link) {
+        CacheSlot *slot = *link;
+        bool match = !path || strcmp(slot->path, path) == 0;
+        if (match && (!id || !identity_equal(&slot->id, id))) {
+            if (slot->in_use) {
+                if (!slot->stale) {
+                    slot->stale = true;
+                    cache->stats.invalidations++;
+                }
+            } else {
+                slot_destroy(cache, link, doomed);
+                cache->stats.invalidations++;
+                continue;
+            }
+        }
+        link = &slot->next;
+    }
+}
+
+ArcReaderCache *arc_reader_cache_new(size_t max_open_fds, size_t max_metadata_bytes, const ArcLimits *limits) {
+    ArcReaderCache *cache = calloc(1, sizeof(ArcReaderCache));
+    if (!cache) {
+        return NULL;
+    }
+    if (pthread_mutex_init(&cache->lock, NULL) != 0) {
+        free(cache);
+        return NULL;
+    }
+    cache->max_open_fds = max_open_fds ? max_open_fds : DEFAULT_MAX_OPEN_FDS;
+    cache->max_metadata_bytes = max_metadata_bytes ? max_metadata_bytes : DEFAULT_MAX_METADATA_BYTES;
+    cache->limits = *(limits ? limits : arc_default_limits());
+    return cache;
+}
+
+void arc_reader_cache_free(ArcReaderCache *cache) {
+    if (!cache) {
+        return;
+    }
+    CacheSlot *slot = cache->slots;
+    while (slot) {
+        CacheSlot *next = slot->next;
+        if (!slot->in_use) {
+            arc_close(slot->reader);
+        }
+        free(slot->path);
+        free(slot);
+        slot = next;
+    }
+    pthread_mutex_destroy(&cache->lock);
+    free(cache);
+}
+
+// Stream for a second cursor over a ZIP that is already open, so a clone can
+// share its central directory (opened without the lock held)
+static ArcStream *open_clone_stream(ArcReaderCache *cache, const char *path, const FileIdentity *id) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return NULL;
+    }
+    FileIdentity now = identity_from_stat(&st);
+    if (!identity_equal(&now, id)) {
+        close(fd); // Replaced since the readers were opened
+        return NULL;
+    }
+    // Same byte budget arc_open_path_ex() gives the file stream
+    int64_t limit = st.st_size * 10;
+    if (cache->limits.max_uncompressed_bytes > 0 && (uint64_t)limit > cache->limits.max_uncompressed_bytes) {
+        limit = (int64_t)cache->limits.max_uncompressed_bytes;
+    }
+    ArcStream *stream = arc_stream_from_fd(fd, limit);
+    if (!stream) {
+        close(fd);
+    }
+    return stream;
+}
+
+// A checked-out ZIP reader for the file whose central directory a clone can
+// share (caller holds the lock, so it can't be closed meanwhile)
+static CacheSlot *find_template(ArcReaderCache *cache, const char *path, const FileIdentity *id) {
+    for (CacheSlot *slot = cache->slots; slot; slot = slot->next) {
+        if (slot->in_use && !slot->stale && strcmp(slot->path, path) == 0 &&
+            identity_equal(&slot->id, id) && arc_reader_format(slot->reader) == ARC_FORMAT_ZIP) {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+// Open from scratch, making sure the reader matches the identity we key it by
+static ArcReader *open_verified(ArcReaderCache *cache, const char *path, FileIdentity *id) {
+    for (int attempt = 0; attempt < OPEN_RETRIES; attempt++) {
+        ArcReader *reader = arc_open_path_ex(path, &cache->limits);
+        if (!reader) {
+            return NULL;
+        }
+        struct stat st;
+        if (stat(path, &st) < 0) {
+            arc_close(reader);
+            return NULL;
+        }
+        FileIdentity after = identity_from_stat(&st);
+        if (identity_equal(&after, id)) {
+            return reader;
+        }
+        // Changed between stat and open; try again against the new file
+        arc_close(reader);
+        *id = after;
+    }
+    errno = EAGAIN;
+    return NULL;
+}
+
+ArcReader *arc_reader_cache_acquire(ArcReaderCache *cache, const char *path) {
+    if (!cache || !path) {
+        errno = EINVAL;
+        return NULL;
+    }
+    struct stat st;
+    if (stat(path, &st) < 0) {
+        return NULL;
+    }
+    FileIdentity id = identity_from_stat(&st);
+
+    CacheSlot *doomed = NULL;
+    pthread_mutex_lock(&cache->lock);
+    drop_path(cache, path, &id, &doomed);
+
+    // Reuse the most recently used idle reader: claim it under the lock,
+    // rewind it outside
+    for (;;) {
+        CacheSlot **best = NULL;
+        for (CacheSlot **link = &cache->slots; *link; link = &(*link)->next) {
+            CacheSlot *slot = *link;
+            if (!slot->in_use && strcmp(slot->path, path) == 0 &&
+                (!best || slot->last_used > (*best)->last_used)) {
+                best = link;
+            }
+        }
+        if (!best) {
+            break;
+        }
+        CacheSlot *slot = *best;
+        slot->in_use = true;
+        slot->last_used = ++cache->tick;
+        cache->stats.idle_readers--;
+        pthread_mutex_unlock(&cache->lock);
+        close_doomed(doomed);
+        doomed = NULL;
+        int rc = arc_rewind(slot->reader);
+        pthread_mutex_lock(&cache->lock);
+        if (rc == 0) {
+            cache->stats.hits++;
+            pthread_mutex_unlock(&cache->lock);
+            return slot->reader;
+        }
+        // Can't go back (e.g. .tar.gz): reopening is the only way
+        slot_destroy(cache, slot_link(cache, slot), &doomed);
+    }
+    bool clonable = find_template(cache, path, &id) != NULL;
+    pthread_mutex_unlock(&cache->lock);
+    close_doomed(doomed);
+    doomed = NULL;
+
+    CacheSlot *slot = calloc(1, sizeof(CacheSlot));
+    char *path_copy = strdup(path);
+    if (!slot || !path_copy) {
+        free(slot);
+        free(path_copy);
+        return NULL;
+    }
+    slot->path = path_copy;
+    slot->id = id;
+    slot->in_use = true;
+
+    ArcReader *reader = NULL;
+    if (clonable) {
+        ArcStream *stream = open_clone_stream(cache, path, &id);
+        if (stream) {
+            // The template may have been released and evicted meanwhile; the
+            // clone is linked under the same lock so its owner can't go away
+            pthread_mutex_lock(&cache->lock);
+            CacheSlot *tmpl = find_template(cache, path, &id);
+            if (tmpl) {
+                reader = arc_zip_clone(tmpl->reader, stream);
+            }
+            if (reader) {
+                slot->reader = reader;
+                slot->meta_bytes = READER_BASE_COST;
+                slot->dir_owner = tmpl->dir_owner ? tmpl->dir_owner : tmpl;
+                cache->stats.clones++;
+                slot_insert(cache, slot, &doomed);
+            }
+            pthread_mutex_unlock(&cache->lock);
+            if (reader) {
+                close_doomed(doomed);
+                return reader;
+            }
+            arc_stream_close(stream);
+        }
+    }
+
+    reader = open_verified(cache, path, &slot->id);
+    if (!reader) {
+        free(slot->path);
+        free(slot);
+        return NULL;
+    }
+    slot->reader = reader;
+    slot->dir_bytes = reader_dir_bytes(reader);
+    slot->meta_bytes = READER_BASE_COST + slot->dir_bytes;
+
+    pthread_mutex_lock(&cache->lock);
+    cache->stats.opens++;
+    slot_insert(cache, slot, &doomed);
+    pthread_mutex_unlock(&cache->lock);
+    close_doomed(doomed);
+    return reader;
+}
+
+void arc_reader_cache_release(ArcReaderCache *cache, ArcReader *reader) {
+    if (!reader) {
+        return;
+    }
+    if (!cache) {
+        arc_close(reader);
+        return;
+    }
+    CacheSlot *doomed = NULL;
+    pthread_mutex_lock(&cache->lock);
+    CacheSlot **link = &cache->slots;
+    while (*link && (*link)->reader != reader) {
+        link = &(*link)->next;
+    }
+    if (!*link) {
+        pthread_mutex_unlock(&cache->lock);
+        arc_close(reader); // Not ours
+        return;
+    }
+    CacheSlot *slot = *link;
+    if (slot->stale) {
+        slot_destroy(cache, link, &doomed);
+    } else {
+        slot->in_use = false;
+        slot->last_used = ++cache->tick;
+        cache->stats.idle_readers++;
+        evict(cache, &doomed);
+    }
+    pthread_mutex_unlock(&cache->lock);
+    close_doomed(doomed);
+}
+
+void arc_reader_cache_invalidate(ArcReaderCache *cache, const char *path) {
+    if (!cache) {
+        return;
+    }
+    CacheSlot *doomed = NULL;
+    pthread_mutex_lock(&cache->lock);
+    drop_path(cache, path, NULL, &doomed);
+    pthread_mutex_unlock(&cache->lock);
+    close_doomed(doomed);
+}
+
+void arc_reader_cache_stats(ArcReaderCache *cache, ArcReaderCacheStats *stats) {
+    if (!cache || !stats) {
+        return;
+    }
+    pthread_mutex_lock(&cache->lock);
+    *stats = cache->stats;
+    pthread_mutex_unlock(&cache->lock);
+}
@@ -0,0 +1,91 @@
+#ifndef ARC_READER_CACHE_H
+#define ARC_READER_CACHE_H
+
+#include "arc_reader.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Cache of opened archive readers for repeated access.
+ *
+ * Opening a ZIP means locating the end of central directory and parsing
+ * every central directory record; doing that on every request (file
+ * manager previews, FUSE lookups, servers) dominates small reads. The
+ * cache keeps readers open in an LRU keyed by path and file identity
+ * (device, inode, size, mtime) and hands them out as cursors:
+ *
+ * - An idle reader for the file is rewound (arc_rewind()) and reused.
+ * - If every reader for a ZIP is checked out, a clone sharing the parsed
+ *   central directory is created on a fresh file descriptor.
+ * - Otherwise (or for formats that can't rewind) the archive is reopened.
+ *
+ * Each acquire stat()s the path; readers for a file that changed on disk
+ * are dropped (or closed when released, if checked out).
+ *
+ * All functions are thread-safe. A checked-out reader is used by one
+ * thread at a time, like any ArcReader.
+ */
+
+typedef struct ArcReaderCache ArcReaderCache;
+
+/**
+ * Counters for tuning and tests.
+ */
+typedef struct ArcReaderCacheStats {
+    size_t   open_readers;     // Readers held (idle + checked out), i.e. open fds
+    size_t   idle_readers;     // Readers available for reuse
+    size_t   metadata_bytes;   // Approximate heap held by cached readers
+    uint64_t hits;             // Acquires served by rewinding an idle reader
+    uint64_t clones;           // Acquires served by cloning a checked-out ZIP reader
+    uint64_t opens;            // Acquires that opened the archive from scratch
+    uint64_t evictions;        // Idle readers closed to stay within the bounds
+    uint64_t invalidations;    // Readers dropped because the file changed
+} ArcReaderCacheStats;
+
+/**
+ * Create a reader cache.
+ *
+ * @param max_open_fds Max readers (file descriptors) to keep open, 0 = default (64)
+ * @param max_metadata_bytes Max approximate metadata memory, 0 = default (64 MiB)
+ * @param limits Limits for opened archives (copied; NULL = arc_default_limits())
+ * @return New cache, or NULL on error
+ *
+ * Note: Only idle readers are evicted, so checked-out readers can push the
+ *       cache above its bounds until they are released.
+ */
+ArcReaderCache *arc_reader_cache_new(size_t max_open_fds, size_t max_metadata_bytes, const ArcLimits *limits);
+
+/**
+ * Free the cache and close its idle readers.
+ * Readers still checked out are no longer tracked; close them with arc_close().
+ */
+void arc_reader_cache_free(ArcReaderCache *cache);
+
+/**
+ * Check out a reader positioned before the first entry.
+ *
+ * @param cache The cache
+ * @param path Archive path
+ * @return Reader (return it with arc_reader_cache_release()), or NULL on error
+ */
+ArcReader *arc_reader_cache_acquire(ArcReaderCache *cache, const char *path);
+
+/**
+ * Return a reader obtained from arc_reader_cache_acquire().
+ * Any data stream opened from it must be closed first.
+ * Readers the cache doesn't know about are closed.
+ */
+void arc_reader_cache_release(ArcReaderCache *cache, ArcReader *reader);
+
+/**
+ * Drop cached readers for a path (NULL = every path).
+ * Checked-out readers are closed when released.
+ */
+void arc_reader_cache_invalidate(ArcReaderCache *cache, const char *path);
+
+/**
+ * Snapshot the cache counters.
+ */
+void arc_reader_cache_stats(ArcReaderCache *cache, ArcReaderCacheStats *stats);
+
+#endif // ARC_READER_CACHE_H
@@ -0,0 +1,532 @@
+#define _POSIX_C_SOURCE 200809L
+#include "arc_shard.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+
+#define DEFAULT_PREFETCH 64
+#define MAX_PREFETCH (1024 * 1024)
+#define SHARD_MAX_THREADS 64
+#define FIELD_INITIAL_MAX (64 * 1024)  // Header sizes beyond this grow as data arrives
+
+/**
+ * One slot of the sample queue. seq tells producers and consumers whose
+ * turn the slot is (bounded MPMC ring after Dmitry Vyukov's design).
+ */
+typedef struct ShardCell {
+    atomic_size_t seq;
+    ArcSample *sample;
+    int error;            // Non-zero: the shard failed here (sample is NULL)
+    bool end;             // End of the epoch (pushed once every worker is done)
+} ShardCell;
+
+struct ArcShardSet {
+    char **paths;
+    size_t count;
+    unsigned threads;
+    bool shuffle;
+    uint64_t seed;
+    const ArcLimits *limits;
+
+    // Lock-free ring. The semaphores count free slots (the prefetch depth)
+    // and queued cells, so a push never finds the ring full and a pop
+    // holding a ready token only waits for a slot being written. One slot
+    // beyond the prefetch depth is kept for the end cell.
+    ShardCell *cells;
+    size_t mask;
+    size_t prefetch;
+    atomic_size_t enqueue_pos;
+    atomic_size_t dequeue_pos;
+    sem_t free_slots;
+    sem_t ready;
+
+    // Current epoch
+    bool running;
+    size_t *order;
+    atomic_size_t next_shard;
+    atomic_uint producers;  // Workers still reading shards
+    atomic_bool stop;
+    pthread_t workers[SHARD_MAX_THREADS];
+    unsigned worker_count;
+};
+
+static void queue_push(ArcShardSet *set, ArcSample *sample, int error, bool end) {
+    ShardCell *cell;
+    size_t pos = atomic_load_explicit(&set->enqueue_pos, memory_order_relaxed);
+    for (;;) {
+        cell = &set->cells[pos & set->mask];
+        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        if (seq == pos) {
+            if (atomic_compare_exchange_weak_explicit(&set->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else {
+            pos = atomic_load_explicit(&set->enqueue_pos, memory_order_relaxed);
+        }
+    }
+    cell->sample = sample;
+    cell->error = error;
+    cell->end = end;
+    atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+}
+
+/**
+ * Take the next cell. A producer may have claimed the slot and not yet
+ * published it while a later slot already is; with `wait` (the caller holds
+ * a ready token, so the slot is being written) spin until it is.
+ *
+ * @return false if the ring is empty (only without `wait`)
+ */
+static bool queue_pop(ArcShardSet *set, ArcSample **sample, int *error, bool *end, bool wait) {
+    ShardCell *cell;
+    size_t pos = atomic_load_explicit(&set->dequeue_pos, memory_order_relaxed);
+    for (;;) {
+        cell = &set->cells[pos & set->mask];
+        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&set->dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            if (!wait) {
+                return false;  // Empty
+            }
+            sched_yield();
+            pos = atomic_load_explicit(&set->dequeue_pos, memory_order_relaxed);
+        } else {
+            pos = atomic_load_explicit(&set->dequeue_pos, memory_order_relaxed);
+        }
+    }
+    *sample = cell->sample;
+    *error = cell->error;
+    *end = cell->end;
+    atomic_store_explicit(&cell->seq, pos + set->mask + 1, memory_order_release);
+    return true;
+}
+
+static void queue_reset(ArcShardSet *set) {
+    for (size_t i = 0; i <= set->mask; i++) {
+        atomic_init(&set->cells[i].seq, i);
+        set->cells[i].sample = NULL;
+        set->cells[i].end = false;
+    }
+    atomic_init(&set->enqueue_pos, 0);
+    atomic_init(&set->dequeue_pos, 0);
+}
+
+static int sem_wait_intr(sem_t *sem) {
+    while (sem_wait(sem) < 0) {
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Hand a sample (or a shard error) to the consumers once there is room.
+ *
+ * @return false if the epoch is being stopped (the sample is freed)
+ */
+static bool produce(ArcShardSet *set, ArcSample *sample, int error) {
+    if (sem_wait_intr(&set->free_slots) < 0 || atomic_load(&set->stop)) {
+        arc_sample_free(sample);
+        return false;
+    }
+    queue_push(set, sample, error, false);
+    sem_post(&set->ready);
+    return true;
+}
+
+/**
+ * A producer is done; the last one queues the end cell (into the slot kept
+ * for it, so this never waits for room).
+ */
+static void producers_done(ArcShardSet *set, unsigned count) {
+    if (atomic_fetch_sub(&set->producers, count) == count && !atomic_load(&set->stop)) {
+        queue_push(set, NULL, 0, true);
+        sem_post(&set->ready);
+    }
+}
+
+static ArcSample *sample_new(const char *key, size_t key_len, size_t shard) {
+    ArcSample *sample = calloc(1, sizeof(ArcSample));
+    if (!sample) {
+        return NULL;
+    }
+    sample->key = malloc(key_len + 1);
+    if (!sample->key) {
+        free(sample);
+        return NULL;
+    }
+    memcpy(sample->key, key, key_len);
+    sample->key[key_len] = '\0';
+    sample->shard = shard;
+    return sample;
+}
+
+/**
+ * Read the current entry into a new field of the sample.
+ */
+static int add_field(ArcSample *sample, const char *name, ArcReader *reader, const ArcEntry *entry) {
+    ArcSampleField *fields = realloc(sample->fields, (sample->field_count + 1) * sizeof(ArcSampleField));
+    if (!fields) {
+        return -1;
+    }
+    sample->fields = fields;
+    ArcSampleField *field = &fields[sample->field_count];
+    field->name = strdup(name);
+    // The header's size is untrusted: don't allocate it up front
+    size_t capacity = (entry->size < FIELD_INITIAL_MAX ? (size_t)entry->size : FIELD_INITIAL_MAX) + 1;
+    field->data = malloc(capacity);
+    field->size = 0;
+    if (!field->name || !field->data) {
+        free(field->name);
+        free(field->data);
+        errno = ENOMEM;
+        return -1;
+    }
+    sample->field_count++;
+
+    // Empty files have no data stream
+    ArcStream *data = entry->size > 0 ? arc_open_data(reader) : NULL;
+    if (entry->size > 0 && !data) {
+        return -1;
+    }
+    ssize_t n = 0;
+    while (data) {
+        if (field->size + 1 == capacity) {
+            // More data than allocated so far (large field, or a lone compressed file)
+            uint8_t *grown = realloc(field->data, capacity * 2);
+            if (!grown) {
+                n = -1;
+                errno = ENOMEM;
+                break;
+            }
+            field->data = grown;
+            capacity *= 2;
+        }
+        n = arc_stream_read(data, field->data + field->size, capacity - 1 - field->size);
+        if (n <= 0) {
+            break;
+        }
+        field->size += (size_t)n;
+    }
+    int saved = errno;
+    arc_stream_close(data);
+    field->data[field->size] = '\0';
+    errno = saved;
+    return n < 0 ? -1 : 0;
+}
+
+/**
+ * Read one shard, grouping adjacent files by key into samples.
+ */
+static void read_shard(ArcShardSet *set, size_t shard) {
+    ArcReader *reader = arc_open_path_ex(set->paths[shard], set->limits);
+    if (!reader) {
+        produce(set, NULL, errno ? errno : EIO);
+        return;
+    }
+    ArcSample *current = NULL;
+    ArcEntry entry;
+    int rc = 0;
+    int error = 0;
+    while (!atomic_load(&set->stop) && (rc = arc_next(reader, &entry)) == 0) {
+        if (entry.type != ARC_ENTRY_FILE) {
+            arc_entry_free(&entry);
+            continue;
+        }
+        // Key: the path up to the first '.' of the file name
+        const char *base = strrchr(entry.path, '/');
+        base = base ? base + 1 : entry.path;
+        const char *dot = strchr(base, '.');
+        size_t key_len = dot ? (size_t)(dot - entry.path) : strlen(entry.path);
+
+        if (current && (strlen(current->key) != key_len || memcmp(current->key, entry.path, key_len) != 0)) {
+            bool queued = produce(set, current, 0);
+            current = NULL;
+            if (!queued) {
+                arc_entry_free(&entry);
+                break;
+            }
+        }
+        if (!current) {
+            current = sample_new(entry.path, key_len, shard);
+        }
+        errno = 0;
+        if (!current || add_field(current, dot ? dot + 1 : "", reader, &entry) < 0) {
+            error = errno ? errno : ENOMEM;
+            arc_entry_free(&entry);
+            break;
+        }
+        arc_entry_free(&entry);
+    }
+    if (!error && rc < 0) {
+        error = errno ? errno : EIO;
+    }
+    arc_close(reader);
+
+    if (error) {
+        // The sample being read is incomplete: report the failure instead
+        arc_sample_free(current);
+        produce(set, NULL, error);
+    } else if (current) {
+        produce(set, current, 0);
+    }
+}
+
+static void *shard_worker(void *arg) {
+    ArcShardSet *set = arg;
+    for (;;) {
+        size_t i = atomic_fetch_add(&set->next_shard, 1);
+        if (i >= set->count || atomic_load(&set->stop)) {
+            break;
+        }
+        read_shard(set, set->order[i]);
+    }
+    producers_done(set, 1);
+    return NULL;
+}
+
+/**
+ * Stop the workers of the current epoch and drop what they queued.
+ */
+static void stop_epoch(ArcShardSet *set) {
+    if (!set->running) {
+        return;
+    }
+    atomic_store(&set->stop, true);
+    // Wake workers waiting for room; they see the stop flag and quit
+    for (unsigned i = 0; i < set->worker_count; i++) {
+        sem_post(&set->free_slots);
+    }
+    for (unsigned i = 0; i < set->worker_count; i++) {
+        pthread_join(set->workers[i], NULL);
+    }
+    ArcSample *sample;
+    int error;
+    bool end;
+    while (queue_pop(set, &sample, &error, &end, false)) {
+        arc_sample_free(sample);
+    }
+    sem_destroy(&set->free_slots);
+    sem_destroy(&set->ready);
+    sem_init(&set->free_slots, 0, (unsigned)set->prefetch);
+    sem_init(&set->ready, 0, 0);
+    set->running = false;
+}
+
+ArcShardSet *arc_shard_set_open(const char *const *paths, size_t count, const ArcShardSetOptions *opts) {
+    if (!paths || count == 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    ArcShardSet *set = calloc(1, sizeof(ArcShardSet));
+    if (!set) {
+        return NULL;
+    }
+    set->paths = calloc(count, sizeof(char *));
+    set->order = calloc(count, sizeof(size_t));
+    if (!set->paths || !set->order) {
+        goto fail;
+    }
+    set->count = count;
+    for (size_t i = 0; i < count; i++) {
+        set->paths[i] = paths[i] ? strdup(paths[i]) : NULL;
+        if (!set->paths[i]) {
+            if (!paths[i]) {
+                errno = EINVAL;
+            }
+            goto fail;
+        }
+    }
+
+    long threads = opts && opts->threads ? (long)opts->threads : sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (threads > SHARD_MAX_THREADS) {
+        threads = SHARD_MAX_THREADS;
+    }
+    if ((size_t)threads > count) {
+        threads = (long)count;
+    }
+    set->threads = (unsigned)threads;
+    set->shuffle = opts && opts->shuffle;
+    set->seed = opts ? opts->seed : 0;
+    set->limits = opts ? opts->limits : NULL;
+
+    set->prefetch = opts && opts->prefetch ? opts->prefetch : DEFAULT_PREFETCH;
+    if (set->prefetch > MAX_PREFETCH) {
+        set->prefetch = MAX_PREFETCH;
+    }
+    size_t capacity = 1;
+    while (capacity < set->prefetch + 1) {
+        capacity *= 2;
+    }
+    set->cells = calloc(capacity, sizeof(ShardCell));
+    if (!set->cells) {
+        goto fail;
+    }
+    set->mask = capacity - 1;
+    if (sem_init(&set->free_slots, 0, (unsigned)set->prefetch) < 0) {
+        goto fail;
+    }
+    if (sem_init(&set->ready, 0, 0) < 0) {
+        sem_destroy(&set->free_slots);
+        goto fail;
+    }
+    return set;
+
+fail:;
+    int saved = errno ? errno : ENOMEM;
+    for (size_t i = 0; set->paths && i < count; i++) {
+        free(set->paths[i]);
+    }
+    free(set->paths);
+    free(set->order);
+    free(set->cells);
+    free(set);
+    errno = saved;
+    return NULL;
+}
+
+static uint64_t splitmix64(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+void arc_shard_set_order(const ArcShardSet *set, uint64_t epoch, size_t *order) {
+    if (!set || !order) {
+        return;
+    }
+    for (size_t i = 0; i < set->count; i++) {
+        order[i] = i;
+    }
+    if (!set->shuffle) {
+        return;
+    }
+    // Fisher-Yates with a generator seeded by (seed, epoch)
+    uint64_t state = set->seed ^ (epoch * 0xD1B54A32D192ED03ULL);
+    for (size_t i = set->count - 1; i > 0; i--) {
+        size_t j = (size_t)(splitmix64(&state) % (i + 1));
+        size_t tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+}
+
+int arc_shard_set_start(ArcShardSet *set, uint64_t epoch) {
+    if (!set) {
+        errno = EINVAL;
+        return -1;
+    }
+    stop_epoch(set);
+    arc_shard_set_order(set, epoch, set->order);
+    queue_reset(set);
+    atomic_store(&set->next_shard, 0);
+    atomic_store(&set->stop, false);
+    atomic_store(&set->producers, set->threads);
+
+    set->worker_count = 0;
+    for (unsigned i = 0; i < set->threads; i++) {
+        if (pthread_create(&set->workers[i], NULL, shard_worker, set) != 0) {
+            break;
+        }
+        set->worker_count++;
+    }
+    if (set->worker_count == 0) {
+        errno = EAGAIN;
+        return -1;
+    }
+    set->running = true;
+    // Workers that could not be started never finish
+    unsigned missing = set->threads - set->worker_count;
+    if (missing > 0) {
+        producers_done(set, missing);
+    }
+    return 0;
+}
+
+int arc_shard_set_next(ArcShardSet *set, ArcSample **sample) {
+    if (!set || !sample) {
+        errno = EINVAL;
+        return -1;
+    }
+    *sample = NULL;
+    if (!set->running && arc_shard_set_start(set, 0) < 0) {
+        return -1;
+    }
+    if (sem_wait_intr(&set->ready) < 0) {
+        return -1;
+    }
+    ArcSample *s;
+    int error;
+    bool end;
+    queue_pop(set, &s, &error, &end, true);
+    if (end) {
+        // Put the end cell back for the other consumers
+        queue_push(set, NULL, 0, true);
+        sem_post(&set->ready);
+        return 1;
+    }
+    sem_post(&set->free_slots);
+    if (error) {
+        errno = error;
+        return -1;
+    }
+    *sample = s;
+    return 0;
+}
+
+const ArcSampleField *arc_sample_field(const ArcSample *sample, const char *name) {
+    if (!sample || !name) {
+        return NULL;
+    }
+    for (size_t i = 0; i < sample->field_count; i++) {
+        if (strcmp(sample->fields[i].name, name) == 0) {
+            return &sample->fields[i];
+        }
+    }
+    return NULL;
+}
+
+void arc_sample_free(ArcSample *sample) {
+    if (!sample) {
+        return;
+    }
+    for (size_t i = 0; i < sample->field_count; i++) {
+        free(sample->fields[i].name);
+        free(sample->fields[i].data);
+    }
+    free(sample->fields);
+    free(sample->key);
+    free(sample);
+}
+
+void arc_shard_set_close(ArcShardSet *set) {
+    if (!set) {
+        return;
+    }
+    stop_epoch(set);
+    sem_destroy(&set->free_slots);
+    sem_destroy(&set->ready);
+    for (size_t i = 0; i < set->count; i++) {
+        free(set->paths[i]);
+    }
+    free(set->paths);
+    free(set->order);
+    free(set->cells);
+    free(set);
+}
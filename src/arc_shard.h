@@ -0,0 +1,109 @@
+#ifndef ARC_SHARD_H
+#define ARC_SHARD_H
+
+#include "arc_reader.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * Sharded datasets (WebDataset layout).
+ *
+ * A dataset is a list of shard archives (TAR, compressed TAR or ZIP). Files
+ * that share a key, the path up to the first '.' of the file name, form
+ * one sample: "train/0001.jpg" and "train/0001.cls" are the fields "jpg"
+ * and "cls" of sample "train/0001". A sample's files must be adjacent in
+ * its shard.
+ *
+ * A pool of threads reads several shards at once, each whole shard on one
+ * thread, and hands complete samples to the consumers through a bounded
+ * lock-free queue; its capacity is the prefetch depth. Within a shard,
+ * samples keep their order; samples from different shards interleave as
+ * the threads produce them, so only a single thread gives a reproducible
+ * sample order. The shard order itself is reproducible: each epoch
+ * shuffles it with a generator seeded by (seed, epoch).
+ */
+
+typedef struct ArcShardSet ArcShardSet;
+
+/**
+ * Options. A zeroed struct (or NULL) reads shards in order on one thread
+ * per online CPU with 64 samples of prefetch.
+ */
+typedef struct ArcShardSetOptions {
+    unsigned threads;         // Shards read at once (0 = one per online CPU; at most the shard count)
+    size_t prefetch;          // Samples queued ahead of the consumers (0 = 64)
+    bool shuffle;             // Shuffle the shard order every epoch
+    uint64_t seed;            // Shuffle seed
+    const ArcLimits *limits;  // Limits for opening shards (NULL = arc_default_limits())
+} ArcShardSetOptions;
+
+typedef struct ArcSampleField {
+    char *name;      // Extension after the key, e.g. "jpg" or "seg.png" ("" if none)
+    uint8_t *data;   // File contents (NUL-terminated for convenience, not counted in size)
+    size_t size;
+} ArcSampleField;
+
+typedef struct ArcSample {
+    char *key;                // Path without extension, e.g. "train/0001"
+    size_t shard;             // Index of the shard in the list given to arc_shard_set_open()
+    ArcSampleField *fields;   // In archive order
+    size_t field_count;
+} ArcSample;
+
+/**
+ * Create a shard set. Nothing is opened until an epoch starts, and the
+ * paths are copied.
+ *
+ * @param paths Shard paths
+ * @param count Number of shards
+ * @param opts Options (NULL = defaults)
+ * @return New shard set, or NULL on error
+ */
+ArcShardSet *arc_shard_set_open(const char *const *paths, size_t count, const ArcShardSetOptions *opts);
+
+/**
+ * Start an epoch: stop the current one (dropping its queued samples) and
+ * start reading the shards in this epoch's order.
+ *
+ * @return 0 on success, -1 on error
+ */
+int arc_shard_set_start(ArcShardSet *set, uint64_t epoch);
+
+/**
+ * Shard order of an epoch: fills order[0..count) with shard indexes.
+ * Depends only on the options' shuffle flag and seed.
+ */
+void arc_shard_set_order(const ArcShardSet *set, uint64_t epoch, size_t *order);
+
+/**
+ * Take the next sample of the current epoch, waiting for one if needed.
+ * Safe to call from several consumer threads at once (but not together
+ * with arc_shard_set_start() or arc_shard_set_close()). Without a prior
+ * arc_shard_set_start(), epoch 0 is started.
+ *
+ * @param set The shard set
+ * @param sample Output sample (free with arc_sample_free())
+ * @return 0 on success, 1 at the end of the epoch, -1 if a shard failed
+ *         (errno set; the rest of the epoch still follows)
+ */
+int arc_shard_set_next(ArcShardSet *set, ArcSample **sample);
+
+/**
+ * Field of a sample by name (extension).
+ *
+ * @return The field, or NULL if the sample has none of that name
+ */
+const ArcSampleField *arc_sample_field(const ArcSample *sample, const char *name);
+
+/**
+ * Free a sample returned by arc_shard_set_next().
+ */
+void arc_sample_free(ArcSample *sample);
+
+/**
+ * Stop reading and free the shard set.
+ */
+void arc_shard_set_close(ArcShardSet *set);
+
+#endif // ARC_SHARD_H
@@ -0,0 +1,269 @@
+#define _POSIX_C_SOURCE 200809L
+#include "arc_shuffle.h"
+#include "arc_base.h"
+#include "arc_stream.h"
+#include "arc_zip.h"
+#include "arc_entry.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdbool.h>
+
+#define DEFAULT_WINDOW 64
+
+// A read waiting in the current window
+typedef struct ShuffleRead {
+    int64_t offset;  // Where the entry lives in the archive file
+    size_t file;     // Index into the file table
+} ShuffleRead;
+
+struct ArcShuffle {
+    ArcStream *stream;        // The archive file (the reader's stream)
+    const ArcLimits *limits;
+    ArcEntryHandle *packed;   // Compressed TAR: handle over the whole decompressed archive
+
+    // File table, in listing order
+    ArcEntry *entries;
+    ArcEntryLocation *locs;
+    size_t count;
+
+    // Current pass: order[0..sample) is a random sample of the file indexes
+    size_t *order;
+    size_t sample;
+    size_t taken;             // Positions of order already moved into windows
+
+    ShuffleRead *window;
+    size_t window_size;
+    size_t window_count;
+    size_t window_next;
+
+    size_t current;
+    bool has_current;
+};
+
+static uint64_t splitmix64(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static int compare_reads(const void *a, const void *b) {
+    const ShuffleRead *ra = a;
+    const ShuffleRead *rb = b;
+    if (ra->offset != rb->offset) {
+        return ra->offset < rb->offset ? -1 : 1;
+    }
+    return ra->file < rb->file ? -1 : ra->file > rb->file;
+}
+
+/**
+ * Compressed TAR entries are read back through one entry handle spanning
+ * the decompressed archive (see arc_entry.h): its checkpoints or BGZF
+ * blocks serve every entry, so the archive is decoded once at open time.
+ */
+static int open_packed(ArcShuffle *shuffle, ArcReader *reader, int compression) {
+    ArcEntryLocation whole = { .format = ARC_FORMAT_TAR, .compression = compression };
+    for (size_t i = 0; i < shuffle->count; i++) {
+        uint64_t end = (uint64_t)shuffle->locs[i].offset + shuffle->locs[i].stored_size;
+        if (end > whole.size) {
+            whole.size = end;
+        }
+    }
+    whole.stored_size = whole.size;
+    shuffle->packed = arc_entry_open_location(reader, &whole);
+    return shuffle->packed ? 0 : -1;
+}
+
+static int add_file(ArcShuffle *shuffle, size_t *capacity, ArcEntry *entry, const ArcEntryLocation *loc) {
+    if (shuffle->count == *capacity) {
+        size_t grown = *capacity ? *capacity * 2 : 256;
+        ArcEntry *entries = realloc(shuffle->entries, grown * sizeof(ArcEntry));
+        if (!entries) {
+            return -1;
+        }
+        shuffle->entries = entries;
+        ArcEntryLocation *locs = realloc(shuffle->locs, grown * sizeof(ArcEntryLocation));
+        if (!locs) {
+            return -1;
+        }
+        shuffle->locs = locs;
+        *capacity = grown;
+    }
+    shuffle->entries[shuffle->count] = *entry;
+    shuffle->locs[shuffle->count] = *loc;
+    shuffle->count++;
+    return 0;
+}
+
+ArcShuffle *arc_shuffle_open(ArcReader *reader, const ArcShuffleOptions *opts) {
+    if (!reader) {
+        errno = EINVAL;
+        return NULL;
+    }
+    // TAR readers over a decompression filter can't go back; they are
+    // listed from where they are and read through an entry handle
+    ArcStream *stream = ((ArcReaderBase *)reader)->stream;
+    bool rewound = arc_rewind(reader) == 0;
+    if (!rewound && arc_reader_format(reader) != ARC_FORMAT_TAR) {
+        errno = ENOTSUP;
+        return NULL;
+    }
+    // A reader straight on a descriptor that can't rewind is on a pipe
+    if (rewound ? !stream || !arc_stream_is_seekable(stream) : arc_stream_fd(stream) >= 0) {
+        errno = ESPIPE;
+        return NULL;
+    }
+    ArcShuffle *shuffle = calloc(1, sizeof(ArcShuffle));
+    if (!shuffle) {
+        return NULL;
+    }
+    shuffle->stream = stream;
+    shuffle->limits = ((ArcReaderBase *)reader)->limits;
+
+    size_t capacity = 0;
+    bool packed = !rewound;
+    int compression = -1;
+    ArcEntry entry;
+    int rc;
+    while ((rc = arc_next(reader, &entry)) == 0) {
+        ArcEntryLocation loc;
+        if (arc_reader_entry_location(reader, &loc) < 0 ||
+            (loc.format != ARC_FORMAT_ZIP && loc.format != ARC_FORMAT_TAR)) {
+            arc_entry_free(&entry);
+            errno = ENOTSUP;
+            rc = -1;
+            break;
+        }
+        // Listing-cache readers rewind but still describe compressed offsets
+        if (loc.format == ARC_FORMAT_TAR && loc.compression >= 0) {
+            packed = true;
+            compression = loc.compression;
+        }
+        if (entry.type != ARC_ENTRY_FILE) {
+            arc_entry_free(&entry);
+            continue;
+        }
+        if (add_file(shuffle, &capacity, &entry, &loc) < 0) {
+            arc_entry_free(&entry);
+            rc = -1;
+            break;
+        }
+    }
+    if (rc == 1 && packed && open_packed(shuffle, reader, compression) < 0) {
+        rc = -1;
+    }
+    if (rc < 0) {
+        int saved = errno ? errno : EIO;
+        arc_shuffle_close(shuffle);
+        errno = saved;
+        return NULL;
+    }
+
+    shuffle->sample = opts && opts->sample && opts->sample < shuffle->count ? opts->sample : shuffle->count;
+    shuffle->window_size = opts && opts->window ? opts->window : DEFAULT_WINDOW;
+    if (shuffle->window_size > shuffle->sample) {
+        shuffle->window_size = shuffle->sample ? shuffle->sample : 1;
+    }
+    shuffle->order = malloc((shuffle->count ? shuffle->count : 1) * sizeof(size_t));
+    shuffle->window = malloc(shuffle->window_size * sizeof(ShuffleRead));
+    if (!shuffle->order || !shuffle->window) {
+        arc_shuffle_close(shuffle);
+        errno = ENOMEM;
+        return NULL;
+    }
+    arc_shuffle_reset(shuffle, opts ? opts->seed : 0);
+    return shuffle;
+}
+
+int arc_shuffle_reset(ArcShuffle *shuffle, uint64_t seed) {
+    if (!shuffle) {
+        errno = EINVAL;
+        return -1;
+    }
+    // Fisher-Yates, stopped after the first `sample` positions
+    uint64_t state = seed;
+    for (size_t i = 0; i < shuffle->count; i++) {
+        shuffle->order[i] = i;
+    }
+    for (size_t i = 0; i < shuffle->sample && i + 1 < shuffle->count; i++) {
+        size_t j = i + (size_t)(splitmix64(&state) % (shuffle->count - i));
+        size_t tmp = shuffle->order[i];
+        shuffle->order[i] = shuffle->order[j];
+        shuffle->order[j] = tmp;
+    }
+    shuffle->taken = 0;
+    shuffle->window_count = 0;
+    shuffle->window_next = 0;
+    shuffle->has_current = false;
+    return 0;
+}
+
+int arc_shuffle_next(ArcShuffle *shuffle, const ArcEntry **entry) {
+    if (!shuffle || !entry) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (shuffle->window_next == shuffle->window_count) {
+        if (shuffle->taken == shuffle->sample) {
+            shuffle->has_current = false;
+            *entry = NULL;
+            return 1;
+        }
+        // Next window of the permutation, read in offset order
+        size_t n = shuffle->sample - shuffle->taken;
+        if (n > shuffle->window_size) {
+            n = shuffle->window_size;
+        }
+        for (size_t i = 0; i < n; i++) {
+            size_t file = shuffle->order[shuffle->taken + i];
+            shuffle->window[i].offset = shuffle->locs[file].offset;
+            shuffle->window[i].file = file;
+        }
+        qsort(shuffle->window, n, sizeof(ShuffleRead), compare_reads);
+        shuffle->taken += n;
+        shuffle->window_count = n;
+        shuffle->window_next = 0;
+    }
+    shuffle->current = shuffle->window[shuffle->window_next++].file;
+    shuffle->has_current = true;
+    *entry = &shuffle->entries[shuffle->current];
+    return 0;
+}
+
+ArcStream *arc_shuffle_open_data(ArcShuffle *shuffle) {
+    if (!shuffle || !shuffle->has_current) {
+        errno = EINVAL;
+        return NULL;
+    }
+    const ArcEntryLocation *loc = &shuffle->locs[shuffle->current];
+    if (loc->stored_size == 0) {
+        return NULL;
+    }
+    if (loc->format == ARC_FORMAT_ZIP) {
+        return arc_zip_open_location(shuffle->stream, loc, shuffle->limits);
+    }
+    if (shuffle->packed) {
+        return arc_entry_open_range(shuffle->packed, (uint64_t)loc->offset, loc->stored_size);
+    }
+    return arc_stream_substream(shuffle->stream, loc->offset, (int64_t)loc->stored_size);
+}
+
+size_t arc_shuffle_count(const ArcShuffle *shuffle) {
+    return shuffle ? shuffle->sample : 0;
+}
+
+void arc_shuffle_close(ArcShuffle *shuffle) {
+    if (!shuffle) {
+        return;
+    }
+    for (size_t i = 0; i < shuffle->count; i++) {
+        arc_entry_free(&shuffle->entries[i]);
+    }
+    free(shuffle->entries);
+    free(shuffle->locs);
+    free(shuffle->order);
+    free(shuffle->window);
+    arc_entry_close(shuffle->packed);
+    free(shuffle);
+}
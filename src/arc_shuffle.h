@@ -0,0 +1,89 @@
+#ifndef ARC_SHUFFLE_H
+#define ARC_SHUFFLE_H
+
+#include "arc_reader.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Shuffled and sampled iteration over ZIP and TAR archives (plain or
+ * compressed, including readers served from the listing cache).
+ *
+ * The archive is listed once, then its files are visited in a seeded
+ * pseudo-random permutation, or as a random sample of K of them. Reading
+ * entries in truly random order turns every read into a seek; instead the
+ * permutation is consumed a window at a time and each window is read in
+ * on-disk offset order. The set of entries in a window, and the order of
+ * the windows, stay random; only the order within a window is traded for
+ * mostly sequential disk access. A window of 1 gives the exact permutation.
+ *
+ * Compressed TAR entries are read back through an entry handle over the
+ * whole decompressed archive (see arc_entry.h): .tar.gz is inflated once at
+ * open time to record checkpoints and each file resumes from the nearest
+ * one, BGZF resumes from the block holding the file, and .tar.bz2 / .tar.xz
+ * / .tar.lz4 decode from the start of the archive for every file.
+ */
+
+typedef struct ArcShuffle ArcShuffle;
+
+/**
+ * Options. A zeroed struct (or NULL) visits every file with seed 0 and a
+ * window of 64 reads.
+ */
+typedef struct ArcShuffleOptions {
+    uint64_t seed;   // Permutation seed: the same seed gives the same order
+    size_t sample;   // Files to visit (0 = all; otherwise a random sample, at most all)
+    size_t window;   // Reads reordered by offset at a time (0 = 64, 1 = exact permutation order)
+} ArcShuffleOptions;
+
+/**
+ * List an archive and prepare a shuffled pass over its regular files.
+ * The reader is rewound first; it must stay open while the shuffle is
+ * used, and its cursor must not be moved meanwhile. Compressed TAR readers
+ * can't rewind and are listed from their current entry, so open them fresh.
+ *
+ * @param reader Reader on a seekable ZIP or TAR (compressed TAR must be
+ *               file-backed, e.g. from arc_open_path())
+ * @param opts Options (NULL = defaults)
+ * @return New shuffle, or NULL on error (ENOTSUP for 7z, single compressed
+ *         files and compressed TAR not backed by a file; ESPIPE for
+ *         archives read from a pipe)
+ */
+ArcShuffle *arc_shuffle_open(ArcReader *reader, const ArcShuffleOptions *opts);
+
+/**
+ * Move to the next file of the pass.
+ *
+ * @param shuffle The shuffle
+ * @param entry Output: the entry (owned by the shuffle, valid until it is closed)
+ * @return 0 on success, 1 at the end of the pass, -1 on error
+ */
+int arc_shuffle_next(ArcShuffle *shuffle, const ArcEntry **entry);
+
+/**
+ * Open the data of the current file (see arc_open_data()). Only one data
+ * stream may be open at a time, and it must be closed before the next
+ * arc_shuffle_next().
+ *
+ * @return Data stream, or NULL for empty files or on error
+ */
+ArcStream *arc_shuffle_open_data(ArcShuffle *shuffle);
+
+/**
+ * Number of files the pass visits.
+ */
+size_t arc_shuffle_count(const ArcShuffle *shuffle);
+
+/**
+ * Start another pass with a new seed (same sample size and window).
+ *
+ * @return 0 on success, -1 on error
+ */
+int arc_shuffle_reset(ArcShuffle *shuffle, uint64_t seed);
+
+/**
+ * Free the shuffle (the reader stays open).
+ */
+void arc_shuffle_close(ArcShuffle *shuffle);
+
+#endif // ARC_SHUFFLE_H
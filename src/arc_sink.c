@@ -0,0 +1,561 @@
+#define _POSIX_C_SOURCE 200809L
+#include "arc_sink.h"
+#include "arc_hash.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+void arc_sink_free(ArcSink *sink) {
+    if (sink && sink->vtable && sink->vtable->free) {
+        sink->vtable->free(sink);
+    }
+}
+
+// In-memory tree
+
+typedef struct MemorySink {
+    ArcSink base;
+    ArcMemoryNode *nodes;
+    size_t count;
+    size_t capacity;
+    size_t *slots;          // Open-addressing table of node index + 1 (0 = empty)
+    size_t slot_count;      // Power of two
+} MemorySink;
+
+typedef struct MemoryFile {
+    char *path;
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+    uint32_t mode;
+    uint64_t mtime;
+} MemoryFile;
+
+static uint64_t memory_hash(const char *path, size_t len) {
+    // FNV-1a
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)path[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// Slot holding `path`, or the empty slot where it would go
+static size_t *memory_slot(const MemorySink *ms, const char *path, size_t len) {
+    size_t pos = (size_t)memory_hash(path, len) & (ms->slot_count - 1);
+    while (ms->slots[pos]) {
+        const char *name = ms->nodes[ms->slots[pos] - 1].path;
+        if (strncmp(name, path, len) == 0 && name[len] == '\0') {
+            break;
+        }
+        pos = (pos + 1) & (ms->slot_count - 1);
+    }
+    return &ms->slots[pos];
+}
+
+static int memory_rehash(MemorySink *ms, size_t slot_count) {
+    size_t *slots = calloc(slot_count, sizeof(*slots));
+    if (!slots) {
+        return -1;
+    }
+    for (size_t i = 0; i < ms->count; i++) {
+        size_t pos = (size_t)memory_hash(ms->nodes[i].path, strlen(ms->nodes[i].path)) & (slot_count - 1);
+        while (slots[pos]) {
+            pos = (pos + 1) & (slot_count - 1);
+        }
+        slots[pos] = i + 1;
+    }
+    free(ms->slots);
+    ms->slots = slots;
+    ms->slot_count = slot_count;
+    return 0;
+}
+
+/**
+ * Find or create the node for the first len bytes of path, creating its
+ * parents as directories. An existing node is returned as is.
+ */
+static ArcMemoryNode *memory_node(MemorySink *ms, const char *path, size_t len, int type) {
+    if ((ms->count + 1) * 2 > ms->slot_count) {
+        if (memory_rehash(ms, ms->slot_count ? ms->slot_count * 2 : 64) < 0) {
+            return NULL;
+        }
+    }
+    size_t *slot = memory_slot(ms, path, len);
+    if (*slot) {
+        return &ms->nodes[*slot - 1];
+    }
+
+    // Parents first, so creation order lists them before their children
+    for (size_t i = len; i > 0; i--) {
+        if (path[i - 1] == '/') {
+            if (i > 1 && !memory_node(ms, path, i - 1, ARC_ENTRY_DIR)) {
+                return NULL;
+            }
+            slot = memory_slot(ms, path, len);  // The table may have grown
+            break;
+        }
+    }
+
+    if (ms->count >= ms->capacity) {
+        size_t new_capacity = ms->capacity ? ms->capacity * 2 : 16;
+        ArcMemoryNode *nodes = realloc(ms->nodes, new_capacity * sizeof(*nodes));
+        if (!nodes) {
+            return NULL;
+        }
+        ms->nodes = nodes;
+        ms->capacity = new_capacity;
+    }
+    ArcMemoryNode *node = &ms->nodes[ms->count];
+    memset(node, 0, sizeof(*node));
+    node->path = strndup(path, len);
+    if (!node->path) {
+        return NULL;
+    }
+    node->type = type;
+    node->mode = (type == ARC_ENTRY_DIR) ? 0755 : (type == ARC_ENTRY_SYMLINK) ? 0777 : 0644;
+    *slot = ++ms->count;
+    return node;
+}
+
+// Turn an existing node into a fresh one of the given type
+static void memory_node_reset(ArcMemoryNode *node, int type) {
+    free(node->data);
+    free(node->link_target);
+    node->data = NULL;
+    node->size = 0;
+    node->link_target = NULL;
+    node->type = type;
+    node->mode = (type == ARC_ENTRY_DIR) ? 0755 : (type == ARC_ENTRY_SYMLINK) ? 0777 : 0644;
+    node->mtime = 0;
+}
+
+static int memory_mkdir(ArcSink *sink, const char *path, const ArcEntry *entry) {
+    (void)entry;
+    ArcMemoryNode *node = memory_node((MemorySink *)sink, path, strlen(path), ARC_ENTRY_DIR);
+    if (!node) {
+        return -1;
+    }
+    if (node->type != ARC_ENTRY_DIR) {
+        memory_node_reset(node, ARC_ENTRY_DIR);
+    }
+    return 0;
+}
+
+static void *memory_open_file(ArcSink *sink, const char *path, const ArcEntry *entry) {
+    (void)sink;
+    (void)entry;
+    MemoryFile *file = calloc(1, sizeof(MemoryFile));
+    if (!file || !(file->path = strdup(path))) {
+        free(file);
+        errno = ENOMEM;
+        return NULL;
+    }
+    file->mode = 0644;
+    return file;
+}
+
+static int memory_write(ArcSink *sink, void *file, const void *buf, size_t n) {
+    (void)sink;
+    MemoryFile *f = file;
+    if (n > f->capacity - f->size) {
+        size_t new_capacity = f->capacity ? f->capacity : 4096;
+        while (new_capacity - f->size < n) {
+            if (new_capacity > SIZE_MAX / 2) {
+                errno = ENOMEM;
+                return -1;
+            }
+            new_capacity *= 2;
+        }
+        uint8_t *data = realloc(f->data, new_capacity);
+        if (!data) {
+            return -1;
+        }
+        f->data = data;
+        f->capacity = new_capacity;
+    }
+    memcpy(f->data + f->size, buf, n);
+    f->size += n;
+    return 0;
+}
+
+static int memory_set_attrs(ArcSink *sink, const char *path, void *file, const ArcEntry *entry, unsigned what) {
+    uint32_t *mode;
+    uint64_t *mtime;
+    if (file) {
+        mode = &((MemoryFile *)file)->mode;
+        mtime = &((MemoryFile *)file)->mtime;
+    } else {
+        MemorySink *ms = (MemorySink *)sink;
+        size_t *slot = memory_slot(ms, path, strlen(path));
+        if (!*slot) {
+            errno = ENOENT;
+            return -1;
+        }
+        mode = &ms->nodes[*slot - 1].mode;
+        mtime = &ms->nodes[*slot - 1].mtime;
+    }
+    if ((what & ARC_SINK_ATTR_MODE) && entry->mode != 0) {
+        *mode = entry->mode & 0777;
+    }
+    if (what & ARC_SINK_ATTR_MTIME) {
+        *mtime = entry->mtime;
+    }
+    return 0;
+}
+
+static int memory_close(ArcSink *sink, void *file, bool ok) {
+    MemoryFile *f = file;
+    int result = 0;
+    if (ok) {
+        ArcMemoryNode *node = memory_node((MemorySink *)sink, f->path, strlen(f->path), ARC_ENTRY_FILE);
+        if (node) {
+            memory_node_reset(node, ARC_ENTRY_FILE);
+            node->data = f->data;
+            node->size = f->size;
+            node->mode = f->mode;
+            node->mtime = f->mtime;
+            f->data = NULL;
+        } else {
+            result = -1;
+        }
+    }
+    free(f->data);
+    free(f->path);
+    free(f);
+    return result;
+}
+
+static int memory_symlink(ArcSink *sink, const char *path, const char *target, const ArcEntry *entry) {
+    (void)entry;
+    char *copy = strdup(target);
+    ArcMemoryNode *node = copy ? memory_node((MemorySink *)sink, path, strlen(path), ARC_ENTRY_SYMLINK) : NULL;
+    if (!node) {
+        free(copy);
+        return -1;
+    }
+    memory_node_reset(node, ARC_ENTRY_SYMLINK);
+    node->link_target = copy;
+    return 0;
+}
+
+static void memory_free(ArcSink *sink) {
+    MemorySink *ms = (MemorySink *)sink;
+    for (size_t i = 0; i < ms->count; i++) {
+        free(ms->nodes[i].path);
+        free(ms->nodes[i].data);
+        free(ms->nodes[i].link_target);
+    }
+    free(ms->nodes);
+    free(ms->slots);
+    free(ms);
+}
+
+static const struct ArcSinkVtable memory_sink_vtable = {
+    .mkdir = memory_mkdir,
+    .open_file = memory_open_file,
+    .write = memory_write,
+    .set_attrs = memory_set_attrs,
+    .close = memory_close,
+    .symlink = memory_symlink,
+    .free = memory_free,
+};
+
+ArcSink *arc_sink_memory_new(void) {
+    MemorySink *ms = calloc(1, sizeof(MemorySink));
+    if (!ms) {
+        return NULL;
+    }
+    ms->base.vtable = &memory_sink_vtable;
+    return &ms->base;
+}
+
+size_t arc_sink_memory_count(const ArcSink *sink) {
+    if (!sink || sink->vtable != &memory_sink_vtable) {
+        return 0;
+    }
+    return ((const MemorySink *)sink)->count;
+}
+
+const ArcMemoryNode *arc_sink_memory_node(const ArcSink *sink, size_t index) {
+    if (index >= arc_sink_memory_count(sink)) {
+        return NULL;
+    }
+    return &((const MemorySink *)sink)->nodes[index];
+}
+
+const ArcMemoryNode *arc_sink_memory_find(const ArcSink *sink, const char *path) {
+    if (!path || arc_sink_memory_count(sink) == 0) {
+        return NULL;
+    }
+    const MemorySink *ms = (const MemorySink *)sink;
+    while (path[0] == '.' && path[1] == '/') {
+        path += 2;
+    }
+    size_t len = strlen(path);
+    while (len > 0 && path[len - 1] == '/') {
+        len--;
+    }
+    size_t *slot = memory_slot(ms, path, len);
+    return *slot ? &ms->nodes[*slot - 1] : NULL;
+}
+
+// Content-addressed store
+
+// Longest digest (BLAKE3 / SHA-256) in hex, plus NUL
+#define CAS_HEX_SIZE 65
+
+typedef struct CasSink {
+    ArcSink base;
+    char *dir;
+    unsigned algorithm;
+    ArcCasEntry *entries;
+    size_t count;
+    size_t capacity;
+} CasSink;
+
+typedef struct CasFile {
+    int fd;
+    char *tmp_path;
+    char *path;
+    ArcHasher *hasher;
+    uint64_t size;
+    uint32_t mode;
+    uint64_t mtime;
+} CasFile;
+
+static ArcCasEntry *cas_add(CasSink *cs, const char *path, int type) {
+    if (cs->count >= cs->capacity) {
+        size_t new_capacity = cs->capacity ? cs->capacity * 2 : 16;
+        ArcCasEntry *entries = realloc(cs->entries, new_capacity * sizeof(*entries));
+        if (!entries) {
+            return NULL;
+        }
+        cs->entries = entries;
+        cs->capacity = new_capacity;
+    }
+    ArcCasEntry *e = &cs->entries[cs->count];
+    memset(e, 0, sizeof(*e));
+    e->path = strdup(path);
+    if (!e->path) {
+        return NULL;
+    }
+    e->type = type;
+    e->mode = (type == ARC_ENTRY_DIR) ? 0755 : (type == ARC_ENTRY_SYMLINK) ? 0777 : 0644;
+    cs->count++;
+    return e;
+}
+
+static int cas_mkdir(ArcSink *sink, const char *path, const ArcEntry *entry) {
+    (void)entry;
+    return cas_add((CasSink *)sink, path, ARC_ENTRY_DIR) ? 0 : -1;
+}
+
+static void *cas_open_file(ArcSink *sink, const char *path, const ArcEntry *entry) {
+    (void)entry;
+    CasSink *cs = (CasSink *)sink;
+    CasFile *file = calloc(1, sizeof(CasFile));
+    if (!file) {
+        return NULL;
+    }
+    size_t tmp_size = strlen(cs->dir) + sizeof("/.tmp-XXXXXX");
+    file->fd = -1;
+    file->tmp_path = malloc(tmp_size);
+    file->path = strdup(path);
+    file->hasher = arc_hasher_new(cs->algorithm);
+    if (file->tmp_path && file->path && file->hasher) {
+        snprintf(file->tmp_path, tmp_size, "%s/.tmp-XXXXXX", cs->dir);
+        file->fd = mkstemp(file->tmp_path);
+    }
+    if (file->fd < 0) {
+        int saved = file->tmp_path && file->path && file->hasher ? errno : ENOMEM;
+        arc_hasher_free(file->hasher);
+        free(file->path);
+        free(file->tmp_path);
+        free(file);
+        errno = saved;
+        return NULL;
+    }
+    file->mode = 0644;
+    return file;
+}
+
+static int cas_write(ArcSink *sink, void *file, const void *buf, size_t n) {
+    (void)sink;
+    CasFile *f = file;
+    arc_hasher_update(f->hasher, buf, n);
+    f->size += n;
+    const uint8_t *p = buf;
+    while (n > 0) {
+        ssize_t written = write(f->fd, p, n);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += written;
+        n -= (size_t)written;
+    }
+    return 0;
+}
+
+static int cas_set_attrs(ArcSink *sink, const char *path, void *file, const ArcEntry *entry, unsigned what) {
+    uint32_t *mode;
+    uint64_t *mtime;
+    if (file) {
+        mode = &((CasFile *)file)->mode;
+        mtime = &((CasFile *)file)->mtime;
+    } else {
+        // The directory just recorded by cas_mkdir()
+        CasSink *cs = (CasSink *)sink;
+        if (cs->count == 0 || strcmp(cs->entries[cs->count - 1].path, path) != 0) {
+            errno = ENOENT;
+            return -1;
+        }
+        mode = &cs->entries[cs->count - 1].mode;
+        mtime = &cs->entries[cs->count - 1].mtime;
+    }
+    if ((what & ARC_SINK_ATTR_MODE) && entry->mode != 0) {
+        *mode = entry->mode & 0777;
+    }
+    if (what & ARC_SINK_ATTR_MTIME) {
+        *mtime = entry->mtime;
+    }
+    return 0;
+}
+
+// Move a finished temporary file to its object path (unless already stored)
+static int cas_store(CasSink *cs, CasFile *f, const char *hex) {
+    size_t dir_len = strlen(cs->dir);
+    char *object = malloc(dir_len + strlen(hex) + 3);
+    if (!object) {
+        return -1;
+    }
+    snprintf(object, dir_len + 4, "%s/%.2s", cs->dir, hex);
+    int result = -1;
+    if (mkdir(object, 0755) == 0 || errno == EEXIST) {
+        snprintf(object, dir_len + strlen(hex) + 3, "%s/%.2s/%s", cs->dir, hex, hex + 2);
+        struct stat st;
+        if (stat(object, &st) == 0) {
+            unlink(f->tmp_path);    // Deduplicated
+            result = 0;
+        } else if (errno == ENOENT && fchmod(f->fd, 0444) == 0) {
+            result = rename(f->tmp_path, object);
+        }
+    }
+    int saved = errno;
+    free(object);
+    errno = saved;
+    return result;
+}
+
+static int cas_close(ArcSink *sink, void *file, bool ok) {
+    CasSink *cs = (CasSink *)sink;
+    CasFile *f = file;
+    int result = -1;
+    if (ok) {
+        ArcDigests digests;
+        char hex[CAS_HEX_SIZE];
+        arc_hasher_final(f->hasher, &digests);
+        if (arc_digest_hex(&digests, cs->algorithm, hex, sizeof(hex)) > 2 && cas_store(cs, f, hex) == 0) {
+            ArcCasEntry *e = cas_add(cs, f->path, ARC_ENTRY_FILE);
+            if (e && (e->digest = strdup(hex))) {
+                e->size = f->size;
+                e->mode = f->mode;
+                e->mtime = f->mtime;
+                result = 0;
+            }
+        }
+    }
+    int saved = errno;
+    if (result < 0) {
+        unlink(f->tmp_path);
+    }
+    close(f->fd);
+    arc_hasher_free(f->hasher);
+    free(f->tmp_path);
+    free(f->path);
+    free(f);
+    errno = saved;
+    return ok ? result : 0;
+}
+
+static int cas_symlink(ArcSink *sink, const char *path, const char *target, const ArcEntry *entry) {
+    (void)entry;
+    ArcCasEntry *e = cas_add((CasSink *)sink, path, ARC_ENTRY_SYMLINK);
+    if (!e) {
+        return -1;
+    }
+    e->link_target = strdup(target);
+    return e->link_target ? 0 : -1;
+}
+
+static void cas_free(ArcSink *sink) {
+    CasSink *cs = (CasSink *)sink;
+    for (size_t i = 0; i < cs->count; i++) {
+        free(cs->entries[i].path);
+        free(cs->entries[i].digest);
+        free(cs->entries[i].link_target);
+    }
+    free(cs->entries);
+    free(cs->dir);
+    free(cs);
+}
+
+static const struct ArcSinkVtable cas_sink_vtable = {
+    .mkdir = cas_mkdir,
+    .open_file = cas_open_file,
+    .write = cas_write,
+    .set_attrs = cas_set_attrs,
+    .close = cas_close,
+    .symlink = cas_symlink,
+    .free = cas_free,
+};
+
+ArcSink *arc_sink_cas_new(const char *store_dir, unsigned algorithm) {
+    if (algorithm == 0) {
+        algorithm = ARC_HASH_SHA256;
+    }
+    // Exactly one known algorithm
+    if (!store_dir || (algorithm & ~ARC_HASH_ALL) || (algorithm & (algorithm - 1))) {
+        errno = EINVAL;
+        return NULL;
+    }
+    struct stat st;
+    if (stat(store_dir, &st) < 0) {
+        return NULL;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        errno = ENOTDIR;
+        return NULL;
+    }
+    CasSink *cs = calloc(1, sizeof(CasSink));
+    if (!cs || !(cs->dir = strdup(store_dir))) {
+        free(cs);
+        errno = ENOMEM;
+        return NULL;
+    }
+    cs->base.vtable = &cas_sink_vtable;
+    cs->algorithm = algorithm;
+    return &cs->base;
+}
+
+size_t arc_sink_cas_count(const ArcSink *sink) {
+    if (!sink || sink->vtable != &cas_sink_vtable) {
+        return 0;
+    }
+    return ((const CasSink *)sink)->count;
+}
+
+const ArcCasEntry *arc_sink_cas_entry(const ArcSink *sink, size_t index) {
+    if (index >= arc_sink_cas_count(sink)) {
+        return NULL;
+    }
+    return &((const CasSink *)sink)->entries[index];
+}
@@ -0,0 +1,192 @@
+#ifndef ARC_SINK_H
+#define ARC_SINK_H
+
+#include "arc_reader.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * Extraction sinks: where extracted entries go.
+ *
+ * arc_extract_to_sink() decodes each entry once and streams its data
+ * through the sink's vtable, so an archive can be unpacked straight into
+ * memory, a blob store or any other destination without a temporary
+ * directory in between. Entry paths are validated (no absolute paths or
+ * "..") and normalized (no leading "./", no trailing '/') before a sink
+ * sees them.
+ *
+ * Built in:
+ * - arc_sink_fs_new(): a local directory, with the same openat()-anchored
+ *   safety as arc_extract_to_path()
+ * - arc_sink_memory_new(): an in-memory tree of nodes
+ * - arc_sink_cas_new(): a content-addressed store directory; file data is
+ *   written once, under its digest, while it is being hashed
+ */
+
+typedef struct ArcSink ArcSink;
+
+// Attributes set_attrs() should apply (from ArcExtractOptions' preserve flags)
+#define ARC_SINK_ATTR_MODE  0x1u
+#define ARC_SINK_ATTR_MTIME 0x2u
+
+/**
+ * Virtual function table for sinks.
+ */
+struct ArcSinkVtable {
+    /**
+     * Create a directory (and any missing parents).
+     * Returns 0 on success, -1 on error.
+     */
+    int (*mkdir)(ArcSink *sink, const char *path, const ArcEntry *entry);
+
+    /**
+     * Start writing a file (creating missing parent directories).
+     * Returns a handle passed to write/set_attrs/close, or NULL on error.
+     */
+    void *(*open_file)(ArcSink *sink, const char *path, const ArcEntry *entry);
+
+    /**
+     * Append n bytes to a file.
+     * Returns 0 on success, -1 on error.
+     */
+    int (*write)(ArcSink *sink, void *file, const void *buf, size_t n);
+
+    /**
+     * Apply the ARC_SINK_ATTR_* attributes in `what` from the entry
+     * (optional, may be NULL). file is NULL for directories.
+     * Returns 0 on success, -1 on error.
+     */
+    int (*set_attrs)(ArcSink *sink, const char *path, void *file, const ArcEntry *entry, unsigned what);
+
+    /**
+     * Finish a file and free its handle: keep it if ok, discard it otherwise.
+     * Returns 0 on success, -1 on error.
+     */
+    int (*close)(ArcSink *sink, void *file, bool ok);
+
+    /**
+     * Create a symlink (optional, may be NULL: symlinks are skipped).
+     * Returns 0 on success, -1 on error.
+     */
+    int (*symlink)(ArcSink *sink, const char *path, const char *target, const ArcEntry *entry);
+
+    /**
+     * Free the sink.
+     */
+    void (*free)(ArcSink *sink);
+};
+
+/**
+ * Sink structure.
+ */
+struct ArcSink {
+    const struct ArcSinkVtable *vtable;
+    void *user_data;         // Implementation-specific data
+};
+
+/**
+ * Extract all entries into a sink.
+ *
+ * Honors the preserve flags (as ARC_SINK_ATTR_* for set_attrs),
+ * hash_algorithms and the include/exclude patterns of the options;
+ * hash_xattrs only applies to arc_extract_to_path_ex(). Hard links go
+ * through open_file/write/close with the link entry's own data, which
+ * TAR doesn't store: the sink gets an empty file, and entry->type
+ * (ARC_ENTRY_HARDLINK) and entry->link_target name the earlier file it
+ * should share data with. Data goes through buffers taken from a small
+ * process-wide pool, so repeated extractions don't allocate.
+ *
+ * @param reader The archive reader
+ * @param sink Destination
+ * @param opts Extraction options (NULL = defaults)
+ * @param report Filled with the files written and their digests (may be NULL)
+ * @return 0 on success, <0 if any entry failed (the others are still written)
+ */
+int arc_extract_to_sink(ArcReader *reader, ArcSink *sink, const ArcExtractOptions *opts,
+                        ArcExtractReport *report);
+
+/**
+ * Free a sink.
+ */
+void arc_sink_free(ArcSink *sink);
+
+/**
+ * Sink writing into an existing local directory.
+ *
+ * @return New sink, or NULL on error (ENOTDIR if dest_dir isn't a directory)
+ */
+ArcSink *arc_sink_fs_new(const char *dest_dir);
+
+/**
+ * A node of the in-memory tree.
+ */
+typedef struct ArcMemoryNode {
+    char *path;             // Normalized path, e.g. "dir/file.txt"
+    int type;               // ARC_ENTRY_FILE, ARC_ENTRY_DIR or ARC_ENTRY_SYMLINK
+    uint32_t mode;          // Permission bits (0644 / 0755 unless preserved)
+    uint64_t mtime;         // 0 unless preserved
+    uint8_t *data;          // File contents (NULL if empty)
+    size_t size;
+    char *link_target;      // Symlinks only
+} ArcMemoryNode;
+
+/**
+ * Sink building an in-memory tree. Parent directories are created
+ * implicitly; a path written twice keeps the last contents.
+ */
+ArcSink *arc_sink_memory_new(void);
+
+/**
+ * Number of nodes in a memory sink (0 for other sinks).
+ */
+size_t arc_sink_memory_count(const ArcSink *sink);
+
+/**
+ * Node by position, in creation order (parents before their children).
+ */
+const ArcMemoryNode *arc_sink_memory_node(const ArcSink *sink, size_t index);
+
+/**
+ * Node by path (leading "./" and trailing '/' ignored).
+ *
+ * @return The node, or NULL if there is none
+ */
+const ArcMemoryNode *arc_sink_memory_find(const ArcSink *sink, const char *path);
+
+/**
+ * An entry recorded by a content-addressed sink.
+ */
+typedef struct ArcCasEntry {
+    char *path;
+    int type;               // ARC_ENTRY_FILE, ARC_ENTRY_DIR or ARC_ENTRY_SYMLINK
+    uint32_t mode;
+    uint64_t mtime;
+    uint64_t size;
+    char *digest;           // Files: hex digest naming the object
+    char *link_target;      // Symlinks only
+} ArcCasEntry;
+
+/**
+ * Sink writing file data into a content-addressed store: the object for a
+ * digest "abcd..." is <store_dir>/ab/cd..., written once (data already in
+ * the store is not written again). Directories and symlinks are only
+ * recorded, so the entries form a manifest of the archive.
+ *
+ * @param store_dir Existing store directory
+ * @param algorithm One ARC_HASH_* algorithm naming the objects (0 = SHA-256)
+ * @return New sink, or NULL on error
+ */
+ArcSink *arc_sink_cas_new(const char *store_dir, unsigned algorithm);
+
+/**
+ * Number of entries recorded by a CAS sink (0 for other sinks).
+ */
+size_t arc_sink_cas_count(const ArcSink *sink);
+
+/**
+ * Recorded entry by position, in archive order.
+ */
+const ArcCasEntry *arc_sink_cas_entry(const ArcSink *sink, size_t index);
+
+#endif // ARC_SINK_H
@@ -1,3 +1,4 @@
+#define _POSIX_C_SOURCE 200809L
 #include "arc_stream.h"
 #include <stdlib.h>
 #include <string.h>
@@ -21,6 +22,16 @@ static int substream_seek(ArcStream *stream, int64_t off, int whence);
 static int64_t substream_tell(ArcStream *stream);
 static void substream_close(ArcStream *stream);
 
+static ssize_t pread_read(ArcStream *stream, void *buf, size_t n);
+static int pread_seek(ArcStream *stream, int64_t off, int whence);
+static int64_t pread_tell(ArcStream *stream);
+static void pread_close(ArcStream *stream);
+
+static ssize_t spill_read(ArcStream *stream, void *buf, size_t n);
+static int spill_seek(ArcStream *stream, int64_t off, int whence);
+static int64_t spill_tell(ArcStream *stream);
+static void spill_close(ArcStream *stream);
+
 // Vtables
 static const struct ArcStreamVtable fd_vtable = {
     .read = fd_read,
@@ -43,6 +54,20 @@ static const struct ArcStreamVtable substream_vtable = {
     .close = substream_close,
 };
 
+static const struct ArcStreamVtable pread_vtable = {
+    .read = pread_read,
+    .seek = pread_seek,
+    .tell = pread_tell,
+    .close = pread_close,
+};
+
+static const struct ArcStreamVtable spill_vtable = {
+    .read = spill_read,
+    .seek = spill_seek,
+    .tell = spill_tell,
+    .close = spill_close,
+};
+
 // File descriptor stream implementation
 struct FdStreamData {
     int fd;
@@ -176,6 +201,10 @@ static int mem_seek(ArcStream *stream, int64_t off, int whence) {
     }
     
     data->pos = new_pos;
+    // Same as fd streams: rewinding allows a fresh filter to read from the start
+    if (whence == SEEK_SET && off == 0) {
+        stream->bytes_read = 0;
+    }
     return 0;
 }
 
@@ -222,8 +251,11 @@ static ssize_t substream_read(ArcStream *stream, void *buf, size_t n) {
         n = (size_t)remaining;
     }
     
-    // Seek parent to correct position
-    if (arc_stream_seek(data->parent, data->offset + data->pos, SEEK_SET) < 0) {
+    // Seek parent to correct position (skip the seek when already there, so
+    // forward-only parents such as decompression filters work for sequential reads)
+    int64_t target = data->offset + data->pos;
+    if (arc_stream_tell(data->parent) != target &&
+        arc_stream_seek(data->parent, target, SEEK_SET) < 0) {
         return -1;
     }
     
@@ -276,6 +308,234 @@ static void substream_close(ArcStream *stream) {
     free(stream);
 }
 
+// Positional stream implementation (pread(2): no shared file offset)
+struct PreadStreamData {
+    int fd;
+    int64_t offset;
+    int64_t length;
+    int64_t pos;
+};
+
+static ssize_t pread_read(ArcStream *stream, void *buf, size_t n) {
+    struct PreadStreamData *data = (struct PreadStreamData *)stream->user_data;
+    
+    // Enforce byte limit
+    if (stream->byte_limit > 0) {
+        int64_t remaining = stream->byte_limit - stream->bytes_read;
+        if (remaining <= 0) {
+            return 0; // EOF (limit reached)
+        }
+        if ((int64_t)n > remaining) {
+            n = (size_t)remaining;
+        }
+    }
+    
+    int64_t remaining = data->length - data->pos;
+    if (remaining <= 0) {
+        return 0; // EOF
+    }
+    if ((int64_t)n > remaining) {
+        n = (size_t)remaining;
+    }
+    
+    ssize_t ret = pread(data->fd, buf, n, (off_t)(data->offset + data->pos));
+    if (ret > 0) {
+        data->pos += ret;
+        stream->bytes_read += ret;
+    }
+    return ret;
+}
+
+static int pread_seek(ArcStream *stream, int64_t off, int whence) {
+    struct PreadStreamData *data = (struct PreadStreamData *)stream->user_data;
+    int64_t new_pos;
+    
+    switch (whence) {
+        case SEEK_SET:
+            new_pos = off;
+            break;
+        case SEEK_CUR:
+            new_pos = data->pos + off;
+            break;
+        case SEEK_END:
+            new_pos = data->length + off;
+            break;
+        default:
+            errno = EINVAL;
+            return -1;
+    }
+    
+    if (new_pos < 0 || new_pos > data->length) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    data->pos = new_pos;
+    return 0;
+}
+
+static int64_t pread_tell(ArcStream *stream) {
+    struct PreadStreamData *data = (struct PreadStreamData *)stream->user_data;
+    return data->pos;
+}
+
+static void pread_close(ArcStream *stream) {
+    // Note: We don't close the fd - caller owns it
+    free(stream->user_data);
+    free(stream);
+}
+
+// Spill stream implementation (seekable view of a forward-only stream)
+struct SpillStreamData {
+    ArcStream *source;  // Owned
+    uint8_t *buf;       // Bytes [0, kept) of the source
+    size_t kept;
+    size_t buf_size;
+    size_t capacity;    // Max bytes kept in memory
+    int64_t src_pos;    // Bytes consumed from the source (kept <= src_pos)
+    int64_t pos;
+    bool src_eof;
+};
+
+// Pull more bytes from the source, keeping them while they fit
+static ssize_t spill_fill(struct SpillStreamData *data, void *buf, size_t n) {
+    ssize_t got = arc_stream_read(data->source, buf, n);
+    if (got <= 0) {
+        if (got == 0) {
+            data->src_eof = true;
+        }
+        return got;
+    }
+    size_t keep = 0;
+    if ((int64_t)data->kept == data->src_pos && data->kept < data->capacity) {
+        keep = data->capacity - data->kept;
+        if (keep > (size_t)got) {
+            keep = (size_t)got;
+        }
+    }
+    if (keep > 0) {
+        if (data->kept + keep > data->buf_size) {
+            size_t new_size = data->buf_size ? data->buf_size : 64 * 1024;
+            while (new_size < data->kept + keep) {
+                new_size *= 2;
+            }
+            if (new_size > data->capacity) {
+                new_size = data->capacity;
+            }
+            uint8_t *grown = realloc(data->buf, new_size);
+            if (!grown) {
+                return -1;
+            }
+            data->buf = grown;
+            data->buf_size = new_size;
+        }
+        memcpy(data->buf + data->kept, buf, keep);
+        data->kept += keep;
+    }
+    data->src_pos += got;
+    return got;
+}
+
+static ssize_t spill_read(ArcStream *stream, void *buf, size_t n) {
+    struct SpillStreamData *data = (struct SpillStreamData *)stream->user_data;
+    
+    // Enforce byte limit
+    if (stream->byte_limit > 0) {
+        int64_t remaining = stream->byte_limit - stream->bytes_read;
+        if (remaining <= 0) {
+            return 0; // EOF (limit reached)
+        }
+        if ((int64_t)n > remaining) {
+            n = (size_t)remaining;
+        }
+    }
+    
+    ssize_t ret;
+    if (data->pos < (int64_t)data->kept) {
+        size_t avail = data->kept - (size_t)data->pos;
+        ret = (ssize_t)(n < avail ? n : avail);
+        memcpy(buf, data->buf + data->pos, (size_t)ret);
+    } else if (data->pos == data->src_pos) {
+        ret = spill_fill(data, buf, n);
+    } else {
+        // These bytes were passed through without being kept
+        errno = EFBIG;
+        return -1;
+    }
+    if (ret > 0) {
+        data->pos += ret;
+        stream->bytes_read += ret;
+    }
+    return ret;
+}
+
+static int spill_seek(ArcStream *stream, int64_t off, int whence) {
+    struct SpillStreamData *data = (struct SpillStreamData *)stream->user_data;
+    uint8_t discard[8192];
+    int64_t target;
+    
+    switch (whence) {
+        case SEEK_SET:
+            target = off;
+            break;
+        case SEEK_CUR:
+            target = data->pos + off;
+            break;
+        case SEEK_END:
+            // The end is only known once the source is drained; give up
+            // as soon as the buffer overflows (the tail couldn't be replayed)
+            while (!data->src_eof) {
+                if ((int64_t)data->kept < data->src_pos) {
+                    errno = EFBIG;
+                    return -1;
+                }
+                if (spill_fill(data, discard, sizeof(discard)) < 0) {
+                    return -1;
+                }
+            }
+            target = data->src_pos + off;
+            break;
+        default:
+            errno = EINVAL;
+            return -1;
+    }
+    if (target < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    // Forward past what has been read: consume the source up to the target
+    while (target > data->src_pos && !data->src_eof) {
+        int64_t left = target - data->src_pos;
+        if (spill_fill(data, discard, left < (int64_t)sizeof(discard) ? (size_t)left : sizeof(discard)) < 0) {
+            return -1;
+        }
+    }
+    if (target > data->src_pos) {
+        errno = EINVAL; // Past the end of the source
+        return -1;
+    }
+    if (target >= (int64_t)data->kept && target < data->src_pos) {
+        errno = EFBIG; // Dropped after the capacity was reached
+        return -1;
+    }
+    data->pos = target;
+    return 0;
+}
+
+static int64_t spill_tell(ArcStream *stream) {
+    struct SpillStreamData *data = (struct SpillStreamData *)stream->user_data;
+    return data->pos;
+}
+
+static void spill_close(ArcStream *stream) {
+    struct SpillStreamData *data = (struct SpillStreamData *)stream->user_data;
+    arc_stream_close(data->source);
+    free(data->buf);
+    free(data);
+    free(stream);
+}
+
 // Public API
 ssize_t arc_stream_read(ArcStream *stream, void *buf, size_t n) {
     if (!stream || !stream->vtable || !stream->vtable->read) {
@@ -391,3 +651,198 @@ ArcStream *arc_stream_substream(ArcStream *parent, int64_t offset, int64_t lengt
     return stream;
 }
 
+ArcStream *arc_stream_pread(int fd, int64_t offset, int64_t length) {
+    if (fd < 0 || offset < 0 || length < 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    ArcStream *stream = calloc(1, sizeof(ArcStream));
+    if (!stream) {
+        return NULL;
+    }
+    
+    struct PreadStreamData *data = calloc(1, sizeof(struct PreadStreamData));
+    if (!data) {
+        free(stream);
+        return NULL;
+    }
+    
+    data->fd = fd;
+    data->offset = offset;
+    data->length = length;
+    data->pos = 0;
+    
+    stream->vtable = &pread_vtable;
+    stream->byte_limit = 0; // Bounded by length; seeking back must not eat a budget
+    stream->bytes_read = 0;
+    stream->user_data = data;
+    
+    return stream;
+}
+
+int arc_stream_fd(ArcStream *stream) {
+    if (!stream || stream->vtable != &fd_vtable) {
+        return -1;
+    }
+    return ((struct FdStreamData *)stream->user_data)->fd;
+}
+
+ArcStream *arc_stream_spill(ArcStream *source, const void *prefix, size_t prefix_len, size_t capacity) {
+    if (!source || (prefix_len > 0 && !prefix)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    ArcStream *stream = calloc(1, sizeof(ArcStream));
+    if (!stream) {
+        return NULL;
+    }
+    
+    struct SpillStreamData *data = calloc(1, sizeof(struct SpillStreamData));
+    if (!data) {
+        free(stream);
+        return NULL;
+    }
+    
+    // The prefix is always kept so it can be replayed, even beyond capacity
+    data->source = source;
+    data->capacity = capacity > prefix_len ? capacity : prefix_len;
+    if (prefix_len > 0) {
+        data->buf = malloc(prefix_len);
+        if (!data->buf) {
+            free(data);
+            free(stream);
+            return NULL;
+        }
+        memcpy(data->buf, prefix, prefix_len);
+        data->buf_size = prefix_len;
+        data->kept = prefix_len;
+        data->src_pos = (int64_t)prefix_len;
+    }
+    
+    stream->vtable = &spill_vtable;
+    stream->byte_limit = 0; // The source enforces its own limit
+    stream->bytes_read = 0;
+    stream->user_data = data;
+    
+    return stream;
+}
+
+bool arc_stream_is_seekable(ArcStream *stream) {
+    if (!stream) {
+        return false;
+    }
+    if (stream->vtable == &fd_vtable) {
+        return lseek(((struct FdStreamData *)stream->user_data)->fd, 0, SEEK_CUR) != (off_t)-1;
+    }
+    if (stream->vtable == &mem_vtable || stream->vtable == &pread_vtable) {
+        return true;
+    }
+    if (stream->vtable == &substream_vtable) {
+        return arc_stream_is_seekable(((struct SubstreamData *)stream->user_data)->parent);
+    }
+    if (stream->vtable == &spill_vtable) {
+        struct SpillStreamData *data = (struct SpillStreamData *)stream->user_data;
+        return (int64_t)data->kept == data->src_pos;
+    }
+    return false; // Decompression filters and unknown streams
+}
+
+// Output streams
+
+static int out_fd_write(ArcOutStream *stream, const void *buf, size_t n);
+static void out_fd_close(ArcOutStream *stream);
+
+static const struct ArcOutStreamVtable out_fd_vtable = {
+    .write = out_fd_write,
+    .finish = NULL,
+    .close = out_fd_close,
+};
+
+struct OutFdStreamData {
+    int fd;
+};
+
+static int out_fd_write(ArcOutStream *stream, const void *buf, size_t n) {
+    struct OutFdStreamData *data = (struct OutFdStreamData *)stream->user_data;
+    const uint8_t *p = buf;
+    while (n > 0) {
+        ssize_t ret = write(data->fd, p, n);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += ret;
+        n -= (size_t)ret;
+    }
+    return 0;
+}
+
+static void out_fd_close(ArcOutStream *stream) {
+    free(stream->user_data);
+    free(stream);
+}
+
+int arc_out_stream_write(ArcOutStream *stream, const void *buf, size_t n) {
+    if (!stream || (!buf && n > 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (n == 0) {
+        return 0;
+    }
+    if (stream->vtable->write(stream, buf, n) < 0) {
+        return -1;
+    }
+    stream->bytes_written += (int64_t)n;
+    return 0;
+}
+
+int arc_out_stream_finish(ArcOutStream *stream) {
+    if (!stream) {
+        errno = EINVAL;
+        return -1;
+    }
+    return stream->vtable->finish ? stream->vtable->finish(stream) : 0;
+}
+
+void arc_out_stream_close(ArcOutStream *stream) {
+    if (stream) {
+        stream->vtable->close(stream);
+    }
+}
+
+ArcOutStream *arc_out_stream_from_fd(int fd) {
+    if (fd < 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    ArcOutStream *stream = calloc(1, sizeof(ArcOutStream));
+    if (!stream) {
+        return NULL;
+    }
+    
+    struct OutFdStreamData *data = calloc(1, sizeof(struct OutFdStreamData));
+    if (!data) {
+        free(stream);
+        return NULL;
+    }
+    data->fd = fd;
+    
+    stream->vtable = &out_fd_vtable;
+    stream->bytes_written = 0;
+    stream->user_data = data;
+    
+    return stream;
+}
+
+int arc_out_stream_fd(ArcOutStream *stream) {
+    if (!stream || stream->vtable != &out_fd_vtable) {
+        return -1;
+    }
+    return ((struct OutFdStreamData *)stream->user_data)->fd;
+}
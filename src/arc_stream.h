@@ -3,6 +3,7 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <sys/types.h>
 
 /**
@@ -122,5 +123,124 @@ ArcStream *arc_stream_from_memory(const void *data, size_t size, int64_t byte_li
  */
 ArcStream *arc_stream_substream(ArcStream *parent, int64_t offset, int64_t length);
 
+/**
+ * Create a positional stream over a byte range of a file.
+ * Reads use pread(2) and never move the descriptor's file offset, so any
+ * number of these streams can share one descriptor across threads.
+ * 
+ * @param fd File descriptor (not closed by the stream; must outlive it)
+ * @param offset File offset where the range starts
+ * @param length Length of the range
+ * @return New stream, or NULL on error
+ */
+ArcStream *arc_stream_pread(int fd, int64_t offset, int64_t length);
+
+/**
+ * File descriptor behind a stream created by arc_stream_from_fd().
+ * 
+ * @return The descriptor, or -1 for any other kind of stream
+ */
+int arc_stream_fd(ArcStream *stream);
+
+/**
+ * Create a spill stream: a seekable view of a forward-only stream.
+ * Bytes read from `source` are kept in memory (up to `capacity`), so any
+ * earlier position can be read again. Past the capacity, reads continue
+ * straight from the source and seeking back into the dropped range fails
+ * with EFBIG.
+ * 
+ * @param source Stream to wrap (owned: closed with the spill stream)
+ * @param prefix Bytes already read from source (e.g. sniffed magic), replayed first (may be NULL)
+ * @param prefix_len Length of prefix
+ * @param capacity Max bytes kept in memory
+ * @return New stream, or NULL on error (source is not closed on error)
+ */
+ArcStream *arc_stream_spill(ArcStream *source, const void *prefix, size_t prefix_len, size_t capacity);
+
+/**
+ * Whether every position of the stream can be read again after seeking
+ * (true for file, memory and positional streams, substreams of seekable
+ * streams, and spill streams that haven't dropped anything).
+ */
+bool arc_stream_is_seekable(ArcStream *stream);
+
+/**
+ * Output stream: the writing counterpart of ArcStream.
+ * 
+ * The archive writers emit through one, and write filters (compressors)
+ * wrap another output stream the way read filters wrap an ArcStream.
+ */
+typedef struct ArcOutStream ArcOutStream;
+
+/**
+ * Virtual function table for output streams.
+ */
+struct ArcOutStreamVtable {
+    /**
+     * Write all n bytes.
+     * Returns 0 on success, -1 on error.
+     */
+    int (*write)(ArcOutStream *stream, const void *buf, size_t n);
+    
+    /**
+     * Flush buffered data and write any trailer (optional, may be NULL).
+     * Returns 0 on success, -1 on error.
+     */
+    int (*finish)(ArcOutStream *stream);
+    
+    /**
+     * Free the stream (without finishing it).
+     */
+    void (*close)(ArcOutStream *stream);
+};
+
+/**
+ * Output stream structure.
+ */
+struct ArcOutStream {
+    const struct ArcOutStreamVtable *vtable;
+    int64_t bytes_written;   // Total bytes accepted so far
+    void *user_data;         // Implementation-specific data
+};
+
+/**
+ * Write to an output stream. Partial writes are retried until all n bytes
+ * are written or an error occurs.
+ * 
+ * @return 0 on success, -1 on error
+ */
+int arc_out_stream_write(ArcOutStream *stream, const void *buf, size_t n);
+
+/**
+ * Flush an output stream and write its trailer (e.g. the gzip CRC).
+ * Filters finish their own data only; the stream they wrap is not finished.
+ * 
+ * @return 0 on success, -1 on error
+ */
+int arc_out_stream_finish(ArcOutStream *stream);
+
+/**
+ * Free an output stream. Data not yet finished is discarded.
+ */
+void arc_out_stream_close(ArcOutStream *stream);
+
+/**
+ * Create an output stream writing to a file descriptor at its current
+ * offset.
+ * 
+ * @param fd File descriptor (not closed by the stream; must outlive it)
+ * @return New stream, or NULL on error
+ */
+ArcOutStream *arc_out_stream_from_fd(int fd);
+
+/**
+ * File descriptor behind a stream created by arc_out_stream_from_fd(), for
+ * zero-copy transfers (copy_file_range(), sendfile()). Bytes written to it
+ * directly must be added to bytes_written by the caller.
+ * 
+ * @return The descriptor, or -1 for any other kind of stream
+ */
+int arc_out_stream_fd(ArcOutStream *stream);
+
 #endif // ARC_STREAM_H
 
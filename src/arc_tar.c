@@ -4,6 +4,7 @@
 #include "arc_base.h"
 #include "arc_stream.h"
 #include "arc_filter.h"
+#include "arc_tar_format.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -15,66 +16,6 @@
 #include <ctype.h>
 #include <math.h>
 
-#define TAR_BLOCK_SIZE 512
-#define TAR_NAME_SIZE 100
-#define TAR_MODE_SIZE 8
-#define TAR_UID_SIZE 8
-#define TAR_GID_SIZE 8
-#define TAR_SIZE_SIZE 12
-#define TAR_MTIME_SIZE 12
-#define TAR_CHKSUM_SIZE 8
-#define TAR_TYPE_SIZE 1
-#define TAR_LINKNAME_SIZE 100
-#define TAR_MAGIC_SIZE 6
-#define TAR_VERSION_SIZE 2
-#define TAR_UNAME_SIZE 32
-#define TAR_GNAME_SIZE 32
-#define TAR_DEVMAJOR_SIZE 8
-#define TAR_DEVMINOR_SIZE 8
-#define TAR_PREFIX_SIZE 155
-
-// TAR header structure (ustar)
-struct TarHeader {
-    char name[TAR_NAME_SIZE];
-    char mode[TAR_MODE_SIZE];
-    char uid[TAR_UID_SIZE];
-    char gid[TAR_GID_SIZE];
-    char size[TAR_SIZE_SIZE];
-    char mtime[TAR_MTIME_SIZE];
-    char chksum[TAR_CHKSUM_SIZE];
-    char typeflag;
-    char linkname[TAR_LINKNAME_SIZE];
-    char magic[TAR_MAGIC_SIZE];
-    char version[TAR_VERSION_SIZE];
-    char uname[TAR_UNAME_SIZE];
-    char gname[TAR_GNAME_SIZE];
-    char devmajor[TAR_DEVMAJOR_SIZE];
-    char devminor[TAR_DEVMINOR_SIZE];
-    char prefix[TAR_PREFIX_SIZE];
-    char padding[12];
-};
-
-// TAR type flags
-#define TAR_REGTYPE   '0'
-#define TAR_AREGTYPE  '\0'
-#define TAR_LNKTYPE   '1'
-#define TAR_SYMTYPE   '2'
-#define TAR_CHRTYPE   '3'
-#define TAR_BLKTYPE   '4'
-#define TAR_DIRTYPE   '5'
-#define TAR_FIFOTYPE  '6'
-#define TAR_CONTTYPE  '7'
-#define TAR_XHDTYPE   'x'  // pax extended header
-#define TAR_XGLTYPE   'g'  // pax global header
-
-
-#define TAR_GNUTYPE_SPARSE 'S'  // GNU old sparse file
-#define TAR_GNUTYPE_LONGNAME 'L'
-#define TAR_GNUTYPE_LONGLINK 'K'
-// Format types (must match arc_reader.c)
-#define ARC_FORMAT_TAR 0
-#define ARC_FORMAT_ZIP 1
-
 // TAR reader structure
 // Note: ArcReader is actually a TarReader (they're the same)
 typedef struct PaxState {
@@ -710,6 +651,21 @@ static int tar_read_entry(struct TarReader *reader) {
 }
 
 // ArcReader vtable for TAR
+// Move past the current entry's data and padding.
+// A data stream from arc_open_data() may have consumed part of it already,
+// so skip relative to where the data started rather than the current position.
+static int tar_skip_entry_data(TarReader *tar) {
+    uint64_t size = (uint64_t)tar->entry_data_remaining;
+    uint64_t padded = size + (TAR_BLOCK_SIZE - (size % TAR_BLOCK_SIZE)) % TAR_BLOCK_SIZE;
+    int64_t pos = arc_stream_tell(tar->base.stream);
+    if (tar->entry_data_offset >= 0 && pos >= tar->entry_data_offset &&
+        (uint64_t)(pos - tar->entry_data_offset) <= padded) {
+        return tar_skip_bytes(tar->base.stream, padded - (uint64_t)(pos - tar->entry_data_offset));
+    }
+    if (tar_skip_bytes(tar->base.stream, size) < 0) return -1;
+    return tar_skip_padding(tar->base.stream, size);
+}
+
 int arc_tar_next(ArcReader *reader, ArcEntry *entry) {
     if (!reader || !entry) {
         return -1;
@@ -718,9 +674,7 @@ int arc_tar_next(ArcReader *reader, ArcEntry *entry) {
     
     // If we have a valid entry with data remaining, skip it before reading next.
     if (tar->entry_valid && tar->entry_data_remaining > 0) {
-        uint64_t prev = (uint64_t)tar->entry_data_remaining;
-        if (tar_skip_bytes(tar->base.stream, prev) < 0) return -1;
-        if (tar_skip_padding(tar->base.stream, prev) < 0) return -1;
+        if (tar_skip_entry_data(tar) < 0) return -1;
         tar->entry_data_remaining = 0;
         tar->entry_valid = false;
     }
@@ -753,6 +707,24 @@ ArcStream *arc_tar_open_data(ArcReader *reader) {
     return arc_stream_substream(tar->base.stream, tar->entry_data_offset, tar->entry_data_remaining);
 }
 
+int arc_tar_entry_location(ArcReader *reader, ArcEntryLocation *loc) {
+    if (!reader || !loc) {
+        return -1;
+    }
+    TarReader *tar = (TarReader *)reader;
+    if (!tar->entry_valid || tar->entry_data_offset < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    memset(loc, 0, sizeof(*loc));
+    loc->format = ARC_FORMAT_TAR;
+    loc->compression = -1;
+    loc->offset = tar->entry_data_offset;
+    loc->stored_size = (uint64_t)tar->entry_data_remaining;
+    loc->size = (uint64_t)tar->entry_data_remaining;
+    return 0;
+}
+
 int arc_tar_skip_data(ArcReader *reader) {
     if (!reader) {
         return -1;
@@ -762,9 +734,7 @@ int arc_tar_skip_data(ArcReader *reader) {
         return -1;
     }
     
-    uint64_t prev = (uint64_t)tar->entry_data_remaining;
-    if (tar_skip_bytes(tar->base.stream, prev) < 0) return -1;
-    if (tar_skip_padding(tar->base.stream, prev) < 0) return -1;
+    if (tar_skip_entry_data(tar) < 0) return -1;
     
     tar->entry_data_remaining = 0;
     tar->entry_valid = false; // Mark as invalid after skipping
@@ -790,6 +760,28 @@ void arc_tar_close(ArcReader *reader) {
     free(tar);
 }
 
+int arc_tar_rewind(ArcReader *reader) {
+    if (!reader) {
+        return -1;
+    }
+    TarReader *tar = (TarReader *)reader;
+    // Filter streams (.tar.gz etc.) can't seek back; the caller reopens instead
+    if (arc_stream_seek(tar->base.stream, 0, SEEK_SET) < 0) {
+        return -1;
+    }
+    arc_entry_free(&tar->current_entry);
+    tar->entry_valid = false;
+    tar->entry_data_offset = 0;
+    tar->entry_data_remaining = 0;
+    tar->eof = false;
+    pax_clear(&tar->pax_global);
+    free(tar->gnu_longname);
+    free(tar->gnu_longlink);
+    tar->gnu_longname = NULL;
+    tar->gnu_longlink = NULL;
+    return 0;
+}
+
 // Note: Functions are now exported, no vtable needed
 
 ArcReader *arc_tar_open(ArcStream *stream) {
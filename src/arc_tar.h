@@ -3,6 +3,7 @@
 
 #include "arc_reader.h"
 #include "arc_stream.h"
+#include "arc_base.h"
 
 /**
  * TAR format implementation.
@@ -27,5 +28,18 @@ ArcStream *arc_tar_open_data(ArcReader *reader);
 int arc_tar_skip_data(ArcReader *reader);
 void arc_tar_close(ArcReader *reader);
 
+/**
+ * Describe where the current entry's data lives (offset in the TAR stream,
+ * which is the decompressed stream for .tar.gz and friends).
+ */
+int arc_tar_entry_location(ArcReader *reader, ArcEntryLocation *loc);
+
+/**
+ * Restart iteration from the first header.
+ *
+ * @return 0 on success, -1 if the stream cannot seek back (compressed TAR)
+ */
+int arc_tar_rewind(ArcReader *reader);
+
 #endif // ARC_TAR_H
 
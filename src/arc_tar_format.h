@@ -0,0 +1,69 @@
+#ifndef ARC_TAR_FORMAT_H
+#define ARC_TAR_FORMAT_H
+
+/**
+ * On-disk TAR header layout, shared by the reader (arc_tar.c) and the
+ * writer (arc_tar_writer.c). Internal.
+ */
+
+#define TAR_BLOCK_SIZE 512
+#define TAR_NAME_SIZE 100
+#define TAR_MODE_SIZE 8
+#define TAR_UID_SIZE 8
+#define TAR_GID_SIZE 8
+#define TAR_SIZE_SIZE 12
+#define TAR_MTIME_SIZE 12
+#define TAR_CHKSUM_SIZE 8
+#define TAR_TYPE_SIZE 1
+#define TAR_LINKNAME_SIZE 100
+#define TAR_MAGIC_SIZE 6
+#define TAR_VERSION_SIZE 2
+#define TAR_UNAME_SIZE 32
+#define TAR_GNAME_SIZE 32
+#define TAR_DEVMAJOR_SIZE 8
+#define TAR_DEVMINOR_SIZE 8
+#define TAR_PREFIX_SIZE 155
+
+// TAR header structure (ustar)
+struct TarHeader {
+    char name[TAR_NAME_SIZE];
+    char mode[TAR_MODE_SIZE];
+    char uid[TAR_UID_SIZE];
+    char gid[TAR_GID_SIZE];
+    char size[TAR_SIZE_SIZE];
+    char mtime[TAR_MTIME_SIZE];
+    char chksum[TAR_CHKSUM_SIZE];
+    char typeflag;
+    char linkname[TAR_LINKNAME_SIZE];
+    char magic[TAR_MAGIC_SIZE];
+    char version[TAR_VERSION_SIZE];
+    char uname[TAR_UNAME_SIZE];
+    char gname[TAR_GNAME_SIZE];
+    char devmajor[TAR_DEVMAJOR_SIZE];
+    char devminor[TAR_DEVMINOR_SIZE];
+    char prefix[TAR_PREFIX_SIZE];
+    char padding[12];
+};
+
+// TAR type flags
+#define TAR_REGTYPE   '0'
+#define TAR_AREGTYPE  '\0'
+#define TAR_LNKTYPE   '1'
+#define TAR_SYMTYPE   '2'
+#define TAR_CHRTYPE   '3'
+#define TAR_BLKTYPE   '4'
+#define TAR_DIRTYPE   '5'
+#define TAR_FIFOTYPE  '6'
+#define TAR_CONTTYPE  '7'
+#define TAR_XHDTYPE   'x'  // pax extended header
+#define TAR_XGLTYPE   'g'  // pax global header
+
+// GNU extensions
+#define TAR_GNUTYPE_SPARSE 'S'  // GNU old sparse file
+#define TAR_GNUTYPE_LONGNAME 'L'
+#define TAR_GNUTYPE_LONGLINK 'K'
+
+#define TAR_MAGIC   "ustar"  // ustar/pax magic, NUL terminated, version "00"
+#define TAR_VERSION "00"
+
+#endif // ARC_TAR_FORMAT_H
@@ -0,0 +1,768 @@
+#ifdef __linux__
+#define _GNU_SOURCE  // copy_file_range(), SEEK_DATA/SEEK_HOLE
+#else
+#define _POSIX_C_SOURCE 200809L
+#endif
+#include "arc_tar_writer.h"
+#include "arc_tar_format.h"
+#include "arc_stream.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+#define COPY_BUFFER_SIZE (64 * 1024)
+#define SYMLINK_MAX 4096
+
+// Unix file type bits as passed in ArcTarEntryInfo.mode
+#define UNIX_IFMT  0170000
+#define UNIX_IFDIR 0040000
+#define UNIX_IFREG 0100000
+#define UNIX_IFLNK 0120000
+
+struct ArcTarWriter {
+    ArcOutStream *out;
+    bool owns_out;         // Created by arc_tar_writer_new()
+    bool sparse;
+    bool zero_copy;
+    bool copy_file_range_ok;  // Cleared once the kernel refuses it for this output
+    int error;             // Sticky errno after an output failure
+    uint8_t *buf;          // Copy buffer, allocated on first use
+};
+
+/**
+ * Extended header records ("<len> <key>=<value>\n").
+ */
+typedef struct PaxRecords {
+    char *data;
+    size_t len;
+    size_t capacity;
+} PaxRecords;
+
+/**
+ * A data region of a sparse file.
+ */
+typedef struct SparseRegion {
+    uint64_t offset;
+    uint64_t length;
+} SparseRegion;
+
+static int fail(ArcTarWriter *w, int error) {
+    if (!w->error) {
+        w->error = error ? error : EIO;
+    }
+    errno = w->error;
+    return -1;
+}
+
+static int emit(ArcTarWriter *w, const void *buf, size_t len) {
+    if (arc_out_stream_write(w->out, buf, len) < 0) {
+        return fail(w, errno);
+    }
+    return 0;
+}
+
+static int emit_padding(ArcTarWriter *w, uint64_t size) {
+    static const uint8_t zeros[TAR_BLOCK_SIZE];
+    size_t rem = (size_t)(size % TAR_BLOCK_SIZE);
+    return rem ? emit(w, zeros, TAR_BLOCK_SIZE - rem) : 0;
+}
+
+static bool fits_octal(uint64_t value, size_t field_len) {
+    // field_len - 1 digits and a NUL
+    size_t digits = field_len - 1;
+    return digits * 3 >= 64 || value < (1ULL << (digits * 3));
+}
+
+static void put_octal(char *field, size_t field_len, uint64_t value) {
+    snprintf(field, field_len, "%0*llo", (int)(field_len - 1), (unsigned long long)value);
+}
+
+// GNU base-256: high bit of the first byte set, big-endian value in the rest
+static void put_base256(char *field, size_t field_len, uint64_t value) {
+    memset(field, 0, field_len);
+    for (size_t i = field_len; i-- > 1 && value;) {
+        field[i] = (char)(value & 0xFF);
+        value >>= 8;
+    }
+    field[0] = (char)0x80;
+}
+
+static int pax_add(PaxRecords *pax, const char *key, const char *value) {
+    size_t body = strlen(key) + strlen(value) + 3;  // ' ', '=', '\n'
+    // The length prefix counts its own digits
+    size_t len = body + 1;
+    for (size_t digits = 1;; digits++) {
+        len = body + digits;
+        size_t actual = (size_t)snprintf(NULL, 0, "%zu", len);
+        if (actual == digits) {
+            break;
+        }
+    }
+    if (pax->len + len + 1 > pax->capacity) {
+        size_t capacity = pax->capacity ? pax->capacity * 2 : 512;
+        while (capacity < pax->len + len + 1) {
+            capacity *= 2;
+        }
+        char *grown = realloc(pax->data, capacity);
+        if (!grown) {
+            return -1;
+        }
+        pax->data = grown;
+        pax->capacity = capacity;
+    }
+    snprintf(pax->data + pax->len, len + 1, "%zu %s=%s\n", len, key, value);
+    pax->len += len;
+    return 0;
+}
+
+static int pax_add_number(PaxRecords *pax, const char *key, uint64_t value) {
+    char text[24];
+    snprintf(text, sizeof(text), "%llu", (unsigned long long)value);
+    return pax_add(pax, key, text);
+}
+
+// Split a path over the ustar prefix and name fields, if it fits at all
+static bool split_name(const char *path, struct TarHeader *hdr) {
+    size_t len = strlen(path);
+    if (len <= TAR_NAME_SIZE) {
+        memcpy(hdr->name, path, len);
+        return true;
+    }
+    for (size_t i = len; i-- > 0;) {
+        if (path[i] != '/') {
+            continue;
+        }
+        if (len - i - 1 > TAR_NAME_SIZE) {
+            return false;
+        }
+        if (i <= TAR_PREFIX_SIZE && i > 0 && len - i - 1 > 0) {
+            memcpy(hdr->prefix, path, i);
+            memcpy(hdr->name, path + i + 1, len - i - 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void finish_checksum(struct TarHeader *hdr) {
+    memset(hdr->chksum, ' ', TAR_CHKSUM_SIZE);
+    unsigned sum = 0;
+    const unsigned char *p = (const unsigned char *)hdr;
+    for (size_t i = 0; i < sizeof(*hdr); i++) {
+        sum += p[i];
+    }
+    snprintf(hdr->chksum, TAR_CHKSUM_SIZE, "%06o", sum);  // "NNNNNN\0 "
+    hdr->chksum[7] = ' ';
+}
+
+static void fill_header(struct TarHeader *hdr, char typeflag, uint32_t mode, uint32_t uid, uint32_t gid,
+                        uint64_t size, uint64_t mtime) {
+    put_octal(hdr->mode, TAR_MODE_SIZE, mode & 07777);
+    if (fits_octal(uid, TAR_UID_SIZE)) {
+        put_octal(hdr->uid, TAR_UID_SIZE, uid);
+    } else {
+        put_base256(hdr->uid, TAR_UID_SIZE, uid);
+    }
+    if (fits_octal(gid, TAR_GID_SIZE)) {
+        put_octal(hdr->gid, TAR_GID_SIZE, gid);
+    } else {
+        put_base256(hdr->gid, TAR_GID_SIZE, gid);
+    }
+    if (fits_octal(size, TAR_SIZE_SIZE)) {
+        put_octal(hdr->size, TAR_SIZE_SIZE, size);
+    } else {
+        put_base256(hdr->size, TAR_SIZE_SIZE, size);
+    }
+    if (fits_octal(mtime, TAR_MTIME_SIZE)) {
+        put_octal(hdr->mtime, TAR_MTIME_SIZE, mtime);
+    } else {
+        put_base256(hdr->mtime, TAR_MTIME_SIZE, mtime);
+    }
+    hdr->typeflag = typeflag;
+    memcpy(hdr->magic, TAR_MAGIC, sizeof(TAR_MAGIC));
+    memcpy(hdr->version, TAR_VERSION, TAR_VERSION_SIZE);
+}
+
+/**
+ * Write an entry's header(s): a pax extended header first if the records
+ * are non-empty or a field does not fit into ustar.
+ *
+ * @param pax Records collected so far (may gain more here; freed by caller)
+ * @param placeholder_only Never add a "path" record (sparse entries name
+ *        the real file in GNU.sparse.name)
+ */
+static int write_headers(ArcTarWriter *w, const char *name, char typeflag, uint32_t mode,
+                         uint32_t uid, uint32_t gid, uint64_t size, uint64_t mtime,
+                         const char *link_target, PaxRecords *pax, bool placeholder_only) {
+    struct TarHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    bool ok = true;
+    if (!split_name(name, &hdr)) {
+        // Keep what fits so tools without pax support show something sensible
+        memcpy(hdr.name, name, TAR_NAME_SIZE);
+        if (!placeholder_only) {
+            ok = ok && pax_add(pax, "path", name) == 0;
+        }
+    }
+    if (link_target) {
+        size_t len = strlen(link_target);
+        memcpy(hdr.linkname, link_target, len < TAR_LINKNAME_SIZE ? len : TAR_LINKNAME_SIZE);
+        if (len > TAR_LINKNAME_SIZE) {
+            ok = ok && pax_add(pax, "linkpath", link_target) == 0;
+        }
+    }
+    if (!fits_octal(size, TAR_SIZE_SIZE)) {
+        ok = ok && pax_add_number(pax, "size", size) == 0;
+    }
+    if (!fits_octal(mtime, TAR_MTIME_SIZE)) {
+        ok = ok && pax_add_number(pax, "mtime", mtime) == 0;
+    }
+    if (!fits_octal(uid, TAR_UID_SIZE)) {
+        ok = ok && pax_add_number(pax, "uid", uid) == 0;
+    }
+    if (!fits_octal(gid, TAR_GID_SIZE)) {
+        ok = ok && pax_add_number(pax, "gid", gid) == 0;
+    }
+    if (!ok) {
+        return fail(w, ENOMEM);
+    }
+
+    if (pax->len > 0) {
+        struct TarHeader xhdr;
+        memset(&xhdr, 0, sizeof(xhdr));
+        const char *base = strrchr(name, '/');
+        base = base && base[1] ? base + 1 : name;
+        snprintf(xhdr.name, TAR_NAME_SIZE, "PaxHeaders/%.88s", base);
+        fill_header(&xhdr, TAR_XHDTYPE, 0644, 0, 0, pax->len, mtime);
+        finish_checksum(&xhdr);
+        if (emit(w, &xhdr, sizeof(xhdr)) < 0 || emit(w, pax->data, pax->len) < 0 ||
+            emit_padding(w, pax->len) < 0) {
+            return -1;
+        }
+    }
+
+    fill_header(&hdr, typeflag, mode, uid, gid, size, mtime);
+    finish_checksum(&hdr);
+    return emit(w, &hdr, sizeof(hdr));
+}
+
+static int ensure_buffer(ArcTarWriter *w) {
+    if (!w->buf) {
+        w->buf = malloc(COPY_BUFFER_SIZE);
+        if (!w->buf) {
+            return fail(w, ENOMEM);
+        }
+    }
+    return 0;
+}
+
+/**
+ * Copy len bytes at offset of in_fd into the archive, without a user-space
+ * copy when the output is a descriptor.
+ *
+ * @return Bytes copied (short if the input ends early), -1 on output error
+ */
+static int64_t copy_range(ArcTarWriter *w, int in_fd, uint64_t offset, uint64_t len) {
+    uint64_t done = 0;
+#ifdef __linux__
+    int out_fd = w->zero_copy ? arc_out_stream_fd(w->out) : -1;
+    while (out_fd >= 0 && done < len) {
+        off_t off = (off_t)(offset + done);
+        size_t want = len - done > (1u << 30) ? (1u << 30) : (size_t)(len - done);
+        ssize_t n;
+        if (w->copy_file_range_ok) {
+            n = copy_file_range(in_fd, &off, out_fd, NULL, want, 0);
+            if (n < 0 && (errno == EXDEV || errno == EINVAL || errno == ENOSYS ||
+                          errno == EOPNOTSUPP || errno == EBADF)) {
+                // Not a regular file pair on a supporting kernel: pipes, sockets, O_APPEND
+                w->copy_file_range_ok = false;
+                continue;
+            }
+        } else {
+            n = sendfile(out_fd, in_fd, &off, want);
+            if (n < 0 && (errno == EINVAL || errno == ENOSYS)) {
+                break;  // Fall back to the buffer
+            }
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return fail(w, errno);
+        }
+        if (n == 0) {
+            break;  // End of input, or a file system that reports none: let pread() decide
+        }
+        done += (uint64_t)n;
+        w->out->bytes_written += n;
+    }
+#endif
+    if (done < len && ensure_buffer(w) < 0) {
+        return -1;
+    }
+    while (done < len) {
+        size_t want = len - done > COPY_BUFFER_SIZE ? COPY_BUFFER_SIZE : (size_t)(len - done);
+        ssize_t n = pread(in_fd, w->buf, want, (off_t)(offset + done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        if (emit(w, w->buf, (size_t)n) < 0) {
+            return -1;
+        }
+        done += (uint64_t)n;
+    }
+    return (int64_t)done;
+}
+
+/**
+ * Pad out an entry whose input ended early, keeping the archive in step
+ * with the size in its header.
+ */
+static int pad_short_entry(ArcTarWriter *w, uint64_t missing) {
+    if (ensure_buffer(w) < 0) {
+        return -1;
+    }
+    memset(w->buf, 0, COPY_BUFFER_SIZE);
+    while (missing > 0) {
+        size_t n = missing > COPY_BUFFER_SIZE ? COPY_BUFFER_SIZE : (size_t)missing;
+        if (emit(w, w->buf, n) < 0) {
+            return -1;
+        }
+        missing -= n;
+    }
+    errno = EIO;
+    return -1;
+}
+
+/**
+ * Find the data regions of a file with SEEK_DATA/SEEK_HOLE.
+ *
+ * @return Number of regions (a file ending in a hole gets a final empty
+ *         region at its size, as GNU tar writes it), or -1 if holes can't
+ *         be detected here
+ */
+static ssize_t find_regions(int fd, uint64_t size, SparseRegion **out) {
+    *out = NULL;
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+    SparseRegion *regions = NULL;
+    size_t count = 0, capacity = 0;
+    uint64_t pos = 0;
+    while (pos < size) {
+        off_t data = lseek(fd, (off_t)pos, SEEK_DATA);
+        if (data < 0) {
+            if (errno == ENXIO) {
+                break;  // Only a hole remains
+            }
+            free(regions);
+            return -1;
+        }
+        off_t hole = lseek(fd, data, SEEK_HOLE);
+        if (hole < 0) {
+            free(regions);
+            return -1;
+        }
+        if ((uint64_t)hole > size) {
+            hole = (off_t)size;
+        }
+        if ((uint64_t)data >= size) {
+            break;
+        }
+        if (count + 1 >= capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            SparseRegion *grown = realloc(regions, capacity * sizeof(SparseRegion));
+            if (!grown) {
+                free(regions);
+                errno = ENOMEM;
+                return -1;
+            }
+            regions = grown;
+        }
+        regions[count++] = (SparseRegion){ (uint64_t)data, (uint64_t)(hole - data) };
+        pos = (uint64_t)hole;
+    }
+    if (count == 0 || regions[count - 1].offset + regions[count - 1].length < size) {
+        if (count + 1 > capacity) {
+            SparseRegion *grown = realloc(regions, (count + 1) * sizeof(SparseRegion));
+            if (!grown) {
+                free(regions);
+                errno = ENOMEM;
+                return -1;
+            }
+            regions = grown;
+        }
+        regions[count++] = (SparseRegion){ size, 0 };
+    }
+    *out = regions;
+    return (ssize_t)count;
+#else
+    (void)fd;
+    (void)size;
+    errno = ENOTSUP;
+    return -1;
+#endif
+}
+
+/**
+ * Write a sparse file in GNU pax sparse format 1.0: a placeholder ustar
+ * name, the real name and size in pax records, and a data section that
+ * starts with the region map in decimal text.
+ */
+static int write_sparse(ArcTarWriter *w, const char *name, const struct stat *st, int fd,
+                        const SparseRegion *regions, size_t count) {
+    char line[48];
+    PaxRecords map = { NULL, 0, 0 };
+    bool ok = true;
+    int n = snprintf(line, sizeof(line), "%zu\n", count);
+    uint64_t data_size = 0;
+    // Reuse the record buffer as a plain text buffer: only its growth logic matters
+    for (size_t i = 0; i <= count && ok; i++) {
+        if (i > 0) {
+            n = snprintf(line, sizeof(line), "%llu\n%llu\n", (unsigned long long)regions[i - 1].offset,
+                         (unsigned long long)regions[i - 1].length);
+            data_size += regions[i - 1].length;
+        }
+        if (map.len + (size_t)n + 1 > map.capacity) {
+            size_t capacity = map.capacity ? map.capacity * 2 : TAR_BLOCK_SIZE;
+            char *grown = realloc(map.data, capacity);
+            ok = grown != NULL;
+            if (ok) {
+                map.data = grown;
+                map.capacity = capacity;
+            }
+        }
+        if (ok) {
+            memcpy(map.data + map.len, line, (size_t)n);
+            map.len += (size_t)n;
+        }
+    }
+
+    PaxRecords pax = { NULL, 0, 0 };
+    ok = ok && pax_add(&pax, "GNU.sparse.major", "1") == 0 && pax_add(&pax, "GNU.sparse.minor", "0") == 0 &&
+         pax_add(&pax, "GNU.sparse.name", name) == 0 &&
+         pax_add_number(&pax, "GNU.sparse.realsize", (uint64_t)st->st_size) == 0;
+    if (!ok) {
+        free(map.data);
+        free(pax.data);
+        return fail(w, ENOMEM);
+    }
+
+    // Placeholder name, as GNU tar writes it: dir/GNUSparseFile.0/base
+    const char *slash = strrchr(name, '/');
+    size_t dir_len = slash ? (size_t)(slash - name) + 1 : 0;
+    size_t placeholder_len = strlen(name) + 32;
+    char *placeholder = malloc(placeholder_len);
+    if (!placeholder) {
+        free(map.data);
+        free(pax.data);
+        return fail(w, ENOMEM);
+    }
+    snprintf(placeholder, placeholder_len, "%.*sGNUSparseFile.0/%s", (int)dir_len, name, name + dir_len);
+
+    uint64_t map_size = (map.len + TAR_BLOCK_SIZE - 1) / TAR_BLOCK_SIZE * TAR_BLOCK_SIZE;
+    uint64_t stored = map_size + data_size;
+    int rc = write_headers(w, placeholder, TAR_REGTYPE, (uint32_t)st->st_mode, (uint32_t)st->st_uid,
+                           (uint32_t)st->st_gid, stored, (uint64_t)st->st_mtime, NULL, &pax, true);
+    free(placeholder);
+    free(pax.data);
+    if (rc == 0) {
+        rc = emit(w, map.data, map.len);
+    }
+    if (rc == 0) {
+        rc = emit_padding(w, map.len);
+    }
+    free(map.data);
+    if (rc < 0) {
+        return -1;
+    }
+
+    uint64_t missing = 0;
+    for (size_t i = 0; i < count; i++) {
+        int64_t copied = copy_range(w, fd, regions[i].offset, regions[i].length);
+        if (copied < 0) {
+            return -1;
+        }
+        missing += regions[i].length - (uint64_t)copied;
+    }
+    if (missing > 0 && pad_short_entry(w, missing) < 0 && w->error) {
+        return -1;
+    }
+    if (emit_padding(w, stored) < 0) {
+        return -1;
+    }
+    if (missing > 0) {
+        errno = EIO;
+        return -1;
+    }
+    return 0;
+}
+
+static int write_regular(ArcTarWriter *w, const char *name, const struct stat *st, int fd) {
+    uint64_t size = (uint64_t)st->st_size;
+    if (w->sparse && size > 0 && (uint64_t)st->st_blocks * 512 < size) {
+        SparseRegion *regions = NULL;
+        ssize_t count = find_regions(fd, size, &regions);
+        if (count > 0) {
+            uint64_t data_size = 0;
+            for (ssize_t i = 0; i < count; i++) {
+                data_size += regions[i].length;
+            }
+            if (data_size < size) {
+                int rc = write_sparse(w, name, st, fd, regions, (size_t)count);
+                free(regions);
+                return rc;
+            }
+        }
+        free(regions);
+    }
+
+    PaxRecords pax = { NULL, 0, 0 };
+    int rc = write_headers(w, name, TAR_REGTYPE, (uint32_t)st->st_mode, (uint32_t)st->st_uid,
+                           (uint32_t)st->st_gid, size, (uint64_t)st->st_mtime, NULL, &pax, false);
+    free(pax.data);
+    if (rc < 0) {
+        return -1;
+    }
+    int64_t copied = copy_range(w, fd, 0, size);
+    if (copied < 0) {
+        return -1;
+    }
+    bool shrunk = (uint64_t)copied < size;
+    if (shrunk && pad_short_entry(w, size - (uint64_t)copied) < 0 && w->error) {
+        return -1;
+    }
+    if (emit_padding(w, size) < 0) {
+        return -1;
+    }
+    if (shrunk) {
+        errno = EIO;
+        return -1;
+    }
+    return 0;
+}
+
+// Entry name with a trailing '/' for directories
+static char *entry_name(const char *name, bool is_dir) {
+    size_t len = strlen(name);
+    bool add_slash = is_dir && (len == 0 || name[len - 1] != '/');
+    char *copy = malloc(len + 2);
+    if (!copy) {
+        return NULL;
+    }
+    memcpy(copy, name, len);
+    if (add_slash) {
+        copy[len++] = '/';
+    }
+    copy[len] = '\0';
+    return copy;
+}
+
+ArcTarWriter *arc_tar_writer_new(int fd) {
+    return arc_tar_writer_new_ex(fd, NULL);
+}
+
+ArcTarWriter *arc_tar_writer_new_ex(int fd, const ArcTarWriterOptions *opts) {
+    ArcOutStream *out = arc_out_stream_from_fd(fd);
+    if (!out) {
+        return NULL;
+    }
+    ArcTarWriter *w = arc_tar_writer_new_stream(out, opts);
+    if (!w) {
+        arc_out_stream_close(out);
+        return NULL;
+    }
+    w->owns_out = true;
+    return w;
+}
+
+ArcTarWriter *arc_tar_writer_new_stream(ArcOutStream *out, const ArcTarWriterOptions *opts) {
+    if (!out) {
+        errno = EINVAL;
+        return NULL;
+    }
+    ArcTarWriter *w = calloc(1, sizeof(ArcTarWriter));
+    if (!w) {
+        return NULL;
+    }
+    w->out = out;
+    w->sparse = !(opts && opts->no_sparse);
+    w->zero_copy = !(opts && opts->no_zero_copy);
+    w->copy_file_range_ok = true;
+    return w;
+}
+
+int arc_tar_writer_add_stream(ArcTarWriter *w, const char *name, ArcStream *data,
+                              const ArcTarEntryInfo *info) {
+    if (!w || !name || !info) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (w->error) {
+        errno = w->error;
+        return -1;
+    }
+    // A hard link is stored like a regular file without data
+    uint32_t type = info->hard_link ? UNIX_IFREG : info->mode & UNIX_IFMT;
+    if (type == 0) {
+        type = UNIX_IFREG;
+    }
+    if ((type != UNIX_IFREG && type != UNIX_IFDIR && type != UNIX_IFLNK) ||
+        ((type == UNIX_IFLNK || info->hard_link) && (!info->link_target || !*info->link_target))) {
+        errno = EINVAL;
+        return -1;
+    }
+    uint32_t mode = info->mode & 07777;
+    if (mode == 0) {
+        mode = type == UNIX_IFREG ? 0644 : 0755;
+    }
+    uint64_t mtime = info->mtime;
+    uint64_t size = type == UNIX_IFREG && !info->hard_link ? info->size : 0;
+    char typeflag = type == UNIX_IFDIR ? TAR_DIRTYPE : (type == UNIX_IFLNK ? TAR_SYMTYPE : TAR_REGTYPE);
+    if (info->hard_link) {
+        typeflag = TAR_LNKTYPE;
+    }
+
+    char *path = entry_name(name, type == UNIX_IFDIR);
+    if (!path) {
+        return fail(w, ENOMEM);
+    }
+    PaxRecords pax = { NULL, 0, 0 };
+    int rc = write_headers(w, path, typeflag, mode, info->uid, info->gid, size, mtime,
+                           type == UNIX_IFLNK || info->hard_link ? info->link_target : NULL, &pax,
+                           false);
+    free(pax.data);
+    free(path);
+    if (rc < 0 || size == 0) {
+        return rc;
+    }
+
+    if (ensure_buffer(w) < 0) {
+        return -1;
+    }
+    uint64_t done = 0;
+    while (data && done < size) {
+        size_t want = size - done > COPY_BUFFER_SIZE ? COPY_BUFFER_SIZE : (size_t)(size - done);
+        ssize_t n = arc_stream_read(data, w->buf, want);
+        if (n <= 0) {
+            break;
+        }
+        if (emit(w, w->buf, (size_t)n) < 0) {
+            return -1;
+        }
+        done += (uint64_t)n;
+    }
+    if (done < size && pad_short_entry(w, size - done) < 0 && w->error) {
+        return -1;
+    }
+    if (emit_padding(w, size) < 0) {
+        return -1;
+    }
+    if (done < size) {
+        errno = EIO;
+        return -1;
+    }
+    return 0;
+}
+
+int arc_tar_writer_add_file(ArcTarWriter *w, const char *name, const char *path) {
+    if (!w || !path) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (w->error) {
+        errno = w->error;
+        return -1;
+    }
+    if (!name) {
+        name = path;
+        while (*name == '/' || (name[0] == '.' && name[1] == '/')) {
+            name += *name == '/' ? 1 : 2;
+        }
+    }
+
+    struct stat st;
+    if (lstat(path, &st) < 0) {
+        return -1;
+    }
+    ArcTarEntryInfo info;
+    memset(&info, 0, sizeof(info));
+    info.mode = (uint32_t)(st.st_mode & 07777);
+    info.mtime = st.st_mtime > 0 ? (uint64_t)st.st_mtime : 0;
+    info.uid = (uint32_t)st.st_uid;
+    info.gid = (uint32_t)st.st_gid;
+
+    if (S_ISDIR(st.st_mode)) {
+        info.mode |= UNIX_IFDIR;
+        return arc_tar_writer_add_stream(w, name, NULL, &info);
+    }
+    if (S_ISLNK(st.st_mode)) {
+        char target[SYMLINK_MAX];
+        ssize_t n = readlink(path, target, sizeof(target));
+        if (n < 0) {
+            return -1;
+        }
+        // A full buffer may be a truncated target
+        if ((size_t)n == sizeof(target)) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        target[n] = '\0';
+        info.mode |= UNIX_IFLNK;
+        info.link_target = target;
+        return arc_tar_writer_add_stream(w, name, NULL, &info);
+    }
+    if (!S_ISREG(st.st_mode)) {
+        errno = ENOTSUP;
+        return -1;
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    char *entry = entry_name(name, false);
+    int rc = entry ? write_regular(w, entry, &st, fd) : fail(w, ENOMEM);
+    int saved = errno;
+    free(entry);
+    close(fd);
+    errno = saved;
+    return rc;
+}
+
+int arc_tar_writer_finish(ArcTarWriter *w) {
+    if (!w) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!w->error) {
+        static const uint8_t end[2 * TAR_BLOCK_SIZE];
+        emit(w, end, sizeof(end));
+    }
+    int error = w->error;
+    arc_tar_writer_free(w);
+    if (error) {
+        errno = error;
+        return -1;
+    }
+    return 0;
+}
+
+void arc_tar_writer_free(ArcTarWriter *w) {
+    if (!w) {
+        return;
+    }
+    if (w->owns_out) {
+        arc_out_stream_close(w->out);
+    }
+    free(w->buf);
+    free(w);
+}
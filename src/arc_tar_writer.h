@@ -0,0 +1,109 @@
+#ifndef ARC_TAR_WRITER_H
+#define ARC_TAR_WRITER_H
+
+#include "arc_stream.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * TAR archive creation (pax format).
+ *
+ * Headers are ustar, with a pax extended header in front whenever a name,
+ * link target, size, mtime or id does not fit. When the output is a plain
+ * descriptor, file bodies go from the source file to the archive with
+ * copy_file_range() (file output) or sendfile() (pipes, sockets), so the
+ * data never passes through user space; otherwise they are copied through
+ * a buffer into the output stream (e.g. a compressing filter).
+ *
+ * Sparse files are found with SEEK_DATA/SEEK_HOLE and stored in GNU pax
+ * sparse format 1.0: only the data regions are written, preceded by a map
+ * of their offsets, and GNU tar and libarchive restore the holes.
+ */
+
+typedef struct ArcTarWriter ArcTarWriter;
+
+/**
+ * Writer options. A zeroed struct (or NULL) enables sparse detection and
+ * zero-copy transfers.
+ */
+typedef struct ArcTarWriterOptions {
+    bool no_sparse;     // Store holes as zeros instead of a sparse map
+    bool no_zero_copy;  // Always copy file data through a buffer
+} ArcTarWriterOptions;
+
+/**
+ * Metadata for arc_tar_writer_add_stream().
+ */
+typedef struct ArcTarEntryInfo {
+    uint32_t mode;            // Unix mode with type bits: S_IFREG, S_IFDIR or S_IFLNK (0 = regular file, 0644)
+    uint64_t mtime;           // Modification time, kept as given (0 is the epoch)
+    uint32_t uid;
+    uint32_t gid;
+    uint64_t size;            // Data size; TAR needs it before the data
+    const char *link_target;  // Symlink target (S_IFLNK), or the earlier entry a hard link names
+    bool hard_link;           // Hard link to link_target (LNKTYPE, no data); the mode's type bits are ignored
+} ArcTarEntryInfo;
+
+/**
+ * Create a writer on an open descriptor with default options. The
+ * descriptor is not closed by the writer.
+ *
+ * @return New writer, or NULL on error
+ */
+ArcTarWriter *arc_tar_writer_new(int fd);
+
+/**
+ * Create a writer on a descriptor with options (NULL = defaults).
+ */
+ArcTarWriter *arc_tar_writer_new_ex(int fd, const ArcTarWriterOptions *opts);
+
+/**
+ * Create a writer on an output stream (e.g. arc_filter_gzip_write()).
+ * Zero-copy transfers are used only if the stream is a plain descriptor.
+ * The stream is neither finished nor closed by the writer.
+ */
+ArcTarWriter *arc_tar_writer_new_stream(ArcOutStream *out, const ArcTarWriterOptions *opts);
+
+/**
+ * Add a file from the filesystem: a regular file, directory or symlink,
+ * with mode, owner and mtime from lstat().
+ *
+ * A file that shrinks while it is read is padded with zeros to the size
+ * in its header, so the archive stays readable, and the call fails with
+ * EIO.
+ *
+ * @param writer The writer
+ * @param name Entry name in the archive (NULL = path without leading '/' and "./")
+ * @param path File to add
+ * @return 0 on success, -1 on error (ENOTSUP for devices, FIFOs and sockets)
+ */
+int arc_tar_writer_add_file(ArcTarWriter *writer, const char *name, const char *path);
+
+/**
+ * Add an entry whose data (exactly info->size bytes) is read from a
+ * stream. A short stream is padded like a shrinking file (EIO). The
+ * stream is not closed.
+ *
+ * @param writer The writer
+ * @param name Entry name ('/' is appended for directories)
+ * @param data Entry data (ignored, may be NULL, for directories and links)
+ * @param info Entry metadata (required)
+ * @return 0 on success, -1 on error
+ */
+int arc_tar_writer_add_stream(ArcTarWriter *writer, const char *name, ArcStream *data,
+                              const ArcTarEntryInfo *info);
+
+/**
+ * Write the end-of-archive blocks and free the writer (also on failure).
+ *
+ * @return 0 on success, -1 if this or an earlier write failed
+ */
+int arc_tar_writer_finish(ArcTarWriter *writer);
+
+/**
+ * Free a writer without completing the archive.
+ */
+void arc_tar_writer_free(ArcTarWriter *writer);
+
+#endif // ARC_TAR_WRITER_H
@@ -0,0 +1,347 @@
+#define _POSIX_C_SOURCE 200809L
+#include "arc_test.h"
+#include "arc_base.h"
+#include "arc_stream.h"
+#include "arc_zip.h"
+#include "arc_7z.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#define TEST_BUFFER_SIZE (64 * 1024)
+#define TEST_MAX_THREADS 64
+
+/**
+ * Shared state for the ZIP worker pool. Entries are handed out by an atomic
+ * counter; each result slot is written by exactly one worker.
+ */
+typedef struct TestPool {
+    int fd;
+    int64_t file_size;
+    const ArcLimits *limits;
+    const ArcEntryLocation *locs;
+    ArcTestResult *results;
+    size_t count;
+    atomic_size_t next;
+} TestPool;
+
+/**
+ * Append a result slot for a regular file.
+ */
+static ArcTestResult *report_add(ArcTestReport *report, const ArcEntry *entry) {
+    if (report->count == report->capacity) {
+        size_t capacity = report->capacity ? report->capacity * 2 : 64;
+        ArcTestResult *results = realloc(report->results, capacity * sizeof(ArcTestResult));
+        if (!results) {
+            return NULL;
+        }
+        report->results = results;
+        report->capacity = capacity;
+    }
+    char *path = strdup(entry->path);
+    if (!path) {
+        return NULL;
+    }
+    ArcTestResult *r = &report->results[report->count++];
+    memset(r, 0, sizeof(*r));
+    r->path = path;
+    return r;
+}
+
+/**
+ * Decode a data stream to the end, CRC-ing it into the result.
+ */
+static void drain_data(ArcStream *data, uint8_t *buf, ArcTestResult *r) {
+    uLong crc = crc32(0L, Z_NULL, 0);
+    ssize_t n;
+    errno = 0;
+    while ((n = arc_stream_read(data, buf, TEST_BUFFER_SIZE)) > 0) {
+        crc = crc32(crc, buf, (uInt)n);
+        r->size += (uint64_t)n;
+    }
+    r->actual_crc = (uint32_t)crc;
+    if (n < 0) {
+        // zlib and liblzma errors don't set errno
+        r->status = ARC_TEST_DECODE;
+        r->error = errno ? errno : EIO;
+    }
+}
+
+/**
+ * Compare a cleanly decoded entry against its header.
+ */
+static void check_result(ArcTestResult *r, uint64_t expected_size, bool check_size) {
+    if (r->status != ARC_TEST_OK) {
+        return;
+    }
+    if (check_size && r->size != expected_size) {
+        r->status = ARC_TEST_BAD_SIZE;
+    } else if (r->has_crc && r->actual_crc != r->expected_crc) {
+        r->status = ARC_TEST_BAD_CRC;
+    }
+}
+
+static bool zip_supported(const ArcEntryLocation *loc, ArcTestResult *r) {
+    if ((loc->flags & ZIP_FLAG_ENCRYPTED) ||
+        (loc->method != ZIP_METHOD_STORE && loc->method != ZIP_METHOD_DEFLATE)) {
+        r->status = ARC_TEST_UNSUPPORTED;
+        r->error = ENOTSUP;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Test one ZIP entry through a positional stream over the archive file.
+ */
+static void test_zip_entry(ArcStream *file, const ArcEntryLocation *loc, const ArcLimits *limits,
+                           uint8_t *buf, ArcTestResult *r) {
+    if (!zip_supported(loc, r)) {
+        return;
+    }
+    if (loc->stored_size > 0) {
+        ArcStream *data = arc_zip_open_location(file, loc, limits);
+        if (!data) {
+            r->status = ARC_TEST_DECODE;
+            r->error = errno ? errno : EIO;
+            return;
+        }
+        drain_data(data, buf, r);
+        arc_stream_close(data);
+    }
+    check_result(r, loc->size, true);
+}
+
+static void *test_worker(void *arg) {
+    TestPool *pool = arg;
+    uint8_t *buf = malloc(TEST_BUFFER_SIZE);
+    ArcStream *file = arc_stream_pread(pool->fd, 0, pool->file_size);
+    for (;;) {
+        size_t i = atomic_fetch_add(&pool->next, 1);
+        if (i >= pool->count) {
+            break;
+        }
+        if (!buf || !file) {
+            pool->results[i].status = ARC_TEST_DECODE;
+            pool->results[i].error = ENOMEM;
+            continue;
+        }
+        test_zip_entry(file, &pool->locs[i], pool->limits, buf, &pool->results[i]);
+    }
+    arc_stream_close(file);
+    free(buf);
+    return NULL;
+}
+
+static unsigned worker_count(unsigned wanted, size_t entries) {
+    long threads = (long)wanted;
+    if (threads == 0) {
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (threads > TEST_MAX_THREADS) {
+        threads = TEST_MAX_THREADS;
+    }
+    if ((size_t)threads > entries) {
+        threads = (long)(entries ? entries : 1);
+    }
+    return (unsigned)threads;
+}
+
+/**
+ * List a file-backed ZIP, then decode its entries on a thread pool.
+ * The calling thread is one of the workers.
+ */
+static int test_zip_parallel(ArcReader *reader, int fd, unsigned threads_wanted, ArcTestReport *report) {
+    ArcReaderBase *base = (ArcReaderBase *)reader;
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        return -1;
+    }
+
+    ArcEntryLocation *locs = NULL;
+    size_t loc_capacity = 0;
+    ArcEntry entry;
+    int rc;
+    while ((rc = arc_next(reader, &entry)) == 0) {
+        if (entry.type != ARC_ENTRY_FILE) {
+            arc_entry_free(&entry);
+            continue;
+        }
+        if (report->count == loc_capacity) {
+            size_t capacity = loc_capacity ? loc_capacity * 2 : 64;
+            ArcEntryLocation *grown = realloc(locs, capacity * sizeof(ArcEntryLocation));
+            if (!grown) {
+                arc_entry_free(&entry);
+                free(locs);
+                return -1;
+            }
+            locs = grown;
+            loc_capacity = capacity;
+        }
+        ArcTestResult *r = report_add(report, &entry);
+        if (!r || arc_reader_entry_location(reader, &locs[report->count - 1]) < 0) {
+            arc_entry_free(&entry);
+            free(locs);
+            return -1;
+        }
+        ArcEntryLocation *loc = &locs[report->count - 1];
+        r->expected_crc = loc->crc32;
+        r->has_crc = loc->has_crc;
+        arc_entry_free(&entry);
+    }
+    if (rc < 0) {
+        report->archive_status = ARC_TEST_DECODE;
+        report->archive_error = errno ? errno : EIO;
+    }
+
+    TestPool pool;
+    memset(&pool, 0, sizeof(pool));
+    pool.fd = fd;
+    pool.file_size = (int64_t)st.st_size;
+    pool.limits = base->limits;
+    pool.locs = locs;
+    pool.results = report->results;
+    pool.count = report->count;
+    atomic_init(&pool.next, 0);
+
+    unsigned threads = worker_count(threads_wanted, report->count);
+    pthread_t tids[TEST_MAX_THREADS];
+    unsigned started = 0;
+    for (unsigned i = 1; i < threads; i++) {
+        // Fewer workers if a thread can't be created
+        if (pthread_create(&tids[started], NULL, test_worker, &pool) != 0) {
+            break;
+        }
+        started++;
+    }
+    test_worker(&pool);
+    for (unsigned i = 0; i < started; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    free(locs);
+    return 0;
+}
+
+/**
+ * Test entries in listing order on the calling thread.
+ */
+static int test_sequential(ArcReader *reader, ArcTestReport *report) {
+    ArcReaderBase *base = (ArcReaderBase *)reader;
+    int format = arc_reader_format(reader);
+    uint8_t *buf = malloc(TEST_BUFFER_SIZE);
+    if (!buf) {
+        return -1;
+    }
+
+    ArcEntry entry;
+    int rc;
+    while ((rc = arc_next(reader, &entry)) == 0) {
+        if (entry.type != ARC_ENTRY_FILE) {
+            arc_entry_free(&entry);
+            continue;
+        }
+        ArcTestResult *r = report_add(report, &entry);
+        if (!r) {
+            arc_entry_free(&entry);
+            free(buf);
+            return -1;
+        }
+
+        ArcEntryLocation loc;
+        bool supported = true;
+        if (arc_reader_entry_location(reader, &loc) == 0) {
+            r->expected_crc = loc.crc32;
+            r->has_crc = loc.has_crc;
+            if (loc.format == ARC_FORMAT_ZIP) {
+                supported = zip_supported(&loc, r);
+            }
+        } else if (format == ARC_FORMAT_7Z) {
+            r->has_crc = arc_7z_entry_crc(reader, &r->expected_crc) == 0;
+        }
+
+        if (supported) {
+            errno = 0;
+            ArcStream *data = arc_open_data(reader);
+            if (data) {
+                drain_data(data, buf, r);
+                arc_stream_close(data);
+            } else if (entry.size != 0) {
+                r->status = ARC_TEST_DECODE;
+                r->error = errno ? errno : EIO;
+            }
+            // A lone compressed file's size is a hint (gzip ISIZE is mod 2^32)
+            check_result(r, entry.size, format != ARC_FORMAT_COMPRESSED);
+        }
+        arc_entry_free(&entry);
+    }
+    free(buf);
+
+    if (rc < 0) {
+        report->archive_status = ARC_TEST_DECODE;
+        report->archive_error = errno ? errno : EIO;
+    } else if (format == ARC_FORMAT_TAR && base->owned_stream) {
+        // A compressed TAR's trailer (gzip CRC/ISIZE, xz index) follows the
+        // end-of-archive blocks: decode the rest of the stream to check it
+        uint8_t tail[4096];
+        ssize_t n;
+        errno = 0;
+        while ((n = arc_stream_read(base->stream, tail, sizeof(tail))) > 0) {
+        }
+        if (n < 0) {
+            report->archive_status = ARC_TEST_DECODE;
+            report->archive_error = errno ? errno : EIO;
+        }
+    }
+    return 0;
+}
+
+int64_t arc_test(ArcReader *reader, const ArcTestOptions *opts, ArcTestReport *report) {
+    if (!reader || !report) {
+        errno = EINVAL;
+        return -1;
+    }
+    memset(report, 0, sizeof(*report));
+
+    ArcReaderBase *base = (ArcReaderBase *)reader;
+    int fd = arc_stream_fd(base->stream);
+    unsigned threads = opts ? opts->threads : 0;
+    int rc;
+    if (arc_reader_format(reader) == ARC_FORMAT_ZIP && fd >= 0 && threads != 1) {
+        rc = test_zip_parallel(reader, fd, threads, report);
+    } else {
+        rc = test_sequential(reader, report);
+    }
+    if (rc < 0) {
+        int saved = errno;
+        arc_test_report_free(report);
+        errno = saved;
+        return -1;
+    }
+
+    for (size_t i = 0; i < report->count; i++) {
+        report->total_bytes += report->results[i].size;
+        if (report->results[i].status != ARC_TEST_OK) {
+            report->failed++;
+        }
+    }
+    return (int64_t)report->failed + (report->archive_status != ARC_TEST_OK ? 1 : 0);
+}
+
+void arc_test_report_free(ArcTestReport *report) {
+    if (!report) {
+        return;
+    }
+    for (size_t i = 0; i < report->count; i++) {
+        free(report->results[i].path);
+    }
+    free(report->results);
+    memset(report, 0, sizeof(*report));
+}
@@ -0,0 +1,81 @@
+#ifndef ARC_TEST_H
+#define ARC_TEST_H
+
+#include "arc_reader.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * Archive integrity testing.
+ *
+ * Every regular file is decoded to nowhere and checked against whatever
+ * the format stores: the ZIP CRC-32, the 7z folder/substream CRC, and the
+ * entry size from the header. Container checks come from the decoders
+ * themselves: zlib verifies the gzip trailer (CRC-32 and length) and
+ * liblzma the xz block checks, so a mismatch surfaces as a decode error,
+ * either on the entry being read or, for a .tar.gz/.tar.xz whose trailer
+ * follows the last entry, on the archive as a whole.
+ *
+ * ZIP entries are independent, so a file-backed ZIP is tested by a pool of
+ * threads, each decoding whole entries through its own positional stream
+ * over the shared descriptor. Other formats are one compressed stream and
+ * are tested in listing order on the calling thread.
+ */
+
+// ArcTestResult.status / ArcTestReport.archive_status
+#define ARC_TEST_OK          0
+#define ARC_TEST_BAD_CRC     1  // Decoded cleanly, but the CRC-32 doesn't match
+#define ARC_TEST_BAD_SIZE    2  // Decoded length differs from the header
+#define ARC_TEST_DECODE      3  // Decoder error (corrupt data, gzip trailer or xz check mismatch)
+#define ARC_TEST_UNSUPPORTED 4  // Can't be decoded (encrypted, unknown method)
+
+typedef struct ArcTestOptions {
+    unsigned threads;  // Worker threads for ZIP archives (0 = one per online CPU, 1 = calling thread only)
+} ArcTestOptions;
+
+/**
+ * Outcome for one regular file.
+ */
+typedef struct ArcTestResult {
+    char *path;
+    uint64_t size;          // Bytes decoded
+    int status;             // ARC_TEST_*
+    int error;              // errno for ARC_TEST_DECODE / ARC_TEST_UNSUPPORTED
+    uint32_t expected_crc;  // Stored CRC-32 (valid if has_crc)
+    uint32_t actual_crc;    // CRC-32 of the decoded data
+    bool has_crc;           // The archive stores a CRC for this entry
+} ArcTestResult;
+
+typedef struct ArcTestReport {
+    ArcTestResult *results;  // In listing order
+    size_t count;
+    size_t capacity;
+    size_t failed;           // Results with status != ARC_TEST_OK
+    uint64_t total_bytes;    // Decoded bytes across all entries
+    int archive_status;      // ARC_TEST_DECODE if the archive itself is damaged (listing or trailer)
+    int archive_error;       // errno for archive_status
+} ArcTestReport;
+
+/**
+ * Decode and verify the remaining entries of an archive.
+ *
+ * Nothing is written to disk. Directories, links and other non-file
+ * entries carry no data and get no result. A damaged header stops the
+ * listing: entries up to that point are still reported, and
+ * archive_status is set.
+ *
+ * @param reader The archive reader (iterated from its current position)
+ * @param opts Options (NULL = defaults)
+ * @param report Output report (free with arc_test_report_free())
+ * @return Number of failures (failed entries, plus one for a damaged
+ *         archive), or -1 on error (the report is left empty)
+ */
+int64_t arc_test(ArcReader *reader, const ArcTestOptions *opts, ArcTestReport *report);
+
+/**
+ * Free a report filled in by arc_test().
+ */
+void arc_test_report_free(ArcTestReport *report);
+
+#endif // ARC_TEST_H
@@ -0,0 +1,172 @@
+#define _POSIX_C_SOURCE 200809L
+#include "arc_transcode.h"
+#include "arc_base.h"
+#include "arc_stream.h"
+#include "arc_zip.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#define SPOOL_BUFFER_SIZE (64 * 1024)
+
+/**
+ * Copy the current ZIP entry's compressed bytes into the writer, if it is
+ * stored with the writer's method.
+ *
+ * @return 1 if copied, 0 if the entry must be decoded instead, -1 on error
+ */
+static int pass_through(ArcReader *src, ArcWriter *dst, const ArcEntry *entry) {
+    ArcEntryLocation loc;
+    if (arc_reader_entry_location(src, &loc) < 0 || loc.format != ARC_FORMAT_ZIP ||
+        !loc.has_crc || (loc.flags & ZIP_FLAG_ENCRYPTED) || (int)loc.method != arc_writer_zip_method(dst)) {
+        return 0;
+    }
+    ArcStream *stream = ((ArcReaderBase *)src)->stream;
+    if (!arc_stream_is_seekable(stream)) {
+        return 0;
+    }
+    // A streaming-mode reader continues from the current position
+    int64_t pos = arc_stream_tell(stream);
+    int64_t offset = pos >= 0 ? arc_zip_data_offset(stream, &loc) : -1;
+    if (offset < 0 || arc_stream_seek(stream, pos, SEEK_SET) < 0) {
+        return 0;
+    }
+
+    ArcStream *raw = arc_stream_substream(stream, offset, (int64_t)loc.stored_size);
+    if (!raw) {
+        return -1;
+    }
+    ArcZipRawInfo raw_info = { loc.method, loc.crc32, loc.size, loc.stored_size };
+    int rc = arc_writer_add_raw(dst, entry, raw, &raw_info);
+    int saved = errno;
+    arc_stream_close(raw);
+    if (arc_stream_seek(stream, pos, SEEK_SET) < 0 && rc == 0) {
+        return -1;
+    }
+    errno = saved;
+    return rc < 0 ? -1 : 1;
+}
+
+/**
+ * Decode a lone compressed file into an anonymous temporary file, to learn
+ * its exact size.
+ *
+ * @return The file (size in *size), or NULL on error
+ */
+static FILE *spool(ArcStream *data, uint64_t *size) {
+    FILE *f = tmpfile();
+    char *buf = f ? malloc(SPOOL_BUFFER_SIZE) : NULL;
+    if (!buf) {
+        int saved = errno ? errno : ENOMEM;
+        if (f) {
+            fclose(f);
+        }
+        errno = saved;
+        return NULL;
+    }
+    *size = 0;
+    ssize_t n = 0;
+    while (data && (n = arc_stream_read(data, buf, SPOOL_BUFFER_SIZE)) > 0) {
+        if (fwrite(buf, 1, (size_t)n, f) != (size_t)n) {
+            n = -1;
+            break;
+        }
+        *size += (uint64_t)n;
+    }
+    free(buf);
+    if (n < 0 || fflush(f) != 0 || lseek(fileno(f), 0, SEEK_SET) < 0) {
+        int saved = errno ? errno : EIO;
+        fclose(f);
+        errno = saved;
+        return NULL;
+    }
+    return f;
+}
+
+/**
+ * Decode the current entry and write it with the same metadata.
+ */
+static int copy_entry(ArcReader *src, ArcWriter *dst, ArcEntry *entry, uint64_t *bytes) {
+    // A lone compressed file's size is only a hint (0 = unknown, gzip ISIZE is mod 2^32)
+    bool lone = entry->type == ARC_ENTRY_FILE && arc_reader_format(src) == ARC_FORMAT_COMPRESSED;
+    ArcStream *data = NULL;
+    if (entry->type == ARC_ENTRY_FILE && (entry->size > 0 || lone)) {
+        errno = 0;
+        data = arc_open_data(src);
+        if (!data && !lone) {
+            return -1;
+        }
+    }
+
+    int rc;
+    if (lone) {
+        if (arc_writer_zip_method(dst) >= 0) {
+            // ZIP takes a stream of unknown length
+            entry->size = ARC_ZIP_SIZE_UNKNOWN;
+            rc = arc_writer_add(dst, entry, data);
+        } else {
+            FILE *f = spool(data, &entry->size);
+            ArcStream *spooled = f ? arc_stream_from_fd(fileno(f), 0) : NULL;
+            rc = spooled ? arc_writer_add(dst, entry, spooled) : -1;
+            int saved = errno;
+            arc_stream_close(spooled);
+            if (f) {
+                fclose(f);
+            }
+            errno = saved;
+        }
+    } else {
+        rc = arc_writer_add(dst, entry, data);
+    }
+    int saved = errno;
+    arc_stream_close(data);
+    errno = saved;
+    if (rc == 0 && entry->type == ARC_ENTRY_FILE && entry->size != ARC_ZIP_SIZE_UNKNOWN) {
+        *bytes += entry->size;
+    }
+    return rc;
+}
+
+int64_t arc_transcode(ArcReader *src, ArcWriter *dst, const ArcTranscodeOptions *opts,
+                      ArcTranscodeStats *stats) {
+    if (!src || !dst) {
+        errno = EINVAL;
+        return -1;
+    }
+    ArcTranscodeStats counts = { 0, 0, 0 };
+    bool passthrough = !(opts && opts->no_passthrough) && arc_writer_zip_method(dst) >= 0 &&
+                       arc_reader_format(src) == ARC_FORMAT_ZIP;
+
+    ArcEntry entry;
+    int rc;
+    while ((rc = arc_next(src, &entry)) == 0) {
+        int copied = 0;
+        if (passthrough && entry.type == ARC_ENTRY_FILE && entry.size > 0) {
+            copied = pass_through(src, dst, &entry);
+            if (copied > 0) {
+                counts.passed_through++;
+                counts.bytes += entry.size;
+            }
+        }
+        if (copied == 0) {
+            copied = copy_entry(src, dst, &entry, &counts.bytes) < 0 ? -1 : 1;
+        }
+        int saved = errno ? errno : EIO;
+        arc_entry_free(&entry);
+        if (copied < 0) {
+            errno = saved;
+            rc = -1;
+            break;
+        }
+        counts.entries++;
+    }
+    if (stats) {
+        *stats = counts;
+    }
+    if (rc < 0) {
+        return -1;
+    }
+    return (int64_t)counts.entries;
+}
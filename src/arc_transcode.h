@@ -0,0 +1,50 @@
+#ifndef ARC_TRANSCODE_H
+#define ARC_TRANSCODE_H
+
+#include "arc_reader.h"
+#include "arc_writer.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Archive transcoding: re-encode an archive into another container or
+ * compression in one pass, without extracting it.
+ *
+ * Entries are read in order and each one's data is streamed straight into
+ * the writer, so memory stays bounded by the writers' buffers whatever the
+ * archive size. ZIP entries already compressed with the target's method
+ * are copied as they are (raw deflate bytes, stored CRC), with no
+ * decompression or recompression at all.
+ */
+
+typedef struct ArcTranscodeOptions {
+    bool no_passthrough;  // Decode and re-encode every ZIP entry
+} ArcTranscodeOptions;
+
+typedef struct ArcTranscodeStats {
+    uint64_t entries;         // Entries written
+    uint64_t passed_through;  // Of those, ZIP entries copied without decoding
+    uint64_t bytes;           // Uncompressed file bytes written (lone compressed files into ZIP: not counted)
+} ArcTranscodeStats;
+
+/**
+ * Copy the remaining entries of an archive into a writer. The writer is
+ * not finished, so entries from several sources can be combined.
+ *
+ * A lone compressed file (.gz, .xz, ...) has no reliable size up front;
+ * for TAR targets its data is spooled to an anonymous temporary file first.
+ *
+ * No entry is dropped: hard links go to TAR targets as hard links, and a
+ * hard link into ZIP or a special file fails the call with ENOTSUP.
+ *
+ * @param src Source archive (iterated from its current position)
+ * @param dst Target writer
+ * @param opts Options (NULL = defaults)
+ * @param stats Counters (may be NULL)
+ * @return Number of entries written, or -1 on error (errno set; the
+ *         target is incomplete, stats count what was written)
+ */
+int64_t arc_transcode(ArcReader *src, ArcWriter *dst, const ArcTranscodeOptions *opts,
+                      ArcTranscodeStats *stats);
+
+#endif // ARC_TRANSCODE_H
@@ -0,0 +1,461 @@
+#define _POSIX_C_SOURCE 200809L
+#include "arc_tree.h"
+#include "arc_reader.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#define TREE_NO_ENTRY UINT32_MAX
+
+// Final, compact node layout (children of a node are contiguous)
+typedef struct TreeNodeData {
+    uint32_t parent;
+    uint32_t first_child;
+    uint32_t child_count;
+    uint32_t name_off;      // Offset into names (NUL-terminated)
+    uint32_t name_len;
+    uint32_t entry;         // Index into entries, or TREE_NO_ENTRY
+    uint8_t is_dir;
+} TreeNodeData;
+
+struct ArcTree {
+    ArcEntry *entries;
+    size_t entry_count;
+    TreeNodeData *nodes;
+    size_t node_count;
+    char *names;
+};
+
+// Build-time node: names point into the entries' path strings
+typedef struct TreeTmpNode {
+    const char *name;
+    uint32_t name_len;
+    uint32_t parent;
+    uint32_t entry;
+    bool is_dir;
+} TreeTmpNode;
+
+typedef struct TreeBuilder {
+    TreeTmpNode *nodes;
+    size_t count;
+    size_t capacity;
+    uint32_t *slots;        // Open-addressing table of node ids keyed by (parent, name)
+    size_t slot_count;      // Power of two
+} TreeBuilder;
+
+static uint64_t tree_hash(uint32_t parent, const char *name, size_t len) {
+    // FNV-1a over the name, seeded with the parent id
+    uint64_t h = 1469598103934665603ULL ^ ((uint64_t)parent * 0x9E3779B97F4A7C15ULL);
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)name[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static int builder_rehash(TreeBuilder *b, size_t slot_count) {
+    uint32_t *slots = malloc(slot_count * sizeof(*slots));
+    if (!slots) {
+        return -1;
+    }
+    memset(slots, 0xFF, slot_count * sizeof(*slots));
+    for (size_t i = 1; i < b->count; i++) {
+        const TreeTmpNode *n = &b->nodes[i];
+        size_t pos = (size_t)tree_hash(n->parent, n->name, n->name_len) & (slot_count - 1);
+        while (slots[pos] != UINT32_MAX) {
+            pos = (pos + 1) & (slot_count - 1);
+        }
+        slots[pos] = (uint32_t)i;
+    }
+    free(b->slots);
+    b->slots = slots;
+    b->slot_count = slot_count;
+    return 0;
+}
+
+// Find the child `name` of `parent`, creating it if needed
+static uint32_t builder_child(TreeBuilder *b, uint32_t parent, const char *name, size_t len) {
+    if ((b->count + 1) * 2 > b->slot_count) {
+        if (builder_rehash(b, b->slot_count ? b->slot_count * 2 : 1024) < 0) {
+            return UINT32_MAX;
+        }
+    }
+    size_t pos = (size_t)tree_hash(parent, name, len) & (b->slot_count - 1);
+    while (b->slots[pos] != UINT32_MAX) {
+        const TreeTmpNode *n = &b->nodes[b->slots[pos]];
+        if (n->parent == parent && n->name_len == len && memcmp(n->name, name, len) == 0) {
+            return b->slots[pos];
+        }
+        pos = (pos + 1) & (b->slot_count - 1);
+    }
+
+    if (b->count >= b->capacity) {
+        size_t new_capacity = b->capacity * 2;
+        TreeTmpNode *nodes = realloc(b->nodes, new_capacity * sizeof(*nodes));
+        if (!nodes) {
+            return UINT32_MAX;
+        }
+        b->nodes = nodes;
+        b->capacity = new_capacity;
+    }
+    if (b->count >= UINT32_MAX - 1) {
+        errno = EOVERFLOW;
+        return UINT32_MAX;
+    }
+    uint32_t id = (uint32_t)b->count++;
+    TreeTmpNode *n = &b->nodes[id];
+    n->name = name;
+    n->name_len = (uint32_t)len;
+    n->parent = parent;
+    n->entry = TREE_NO_ENTRY;
+    n->is_dir = false;
+    b->slots[pos] = id;
+    return id;
+}
+
+// Insert one entry path, synthesising its parent directories
+static int builder_add(TreeBuilder *b, const ArcEntry *entry, uint32_t index) {
+    const char *s = entry->path;
+    uint32_t parent = ARC_TREE_ROOT;
+    uint32_t node = ARC_TREE_NONE;
+    if (!s) {
+        return 0;
+    }
+    while (*s) {
+        while (*s == '/') s++;
+        if (!*s) break;
+        const char *end = strchr(s, '/');
+        if (!end) end = s + strlen(s);
+        size_t len = (size_t)(end - s);
+        if (!(len == 1 && s[0] == '.')) {
+            node = builder_child(b, parent, s, len);
+            if (node == UINT32_MAX) {
+                return -1;
+            }
+            b->nodes[parent].is_dir = true; // Anything with children is a directory
+            parent = node;
+        }
+        s = end;
+    }
+    if (node == ARC_TREE_NONE) {
+        return 0; // Empty path or just "/" and "." components
+    }
+    // Later duplicates win, like extraction overwriting earlier files
+    b->nodes[node].entry = index;
+    if (entry->type == ARC_ENTRY_DIR) {
+        b->nodes[node].is_dir = true;
+    }
+    return 0;
+}
+
+typedef struct TreeSortItem {
+    const char *name;
+    uint32_t name_len;
+    uint32_t tmp;
+} TreeSortItem;
+
+static int tree_name_cmp(const char *a, size_t alen, const char *b, size_t blen) {
+    int c = memcmp(a, b, alen < blen ? alen : blen);
+    if (c != 0) return c;
+    return (alen > blen) - (alen < blen);
+}
+
+static int sort_item_cmp(const void *pa, const void *pb) {
+    const TreeSortItem *a = (const TreeSortItem *)pa;
+    const TreeSortItem *b = (const TreeSortItem *)pb;
+    return tree_name_cmp(a->name, a->name_len, b->name, b->name_len);
+}
+
+// Lay the nodes out breadth-first so every child range is contiguous
+static int tree_finalize(ArcTree *tree, const TreeBuilder *b) {
+    size_t n = b->count;
+    uint32_t *child_start = calloc(n + 1, sizeof(uint32_t));
+    uint32_t *child_list = malloc((n ? n : 1) * sizeof(uint32_t));
+    TreeSortItem *items = malloc((n ? n : 1) * sizeof(TreeSortItem));
+    uint32_t *order = malloc(n * sizeof(uint32_t));
+    tree->nodes = calloc(n, sizeof(TreeNodeData));
+    size_t names_size = 1;
+    for (size_t i = 1; i < n; i++) {
+        names_size += b->nodes[i].name_len + 1;
+    }
+    tree->names = malloc(names_size);
+    if (!child_start || !child_list || !items || !order || !tree->nodes || !tree->names) {
+        free(child_start);
+        free(child_list);
+        free(items);
+        free(order);
+        return -1;
+    }
+
+    // Group tmp ids by parent (counting sort)
+    for (size_t i = 1; i < n; i++) {
+        child_start[b->nodes[i].parent + 1]++;
+    }
+    for (size_t i = 0; i < n; i++) {
+        child_start[i + 1] += child_start[i];
+    }
+    uint32_t *fill = calloc(n, sizeof(uint32_t));
+    if (!fill) {
+        free(child_start);
+        free(child_list);
+        free(items);
+        free(order);
+        return -1;
+    }
+    for (size_t i = 1; i < n; i++) {
+        uint32_t p = b->nodes[i].parent;
+        child_list[child_start[p] + fill[p]++] = (uint32_t)i;
+    }
+    free(fill);
+
+    size_t name_pos = 0;
+    tree->names[name_pos++] = '\0'; // Root name
+    order[0] = ARC_TREE_ROOT;
+    tree->nodes[0].parent = ARC_TREE_NONE;
+    tree->nodes[0].entry = TREE_NO_ENTRY;
+    tree->nodes[0].is_dir = 1;
+    size_t next = 1;
+    for (size_t head = 0; head < next; head++) {
+        uint32_t t = order[head];
+        uint32_t k = child_start[t + 1] - child_start[t];
+        for (uint32_t c = 0; c < k; c++) {
+            const TreeTmpNode *tn = &b->nodes[child_list[child_start[t] + c]];
+            items[c].name = tn->name;
+            items[c].name_len = tn->name_len;
+            items[c].tmp = child_list[child_start[t] + c];
+        }
+        qsort(items, k, sizeof(*items), sort_item_cmp);
+        tree->nodes[head].first_child = (uint32_t)next;
+        tree->nodes[head].child_count = k;
+        for (uint32_t c = 0; c < k; c++) {
+            const TreeTmpNode *tn = &b->nodes[items[c].tmp];
+            TreeNodeData *fn = &tree->nodes[next];
+            fn->parent = (uint32_t)head;
+            fn->entry = tn->entry;
+            fn->is_dir = tn->is_dir ? 1 : 0;
+            fn->name_off = (uint32_t)name_pos;
+            fn->name_len = tn->name_len;
+            memcpy(tree->names + name_pos, tn->name, tn->name_len);
+            name_pos += tn->name_len;
+            tree->names[name_pos++] = '\0';
+            order[next++] = items[c].tmp;
+        }
+    }
+    tree->node_count = next;
+
+    free(child_start);
+    free(child_list);
+    free(items);
+    free(order);
+    return 0;
+}
+
+static void free_entries(ArcEntry *entries, size_t count) {
+    if (!entries) {
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        arc_entry_free(&entries[i]);
+    }
+    free(entries);
+}
+
+ArcTree *arc_tree_build_entries(ArcEntry *entries, size_t count) {
+    if (!entries && count > 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (count >= UINT32_MAX) {
+        free_entries(entries, count);
+        errno = EOVERFLOW;
+        return NULL;
+    }
+    ArcTree *tree = calloc(1, sizeof(*tree));
+    TreeBuilder b;
+    memset(&b, 0, sizeof(b));
+    b.capacity = count + 16;
+    b.nodes = malloc(b.capacity * sizeof(*b.nodes));
+    if (!tree || !b.nodes) {
+        goto fail;
+    }
+    // Root
+    b.nodes[0].name = "";
+    b.nodes[0].name_len = 0;
+    b.nodes[0].parent = ARC_TREE_NONE;
+    b.nodes[0].entry = TREE_NO_ENTRY;
+    b.nodes[0].is_dir = true;
+    b.count = 1;
+
+    for (size_t i = 0; i < count; i++) {
+        if (builder_add(&b, &entries[i], (uint32_t)i) < 0) {
+            goto fail;
+        }
+    }
+    if (tree_finalize(tree, &b) < 0) {
+        goto fail;
+    }
+    tree->entries = entries;
+    tree->entry_count = count;
+    free(b.nodes);
+    free(b.slots);
+    return tree;
+
+fail:
+    free(b.nodes);
+    free(b.slots);
+    if (tree) {
+        free(tree->nodes);
+        free(tree->names);
+        free(tree);
+    }
+    free_entries(entries, count);
+    return NULL;
+}
+
+ArcTree *arc_tree_build(ArcReader *reader) {
+    if (!reader) {
+        errno = EINVAL;
+        return NULL;
+    }
+    ArcEntry *entries = NULL;
+    size_t count = 0;
+    if (arc_list_entries(reader, &entries, &count) < 0) {
+        return NULL;
+    }
+    return arc_tree_build_entries(entries, count);
+}
+
+void arc_tree_free(ArcTree *tree) {
+    if (!tree) {
+        return;
+    }
+    free_entries(tree->entries, tree->entry_count);
+    free(tree->nodes);
+    free(tree->names);
+    free(tree);
+}
+
+size_t arc_tree_node_count(const ArcTree *tree) {
+    return tree ? tree->node_count : 0;
+}
+
+size_t arc_tree_children(const ArcTree *tree, ArcTreeNode node, ArcTreeNode *first) {
+    if (first) {
+        *first = ARC_TREE_NONE;
+    }
+    if (!tree || node >= tree->node_count) {
+        return 0;
+    }
+    const TreeNodeData *n = &tree->nodes[node];
+    if (first && n->child_count > 0) {
+        *first = n->first_child;
+    }
+    return n->child_count;
+}
+
+ArcTreeNode arc_tree_parent(const ArcTree *tree, ArcTreeNode node) {
+    if (!tree || node >= tree->node_count) {
+        return ARC_TREE_NONE;
+    }
+    return tree->nodes[node].parent;
+}
+
+const char *arc_tree_name(const ArcTree *tree, ArcTreeNode node) {
+    if (!tree || node >= tree->node_count) {
+        return NULL;
+    }
+    return tree->names + tree->nodes[node].name_off;
+}
+
+bool arc_tree_is_dir(const ArcTree *tree, ArcTreeNode node) {
+    if (!tree || node >= tree->node_count) {
+        return false;
+    }
+    return tree->nodes[node].is_dir != 0;
+}
+
+const ArcEntry *arc_tree_entry(const ArcTree *tree, ArcTreeNode node) {
+    if (!tree || node >= tree->node_count || tree->nodes[node].entry == TREE_NO_ENTRY) {
+        return NULL;
+    }
+    return &tree->entries[tree->nodes[node].entry];
+}
+
+int64_t arc_tree_entry_index(const ArcTree *tree, ArcTreeNode node) {
+    if (!tree || node >= tree->node_count || tree->nodes[node].entry == TREE_NO_ENTRY) {
+        return -1;
+    }
+    return (int64_t)tree->nodes[node].entry;
+}
+
+ArcTreeNode arc_tree_lookup(const ArcTree *tree, const char *path) {
+    if (!tree || !path) {
+        return ARC_TREE_NONE;
+    }
+    ArcTreeNode node = ARC_TREE_ROOT;
+    const char *s = path;
+    while (*s) {
+        while (*s == '/') s++;
+        if (!*s) break;
+        const char *end = strchr(s, '/');
+        if (!end) end = s + strlen(s);
+        size_t len = (size_t)(end - s);
+        if (!(len == 1 && s[0] == '.')) {
+            // Binary search the sorted child range
+            const TreeNodeData *n = &tree->nodes[node];
+            size_t lo = n->first_child;
+            size_t hi = lo + n->child_count;
+            ArcTreeNode found = ARC_TREE_NONE;
+            while (lo < hi) {
+                size_t mid = lo + (hi - lo) / 2;
+                const TreeNodeData *m = &tree->nodes[mid];
+                int c = tree_name_cmp(tree->names + m->name_off, m->name_len, s, len);
+                if (c == 0) {
+                    found = (ArcTreeNode)mid;
+                    break;
+                }
+                if (c < 0) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            if (found == ARC_TREE_NONE) {
+                return ARC_TREE_NONE;
+            }
+            node = found;
+        }
+        s = end;
+    }
+    return node;
+}
+
+size_t arc_tree_path(const ArcTree *tree, ArcTreeNode node, char *buf, size_t size) {
+    if (!tree || node >= tree->node_count) {
+        if (buf && size > 0) buf[0] = '\0';
+        return 0;
+    }
+    // Total length: components joined by '/'
+    size_t total = 0;
+    for (ArcTreeNode n = node; n != ARC_TREE_ROOT; n = tree->nodes[n].parent) {
+        total += tree->nodes[n].name_len + (tree->nodes[n].parent != ARC_TREE_ROOT ? 1 : 0);
+    }
+    if (!buf || size == 0) {
+        return total;
+    }
+    // Fill from the end; bytes past size - 1 are dropped
+    size_t pos = total;
+    for (ArcTreeNode n = node; n != ARC_TREE_ROOT; n = tree->nodes[n].parent) {
+        const TreeNodeData *d = &tree->nodes[n];
+        pos -= d->name_len;
+        for (size_t i = 0; i < d->name_len; i++) {
+            if (pos + i < size - 1) buf[pos + i] = tree->names[d->name_off + i];
+        }
+        if (d->parent != ARC_TREE_ROOT) {
+            pos--;
+            if (pos < size - 1) buf[pos] = '/';
+        }
+    }
+    buf[total < size - 1 ? total : size - 1] = '\0';
+    return total;
+}
@@ -0,0 +1,107 @@
+#ifndef ARC_TREE_H
+#define ARC_TREE_H
+
+#include "arc_reader.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * In-memory directory tree over an archive listing.
+ *
+ * Built once from the entry names, the tree answers "children of directory
+ * X" in O(children) and "node for path P" in O(depth * log(fanout)).
+ * Parent directories that have no entry of their own (common in ZIPs) are
+ * synthesised. Children of a node are stored contiguously and sorted by
+ * name, so a listing is a single slice [first, first + count).
+ */
+
+typedef struct ArcTree ArcTree;
+
+/**
+ * Node handle. Nodes are numbered 0..arc_tree_node_count()-1.
+ */
+typedef uint32_t ArcTreeNode;
+
+#define ARC_TREE_ROOT 0u            // The archive root (no name, no entry)
+#define ARC_TREE_NONE UINT32_MAX    // "No such node"
+
+/**
+ * Build a tree from all remaining entries of a reader.
+ * The reader is consumed (iterated to the end); entry data is not read.
+ *
+ * @param reader The archive reader
+ * @return New tree, or NULL on error
+ */
+ArcTree *arc_tree_build(ArcReader *reader);
+
+/**
+ * Build a tree from an entry array (e.g. from arc_list_entries()).
+ * The tree takes ownership of `entries` (freed by arc_tree_free()).
+ *
+ * @param entries Entry array allocated like arc_list_entries() does
+ * @param count Number of entries
+ * @return New tree, or NULL on error (entries are freed in both cases)
+ */
+ArcTree *arc_tree_build_entries(ArcEntry *entries, size_t count);
+
+/**
+ * Free a tree and the entries it owns.
+ */
+void arc_tree_free(ArcTree *tree);
+
+/**
+ * Number of nodes (including the root and synthesised directories).
+ */
+size_t arc_tree_node_count(const ArcTree *tree);
+
+/**
+ * Children of a node.
+ *
+ * @param tree The tree
+ * @param node Directory node
+ * @param first Output: first child node (children are first..first+count-1)
+ * @return Number of children (0 for files or unknown nodes)
+ */
+size_t arc_tree_children(const ArcTree *tree, ArcTreeNode node, ArcTreeNode *first);
+
+/**
+ * Parent of a node (ARC_TREE_NONE for the root).
+ */
+ArcTreeNode arc_tree_parent(const ArcTree *tree, ArcTreeNode node);
+
+/**
+ * Last path component of a node ("" for the root). Valid for the tree's lifetime.
+ */
+const char *arc_tree_name(const ArcTree *tree, ArcTreeNode node);
+
+/**
+ * Whether the node is a directory (explicit or synthesised).
+ */
+bool arc_tree_is_dir(const ArcTree *tree, ArcTreeNode node);
+
+/**
+ * Archive entry for a node, or NULL for the root and synthesised directories.
+ */
+const ArcEntry *arc_tree_entry(const ArcTree *tree, ArcTreeNode node);
+
+/**
+ * Position of the node's entry in the listing order, or -1 if it has none.
+ */
+int64_t arc_tree_entry_index(const ArcTree *tree, ArcTreeNode node);
+
+/**
+ * Find a node by path ("a/b/c", leading/trailing slashes are ignored; "" is the root).
+ *
+ * @return Node, or ARC_TREE_NONE if not found
+ */
+ArcTreeNode arc_tree_lookup(const ArcTree *tree, const char *path);
+
+/**
+ * Write the full path of a node into buf (snprintf semantics).
+ *
+ * @return Length of the full path (may exceed size - 1 if truncated)
+ */
+size_t arc_tree_path(const ArcTree *tree, ArcTreeNode node, char *buf, size_t size);
+
+#endif // ARC_TREE_H
@@ -0,0 +1,189 @@
+#define _POSIX_C_SOURCE 200809L
+#include "arc_writer.h"
+#include "arc_tar_writer.h"
+#include "arc_base.h"
+#include "arc_filter.h"
+#include "arc_stream.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+// Unix file type bits (must match arc_zip_writer.c)
+#define UNIX_IFDIR 0040000
+#define UNIX_IFREG 0100000
+#define UNIX_IFLNK 0120000
+
+struct ArcWriter {
+    int format;
+    bool store;
+    ArcZipWriter *zip;
+    ArcTarWriter *tar;
+    ArcOutStream *out;   // TAR output: the descriptor
+    ArcOutStream *gzip;  // Compressing filter on out (ARC_WRITER_TAR_GZIP)
+};
+
+ArcWriter *arc_writer_new(int fd, const ArcWriterOptions *opts) {
+    int format = opts ? opts->format : ARC_WRITER_TAR;
+    if (fd < 0 || format < ARC_WRITER_TAR || format > ARC_WRITER_ZIP) {
+        errno = EINVAL;
+        return NULL;
+    }
+    ArcWriter *w = calloc(1, sizeof(ArcWriter));
+    if (!w) {
+        return NULL;
+    }
+    w->format = format;
+    w->store = opts && opts->store;
+
+    if (format == ARC_WRITER_ZIP) {
+        ArcZipWriterOptions zip_opts = { 0 };
+        if (opts) {
+            zip_opts.level = opts->level;
+            zip_opts.store = opts->store;
+            zip_opts.threads = opts->threads;
+        }
+        w->zip = arc_zip_writer_new_ex(fd, &zip_opts);
+        if (!w->zip) {
+            int saved = errno;
+            free(w);
+            errno = saved;
+            return NULL;
+        }
+        return w;
+    }
+
+    w->out = arc_out_stream_from_fd(fd);
+    ArcOutStream *target = w->out;
+    if (w->out && format == ARC_WRITER_TAR_GZIP) {
+        ArcGzipWriteOptions gzip_opts = { 0, 0, 0 };
+        if (opts) {
+            gzip_opts.level = opts->level;
+            gzip_opts.threads = opts->threads;
+        }
+        w->gzip = arc_filter_gzip_write(w->out, &gzip_opts);
+        target = w->gzip;
+    }
+    w->tar = target ? arc_tar_writer_new_stream(target, NULL) : NULL;
+    if (!w->tar) {
+        int saved = errno;
+        arc_writer_free(w);
+        errno = saved;
+        return NULL;
+    }
+    return w;
+}
+
+int arc_writer_add(ArcWriter *w, const ArcEntry *entry, ArcStream *data) {
+    if (!w || !entry || !entry->path) {
+        errno = EINVAL;
+        return -1;
+    }
+    uint32_t type;
+    switch (entry->type) {
+        case ARC_ENTRY_FILE:
+            type = UNIX_IFREG;
+            break;
+        case ARC_ENTRY_DIR:
+            type = UNIX_IFDIR;
+            break;
+        case ARC_ENTRY_SYMLINK:
+            if (!entry->link_target) {
+                errno = EINVAL;
+                return -1;
+            }
+            type = UNIX_IFLNK;
+            break;
+        case ARC_ENTRY_HARDLINK:
+            // ZIP has no hard links, and the linked file's data is not at hand
+            if (!w->tar) {
+                errno = ENOTSUP;
+                return -1;
+            }
+            if (!entry->link_target) {
+                errno = EINVAL;
+                return -1;
+            }
+            type = UNIX_IFREG;
+            break;
+        default:
+            errno = ENOTSUP;
+            return -1;
+    }
+    uint32_t mode = type | (entry->mode & 07777);
+
+    if (w->tar) {
+        ArcTarEntryInfo info = { mode, entry->mtime, entry->uid, entry->gid, entry->size,
+                                 entry->link_target, entry->type == ARC_ENTRY_HARDLINK };
+        return arc_tar_writer_add_stream(w->tar, entry->path, data, &info);
+    }
+
+    ArcZipEntryInfo info = { mode, entry->mtime, entry->size };
+    if (type != UNIX_IFLNK) {
+        return arc_zip_writer_add_stream(w->zip, entry->path, data, &info);
+    }
+    // Info-ZIP style: a symlink's data is its target
+    size_t len = strlen(entry->link_target);
+    ArcStream *target = arc_stream_from_memory(entry->link_target, len, 0);
+    if (!target) {
+        return -1;
+    }
+    info.size = len;
+    int rc = arc_zip_writer_add_stream(w->zip, entry->path, target, &info);
+    arc_stream_close(target);
+    return rc;
+}
+
+int arc_writer_zip_method(const ArcWriter *w) {
+    if (!w || !w->zip) {
+        return -1;
+    }
+    return w->store ? ZIP_METHOD_STORE : ZIP_METHOD_DEFLATE;
+}
+
+int arc_writer_add_raw(ArcWriter *w, const ArcEntry *entry, ArcStream *raw,
+                       const ArcZipRawInfo *raw_info) {
+    if (!w || !entry || !entry->path || !raw_info || entry->type != ARC_ENTRY_FILE) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (arc_writer_zip_method(w) != (int)raw_info->method) {
+        errno = ENOTSUP;
+        return -1;
+    }
+    ArcZipEntryInfo info = { UNIX_IFREG | (entry->mode & 07777), entry->mtime, raw_info->size };
+    return arc_zip_writer_add_raw(w->zip, entry->path, raw, &info, raw_info);
+}
+
+int arc_writer_finish(ArcWriter *w) {
+    if (!w) {
+        errno = EINVAL;
+        return -1;
+    }
+    int rc;
+    if (w->zip) {
+        rc = arc_zip_writer_finish(w->zip);
+        w->zip = NULL;
+    } else {
+        rc = arc_tar_writer_finish(w->tar);
+        w->tar = NULL;
+        if (rc == 0 && w->gzip) {
+            rc = arc_out_stream_finish(w->gzip);
+        }
+    }
+    int saved = errno;
+    arc_writer_free(w);
+    errno = saved;
+    return rc;
+}
+
+void arc_writer_free(ArcWriter *w) {
+    if (!w) {
+        return;
+    }
+    arc_zip_writer_free(w->zip);
+    arc_tar_writer_free(w->tar);
+    // The filter before the stream it writes to
+    arc_out_stream_close(w->gzip);
+    arc_out_stream_close(w->out);
+    free(w);
+}
@@ -0,0 +1,89 @@
+#ifndef ARC_WRITER_H
+#define ARC_WRITER_H
+
+#include "arc_reader.h"
+#include "arc_zip_writer.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Format-independent archive writer.
+ *
+ * One handle over the ZIP writer, the TAR writer, or the TAR writer on the
+ * parallel gzip filter, taking entries as ArcEntry records, the same shape
+ * arc_next() hands out, so anything read from one archive can be written
+ * to another. Metadata is kept as far as the target can store it: ZIP has
+ * no owner ids and keeps mtime to 2 seconds.
+ */
+
+// ArcWriterOptions.format
+#define ARC_WRITER_TAR      0  // Uncompressed pax TAR
+#define ARC_WRITER_TAR_GZIP 1  // TAR through arc_filter_gzip_write()
+#define ARC_WRITER_ZIP      2  // ZIP, deflated (or stored) per entry
+
+typedef struct ArcWriter ArcWriter;
+
+/**
+ * Writer options. A zeroed struct (or NULL) writes a plain TAR; level and
+ * threads default as in the underlying writers.
+ */
+typedef struct ArcWriterOptions {
+    int format;        // ARC_WRITER_*
+    int level;         // Deflate level 1-9 (0 = zlib default); ignored for plain TAR
+    bool store;        // ZIP only: store entries uncompressed
+    unsigned threads;  // Compression threads (0 = one per online CPU, 1 = calling thread only)
+} ArcWriterOptions;
+
+/**
+ * Create a writer on an open descriptor. The descriptor is not closed by
+ * the writer.
+ *
+ * @return New writer, or NULL on error (EINVAL for an unknown format)
+ */
+ArcWriter *arc_writer_new(int fd, const ArcWriterOptions *opts);
+
+/**
+ * Add an entry. Files take their data from the stream (entry->size bytes;
+ * TAR needs the size before the data), symlinks and hard links their
+ * target from entry->link_target, and directories no data. The type comes
+ * from entry->type and the permissions from entry->mode.
+ *
+ * @param writer The writer
+ * @param entry Entry metadata
+ * @param data File data (may be NULL for empty files and other types; not closed)
+ * @return 0 on success, -1 on error (ENOTSUP for special files, and for
+ *         hard links into ZIP)
+ */
+int arc_writer_add(ArcWriter *writer, const ArcEntry *entry, ArcStream *data);
+
+/**
+ * ZIP compression method the writer uses for file data: 0 (store) or 8
+ * (deflate), or -1 if the target is not ZIP. Entries already compressed
+ * with this method can go through arc_writer_add_raw().
+ */
+int arc_writer_zip_method(const ArcWriter *writer);
+
+/**
+ * Add a regular file whose data is already compressed with the writer's
+ * ZIP method (see arc_zip_writer_add_raw()).
+ *
+ * @return 0 on success, -1 on error (ENOTSUP if the target is not ZIP or
+ *         the method differs)
+ */
+int arc_writer_add_raw(ArcWriter *writer, const ArcEntry *entry, ArcStream *raw,
+                       const ArcZipRawInfo *raw_info);
+
+/**
+ * Complete the archive (central directory, end blocks, gzip trailer) and
+ * free the writer (also on failure).
+ *
+ * @return 0 on success, -1 if this or an earlier call failed
+ */
+int arc_writer_finish(ArcWriter *writer);
+
+/**
+ * Free a writer without completing the archive.
+ */
+void arc_writer_free(ArcWriter *writer);
+
+#endif // ARC_WRITER_H
@@ -3,6 +3,7 @@
 #include "arc_reader.h"
 #include "arc_stream.h"
 #include "arc_filter.h"
+#include "arc_codec.h"
 #include "arc_base.h"
 #include <stdlib.h>
 #include <stdio.h>
@@ -14,6 +15,8 @@
 #include <zlib.h>
 #include <stdint.h>
 #include <limits.h>
+#include <stdatomic.h>
+#include <pthread.h>
 
 // Note: Security/resource limits are provided via ArcLimits (ArcReaderBase.limits).
 
@@ -27,13 +30,11 @@
 // ZIP64 Extended Information Extra Field ID
 #define ZIP64_EXTRA_FIELD_ID 0x0001
 
-// ZIP compression methods
-#define ZIP_METHOD_STORE   0
-#define ZIP_METHOD_DEFLATE 8
-
-// ZIP general purpose bit flags
-#define ZIP_FLAG_ENCRYPTED 0x0001
-#define ZIP_FLAG_DATA_DESCRIPTOR 0x0008
+// Central directory decoding
+#define ZIP_CD_HEADER_SIZE 46          // Fixed part of a central directory record
+#define ZIP_CD_CHUNK 8192              // Records per chunk handed to a worker
+#define ZIP_CD_PARALLEL_MIN 32768      // Fewer records are decoded on the calling thread
+#define ZIP_CD_MAX_THREADS 64
 
 // ZIP Central Directory File Header structure (variable size)
 // We'll read it field by field
@@ -104,11 +105,15 @@ struct Zip64EOCDRecord {
     uint64_t central_dir_offset;
 };
 
-// Format types (must match arc_reader.c and arc_tar.c)
-#define ARC_FORMAT_TAR 0
-#define ARC_FORMAT_ZIP 1
-
 // ZIP reader structure
+// Parsed central directory, shared between a reader and its clones (arc_zip_clone)
+typedef struct ZipSharedDir {
+    atomic_size_t refs;
+    struct ZipCentralDirEntry *entries;
+    size_t count;
+    size_t bytes;  // Approximate heap footprint (for cache accounting)
+} ZipSharedDir;
+
 typedef struct ZipReader {
     ArcReaderBase base;  // Must be first member for safe dispatch
     ArcEntry current_entry;
@@ -118,13 +123,16 @@ typedef struct ZipReader {
     uint64_t entry_uncompressed_size;  // Store separately since current_entry is cleared
     uint16_t entry_compression_method;
     uint16_t entry_flags;
+    int64_t entry_header_offset;       // Local file header offset of the current entry
+    uint32_t entry_crc32;              // CRC-32 from the central directory / local header
     bool eof;
     
     // Reading mode
     bool streaming_mode;  // true = parse local headers, false = use central directory
     
     // Central directory (used when streaming_mode = false)
-    struct ZipCentralDirEntry *entries;
+    ZipSharedDir *shared_dir;  // Owner of entries (refcounted)
+    struct ZipCentralDirEntry *entries;  // Borrowed from shared_dir
     size_t entry_count;
     size_t current_entry_index;
     int64_t central_dir_offset;
@@ -134,6 +142,10 @@ typedef struct ZipReader {
     struct ZipCentralDirEntry *stream_entries;  // Dynamically built entry list
     size_t stream_entry_count;
     size_t stream_entry_capacity;
+
+    // Central directory pre-filter (see arc_zip_set_filter())
+    bool (*filter)(const char *name, void *user);
+    void *filter_user;
 } ZipReader;
 
 // Helper: Read little-endian uint16_t
@@ -177,8 +189,12 @@ static int parse_zip64_extra_field(const uint8_t *extra_field, size_t extra_fiel
         }
         
         if (header_id == ZIP64_EXTRA_FIELD_ID) {
-            // ZIP64 Extended Information Extra Field
+            // ZIP64 Extended Information Extra Field: only the fields that
+            // overflowed are present, so the others keep their 32-bit values
             size_t data_pos = 0;
+            entry->zip64_uncompressed_size = entry->uncompressed_size;
+            entry->zip64_compressed_size = entry->compressed_size;
+            entry->zip64_local_header_offset = entry->local_header_offset;
             
             // Uncompressed size (if standard field is 0xFFFFFFFF)
             if (entry->uncompressed_size == 0xFFFFFFFF && data_pos + 8 <= data_size) {
@@ -191,12 +207,14 @@ static int parse_zip64_extra_field(const uint8_t *extra_field, size_t extra_fiel
             if (entry->compressed_size == 0xFFFFFFFF && data_pos + 8 <= data_size) {
                 entry->zip64_compressed_size = read_le64(extra_field + pos + data_pos);
                 data_pos += 8;
+                entry->has_zip64_fields = true;
             }
             
             // Local header offset (if standard field is 0xFFFFFFFF)
             if (entry->local_header_offset == 0xFFFFFFFF && data_pos + 8 <= data_size) {
                 entry->zip64_local_header_offset = read_le64(extra_field + pos + data_pos);
                 data_pos += 8;
+                entry->has_zip64_fields = true;
             }
             
             return 0; // Found ZIP64 field
@@ -383,15 +401,8 @@ static void free_central_dir_entry(struct ZipCentralDirEntry *entry) {
     }
 }
 
-// Helper: Read central directory entry
-static int read_central_dir_entry(ArcStream *stream, struct ZipCentralDirEntry *entry, const ArcLimits *limits) {
-    uint8_t header[46]; // Fixed part of central directory header
-    
-    ssize_t n = arc_stream_read(stream, header, sizeof(header));
-    if (n != sizeof(header)) {
-        return -1;
-    }
-    
+// Helper: Decode the fixed part of a central directory header and check its lengths
+static int parse_central_dir_header(const uint8_t *header, struct ZipCentralDirEntry *entry, const ArcLimits *limits) {
     entry->signature = read_le32(header);
     if (entry->signature != ZIP_CENTRAL_DIR_SIG) {
         return -1;
@@ -427,6 +438,20 @@ static int read_central_dir_entry(ArcStream *stream, struct ZipCentralDirEntry *
         errno = EOVERFLOW;
         return -1;
     }
+    return 0;
+}
+
+// Helper: Read central directory entry
+static int read_central_dir_entry(ArcStream *stream, struct ZipCentralDirEntry *entry, const ArcLimits *limits) {
+    uint8_t header[ZIP_CD_HEADER_SIZE]; // Fixed part of central directory header
+    
+    ssize_t n = arc_stream_read(stream, header, sizeof(header));
+    if (n != sizeof(header)) {
+        return -1;
+    }
+    if (parse_central_dir_header(header, entry, limits) < 0) {
+        return -1;
+    }
     
     // Initialize ZIP64 fields
     entry->has_zip64_fields = false;
@@ -495,6 +520,169 @@ static int read_central_dir_entry(ArcStream *stream, struct ZipCentralDirEntry *
     return 0;
 }
 
+// Helper: Decode a central directory entry from memory (the whole record is in the buffer)
+static int decode_central_dir_entry(const uint8_t *record, struct ZipCentralDirEntry *entry, const ArcLimits *limits) {
+    if (parse_central_dir_header(record, entry, limits) < 0) {
+        return -1;
+    }
+    const uint8_t *p = record + ZIP_CD_HEADER_SIZE;
+    
+    if (entry->filename_length > 0) {
+        entry->filename = malloc(entry->filename_length + 1);
+        if (!entry->filename) {
+            return -1;
+        }
+        memcpy(entry->filename, p, entry->filename_length);
+        entry->filename[entry->filename_length] = '\0';
+        p += entry->filename_length;
+    }
+    
+    if (entry->extra_field_length > 0) {
+        entry->extra_field = malloc(entry->extra_field_length);
+        if (!entry->extra_field) {
+            return -1;
+        }
+        memcpy(entry->extra_field, p, entry->extra_field_length);
+        p += entry->extra_field_length;
+        parse_zip64_extra_field(entry->extra_field, entry->extra_field_length, entry);
+    }
+    
+    if (entry->comment_length > 0) {
+        entry->comment = malloc(entry->comment_length + 1);
+        if (!entry->comment) {
+            return -1;
+        }
+        memcpy(entry->comment, p, entry->comment_length);
+        entry->comment[entry->comment_length] = '\0';
+    }
+    return 0;
+}
+
+// In-memory central directory split into chunks of ZIP_CD_CHUNK records
+typedef struct CentralDirDecode {
+    const uint8_t *buf;
+    const size_t *chunk_offsets;   // Buffer offset of each chunk's first record
+    size_t chunk_count;
+    size_t count;
+    struct ZipCentralDirEntry *entries;
+    const ArcLimits *limits;
+    atomic_size_t next;            // Next chunk to claim
+    int *errors;                   // errno per chunk, 0 on success
+} CentralDirDecode;
+
+static void *decode_central_dir_worker(void *arg) {
+    CentralDirDecode *d = arg;
+    for (;;) {
+        size_t chunk = atomic_fetch_add(&d->next, 1);
+        if (chunk >= d->chunk_count) {
+            break;
+        }
+        const uint8_t *p = d->buf + d->chunk_offsets[chunk];
+        size_t end = (chunk + 1) * ZIP_CD_CHUNK < d->count ? (chunk + 1) * ZIP_CD_CHUNK : d->count;
+        for (size_t i = chunk * ZIP_CD_CHUNK; i < end; i++) {
+            errno = 0;
+            if (decode_central_dir_entry(p, &d->entries[i], d->limits) < 0) {
+                d->errors[chunk] = errno ? errno : EINVAL;
+                break;
+            }
+            p += ZIP_CD_HEADER_SIZE + d->entries[i].filename_length +
+                 d->entries[i].extra_field_length + d->entries[i].comment_length;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Decode a central directory that was read into memory as a whole.
+ *
+ * A sequential pass reads only the three length fields of each record to
+ * find where every chunk of ZIP_CD_CHUNK records starts; the chunks are
+ * then decoded (fields, names, extra fields, ZIP64 sizes) on a pool of
+ * threads, the calling thread included.
+ *
+ * @return 0 on success, -1 on error, 1 if the records don't fit in the
+ *         buffer (the directory size in the end record is wrong)
+ */
+static int decode_central_directory(const uint8_t *buf, size_t size, size_t count,
+                                    struct ZipCentralDirEntry *entries, const ArcLimits *limits) {
+    size_t chunk_count = (count + ZIP_CD_CHUNK - 1) / ZIP_CD_CHUNK;
+    size_t *chunk_offsets = malloc((chunk_count ? chunk_count : 1) * sizeof(size_t));
+    int *errors = calloc(chunk_count ? chunk_count : 1, sizeof(int));
+    if (!chunk_offsets || !errors) {
+        free(chunk_offsets);
+        free(errors);
+        errno = ENOMEM;
+        return -1;
+    }
+    
+    size_t pos = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (size - pos < ZIP_CD_HEADER_SIZE || read_le32(buf + pos) != ZIP_CENTRAL_DIR_SIG) {
+            free(chunk_offsets);
+            free(errors);
+            return 1;
+        }
+        if (i % ZIP_CD_CHUNK == 0) {
+            chunk_offsets[i / ZIP_CD_CHUNK] = pos;
+        }
+        size_t record = ZIP_CD_HEADER_SIZE + (size_t)read_le16(buf + pos + 28) +
+                        read_le16(buf + pos + 30) + read_le16(buf + pos + 32);
+        if (record > size - pos) {
+            free(chunk_offsets);
+            free(errors);
+            return 1;
+        }
+        pos += record;
+    }
+    
+    CentralDirDecode d = {
+        .buf = buf,
+        .chunk_offsets = chunk_offsets,
+        .chunk_count = chunk_count,
+        .count = count,
+        .entries = entries,
+        .limits = limits,
+        .errors = errors,
+    };
+    atomic_init(&d.next, 0);
+    
+    long threads = count >= ZIP_CD_PARALLEL_MIN ? sysconf(_SC_NPROCESSORS_ONLN) : 1;
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (threads > ZIP_CD_MAX_THREADS) {
+        threads = ZIP_CD_MAX_THREADS;
+    }
+    if ((size_t)threads > chunk_count) {
+        threads = (long)chunk_count;
+    }
+    pthread_t workers[ZIP_CD_MAX_THREADS];
+    long started = 0;
+    for (long i = 1; i < threads; i++) {
+        if (pthread_create(&workers[started], NULL, decode_central_dir_worker, &d) != 0) {
+            break;
+        }
+        started++;
+    }
+    decode_central_dir_worker(&d);
+    for (long i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    
+    // Report the first failing record's error, as a sequential decode would
+    int err = 0;
+    for (size_t c = 0; c < chunk_count && !err; c++) {
+        err = errors[c];
+    }
+    free(chunk_offsets);
+    free(errors);
+    if (err) {
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
 // Helper: Read all central directory entries
 static int read_central_directory(ArcStream *stream, int64_t offset, uint64_t count,
                                   int64_t stream_size, uint64_t central_dir_size,
@@ -538,6 +726,48 @@ static int read_central_directory(ArcStream *stream, int64_t offset, uint64_t co
         return -1;
     }
     
+    // Fast path: the whole directory (its size bounded by the file's above)
+    // in one read, then decoded in parallel chunks
+    if (stream_size >= 0 && central_dir_size > 0 && central_dir_size <= SIZE_MAX) {
+        uint8_t *buf = malloc((size_t)central_dir_size);
+        size_t have = 0;
+        while (buf && have < central_dir_size) {
+            ssize_t got = arc_stream_read(stream, buf + have, (size_t)central_dir_size - have);
+            if (got <= 0) {
+                break;
+            }
+            have += (size_t)got;
+        }
+        int rc = 1;
+        if (buf && have == central_dir_size) {
+            rc = decode_central_directory(buf, have, (size_t)count, entries, limits);
+        }
+        free(buf);
+        if (rc == 0) {
+            *entries_out = entries;
+            *count_out = (size_t)count;
+            return 0;
+        }
+        int saved = errno;
+        for (uint64_t i = 0; i < count; i++) {
+            free_central_dir_entry(&entries[i]);
+        }
+        if (rc < 0) {
+            free(entries);
+            errno = saved;
+            return -1;
+        }
+        // Records don't match the directory size: read them one by one.
+        // Rewinding first resets the stream's read budget, which the read
+        // above has spent on the same bytes.
+        memset(entries, 0, (size_t)count * sizeof(struct ZipCentralDirEntry));
+        if (arc_stream_seek(stream, 0, SEEK_SET) < 0 ||
+            arc_stream_seek(stream, offset, SEEK_SET) < 0) {
+            free(entries);
+            return -1;
+        }
+    }
+    
     for (uint64_t i = 0; i < count; i++) {
         if (read_central_dir_entry(stream, &entries[i], limits) < 0) {
             // Free what we've read so far
@@ -837,6 +1067,16 @@ static int zip_read_entry(ZipReader *reader) {
     
     struct ZipCentralDirEntry *cd_entry = &reader->entries[reader->current_entry_index];
     reader->current_entry_index++;
+    while (reader->filter && !reader->filter(cd_entry->filename, reader->filter_user)) {
+        if (reader->current_entry_index >= reader->entry_count) {
+            arc_entry_free(&reader->current_entry);
+            memset(&reader->current_entry, 0, sizeof(reader->current_entry));
+            reader->entry_valid = false;
+            reader->eof = true;
+            return 1;
+        }
+        cd_entry = &reader->entries[reader->current_entry_index++];
+    }
     
     // Free previous entry
     arc_entry_free(&reader->current_entry);
@@ -884,6 +1124,8 @@ static int zip_read_entry(ZipReader *reader) {
         reader->entry_uncompressed_size = cd_entry->uncompressed_size;
         reader->current_entry.size = cd_entry->uncompressed_size;
     }
+    reader->entry_header_offset = reader->entry_data_offset;
+    reader->entry_crc32 = cd_entry->crc32;
     reader->entry_compression_method = cd_entry->compression_method;
     reader->entry_flags = cd_entry->flags;
     reader->entry_valid = true;
@@ -1091,6 +1333,8 @@ static int zip_read_entry_streaming(ZipReader *reader) {
     }
     
     reader->current_entry.link_target = NULL;
+    reader->entry_header_offset = header_pos;
+    reader->entry_crc32 = cd_entry->crc32;
     reader->entry_compression_method = cd_entry->compression_method;
     reader->entry_flags = cd_entry->flags;
     reader->entry_valid = true;
@@ -1120,69 +1364,96 @@ int arc_zip_next(ArcReader *reader, ArcEntry *entry) {
     return ret;
 }
 
-ArcStream *arc_zip_open_data(ArcReader *reader) {
-    if (!reader) {
-        return NULL;
-    }
-    ZipReader *zip = (ZipReader *)reader;
-    if (!zip->entry_valid || zip->entry_data_remaining == 0) {
-        return NULL;
+int64_t arc_zip_data_offset(ArcStream *stream, const ArcEntryLocation *loc) {
+    if (!stream || !loc) {
+        errno = EINVAL;
+        return -1;
     }
     
     // Seek to local file header
-    if (arc_stream_seek(zip->base.stream, zip->entry_data_offset, SEEK_SET) < 0) {
-        return NULL;
+    if (arc_stream_seek(stream, loc->offset, SEEK_SET) < 0) {
+        return -1;
     }
     
     // Read local file header
     uint8_t header[30];
-    ssize_t n = arc_stream_read(zip->base.stream, header, sizeof(header));
+    ssize_t n = arc_stream_read(stream, header, sizeof(header));
     if (n != sizeof(header)) {
-        return NULL;
+        errno = EIO;
+        return -1;
     }
     
     uint32_t sig = read_le32(header);
     if (sig != ZIP_LOCAL_FILE_HEADER_SIG) {
-        return NULL;
+        errno = EINVAL;
+        return -1;
     }
     
+    // Data follows the filename and extra field (local lengths may differ from the central directory)
     uint16_t filename_length = read_le16(header + 26);
     uint16_t extra_field_length = read_le16(header + 28);
-    
-    // Skip filename and extra field
-    int64_t skip = filename_length + extra_field_length;
-    if (arc_stream_seek(zip->base.stream, skip, SEEK_CUR) < 0) {
+    return loc->offset + (int64_t)sizeof(header) + filename_length + extra_field_length;
+}
+
+ArcStream *arc_zip_open_location(ArcStream *stream, const ArcEntryLocation *loc, const ArcLimits *limits) {
+    if (!stream || !loc) {
         return NULL;
     }
     
-    // Get current position (start of file data)
-    int64_t data_start = arc_stream_tell(zip->base.stream);
+    int64_t data_start = arc_zip_data_offset(stream, loc);
+    if (data_start < 0) {
+        return NULL;
+    }
     
     // When bit 3 (data descriptor) is set, local header sizes are unreliable
-    // Use central directory sizes (which we already have in entry_data_remaining)
+    // Use central directory sizes (which the caller passes in stored_size)
     // The substream will use the correct size from central directory
-    ArcStream *data_stream = arc_stream_substream(zip->base.stream, data_start, zip->entry_data_remaining);
+    ArcStream *data_stream = arc_stream_substream(stream, data_start, (int64_t)loc->stored_size);
     if (!data_stream) {
         return NULL;
     }
     
     // Wrap with decompression filter if needed
-    if (zip->entry_compression_method == ZIP_METHOD_DEFLATE) {
+    if (loc->method == ZIP_METHOD_DEFLATE) {
         // ZIP uses raw deflate (not gzip-wrapped)
-        int64_t out_limit = zip->entry_uncompressed_size;
-        if (zip->base.limits && zip->base.limits->max_uncompressed_bytes > 0) {
-            if (out_limit <= 0 || (uint64_t)out_limit > zip->base.limits->max_uncompressed_bytes) {
-                out_limit = (int64_t)zip->base.limits->max_uncompressed_bytes;
+        int64_t out_limit = (int64_t)loc->size;
+        if (limits && limits->max_uncompressed_bytes > 0) {
+            if (out_limit <= 0 || (uint64_t)out_limit > limits->max_uncompressed_bytes) {
+                out_limit = (int64_t)limits->max_uncompressed_bytes;
+            }
+        }
+        ArcStream *decompressed = NULL;
+        // Whole-buffer backends (libdeflate) decode the entry in one call
+        // when both sizes are known and the result fits the output limit
+        const ArcCodecBackend *backend = arc_codec_selected(ARC_CODEC_DEFLATE);
+        if (backend && (backend->flags & ARC_CODEC_PREFER_ONESHOT) &&
+            loc->stored_size > 0 && loc->size <= ARC_CODEC_ONESHOT_MAX &&
+            loc->stored_size <= ARC_CODEC_ONESHOT_MAX &&
+            (out_limit <= 0 || loc->size <= (uint64_t)out_limit)) {
+            decompressed = arc_codec_oneshot(data_stream, ARC_CODEC_DEFLATE, NULL, 0,
+                                             (size_t)loc->stored_size, (size_t)loc->size, true);
+            if (decompressed) {
+                return decompressed;
             }
+            // Sizes disagree with the data: stream it and let that report errors
+            if (arc_stream_seek(data_stream, 0, SEEK_SET) < 0) {
+                arc_stream_close(data_stream);
+                return NULL;
+            }
+        }
+        if (arc_parallel_inflate_worthwhile((int64_t)loc->stored_size)) {
+            decompressed = arc_filter_deflate_parallel_owned(data_stream, out_limit, NULL);
+        }
+        if (!decompressed) {
+            decompressed = arc_filter_deflate_owned(data_stream, out_limit);
         }
-        ArcStream *decompressed = arc_filter_deflate(data_stream, out_limit);
         if (decompressed) {
             return decompressed;
         }
         // Fall through to return compressed stream if filter fails
         arc_stream_close(data_stream);
         return NULL;
-    } else if (zip->entry_compression_method != ZIP_METHOD_STORE) {
+    } else if (loc->method != ZIP_METHOD_STORE) {
         // Unsupported compression method
         arc_stream_close(data_stream);
         return NULL;
@@ -1191,6 +1462,44 @@ ArcStream *arc_zip_open_data(ArcReader *reader) {
     return data_stream;
 }
 
+int arc_zip_entry_location(ArcReader *reader, ArcEntryLocation *loc) {
+    if (!reader || !loc) {
+        return -1;
+    }
+    ZipReader *zip = (ZipReader *)reader;
+    if (!zip->entry_valid) {
+        errno = EINVAL;
+        return -1;
+    }
+    memset(loc, 0, sizeof(*loc));
+    loc->format = ARC_FORMAT_ZIP;
+    loc->compression = -1;
+    loc->method = zip->entry_compression_method;
+    loc->flags = zip->entry_flags;
+    loc->offset = zip->entry_header_offset;
+    loc->stored_size = (uint64_t)zip->entry_data_remaining;
+    loc->size = zip->entry_uncompressed_size;
+    loc->crc32 = zip->entry_crc32;
+    loc->has_crc = !(zip->entry_flags & ZIP_FLAG_DATA_DESCRIPTOR) || !zip->streaming_mode;
+    return 0;
+}
+
+ArcStream *arc_zip_open_data(ArcReader *reader) {
+    if (!reader) {
+        return NULL;
+    }
+    ZipReader *zip = (ZipReader *)reader;
+    if (!zip->entry_valid || zip->entry_data_remaining == 0) {
+        return NULL;
+    }
+    
+    ArcEntryLocation loc;
+    if (arc_zip_entry_location(reader, &loc) < 0) {
+        return NULL;
+    }
+    return arc_zip_open_location(zip->base.stream, &loc, zip->base.limits);
+}
+
 int arc_zip_skip_data(ArcReader *reader) {
     if (!reader) {
         return -1;
@@ -1205,6 +1514,143 @@ int arc_zip_skip_data(ArcReader *reader) {
     return 0;
 }
 
+// Helper: Wrap a freshly read central directory for sharing with clones
+static ZipSharedDir *shared_dir_new(struct ZipCentralDirEntry *entries, size_t count) {
+    ZipSharedDir *dir = calloc(1, sizeof(ZipSharedDir));
+    if (!dir) {
+        return NULL;
+    }
+    atomic_init(&dir->refs, 1);
+    dir->entries = entries;
+    dir->count = count;
+    dir->bytes = sizeof(ZipSharedDir) + count * sizeof(struct ZipCentralDirEntry);
+    for (size_t i = 0; i < count; i++) {
+        dir->bytes += (size_t)entries[i].filename_length + entries[i].extra_field_length +
+                      entries[i].comment_length + 3;
+    }
+    return dir;
+}
+
+int arc_zip_rewind(ArcReader *reader) {
+    if (!reader) {
+        return -1;
+    }
+    ZipReader *zip = (ZipReader *)reader;
+    // Seeking to 0 also resets the stream's byte budget for the new pass
+    if (arc_stream_seek(zip->base.stream, 0, SEEK_SET) < 0) {
+        return -1;
+    }
+    arc_entry_free(&zip->current_entry);
+    zip->entry_valid = false;
+    zip->entry_data_remaining = 0;
+    zip->eof = false;
+    zip->current_entry_index = 0;
+    zip->stream_pos = 0;
+    if (zip->stream_entries) {
+        for (size_t i = 0; i < zip->stream_entry_count; i++) {
+            free_central_dir_entry(&zip->stream_entries[i]);
+        }
+        zip->stream_entry_count = 0;
+    }
+    return 0;
+}
+
+ArcReader *arc_zip_clone(ArcReader *reader, ArcStream *stream) {
+    if (!reader || !stream) {
+        errno = EINVAL;
+        return NULL;
+    }
+    ZipReader *src = (ZipReader *)reader;
+    if (src->streaming_mode || !src->shared_dir) {
+        // Nothing parsed up front to share; the caller should reopen instead
+        errno = ENOTSUP;
+        return NULL;
+    }
+    ZipReader *zip = calloc(1, sizeof(ZipReader));
+    if (!zip) {
+        return NULL;
+    }
+    zip->base.format = ARC_FORMAT_ZIP;
+    zip->base.stream = stream;
+    arc_reader_set_limits(&zip->base, src->base.limits);
+    zip->streaming_mode = false;
+    zip->central_dir_offset = src->central_dir_offset;
+    atomic_fetch_add(&src->shared_dir->refs, 1);
+    zip->shared_dir = src->shared_dir;
+    zip->entries = src->shared_dir->entries;
+    zip->entry_count = src->shared_dir->count;
+    return (ArcReader *)zip;
+}
+
+int arc_zip_set_filter(ArcReader *reader, bool (*filter)(const char *name, void *user), void *user) {
+    if (!reader || arc_reader_format(reader) != ARC_FORMAT_ZIP) {
+        errno = EINVAL;
+        return -1;
+    }
+    ZipReader *zip = (ZipReader *)reader;
+    if (zip->streaming_mode && filter) {
+        errno = ENOTSUP;
+        return -1;
+    }
+    zip->filter = filter;
+    zip->filter_user = user;
+    return 0;
+}
+
+int arc_zip_directory(ArcReader *reader, size_t *count, int64_t *offset) {
+    if (!reader || !count || !offset) {
+        errno = EINVAL;
+        return -1;
+    }
+    ZipReader *zip = (ZipReader *)reader;
+    if (zip->streaming_mode) {
+        errno = ENOTSUP;
+        return -1;
+    }
+    *count = zip->entry_count;
+    *offset = zip->central_dir_offset;
+    return 0;
+}
+
+int arc_zip_dir_record(ArcReader *reader, size_t index, ArcZipDirRecord *rec) {
+    if (!reader || !rec) {
+        errno = EINVAL;
+        return -1;
+    }
+    ZipReader *zip = (ZipReader *)reader;
+    if (zip->streaming_mode || index >= zip->entry_count) {
+        errno = EINVAL;
+        return -1;
+    }
+    const struct ZipCentralDirEntry *e = &zip->entries[index];
+    rec->name = e->filename ? e->filename : "";
+    rec->version_made_by = e->version_made_by;
+    rec->version_needed = e->version_needed;
+    rec->flags = e->flags;
+    rec->method = e->compression_method;
+    rec->dos_time = e->mod_time;
+    rec->dos_date = e->mod_date;
+    rec->crc32 = e->crc32;
+    rec->stored_size = e->has_zip64_fields ? e->zip64_compressed_size : e->compressed_size;
+    rec->size = e->has_zip64_fields ? e->zip64_uncompressed_size : e->uncompressed_size;
+    rec->offset = e->has_zip64_fields ? e->zip64_local_header_offset : e->local_header_offset;
+    rec->internal_attrs = e->internal_attrs;
+    rec->external_attrs = e->external_attrs;
+    rec->extra = e->extra_field;
+    rec->extra_len = e->extra_field ? e->extra_field_length : 0;
+    rec->comment = e->comment;
+    rec->comment_len = e->comment ? e->comment_length : 0;
+    return 0;
+}
+
+size_t arc_zip_metadata_size(ArcReader *reader) {
+    if (!reader) {
+        return 0;
+    }
+    ZipReader *zip = (ZipReader *)reader;
+    return sizeof(ZipReader) + (zip->shared_dir ? zip->shared_dir->bytes : 0);
+}
+
 void arc_zip_close(ArcReader *reader) {
     if (!reader) {
         return;
@@ -1213,12 +1659,13 @@ void arc_zip_close(ArcReader *reader) {
     
     arc_entry_free(&zip->current_entry);
     
-    // Free central directory entries
-    if (zip->entries) {
-        for (size_t i = 0; i < zip->entry_count; i++) {
-            free_central_dir_entry(&zip->entries[i]);
+    // Drop our reference to the central directory (clones may still use it)
+    if (zip->shared_dir && atomic_fetch_sub(&zip->shared_dir->refs, 1) == 1) {
+        for (size_t i = 0; i < zip->shared_dir->count; i++) {
+            free_central_dir_entry(&zip->shared_dir->entries[i]);
         }
-        free(zip->entries);
+        free(zip->shared_dir->entries);
+        free(zip->shared_dir);
     }
     
     // Free streaming entries
@@ -1256,7 +1703,7 @@ ArcReader *arc_zip_open_ex(ArcStream *stream, const ArcLimits *limits) {
     
     zip->base.format = ARC_FORMAT_ZIP;
     zip->base.stream = stream;
-    zip->base.limits = limits;
+    arc_reader_set_limits(&zip->base, limits);
     zip->entry_valid = false;
     zip->eof = false;
     zip->current_entry_index = 0;
@@ -1269,6 +1716,7 @@ ArcReader *arc_zip_open_ex(ArcStream *stream, const ArcLimits *limits) {
     // Try to find End of Central Directory (for fast listing)
     struct ZipEOCD eocd;
     struct Zip64EOCDRecord eocd64;
+    memset(&eocd, 0, sizeof(eocd)); // find_eocd() may fail before setting the comment
     memset(&eocd64, 0, sizeof(eocd64));
     
     int eocd_found = find_eocd(stream, &eocd, &eocd64, limits);
@@ -1299,6 +1747,16 @@ ArcReader *arc_zip_open_ex(ArcStream *stream, const ArcLimits *limits) {
             free(zip);
             return NULL;
         }
+        zip->shared_dir = shared_dir_new(zip->entries, zip->entry_count);
+        if (!zip->shared_dir) {
+            for (size_t i = 0; i < zip->entry_count; i++) {
+                free_central_dir_entry(&zip->entries[i]);
+            }
+            free(zip->entries);
+            free(eocd.comment);
+            free(zip);
+            return NULL;
+        }
     } else {
         // Central directory not found - use streaming mode
         zip->streaming_mode = true;
@@ -3,6 +3,7 @@
 
 #include "arc_reader.h"
 #include "arc_stream.h"
+#include "arc_base.h"
 
 /**
  * ZIP format implementation.
@@ -46,5 +47,105 @@ ArcStream *arc_zip_open_data(ArcReader *reader);
 int arc_zip_skip_data(ArcReader *reader);
 void arc_zip_close(ArcReader *reader);
 
+/**
+ * Describe where the current entry lives (local header offset, method, sizes, CRC).
+ */
+int arc_zip_entry_location(ArcReader *reader, ArcEntryLocation *loc);
+
+/**
+ * Offset of an entry's data, read from the local header at loc->offset.
+ *
+ * @return Data offset, or -1 on error
+ */
+int64_t arc_zip_data_offset(ArcStream *stream, const ArcEntryLocation *loc);
+
+/**
+ * Open an entry's data directly from its location, without a ZipReader.
+ * Reads the local header at loc->offset and wraps the data in a deflate
+ * filter when needed.
+ *
+ * @param stream Seekable archive stream (must remain valid for the returned stream's lifetime)
+ * @param loc Location from arc_zip_entry_location()
+ * @param limits Limits for the decompressed size (may be NULL)
+ * @return Stream for the entry data, or NULL on error
+ */
+ArcStream *arc_zip_open_location(ArcStream *stream, const ArcEntryLocation *loc, const ArcLimits *limits);
+
+/**
+ * Restart iteration from the first entry (central directory mode reuses the
+ * parsed directory; streaming mode re-parses local headers from offset 0).
+ *
+ * @return 0 on success, -1 if the stream cannot seek back
+ */
+int arc_zip_rewind(ArcReader *reader);
+
+/**
+ * Create an independent cursor over the same archive.
+ * The clone shares the parsed central directory (refcounted) and reads
+ * from its own stream, so it can be used concurrently with the original.
+ *
+ * @param reader ZIP reader opened in central directory mode
+ * @param stream New stream over the same archive (owned by the clone)
+ * @return New reader, or NULL on error (ENOTSUP in streaming mode)
+ */
+ArcReader *arc_zip_clone(ArcReader *reader, ArcStream *stream);
+
+/**
+ * One central directory record as stored, for rewriting the directory of
+ * an existing archive (see arc_zip_writer_open()). ZIP64 values are
+ * already resolved. Pointers stay valid while the reader is open.
+ */
+typedef struct ArcZipDirRecord {
+    const char *name;
+    uint16_t version_made_by;
+    uint16_t version_needed;
+    uint16_t flags;
+    uint16_t method;
+    uint16_t dos_time;
+    uint16_t dos_date;
+    uint32_t crc32;
+    uint64_t stored_size;
+    uint64_t size;
+    uint64_t offset;           // Local header offset
+    uint16_t internal_attrs;
+    uint32_t external_attrs;
+    const uint8_t *extra;      // Extra fields, ZIP64 included (may be NULL)
+    uint16_t extra_len;
+    const char *comment;       // Entry comment (may be NULL)
+    uint16_t comment_len;
+} ArcZipDirRecord;
+
+/**
+ * Skip central directory records whose name the filter rejects: arc_next()
+ * never returns them and nothing is read for them. Not for readers with a
+ * listing recorder attached, which would record the filtered listing.
+ *
+ * @param reader ZIP reader
+ * @param filter Called with the stored name; true keeps the entry (NULL = no filter)
+ * @param user Passed to filter
+ * @return 0 on success, -1 on error (ENOTSUP in streaming mode)
+ */
+int arc_zip_set_filter(ArcReader *reader, bool (*filter)(const char *name, void *user), void *user);
+
+/**
+ * Size and position of the central directory a reader was opened with.
+ *
+ * @return 0 on success, -1 on error (ENOTSUP in streaming mode)
+ */
+int arc_zip_directory(ArcReader *reader, size_t *count, int64_t *offset);
+
+/**
+ * Central directory record `index` (0 <= index < count), independent of
+ * the reader's cursor.
+ *
+ * @return 0 on success, -1 on error
+ */
+int arc_zip_dir_record(ArcReader *reader, size_t index, ArcZipDirRecord *rec);
+
+/**
+ * Approximate heap footprint of the reader and its central directory.
+ */
+size_t arc_zip_metadata_size(ArcReader *reader);
+
 #endif // ARC_ZIP_H
 
@@ -0,0 +1,1172 @@
+#define _POSIX_C_SOURCE 200809L
+#include "arc_zip_writer.h"
+#include "arc_deflate_pool.h"
+#include "arc_stream.h"
+#include "arc_zip.h"
+#include "arc_base.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+// ZIP constants (must match arc_zip.c)
+#define ZIP_LOCAL_FILE_HEADER_SIG   0x04034b50
+#define ZIP_CENTRAL_DIR_SIG         0x02014b50
+#define ZIP_END_OF_CENTRAL_DIR_SIG  0x06054b50
+#define ZIP_END_OF_CENTRAL_DIR64_SIG 0x06064b50
+#define ZIP_END_OF_CENTRAL_DIR64_LOCATOR_SIG 0x07064b50
+#define ZIP_DATA_DESCRIPTOR_SIG     0x08074b50
+#define ZIP64_EXTRA_FIELD_ID 0x0001
+
+#define ZIP_FLAG_UTF8            0x0800
+
+#define ZIP_VERSION_MADE_BY 0x031E  // Unix, spec 3.0
+#define ZIP_VERSION_STORE   10
+#define ZIP_VERSION_DEFLATE 20
+#define ZIP_VERSION_ZIP64   45
+
+#define ZIP32_MAX 0xFFFFFFFFu
+#define ZIP16_MAX 0xFFFFu
+
+// Unix file type bits as stored in the external attributes (platform independent)
+#define UNIX_IFMT  0170000
+#define UNIX_IFDIR 0040000
+#define UNIX_IFREG 0100000
+#define UNIX_IFLNK 0120000
+
+#define NO_ENTRY SIZE_MAX
+
+#define DEFAULT_CHUNK_SIZE (1024 * 1024)
+#define MIN_CHUNK_SIZE (4 * 1024)
+#define MAX_CHUNK_SIZE (64 * 1024 * 1024)
+
+/**
+ * One archive entry, kept for the central directory.
+ */
+typedef struct ZipWriterEntry {
+    char *name;
+    uint32_t mode;
+    uint16_t dos_time;
+    uint16_t dos_date;
+    uint16_t method;
+    uint16_t flags;
+    bool local_zip64;      // Local header carries ZIP64 size fields
+    uint64_t offset;       // Local header offset
+    uint32_t crc;
+    uint64_t size;         // Uncompressed
+    uint64_t stored_size;  // Compressed
+    bool dead;             // Replaced or removed: left out of the central directory
+
+    // Kept from the directory of an archive opened for update
+    bool kept;
+    uint16_t made_by;
+    uint16_t min_version;
+    uint16_t internal_attrs;
+    uint32_t external_attrs;
+    uint8_t *extra;        // Extra fields without ZIP64 (rewritten as needed)
+    uint16_t extra_len;
+    char *comment;
+    uint16_t comment_len;
+} ZipWriterEntry;
+
+/**
+ * A chunk in flight: compressing on the pool, or waiting to be written.
+ */
+typedef struct ZipSlot {
+    ArcDeflateBlock block;
+    size_t entry;          // Index into entries
+    bool first;            // Write the local header before this chunk
+} ZipSlot;
+
+struct ArcZipWriter {
+    int fd;
+    bool seekable;
+    uint64_t pos;          // Absolute offset of the next byte written
+    int error;             // Sticky errno after a failure
+
+    bool store;
+    size_t chunk_size;
+    ArcDeflatePool *pool;
+
+    ZipSlot *slots;        // Ring of in-flight chunks, in archive order
+    size_t slot_count;
+    size_t slot_head;      // Oldest in-flight chunk
+    size_t in_flight;
+
+    ZipWriterEntry *entries;
+    size_t entry_count;
+    size_t entry_capacity;
+
+    // Update mode (arc_zip_writer_open())
+    bool update;
+    bool compact;
+    size_t *names;         // Open-addressing table of entry indexes keyed by name
+    size_t name_slots;     // Power of two
+    size_t name_count;
+};
+
+static void put16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static void put64(uint8_t *p, uint64_t v) {
+    put32(p, (uint32_t)v);
+    put32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint16_t get16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t *p) {
+    return (uint32_t)get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+static int fail(ArcZipWriter *w, int error) {
+    if (!w->error) {
+        w->error = error ? error : EIO;
+    }
+    errno = w->error;
+    return -1;
+}
+
+static int write_all(ArcZipWriter *w, const void *buf, size_t len) {
+    const uint8_t *p = buf;
+    while (len > 0) {
+        ssize_t n = write(w->fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return fail(w, errno);
+        }
+        p += n;
+        len -= (size_t)n;
+        w->pos += (uint64_t)n;
+    }
+    return 0;
+}
+
+static int pwrite_all(ArcZipWriter *w, const void *buf, size_t len, uint64_t offset) {
+    const uint8_t *p = buf;
+    while (len > 0) {
+        ssize_t n = pwrite(w->fd, p, len, (off_t)offset);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return fail(w, errno);
+        }
+        p += n;
+        len -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return 0;
+}
+
+static int pread_all(ArcZipWriter *w, void *buf, size_t len, uint64_t offset) {
+    uint8_t *p = buf;
+    while (len > 0) {
+        ssize_t n = pread(w->fd, p, len, (off_t)offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return fail(w, n < 0 ? errno : EIO);
+        }
+        p += n;
+        len -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return 0;
+}
+
+// Local time as DOS date/time, clamped to the representable 1980-2107 range
+static void dos_datetime(uint64_t mtime, uint16_t *date, uint16_t *time_out) {
+    time_t t = (time_t)mtime;
+    struct tm tm;
+    if (!localtime_r(&t, &tm) || tm.tm_year < 80) {
+        *date = (1 << 5) | 1;  // 1980-01-01
+        *time_out = 0;
+        return;
+    }
+    if (tm.tm_year > 207) {
+        tm.tm_year = 207;
+    }
+    *date = (uint16_t)(((tm.tm_year - 80) << 9) | ((tm.tm_mon + 1) << 5) | tm.tm_mday);
+    *time_out = (uint16_t)((tm.tm_hour << 11) | (tm.tm_min << 5) | (tm.tm_sec / 2));
+}
+
+static uint16_t version_needed(const ZipWriterEntry *e, bool zip64) {
+    if (zip64) {
+        return ZIP_VERSION_ZIP64;
+    }
+    return e->method == ZIP_METHOD_DEFLATE ? ZIP_VERSION_DEFLATE : ZIP_VERSION_STORE;
+}
+
+static int write_local_header(ArcZipWriter *w, ZipWriterEntry *e) {
+    size_t name_len = strlen(e->name);
+    uint8_t header[30 + 20];
+    memset(header, 0, sizeof(header));
+    e->offset = w->pos;
+
+    put32(header, ZIP_LOCAL_FILE_HEADER_SIG);
+    put16(header + 4, version_needed(e, e->local_zip64));
+    put16(header + 6, e->flags);
+    put16(header + 8, e->method);
+    put16(header + 10, e->dos_time);
+    put16(header + 12, e->dos_date);
+    // CRC and sizes are known up front only for raw entries; otherwise they
+    // are still zero here and get patched in later, or follow in a data descriptor
+    put32(header + 14, e->crc);
+    if (e->local_zip64) {
+        put32(header + 18, ZIP32_MAX);
+        put32(header + 22, ZIP32_MAX);
+    } else {
+        put32(header + 18, (uint32_t)e->stored_size);
+        put32(header + 22, (uint32_t)e->size);
+    }
+    put16(header + 26, (uint16_t)name_len);
+    put16(header + 28, e->local_zip64 ? 20 : 0);
+    if (write_all(w, header, 30) < 0 || write_all(w, e->name, name_len) < 0) {
+        return -1;
+    }
+    if (e->local_zip64) {
+        put16(header + 30, ZIP64_EXTRA_FIELD_ID);
+        put16(header + 32, 16);
+        put64(header + 34, e->size);
+        put64(header + 42, e->stored_size);
+        return write_all(w, header + 30, 20);
+    }
+    return 0;
+}
+
+/**
+ * Record an entry's CRC and sizes after its data: patch the local header,
+ * or append a data descriptor when the output can't seek.
+ */
+static int finish_entry(ArcZipWriter *w, ZipWriterEntry *e) {
+    bool big = e->size >= ZIP32_MAX || e->stored_size >= ZIP32_MAX;
+    if (big && !e->local_zip64) {
+        return fail(w, EFBIG);
+    }
+
+    uint8_t buf[24];
+    if (e->flags & ZIP_FLAG_DATA_DESCRIPTOR) {
+        put32(buf, ZIP_DATA_DESCRIPTOR_SIG);
+        put32(buf + 4, e->crc);
+        if (e->local_zip64) {
+            put64(buf + 8, e->stored_size);
+            put64(buf + 16, e->size);
+            return write_all(w, buf, 24);
+        }
+        put32(buf + 8, (uint32_t)e->stored_size);
+        put32(buf + 12, (uint32_t)e->size);
+        return write_all(w, buf, 16);
+    }
+
+    put32(buf, e->crc);
+    if (e->local_zip64) {
+        if (pwrite_all(w, buf, 4, e->offset + 14) < 0) {
+            return -1;
+        }
+        put64(buf, e->size);
+        put64(buf + 8, e->stored_size);
+        return pwrite_all(w, buf, 16, e->offset + 30 + strlen(e->name) + 4);
+    }
+    put32(buf + 4, (uint32_t)e->stored_size);
+    put32(buf + 8, (uint32_t)e->size);
+    return pwrite_all(w, buf, 12, e->offset + 14);
+}
+
+/**
+ * Wait for the oldest chunk in flight and write it out.
+ */
+static int retire_slot(ArcZipWriter *w) {
+    ZipSlot *slot = &w->slots[w->slot_head];
+    w->slot_head = (w->slot_head + 1) % w->slot_count;
+    w->in_flight--;
+
+    int rc = arc_deflate_pool_wait(w->pool, &slot->block);
+    if (w->error) {
+        return -1;
+    }
+    if (rc < 0) {
+        return fail(w, errno);
+    }
+    ZipWriterEntry *e = &w->entries[slot->entry];
+    if (slot->first && write_local_header(w, e) < 0) {
+        return -1;
+    }
+    if (write_all(w, slot->block.out, slot->block.out_len) < 0) {
+        return -1;
+    }
+    e->crc = (uint32_t)crc32_combine(e->crc, slot->block.crc, (z_off_t)slot->block.in_len);
+    e->size += slot->block.in_len;
+    e->stored_size += slot->block.out_len;
+    if (slot->block.last) {
+        return finish_entry(w, e);
+    }
+    return 0;
+}
+
+/**
+ * Claim the next free slot, writing out the oldest chunk if all are busy.
+ */
+static ZipSlot *claim_slot(ArcZipWriter *w) {
+    if (w->in_flight == w->slot_count && retire_slot(w) < 0) {
+        return NULL;
+    }
+    ZipSlot *slot = &w->slots[(w->slot_head + w->in_flight) % w->slot_count];
+    w->in_flight++;
+    slot->block.in_len = 0;
+    slot->block.dict_len = 0;
+    slot->block.last = false;
+    slot->block.store = w->store;
+    slot->first = false;
+    return slot;
+}
+
+/**
+ * Fill a slot with up to chunk_size bytes from the stream.
+ */
+static int fill_slot(ArcZipWriter *w, ZipSlot *slot, ArcStream *data) {
+    ArcDeflateBlock *b = &slot->block;
+    if (!b->in) {
+        b->in = malloc(w->chunk_size);
+        if (!b->in) {
+            return fail(w, ENOMEM);
+        }
+        b->in_capacity = w->chunk_size;
+    }
+    while (data && b->in_len < w->chunk_size) {
+        ssize_t n = arc_stream_read(data, b->in + b->in_len, w->chunk_size - b->in_len);
+        if (n < 0) {
+            return fail(w, errno);
+        }
+        if (n == 0) {
+            break;
+        }
+        b->in_len += (size_t)n;
+    }
+    return 0;
+}
+
+static uint64_t name_hash(const char *name) {
+    // FNV-1a
+    uint64_t h = 1469598103934665603ULL;
+    for (; *name; name++) {
+        h ^= (unsigned char)*name;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/**
+ * Slot of `name` in the name table, or of the empty slot where it would go.
+ */
+static size_t name_slot(const ArcZipWriter *w, const char *name) {
+    size_t pos = (size_t)name_hash(name) & (w->name_slots - 1);
+    while (w->names[pos] != NO_ENTRY && strcmp(w->entries[w->names[pos]].name, name) != 0) {
+        pos = (pos + 1) & (w->name_slots - 1);
+    }
+    return pos;
+}
+
+static int names_rehash(ArcZipWriter *w, size_t slot_count) {
+    size_t *names = malloc(slot_count * sizeof(*names));
+    if (!names) {
+        return fail(w, ENOMEM);
+    }
+    memset(names, 0xFF, slot_count * sizeof(*names));
+    size_t *old = w->names;
+    size_t old_slots = w->name_slots;
+    w->names = names;
+    w->name_slots = slot_count;
+    for (size_t i = 0; i < old_slots; i++) {
+        if (old[i] != NO_ENTRY) {
+            w->names[name_slot(w, w->entries[old[i]].name)] = old[i];
+        }
+    }
+    free(old);
+    return 0;
+}
+
+/**
+ * Make `index` the entry known by its name. An earlier entry of the same
+ * name (from the archive or added before) becomes dead space.
+ */
+static int names_put(ArcZipWriter *w, size_t index) {
+    if ((w->name_count + 1) * 2 > w->name_slots &&
+        names_rehash(w, w->name_slots ? w->name_slots * 2 : 1024) < 0) {
+        return -1;
+    }
+    size_t pos = name_slot(w, w->entries[index].name);
+    if (w->names[pos] == NO_ENTRY) {
+        w->name_count++;
+    } else {
+        w->entries[w->names[pos]].dead = true;
+    }
+    w->names[pos] = index;
+    return 0;
+}
+
+static ZipWriterEntry *new_entry(ArcZipWriter *w, const char *name, const ArcZipEntryInfo *info) {
+    if (w->entry_count == w->entry_capacity) {
+        size_t capacity = w->entry_capacity ? w->entry_capacity * 2 : 64;
+        ZipWriterEntry *entries = realloc(w->entries, capacity * sizeof(ZipWriterEntry));
+        if (!entries) {
+            fail(w, ENOMEM);
+            return NULL;
+        }
+        w->entries = entries;
+        w->entry_capacity = capacity;
+    }
+
+    uint32_t mode = info ? info->mode : 0;
+    if ((mode & UNIX_IFMT) == 0) {
+        mode |= UNIX_IFREG;
+    }
+    if ((mode & 07777) == 0) {
+        mode |= (mode & UNIX_IFMT) == UNIX_IFDIR ? 0755 : 0644;
+    }
+    bool is_dir = (mode & UNIX_IFMT) == UNIX_IFDIR;
+
+    size_t len = strlen(name);
+    bool add_slash = is_dir && (len == 0 || name[len - 1] != '/');
+    if (len + add_slash > ZIP16_MAX) {
+        fail(w, ENAMETOOLONG);
+        return NULL;
+    }
+    char *copy = malloc(len + 2);
+    if (!copy) {
+        fail(w, ENOMEM);
+        return NULL;
+    }
+    memcpy(copy, name, len);
+    if (add_slash) {
+        copy[len++] = '/';
+    }
+    copy[len] = '\0';
+
+    ZipWriterEntry *e = &w->entries[w->entry_count++];
+    memset(e, 0, sizeof(*e));
+    e->name = copy;
+    e->mode = mode;
+    // An mtime of 0 is the epoch (clamped to 1980 below), not "unset"
+    uint64_t mtime = info ? info->mtime : (uint64_t)time(NULL);
+    dos_datetime(mtime, &e->dos_date, &e->dos_time);
+    for (size_t i = 0; i < len; i++) {
+        if ((unsigned char)copy[i] >= 0x80) {
+            e->flags |= ZIP_FLAG_UTF8;
+            break;
+        }
+    }
+    if (!w->seekable) {
+        e->flags |= ZIP_FLAG_DATA_DESCRIPTOR;
+    }
+    uint64_t size = info ? info->size : 0;
+    e->local_zip64 = !is_dir && size >= ZIP32_MAX;
+    if (w->update && names_put(w, w->entry_count - 1) < 0) {
+        return NULL;
+    }
+    return e;
+}
+
+ArcZipWriter *arc_zip_writer_new(int fd) {
+    return arc_zip_writer_new_ex(fd, NULL);
+}
+
+ArcZipWriter *arc_zip_writer_new_ex(int fd, const ArcZipWriterOptions *opts) {
+    if (fd < 0 || (opts && (opts->level < 0 || opts->level > 9))) {
+        errno = EINVAL;
+        return NULL;
+    }
+    ArcZipWriter *w = calloc(1, sizeof(ArcZipWriter));
+    if (!w) {
+        return NULL;
+    }
+    w->fd = fd;
+    struct stat st;
+    off_t start = lseek(fd, 0, SEEK_CUR);
+    w->seekable = start >= 0 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+    w->pos = w->seekable ? (uint64_t)start : 0;
+
+    w->store = opts && opts->store;
+    w->chunk_size = opts && opts->chunk_size ? opts->chunk_size : DEFAULT_CHUNK_SIZE;
+    if (w->chunk_size < MIN_CHUNK_SIZE) {
+        w->chunk_size = MIN_CHUNK_SIZE;
+    } else if (w->chunk_size > MAX_CHUNK_SIZE) {
+        w->chunk_size = MAX_CHUNK_SIZE;
+    }
+    unsigned threads = opts && opts->threads ? opts->threads : arc_deflate_default_threads();
+    int level = opts && opts->level ? opts->level : Z_DEFAULT_COMPRESSION;
+
+    // Two chunks per thread keep the workers busy while one is written;
+    // at least two, since add_stream holds one back while reading the next
+    w->slot_count = threads > 1 ? 2 * (size_t)threads : 2;
+    w->slots = calloc(w->slot_count, sizeof(ZipSlot));
+    w->pool = w->slots ? arc_deflate_pool_new(threads > 1 ? threads : 0, level) : NULL;
+    if (!w->pool) {
+        int saved = errno ? errno : ENOMEM;
+        free(w->slots);
+        free(w);
+        errno = saved;
+        return NULL;
+    }
+    return w;
+}
+
+/**
+ * Keep an entry's extra fields except ZIP64, which is rewritten from the
+ * entry's current sizes and offset.
+ */
+static int keep_extra(ZipWriterEntry *e, const uint8_t *extra, size_t len) {
+    if (!extra || len == 0) {
+        return 0;
+    }
+    e->extra = malloc(len);
+    if (!e->extra) {
+        return -1;
+    }
+    size_t pos = 0;
+    while (pos + 4 <= len) {
+        size_t field_len = 4 + (size_t)get16(extra + pos + 2);
+        if (pos + field_len > len) {
+            break;
+        }
+        if (get16(extra + pos) != ZIP64_EXTRA_FIELD_ID) {
+            memcpy(e->extra + e->extra_len, extra + pos, field_len);
+            e->extra_len += (uint16_t)field_len;
+        }
+        pos += field_len;
+    }
+    return 0;
+}
+
+/**
+ * Take over the central directory of the archive at fd, so that new entries
+ * go where the directory was.
+ */
+static int load_directory(ArcZipWriter *w, int fd, int64_t size) {
+    ArcStream *stream = arc_stream_pread(fd, 0, size);
+    ArcReader *reader = stream ? arc_zip_open_ex(stream, NULL) : NULL;
+    if (!reader) {
+        arc_stream_close(stream);
+        return fail(w, errno ? errno : EINVAL);
+    }
+    size_t count;
+    int64_t cd_offset;
+    if (arc_zip_directory(reader, &count, &cd_offset) < 0) {
+        // No central directory to update (not a ZIP, or a damaged one)
+        arc_zip_close(reader);
+        return fail(w, EINVAL);
+    }
+
+    w->entries = calloc(count ? count : 1, sizeof(ZipWriterEntry));
+    if (!w->entries) {
+        arc_zip_close(reader);
+        return fail(w, ENOMEM);
+    }
+    w->entry_capacity = count ? count : 1;
+    for (size_t i = 0; i < count; i++) {
+        ArcZipDirRecord rec;
+        if (arc_zip_dir_record(reader, i, &rec) < 0) {
+            arc_zip_close(reader);
+            return fail(w, errno);
+        }
+        ZipWriterEntry *e = &w->entries[w->entry_count++];
+        e->name = strdup(rec.name);
+        e->comment = rec.comment_len ? malloc(rec.comment_len) : NULL;
+        if (!e->name || (rec.comment_len && !e->comment) || keep_extra(e, rec.extra, rec.extra_len) < 0) {
+            arc_zip_close(reader);
+            return fail(w, ENOMEM);
+        }
+        if (rec.comment_len) {
+            memcpy(e->comment, rec.comment, rec.comment_len);
+            e->comment_len = rec.comment_len;
+        }
+        e->kept = true;
+        e->made_by = rec.version_made_by;
+        e->min_version = rec.version_needed;
+        e->internal_attrs = rec.internal_attrs;
+        e->external_attrs = rec.external_attrs;
+        e->method = rec.method;
+        e->flags = rec.flags;
+        e->dos_time = rec.dos_time;
+        e->dos_date = rec.dos_date;
+        e->crc = rec.crc32;
+        e->size = rec.size;
+        e->stored_size = rec.stored_size;
+        e->offset = rec.offset;
+        if (names_put(w, i) < 0) {
+            arc_zip_close(reader);
+            return -1;
+        }
+    }
+    arc_zip_close(reader);
+
+    // New entries overwrite the old directory
+    if (lseek(fd, cd_offset, SEEK_SET) < 0) {
+        return fail(w, errno);
+    }
+    w->pos = (uint64_t)cd_offset;
+    return 0;
+}
+
+ArcZipWriter *arc_zip_writer_open(int fd, const ArcZipWriterOptions *opts) {
+    struct stat st;
+    if (fd < 0 || (opts && (opts->level < 0 || opts->level > 9))) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (fstat(fd, &st) < 0) {
+        return NULL;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        errno = ESPIPE;
+        return NULL;
+    }
+    if (lseek(fd, 0, SEEK_SET) < 0) {
+        return NULL;
+    }
+    ArcZipWriter *w = arc_zip_writer_new_ex(fd, opts);
+    if (!w) {
+        return NULL;
+    }
+    w->update = true;
+    w->compact = opts && opts->compact;
+    // An empty file simply becomes a new archive
+    if (st.st_size > 0 && load_directory(w, fd, (int64_t)st.st_size) < 0) {
+        int saved = w->error;
+        arc_zip_writer_free(w);
+        errno = saved;
+        return NULL;
+    }
+    return w;
+}
+
+int arc_zip_writer_remove(ArcZipWriter *w, const char *name) {
+    if (!w || !name) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!w->update) {
+        errno = ENOTSUP;
+        return -1;
+    }
+    if (w->error) {
+        errno = w->error;
+        return -1;
+    }
+    size_t index = NO_ENTRY;
+    if (w->name_slots > 0) {
+        index = w->names[name_slot(w, name)];
+        size_t len = strlen(name);
+        if (index == NO_ENTRY && len > 0 && name[len - 1] != '/') {
+            // A directory, named without its slash
+            char *dir = malloc(len + 2);
+            if (!dir) {
+                return fail(w, ENOMEM);
+            }
+            memcpy(dir, name, len);
+            memcpy(dir + len, "/", 2);
+            index = w->names[name_slot(w, dir)];
+            free(dir);
+        }
+    }
+    if (index == NO_ENTRY || w->entries[index].dead) {
+        errno = ENOENT;
+        return -1;
+    }
+    w->entries[index].dead = true;
+    return 0;
+}
+
+int arc_zip_writer_add_stream(ArcZipWriter *w, const char *name, ArcStream *data,
+                              const ArcZipEntryInfo *info) {
+    if (!w || !name) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (w->error) {
+        errno = w->error;
+        return -1;
+    }
+    ZipWriterEntry *e = new_entry(w, name, info);
+    if (!e) {
+        return -1;
+    }
+    size_t index = w->entry_count - 1;
+    bool is_dir = (e->mode & UNIX_IFMT) == UNIX_IFDIR;
+    if (!is_dir && info && info->size == ARC_ZIP_SIZE_UNKNOWN) {
+        e->local_zip64 = true;
+    }
+
+    // Hold each chunk back until the next read shows whether it is the last.
+    // Claimed slots that were never submitted are dropped again on error.
+    ZipSlot *cur = claim_slot(w);
+    if (!cur) {
+        return -1;
+    }
+    if (fill_slot(w, cur, is_dir ? NULL : data) < 0) {
+        w->in_flight--;
+        return -1;
+    }
+    cur->entry = index;
+    cur->first = true;
+    if (cur->block.in_len == 0) {
+        // Empty files and directories are stored: no deflate stream at all
+        ZipWriterEntry *ce = &w->entries[index];
+        ce->method = ZIP_METHOD_STORE;
+        ce->local_zip64 = false;
+        cur->block.store = true;
+        cur->block.last = true;
+        arc_deflate_pool_submit(w->pool, &cur->block);
+        return 0;
+    }
+    w->entries[index].method = w->store ? ZIP_METHOD_STORE : ZIP_METHOD_DEFLATE;
+
+    for (;;) {
+        ZipSlot *next = claim_slot(w);
+        if (!next) {
+            w->in_flight--;
+            return -1;
+        }
+        if (fill_slot(w, next, data) < 0) {
+            w->in_flight -= 2;
+            return -1;
+        }
+        if (next->block.in_len == 0) {
+            // Nothing more: give the slot back and finish with the held chunk
+            w->in_flight--;
+            cur->block.last = true;
+            arc_deflate_pool_submit(w->pool, &cur->block);
+            return 0;
+        }
+        next->entry = index;
+        arc_deflate_block_chain(&cur->block, &next->block);
+        arc_deflate_pool_submit(w->pool, &cur->block);
+        cur = next;
+    }
+}
+
+int arc_zip_writer_add_raw(ArcZipWriter *w, const char *name, ArcStream *raw,
+                           const ArcZipEntryInfo *info, const ArcZipRawInfo *raw_info) {
+    if (!w || !name || !raw || !raw_info) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (raw_info->method != ZIP_METHOD_STORE && raw_info->method != ZIP_METHOD_DEFLATE) {
+        errno = ENOTSUP;
+        return -1;
+    }
+    if (w->error) {
+        errno = w->error;
+        return -1;
+    }
+    if (info && (info->mode & UNIX_IFMT) == UNIX_IFDIR) {
+        errno = EINVAL;
+        return -1;
+    }
+    // Earlier entries come first in the archive
+    while (w->in_flight > 0) {
+        if (retire_slot(w) < 0) {
+            return -1;
+        }
+    }
+    ZipWriterEntry *e = new_entry(w, name, info);
+    if (!e) {
+        return -1;
+    }
+    // Everything is known up front: no patching and no data descriptor
+    e->method = raw_info->method;
+    e->flags &= (uint16_t)~ZIP_FLAG_DATA_DESCRIPTOR;
+    e->crc = raw_info->crc32;
+    e->size = raw_info->size;
+    e->stored_size = raw_info->stored_size;
+    e->local_zip64 = e->size >= ZIP32_MAX || e->stored_size >= ZIP32_MAX;
+    if (write_local_header(w, e) < 0) {
+        return -1;
+    }
+
+    // The ring is idle, so its first input buffer serves as the copy buffer
+    ArcDeflateBlock *b = &w->slots[w->slot_head].block;
+    if (!b->in) {
+        b->in = malloc(w->chunk_size);
+        if (!b->in) {
+            return fail(w, ENOMEM);
+        }
+        b->in_capacity = w->chunk_size;
+    }
+    uint64_t remaining = raw_info->stored_size;
+    while (remaining > 0) {
+        size_t want = remaining > w->chunk_size ? w->chunk_size : (size_t)remaining;
+        ssize_t n = arc_stream_read(raw, b->in, want);
+        if (n <= 0) {
+            // The header already promised stored_size bytes
+            return fail(w, n < 0 ? errno : EIO);
+        }
+        if (write_all(w, b->in, (size_t)n) < 0) {
+            return -1;
+        }
+        remaining -= (uint64_t)n;
+    }
+    return 0;
+}
+
+int arc_zip_writer_add_file(ArcZipWriter *w, const char *name, const char *path) {
+    if (!w || !path) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (w->error) {
+        errno = w->error;
+        return -1;
+    }
+    if (!name) {
+        name = path;
+        while (*name == '/' || (name[0] == '.' && name[1] == '/')) {
+            name += *name == '/' ? 1 : 2;
+        }
+    }
+
+    struct stat st;
+    if (lstat(path, &st) < 0) {
+        return -1;
+    }
+    ArcZipEntryInfo info;
+    memset(&info, 0, sizeof(info));
+    info.mode = (uint32_t)(st.st_mode & 07777);
+    info.mtime = st.st_mtime > 0 ? (uint64_t)st.st_mtime : 0;
+
+    if (S_ISDIR(st.st_mode)) {
+        info.mode |= UNIX_IFDIR;
+        return arc_zip_writer_add_stream(w, name, NULL, &info);
+    }
+    if (S_ISLNK(st.st_mode)) {
+        char target[4096];
+        ssize_t n = readlink(path, target, sizeof(target));
+        if (n < 0) {
+            return -1;
+        }
+        if ((size_t)n == sizeof(target)) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        ArcStream *data = arc_stream_from_memory(target, (size_t)n, 0);
+        if (!data) {
+            return -1;
+        }
+        info.mode |= UNIX_IFLNK;
+        info.size = (uint64_t)n;
+        int rc = arc_zip_writer_add_stream(w, name, data, &info);
+        arc_stream_close(data);
+        return rc;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        errno = ENOTSUP;
+        return -1;
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    ArcStream *data = arc_stream_from_fd(fd, 0);
+    if (!data) {
+        close(fd);
+        return -1;
+    }
+    info.mode |= UNIX_IFREG;
+    info.size = (uint64_t)st.st_size;
+    int rc = arc_zip_writer_add_stream(w, name, data, &info);
+    arc_stream_close(data);
+    return rc;
+}
+
+/**
+ * Bytes an entry takes in the archive: local header, data and data
+ * descriptor.
+ */
+static int record_length(ArcZipWriter *w, const ZipWriterEntry *e, uint64_t *len) {
+    uint8_t header[30];
+    if (pread_all(w, header, sizeof(header), e->offset) < 0) {
+        return -1;
+    }
+    if (get32(header) != ZIP_LOCAL_FILE_HEADER_SIG) {
+        return fail(w, EINVAL);
+    }
+    uint16_t name_len = get16(header + 26);
+    uint16_t extra_len = get16(header + 28);
+    *len = sizeof(header) + name_len + extra_len + e->stored_size;
+    if (!(e->flags & ZIP_FLAG_DATA_DESCRIPTOR)) {
+        return 0;
+    }
+
+    // The descriptor has 64-bit sizes if the local header has a ZIP64 field
+    bool zip64 = e->local_zip64;
+    if (e->kept && extra_len > 0) {
+        uint8_t *extra = malloc(extra_len);
+        if (!extra) {
+            return fail(w, ENOMEM);
+        }
+        if (pread_all(w, extra, extra_len, e->offset + sizeof(header) + name_len) < 0) {
+            free(extra);
+            return -1;
+        }
+        for (size_t pos = 0; pos + 4 <= extra_len; pos += 4 + (size_t)get16(extra + pos + 2)) {
+            if (get16(extra + pos) == ZIP64_EXTRA_FIELD_ID) {
+                zip64 = true;
+            }
+        }
+        free(extra);
+    }
+    // The descriptor signature is optional
+    uint8_t sig[4];
+    if (pread_all(w, sig, sizeof(sig), e->offset + *len) < 0) {
+        return -1;
+    }
+    *len += (get32(sig) == ZIP_DATA_DESCRIPTOR_SIG ? 4 : 0) + 4 + (zip64 ? 16 : 8);
+    return 0;
+}
+
+typedef struct ZipLiveEntry {
+    uint64_t offset;
+    size_t index;
+} ZipLiveEntry;
+
+static int compare_live_entries(const void *a, const void *b) {
+    uint64_t x = ((const ZipLiveEntry *)a)->offset;
+    uint64_t y = ((const ZipLiveEntry *)b)->offset;
+    return x < y ? -1 : (x > y);
+}
+
+/**
+ * Slide the live entries down, in file order, over any space no entry owns
+ * (left by entries replaced or removed in this or an earlier update), so
+ * the directory can follow the last of them. Every move goes to a lower
+ * offset, so a forward copy never overwrites data it still has to read.
+ */
+static int compact_entries(ArcZipWriter *w) {
+    uint64_t dst = w->pos;
+    size_t live = 0;
+    for (size_t i = 0; i < w->entry_count; i++) {
+        if (w->entries[i].offset < dst) {
+            dst = w->entries[i].offset;  // Anything before the first entry stays
+        }
+        live += !w->entries[i].dead;
+    }
+    ZipLiveEntry *order = malloc((live ? live : 1) * sizeof(ZipLiveEntry));
+    if (!order) {
+        return fail(w, ENOMEM);
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < w->entry_count; i++) {
+        if (!w->entries[i].dead) {
+            order[n].offset = w->entries[i].offset;
+            order[n++].index = i;
+        }
+    }
+    qsort(order, live, sizeof(ZipLiveEntry), compare_live_entries);
+
+    // The ring is idle, so its first input buffer serves as the copy buffer
+    ArcDeflateBlock *b = &w->slots[w->slot_head].block;
+    if (!b->in && (b->in = malloc(w->chunk_size)) != NULL) {
+        b->in_capacity = w->chunk_size;
+    }
+    int rc = b->in ? 0 : fail(w, ENOMEM);
+    for (size_t i = 0; rc == 0 && i < live; i++) {
+        ZipWriterEntry *e = &w->entries[order[i].index];
+        uint64_t len;
+        rc = record_length(w, e, &len);
+        for (uint64_t done = 0; rc == 0 && e->offset != dst && done < len;) {
+            size_t chunk = len - done > w->chunk_size ? w->chunk_size : (size_t)(len - done);
+            rc = pread_all(w, b->in, chunk, e->offset + done);
+            if (rc == 0) {
+                rc = pwrite_all(w, b->in, chunk, dst + done);
+            }
+            done += chunk;
+        }
+        if (rc == 0) {
+            e->offset = dst;
+            dst += len;
+        }
+    }
+    free(order);
+    if (rc < 0) {
+        return -1;
+    }
+    if (lseek(w->fd, (off_t)dst, SEEK_SET) < 0) {
+        return fail(w, errno);
+    }
+    w->pos = dst;
+    return 0;
+}
+
+static int write_central_directory(ArcZipWriter *w) {
+    uint64_t cd_start = w->pos;
+    uint64_t count = 0;
+    for (size_t i = 0; i < w->entry_count; i++) {
+        ZipWriterEntry *e = &w->entries[i];
+        if (e->dead) {
+            continue;
+        }
+        count++;
+        size_t name_len = strlen(e->name);
+
+        // ZIP64 extra: only the fields that overflow, in this order
+        uint8_t extra[4 + 24];
+        size_t extra_len = 0;
+        bool size64 = e->size >= ZIP32_MAX;
+        bool stored64 = e->stored_size >= ZIP32_MAX;
+        bool offset64 = e->offset >= ZIP32_MAX;
+        if (size64 || stored64 || offset64) {
+            extra_len = 4;
+            if (size64) {
+                put64(extra + extra_len, e->size);
+                extra_len += 8;
+            }
+            if (stored64) {
+                put64(extra + extra_len, e->stored_size);
+                extra_len += 8;
+            }
+            if (offset64) {
+                put64(extra + extra_len, e->offset);
+                extra_len += 8;
+            }
+            put16(extra, ZIP64_EXTRA_FIELD_ID);
+            put16(extra + 2, (uint16_t)(extra_len - 4));
+        }
+
+        // Other extra fields of a kept entry follow, if they still fit
+        uint16_t kept_len = extra_len + e->extra_len <= ZIP16_MAX ? e->extra_len : 0;
+        uint16_t needed = version_needed(e, extra_len > 0 || e->local_zip64);
+        if (e->kept && e->min_version > needed) {
+            needed = e->min_version;
+        }
+
+        uint8_t header[46];
+        memset(header, 0, sizeof(header));
+        put32(header, ZIP_CENTRAL_DIR_SIG);
+        put16(header + 4, e->kept ? e->made_by : ZIP_VERSION_MADE_BY);
+        put16(header + 6, needed);
+        put16(header + 8, e->flags);
+        put16(header + 10, e->method);
+        put16(header + 12, e->dos_time);
+        put16(header + 14, e->dos_date);
+        put32(header + 16, e->crc);
+        put32(header + 20, stored64 ? ZIP32_MAX : (uint32_t)e->stored_size);
+        put32(header + 24, size64 ? ZIP32_MAX : (uint32_t)e->size);
+        put16(header + 28, (uint16_t)name_len);
+        put16(header + 30, (uint16_t)(extra_len + kept_len));
+        put16(header + 32, e->comment_len);
+        if (e->kept) {
+            put16(header + 36, e->internal_attrs);
+            put32(header + 38, e->external_attrs);
+        } else {
+            // MS-DOS directory attribute alongside the Unix mode
+            uint32_t dos_attrs = (e->mode & UNIX_IFMT) == UNIX_IFDIR ? 0x10 : 0;
+            put32(header + 38, (e->mode << 16) | dos_attrs);
+        }
+        put32(header + 42, offset64 ? ZIP32_MAX : (uint32_t)e->offset);
+        if (write_all(w, header, sizeof(header)) < 0 || write_all(w, e->name, name_len) < 0 ||
+            write_all(w, extra, extra_len) < 0 || write_all(w, e->extra, kept_len) < 0 ||
+            write_all(w, e->comment, e->comment_len) < 0) {
+            return -1;
+        }
+    }
+    uint64_t cd_size = w->pos - cd_start;
+
+    if (count >= ZIP16_MAX || cd_size >= ZIP32_MAX || cd_start >= ZIP32_MAX) {
+        uint64_t eocd64_pos = w->pos;
+        uint8_t eocd64[56 + 20];
+        memset(eocd64, 0, sizeof(eocd64));
+        put32(eocd64, ZIP_END_OF_CENTRAL_DIR64_SIG);
+        put64(eocd64 + 4, 56 - 12);
+        put16(eocd64 + 12, ZIP_VERSION_MADE_BY);
+        put16(eocd64 + 14, ZIP_VERSION_ZIP64);
+        put64(eocd64 + 24, count);
+        put64(eocd64 + 32, count);
+        put64(eocd64 + 40, cd_size);
+        put64(eocd64 + 48, cd_start);
+        // Locator
+        put32(eocd64 + 56, ZIP_END_OF_CENTRAL_DIR64_LOCATOR_SIG);
+        put64(eocd64 + 64, eocd64_pos);
+        put32(eocd64 + 72, 1);
+        if (write_all(w, eocd64, sizeof(eocd64)) < 0) {
+            return -1;
+        }
+    }
+
+    uint8_t eocd[22];
+    memset(eocd, 0, sizeof(eocd));
+    put32(eocd, ZIP_END_OF_CENTRAL_DIR_SIG);
+    put16(eocd + 8, count >= ZIP16_MAX ? ZIP16_MAX : (uint16_t)count);
+    put16(eocd + 10, count >= ZIP16_MAX ? ZIP16_MAX : (uint16_t)count);
+    put32(eocd + 12, cd_size >= ZIP32_MAX ? ZIP32_MAX : (uint32_t)cd_size);
+    put32(eocd + 16, cd_start >= ZIP32_MAX ? ZIP32_MAX : (uint32_t)cd_start);
+    return write_all(w, eocd, sizeof(eocd));
+}
+
+int arc_zip_writer_finish(ArcZipWriter *w) {
+    if (!w) {
+        errno = EINVAL;
+        return -1;
+    }
+    while (w->in_flight > 0 && !w->error) {
+        retire_slot(w);
+    }
+    if (!w->error && w->update && w->compact) {
+        compact_entries(w);
+    }
+    if (!w->error && write_central_directory(w) == 0 && w->update) {
+        // Drop whatever of the old directory (or compacted data) lies beyond
+        if (ftruncate(w->fd, (off_t)w->pos) < 0) {
+            fail(w, errno);
+        }
+    }
+    int error = w->error;
+    arc_zip_writer_free(w);
+    if (error) {
+        errno = error;
+        return -1;
+    }
+    return 0;
+}
+
+void arc_zip_writer_free(ArcZipWriter *w) {
+    if (!w) {
+        return;
+    }
+    // Chunks still on the pool must finish before their buffers go away
+    while (w->in_flight > 0) {
+        ZipSlot *slot = &w->slots[w->slot_head];
+        arc_deflate_pool_wait(w->pool, &slot->block);
+        w->slot_head = (w->slot_head + 1) % w->slot_count;
+        w->in_flight--;
+    }
+    arc_deflate_pool_free(w->pool);
+    for (size_t i = 0; i < w->slot_count; i++) {
+        arc_deflate_block_release(&w->slots[i].block);
+    }
+    free(w->slots);
+    for (size_t i = 0; i < w->entry_count; i++) {
+        free(w->entries[i].name);
+        free(w->entries[i].extra);
+        free(w->entries[i].comment);
+    }
+    free(w->entries);
+    free(w->names);
+    free(w);
+}
@@ -0,0 +1,172 @@
+#ifndef ARC_ZIP_WRITER_H
+#define ARC_ZIP_WRITER_H
+
+#include "arc_stream.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * ZIP archive creation.
+ *
+ * Entry data is cut into chunks that a pool of threads deflates
+ * concurrently, while the calling thread reads input and writes finished
+ * chunks out in order. Chunks of one entry are chained pigz-style (each
+ * primed with the previous chunk's last 32 KiB and sync-flushed), so a
+ * large file compresses on every core yet is still one ordinary deflate
+ * stream; small files simply compress in parallel with each other.
+ *
+ * On a seekable descriptor each local header is patched with the CRC-32
+ * and sizes once its entry is written. On a pipe or socket, entries use a
+ * data descriptor (general purpose bit 3) instead. ZIP64 records are
+ * written wherever a size, offset or entry count needs them.
+ *
+ * An existing archive can be updated in place (arc_zip_writer_open()): new
+ * entries are written where its central directory was, and only the
+ * directory and end records are rewritten. Replaced and removed entries
+ * stay in the file as dead space until a compacting finish slides the
+ * live entries down over it.
+ */
+
+// ArcZipEntryInfo.size for a stream of unknown length
+#define ARC_ZIP_SIZE_UNKNOWN UINT64_MAX
+
+typedef struct ArcZipWriter ArcZipWriter;
+
+/**
+ * Writer options. A zeroed struct (or NULL) deflates at zlib's default
+ * level on one thread per online CPU.
+ */
+typedef struct ArcZipWriterOptions {
+    int level;          // Deflate level 1-9 (0 = zlib default)
+    bool store;         // Store entries uncompressed instead
+    unsigned threads;   // Compression threads (0 = one per online CPU, 1 = calling thread only)
+    size_t chunk_size;  // Input bytes per parallel chunk (0 = 1 MiB)
+    bool compact;       // arc_zip_writer_open() only: reclaim dead space on finish
+} ArcZipWriterOptions;
+
+/**
+ * Metadata for arc_zip_writer_add_stream().
+ */
+typedef struct ArcZipEntryInfo {
+    uint32_t mode;   // Unix mode with type bits: S_IFREG, S_IFDIR or S_IFLNK (0 = regular file, 0644)
+    uint64_t mtime;  // Modification time, also 0 (NULL info = now); stored as a DOS time, 2 s resolution, 1980 at the earliest
+    uint64_t size;   // Expected data size, if known. Streams that may exceed 4 GiB
+                     // need a size >= 4 GiB or ARC_ZIP_SIZE_UNKNOWN (reserves ZIP64 fields)
+} ArcZipEntryInfo;
+
+/**
+ * Already-compressed entry data for arc_zip_writer_add_raw(), e.g. copied
+ * from another ZIP archive.
+ */
+typedef struct ArcZipRawInfo {
+    uint16_t method;       // ZIP compression method of the data: 0 (store) or 8 (deflate)
+    uint32_t crc32;        // CRC-32 of the uncompressed data
+    uint64_t size;         // Uncompressed size
+    uint64_t stored_size;  // Bytes of compressed data to copy
+} ArcZipRawInfo;
+
+/**
+ * Create a writer on an open descriptor with default options.
+ *
+ * The archive starts at the descriptor's current offset; the descriptor is
+ * not closed by the writer.
+ *
+ * @return New writer, or NULL on error
+ */
+ArcZipWriter *arc_zip_writer_new(int fd);
+
+/**
+ * Create a writer with options (NULL = defaults).
+ */
+ArcZipWriter *arc_zip_writer_new_ex(int fd, const ArcZipWriterOptions *opts);
+
+/**
+ * Open an existing archive for update. The descriptor must be a regular
+ * file opened for reading and writing; an empty file becomes a new archive.
+ *
+ * The central directory is taken over as it is (names, attributes, extra
+ * fields and comments are kept; the archive comment is not). Entries added
+ * afterwards overwrite the old directory, and an entry added under an
+ * existing name replaces it. Until arc_zip_writer_finish() completes, the
+ * file has no valid directory.
+ *
+ * @param fd Archive file (not closed by the writer)
+ * @param opts Options (NULL = defaults, no compaction)
+ * @return New writer, or NULL on error (EINVAL if the file is not a ZIP
+ *         archive with a central directory, ESPIPE if not a regular file)
+ */
+ArcZipWriter *arc_zip_writer_open(int fd, const ArcZipWriterOptions *opts);
+
+/**
+ * Remove an entry from an archive opened with arc_zip_writer_open(). Its
+ * data becomes dead space (reclaimed by the compact option).
+ *
+ * @param writer The writer
+ * @param name Entry name (directories with or without the trailing '/')
+ * @return 0 on success, -1 on error (ENOENT if there is no such entry,
+ *         ENOTSUP for a writer that is not updating an archive)
+ */
+int arc_zip_writer_remove(ArcZipWriter *writer, const char *name);
+
+/**
+ * Add a file from the filesystem. Directories and symlinks (stored as
+ * their target, Info-ZIP style) are added as such; mode and mtime come
+ * from lstat().
+ *
+ * @param writer The writer
+ * @param name Entry name in the archive (NULL = path without leading '/' and "./")
+ * @param path File to add
+ * @return 0 on success, -1 on error (ENOTSUP for devices, FIFOs and sockets)
+ */
+int arc_zip_writer_add_file(ArcZipWriter *writer, const char *name, const char *path);
+
+/**
+ * Add an entry whose data is read from a stream until end of stream.
+ * Returns once all data has been read; compression may still be in
+ * progress. The stream is not closed.
+ *
+ * @param writer The writer
+ * @param name Entry name ('/' is appended for directories)
+ * @param data Entry data (ignored, may be NULL, for directories)
+ * @param info Entry metadata (NULL = regular file, current time)
+ * @return 0 on success, -1 on error (EFBIG if a stream outgrows 4 GiB
+ *         without reserved ZIP64 fields)
+ */
+int arc_zip_writer_add_stream(ArcZipWriter *writer, const char *name, ArcStream *data,
+                              const ArcZipEntryInfo *info);
+
+/**
+ * Add an entry whose data is already compressed. Exactly
+ * raw_info->stored_size bytes are copied from the stream as they are, with
+ * no decoding or CRC check; the local header carries the given CRC and
+ * sizes, so no data descriptor is needed even on a pipe. Entries added
+ * earlier are written out first. The stream is not closed.
+ *
+ * @param writer The writer
+ * @param name Entry name
+ * @param raw Compressed data
+ * @param info Entry metadata (NULL = regular file, current time; not a directory)
+ * @param raw_info Method, CRC-32 and sizes of the data
+ * @return 0 on success, -1 on error (ENOTSUP for other methods; a short
+ *         stream leaves a broken entry and fails the writer with EIO)
+ */
+int arc_zip_writer_add_raw(ArcZipWriter *writer, const char *name, ArcStream *raw,
+                           const ArcZipEntryInfo *info, const ArcZipRawInfo *raw_info);
+
+/**
+ * Write any pending entries and the central directory, then free the
+ * writer (also on failure). When updating an archive, the file is
+ * truncated after the new end record, and with the compact option the
+ * live entries are first moved down over the dead space.
+ *
+ * @return 0 on success, -1 if this or any earlier call failed
+ */
+int arc_zip_writer_finish(ArcZipWriter *writer);
+
+/**
+ * Free a writer without completing the archive.
+ */
+void arc_zip_writer_free(ArcZipWriter *writer);
+
+#endif // ARC_ZIP_WRITER_H
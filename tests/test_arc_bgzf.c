@@ -0,0 +1,388 @@
+#include "test_runner.h"
+#include "test_fixtures.h"
+#include "../cupidarchive.h"
+#include <errno.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#define DATA_SIZE (2 * 1024 * 1024 + 12345)
+#define BGZF_BLOCK_DATA 65280   // Input per block, as bgzip uses
+
+static uint8_t *data;
+
+typedef struct Bgzf {
+    uint8_t *buf;
+    size_t len;
+    size_t blocks;              // Including the empty EOF block
+} Bgzf;
+
+static void put16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+// One BGZF block holding `len` bytes; returns its size
+static size_t bgzf_block(const uint8_t *in, size_t len, uint8_t *out) {
+    static const uint8_t header[18] = {
+        0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0, 0, 0
+    };
+    memcpy(out, header, sizeof(header));
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    deflateInit2(&zs, 6, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    zs.next_in = (Bytef *)in;
+    zs.avail_in = (uInt)len;
+    zs.next_out = out + 18;
+    zs.avail_out = 65536 - 26;
+    deflate(&zs, Z_FINISH);
+    size_t size = 18 + zs.total_out + 8;
+    deflateEnd(&zs);
+    put32(out + size - 8, (uint32_t)crc32(0L, in, (uInt)len));
+    put32(out + size - 4, (uint32_t)len);
+    put16(out + 16, (uint16_t)(size - 1));
+    return size;
+}
+
+static Bgzf bgzf_compress(const uint8_t *in, size_t len) {
+    Bgzf z = {0};
+    z.buf = malloc((len / BGZF_BLOCK_DATA + 2) * 65536);
+    for (size_t off = 0; off < len; off += BGZF_BLOCK_DATA) {
+        size_t n = len - off < BGZF_BLOCK_DATA ? len - off : BGZF_BLOCK_DATA;
+        z.len += bgzf_block(in + off, n, z.buf + z.len);
+        z.blocks++;
+    }
+    z.len += bgzf_block(in, 0, z.buf + z.len);  // EOF marker
+    z.blocks++;
+    return z;
+}
+
+static bool read_all(ArcStream *s, uint8_t *out, size_t cap, size_t *len_out) {
+    size_t len = 0;
+    ssize_t n;
+    while (len < cap && (n = arc_stream_read(s, out + len, cap - len > 10000 ? 10000 : cap - len)) > 0) {
+        len += (size_t)n;
+    }
+    *len_out = len;
+    return arc_stream_read(s, out, 1) == 0;
+}
+
+static bool test_detect(void) {
+    Bgzf z = bgzf_compress(data, 1000);
+    size_t block_size = 0;
+    ASSERT_TRUE(arc_bgzf_detect(z.buf, z.len, &block_size), "BGZF header detected");
+    ASSERT_EQ(block_size, z.len - 28, "BSIZE gives the first block's size");
+    ASSERT_FALSE(arc_bgzf_detect(z.buf, 11, NULL), "Too short");
+
+    uint8_t gz[64];
+    uLongf gz_len = sizeof(gz);
+    ASSERT_EQ(compress2(gz, &gz_len, data, 10, 6), Z_OK, "zlib data");
+    ASSERT_FALSE(arc_bgzf_detect(gz, gz_len, NULL), "zlib stream is not BGZF");
+    uint8_t plain[18] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 3 };
+    ASSERT_FALSE(arc_bgzf_detect(plain, sizeof(plain), NULL), "gzip without FEXTRA");
+    free(z.buf);
+    return true;
+}
+
+// Sequential decode on 1 and 4 threads; the filter indexes every block
+static bool test_sequential(void) {
+    Bgzf z = bgzf_compress(data, DATA_SIZE);
+    uint8_t *out = malloc(DATA_SIZE + 1);
+    unsigned threads[] = { 1, 4 };
+    for (size_t t = 0; t < 2; t++) {
+        ArcStream *mem = arc_stream_from_memory(z.buf, z.len, 0);
+        ArcBgzfOptions opts = { .threads = threads[t] };
+        ArcStream *f = arc_filter_bgzf(mem, 0, &opts);
+        ASSERT_NOT_NULL(f, "Filter should open");
+        size_t len = 0;
+        ASSERT_TRUE(read_all(f, out, DATA_SIZE + 1, &len), "Reads to EOF");
+        ASSERT_EQ(len, DATA_SIZE, "Decoded size");
+        ASSERT_TRUE(memcmp(out, data, DATA_SIZE) == 0, "Decoded bytes");
+        ASSERT_EQ(arc_stream_tell(f), DATA_SIZE, "tell() at the end");
+
+        const ArcBgzfIndex *index = arc_filter_bgzf_index(f);
+        ASSERT_NOT_NULL(index, "Filter exposes its index");
+        ASSERT_TRUE(index->complete, "Index complete after EOF");
+        ASSERT_EQ(index->count, z.blocks, "One entry per block");
+        ASSERT_EQ(index->out_size, DATA_SIZE, "Uncompressed size");
+        ASSERT_EQ(index->in_size, z.len, "Compressed size");
+        arc_stream_close(f);
+        arc_stream_close(mem);
+    }
+    free(out);
+    free(z.buf);
+    return true;
+}
+
+static bool check_at(ArcStream *f, uint64_t offset, size_t n) {
+    uint8_t buf[3000];
+    size_t len = 0;
+    while (len < n) {
+        ssize_t got = arc_stream_read(f, buf + len, n - len);
+        if (got <= 0) {
+            break;
+        }
+        len += (size_t)got;
+    }
+    size_t expect = offset >= DATA_SIZE ? 0 : (DATA_SIZE - offset < n ? DATA_SIZE - offset : n);
+    ASSERT_EQ(len, expect, "Bytes after seek");
+    ASSERT_TRUE(len == 0 || memcmp(buf, data + offset, len) == 0, "Data after seek");
+    return true;
+}
+
+// Random access with and without a prebuilt index
+static bool test_seek(void) {
+    Bgzf z = bgzf_compress(data, DATA_SIZE);
+    ArcStream *mem = arc_stream_from_memory(z.buf, z.len, 0);
+    ArcBgzfIndex *built = arc_bgzf_index_build(mem);
+    ASSERT_NOT_NULL(built, "Index builds from block headers");
+    ASSERT_EQ(built->count, z.blocks, "Built index has every block");
+
+    for (int pass = 0; pass < 2; pass++) {
+        arc_stream_seek(mem, 0, SEEK_SET);
+        ArcBgzfOptions opts = { .threads = 3, .index = pass ? built : NULL };
+        ArcStream *f = arc_filter_bgzf(mem, 0, &opts);
+        ASSERT_NOT_NULL(f, "Filter should open");
+
+        static const uint64_t offsets[] = {
+            1500000, 10, 65280, 65279, DATA_SIZE - 5, 700000, 0, 65280 * 3 + 100
+        };
+        for (size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i++) {
+            ASSERT_EQ(arc_stream_seek(f, (int64_t)offsets[i], SEEK_SET), 0, "SEEK_SET");
+            ASSERT_EQ(arc_stream_tell(f), (int64_t)offsets[i], "tell() after seek");
+            ASSERT_TRUE(check_at(f, offsets[i], 2500), "Read after SEEK_SET");
+        }
+        // Inside the block being served, then relative and from the end
+        ASSERT_EQ(arc_stream_seek(f, 4000, SEEK_SET), 0, "SEEK_SET");
+        ASSERT_TRUE(check_at(f, 4000, 100), "Read");
+        ASSERT_EQ(arc_stream_seek(f, -50, SEEK_CUR), 0, "SEEK_CUR back");
+        ASSERT_TRUE(check_at(f, 4050, 100), "Read after SEEK_CUR");
+        ASSERT_EQ(arc_stream_seek(f, 200000, SEEK_CUR), 0, "SEEK_CUR forward");
+        ASSERT_TRUE(check_at(f, 204150, 100), "Read after SEEK_CUR forward");
+        ASSERT_EQ(arc_stream_seek(f, -1000, SEEK_END), 0, "SEEK_END");
+        ASSERT_EQ(arc_stream_tell(f), DATA_SIZE - 1000, "tell() after SEEK_END");
+        ASSERT_TRUE(check_at(f, DATA_SIZE - 1000, 2000), "Tail after SEEK_END");
+        ASSERT_EQ(arc_stream_seek(f, DATA_SIZE + 10, SEEK_SET), 0, "Past the end");
+        ASSERT_TRUE(check_at(f, DATA_SIZE + 10, 10), "Nothing past the end");
+        ASSERT_EQ(arc_stream_seek(f, -1, SEEK_SET), -1, "Negative offset");
+        ASSERT_TRUE(arc_filter_bgzf_index(f)->complete, "SEEK_END completes the index");
+        arc_stream_close(f);
+    }
+    arc_bgzf_index_free(built);
+    arc_stream_close(mem);
+    free(z.buf);
+    return true;
+}
+
+// .gzi round trip and virtual offsets
+static bool test_gzi(void) {
+    Bgzf z = bgzf_compress(data, DATA_SIZE);
+    ArcStream *mem = arc_stream_from_memory(z.buf, z.len, 0);
+    ArcBgzfIndex *index = arc_bgzf_index_build(mem);
+    ASSERT_NOT_NULL(index, "Index builds");
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/cupidarchive_bgzf_%ld.gzi", (long)getpid());
+    FILE *f = fopen(path, "wb");
+    ASSERT_EQ(arc_bgzf_index_write(index, f), 0, "Write .gzi");
+    fclose(f);
+    ArcBgzfIndex *loaded = arc_bgzf_index_load(path);
+    unlink(path);
+    ASSERT_NOT_NULL(loaded, "Load .gzi");
+    ASSERT_EQ(loaded->count, index->count, "Same block count");
+    ASSERT_FALSE(loaded->complete, ".gzi doesn't record the total size");
+    ASSERT_TRUE(memcmp(loaded->blocks, index->blocks, index->count * sizeof(ArcBgzfBlock)) == 0, "Same blocks");
+
+    uint64_t voff = 0;
+    ASSERT_EQ(arc_bgzf_virtual_offset(index, 65280 * 2 + 7, &voff), 0, "Virtual offset");
+    ASSERT_EQ(voff >> 16, index->blocks[2].in, "Block part");
+    ASSERT_EQ(voff & 0xffff, 7, "Within-block part");
+    ASSERT_EQ(arc_bgzf_virtual_offset(index, 0, &voff), 0, "Offset 0");
+    ASSERT_EQ(voff, 0, "Offset 0 is virtual offset 0");
+    errno = 0;
+    ASSERT_EQ(arc_bgzf_virtual_offset(index, DATA_SIZE + 1, &voff), -1, "Past the end");
+    ASSERT_EQ(errno, ERANGE, "ERANGE past the end");
+
+    uint8_t bad[24] = { 2 };
+    errno = 0;
+    ASSERT_NULL(arc_bgzf_index_parse(bad, sizeof(bad)), "Entry count disagrees with size");
+    ASSERT_EQ(errno, EINVAL, "Malformed .gzi sets EINVAL");
+
+    arc_bgzf_index_free(loaded);
+    arc_bgzf_index_free(index);
+    arc_stream_close(mem);
+    free(z.buf);
+    return true;
+}
+
+static bool test_corrupt(void) {
+    Bgzf z = bgzf_compress(data, DATA_SIZE);
+    uint8_t *out = malloc(DATA_SIZE);
+    size_t len = 0;
+
+    z.buf[z.len / 2] ^= 0x55;  // Inside some block's deflate data
+    ArcStream *mem = arc_stream_from_memory(z.buf, z.len, 0);
+    ArcStream *f = arc_filter_bgzf(mem, 0, NULL);
+    read_all(f, out, DATA_SIZE, &len);
+    errno = 0;
+    ASSERT_EQ(arc_stream_read(f, out, 100), -1, "Corrupt block fails");
+    ASSERT_EQ(errno, EINVAL, "Corruption sets EINVAL");
+    ASSERT_TRUE(len < DATA_SIZE, "Stops before the corrupt block's data");
+    arc_stream_close(f);
+    arc_stream_close(mem);
+    z.buf[z.len / 2] ^= 0x55;
+
+    mem = arc_stream_from_memory(z.buf, z.len - 28 - 1000, 0);
+    f = arc_filter_bgzf(mem, 0, NULL);
+    read_all(f, out, DATA_SIZE, &len);
+    errno = 0;
+    ASSERT_EQ(arc_stream_read(f, out, 100), -1, "Truncated block fails");
+    ASSERT_EQ(errno, EINVAL, "Truncation sets EINVAL");
+    arc_stream_close(f);
+    arc_stream_close(mem);
+
+    mem = arc_stream_from_memory(z.buf, z.len, 0);
+    f = arc_filter_bgzf(mem, 100000, NULL);
+    ASSERT_TRUE(read_all(f, out, DATA_SIZE, &len), "Limited read ends cleanly");
+    ASSERT_EQ(len, 100000, "Byte limit caps the output");
+    arc_stream_close(f);
+    arc_stream_close(mem);
+    free(out);
+    free(z.buf);
+    return true;
+}
+
+// The readers pick the BGZF filter for .gz and .tar.gz, with a .gzi sidecar
+static bool test_reader(void) {
+    char gz_path[64];
+    char tgz_path[64];
+    char gzi_path[80];
+    snprintf(gz_path, sizeof(gz_path), "/tmp/cupidarchive_bgzf_%ld.bin.gz", (long)getpid());
+    snprintf(tgz_path, sizeof(tgz_path), "/tmp/cupidarchive_bgzf_%ld.tar.gz", (long)getpid());
+    snprintf(gzi_path, sizeof(gzi_path), "%s.gzi", gz_path);
+
+    Bgzf z = bgzf_compress(data, DATA_SIZE);
+    ASSERT_TRUE(fixture_write_file(gz_path, z.buf, z.len), "Write .gz");
+    ArcStream *mem = arc_stream_from_memory(z.buf, z.len, 0);
+    ArcBgzfIndex *index = arc_bgzf_index_build(mem);
+    arc_stream_close(mem);
+    FILE *f = fopen(gzi_path, "wb");
+    ASSERT_EQ(arc_bgzf_index_write(index, f), 0, "Write .gzi");
+    fclose(f);
+    arc_bgzf_index_free(index);
+    free(z.buf);
+
+    uint8_t *out = malloc(DATA_SIZE + 1);
+    size_t len = 0;
+    ArcReader *r = arc_open_path(gz_path);
+    ASSERT_NOT_NULL(r, "Open BGZF .gz");
+    ArcEntry entry;
+    ASSERT_EQ(arc_next(r, &entry), 0, "Single entry");
+    ArcStream *s = arc_open_data(r);
+    ASSERT_NOT_NULL(s, "Entry data");
+    read_all(s, out, DATA_SIZE + 1, &len);
+    ASSERT_EQ(len, DATA_SIZE, "Whole file, not just the first member");
+    ASSERT_TRUE(memcmp(out, data, len) == 0, "File bytes");
+    arc_stream_close(s);
+    arc_entry_free(&entry);
+    arc_close(r);
+    unlink(gz_path);
+    unlink(gzi_path);
+
+    FixtureEntry entries[] = {
+        { "big.bin", data, DATA_SIZE - 1000, '0' },
+        { "dir", NULL, 0, '5' },
+        { "dir/small.txt", "bgzf tar", 8, '0' },
+    };
+    uint8_t *tar = NULL;
+    size_t tar_len = fixture_tar(entries, 3, &tar);
+    z = bgzf_compress(tar, tar_len);
+    ASSERT_TRUE(fixture_write_file(tgz_path, z.buf, z.len), "Write .tar.gz");
+    free(z.buf);
+    free(tar);
+
+    // Skip the big entry's data, then read the last one
+    r = arc_open_path(tgz_path);
+    ASSERT_NOT_NULL(r, "Open BGZF .tar.gz");
+    size_t count = 0;
+    while (arc_next(r, &entry) == 0) {
+        if (strcmp(entry.path, "dir/small.txt") == 0) {
+            s = arc_open_data(r);
+            read_all(s, out, DATA_SIZE, &len);
+            ASSERT_EQ(len, 8, "Small entry size");
+            ASSERT_TRUE(memcmp(out, "bgzf tar", 8) == 0, "Small entry bytes");
+            arc_stream_close(s);
+        }
+        arc_entry_free(&entry);
+        count++;
+    }
+    arc_close(r);
+    ASSERT_EQ(count, 3, "All TAR entries listed");
+    unlink(tgz_path);
+    free(out);
+    return true;
+}
+
+// Positional reads on a BGZF .tar.gz start at the block holding the offset,
+// for entries well past the first gzip member
+static bool test_entry_handles(void) {
+    char tgz_path[64];
+    snprintf(tgz_path, sizeof(tgz_path), "/tmp/cupidarchive_bgzf_h_%ld.tar.gz", (long)getpid());
+    FixtureEntry entries[] = {
+        { "f1.bin", data, 200000, '0' },
+        { "f2.txt", data + 200000, 150000, '0' },
+        { "f3.txt", "third", 5, '0' },
+    };
+    uint8_t *tar = NULL;
+    size_t tar_len = fixture_tar(entries, 3, &tar);
+    Bgzf z = bgzf_compress(tar, tar_len);
+    ASSERT_TRUE(fixture_write_file(tgz_path, z.buf, z.len), "Write .tar.gz");
+    free(z.buf);
+    free(tar);
+
+    ArcReader *r = arc_open_path(tgz_path);
+    ASSERT_NOT_NULL(r, "Open BGZF .tar.gz");
+    ArcEntryHandle *h = arc_entry_open(r, "f2.txt");
+    ASSERT_NOT_NULL(h, "Handle on an entry past the first block");
+    ASSERT_EQ(arc_entry_handle_size(h), 150000, "Handle size");
+    uint8_t buf[70000];
+    const uint64_t offsets[] = { 0, 65000, 149990, 1 };
+    const size_t lengths[] = { 70000, 1000, 10, 69999 };
+    for (size_t i = 0; i < 4; i++) {
+        ASSERT_EQ(arc_entry_pread(h, buf, lengths[i], offsets[i]), (ssize_t)lengths[i], "Read inside the entry");
+        ASSERT_TRUE(memcmp(buf, data + 200000 + offsets[i], lengths[i]) == 0, "Entry bytes");
+    }
+    ASSERT_EQ(arc_entry_pread(h, buf, 100, 149995), 5, "Read clipped at the end");
+    arc_entry_close(h);
+
+    h = arc_entry_open_index(r, 2);
+    ASSERT_NOT_NULL(h, "Handle on the last entry");
+    ASSERT_EQ(arc_entry_pread(h, buf, 5, 0), 5, "Whole last entry");
+    ASSERT_TRUE(memcmp(buf, "third", 5) == 0, "Last entry bytes");
+    arc_entry_close(h);
+    arc_close(r);
+    unlink(tgz_path);
+    return true;
+}
+
+int main(void) {
+    printf("=== BGZF Tests ===\n\n");
+
+    data = fixture_pattern(DATA_SIZE, 5);
+
+    RUN_TEST(test_detect);
+    RUN_TEST(test_sequential);
+    RUN_TEST(test_seek);
+    RUN_TEST(test_gzi);
+    RUN_TEST(test_corrupt);
+    RUN_TEST(test_reader);
+    RUN_TEST(test_entry_handles);
+
+    free(data);
+
+    PRINT_SUMMARY();
+}
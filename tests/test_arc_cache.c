@@ -0,0 +1,245 @@
+#define _POSIX_C_SOURCE 200809L
+#include "test_runner.h"
+#include "test_fixtures.h"
+#include "../cupidarchive.h"
+#include "arc_base.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <errno.h>
+
+static char base_dir[128];
+static char cache_dir[160];
+static char archive_path[192];
+
+static void clear_cache_dir(void) {
+    DIR *dir = opendir(cache_dir);
+    if (!dir) {
+        return;
+    }
+    struct dirent *de;
+    char path[512];
+    while ((de = readdir(dir)) != NULL) {
+        if (de->d_name[0] == '.') {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", cache_dir, de->d_name);
+        unlink(path);
+    }
+    closedir(dir);
+}
+
+// Read an entry's data fully; returns a malloc'd buffer
+static uint8_t *read_all(ArcReader *reader, size_t *size_out) {
+    ArcStream *s = arc_open_data(reader);
+    if (!s) {
+        return NULL;
+    }
+    size_t cap = 64 * 1024, len = 0;
+    uint8_t *buf = malloc(cap);
+    for (;;) {
+        if (len == cap) {
+            cap *= 2;
+            buf = realloc(buf, cap);
+        }
+        ssize_t n = arc_stream_read(s, buf + len, cap - len);
+        if (n <= 0) {
+            break;
+        }
+        len += (size_t)n;
+    }
+    arc_stream_close(s);
+    *size_out = len;
+    return buf;
+}
+
+// List the archive once (populating the cache), then check the second open
+// is served from the cache and returns the same entries and data.
+static bool check_roundtrip(const FixtureEntry *files, size_t count) {
+    clear_cache_dir();
+
+    ArcReader *reader = arc_open_path(archive_path);
+    ASSERT_NOT_NULL(reader, "Should open archive");
+    ASSERT_NE(arc_reader_format(reader), ARC_FORMAT_CACHED, "First open should parse the archive");
+    ArcEntry *entries = NULL;
+    size_t n = 0;
+    ASSERT_EQ(arc_list_entries(reader, &entries, &n), 0, "Should list entries");
+    ASSERT_EQ(n, count, "Should list every entry");
+    arc_entries_free(entries, n);
+    arc_close(reader);
+
+    reader = arc_open_path(archive_path);
+    ASSERT_NOT_NULL(reader, "Should reopen archive");
+    ASSERT_EQ(arc_reader_format(reader), ARC_FORMAT_CACHED, "Second open should hit the cache");
+
+    ArcEntry entry;
+    size_t i = 0;
+    while (arc_next(reader, &entry) == 0) {
+        ASSERT(i < count, "Cache should not invent entries");
+        ASSERT_STR_EQ(entry.path, files[i].name, "Cached path should match");
+        if (files[i].type == '0') {
+            ASSERT_EQ(entry.size, files[i].size, "Cached size should match");
+            size_t len = 0;
+            uint8_t *data = read_all(reader, &len);
+            ASSERT_NOT_NULL(data, "Should open data from cached location");
+            ASSERT_EQ(len, files[i].size, "Cached data length should match");
+            ASSERT(memcmp(data, files[i].data, len) == 0, "Cached data should match");
+            free(data);
+        }
+        arc_entry_free(&entry);
+        i++;
+    }
+    ASSERT_EQ(i, count, "Cached listing should be complete");
+    arc_close(reader);
+    return true;
+}
+
+bool test_cache_tar() {
+    const char *a = "hello from a\n";
+    const char *b = "bee\n";
+    FixtureEntry files[] = {
+        { "dir/", NULL, 0, '5' },
+        { "dir/a.txt", a, strlen(a), '0' },
+        { "dir/b.txt", b, strlen(b), '0' },
+    };
+    uint8_t *tar = NULL;
+    size_t size = fixture_tar(files, 3, &tar);
+    snprintf(archive_path, sizeof(archive_path), "%s/cache_test.tar", base_dir);
+    ASSERT_TRUE(fixture_write_file(archive_path, tar, size), "Should write tar fixture");
+    free(tar);
+    return check_roundtrip(files, 3);
+}
+
+bool test_cache_tar_gz_checkpoints() {
+    // Large enough for several inflate checkpoints (one every 4 MiB)
+    size_t big_size = 9 * 1024 * 1024 + 123;
+    uint8_t *big = fixture_pattern(big_size, 7);
+    const char *tail = "last entry\n";
+    FixtureEntry files[] = {
+        { "big.bin", big, big_size, '0' },
+        { "tail.txt", tail, strlen(tail), '0' },
+    };
+    uint8_t *tar = NULL;
+    size_t size = fixture_tar(files, 2, &tar);
+    snprintf(archive_path, sizeof(archive_path), "%s/cache_test.tar.gz", base_dir);
+    ASSERT_TRUE(fixture_write_gzip(archive_path, tar, size), "Should write tar.gz fixture");
+    free(tar);
+    bool ok = check_roundtrip(files, 2);
+    free(big);
+    return ok;
+}
+
+bool test_cache_zip() {
+    uint8_t *data = fixture_pattern(200000, 3);
+    FixtureEntry files[] = {
+        { "docs/", NULL, 0, '5' },
+        { "docs/readme.txt", "read me", 7, '0' },
+        { "docs/data.bin", data, 200000, '0' },
+    };
+    snprintf(archive_path, sizeof(archive_path), "%s/cache_test.zip", base_dir);
+    ASSERT_TRUE(fixture_write_zip(archive_path, files, 3, true), "Should write zip fixture");
+    bool ok = check_roundtrip(files, 3);
+    free(data);
+    return ok;
+}
+
+bool test_cache_invalidated_on_change() {
+    // Uses the zip written by the previous test (cache is populated)
+    ArcReader *reader = arc_open_path(archive_path);
+    ASSERT_NOT_NULL(reader, "Should open archive");
+    ASSERT_EQ(arc_reader_format(reader), ARC_FORMAT_CACHED, "Should hit the cache");
+    arc_close(reader);
+
+    struct timespec times[2] = { { 1000000000, 0 }, { 1000000000, 0 } };
+    ASSERT_EQ(utimensat(AT_FDCWD, archive_path, times, 0), 0, "Should change mtime");
+
+    reader = arc_open_path(archive_path);
+    ASSERT_NOT_NULL(reader, "Should open archive");
+    ASSERT_NE(arc_reader_format(reader), ARC_FORMAT_CACHED, "Stale cache must not be used");
+    arc_close(reader);
+    return true;
+}
+
+bool test_cache_partial_listing_not_stored() {
+    clear_cache_dir();
+    ArcReader *reader = arc_open_path(archive_path);
+    ASSERT_NOT_NULL(reader, "Should open archive");
+    ArcEntry entry;
+    ASSERT_EQ(arc_next(reader, &entry), 0, "Should read first entry");
+    arc_entry_free(&entry);
+    arc_close(reader);
+
+    reader = arc_open_path(archive_path);
+    ASSERT_NOT_NULL(reader, "Should open archive");
+    ASSERT_NE(arc_reader_format(reader), ARC_FORMAT_CACHED, "Incomplete pass must not be cached");
+    arc_close(reader);
+    return true;
+}
+
+// A listing cached under the defaults must not bypass a stricter caller
+bool test_cache_respects_limits() {
+    FixtureEntry files[] = {
+        { "docs/", NULL, 0, '5' },
+        { "docs/readme.txt", "read me", 7, '0' },
+        { "docs/notes.txt", "notes", 5, '0' },
+    };
+    snprintf(archive_path, sizeof(archive_path), "%s/cache_limits.zip", base_dir);
+    ASSERT_TRUE(fixture_write_zip(archive_path, files, 3, true), "Should write zip fixture");
+    ASSERT_TRUE(check_roundtrip(files, 3), "Listing should be cached");
+
+    ArcLimits limits = *arc_default_limits();
+    limits.max_entries = 2;
+    ASSERT_NULL(arc_open_path_ex(archive_path, &limits), "Too many entries for max_entries");
+
+    limits = *arc_default_limits();
+    limits.max_name = 8;
+    ASSERT_NULL(arc_open_path_ex(archive_path, &limits), "Names longer than max_name");
+
+    ArcReader *reader = arc_open_path(archive_path);
+    ASSERT_NOT_NULL(reader, "Should open archive");
+    ASSERT_EQ(arc_reader_format(reader), ARC_FORMAT_CACHED, "Default limits still hit the cache");
+    arc_close(reader);
+    return true;
+}
+
+bool test_cache_enable_invalid() {
+    ASSERT_EQ(arc_listing_cache_enable(NULL), -1, "NULL dir should fail");
+    ASSERT_EQ(arc_listing_cache_enable("/nonexistent/cache/dir"), -1, "Missing dir should fail");
+    return true;
+}
+
+int main() {
+    printf("=== Listing Cache Tests ===\n\n");
+
+    snprintf(base_dir, sizeof(base_dir), "/tmp/cupidarchive_cache_test_%ld", (long)getpid());
+    mkdir(base_dir, 0755);
+    snprintf(cache_dir, sizeof(cache_dir), "%s/cache", base_dir);
+    mkdir(cache_dir, 0755);
+
+    RUN_TEST(test_cache_enable_invalid);
+    if (arc_listing_cache_enable(cache_dir) < 0) {
+        printf("Could not enable cache in %s\n", cache_dir);
+        return 1;
+    }
+    RUN_TEST(test_cache_tar);
+    RUN_TEST(test_cache_tar_gz_checkpoints);
+    RUN_TEST(test_cache_zip);
+    RUN_TEST(test_cache_invalidated_on_change);
+    RUN_TEST(test_cache_partial_listing_not_stored);
+    RUN_TEST(test_cache_respects_limits);
+    arc_listing_cache_disable();
+
+    clear_cache_dir();
+    rmdir(cache_dir);
+    const char *names[] = { "cache_test.tar", "cache_test.tar.gz", "cache_test.zip" };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/%s", base_dir, names[i]);
+        unlink(path);
+    }
+    rmdir(base_dir);
+
+    PRINT_SUMMARY();
+}
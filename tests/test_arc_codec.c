@@ -0,0 +1,452 @@
+#include "test_runner.h"
+#include "test_fixtures.h"
+#include "../cupidarchive.h"
+#include <errno.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <bzlib.h>
+#include <lzma.h>
+
+#define DATA_SIZE (300 * 1024 + 17)
+
+static uint8_t *data;
+
+typedef struct Encoded {
+    ArcCodec codec;
+    uint8_t props[5];
+    size_t props_len;
+    uint8_t *buf;
+    size_t len;
+} Encoded;
+
+static bool zlib_encode(int window_bits, Encoded *e) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, 6, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+    e->buf = malloc(deflateBound(&zs, DATA_SIZE) + 32);
+    zs.next_in = data;
+    zs.avail_in = DATA_SIZE;
+    zs.next_out = e->buf;
+    zs.avail_out = (uInt)deflateBound(&zs, DATA_SIZE) + 32;
+    int ret = deflate(&zs, Z_FINISH);
+    e->len = zs.total_out;
+    deflateEnd(&zs);
+    return ret == Z_STREAM_END;
+}
+
+static bool raw_lzma_encode(lzma_vli id, Encoded *e) {
+    lzma_options_lzma opts;
+    lzma_lzma_preset(&opts, 6);
+    opts.dict_size = 1u << 20;
+    lzma_filter filters[2] = { { .id = id, .options = &opts }, { .id = LZMA_VLI_UNKNOWN } };
+    uint32_t props_size = 0;
+    lzma_properties_size(&props_size, &filters[0]);
+    e->props_len = props_size;
+    if (lzma_properties_encode(&filters[0], e->props) != LZMA_OK) {
+        return false;
+    }
+    size_t cap = DATA_SIZE + DATA_SIZE / 2 + 4096;
+    e->buf = malloc(cap);
+    e->len = 0;
+    return lzma_raw_buffer_encode(filters, NULL, data, DATA_SIZE, e->buf, &e->len, cap) == LZMA_OK;
+}
+
+// Compress `data` for the given codec with the reference encoder
+static bool encode(ArcCodec codec, Encoded *e) {
+    memset(e, 0, sizeof(*e));
+    e->codec = codec;
+    switch (codec) {
+    case ARC_CODEC_GZIP:
+        return zlib_encode(16 + MAX_WBITS, e);
+    case ARC_CODEC_DEFLATE:
+        return zlib_encode(-MAX_WBITS, e);
+    case ARC_CODEC_BZIP2: {
+        unsigned int len = DATA_SIZE + DATA_SIZE / 100 + 600;
+        e->buf = malloc(len);
+        int ret = BZ2_bzBuffToBuffCompress((char *)e->buf, &len, (char *)data, DATA_SIZE, 9, 0, 0);
+        e->len = len;
+        return ret == BZ_OK;
+    }
+    case ARC_CODEC_XZ: {
+        size_t cap = lzma_stream_buffer_bound(DATA_SIZE);
+        e->buf = malloc(cap);
+        return lzma_easy_buffer_encode(6, LZMA_CHECK_CRC64, NULL, data, DATA_SIZE, e->buf, &e->len, cap) == LZMA_OK;
+    }
+    case ARC_CODEC_LZMA:
+        return raw_lzma_encode(LZMA_FILTER_LZMA1, e);
+    case ARC_CODEC_LZMA2:
+        return raw_lzma_encode(LZMA_FILTER_LZMA2, e);
+    default:
+        return false;
+    }
+}
+
+static uint8_t *read_stream(ArcStream *s, size_t cap, size_t *len_out, int *err) {
+    uint8_t *buf = malloc(cap);
+    size_t len = 0;
+    ssize_t n = 0;
+    while (len < cap && (n = arc_stream_read(s, buf + len, cap - len > 7777 ? 7777 : cap - len)) > 0) {
+        len += (size_t)n;
+    }
+    *err = n < 0 ? errno : 0;
+    *len_out = len;
+    return buf;
+}
+
+// Built-in backends are registered and selected for every codec
+static bool test_builtin_backends(void) {
+    static const char *expected[ARC_CODEC_COUNT] = {
+        [ARC_CODEC_GZIP] = "zlib", [ARC_CODEC_DEFLATE] = "zlib", [ARC_CODEC_BZIP2] = "libbz2",
+        [ARC_CODEC_XZ] = "liblzma", [ARC_CODEC_LZMA] = "liblzma", [ARC_CODEC_LZMA2] = "liblzma",
+    };
+    for (int c = 0; c < ARC_CODEC_COUNT; c++) {
+        const ArcCodecBackend *list[8];
+        ASSERT_TRUE(arc_codec_list((ArcCodec)c, list, 8) >= 1, "Every codec should have a backend");
+        ASSERT_STR_EQ(list[0]->name, expected[c], "Built-in backend is listed first");
+        ASSERT_TRUE(list[0]->init && list[0]->decode && list[0]->end, "Built-ins stream");
+    }
+    const ArcCodecBackend *gz = arc_codec_selected(ARC_CODEC_GZIP);
+    ASSERT_NOT_NULL(gz, "gzip should have a selected backend");
+    ASSERT_STR_EQ(gz->name, "zlib", "zlib is the default gzip backend");
+    ASSERT_TRUE(gz == arc_codec_find(ARC_CODEC_GZIP, "zlib"), "find returns the registered struct");
+    ASSERT_STR_EQ(arc_codec_name(ARC_CODEC_LZMA2), "lzma2", "Codec names");
+    ASSERT_NULL(arc_codec_name(ARC_CODEC_COUNT), "Out of range codec has no name");
+    return true;
+}
+
+// One-shot decode matches the input for every codec; too small outputs fail with ENOBUFS
+static bool test_decode_buffer(void) {
+    uint8_t *out = malloc(DATA_SIZE + 64);
+    for (int c = 0; c < ARC_CODEC_COUNT; c++) {
+        Encoded e;
+        ASSERT_TRUE(encode((ArcCodec)c, &e), "Reference encoder should succeed");
+        size_t out_len = 0;
+        int ret = arc_codec_decode_buffer((ArcCodec)c, e.props, e.props_len, e.buf, e.len,
+                                          out, DATA_SIZE + 64, &out_len);
+        ASSERT_EQ(ret, 0, "Decode should succeed");
+        ASSERT_EQ(out_len, DATA_SIZE, "Decoded size should match");
+        ASSERT_TRUE(memcmp(out, data, DATA_SIZE) == 0, "Decoded bytes should match");
+
+        if (c != ARC_CODEC_LZMA && c != ARC_CODEC_LZMA2) {
+            // Raw LZMA may lack an end marker, so a short output looks complete
+            errno = 0;
+            ret = arc_codec_decode_buffer((ArcCodec)c, e.props, e.props_len, e.buf, e.len,
+                                          out, DATA_SIZE / 2, &out_len);
+            ASSERT_EQ(ret, -1, "Short output buffer should fail");
+            ASSERT_EQ(errno, ENOBUFS, "Short output buffer sets ENOBUFS");
+        }
+        free(e.buf);
+    }
+    free(out);
+    return true;
+}
+
+// Truncated input fails with EINVAL both one-shot and through the filters
+static bool test_truncated(void) {
+    uint8_t *out = malloc(DATA_SIZE);
+    for (int c = 0; c < ARC_CODEC_COUNT; c++) {
+        if (c == ARC_CODEC_LZMA || c == ARC_CODEC_LZMA2) {
+            continue; // See test_decode_buffer
+        }
+        Encoded e;
+        ASSERT_TRUE(encode((ArcCodec)c, &e), "Reference encoder should succeed");
+        size_t cut = e.len - e.len / 3;
+        size_t out_len = 0;
+        errno = 0;
+        ASSERT_EQ(arc_codec_decode_buffer((ArcCodec)c, NULL, 0, e.buf, cut, out, DATA_SIZE, &out_len), -1,
+                  "Truncated buffer should fail");
+        ASSERT_EQ(errno, EINVAL, "Truncation sets EINVAL");
+
+        ArcStream *mem = arc_stream_from_memory(e.buf, cut, 0);
+        ArcStream *f = arc_codec_filter(mem, (ArcCodec)c, NULL, 0, 0, true);
+        ASSERT_NOT_NULL(f, "Filter should open");
+        int err = 0;
+        size_t len = 0;
+        free(read_stream(f, DATA_SIZE, &len, &err));
+        ASSERT_EQ(err, EINVAL, "Truncated stream read sets EINVAL");
+        arc_stream_close(f);
+        free(e.buf);
+    }
+
+    // The public filters go through the registry too
+    Encoded e;
+    ASSERT_TRUE(encode(ARC_CODEC_BZIP2, &e), "bzip2 encode");
+    ArcStream *mem = arc_stream_from_memory(e.buf, e.len - 100, 0);
+    ArcStream *f = arc_filter_bzip2(mem, 0);
+    int err = 0;
+    size_t len = 0;
+    free(read_stream(f, DATA_SIZE, &len, &err));
+    ASSERT_EQ(err, EINVAL, "Truncated bzip2 no longer ends silently");
+    arc_stream_close(f);
+    arc_stream_close(mem);
+    free(e.buf);
+    free(out);
+    return true;
+}
+
+// Filters decode in pieces and respect the byte limit; states are reused across filters
+static bool test_filter_stream(void) {
+    for (int c = 0; c < ARC_CODEC_COUNT; c++) {
+        Encoded e;
+        ASSERT_TRUE(encode((ArcCodec)c, &e), "Reference encoder should succeed");
+        for (int round = 0; round < 3; round++) {
+            ArcStream *mem = arc_stream_from_memory(e.buf, e.len, 0);
+            int64_t limit = round == 2 ? 1000 : 0;
+            ArcStream *f = arc_codec_filter(mem, (ArcCodec)c, e.props, e.props_len, limit, true);
+            ASSERT_NOT_NULL(f, "Filter should open");
+            int err = 0;
+            size_t len = 0;
+            uint8_t *got = read_stream(f, DATA_SIZE + 64, &len, &err);
+            ASSERT_EQ(err, 0, "Stream should decode");
+            ASSERT_EQ(len, limit ? (size_t)limit : (size_t)DATA_SIZE, "Stream length");
+            ASSERT_TRUE(memcmp(got, data, len) == 0, "Stream bytes should match");
+            ASSERT_EQ(arc_stream_seek(f, 0, SEEK_SET), -1, "Filters don't seek");
+            free(got);
+            arc_stream_close(f);
+        }
+        free(e.buf);
+    }
+    return true;
+}
+
+static size_t gzip_member(const char *text, uint8_t *out, size_t cap) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, 6, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return 0;
+    }
+    zs.next_in = (Bytef *)text;
+    zs.avail_in = (uInt)strlen(text);
+    zs.next_out = out;
+    zs.avail_out = (uInt)cap;
+    int ret = deflate(&zs, Z_FINISH);
+    size_t len = zs.total_out;
+    deflateEnd(&zs);
+    return ret == Z_STREAM_END ? len : 0;
+}
+
+// `cat a.gz b.gz` decodes as the concatenation, trailing garbage is ignored
+static bool test_multi_member(void) {
+    uint8_t gz[256];
+    size_t len = gzip_member("hello ", gz, sizeof(gz));
+    size_t len2 = gzip_member("world", gz + len, sizeof(gz) - len);
+    ASSERT(len > 0 && len2 > 0, "Should encode members");
+    len += len2;
+    for (int garbage = 0; garbage < 2; garbage++) {
+        size_t total = len;
+        if (garbage) {
+            memcpy(gz + total, "junk", 4);
+            total += 4;
+        }
+        for (int via_codec = 0; via_codec < 2; via_codec++) {
+            ArcStream *mem = arc_stream_from_memory(gz, total, 0);
+            ArcStream *f = via_codec ? arc_codec_filter(mem, ARC_CODEC_GZIP, NULL, 0, 0, true)
+                                     : arc_filter_gzip(mem, 0);
+            ASSERT_NOT_NULL(f, "Filter should open");
+            int err = 0;
+            size_t got_len = 0;
+            uint8_t *got = read_stream(f, 64, &got_len, &err);
+            ASSERT_EQ(err, 0, "Members should decode");
+            ASSERT_EQ(got_len, (size_t)11, "Both members should be read");
+            ASSERT_TRUE(memcmp(got, "hello world", 11) == 0, "Members should join in order");
+            free(got);
+            arc_stream_close(f);
+            if (!via_codec) {
+                arc_stream_close(mem);
+            }
+        }
+    }
+    return true;
+}
+
+// Registry errors
+static bool test_register_select(void) {
+    errno = 0;
+    ASSERT_EQ(arc_codec_select(ARC_CODEC_DEFLATE, "no-such-backend"), -1, "Unknown backend");
+    ASSERT_EQ(errno, ENOENT, "Unknown backend sets ENOENT");
+    ASSERT_STR_EQ(arc_codec_selected(ARC_CODEC_DEFLATE)->name, "zlib", "Selection unchanged");
+
+    ArcCodecBackend dup = *arc_codec_find(ARC_CODEC_DEFLATE, "zlib");
+    errno = 0;
+    ASSERT_EQ(arc_codec_register(&dup), -1, "Name already taken");
+    ASSERT_EQ(errno, EEXIST, "Duplicate sets EEXIST");
+
+    static const ArcCodecBackend empty = { .name = "empty", .codec = ARC_CODEC_XZ };
+    errno = 0;
+    ASSERT_EQ(arc_codec_register(&empty), -1, "Backend without decode functions");
+    ASSERT_EQ(errno, EINVAL, "Incomplete backend sets EINVAL");
+    return true;
+}
+
+// Custom backends
+
+static int stream_calls;
+static int oneshot_calls;
+
+static void *counting_init(const uint8_t *props, size_t props_len) {
+    return arc_codec_find(ARC_CODEC_DEFLATE, "zlib")->init(props, props_len);
+}
+
+static int counting_decode(void *state, ArcCodecIo *io, bool finish) {
+    stream_calls++;
+    return arc_codec_find(ARC_CODEC_DEFLATE, "zlib")->decode(state, io, finish);
+}
+
+static void counting_end(void *state) {
+    arc_codec_find(ARC_CODEC_DEFLATE, "zlib")->end(state);
+}
+
+static const ArcCodecBackend counting_backend = {
+    .name = "counting",
+    .codec = ARC_CODEC_DEFLATE,
+    .init = counting_init,
+    .decode = counting_decode,
+    .end = counting_end,
+};
+
+static int oneshot_decode(const uint8_t *props, size_t props_len, const uint8_t *in, size_t in_len,
+                          uint8_t *out, size_t out_cap, size_t *out_len) {
+    (void)props;
+    (void)props_len;
+    oneshot_calls++;
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, -MAX_WBITS) != Z_OK) {
+        return -1;
+    }
+    zs.next_in = (Bytef *)in;
+    zs.avail_in = (uInt)in_len;
+    zs.next_out = out;
+    zs.avail_out = (uInt)out_cap;
+    int ret = inflate(&zs, Z_FINISH);
+    *out_len = zs.total_out;
+    inflateEnd(&zs);
+    if (ret != Z_STREAM_END) {
+        errno = ret == Z_BUF_ERROR && zs.avail_out == 0 ? ENOBUFS : EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+static const ArcCodecBackend oneshot_backend = {
+    .name = "oneshot",
+    .codec = ARC_CODEC_DEFLATE,
+    .flags = ARC_CODEC_PREFER_ONESHOT,
+    .decode_buffer = oneshot_decode,
+};
+
+// Read every entry of a ZIP and compare with the fixture
+static bool check_zip(const char *path, const FixtureEntry *entries, size_t count) {
+    ArcReader *r = arc_open_path(path);
+    ASSERT_NOT_NULL(r, "ZIP should open");
+    ArcEntry entry;
+    size_t i = 0;
+    while (arc_next(r, &entry) == 0) {
+        ArcStream *s = arc_open_data(r);
+        ASSERT_NOT_NULL(s, "Entry data should open");
+        int err = 0;
+        size_t len = 0;
+        uint8_t *got = read_stream(s, DATA_SIZE + 64, &len, &err);
+        ASSERT_EQ(err, 0, "Entry should decode");
+        ASSERT_TRUE(i < count && len == entries[i].size, "Entry size");
+        ASSERT_TRUE(memcmp(got, entries[i].data, len) == 0, "Entry bytes");
+        free(got);
+        arc_stream_close(s);
+        arc_entry_free(&entry);
+        i++;
+    }
+    arc_close(r);
+    ASSERT_EQ(i, count, "All entries listed");
+    return true;
+}
+
+// A registered streaming backend is used by the ZIP reader once selected
+static bool test_custom_streaming(void) {
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/cupidarchive_codec_%ld.zip", (long)getpid());
+    FixtureEntry entries[] = {
+        { "a.bin", data, DATA_SIZE, '0' },
+        { "b.txt", "hello codec", 11, '0' },
+    };
+    ASSERT_TRUE(fixture_write_zip(path, entries, 2, true), "Fixture ZIP");
+
+    ASSERT_EQ(arc_codec_register(&counting_backend), 0, "Register counting backend");
+    ASSERT_EQ(arc_codec_select(ARC_CODEC_DEFLATE, "counting"), 0, "Select counting backend");
+    stream_calls = 0;
+    bool ok = check_zip(path, entries, 2);
+    arc_codec_select(ARC_CODEC_DEFLATE, "zlib");
+    ASSERT_TRUE(ok, "ZIP should read through the counting backend");
+    ASSERT_TRUE(stream_calls > 0, "Counting backend should have decoded");
+
+    stream_calls = 0;
+    ASSERT_TRUE(check_zip(path, entries, 2), "ZIP reads with zlib again");
+    ASSERT_EQ(stream_calls, 0, "Deselected backend is no longer used");
+    unlink(path);
+    return true;
+}
+
+// A whole-buffer backend decodes ZIP entries in one call; filters fall back to the built-in
+static bool test_oneshot_backend(void) {
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/cupidarchive_codec1_%ld.zip", (long)getpid());
+    FixtureEntry entries[] = {
+        { "a.bin", data, DATA_SIZE, '0' },
+        { "b.bin", data + 5, 4000, '0' },
+    };
+    ASSERT_TRUE(fixture_write_zip(path, entries, 2, true), "Fixture ZIP");
+
+    ASSERT_EQ(arc_codec_register(&oneshot_backend), 0, "Register one-shot backend");
+    ASSERT_EQ(arc_codec_select(ARC_CODEC_DEFLATE, "oneshot"), 0, "Select one-shot backend");
+    oneshot_calls = 0;
+    bool ok = check_zip(path, entries, 2);
+    ASSERT_TRUE(ok, "ZIP should read through the one-shot backend");
+    ASSERT_EQ(oneshot_calls, 2, "Each entry decoded in one call");
+
+    Encoded e;
+    ASSERT_TRUE(encode(ARC_CODEC_DEFLATE, &e), "deflate encode");
+    ArcStream *mem = arc_stream_from_memory(e.buf, e.len, 0);
+    ArcStream *f = arc_filter_deflate(mem, 0);
+    int err = 0;
+    size_t len = 0;
+    uint8_t *got = read_stream(f, DATA_SIZE, &len, &err);
+    ok = err == 0 && len == DATA_SIZE && memcmp(got, data, len) == 0;
+    free(got);
+    arc_stream_close(f);
+
+    // Memory stream over the one-shot result is seekable
+    arc_stream_seek(mem, 0, SEEK_SET);
+    ArcStream *s = arc_codec_oneshot(mem, ARC_CODEC_DEFLATE, NULL, 0, e.len, DATA_SIZE, true);
+    ASSERT_NOT_NULL(s, "One-shot stream");
+    uint8_t byte = 0;
+    ASSERT_EQ(arc_stream_seek(s, 1234, SEEK_SET), 0, "One-shot stream seeks");
+    ASSERT_EQ(arc_stream_read(s, &byte, 1), 1, "Read after seek");
+    ASSERT_EQ(byte, data[1234], "Byte after seek");
+    arc_stream_close(s);
+    free(e.buf);
+
+    arc_codec_select(ARC_CODEC_DEFLATE, "zlib");
+    ASSERT_TRUE(ok, "Streaming filter falls back to the built-in backend");
+    unlink(path);
+    return true;
+}
+
+int main(void) {
+    printf("=== Codec Backend Tests ===\n\n");
+
+    data = fixture_pattern(DATA_SIZE, 3);
+
+    RUN_TEST(test_builtin_backends);
+    RUN_TEST(test_decode_buffer);
+    RUN_TEST(test_truncated);
+    RUN_TEST(test_filter_stream);
+    RUN_TEST(test_multi_member);
+    RUN_TEST(test_register_select);
+    RUN_TEST(test_custom_streaming);
+    RUN_TEST(test_oneshot_backend);
+
+    free(data);
+
+    PRINT_SUMMARY();
+}
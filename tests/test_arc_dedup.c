@@ -0,0 +1,355 @@
+#define _POSIX_C_SOURCE 200809L
+#include "test_runner.h"
+#include "test_fixtures.h"
+#include "../cupidarchive.h"
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+static char base_dir[128];
+
+static bool write_tar(const char *path, const FixtureEntry *entries, size_t count, const unsigned *modes) {
+    uint8_t *tar;
+    size_t size = fixture_tar_modes(entries, modes, count, &tar);
+    bool ok = size && fixture_write_file(path, tar, size);
+    free(tar);
+    return ok;
+}
+
+static int extract(const char *archive, const char *dest, const ArcExtractOptions *opts, ArcExtractReport *report) {
+    ArcReader *reader = arc_open_path(archive);
+    if (!reader) {
+        return -2;
+    }
+    mkdir(dest, 0755);
+    int result = arc_extract_to_path_ex(reader, dest, opts, report);
+    arc_close(reader);
+    return result;
+}
+
+static bool file_is(const char *dir, const char *name, const void *data, size_t size) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return false;
+    }
+    uint8_t *buf = malloc(size + 1);
+    size_t n = fread(buf, 1, size + 1, f);
+    fclose(f);
+    bool same = n == size && memcmp(buf, data, size) == 0;
+    free(buf);
+    return same;
+}
+
+static ino_t inode(const char *dir, const char *name) {
+    char path[512];
+    struct stat st;
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    return stat(path, &st) == 0 ? st.st_ino : 0;
+}
+
+// Remove the named entries (files before their directories), then dir
+static void remove_tree(const char *dir, const char *const *names, size_t count) {
+    char path[512];
+    for (size_t i = 0; i < count; i++) {
+        snprintf(path, sizeof(path), "%s/%s", dir, names[i]);
+        if (unlink(path) < 0) {
+            rmdir(path);
+        }
+    }
+    rmdir(dir);
+}
+
+static const FixtureEntry dup_entries[] = {
+    { "src/", NULL, 0, '5' },
+    { "src/a.c", "int main(void) { return 0; }\n", 29, '0' },
+    { "src/b.c", "int helper(void);\n", 18, '0' },
+    { "vendor/a.c", "int main(void) { return 0; }\n", 29, '0' },
+    { "vendor/b.c", "int helper(void);\n", 18, '0' },
+    { "vendor/c.c", "int main(void) { return 0; }\n", 29, '0' },
+};
+static const char *dup_names[] = { "src/a.c", "src/b.c", "vendor/a.c", "vendor/b.c", "vendor/c.c", "src", "vendor" };
+#define DUP_COUNT (sizeof(dup_entries) / sizeof(dup_entries[0]))
+#define DUP_NAME_COUNT (sizeof(dup_names) / sizeof(dup_names[0]))
+
+static bool test_hardlink(void) {
+    char archive[256];
+    char dest[256];
+    snprintf(archive, sizeof(archive), "%s/dup.tar", base_dir);
+    snprintf(dest, sizeof(dest), "%s/hardlink", base_dir);
+    ASSERT_TRUE(write_tar(archive, dup_entries, DUP_COUNT, NULL), "Write fixture");
+
+    ArcExtractOptions opts = {0};
+    opts.dedup = ARC_DEDUP_HARDLINK;
+    opts.hash_algorithms = ARC_HASH_SHA256;
+    ArcExtractReport report;
+    ASSERT_EQ(extract(archive, dest, &opts, &report), 0, "Extraction should succeed");
+    ASSERT_EQ(report.count, 5, "Every file should be reported");
+    ASSERT_EQ(report.dedup_files, 3, "Three duplicates should be linked");
+    ASSERT_EQ(report.dedup_bytes, 29 + 18 + 29, "Bytes not written");
+    ASSERT_EQ(report.total_bytes, 2 * 29 + 2 * 18 + 29, "Total still counts every file");
+    ASSERT_EQ(report.files[3].digests.algorithms, ARC_HASH_SHA256, "Only the requested digests are reported");
+    ASSERT_TRUE(memcmp(report.files[0].digests.sha256, report.files[2].digests.sha256, ARC_SHA256_SIZE) == 0,
+                "Linked files report their digests");
+    arc_extract_report_free(&report);
+
+    for (size_t i = 1; i < DUP_COUNT; i++) {
+        ASSERT_TRUE(file_is(dest, dup_entries[i].name, dup_entries[i].data, dup_entries[i].size), "Contents");
+    }
+    ASSERT_EQ(inode(dest, "src/a.c"), inode(dest, "vendor/a.c"), "Duplicate should share the inode");
+    ASSERT_EQ(inode(dest, "src/a.c"), inode(dest, "vendor/c.c"), "Every duplicate should share it");
+    ASSERT_EQ(inode(dest, "src/b.c"), inode(dest, "vendor/b.c"), "Second group should share its inode");
+    ASSERT_NE(inode(dest, "src/a.c"), inode(dest, "src/b.c"), "Different contents stay separate");
+
+    remove_tree(dest, dup_names, DUP_NAME_COUNT);
+    unlink(archive);
+    return true;
+}
+
+static bool test_reflink_fallback(void) {
+    char archive[256];
+    char dest[256];
+    snprintf(archive, sizeof(archive), "%s/dup.tar", base_dir);
+    snprintf(dest, sizeof(dest), "%s/reflink", base_dir);
+    ASSERT_TRUE(write_tar(archive, dup_entries, DUP_COUNT, NULL), "Write fixture");
+
+    // Clones where the file system has them, plain writes elsewhere; never links
+    ArcExtractOptions opts = {0};
+    opts.dedup = ARC_DEDUP_REFLINK;
+    ArcExtractReport report;
+    ASSERT_EQ(extract(archive, dest, &opts, &report), 0, "Extraction should succeed");
+    ASSERT_TRUE(report.dedup_files == 0 || report.dedup_files == 3, "Either no reflinks or all of them");
+    arc_extract_report_free(&report);
+    for (size_t i = 1; i < DUP_COUNT; i++) {
+        ASSERT_TRUE(file_is(dest, dup_entries[i].name, dup_entries[i].data, dup_entries[i].size), "Contents");
+    }
+    ASSERT_NE(inode(dest, "src/a.c"), inode(dest, "vendor/a.c"), "Reflinks are separate files");
+
+    // Reflinks first, then links
+    opts.dedup = ARC_DEDUP_REFLINK | ARC_DEDUP_HARDLINK;
+    ASSERT_EQ(extract(archive, dest, &opts, &report), 0, "Re-extraction should succeed");
+    ASSERT_EQ(report.dedup_files, 3, "Duplicates should be cloned or linked");
+    arc_extract_report_free(&report);
+    for (size_t i = 1; i < DUP_COUNT; i++) {
+        ASSERT_TRUE(file_is(dest, dup_entries[i].name, dup_entries[i].data, dup_entries[i].size), "Contents");
+    }
+
+    remove_tree(dest, dup_names, DUP_NAME_COUNT);
+    unlink(archive);
+    return true;
+}
+
+static bool test_attributes_block_links(void) {
+    char archive[256];
+    char dest[256];
+    snprintf(archive, sizeof(archive), "%s/modes.tar", base_dir);
+    snprintf(dest, sizeof(dest), "%s/modes", base_dir);
+    static const FixtureEntry entries[] = {
+        { "run.sh", "#!/bin/sh\n", 10, '0' },
+        { "copy.sh", "#!/bin/sh\n", 10, '0' },
+        { "exec.sh", "#!/bin/sh\n", 10, '0' },
+    };
+    const unsigned modes[] = { 0644, 0644, 0755 };
+    ASSERT_TRUE(write_tar(archive, entries, 3, modes), "Write fixture");
+
+    ArcExtractOptions opts = {0};
+    opts.dedup = ARC_DEDUP_HARDLINK;
+    opts.preserve_permissions = true;
+    ArcExtractReport report;
+    ASSERT_EQ(extract(archive, dest, &opts, &report), 0, "Extraction should succeed");
+    ASSERT_EQ(report.dedup_files, 1, "Only the file with the same mode should be linked");
+    arc_extract_report_free(&report);
+    ASSERT_EQ(inode(dest, "run.sh"), inode(dest, "copy.sh"), "Same mode: linked");
+    ASSERT_NE(inode(dest, "run.sh"), inode(dest, "exec.sh"), "Other mode: written");
+    struct stat st;
+    char path[512];
+    snprintf(path, sizeof(path), "%s/exec.sh", dest);
+    ASSERT_EQ(stat(path, &st), 0, "stat exec.sh");
+    ASSERT_EQ(st.st_mode & 0777, 0755, "exec.sh keeps its own mode");
+    snprintf(path, sizeof(path), "%s/run.sh", dest);
+    ASSERT_EQ(stat(path, &st), 0, "stat run.sh");
+    ASSERT_EQ(st.st_mode & 0777, 0644, "run.sh is not affected");
+
+    const char *names[] = { "run.sh", "copy.sh", "exec.sh" };
+    remove_tree(dest, names, 3);
+    unlink(archive);
+    return true;
+}
+
+static bool test_rewritten_paths(void) {
+    char archive[256];
+    char dest[256];
+    snprintf(archive, sizeof(archive), "%s/rewrite.tar", base_dir);
+    snprintf(dest, sizeof(dest), "%s/rewrite", base_dir);
+    static const FixtureEntry entries[] = {
+        { "a", "first", 5, '0' },
+        { "b", "first", 5, '0' },   // Linked to a
+        { "a", "other", 5, '0' },   // Must not change b
+        { "c", "first", 5, '0' },   // May link to b, never to the rewritten a
+    };
+    ASSERT_TRUE(write_tar(archive, entries, 4, NULL), "Write fixture");
+
+    ArcExtractOptions opts = {0};
+    opts.dedup = ARC_DEDUP_HARDLINK;
+    ASSERT_EQ(extract(archive, dest, &opts, NULL), 0, "Extraction should succeed");
+    ASSERT_TRUE(file_is(dest, "a", "other", 5), "Rewritten file has the new contents");
+    ASSERT_TRUE(file_is(dest, "b", "first", 5), "Its former link keeps the old contents");
+    ASSERT_TRUE(file_is(dest, "c", "first", 5), "A stale record is not trusted");
+
+    const char *names[] = { "a", "b", "c" };
+    remove_tree(dest, names, 3);
+    unlink(archive);
+    return true;
+}
+
+static bool test_persistent_index(void) {
+    char archive[256];
+    char index[256];
+    char first[256];
+    char second[256];
+    snprintf(archive, sizeof(archive), "%s/dup.tar", base_dir);
+    snprintf(index, sizeof(index), "%s/dedup.index", base_dir);
+    snprintf(first, sizeof(first), "%s/first", base_dir);
+    snprintf(second, sizeof(second), "%s/second", base_dir);
+    ASSERT_TRUE(write_tar(archive, dup_entries, DUP_COUNT, NULL), "Write fixture");
+
+    // Malformed lines and records of vanished files are ignored
+    const char *junk = "not an index line\n"
+                       "0000000000000000000000000000000000000000000000000000000000000000 5 /nonexistent/file\n";
+    ASSERT_TRUE(fixture_write_file(index, junk, strlen(junk)), "Write junk index");
+
+    ArcExtractOptions opts = {0};
+    opts.dedup = ARC_DEDUP_HARDLINK;
+    opts.dedup_index = index;
+    ArcExtractReport report;
+    ASSERT_EQ(extract(archive, first, &opts, &report), 0, "First extraction should succeed");
+    ASSERT_EQ(report.dedup_files, 3, "Duplicates within the archive");
+    arc_extract_report_free(&report);
+
+    char buf[1024];
+    FILE *f = fopen(index, "r");
+    ASSERT_NOT_NULL(f, "Index should be written");
+    size_t lines = 0;
+    bool absolute = true;
+    while (fgets(buf, sizeof(buf), f)) {
+        lines++;
+        absolute = absolute && strstr(buf, " /") != NULL;
+    }
+    fclose(f);
+    ASSERT_EQ(lines, 3, "Index keeps the valid junk record and the two new contents");
+    ASSERT_TRUE(absolute, "Index paths are absolute");
+
+    // A second tree links every file to the first one
+    ASSERT_EQ(extract(archive, second, &opts, &report), 0, "Second extraction should succeed");
+    ASSERT_EQ(report.dedup_files, 5, "Every file is a duplicate of the first tree");
+    arc_extract_report_free(&report);
+    ASSERT_EQ(inode(first, "src/b.c"), inode(second, "vendor/b.c"), "Linked across trees");
+    for (size_t i = 1; i < DUP_COUNT; i++) {
+        ASSERT_TRUE(file_is(second, dup_entries[i].name, dup_entries[i].data, dup_entries[i].size), "Contents");
+    }
+
+    // Without an index the trees are independent
+    opts.dedup_index = NULL;
+    remove_tree(second, dup_names, DUP_NAME_COUNT);
+    ASSERT_EQ(extract(archive, second, &opts, &report), 0, "Extraction without index should succeed");
+    ASSERT_EQ(report.dedup_files, 3, "Only in-archive duplicates");
+    arc_extract_report_free(&report);
+    ASSERT_NE(inode(first, "src/b.c"), inode(second, "src/b.c"), "Not linked across trees");
+
+    remove_tree(first, dup_names, DUP_NAME_COUNT);
+    remove_tree(second, dup_names, DUP_NAME_COUNT);
+    unlink(index);
+    unlink(archive);
+    return true;
+}
+
+static bool test_large_files(void) {
+    char archive[256];
+    char dest[256];
+    snprintf(archive, sizeof(archive), "%s/large.zip", base_dir);
+    snprintf(dest, sizeof(dest), "%s/large", base_dir);
+    size_t size = 8 * 1024 * 1024 + 100;
+    size_t exact = 8 * 1024 * 1024;  // Exactly the spool limit: still deduplicated
+    uint8_t *data = fixture_pattern(size, 7);
+    FixtureEntry entries[] = {
+        { "big1", data, size, '0' },
+        { "big2", data, size, '0' },
+        { "small1", "tiny", 4, '0' },
+        { "small2", "tiny", 4, '0' },
+        { "exact1", data, exact, '0' },
+        { "exact2", data, exact, '0' },
+    };
+    ASSERT_TRUE(fixture_write_zip(archive, entries, 6, true), "Write fixture");
+
+    ArcExtractOptions opts = {0};
+    opts.dedup = ARC_DEDUP_HARDLINK;
+    ArcExtractReport report;
+    ASSERT_EQ(extract(archive, dest, &opts, &report), 0, "Extraction should succeed");
+    ASSERT_EQ(report.dedup_files, 2, "Files past the spool limit are written");
+    arc_extract_report_free(&report);
+    ASSERT_TRUE(file_is(dest, "big1", data, size), "big1 contents");
+    ASSERT_TRUE(file_is(dest, "big2", data, size), "big2 contents");
+    ASSERT_NE(inode(dest, "big1"), inode(dest, "big2"), "Large duplicates are not linked");
+    ASSERT_TRUE(file_is(dest, "exact2", data, exact), "exact2 contents");
+    ASSERT_EQ(inode(dest, "exact1"), inode(dest, "exact2"), "Files at the spool limit are linked");
+    free(data);
+
+    const char *names[] = { "big1", "big2", "small1", "small2", "exact1", "exact2" };
+    remove_tree(dest, names, 6);
+    unlink(archive);
+    return true;
+}
+
+static bool test_invalid(void) {
+    char archive[256];
+    snprintf(archive, sizeof(archive), "%s/dup.tar", base_dir);
+    ASSERT_TRUE(write_tar(archive, dup_entries, DUP_COUNT, NULL), "Write fixture");
+    ArcReader *reader = arc_open_path(archive);
+    ArcExtractOptions opts = {0};
+    opts.dedup = 0x10;
+    errno = 0;
+    ASSERT_EQ(arc_extract_to_path_ex(reader, base_dir, &opts, NULL), -1, "Unknown dedup flag");
+    ASSERT_EQ(errno, EINVAL, "Unknown dedup flag sets EINVAL");
+    opts.dedup = 0;
+    opts.hash_algorithms = ~ARC_HASH_ALL;
+    errno = 0;
+    ASSERT_EQ(arc_extract_to_path_ex(reader, base_dir, &opts, NULL), -1, "Unknown hash algorithm");
+    ASSERT_EQ(errno, EINVAL, "Unknown hash algorithm sets EINVAL");
+    ArcEntry entry;
+    ASSERT_EQ(arc_next(reader, &entry), 0, "Rejected before any entry is read");
+    ASSERT_STR_EQ(entry.path, dup_entries[0].name, "Reader still at the first entry");
+    arc_entry_free(&entry);
+    opts.hash_algorithms = 0;
+
+    char index[256];
+    snprintf(index, sizeof(index), "%s/missing/dir/index", base_dir);
+    opts.dedup = ARC_DEDUP_HARDLINK;
+    opts.dedup_index = index;
+    ASSERT_EQ(arc_extract_to_path_ex(reader, base_dir, &opts, NULL), -1, "Index that can't be written");
+    arc_close(reader);
+    remove_tree(base_dir, dup_names, DUP_NAME_COUNT);
+    mkdir(base_dir, 0755);
+    unlink(archive);
+    return true;
+}
+
+int main() {
+    printf("=== Dedup Tests ===\n\n");
+
+    snprintf(base_dir, sizeof(base_dir), "/tmp/cupidarchive_dedup_test_%ld", (long)getpid());
+    mkdir(base_dir, 0755);
+
+    RUN_TEST(test_hardlink);
+    RUN_TEST(test_reflink_fallback);
+    RUN_TEST(test_attributes_block_links);
+    RUN_TEST(test_rewritten_paths);
+    RUN_TEST(test_persistent_index);
+    RUN_TEST(test_large_files);
+    RUN_TEST(test_invalid);
+
+    rmdir(base_dir);
+
+    PRINT_SUMMARY();
+}
@@ -0,0 +1,238 @@
+#define _POSIX_C_SOURCE 200809L
+#include "test_runner.h"
+#include "test_fixtures.h"
+#include "../cupidarchive.h"
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+static char base_dir[128];
+static char path_a[192];
+static char path_b[192];
+
+#define MAX_ITEMS 16
+
+typedef struct Seen {
+    char path[64];
+    int kind;
+    unsigned changes;
+} Seen;
+
+typedef struct Diffs {
+    Seen items[MAX_ITEMS];
+    size_t count;
+    int reply;
+} Diffs;
+
+static int collect(const ArcDiffItem *item, void *user) {
+    Diffs *d = user;
+    if (d->count < MAX_ITEMS) {
+        snprintf(d->items[d->count].path, sizeof(d->items[0].path), "%s", item->path);
+        d->items[d->count].kind = item->kind;
+        d->items[d->count].changes = item->changes;
+    }
+    d->count++;
+    return d->reply;
+}
+
+static void set_paths(const char *a, const char *b) {
+    snprintf(path_a, sizeof(path_a), "%s/%s", base_dir, a);
+    snprintf(path_b, sizeof(path_b), "%s/%s", base_dir, b);
+}
+
+static int64_t diff_paths(const ArcDiffOptions *opts, Diffs *d) {
+    memset(d->items, 0, sizeof(d->items));
+    d->count = 0;
+    ArcReader *a = arc_open_path(path_a);
+    ArcReader *b = arc_open_path(path_b);
+    int64_t n = (a && b) ? arc_diff(a, b, opts, collect, d) : -2;
+    arc_close(a);
+    arc_close(b);
+    return n;
+}
+
+static bool write_tar_gz(const char *path, const FixtureEntry *files, size_t count, const unsigned *modes) {
+    uint8_t *tar = NULL;
+    size_t size = fixture_tar_modes(files, modes, count, &tar);
+    bool ok = size && fixture_write_gzip(path, tar, size);
+    free(tar);
+    return ok;
+}
+
+static const char text_a[] = "version one of the changelog, long enough to deflate";
+static const char text_b[] = "version two of the changelog, long enough to deflate";
+
+static const FixtureEntry old_files[] = {
+    { "changed.txt", text_a, sizeof(text_a) - 1, '0' },
+    { "dir/", NULL, 0, '5' },
+    { "dir/keep.txt", "same", 4, '0' },
+    { "gone.txt", "bye", 3, '0' },
+};
+
+static const FixtureEntry new_files[] = {
+    { "changed.txt", text_b, sizeof(text_b) - 1, '0' },
+    { "dir/", NULL, 0, '5' },
+    { "dir/keep.txt", "same", 4, '0' },
+    { "new.txt", "hello", 5, '0' },
+};
+
+bool test_zip_stored_crc() {
+    set_paths("old.zip", "new.zip");
+    ASSERT_TRUE(fixture_write_zip(path_a, old_files, 4, true), "Should write old zip");
+    ASSERT_TRUE(fixture_write_zip(path_b, new_files, 4, true), "Should write new zip");
+
+    Diffs d;
+    memset(&d, 0, sizeof(d));
+    ASSERT_EQ(diff_paths(NULL, &d), 3, "Should find three differences");
+    ASSERT_STR_EQ(d.items[0].path, "changed.txt", "Differences come in path order");
+    ASSERT_EQ(d.items[0].kind, ARC_DIFF_MODIFIED, "Same size, different CRC");
+    ASSERT_EQ(d.items[0].changes, ARC_DIFF_CONTENT, "Only the content changed");
+    ASSERT_STR_EQ(d.items[1].path, "gone.txt", "Removed entry");
+    ASSERT_EQ(d.items[1].kind, ARC_DIFF_REMOVED, "gone.txt is only in a");
+    ASSERT_STR_EQ(d.items[2].path, "new.txt", "Added entry");
+    ASSERT_EQ(d.items[2].kind, ARC_DIFF_ADDED, "new.txt is only in b");
+    return true;
+}
+
+// Entry data is never decoded: corrupt deflate data doesn't matter
+bool test_zip_data_not_read() {
+    set_paths("old.zip", "new.zip");
+    FILE *f = fopen(path_a, "r+b");
+    ASSERT_NOT_NULL(f, "Should open old zip");
+    uint8_t junk[8];
+    memset(junk, 0xFF, sizeof(junk));
+    fseek(f, 30 + (long)strlen("changed.txt"), SEEK_SET);
+    fwrite(junk, 1, sizeof(junk), f);
+    fclose(f);
+
+    ArcReader *r = arc_open_path(path_a);
+    ArcEntry entry;
+    ASSERT_EQ(arc_next(r, &entry), 0, "Should list first entry");
+    ArcStream *data = arc_open_data(r);
+    char buf[64];
+    ssize_t n = data ? arc_stream_read(data, buf, sizeof(buf)) : -1;
+    ASSERT_EQ(n, -1, "Corrupted entry data should not decode");
+    arc_stream_close(data);
+    arc_entry_free(&entry);
+    arc_close(r);
+
+    Diffs d;
+    memset(&d, 0, sizeof(d));
+    ASSERT_EQ(diff_paths(NULL, &d), 3, "Diff should still succeed from metadata");
+    ASSERT_EQ(d.items[0].changes, ARC_DIFF_CONTENT, "Stored CRCs still decide");
+    return true;
+}
+
+bool test_tar_quick_check_and_checksums() {
+    set_paths("old.tar.gz", "new.tar.gz");
+    ASSERT_TRUE(write_tar_gz(path_a, old_files, 4, NULL), "Should write old tar.gz");
+    const unsigned new_modes[] = { 0, 0, 0600, 0 };
+    ASSERT_TRUE(write_tar_gz(path_b, new_files, 4, new_modes), "Should write new tar.gz");
+
+    Diffs d;
+    memset(&d, 0, sizeof(d));
+    ASSERT_EQ(diff_paths(NULL, &d), 3, "Same size and mtime pass the quick check");
+    ASSERT_STR_EQ(d.items[0].path, "dir/keep.txt", "Mode change is reported");
+    ASSERT_EQ(d.items[0].kind, ARC_DIFF_MODIFIED, "keep.txt is modified");
+    ASSERT_EQ(d.items[0].changes, ARC_DIFF_MODE, "Only the mode changed");
+
+    ArcDiffOptions opts = { ARC_DIFF_CHECKSUM_DATA };
+    ASSERT_EQ(diff_paths(&opts, &d), 4, "Checksums catch the same-size change");
+    ASSERT_STR_EQ(d.items[0].path, "changed.txt", "changed.txt first");
+    ASSERT_EQ(d.items[0].changes, ARC_DIFF_CONTENT, "Content differs");
+
+    opts.flags |= ARC_DIFF_IGNORE_MODE;
+    ASSERT_EQ(diff_paths(&opts, &d), 3, "Mode changes can be ignored");
+    return true;
+}
+
+bool test_cross_format() {
+    set_paths("old.zip", "cross.tar.gz");
+    ASSERT_TRUE(fixture_write_zip(path_a, old_files, 4, false), "Should write zip");
+    ASSERT_TRUE(write_tar_gz(path_b, old_files, 4, NULL), "Should write tar.gz");
+
+    Diffs d;
+    memset(&d, 0, sizeof(d));
+    ArcDiffOptions opts = { ARC_DIFF_CHECKSUM_DATA | ARC_DIFF_IGNORE_MTIME };
+    ASSERT_EQ(diff_paths(&opts, &d), 0, "Same files: ZIP CRCs match computed TAR CRCs");
+
+    opts.flags = ARC_DIFF_CHECKSUM_DATA;
+    ASSERT_EQ(diff_paths(&opts, &d), 4, "DOS and Unix mtimes differ for every entry");
+    ASSERT_STR_EQ(d.items[1].path, "dir", "Directory paths match with or without a trailing slash");
+    ASSERT_EQ(d.items[1].changes, ARC_DIFF_MTIME, "Only the mtime differs");
+    return true;
+}
+
+// tar -C dir . writes "./" names; the ZIP of the same tree has none
+bool test_dot_slash_tar_vs_zip() {
+    set_paths("old.zip", "dotted.tar.gz");
+    FixtureEntry dotted[] = {
+        { "./", NULL, 0, '5' },
+        { "./changed.txt", text_a, sizeof(text_a) - 1, '0' },
+        { "./dir/", NULL, 0, '5' },
+        { "./dir//keep.txt", "same", 4, '0' },
+        { "././gone.txt", "bye", 3, '0' },
+    };
+    ASSERT_TRUE(fixture_write_zip(path_a, old_files, 4, true), "Should write zip");
+    ASSERT_TRUE(write_tar_gz(path_b, dotted, 5, NULL), "Should write ./ tar.gz");
+
+    Diffs d;
+    memset(&d, 0, sizeof(d));
+    ArcDiffOptions opts = { ARC_DIFF_CHECKSUM_DATA | ARC_DIFF_IGNORE_MTIME };
+    ASSERT_EQ(diff_paths(&opts, &d), 1, "Only the root directory entry differs");
+    ASSERT_STR_EQ(d.items[0].path, ".", "The root is reported as .");
+    ASSERT_EQ(d.items[0].kind, ARC_DIFF_ADDED, "The ZIP has no root entry");
+    return true;
+}
+
+bool test_duplicates_and_early_stop() {
+    set_paths("dup.tar.gz", "new.tar.gz");
+    FixtureEntry dup[] = {
+        { "changed.txt", text_a, sizeof(text_a) - 1, '0' },
+        { "dir/", NULL, 0, '5' },
+        { "dir/keep.txt", "same", 4, '0' },
+        { "new.txt", "hello", 5, '0' },
+        { "changed.txt", text_b, sizeof(text_b) - 1, '0' },
+    };
+    const unsigned dup_modes[] = { 0, 0, 0600, 0, 0 };
+    ASSERT_TRUE(write_tar_gz(path_a, dup, 5, dup_modes), "Should write tar.gz with a duplicate");
+
+    Diffs d;
+    memset(&d, 0, sizeof(d));
+    ArcDiffOptions opts = { ARC_DIFF_CHECKSUM_DATA };
+    ASSERT_EQ(diff_paths(&opts, &d), 0, "The last duplicate wins");
+
+    set_paths("old.tar.gz", "new.tar.gz");
+    d.reply = 1;
+    ASSERT_EQ(diff_paths(&opts, &d), 1, "Callback can stop the diff");
+    ASSERT_EQ(d.count, 1, "No callbacks after stopping");
+
+    errno = 0;
+    ASSERT_EQ(arc_diff(NULL, NULL, NULL, collect, &d), -1, "NULL readers should fail");
+    ASSERT_EQ(errno, EINVAL, "Should report EINVAL");
+    return true;
+}
+
+int main() {
+    printf("=== Archive Diff Tests ===\n\n");
+
+    snprintf(base_dir, sizeof(base_dir), "/tmp/cupidarchive_diff_test_%ld", (long)getpid());
+    mkdir(base_dir, 0755);
+
+    RUN_TEST(test_zip_stored_crc);
+    RUN_TEST(test_zip_data_not_read);
+    RUN_TEST(test_tar_quick_check_and_checksums);
+    RUN_TEST(test_cross_format);
+    RUN_TEST(test_dot_slash_tar_vs_zip);
+    RUN_TEST(test_duplicates_and_early_stop);
+
+    static const char *names[] = { "old.zip", "new.zip", "old.tar.gz", "new.tar.gz", "cross.tar.gz", "dup.tar.gz" };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        set_paths(names[i], names[i]);
+        unlink(path_a);
+    }
+    rmdir(base_dir);
+
+    PRINT_SUMMARY();
+}
@@ -0,0 +1,275 @@
+#define _POSIX_C_SOURCE 200809L
+#include "test_runner.h"
+#include "test_fixtures.h"
+#include "../cupidarchive.h"
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <bzlib.h>
+#include <zlib.h>
+#include <sys/stat.h>
+
+static char base_dir[128];
+static char path_buf[192];
+
+#define BIG_SIZE (3 * 1024 * 1024 + 777)
+#define LEAD_SIZE (2 * 1024 * 1024 + 5)
+
+static uint8_t *big;
+static uint8_t *lead;
+
+static const char *archive(const char *name) {
+    snprintf(path_buf, sizeof(path_buf), "%s/%s", base_dir, name);
+    return path_buf;
+}
+
+// Compare a spread of ranges (start, middle, across checkpoints, tail) against the source
+static bool check_ranges(ArcEntryHandle *h, const uint8_t *expect, size_t size) {
+    static const uint64_t offsets[] = { 0, 1, 4095, 1024 * 1024 - 3, 1024 * 1024 + 17,
+                                        2 * 1024 * 1024 + 100000, 3 * 1024 * 1024 };
+    uint8_t buf[70000];
+    for (size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i++) {
+        uint64_t off = offsets[i];
+        if (off >= size) {
+            continue;
+        }
+        size_t want = sizeof(buf);
+        if (want > size - off) {
+            want = (size_t)(size - off);
+        }
+        ssize_t got = arc_entry_pread(h, buf, sizeof(buf), off);
+        ASSERT_EQ(got, (ssize_t)want, "Range read should be clamped to the entry");
+        ASSERT(memcmp(buf, expect + off, want) == 0, "Range data should match");
+    }
+    // One sequential stream over a long range, clamped to the entry
+    uint64_t range_start = size / 3;
+    ArcStream *range = arc_entry_open_range(h, range_start, size);
+    ASSERT_NOT_NULL(range, "Should open a range stream");
+    uint64_t pos = range_start;
+    ssize_t got;
+    while ((got = arc_stream_read(range, buf, sizeof(buf))) > 0) {
+        ASSERT(memcmp(buf, expect + pos, (size_t)got) == 0, "Range stream data should match");
+        pos += (uint64_t)got;
+    }
+    arc_stream_close(range);
+    ASSERT_EQ(got, 0, "Range stream should end cleanly");
+    ASSERT_EQ(pos, (uint64_t)size, "Range stream should stop at the end of the entry");
+    ASSERT_EQ(arc_entry_pread(h, buf, 10, size), 0, "Read at the end should return 0");
+    ASSERT_EQ(arc_entry_pread(h, buf, 10, size + 100), 0, "Read past the end should return 0");
+    return true;
+}
+
+static bool check_archive(const char *path, const char *entry_name) {
+    ArcReader *reader = arc_open_path(path);
+    ASSERT_NOT_NULL(reader, "Should open archive");
+    ArcEntryHandle *h = arc_entry_open(reader, entry_name);
+    ASSERT_NOT_NULL(h, "Should open entry handle");
+    arc_close(reader); // Handle is independent of the reader
+    ASSERT_EQ(arc_entry_handle_size(h), BIG_SIZE, "Handle size should match");
+    bool ok = check_ranges(h, big, BIG_SIZE);
+    arc_entry_close(h);
+    return ok;
+}
+
+bool test_zip_stored() {
+    FixtureEntry files[] = { { "media/big.bin", big, BIG_SIZE, '0' } };
+    ASSERT_TRUE(fixture_write_zip(archive("stored.zip"), files, 1, false), "Should write zip");
+    return check_archive(path_buf, "media/big.bin");
+}
+
+bool test_zip_deflate() {
+    FixtureEntry files[] = {
+        { "media/", NULL, 0, '5' },
+        { "media/lead.bin", lead, LEAD_SIZE, '0' },
+        { "media/big.bin", big, BIG_SIZE, '0' },
+    };
+    ASSERT_TRUE(fixture_write_zip(archive("deflate.zip"), files, 3, true), "Should write zip");
+    if (!check_archive(path_buf, "media/big.bin")) {
+        return false;
+    }
+
+    ArcReader *reader = arc_open_path(path_buf);
+    ASSERT_NOT_NULL(reader, "Should open archive");
+    ArcEntryHandle *h = arc_entry_open_index(reader, 1);
+    ASSERT_NOT_NULL(h, "Should open entry by index");
+    ASSERT_EQ(arc_entry_handle_size(h), LEAD_SIZE, "Index 1 should be lead.bin");
+    arc_entry_close(h);
+
+    errno = 0;
+    ASSERT_NULL(arc_entry_open(reader, "media/"), "Directories have no data");
+    ASSERT_EQ(errno, EISDIR, "Directory should report EISDIR");
+    errno = 0;
+    ASSERT_NULL(arc_entry_open(reader, "media/missing"), "Missing entry should fail");
+    ASSERT_EQ(errno, ENOENT, "Missing entry should report ENOENT");
+    arc_close(reader);
+    return true;
+}
+
+// The entry under test sits behind another large one, so it starts mid-stream
+static size_t build_tar(uint8_t **tar_out) {
+    FixtureEntry files[] = {
+        { "lead.bin", lead, LEAD_SIZE, '0' },
+        { "big.bin", big, BIG_SIZE, '0' },
+    };
+    return fixture_tar(files, 2, tar_out);
+}
+
+bool test_tar_plain_and_gzip() {
+    uint8_t *tar = NULL;
+    size_t size = build_tar(&tar);
+    ASSERT(size > 0, "Should build tar");
+    bool ok = fixture_write_file(archive("media.tar"), tar, size) && check_archive(path_buf, "big.bin");
+    ok = ok && fixture_write_gzip(archive("media.tar.gz"), tar, size) && check_archive(path_buf, "big.bin");
+    free(tar);
+    ASSERT_TRUE(ok, "Plain and gzip TAR ranges should match");
+    return true;
+}
+
+// pigz-style output: the gzip member boundary falls inside big.bin
+bool test_tar_gzip_members() {
+    uint8_t *tar = NULL;
+    size_t size = build_tar(&tar);
+    ASSERT(size > 0, "Should build tar");
+    size_t split = LEAD_SIZE + 1024 + BIG_SIZE / 2 + 3;
+    gzFile gz = gzopen(archive("members.tar.gz"), "wb1");
+    bool ok = gz && gzwrite(gz, tar, (unsigned)split) == (int)split && gzclose(gz) == Z_OK;
+    gz = ok ? gzopen(path_buf, "ab1") : NULL;
+    ok = gz && gzwrite(gz, tar + split, (unsigned)(size - split)) == (int)(size - split) && gzclose(gz) == Z_OK;
+    free(tar);
+    ASSERT_TRUE(ok, "Should write two gzip members");
+
+    ArcReader *reader = arc_open_path(path_buf);
+    ASSERT_NOT_NULL(reader, "Should open multi-member tar.gz");
+    ArcEntry entry;
+    ASSERT_EQ(arc_next(reader, &entry), 0, "Should list lead.bin");
+    arc_entry_free(&entry);
+    ASSERT_EQ(arc_next(reader, &entry), 0, "Should list big.bin");
+    ok = strcmp(entry.path, "big.bin") == 0;
+    arc_entry_free(&entry);
+    ASSERT_TRUE(ok, "Second entry should be big.bin");
+    ASSERT_EQ(arc_next(reader, &entry), 1, "Should list past the member boundary to the end");
+    arc_close(reader);
+    return check_archive(path_buf, "big.bin");
+}
+
+bool test_tar_bzip2_fallback() {
+    uint8_t *tar = NULL;
+    size_t size = build_tar(&tar);
+    ASSERT(size > 0, "Should build tar");
+    unsigned int packed_size = (unsigned int)(size + size / 100 + 600);
+    char *packed = malloc(packed_size);
+    ASSERT_NOT_NULL(packed, "Should allocate");
+    int ret = BZ2_bzBuffToBuffCompress(packed, &packed_size, (char *)tar, (unsigned int)size, 1, 0, 0);
+    free(tar);
+    bool ok = ret == BZ_OK && fixture_write_file(archive("media.tar.bz2"), packed, packed_size);
+    free(packed);
+    ASSERT_TRUE(ok, "Should write tar.bz2");
+
+    ArcReader *reader = arc_open_path(path_buf);
+    ASSERT_NOT_NULL(reader, "Should open tar.bz2");
+    ArcEntryHandle *h = arc_entry_open(reader, "big.bin");
+    arc_close(reader);
+    ASSERT_NOT_NULL(h, "Should open handle on tar.bz2 entry");
+    uint8_t buf[4096];
+    ASSERT_EQ(arc_entry_pread(h, buf, sizeof(buf), 2000000), (ssize_t)sizeof(buf), "Should decode range");
+    ASSERT(memcmp(buf, big + 2000000, sizeof(buf)) == 0, "bzip2 range should match");
+    arc_entry_close(h);
+    return true;
+}
+
+typedef struct ReaderArgs {
+    ArcEntryHandle *handle;
+    uint32_t seed;
+    int failures;
+} ReaderArgs;
+
+static void *range_worker(void *arg) {
+    ReaderArgs *args = arg;
+    uint8_t buf[20000];
+    uint32_t x = args->seed;
+    for (int i = 0; i < 20; i++) {
+        x = x * 1103515245u + 12345u;
+        uint64_t off = (x >> 4) % BIG_SIZE;
+        size_t want = sizeof(buf);
+        if (want > BIG_SIZE - off) {
+            want = (size_t)(BIG_SIZE - off);
+        }
+        ssize_t got = arc_entry_pread(args->handle, buf, sizeof(buf), off);
+        if (got != (ssize_t)want || memcmp(buf, big + off, want) != 0) {
+            args->failures++;
+        }
+    }
+    return NULL;
+}
+
+bool test_concurrent_preads() {
+    // Reuses the .tar.gz written above
+    ArcReader *reader = arc_open_path(archive("media.tar.gz"));
+    ASSERT_NOT_NULL(reader, "Should open tar.gz");
+    ArcEntryHandle *h = arc_entry_open(reader, "big.bin");
+    arc_close(reader);
+    ASSERT_NOT_NULL(h, "Should open handle");
+
+    pthread_t threads[4];
+    ReaderArgs args[4];
+    for (int i = 0; i < 4; i++) {
+        args[i].handle = h;
+        args[i].seed = (uint32_t)(i + 1);
+        args[i].failures = 0;
+        ASSERT_EQ(pthread_create(&threads[i], NULL, range_worker, &args[i]), 0, "Should start thread");
+    }
+    int failures = 0;
+    for (int i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+        failures += args[i].failures;
+    }
+    arc_entry_close(h);
+    ASSERT_EQ(failures, 0, "Concurrent range reads should all match");
+    return true;
+}
+
+bool test_memory_stream_unsupported() {
+    FixtureEntry files[] = { { "a.txt", "a", 1, '0' } };
+    uint8_t *tar = NULL;
+    size_t size = fixture_tar(files, 1, &tar);
+    ArcStream *stream = arc_stream_from_memory(tar, size, 0);
+    ArcReader *reader = arc_open_stream(stream);
+    ASSERT_NOT_NULL(reader, "Should open memory tar");
+    errno = 0;
+    ASSERT_NULL(arc_entry_open(reader, "a.txt"), "Memory-backed archives have no descriptor");
+    ASSERT_EQ(errno, ENOTSUP, "Should report ENOTSUP");
+    arc_close(reader);
+    free(tar);
+    ASSERT_NULL(arc_entry_open(NULL, "a.txt"), "NULL reader should fail");
+    ASSERT_EQ(arc_entry_pread(NULL, NULL, 0, 0), -1, "NULL handle should fail");
+    return true;
+}
+
+int main() {
+    printf("=== Entry Positional Read Tests ===\n\n");
+
+    snprintf(base_dir, sizeof(base_dir), "/tmp/cupidarchive_entry_test_%ld", (long)getpid());
+    mkdir(base_dir, 0755);
+    big = fixture_pattern(BIG_SIZE, 11);
+    lead = fixture_pattern(LEAD_SIZE, 5);
+
+    RUN_TEST(test_zip_stored);
+    RUN_TEST(test_zip_deflate);
+    RUN_TEST(test_tar_plain_and_gzip);
+    RUN_TEST(test_tar_gzip_members);
+    RUN_TEST(test_tar_bzip2_fallback);
+    RUN_TEST(test_concurrent_preads);
+    RUN_TEST(test_memory_stream_unsupported);
+
+    const char *names[] = { "stored.zip", "deflate.zip", "media.tar", "media.tar.gz", "members.tar.gz",
+                            "media.tar.bz2" };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        unlink(archive(names[i]));
+    }
+    rmdir(base_dir);
+    free(big);
+    free(lead);
+
+    PRINT_SUMMARY();
+}
@@ -1,5 +1,6 @@
 #define _POSIX_C_SOURCE 200809L
 #include "test_runner.h"
+#include "test_fixtures.h"
 #include "../cupidarchive.h"
 #include <unistd.h>
 #include <fcntl.h>
@@ -75,6 +76,119 @@ bool test_extract_entry_invalid_dest() {
     return true;
 }
 
+// Compare an extracted file with the expected data
+static bool extracted_is(const char *dir, const char *name, const uint8_t *data, size_t size) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return false;
+    }
+    uint8_t buf[65536];
+    size_t pos = 0;
+    size_t n;
+    bool same = true;
+    while (same && (n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        same = pos + n <= size && memcmp(buf, data + pos, n) == 0;
+        pos += n;
+    }
+    fclose(f);
+    return same && pos == size;
+}
+
+// Extract an archive with SHA-256 digests and check every file against data
+static bool check_large_extraction(const char *archive, const char *dest, const FixtureEntry *entries, size_t count) {
+    mkdir(dest, 0755);
+    ArcReader *reader = arc_open_path(archive);
+    ASSERT_NOT_NULL(reader, "Archive should open");
+    ArcExtractOptions opts = {0};
+    opts.hash_algorithms = ARC_HASH_SHA256;
+    ArcExtractReport report;
+    ASSERT_EQ(arc_extract_to_path_ex(reader, dest, &opts, &report), 0, "Extraction should succeed");
+    arc_close(reader);
+    ASSERT_EQ(report.count, count, "Every file should be reported");
+    for (size_t i = 0; i < count; i++) {
+        ASSERT_TRUE(extracted_is(dest, entries[i].name, entries[i].data, entries[i].size), "Extracted contents");
+        ASSERT_EQ(report.files[i].size, entries[i].size, "Reported size");
+        ArcHasher *hasher = arc_hasher_new(ARC_HASH_SHA256);
+        ArcDigests expected;
+        arc_hasher_update(hasher, entries[i].data, entries[i].size);
+        arc_hasher_final(hasher, &expected);
+        arc_hasher_free(hasher);
+        ASSERT_TRUE(memcmp(report.files[i].digests.sha256, expected.sha256, ARC_SHA256_SIZE) == 0,
+                    "Digest of the data written");
+    }
+    arc_extract_report_free(&report);
+
+    char path[512];
+    for (size_t i = 0; i < count; i++) {
+        snprintf(path, sizeof(path), "%s/%s", dest, entries[i].name);
+        unlink(path);
+    }
+    rmdir(dest);
+    return true;
+}
+
+// Files above the mmap threshold are decoded straight into the destination
+bool test_extract_large_files() {
+    char base[128];
+    snprintf(base, sizeof(base), "/tmp/cupidarchive_extract_test_%ld", (long)getpid());
+    mkdir(base, 0755);
+    size_t big_size = 3 * 1024 * 1024 + 5;
+    uint8_t *big = fixture_pattern(big_size, 11);
+    uint8_t *exact = fixture_pattern(1024 * 1024, 12);
+    FixtureEntry entries[] = {
+        { "big.bin", big, big_size, '0' },
+        { "exact.bin", exact, 1024 * 1024, '0' },   // At the threshold
+        { "small.txt", "small", 5, '0' },
+    };
+
+    char tar_path[256], tgz_path[256], zip_path[256], dest[256];
+    snprintf(tar_path, sizeof(tar_path), "%s/large.tar", base);
+    snprintf(tgz_path, sizeof(tgz_path), "%s/large.tar.gz", base);
+    snprintf(zip_path, sizeof(zip_path), "%s/large.zip", base);
+    snprintf(dest, sizeof(dest), "%s/out", base);
+    uint8_t *tar;
+    size_t tar_size = fixture_tar(entries, 3, &tar);
+    ASSERT_TRUE(fixture_write_file(tar_path, tar, tar_size), "Write TAR");
+    ASSERT_TRUE(fixture_write_gzip(tgz_path, tar, tar_size), "Write tar.gz");
+    ASSERT_TRUE(fixture_write_zip(zip_path, entries, 3, true), "Write ZIP");
+    free(tar);
+
+    ASSERT_TRUE(check_large_extraction(tar_path, dest, entries, 3), "TAR extraction");
+    ASSERT_TRUE(check_large_extraction(tgz_path, dest, entries, 3), "tar.gz extraction");
+    ASSERT_TRUE(check_large_extraction(zip_path, dest, entries, 3), "Deflated ZIP extraction");
+
+    free(big);
+    free(exact);
+    unlink(tar_path);
+    unlink(tgz_path);
+    unlink(zip_path);
+    rmdir(base);
+    return true;
+}
+
+// A file spanning several mapping windows
+bool test_extract_mapped_windows() {
+    char base[128];
+    snprintf(base, sizeof(base), "/tmp/cupidarchive_extract_test_%ld", (long)getpid());
+    mkdir(base, 0755);
+    size_t size = 65 * 1024 * 1024 + 123;
+    uint8_t *data = fixture_pattern(size, 13);
+    FixtureEntry entries[] = { { "huge.bin", data, size, '0' } };
+
+    char zip_path[256], dest[256];
+    snprintf(zip_path, sizeof(zip_path), "%s/huge.zip", base);
+    snprintf(dest, sizeof(dest), "%s/out", base);
+    ASSERT_TRUE(fixture_write_zip(zip_path, entries, 1, false), "Write stored ZIP");
+    ASSERT_TRUE(check_large_extraction(zip_path, dest, entries, 1), "Extraction across windows");
+
+    free(data);
+    unlink(zip_path);
+    rmdir(base);
+    return true;
+}
+
 int main() {
     printf("=== ArcExtract Tests ===\n\n");
     
@@ -83,6 +197,8 @@ int main() {
     RUN_TEST(test_extract_entry_null_reader);
     RUN_TEST(test_extract_entry_null_entry);
     RUN_TEST(test_extract_entry_invalid_dest);
+    RUN_TEST(test_extract_large_files);
+    RUN_TEST(test_extract_mapped_windows);
     
     PRINT_SUMMARY();
 }
@@ -0,0 +1,243 @@
+#define _POSIX_C_SOURCE 200809L
+#include "test_runner.h"
+#include "test_fixtures.h"
+#include "../cupidarchive.h"
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+static char base_dir[128];
+static char path_buf[256];
+
+#define DATA_SIZE (3 * 1024 * 1024 + 12345)
+
+static uint8_t *input;
+
+static const char *fixture_path(const char *name) {
+    snprintf(path_buf, sizeof(path_buf), "%s/%s", base_dir, name);
+    return path_buf;
+}
+
+// Compress data into a file with the given options, in writes of `step` bytes
+static bool compress_file(const char *path, const uint8_t *data, size_t size,
+                          const ArcGzipWriteOptions *opts, size_t step) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    ArcOutStream *out = arc_out_stream_from_fd(fd);
+    ArcOutStream *gz = arc_filter_gzip_write(out, opts);
+    bool ok = gz != NULL;
+    for (size_t off = 0; ok && off < size; off += step) {
+        size_t n = size - off < step ? size - off : step;
+        ok = arc_out_stream_write(gz, data + off, n) == 0;
+    }
+    ok = ok && arc_out_stream_finish(gz) == 0;
+    arc_out_stream_close(gz);
+    arc_out_stream_close(out);
+    close(fd);
+    return ok;
+}
+
+// Decompress a file with the gzip read filter
+static uint8_t *decompress_file(const char *path, size_t *size) {
+    *size = 0;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    ArcStream *file = arc_stream_from_fd(fd, 0);
+    ArcStream *gz = file ? arc_filter_gzip(file, 0) : NULL;
+    size_t capacity = DATA_SIZE + 1;
+    uint8_t *buf = gz ? malloc(capacity) : NULL;
+    ssize_t n;
+    while (buf && (n = arc_stream_read(gz, buf + *size, capacity - *size)) > 0) {
+        *size += (size_t)n;
+    }
+    if (buf && n < 0) {
+        free(buf);
+        buf = NULL;
+    }
+    arc_stream_close(gz);
+    arc_stream_close(file);
+    return buf;
+}
+
+static uint8_t *read_file(const char *path, size_t *size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    *size = (size_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *data = malloc(*size + 1);
+    if (data && fread(data, 1, *size, f) != *size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    return data;
+}
+
+bool test_parallel_roundtrip() {
+    const char *path = fixture_path("data.gz");
+    ArcGzipWriteOptions opts = { 6, 4, 16 * 1024 };
+    ASSERT_TRUE(compress_file(path, input, DATA_SIZE, &opts, 1 << 20), "Should compress on 4 threads");
+
+    size_t size;
+    uint8_t *out = decompress_file(path, &size);
+    ASSERT_NOT_NULL(out, "Should decompress as one gzip member");
+    bool same = size == DATA_SIZE && memcmp(out, input, size) == 0;
+    free(out);
+    ASSERT_TRUE(same, "Content roundtrips");
+
+    size_t gz_size;
+    uint8_t *gz = read_file(path, &gz_size);
+    ASSERT_NOT_NULL(gz, "Should read gzip file");
+    ASSERT_TRUE(gz_size < DATA_SIZE * 2 / 3, "Data is compressed (16-symbol pattern: 4 bits per byte)");
+    ASSERT_EQ(gz[0], 0x1f, "gzip magic");
+    ASSERT_EQ(gz[1], 0x8b, "gzip magic");
+    uint32_t crc = (uint32_t)gz[gz_size - 8] | (uint32_t)gz[gz_size - 7] << 8 |
+                   (uint32_t)gz[gz_size - 6] << 16 | (uint32_t)gz[gz_size - 5] << 24;
+    uint32_t isize = (uint32_t)gz[gz_size - 4] | (uint32_t)gz[gz_size - 3] << 8 |
+                     (uint32_t)gz[gz_size - 2] << 16 | (uint32_t)gz[gz_size - 1] << 24;
+    ASSERT_EQ(crc, (uint32_t)crc32(0L, input, DATA_SIZE), "Combined CRC matches");
+    ASSERT_EQ(isize, DATA_SIZE, "ISIZE matches");
+
+    // Same blocks on one thread give the same bytes
+    const char *single = fixture_path("single.gz");
+    ArcGzipWriteOptions one = { 6, 1, 16 * 1024 };
+    ASSERT_TRUE(compress_file(single, input, DATA_SIZE, &one, 1 << 20), "Should compress on one thread");
+    size_t single_size;
+    uint8_t *single_gz = read_file(single, &single_size);
+    same = single_gz && single_size == gz_size && memcmp(single_gz, gz, gz_size) == 0;
+    free(single_gz);
+    free(gz);
+    ASSERT_TRUE(same, "Output does not depend on the thread count");
+    unlink(single);
+    return true;
+}
+
+bool test_write_sizes() {
+    // Odd write sizes cross block boundaries at every offset
+    char a[256], b[256];
+    snprintf(a, sizeof(a), "%s/a.gz", base_dir);
+    snprintf(b, sizeof(b), "%s/b.gz", base_dir);
+    ArcGzipWriteOptions opts = { 1, 3, 4096 };
+    ASSERT_TRUE(compress_file(a, input, 200000, &opts, 200000), "One write");
+    ASSERT_TRUE(compress_file(b, input, 200000, &opts, 777), "Many small writes");
+    size_t a_size, b_size;
+    uint8_t *a_data = read_file(a, &a_size);
+    uint8_t *b_data = read_file(b, &b_size);
+    bool same = a_data && b_data && a_size == b_size && memcmp(a_data, b_data, a_size) == 0;
+    free(a_data);
+    free(b_data);
+    ASSERT_TRUE(same, "Write sizes don't change the output");
+    unlink(a);
+    unlink(b);
+
+    // No input at all still makes a valid gzip file
+    const char *empty = fixture_path("empty.gz");
+    ASSERT_TRUE(compress_file(empty, input, 0, NULL, 1), "Should compress nothing");
+    size_t size = 1;
+    uint8_t *out = decompress_file(empty, &size);
+    ASSERT_NOT_NULL(out, "Empty gzip decodes");
+    ASSERT_EQ(size, 0, "No data");
+    free(out);
+    unlink(empty);
+    return true;
+}
+
+bool test_tar_gz() {
+    const char *path = fixture_path("snapshot.tar.gz");
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ASSERT_TRUE(fd >= 0, "Should create tar.gz");
+    ArcOutStream *out = arc_out_stream_from_fd(fd);
+    ArcGzipWriteOptions opts = { 0, 4, 64 * 1024 };
+    ArcOutStream *gz = arc_filter_gzip_write(out, &opts);
+    ASSERT_NOT_NULL(gz, "Should create gzip filter");
+    ArcTarWriter *tar = arc_tar_writer_new_stream(gz, NULL);
+    ASSERT_NOT_NULL(tar, "Should create TAR writer on the filter");
+    for (int i = 0; i < 5; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "part%d.bin", i);
+        ArcStream *data = arc_stream_from_memory(input + i * 500000, 500000, 0);
+        ArcTarEntryInfo info = { 0644, 1600000000, 0, 0, 500000, NULL, false };
+        ASSERT_EQ(arc_tar_writer_add_stream(tar, name, data, &info), 0, "Should add entry");
+        arc_stream_close(data);
+    }
+    ASSERT_EQ(arc_tar_writer_finish(tar), 0, "Should finish TAR");
+    ASSERT_EQ(arc_out_stream_finish(gz), 0, "Should finish gzip");
+    ASSERT_TRUE(gz->bytes_written > 5 * 500000, "Filter counts its input");
+    ASSERT_TRUE(out->bytes_written < gz->bytes_written, "Underlying stream counts compressed bytes");
+    arc_out_stream_close(gz);
+    arc_out_stream_close(out);
+    close(fd);
+
+    ArcReader *r = arc_open_path(path);
+    ASSERT_NOT_NULL(r, "Should open tar.gz");
+    ArcEntry entry;
+    int count = 0;
+    bool same = true;
+    uint8_t *buf = malloc(500000);
+    while (arc_next(r, &entry) == 0) {
+        ArcStream *data = arc_open_data(r);
+        size_t len = 0;
+        ssize_t n;
+        while (data && (n = arc_stream_read(data, buf + len, 500000 - len)) > 0) {
+            len += (size_t)n;
+        }
+        arc_stream_close(data);
+        same = same && len == 500000 && memcmp(buf, input + count * 500000, len) == 0;
+        arc_entry_free(&entry);
+        count++;
+    }
+    free(buf);
+    arc_close(r);
+    ASSERT_EQ(count, 5, "All entries listed");
+    ASSERT_TRUE(same, "Entry data roundtrips");
+
+    r = arc_open_path(path);
+    ArcTestReport report;
+    ASSERT_EQ(arc_test(r, NULL, &report), 0, "gzip trailer verifies");
+    arc_test_report_free(&report);
+    arc_close(r);
+    return true;
+}
+
+bool test_invalid() {
+    errno = 0;
+    ASSERT_NULL(arc_filter_gzip_write(NULL, NULL), "NULL stream should fail");
+    ASSERT_EQ(errno, EINVAL, "Should report EINVAL");
+    ArcOutStream *out = arc_out_stream_from_fd(STDOUT_FILENO);
+    ArcGzipWriteOptions opts = { 10, 1, 0 };
+    ASSERT_NULL(arc_filter_gzip_write(out, &opts), "Bad level should fail");
+    ASSERT_EQ(arc_out_stream_fd(out), STDOUT_FILENO, "Descriptor is exposed");
+    ASSERT_NULL(arc_out_stream_from_fd(-1), "Bad descriptor should fail");
+    arc_out_stream_close(out);
+    ASSERT_EQ(arc_out_stream_write(NULL, "x", 1), -1, "NULL stream write should fail");
+    return true;
+}
+
+int main() {
+    printf("=== Gzip Write Filter Tests ===\n\n");
+
+    snprintf(base_dir, sizeof(base_dir), "/tmp/cupidarchive_gzw_test_%ld", (long)getpid());
+    mkdir(base_dir, 0755);
+    input = fixture_pattern(DATA_SIZE, 5);
+
+    RUN_TEST(test_parallel_roundtrip);
+    RUN_TEST(test_write_sizes);
+    RUN_TEST(test_tar_gz);
+    RUN_TEST(test_invalid);
+
+    free(input);
+    unlink(fixture_path("data.gz"));
+    unlink(fixture_path("snapshot.tar.gz"));
+    rmdir(base_dir);
+
+    PRINT_SUMMARY();
+}
@@ -0,0 +1,367 @@
+#define _POSIX_C_SOURCE 200809L
+#include "test_runner.h"
+#include "test_fixtures.h"
+#include "../cupidarchive.h"
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/xattr.h>
+#endif
+
+static char base_dir[128];
+static char path_buf[256];
+
+// Digests of fixture_pattern(size, 7), from Python's hashlib, blake3 and xxhash
+typedef struct Vector {
+    size_t size;
+    const char *sha256;
+    const char *blake3;
+    const char *xxh3;
+} Vector;
+
+static const Vector vectors[] = {
+    {       0, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+               "af1349b9f5f9a1a6a0404dea36dcc9499bcb25c9adc112b7cc9a93cae41f3262",
+               "2d06800538d394c2" },
+    {       3, "4b6f50ec6e0629790e0dad1d0b5b83437ff8f01d35a7150ebc92bbedd0805b78",
+               "9d814cabbaa944f9743307a4e4302419e72b2fe83e61a038b21a1165057a01e6",
+               "0d731a5e00307605" },
+    {       8, "97713ab1700981b2105a7582fb9eb2199c294e74002a95409237c89512baa324",
+               "69974139d64531e4476037d143067600bbaa4c040ba01d1d18ab258e68c68787",
+               "a2688f2c6510f7a6" },
+    {      16, "b7016d0f1849d3116a9168b16e0d3faa830d6445d227b884d5a6c2c4cfe1589a",
+               "c314e1102436349cbef2d46e320a239a3b4bf2fcde45d32b2212256d9fbb4cb0",
+               "e01e3a05dae0d64e" },
+    {     128, "66e8cb6209229f78d8587112f5e02c275a71ade3ed1562f0f12799b1af2eaad6",
+               "0bd84d60ee2b3b3eeefa8798769db4de4d1058be361af0e09d9cbb091c791a26",
+               "def08e9f49107f45" },
+    {     240, "9a1637eeaa2d3fc0f6406234dfdc7a396892aadfa18d25ff416d122fa6eeff16",
+               "10af49cddfd36fbc6d53dd9c065086305dfbae0096323abe083d76c748b89c11",
+               "51ee4e4115ab39e2" },
+    {     241, "47822f7752570e61480812f8d9f882bbd665602105f38a98e1b87ea179edef81",
+               "e1c33b618479b335828987443953668185e2d7bd6972d5afedba3a8356b7d9c8",
+               "0555975e7a09bffd" },
+    {    1024, "f369cec12d2c2fbd049738001254a162e4f894a005640f1f2dc764af18d0f6ca",
+               "68a7df6e51507b0ef6c7948f39e5966a26e5bedd2c943107c81986c27ef706f4",
+               "fc41ea3e10f52f00" },
+    {    1025, "be56ef039f09516ddae826732f824dbc606c104a97b58f7ee1733e3055ac9712",
+               "e054674eb602019b57b5afb2d03bd6b758cfffa4ce9da5761856e1f84f29b742",
+               "8bce1f77253461b7" },
+    {    4097, "6bb6ce4a3f8ed0e8b8c934397aa0b895742312564545aa49e0d7b111aa52d85f",
+               "16a8082815d151215ba74eea92f200b478c553696f628f943c79c11aa4852194",
+               "e182cb96a1969676" },
+    {   17000, "4bf7b5bb257587a926247254f5d476b1a935a0558d8fcc388a3fbe7711822c3e",
+               "311133c13ee8436188fe260086ac9ef7b345d2b8ae67a882ecdb44bf7c3e5353",
+               "c018a2b334874a1f" },
+    { 1048577, "426bbd819bc07aed89e0a48ea4e4d7ce495b18f84e4c0eb953a26a637e2fa8fc",
+               "4994c7156835f8222a50e16a3d78e86f982e412ac61e52f253da5b2d949f52a6",
+               "edc6c04f419ba446" },
+};
+
+#define VECTOR_COUNT (sizeof(vectors) / sizeof(vectors[0]))
+
+static bool digests_match(const ArcDigests *d, const Vector *v) {
+    char hex[65];
+    return arc_digest_hex(d, ARC_HASH_SHA256, hex, sizeof(hex)) == 64 && strcmp(hex, v->sha256) == 0 &&
+           arc_digest_hex(d, ARC_HASH_BLAKE3, hex, sizeof(hex)) == 64 && strcmp(hex, v->blake3) == 0 &&
+           arc_digest_hex(d, ARC_HASH_XXH3, hex, sizeof(hex)) == 16 && strcmp(hex, v->xxh3) == 0;
+}
+
+static const char *out_path(const char *name) {
+    snprintf(path_buf, sizeof(path_buf), "%s/%s", base_dir, name);
+    return path_buf;
+}
+
+bool test_known_vectors() {
+    ArcHasher *hasher = arc_hasher_new(ARC_HASH_ALL);
+    ASSERT_NOT_NULL(hasher, "Should create hasher");
+    for (size_t i = 0; i < VECTOR_COUNT; i++) {
+        uint8_t *data = fixture_pattern(vectors[i].size, 7);
+        arc_hasher_reset(hasher);
+        arc_hasher_update(hasher, data, vectors[i].size);
+        ArcDigests d;
+        arc_hasher_final(hasher, &d);
+        free(data);
+        ASSERT_EQ(d.algorithms, ARC_HASH_ALL, "All digests should be filled in");
+        ASSERT_TRUE(digests_match(&d, &vectors[i]), "Digests should match the reference");
+    }
+    arc_hasher_free(hasher);
+    return true;
+}
+
+// Odd update sizes cross every block, stripe and chunk boundary differently
+bool test_streaming_updates() {
+    static const size_t steps[] = { 1, 7, 63, 64, 65, 1000, 4097 };
+    for (size_t i = 0; i < VECTOR_COUNT; i++) {
+        if (vectors[i].size > 20000) {
+            continue;
+        }
+        uint8_t *data = fixture_pattern(vectors[i].size, 7);
+        bool ok = true;
+        for (size_t s = 0; s < sizeof(steps) / sizeof(steps[0]); s++) {
+            ArcHasher *hasher = arc_hasher_new(ARC_HASH_ALL);
+            for (size_t off = 0; off < vectors[i].size; off += steps[s]) {
+                size_t n = vectors[i].size - off < steps[s] ? vectors[i].size - off : steps[s];
+                arc_hasher_update(hasher, data + off, n);
+            }
+            ArcDigests d;
+            arc_hasher_final(hasher, &d);
+            arc_hasher_free(hasher);
+            ok = ok && digests_match(&d, &vectors[i]);
+        }
+        free(data);
+        ASSERT_TRUE(ok, "Chunked updates should give the one-shot digests");
+    }
+    return true;
+}
+
+bool test_algorithm_selection() {
+    errno = 0;
+    ASSERT_NULL(arc_hasher_new(0), "No algorithms should fail");
+    ASSERT_EQ(errno, EINVAL, "Should report EINVAL");
+    ASSERT_NULL(arc_hasher_new(0x80), "Unknown algorithm should fail");
+
+    ArcHasher *hasher = arc_hasher_new(ARC_HASH_BLAKE3);
+    arc_hasher_update(hasher, "abc", 3);
+    ArcDigests d;
+    arc_hasher_final(hasher, &d);
+    arc_hasher_free(hasher);
+    char hex[65];
+    ASSERT_EQ(d.algorithms, ARC_HASH_BLAKE3, "Only BLAKE3 should be filled in");
+    ASSERT_EQ(arc_digest_hex(&d, ARC_HASH_SHA256, hex, sizeof(hex)), 0, "Missing digest has no hex");
+    ASSERT_EQ(arc_digest_hex(&d, ARC_HASH_BLAKE3, hex, 64), 0, "Too small a buffer should fail");
+    ASSERT_EQ(arc_digest_hex(&d, ARC_HASH_BLAKE3, hex, sizeof(hex)), 64, "BLAKE3 hex length");
+    ASSERT_STR_EQ(hex, "6437b3ac38465133ffb63b75273a8db548c558465d79db03fd359c6cd5bd9d85", "BLAKE3(\"abc\")");
+    ASSERT_STR_EQ(arc_hash_name(ARC_HASH_XXH3), "xxh3", "Algorithm name");
+    ASSERT_NULL(arc_hash_name(ARC_HASH_ALL), "Combined bits have no name");
+    return true;
+}
+
+bool test_hash_stream() {
+    const Vector *v = &vectors[VECTOR_COUNT - 2];
+    uint8_t *data = fixture_pattern(v->size, 7);
+    ArcStream *mem = arc_stream_from_memory(data, v->size, 0);
+    ArcHasher *hasher = arc_hasher_new(ARC_HASH_ALL);
+    ArcStream *tee = arc_stream_hash(mem, hasher);
+    ASSERT_NOT_NULL(tee, "Should create hashing stream");
+
+    uint8_t *copy = malloc(v->size);
+    size_t got = 0;
+    ssize_t n;
+    while ((n = arc_stream_read(tee, copy + got, got % 2 ? 777 : 4096)) > 0) {
+        got += (size_t)n;
+    }
+    ASSERT_EQ(n, 0, "Should reach EOF");
+    ASSERT_EQ(got, v->size, "Should pass every byte through");
+    ASSERT_TRUE(memcmp(copy, data, v->size) == 0, "Data should be unchanged");
+    ASSERT_EQ(arc_stream_tell(tee), (int64_t)v->size, "tell() counts bytes passed through");
+    errno = 0;
+    ASSERT_EQ(arc_stream_seek(tee, 0, SEEK_SET), -1, "Hashing stream can't seek");
+    ASSERT_EQ(errno, ESPIPE, "Should report ESPIPE");
+
+    ArcDigests d;
+    arc_hasher_final(hasher, &d);
+    ASSERT_TRUE(digests_match(&d, v), "Tee digests should match the reference");
+
+    arc_stream_close(tee);
+    ASSERT_EQ(arc_stream_seek(mem, 0, SEEK_SET), 0, "Closing the tee leaves the source open");
+    arc_stream_close(mem);
+    arc_hasher_free(hasher);
+    free(copy);
+    free(data);
+    ASSERT_NULL(arc_stream_hash(NULL, NULL), "NULL arguments should fail");
+    return true;
+}
+
+static bool write_fixture_archive(const char *path, bool zip, uint8_t **big_out) {
+    const Vector *big = &vectors[VECTOR_COUNT - 2];
+    const Vector *small = &vectors[1];
+    uint8_t *big_data = fixture_pattern(big->size, 7);
+    uint8_t *small_data = fixture_pattern(small->size, 7);
+    FixtureEntry files[] = {
+        { "small.txt", small_data, small->size, '0' },
+        { "dir/", NULL, 0, '5' },
+        { "dir/big.bin", big_data, big->size, '0' },
+        { "dir/empty", "", 0, '0' },
+    };
+    bool ok;
+    if (zip) {
+        ok = fixture_write_zip(path, files, 4, true);
+    } else {
+        uint8_t *tar = NULL;
+        size_t size = fixture_tar(files, 4, &tar);
+        ok = size > 0 && fixture_write_gzip(path, tar, size);
+        free(tar);
+    }
+    free(small_data);
+    *big_out = big_data;
+    return ok;
+}
+
+static void remove_extracted(void) {
+    unlink(out_path("out/small.txt"));
+    unlink(out_path("out/dir/big.bin"));
+    unlink(out_path("out/dir/empty"));
+    rmdir(out_path("out/dir"));
+    rmdir(out_path("out"));
+}
+
+static bool check_extract_report(const char *archive_name, bool zip) {
+    uint8_t *big;
+    char archive[256];
+    snprintf(archive, sizeof(archive), "%s/%s", base_dir, archive_name);
+    ASSERT_TRUE(write_fixture_archive(archive, zip, &big), "Should write archive");
+    free(big);
+    remove_extracted();
+    mkdir(out_path("out"), 0755);
+
+    ArcReader *reader = arc_open_path(archive);
+    ASSERT_NOT_NULL(reader, "Should open archive");
+    ArcExtractOptions opts;
+    memset(&opts, 0, sizeof(opts));
+    opts.hash_algorithms = ARC_HASH_ALL;
+    ArcExtractReport report;
+    int rc = arc_extract_to_path_ex(reader, out_path("out"), &opts, &report);
+    arc_close(reader);
+
+    ASSERT_EQ(rc, 0, "Extraction should succeed");
+    ASSERT_EQ(report.errors, 0, "No entry should fail");
+    ASSERT_EQ(report.count, 3, "Report lists the files, not the directory");
+    ASSERT_STR_EQ(report.files[0].path, "small.txt", "Files are in archive order");
+    ASSERT_EQ(report.files[0].size, vectors[1].size, "small.txt size");
+    ASSERT_TRUE(digests_match(&report.files[0].digests, &vectors[1]), "small.txt digests");
+    ASSERT_STR_EQ(report.files[1].path, "dir/big.bin", "Second file");
+    ASSERT_TRUE(digests_match(&report.files[1].digests, &vectors[VECTOR_COUNT - 2]), "big.bin digests");
+    ASSERT_TRUE(digests_match(&report.files[2].digests, &vectors[0]), "Empty file digests");
+    ASSERT_EQ(report.total_bytes, vectors[1].size + vectors[VECTOR_COUNT - 2].size, "Total bytes");
+
+    struct stat st;
+    ASSERT_EQ(stat(out_path("out/dir/big.bin"), &st), 0, "big.bin should exist");
+    ASSERT_EQ((size_t)st.st_size, vectors[VECTOR_COUNT - 2].size, "big.bin should be complete");
+    arc_extract_report_free(&report);
+    ASSERT_NULL(report.files, "Free should reset the report");
+    remove_extracted();
+    unlink(archive);
+    return true;
+}
+
+bool test_extract_report_tar_gz() {
+    return check_extract_report("hash.tar.gz", false);
+}
+
+bool test_extract_report_zip() {
+    return check_extract_report("hash.zip", true);
+}
+
+bool test_extract_entry_digests() {
+    uint8_t *big;
+    char archive[256];
+    snprintf(archive, sizeof(archive), "%s/entry.zip", base_dir);
+    ASSERT_TRUE(write_fixture_archive(archive, true, &big), "Should write archive");
+    free(big);
+    remove_extracted();
+    mkdir(out_path("out"), 0755);
+
+    ArcReader *reader = arc_open_path(archive);
+    ArcExtractOptions opts;
+    memset(&opts, 0, sizeof(opts));
+    ArcEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.path = "x";
+    opts.hash_algorithms = 0x40;
+    errno = 0;
+    ASSERT_EQ(arc_extract_entry_ex(reader, &entry, out_path("out"), &opts, NULL), -1, "Unknown algorithm should fail");
+    ASSERT_EQ(errno, EINVAL, "Should report EINVAL");
+
+    opts.hash_algorithms = ARC_HASH_SHA256 | ARC_HASH_XXH3;
+    size_t hashed = 0;
+    bool ok = true;
+    while (arc_next(reader, &entry) == 0) {
+        ArcDigests d;
+        ok = ok && arc_extract_entry_ex(reader, &entry, out_path("out"), &opts, &d) == 0;
+        if (strcmp(entry.path, "dir/big.bin") == 0) {
+            char hex[65];
+            arc_digest_hex(&d, ARC_HASH_XXH3, hex, sizeof(hex));
+            ok = ok && d.algorithms == opts.hash_algorithms && strcmp(hex, vectors[VECTOR_COUNT - 2].xxh3) == 0;
+            hashed++;
+        } else if (entry.type == ARC_ENTRY_DIR) {
+            ok = ok && d.algorithms == 0;
+        }
+        arc_entry_free(&entry);
+    }
+    arc_close(reader);
+    ASSERT_TRUE(ok, "Per-entry extraction should return the selected digests");
+    ASSERT_EQ(hashed, 1, "big.bin should have been extracted");
+    remove_extracted();
+    unlink(archive);
+    return true;
+}
+
+bool test_extract_xattrs() {
+#ifdef __linux__
+    // Skip where the temp file system has no user xattrs
+    ASSERT_TRUE(fixture_write_file(out_path("probe"), "x", 1), "Should write probe file");
+    int probe = setxattr(path_buf, "user.cupidarchive.probe", "1", 1, 0);
+    unlink(path_buf);
+    if (probe < 0) {
+        printf("  (skipped: no user xattrs in %s)\n", base_dir);
+        return true;
+    }
+
+    uint8_t *big;
+    char archive[256];
+    snprintf(archive, sizeof(archive), "%s/xattr.tar.gz", base_dir);
+    ASSERT_TRUE(write_fixture_archive(archive, false, &big), "Should write archive");
+    free(big);
+    remove_extracted();
+    mkdir(out_path("out"), 0755);
+
+    ArcReader *reader = arc_open_path(archive);
+    ArcExtractOptions opts;
+    memset(&opts, 0, sizeof(opts));
+    opts.hash_algorithms = ARC_HASH_BLAKE3 | ARC_HASH_XXH3;
+    opts.hash_xattrs = true;
+    ArcExtractReport report;
+    ASSERT_EQ(arc_extract_to_path_ex(reader, out_path("out"), &opts, &report), 0, "Extraction should succeed");
+    arc_close(reader);
+
+    char value[80];
+    ssize_t len = getxattr(out_path("out/dir/big.bin"), "user.cupidarchive.blake3", value, sizeof(value) - 1);
+    ASSERT_EQ(len, 64, "BLAKE3 xattr should hold hex");
+    value[len] = '\0';
+    ASSERT_STR_EQ(value, vectors[VECTOR_COUNT - 2].blake3, "BLAKE3 xattr value");
+    len = getxattr(path_buf, "user.cupidarchive.xxh3", value, sizeof(value) - 1);
+    ASSERT_EQ(len, 16, "XXH3 xattr should hold hex");
+    value[len] = '\0';
+    ASSERT_STR_EQ(value, vectors[VECTOR_COUNT - 2].xxh3, "XXH3 xattr value");
+    errno = 0;
+    ASSERT_EQ(getxattr(path_buf, "user.cupidarchive.sha256", value, sizeof(value)), -1, "SHA-256 wasn't requested");
+
+    arc_extract_report_free(&report);
+    remove_extracted();
+    unlink(archive);
+#endif
+    return true;
+}
+
+int main() {
+    printf("=== Archive Hash Tests ===\n\n");
+
+    snprintf(base_dir, sizeof(base_dir), "/tmp/cupidarchive_hash_test_%ld", (long)getpid());
+    mkdir(base_dir, 0755);
+
+    RUN_TEST(test_known_vectors);
+    RUN_TEST(test_streaming_updates);
+    RUN_TEST(test_algorithm_selection);
+    RUN_TEST(test_hash_stream);
+    RUN_TEST(test_extract_report_tar_gz);
+    RUN_TEST(test_extract_report_zip);
+    RUN_TEST(test_extract_entry_digests);
+    RUN_TEST(test_extract_xattrs);
+
+    rmdir(base_dir);
+
+    PRINT_SUMMARY();
+}
@@ -0,0 +1,314 @@
+#include "test_runner.h"
+#include "../cupidarchive.h"
+#include <errno.h>
+#include <zlib.h>
+
+#define TEXT_SIZE (3 * 1024 * 1024 + 4321)
+
+static uint8_t *text;      // Compressible, with near and far repeats
+static uint8_t *noise;     // Incompressible: deflate emits stored blocks
+
+static uint8_t *make_text(size_t size, uint32_t seed) {
+    static const char *words[] = {
+        "archive", "entry", "stream", "inflate", "window", "marker", "chunk ",
+        "block", "huffman", "\n", "thread", "offset ", "GET /index.html 200 ",
+        "2026-10-17T12:00:00Z ", "level=info ", "user=", "42", "deflate"
+    };
+    uint8_t *buf = malloc(size);
+    size_t n = 0;
+    uint32_t x = seed;
+    while (buf && n < size) {
+        x = x * 1103515245u + 12345u;
+        if ((x >> 16) % 97 == 0 && n > 40000) {
+            // Copy an older stretch: references reaching far back into the window
+            size_t len = 200 + (x >> 8) % 600;
+            size_t from = n - 1000 - (x >> 4) % 30000;
+            for (size_t i = 0; i < len && n < size; i++) {
+                buf[n] = buf[from + i];
+                n++;
+            }
+            continue;
+        }
+        const char *w = words[(x >> 16) % (sizeof(words) / sizeof(words[0]))];
+        for (size_t i = 0; w[i] && n < size; i++) {
+            buf[n++] = (uint8_t)w[i];
+        }
+        if (n < size && (x & 7) == 0) {
+            buf[n++] = (uint8_t)('0' + (x >> 24) % 10);
+        }
+    }
+    return buf;
+}
+
+static uint8_t *make_noise(size_t size, uint32_t seed) {
+    uint8_t *buf = malloc(size);
+    uint32_t x = seed;
+    for (size_t i = 0; buf && i < size; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        buf[i] = (uint8_t)x;
+    }
+    return buf;
+}
+
+/**
+ * Deflate with zlib. window_bits 31 = gzip, -15 = raw.
+ * Returns a malloc'd buffer.
+ */
+static uint8_t *deflate_buf(const uint8_t *data, size_t size, int level, int strategy,
+                         int window_bits, size_t *out_size) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, level, Z_DEFLATED, window_bits, 8, strategy) != Z_OK) {
+        return NULL;
+    }
+    size_t cap = deflateBound(&zs, (uLong)size) + 64;
+    uint8_t *out = malloc(cap);
+    zs.next_in = (Bytef *)data;
+    zs.avail_in = (uInt)size;
+    zs.next_out = out;
+    zs.avail_out = (uInt)cap;
+    int ret = out ? deflate(&zs, Z_FINISH) : Z_MEM_ERROR;
+    *out_size = cap - zs.avail_out;
+    deflateEnd(&zs);
+    if (ret != Z_STREAM_END) {
+        free(out);
+        return NULL;
+    }
+    return out;
+}
+
+/**
+ * Read everything from a parallel filter over `comp`, in reads of `step`
+ * bytes. Returns the bytes read, or -1 if a read failed.
+ */
+static ssize_t inflate_all(const uint8_t *comp, size_t comp_size, bool gzip, unsigned threads,
+                           size_t chunk_size, int64_t limit, size_t step, uint8_t *out, size_t cap) {
+    ArcStream *mem = arc_stream_from_memory(comp, comp_size, 0);
+    ArcParallelInflateOptions opts = { threads, chunk_size };
+    ArcStream *s = gzip ? arc_filter_gzip_parallel(mem, limit, &opts)
+                        : arc_filter_deflate_parallel(mem, limit, &opts);
+    if (!s) {
+        arc_stream_close(mem);
+        return -1;
+    }
+    size_t total = 0;
+    ssize_t n = 0;
+    while (total < cap) {
+        size_t want = cap - total < step ? cap - total : step;
+        n = arc_stream_read(s, out + total, want);
+        if (n <= 0) {
+            break;
+        }
+        total += (size_t)n;
+    }
+    arc_stream_close(s);
+    arc_stream_close(mem);
+    return n < 0 ? -1 : (ssize_t)total;
+}
+
+static bool same_output(const uint8_t *comp, size_t comp_size, bool gzip, unsigned threads,
+                        size_t chunk_size, size_t step, const uint8_t *expect, size_t size) {
+    uint8_t *out = malloc(size + 1);
+    ssize_t got = inflate_all(comp, comp_size, gzip, threads, chunk_size, 0, step, out, size + 1);
+    bool ok = got == (ssize_t)size && memcmp(out, expect, size) == 0;
+    free(out);
+    return ok;
+}
+
+static bool test_gzip_levels(void) {
+    static const int levels[] = { 1, 6, 9 };
+    for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+        size_t comp_size;
+        uint8_t *comp = deflate_buf(text, TEXT_SIZE, levels[i], Z_DEFAULT_STRATEGY, 31, &comp_size);
+        ASSERT_NOT_NULL(comp, "zlib compresses the text");
+        ASSERT_TRUE(same_output(comp, comp_size, true, 4, 16384, 65536, text, TEXT_SIZE),
+                    "Small chunks on 4 threads match the input");
+        ASSERT_TRUE(same_output(comp, comp_size, true, 1, 0, 65536, text, TEXT_SIZE),
+                    "Default chunk on 1 thread matches the input");
+        free(comp);
+    }
+    return true;
+}
+
+static bool test_chunk_sizes(void) {
+    size_t comp_size;
+    uint8_t *comp = deflate_buf(text, TEXT_SIZE, 6, Z_DEFAULT_STRATEGY, 31, &comp_size);
+    ASSERT_NOT_NULL(comp, "zlib compresses the text");
+    static const size_t chunks[] = { 4096, 5000, 77777, 262144 };
+    static const unsigned threads[] = { 2, 3, 8, 5 };
+    for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+        ASSERT_TRUE(same_output(comp, comp_size, true, threads[i], chunks[i], 1 << 20, text, TEXT_SIZE),
+                    "Every chunk size stitches back to the input");
+    }
+    // Odd read sizes cut through chunk and marker boundaries
+    ASSERT_TRUE(same_output(comp, comp_size, true, 3, 8192, 1000, text, TEXT_SIZE),
+                "1000-byte reads match");
+    ASSERT_TRUE(same_output(comp, comp_size, true, 2, 8192, 7, text, TEXT_SIZE),
+                "7-byte reads match");
+    free(comp);
+    return true;
+}
+
+static bool test_block_types(void) {
+    // Stored blocks only (incompressible), fixed Huffman only, and a mix
+    size_t mixed_size = 2 * 1024 * 1024;
+    uint8_t *mixed = malloc(mixed_size);
+    ASSERT_NOT_NULL(mixed, "Allocate");
+    for (size_t off = 0; off < mixed_size; off += 100000) {
+        size_t n = mixed_size - off < 100000 ? mixed_size - off : 100000;
+        memcpy(mixed + off, (off / 100000) % 2 ? noise + off : text + off, n);
+    }
+
+    size_t comp_size;
+    uint8_t *comp = deflate_buf(noise, TEXT_SIZE, 6, Z_DEFAULT_STRATEGY, 31, &comp_size);
+    ASSERT_NOT_NULL(comp, "zlib compresses noise");
+    ASSERT_TRUE(same_output(comp, comp_size, true, 4, 32768, 65536, noise, TEXT_SIZE),
+                "Stored blocks match");
+    free(comp);
+
+    comp = deflate_buf(text, TEXT_SIZE, 6, Z_FIXED, 31, &comp_size);
+    ASSERT_NOT_NULL(comp, "zlib compresses with fixed codes");
+    ASSERT_TRUE(same_output(comp, comp_size, true, 4, 32768, 65536, text, TEXT_SIZE),
+                "Fixed Huffman blocks fall back to serial decoding and match");
+    free(comp);
+
+    comp = deflate_buf(text, TEXT_SIZE, 6, Z_HUFFMAN_ONLY, 31, &comp_size);
+    ASSERT_NOT_NULL(comp, "zlib compresses Huffman-only");
+    ASSERT_TRUE(same_output(comp, comp_size, true, 4, 32768, 65536, text, TEXT_SIZE),
+                "Literal-only blocks match");
+    free(comp);
+
+    comp = deflate_buf(mixed, mixed_size, 6, Z_DEFAULT_STRATEGY, 31, &comp_size);
+    ASSERT_NOT_NULL(comp, "zlib compresses the mix");
+    ASSERT_TRUE(same_output(comp, comp_size, true, 4, 16384, 65536, mixed, mixed_size),
+                "Mixed stored and dynamic blocks match");
+    free(comp);
+    free(mixed);
+    return true;
+}
+
+static bool test_raw_deflate(void) {
+    size_t comp_size;
+    uint8_t *comp = deflate_buf(text, TEXT_SIZE, 6, Z_DEFAULT_STRATEGY, -15, &comp_size);
+    ASSERT_NOT_NULL(comp, "zlib compresses raw deflate");
+    ASSERT_TRUE(same_output(comp, comp_size, false, 4, 16384, 65536, text, TEXT_SIZE),
+                "Raw deflate matches");
+
+    // Owned variant closes its input
+    ArcStream *mem = arc_stream_from_memory(comp, comp_size, 0);
+    ArcParallelInflateOptions opts = { 2, 65536 };
+    ArcStream *s = arc_filter_deflate_parallel_owned(mem, 0, &opts);
+    ASSERT_NOT_NULL(s, "Owned filter opens");
+    uint8_t buf[4096];
+    ASSERT_EQ(arc_stream_read(s, buf, sizeof(buf)), (ssize_t)sizeof(buf), "Owned filter reads");
+    ASSERT_TRUE(memcmp(buf, text, sizeof(buf)) == 0, "Owned filter output matches");
+    ASSERT_EQ(arc_stream_seek(s, 0, SEEK_SET), -1, "Filter does not seek");
+    ASSERT_EQ(arc_stream_tell(s), (int64_t)sizeof(buf), "Tell reports bytes read");
+    arc_stream_close(s);
+    free(comp);
+    return true;
+}
+
+static bool test_multi_member(void) {
+    size_t a_size, b_size, c_size;
+    size_t half = TEXT_SIZE / 2;
+    uint8_t *a = deflate_buf(text, half, 6, Z_DEFAULT_STRATEGY, 31, &a_size);
+    uint8_t *b = deflate_buf(text + half, TEXT_SIZE - half, 9, Z_DEFAULT_STRATEGY, 31, &b_size);
+    uint8_t *c = deflate_buf(text, 0, 6, Z_DEFAULT_STRATEGY, 31, &c_size);
+    ASSERT_TRUE(a && b && c, "zlib compresses the members");
+    size_t all_size = a_size + c_size + b_size;
+    uint8_t *all = malloc(all_size);
+    memcpy(all, a, a_size);
+    memcpy(all + a_size, c, c_size);
+    memcpy(all + a_size + c_size, b, b_size);
+    ASSERT_TRUE(same_output(all, all_size, true, 4, 16384, 65536, text, TEXT_SIZE),
+                "Members (one empty) decode back to back");
+    free(a);
+    free(b);
+    free(c);
+    free(all);
+    return true;
+}
+
+static bool test_corrupt(void) {
+    size_t comp_size;
+    uint8_t *comp = deflate_buf(text, TEXT_SIZE, 6, Z_DEFAULT_STRATEGY, 31, &comp_size);
+    ASSERT_NOT_NULL(comp, "zlib compresses the text");
+    uint8_t *out = malloc(TEXT_SIZE + 1);
+
+    // Bad CRC in the trailer
+    comp[comp_size - 6] ^= 0x55;
+    ASSERT_EQ(inflate_all(comp, comp_size, true, 4, 16384, 0, 1 << 20, out, TEXT_SIZE + 1), -1,
+              "CRC mismatch is reported");
+    comp[comp_size - 6] ^= 0x55;
+
+    // Truncated stream
+    ASSERT_EQ(inflate_all(comp, comp_size / 2, true, 4, 16384, 0, 1 << 20, out, TEXT_SIZE + 1), -1,
+              "Truncation is reported");
+
+    // Damage in the middle of the deflate data
+    comp[comp_size / 2] ^= 0xff;
+    comp[comp_size / 2 + 1] ^= 0xff;
+    ssize_t got = inflate_all(comp, comp_size, true, 4, 16384, 0, 1 << 20, out, TEXT_SIZE + 1);
+    ASSERT_EQ(got, -1, "Damage is reported");
+
+    // Not gzip at all
+    errno = 0;
+    ASSERT_EQ(inflate_all(text, 4096, true, 2, 0, 0, 4096, out, 4096), -1, "Non-gzip input fails");
+    ASSERT_EQ(errno, EINVAL, "Reports EINVAL");
+    ASSERT_NULL(arc_filter_gzip_parallel(NULL, 0, NULL), "NULL stream fails");
+    free(out);
+    free(comp);
+    return true;
+}
+
+static bool test_byte_limit(void) {
+    size_t comp_size;
+    uint8_t *comp = deflate_buf(text, TEXT_SIZE, 6, Z_DEFAULT_STRATEGY, 31, &comp_size);
+    ASSERT_NOT_NULL(comp, "zlib compresses the text");
+    uint8_t *out = malloc(TEXT_SIZE);
+    ssize_t got = inflate_all(comp, comp_size, true, 4, 16384, 1000000, 65536, out, TEXT_SIZE);
+    ASSERT_EQ(got, 1000000, "Output stops at the byte limit");
+    ASSERT_TRUE(memcmp(out, text, 1000000) == 0, "Output up to the limit matches");
+    ASSERT_FALSE(arc_parallel_inflate_worthwhile(ARC_PARALLEL_INFLATE_MIN - 1),
+                 "Small streams stay on the serial filter");
+    free(out);
+    free(comp);
+    return true;
+}
+
+// Below about three workers the speculative decoder loses to zlib
+static bool test_worthwhile_threshold(void) {
+    ASSERT_EQ(ARC_PARALLEL_INFLATE_MIN_CPUS, 4, "Threshold is four online CPUs");
+    ASSERT_FALSE(arc_parallel_inflate_worthwhile_on(ARC_PARALLEL_INFLATE_MIN, 1), "One CPU: serial");
+    ASSERT_FALSE(arc_parallel_inflate_worthwhile_on(ARC_PARALLEL_INFLATE_MIN, 2), "Two CPUs: serial");
+    ASSERT_FALSE(arc_parallel_inflate_worthwhile_on(ARC_PARALLEL_INFLATE_MIN, 3), "Three CPUs: serial");
+    ASSERT_TRUE(arc_parallel_inflate_worthwhile_on(ARC_PARALLEL_INFLATE_MIN, 4), "Four CPUs: parallel");
+    ASSERT_TRUE(arc_parallel_inflate_worthwhile_on(ARC_PARALLEL_INFLATE_MIN, 64), "Many CPUs: parallel");
+    ASSERT_FALSE(arc_parallel_inflate_worthwhile_on(ARC_PARALLEL_INFLATE_MIN - 1, 64),
+                 "Small streams stay serial on any host");
+    return true;
+}
+
+int main(void) {
+    printf("=== Parallel Inflate Tests ===\n\n");
+
+    text = make_text(TEXT_SIZE, 7);
+    noise = make_noise(TEXT_SIZE, 11);
+
+    RUN_TEST(test_gzip_levels);
+    RUN_TEST(test_chunk_sizes);
+    RUN_TEST(test_block_types);
+    RUN_TEST(test_raw_deflate);
+    RUN_TEST(test_multi_member);
+    RUN_TEST(test_corrupt);
+    RUN_TEST(test_byte_limit);
+    RUN_TEST(test_worthwhile_threshold);
+
+    free(text);
+    free(noise);
+
+    PRINT_SUMMARY();
+}
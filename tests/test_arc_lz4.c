@@ -0,0 +1,451 @@
+#include "test_runner.h"
+#include "test_fixtures.h"
+#include "../cupidarchive.h"
+#include <errno.h>
+#include <unistd.h>
+
+#define DATA_SIZE (1536 * 1024 + 777)
+
+static uint8_t *data;
+
+// `lz4 -BD -BX --content-size` of REF_TEXT: linked blocks, block and
+// content checksums, an overlapping match
+static const uint8_t ref_frame[] = {
+    0x04, 0x22, 0x4d, 0x18, 0x7c, 0x40, 0x39, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x50, 0x1d, 0x00, 0x00, 0x00, 0xff, 0x02, 0x63, 0x75, 0x70,
+    0x69, 0x64, 0x61, 0x72, 0x63, 0x68, 0x69, 0x76, 0x65, 0x20, 0x6c, 0x7a,
+    0x34, 0x20, 0x11, 0x00, 0x0f, 0x60, 0x66, 0x72, 0x61, 0x6d, 0x65, 0x0a,
+    0x4c, 0xf6, 0xc4, 0x0e, 0x00, 0x00, 0x00, 0x00, 0x78, 0x36, 0x82, 0x33
+};
+#define REF_TEXT "cupidarchive lz4 cupidarchive lz4 cupidarchive lz4 frame\n"
+
+// Minimal LZ4 frame writer
+
+static void put32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t rd32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t rotl(uint32_t x, int r) {
+    return (x << r) | (x >> (32 - r));
+}
+
+static uint32_t xxh32(const uint8_t *p, size_t len) {
+    const uint32_t p1 = 0x9E3779B1U, p2 = 0x85EBCA77U, p3 = 0xC2B2AE3DU, p4 = 0x27D4EB2FU, p5 = 0x165667B1U;
+    const uint8_t *end = p + len;
+    uint32_t h;
+    if (len >= 16) {
+        uint32_t v[4] = { p1 + p2, p2, 0, 0U - p1 };
+        for (; end - p >= 16; p += 16) {
+            for (int i = 0; i < 4; i++) {
+                v[i] = rotl(v[i] + rd32(p + 4 * i) * p2, 13) * p1;
+            }
+        }
+        h = rotl(v[0], 1) + rotl(v[1], 7) + rotl(v[2], 12) + rotl(v[3], 18);
+    } else {
+        h = p5;
+    }
+    h += (uint32_t)len;
+    for (; end - p >= 4; p += 4) {
+        h = rotl(h + rd32(p) * p3, 17) * p4;
+    }
+    for (; p < end; p++) {
+        h = rotl(h + *p * p5, 11) * p1;
+    }
+    h ^= h >> 15;
+    h *= p2;
+    h ^= h >> 13;
+    h *= p3;
+    return h ^ (h >> 16);
+}
+
+static uint8_t *put_length(uint8_t *op, size_t n) {
+    for (; n >= 255; n -= 255) {
+        *op++ = 255;
+    }
+    *op++ = (uint8_t)n;
+    return op;
+}
+
+static uint8_t *put_sequence(uint8_t *op, const uint8_t *lit, size_t lit_len, size_t offset, size_t match_len) {
+    uint8_t *token = op++;
+    *token = (uint8_t)((lit_len >= 15 ? 15 : lit_len) << 4);
+    if (lit_len >= 15) {
+        op = put_length(op, lit_len - 15);
+    }
+    memcpy(op, lit, lit_len);
+    op += lit_len;
+    if (match_len == 0) {
+        return op;  // Last literals
+    }
+    *op++ = (uint8_t)offset;
+    *op++ = (uint8_t)(offset >> 8);
+    size_t ml = match_len - 4;
+    *token |= (uint8_t)(ml >= 15 ? 15 : ml);
+    if (ml >= 15) {
+        op = put_length(op, ml - 15);
+    }
+    return op;
+}
+
+static unsigned hash4(const uint8_t *p) {
+    return (rd32(p) * 2654435761U) >> 20;
+}
+
+// Greedy block compressor for base[start, end); matches may reach back
+// into base[0, start) (linked blocks)
+static size_t compress_block(const uint8_t *base, size_t start, size_t end, uint8_t *out) {
+    static uint32_t table[4096];
+    for (size_t i = 0; i < 4096; i++) {
+        table[i] = UINT32_MAX;
+    }
+    for (size_t i = start > 65535 ? start - 65535 : 0; i + 4 <= start; i++) {
+        table[hash4(base + i)] = (uint32_t)i;
+    }
+    uint8_t *op = out;
+    size_t anchor = start;
+    size_t i = start;
+    while (i + 12 <= end) {
+        unsigned h = hash4(base + i);
+        size_t cand = table[h];
+        table[h] = (uint32_t)i;
+        if (cand == UINT32_MAX || i - cand > 65535 || memcmp(base + cand, base + i, 4) != 0) {
+            i++;
+            continue;
+        }
+        size_t len = 4;
+        while (i + len + 5 < end && base[cand + len] == base[i + len]) {
+            len++;
+        }
+        op = put_sequence(op, base + anchor, i - anchor, i - cand, len);
+        i += len;
+        anchor = i;
+    }
+    op = put_sequence(op, base + anchor, end - anchor, 0, 0);
+    return (size_t)(op - out);
+}
+
+typedef struct FrameOpts {
+    bool independent;
+    bool block_checksum;
+    bool content_checksum;
+    bool content_size;
+    unsigned block_id;          // 4 = 64 KiB ... 7 = 4 MiB
+} FrameOpts;
+
+// One frame; incompressible blocks are stored
+static size_t write_frame(const uint8_t *in, size_t len, const FrameOpts *o, uint8_t *out) {
+    uint8_t *op = out;
+    put32(op, 0x184D2204U);
+    op += 4;
+    uint8_t *desc = op;
+    *op++ = (uint8_t)(0x40 | (o->independent ? 0x20 : 0) | (o->block_checksum ? 0x10 : 0) |
+                      (o->content_size ? 0x08 : 0) | (o->content_checksum ? 0x04 : 0));
+    *op++ = (uint8_t)(o->block_id << 4);
+    if (o->content_size) {
+        put32(op, (uint32_t)len);
+        put32(op + 4, 0);
+        op += 8;
+    }
+    *op = (uint8_t)(xxh32(desc, (size_t)(op - desc)) >> 8);
+    op++;
+
+    size_t block_max = (size_t)1 << (8 + 2 * o->block_id);
+    uint8_t *tmp = malloc(block_max + block_max / 255 + 16);
+    for (size_t off = 0; off < len; off += block_max) {
+        size_t n = len - off < block_max ? len - off : block_max;
+        const uint8_t *base = o->independent ? in + off : in;
+        size_t start = o->independent ? 0 : off;
+        size_t clen = compress_block(base, start, start + n, tmp);
+        if (clen < n) {
+            put32(op, (uint32_t)clen);
+            memcpy(op + 4, tmp, clen);
+        } else {
+            clen = n;
+            put32(op, 0x80000000U | (uint32_t)n);
+            memcpy(op + 4, in + off, n);
+        }
+        if (o->block_checksum) {
+            put32(op + 4 + clen, xxh32(op + 4, clen));
+        }
+        op += 4 + clen + (o->block_checksum ? 4 : 0);
+    }
+    free(tmp);
+    put32(op, 0);
+    op += 4;
+    if (o->content_checksum) {
+        put32(op, xxh32(in, len));
+        op += 4;
+    }
+    return (size_t)(op - out);
+}
+
+static size_t frame_bound(size_t len) {
+    return len + len / 64 + 4096;
+}
+
+static bool read_all(ArcStream *s, uint8_t *out, size_t cap, size_t *len_out) {
+    size_t len = 0;
+    ssize_t n;
+    while (len < cap && (n = arc_stream_read(s, out + len, cap - len > 10000 ? 10000 : cap - len)) > 0) {
+        len += (size_t)n;
+    }
+    *len_out = len;
+    return arc_stream_read(s, out, 1) == 0;
+}
+
+static bool decode(const uint8_t *frame, size_t frame_len, unsigned threads, uint8_t *out, size_t cap,
+                   size_t *len_out) {
+    ArcStream *mem = arc_stream_from_memory(frame, frame_len, 0);
+    ArcLz4Options opts = { .threads = threads };
+    ArcStream *f = arc_filter_lz4(mem, 0, &opts);
+    bool ok = f && read_all(f, out, cap, len_out);
+    arc_stream_close(f);
+    arc_stream_close(mem);
+    return ok;
+}
+
+// Tests
+
+static bool test_reference(void) {
+    uint8_t out[128];
+    size_t len = 0;
+    ASSERT_TRUE(decode(ref_frame, sizeof(ref_frame), 1, out, sizeof(out), &len), "Reference frame decodes");
+    ASSERT_EQ(len, strlen(REF_TEXT), "Reference size");
+    ASSERT_TRUE(memcmp(out, REF_TEXT, len) == 0, "Reference bytes");
+    return true;
+}
+
+// Every descriptor flag, linked and independent blocks, 1 and 4 threads
+static bool test_frames(void) {
+    static const FrameOpts variants[] = {
+        { true, false, false, false, 4 },
+        { true, true, true, true, 4 },
+        { true, false, true, false, 5 },
+        { false, false, false, false, 4 },
+        { false, true, true, true, 4 },
+        { false, false, true, false, 5 },
+    };
+    uint8_t *frame = malloc(frame_bound(DATA_SIZE));
+    uint8_t *out = malloc(DATA_SIZE + 1);
+    for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+        size_t frame_len = write_frame(data, DATA_SIZE, &variants[v], frame);
+        ASSERT_TRUE(frame_len < DATA_SIZE, "Test data compresses");
+        unsigned threads[] = { 1, 4 };
+        for (size_t t = 0; t < 2; t++) {
+            size_t len = 0;
+            ASSERT_TRUE(decode(frame, frame_len, threads[t], out, DATA_SIZE + 1, &len), "Reads to EOF");
+            ASSERT_EQ(len, DATA_SIZE, "Decoded size");
+            ASSERT_TRUE(memcmp(out, data, DATA_SIZE) == 0, "Decoded bytes");
+        }
+    }
+
+    // Incompressible input goes into stored blocks
+    uint8_t noise[3000];
+    uint32_t x = 7;
+    for (size_t i = 0; i < sizeof(noise); i++) {
+        x = x * 1103515245u + 12345u;
+        noise[i] = (uint8_t)(x >> 16);
+    }
+    FrameOpts stored = { true, true, true, false, 4 };
+    size_t frame_len = write_frame(noise, sizeof(noise), &stored, frame);
+    ASSERT_TRUE((frame[10] & 0x80) != 0, "First block stored");
+    size_t len = 0;
+    ASSERT_TRUE(decode(frame, frame_len, 4, out, DATA_SIZE, &len), "Stored frame decodes");
+    ASSERT_EQ(len, sizeof(noise), "Stored size");
+    ASSERT_TRUE(memcmp(out, noise, len) == 0, "Stored bytes");
+    free(frame);
+    free(out);
+    return true;
+}
+
+// Concatenated frames with a skippable frame and an empty frame between them
+static bool test_concatenated(void) {
+    uint8_t *frames = malloc(frame_bound(DATA_SIZE) + 256);
+    uint8_t *out = malloc(DATA_SIZE + 1);
+    FrameOpts a = { true, false, true, false, 4 };
+    FrameOpts b = { false, true, false, true, 4 };
+    size_t len = write_frame(data, 100000, &a, frames);
+    put32(frames + len, 0x184D2A5AU);
+    put32(frames + len + 4, 5);
+    memcpy(frames + len + 8, "skip!", 5);
+    len += 13;
+    len += write_frame(data, 0, &b, frames + len);
+    len += write_frame(data + 100000, DATA_SIZE - 100000, &b, frames + len);
+
+    size_t got = 0;
+    ASSERT_TRUE(decode(frames, len, 4, out, DATA_SIZE + 1, &got), "Reads every frame");
+    ASSERT_EQ(got, DATA_SIZE, "Frames joined");
+    ASSERT_TRUE(memcmp(out, data, DATA_SIZE) == 0, "Joined bytes");
+    free(frames);
+    free(out);
+    return true;
+}
+
+static bool expect_error(const uint8_t *frame, size_t frame_len, unsigned threads, int err) {
+    uint8_t *out = malloc(DATA_SIZE);
+    size_t len = 0;
+    ArcStream *mem = arc_stream_from_memory(frame, frame_len, 0);
+    ArcLz4Options opts = { .threads = threads };
+    ArcStream *f = arc_filter_lz4(mem, 0, &opts);
+    read_all(f, out, DATA_SIZE, &len);
+    errno = 0;
+    ssize_t n = arc_stream_read(f, out, 100);
+    int saved = errno;
+    arc_stream_close(f);
+    arc_stream_close(mem);
+    free(out);
+    ASSERT_EQ(n, -1, "Decoding fails");
+    ASSERT_EQ(saved, err, "errno");
+    return true;
+}
+
+static bool test_corrupt(void) {
+    uint8_t *frame = malloc(frame_bound(DATA_SIZE));
+    FrameOpts checked = { true, true, true, true, 4 };
+    size_t len = write_frame(data, DATA_SIZE, &checked, frame);
+
+    // Block checksum, on the pool and on the calling thread
+    frame[len / 2] ^= 0x20;
+    ASSERT_TRUE(expect_error(frame, len, 4, EINVAL), "Block checksum mismatch (pool)");
+    ASSERT_TRUE(expect_error(frame, len, 1, EINVAL), "Block checksum mismatch (serial)");
+    frame[len / 2] ^= 0x20;
+
+    // Content checksum and content size
+    frame[len - 1] ^= 1;
+    ASSERT_TRUE(expect_error(frame, len, 4, EINVAL), "Content checksum mismatch");
+    frame[len - 1] ^= 1;
+    frame[6] ^= 1;
+    frame[14] = (uint8_t)(xxh32(frame + 4, 10) >> 8);
+    ASSERT_TRUE(expect_error(frame, len, 1, EINVAL), "Content size mismatch");
+    frame[6] ^= 1;
+    frame[14] = (uint8_t)(xxh32(frame + 4, 10) >> 8);
+
+    // Header checksum, truncation, a dictionary frame
+    frame[14] ^= 1;
+    ASSERT_TRUE(expect_error(frame, len, 1, EINVAL), "Header checksum mismatch");
+    frame[14] ^= 1;
+    ASSERT_TRUE(expect_error(frame, len - 1000, 4, EINVAL), "Truncated frame");
+    uint8_t dict[] = { 0x04, 0x22, 0x4d, 0x18, 0x61, 0x40, 1, 2, 3, 4, 0 };
+    dict[10] = (uint8_t)(xxh32(dict + 4, 6) >> 8);
+    ASSERT_TRUE(expect_error(dict, sizeof(dict), 1, ENOTSUP), "Dictionary frames unsupported");
+
+    // One literal, then a match 16 bytes back: before the start of the block
+    uint8_t bad[] = { 0x04, 0x22, 0x4d, 0x18, 0x60, 0x40, 0, 4, 0, 0, 0, 0x10, 'x', 0x10, 0, 0, 0, 0, 0 };
+    bad[6] = (uint8_t)(xxh32(bad + 4, 2) >> 8);
+    ASSERT_TRUE(expect_error(bad, sizeof(bad), 1, EINVAL), "Match before the block start");
+
+    // The byte limit caps the output
+    len = write_frame(data, DATA_SIZE, &checked, frame);
+    uint8_t *out = malloc(DATA_SIZE);
+    ArcStream *mem = arc_stream_from_memory(frame, len, 0);
+    ArcStream *f = arc_filter_lz4(mem, 100000, NULL);
+    size_t got = 0;
+    ASSERT_TRUE(read_all(f, out, DATA_SIZE, &got), "Limited read ends cleanly");
+    ASSERT_EQ(got, 100000, "Byte limit caps the output");
+    ASSERT_EQ(arc_stream_seek(f, 0, SEEK_SET), -1, "Filter doesn't seek");
+    arc_stream_close(f);
+    arc_stream_close(mem);
+    free(out);
+    free(frame);
+    return true;
+}
+
+// .lz4 single files and .tar.lz4 through arc_open_path()
+static bool test_reader(void) {
+    char lz4_path[64];
+    char tar_path[64];
+    snprintf(lz4_path, sizeof(lz4_path), "/tmp/cupidarchive_lz4_%ld.bin.lz4", (long)getpid());
+    snprintf(tar_path, sizeof(tar_path), "/tmp/cupidarchive_lz4_%ld.tar.lz4", (long)getpid());
+    uint8_t *frame = malloc(frame_bound(DATA_SIZE) + 4096);
+    uint8_t *out = malloc(DATA_SIZE + 1);
+
+    FrameOpts sized = { true, false, true, true, 4 };
+    size_t len = write_frame(data, DATA_SIZE, &sized, frame);
+    ASSERT_TRUE(fixture_write_file(lz4_path, frame, len), "Write .lz4");
+    ArcReader *r = arc_open_path(lz4_path);
+    ASSERT_NOT_NULL(r, "Open .lz4");
+    ArcEntry entry;
+    ASSERT_EQ(arc_next(r, &entry), 0, "One entry");
+    char expect_name[64];
+    snprintf(expect_name, sizeof(expect_name), "cupidarchive_lz4_%ld.bin", (long)getpid());
+    ASSERT_STR_EQ(entry.path, expect_name, "Extension stripped");
+    ASSERT_EQ(entry.size, DATA_SIZE, "Size from the frame's content size");
+    ArcStream *s = arc_open_data(r);
+    ASSERT_NOT_NULL(s, "Entry data");
+    read_all(s, out, DATA_SIZE + 1, &len);
+    ASSERT_EQ(len, DATA_SIZE, "File size");
+    ASSERT_TRUE(memcmp(out, data, len) == 0, "File bytes");
+    arc_stream_close(s);
+    arc_entry_free(&entry);
+    arc_close(r);
+    unlink(lz4_path);
+
+    FixtureEntry entries[] = {
+        { "big.bin", data, DATA_SIZE - 1000, '0' },
+        { "dir", NULL, 0, '5' },
+        { "dir/small.txt", "lz4 tar", 7, '0' },
+    };
+    uint8_t *tar = NULL;
+    size_t tar_len = fixture_tar(entries, 3, &tar);
+    FrameOpts linked = { false, true, true, false, 5 };
+    len = write_frame(tar, tar_len, &linked, frame);
+    ASSERT_TRUE(fixture_write_file(tar_path, frame, len), "Write .tar.lz4");
+    free(tar);
+
+    r = arc_open_path(tar_path);
+    ASSERT_NOT_NULL(r, "Open .tar.lz4");
+    size_t count = 0;
+    while (arc_next(r, &entry) == 0) {
+        if (strcmp(entry.path, "big.bin") == 0) {
+            s = arc_open_data(r);
+            read_all(s, out, DATA_SIZE, &len);
+            ASSERT_EQ(len, DATA_SIZE - 1000, "Big entry size");
+            ASSERT_TRUE(memcmp(out, data, len) == 0, "Big entry bytes");
+            arc_stream_close(s);
+        } else if (strcmp(entry.path, "dir/small.txt") == 0) {
+            s = arc_open_data(r);
+            read_all(s, out, DATA_SIZE, &len);
+            ASSERT_EQ(len, 7, "Small entry size");
+            ASSERT_TRUE(memcmp(out, "lz4 tar", 7) == 0, "Small entry bytes");
+            arc_stream_close(s);
+        }
+        arc_entry_free(&entry);
+        count++;
+    }
+    arc_close(r);
+    ASSERT_EQ(count, 3, "All TAR entries listed");
+    unlink(tar_path);
+    free(frame);
+    free(out);
+    return true;
+}
+
+int main(void) {
+    printf("=== LZ4 Tests ===\n\n");
+
+    // Matches within and across blocks, plus stretches that only compress a little
+    data = fixture_pattern(DATA_SIZE, 9);
+    for (size_t off = 0; off + 4096 <= DATA_SIZE; off += 70000) {
+        memcpy(data + off + 2048, data + off, 2048);
+        if (off >= 70000) {
+            memcpy(data + off, data + off - 60000, 1024);
+        }
+    }
+
+    RUN_TEST(test_reference);
+    RUN_TEST(test_frames);
+    RUN_TEST(test_concatenated);
+    RUN_TEST(test_corrupt);
+    RUN_TEST(test_reader);
+
+    free(data);
+
+    PRINT_SUMMARY();
+}
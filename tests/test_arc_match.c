@@ -0,0 +1,337 @@
+#define _POSIX_C_SOURCE 200809L
+#include "test_runner.h"
+#include "test_fixtures.h"
+#include "../cupidarchive.h"
+#include "arc_zip.h"
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fnmatch.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+static char base_dir[128];
+static char path_buf[256];
+
+static const char *fixture_path(const char *name) {
+    snprintf(path_buf, sizeof(path_buf), "%s/%s", base_dir, name);
+    return path_buf;
+}
+
+static bool matches(const char *pattern, const char *path) {
+    ArcMatcher *m = arc_matcher_new(&pattern, 1, NULL, 0);
+    bool result = m && arc_matcher_match(m, path);
+    arc_matcher_free(m);
+    return result;
+}
+
+bool test_literal() {
+    ASSERT_TRUE(matches("usr/bin", "usr/bin"), "Exact path");
+    ASSERT_TRUE(matches("usr/bin", "usr/bin/ls"), "Everything below a directory");
+    ASSERT_TRUE(matches("./usr/bin/", "/usr/bin/ls"), "Leading ./ and / and trailing / are ignored");
+    ASSERT_TRUE(matches("usr/bin", "usr/bin/"), "Directory entry");
+    ASSERT_FALSE(matches("usr/bin", "usr/binary"), "Not a path prefix");
+    ASSERT_FALSE(matches("usr/bin", "usr"), "Parent is not selected");
+    ASSERT_TRUE(matches("a\\*b", "a*b"), "Escaped star is literal");
+    ASSERT_FALSE(matches("a\\*b", "axb"), "Escaped star is literal");
+    ASSERT_TRUE(matches("[abc", "[abc"), "Unclosed class is literal");
+    ASSERT_TRUE(matches("", "anything/at/all"), "Empty pattern selects everything");
+    return true;
+}
+
+bool test_glob() {
+    ASSERT_TRUE(matches("*/bin/*", "gcc/bin/gcc"), "Star within a component");
+    ASSERT_TRUE(matches("*/bin/*", "a/b/bin/x"), "Star crosses '/'");
+    ASSERT_FALSE(matches("*/bin/*", "bin/x"), "Star before '/' needs a component");
+    ASSERT_FALSE(matches("*/bin/*", "gcc/lib/x"), "Other directory");
+    ASSERT_TRUE(matches("*.txt", "d/a.txt"), "Suffix");
+    ASSERT_FALSE(matches("*.txt", "a.txt.gz"), "Whole path must match");
+    ASSERT_TRUE(matches("file?.[ch]", "file1.c"), "Question mark and class");
+    ASSERT_FALSE(matches("file?.[ch]", "file12.c"), "Question mark is one character");
+    ASSERT_FALSE(matches("file?.[ch]", "file1.o"), "Class");
+    ASSERT_TRUE(matches("[!a-c]*", "dog"), "Negated range");
+    ASSERT_FALSE(matches("[^a-c]*", "apple"), "Negated range");
+    ASSERT_TRUE(matches("[]x]", "]"), "']' first in a class is literal");
+    ASSERT_TRUE(matches("*/lib", "tc/lib/libc.a"), "Glob selects below a matching directory");
+    ASSERT_TRUE(matches("a**b", "a/x/b"), "Runs of stars");
+    return true;
+}
+
+bool test_include_exclude() {
+    const char *include[] = { "src", "include/*.h" };
+    const char *exclude[] = { "*.o", "src/tmp" };
+    ArcMatcher *m = arc_matcher_new(include, 2, exclude, 2);
+    ASSERT_NOT_NULL(m, "Should compile");
+    ASSERT_TRUE(arc_matcher_match(m, "src/a.c"), "Included");
+    ASSERT_TRUE(arc_matcher_match(m, "include/x.h"), "Included by glob");
+    ASSERT_FALSE(arc_matcher_match(m, "src/a.o"), "Excluded by glob");
+    ASSERT_FALSE(arc_matcher_match(m, "src/tmp/x.c"), "Excluded by literal");
+    ASSERT_FALSE(arc_matcher_match(m, "doc/x"), "Not included");
+    arc_matcher_free(m);
+
+    m = arc_matcher_new(NULL, 0, exclude, 2);
+    ASSERT_TRUE(arc_matcher_match(m, "x.c"), "No includes: everything else");
+    ASSERT_FALSE(arc_matcher_match(m, "x.o"), "Excluded");
+    arc_matcher_free(m);
+    return true;
+}
+
+// Reference: some pattern matches the path or one of its leading directories
+static bool reference_match(char patterns[][32], size_t count, const char *path) {
+    char prefix[64];
+    size_t len = strlen(path);
+    for (size_t end = 1; end <= len; end++) {
+        if (end < len && path[end] != '/') {
+            continue;
+        }
+        memcpy(prefix, path, end);
+        prefix[end] = '\0';
+        for (size_t i = 0; i < count; i++) {
+            if (fnmatch(patterns[i], prefix, 0) == 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool test_random_against_fnmatch() {
+    // Enough patterns that the lazy DFA overflows and the NFA takes over
+    static const char *atoms[] = { "a", "b", "/", "*", "?", "[ab]", "[!a]" };
+    static char patterns[300][32];
+    const char *list[300];
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < 300; i++) {
+        patterns[i][0] = '\0';
+        size_t atoms_count = 2 + (seed = seed * 1103515245 + 12345) % 5;
+        for (size_t j = 0; j < atoms_count; j++) {
+            seed = seed * 1103515245 + 12345;
+            strcat(patterns[i], atoms[(seed >> 16) % 7]);
+        }
+        // Leading and trailing '/' are normalized away; keep the reference simple
+        if (patterns[i][0] == '/' || patterns[i][strlen(patterns[i]) - 1] == '/') {
+            strcpy(patterns[i], "*a*");
+        }
+        list[i] = patterns[i];
+    }
+    // "a, then n more characters" patterns make the DFA state count explode
+    for (size_t i = 0; i < 12; i++) {
+        strcpy(patterns[i], "*a");
+        memset(patterns[i] + 2, '?', i);
+        patterns[i][2 + i] = '\0';
+    }
+    for (size_t count = 12; count <= 300; count += 288) {
+        ArcMatcher *m = arc_matcher_new(list, count, NULL, 0);
+        ASSERT_NOT_NULL(m, "Should compile");
+        size_t mismatches = 0;
+        for (int k = 0; k < 3000; k++) {
+            char path[24];
+            size_t len = 1 + (seed = seed * 1103515245 + 12345) % 20;
+            for (size_t j = 0; j < len; j++) {
+                seed = seed * 1103515245 + 12345;
+                path[j] = "ab/c"[(seed >> 16) % 4];
+            }
+            path[len] = '\0';
+            if (path[0] == '/' || path[len - 1] == '/' || strstr(path, "//")) {
+                continue;
+            }
+            mismatches += arc_matcher_match(m, path) != reference_match(patterns, count, path);
+        }
+        ASSERT_EQ(mismatches, 0, "Matcher should agree with fnmatch");
+        arc_matcher_free(m);
+    }
+    return true;
+}
+
+static bool exists(const char *dir, const char *name) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    struct stat st;
+    return stat(path, &st) == 0;
+}
+
+static const FixtureEntry toolchain[] = {
+    { "tc/", NULL, 0, '5' },
+    { "tc/bin/", NULL, 0, '5' },
+    { "tc/bin/gcc", "gcc binary", 10, '0' },
+    { "tc/bin/ld", "ld binary", 9, '0' },
+    { "tc/lib/libc.a", "archive", 7, '0' },
+    { "tc/README", "read me", 7, '0' },
+};
+
+static bool check_filtered_extract(const char *archive, const char *dest) {
+    mkdir(dest, 0755);
+    const char *include[] = { "*/bin/*" };
+    const char *exclude[] = { "*/ld" };
+    ArcExtractOptions opts;
+    memset(&opts, 0, sizeof(opts));
+    opts.include = include;
+    opts.include_count = 1;
+    opts.exclude = exclude;
+    opts.exclude_count = 1;
+
+    ArcReader *r = arc_open_path(archive);
+    ASSERT_NOT_NULL(r, "Should open archive");
+    ArcExtractReport report;
+    ASSERT_EQ(arc_extract_to_path_ex(r, dest, &opts, &report), 0, "Filtered extraction succeeds");
+    ASSERT_EQ(report.count, 1, "One file selected");
+    ASSERT_STR_EQ(report.files[0].path, "tc/bin/gcc", "The selected file");
+    arc_extract_report_free(&report);
+    arc_close(r);
+
+    ASSERT_TRUE(exists(dest, "tc/bin/gcc"), "Selected file written");
+    ASSERT_FALSE(exists(dest, "tc/bin/ld"), "Excluded file skipped");
+    ASSERT_FALSE(exists(dest, "tc/lib"), "Unselected directory not created");
+    ASSERT_FALSE(exists(dest, "tc/README"), "Unselected file skipped");
+
+    unlink(fixture_path("out/tc/bin/gcc"));
+    rmdir(fixture_path("out/tc/bin"));
+    rmdir(fixture_path("out/tc"));
+    rmdir(dest);
+    return true;
+}
+
+bool test_extract_tar() {
+    uint8_t *tar;
+    size_t tar_size = fixture_tar(toolchain, 6, &tar);
+    char archive[256];
+    snprintf(archive, sizeof(archive), "%s/tc.tar.gz", base_dir);
+    ASSERT_TRUE(fixture_write_gzip(archive, tar, tar_size), "Should write tar.gz");
+    free(tar);
+    char dest[256];
+    snprintf(dest, sizeof(dest), "%s/out", base_dir);
+    bool ok = check_filtered_extract(archive, dest);
+    unlink(archive);
+    return ok;
+}
+
+static bool select_entry(const char *name, void *user) {
+    return arc_matcher_match(user, name);
+}
+
+bool test_extract_zip_prefiltered() {
+    char archive[256];
+    snprintf(archive, sizeof(archive), "%s/tc.zip", base_dir);
+    ASSERT_TRUE(fixture_write_zip(archive, toolchain, 6, false), "Should write zip");
+
+    // Corrupt the local header of tc/lib/libc.a: it must never be read
+    size_t offset = 0;
+    for (size_t i = 0; i < 4; i++) {
+        offset += 30 + strlen(toolchain[i].name) + (toolchain[i].type == '0' ? toolchain[i].size : 0);
+    }
+    int fd = open(archive, O_WRONLY);
+    ASSERT_EQ(pwrite(fd, "XXXX", 4, (off_t)offset), 4, "Should corrupt local header");
+    close(fd);
+
+    char dest[256];
+    snprintf(dest, sizeof(dest), "%s/out", base_dir);
+    bool ok = check_filtered_extract(archive, dest);
+
+    // The central directory filter hides entries from arc_next()
+    const char *include[] = { "tc/lib" };
+    ArcMatcher *m = arc_matcher_new(include, 1, NULL, 0);
+    ArcReader *r = arc_open_path(archive);
+    ASSERT_EQ(arc_zip_set_filter(r, select_entry, m), 0, "Should set filter");
+    ArcEntry entry;
+    ASSERT_EQ(arc_next(r, &entry), 0, "Should read the selected entry");
+    ASSERT_STR_EQ(entry.path, "tc/lib/libc.a", "Only the selected entry");
+    arc_entry_free(&entry);
+    ASSERT_EQ(arc_next(r, &entry), 1, "Nothing else");
+    ASSERT_EQ(arc_zip_set_filter(r, NULL, NULL), 0, "Should clear filter");
+    ASSERT_EQ(arc_rewind(r), 0, "Should rewind");
+    size_t count = 0;
+    while (arc_next(r, &entry) == 0) {
+        count++;
+        arc_entry_free(&entry);
+    }
+    ASSERT_EQ(count, 6, "No filter, every entry");
+    errno = 0;
+    ASSERT_EQ(arc_zip_set_filter(NULL, select_entry, m), -1, "NULL reader");
+    ASSERT_EQ(errno, EINVAL, "Should report EINVAL");
+    arc_close(r);
+    arc_matcher_free(m);
+
+    unlink(archive);
+    return ok;
+}
+
+bool test_extract_entry_ex() {
+    FixtureEntry entries[] = { { "keep.txt", "k", 1, '0' }, { "drop.txt", "d", 1, '0' } };
+    uint8_t *tar;
+    size_t tar_size = fixture_tar(entries, 2, &tar);
+    char archive[256];
+    snprintf(archive, sizeof(archive), "%s/one.tar", base_dir);
+    ASSERT_TRUE(fixture_write_file(archive, tar, tar_size), "Should write tar");
+    free(tar);
+    ArcReader *r = arc_open_path(archive);
+    ASSERT_NOT_NULL(r, "Should open tar");
+    char dest[256];
+    snprintf(dest, sizeof(dest), "%s/one", base_dir);
+    mkdir(dest, 0755);
+
+    const char *exclude[] = { "drop*" };
+    ArcExtractOptions opts;
+    memset(&opts, 0, sizeof(opts));
+    opts.exclude = exclude;
+    opts.exclude_count = 1;
+    ArcEntry entry;
+    for (int i = 0; i < 2; i++) {
+        ASSERT_EQ(arc_next(r, &entry), 0, "Should read entry");
+        ASSERT_EQ(arc_extract_entry_ex(r, &entry, dest, &opts, NULL), 0, "Extracted or skipped");
+        arc_entry_free(&entry);
+    }
+    ASSERT_TRUE(exists(dest, "keep.txt"), "Selected entry written");
+    ASSERT_FALSE(exists(dest, "drop.txt"), "Excluded entry skipped");
+
+    const char *bad[] = { NULL };
+    opts.exclude = bad;
+    ASSERT_EQ(arc_rewind(r), 0, "Should rewind");
+    ASSERT_EQ(arc_next(r, &entry), 0, "Should read entry");
+    errno = 0;
+    ASSERT_EQ(arc_extract_entry_ex(r, &entry, dest, &opts, NULL), -1, "NULL pattern");
+    ASSERT_EQ(errno, EINVAL, "Should report EINVAL");
+    arc_entry_free(&entry);
+
+    arc_close(r);
+    unlink(archive);
+    unlink(fixture_path("one/keep.txt"));
+    rmdir(dest);
+    return true;
+}
+
+bool test_invalid() {
+    ASSERT_NULL(arc_matcher_new(NULL, 1, NULL, 0), "NULL include list");
+    ASSERT_NULL(arc_matcher_new(NULL, 0, NULL, 2), "NULL exclude list");
+    const char *list[] = { "a", NULL };
+    errno = 0;
+    ASSERT_NULL(arc_matcher_new(list, 2, NULL, 0), "NULL pattern");
+    ASSERT_EQ(errno, EINVAL, "Should report EINVAL");
+    ArcMatcher *m = arc_matcher_new(NULL, 0, NULL, 0);
+    ASSERT_NOT_NULL(m, "No patterns");
+    ASSERT_TRUE(arc_matcher_match(m, "x"), "No patterns select everything");
+    ASSERT_FALSE(arc_matcher_match(m, NULL), "NULL path");
+    ASSERT_FALSE(arc_matcher_match(NULL, "x"), "NULL matcher");
+    arc_matcher_free(m);
+    arc_matcher_free(NULL);
+    return true;
+}
+
+int main() {
+    printf("=== Match Tests ===\n\n");
+
+    snprintf(base_dir, sizeof(base_dir), "/tmp/cupidarchive_match_test_%ld", (long)getpid());
+    mkdir(base_dir, 0755);
+
+    RUN_TEST(test_literal);
+    RUN_TEST(test_glob);
+    RUN_TEST(test_include_exclude);
+    RUN_TEST(test_random_against_fnmatch);
+    RUN_TEST(test_extract_tar);
+    RUN_TEST(test_extract_zip_prefiltered);
+    RUN_TEST(test_extract_entry_ex);
+    RUN_TEST(test_invalid);
+
+    rmdir(base_dir);
+
+    PRINT_SUMMARY();
+}
@@ -0,0 +1,338 @@
+#define _POSIX_C_SOURCE 200809L
+#include "test_runner.h"
+#include "test_fixtures.h"
+#include "../cupidarchive.h"
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+static char base_dir[128];
+static char path_buf[192];
+
+#define PAYLOAD_SIZE (200 * 1024 + 31)
+
+static uint8_t *payload;
+
+static const char *archive(const char *name) {
+    snprintf(path_buf, sizeof(path_buf), "%s/%s", base_dir, name);
+    return path_buf;
+}
+
+// Load a fixture archive back into memory so it can be nested in another one
+static uint8_t *slurp(const char *path, size_t *size_out) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *buf = malloc(size > 0 ? (size_t)size : 1);
+    if (buf && fread(buf, 1, (size_t)size, f) != (size_t)size) {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    *size_out = (size_t)size;
+    return buf;
+}
+
+// Inner ZIP with one stored payload file (stored so its size tracks the payload)
+static uint8_t *build_inner_zip(size_t *size_out) {
+    FixtureEntry files[] = {
+        { "docs/", NULL, 0, '5' },
+        { "docs/payload.bin", payload, PAYLOAD_SIZE, '0' },
+    };
+    if (!fixture_write_zip(archive("inner.zip"), files, 2, false)) {
+        return NULL;
+    }
+    return slurp(path_buf, size_out);
+}
+
+// Advance to `name` and check that the nested archive holds the payload
+static bool check_nested_payload(ArcReader *outer, const char *name, const char *inner_name) {
+    ArcEntry entry;
+    bool found = false;
+    while (!found && arc_next(outer, &entry) == 0) {
+        found = strcmp(entry.path, name) == 0;
+        arc_entry_free(&entry);
+    }
+    ASSERT_TRUE(found, "Outer archive should contain the nested archive");
+
+    ArcReader *inner = arc_open_nested(outer);
+    ASSERT_NOT_NULL(inner, "Should open nested archive");
+    found = false;
+    while (!found && arc_next(inner, &entry) == 0) {
+        found = strcmp(entry.path, inner_name) == 0;
+        arc_entry_free(&entry);
+    }
+    ASSERT_TRUE(found, "Nested archive should list the payload");
+
+    ArcStream *data = arc_open_data(inner);
+    ASSERT_NOT_NULL(data, "Should open nested entry data");
+    uint8_t *buf = malloc(PAYLOAD_SIZE + 1);
+    size_t total = 0;
+    ssize_t got;
+    while ((got = arc_stream_read(data, buf + total, PAYLOAD_SIZE + 1 - total)) > 0) {
+        total += (size_t)got;
+    }
+    arc_stream_close(data);
+    bool same = total == PAYLOAD_SIZE && memcmp(buf, payload, PAYLOAD_SIZE) == 0;
+    free(buf);
+    arc_close(inner);
+    ASSERT_TRUE(same, "Nested payload should match");
+    return true;
+}
+
+bool test_spill_stream() {
+    uint8_t *packed = NULL;
+    size_t packed_size = 0;
+    ASSERT_TRUE(fixture_write_gzip(archive("payload.gz"), payload, PAYLOAD_SIZE), "Should write gzip");
+    packed = slurp(path_buf, &packed_size);
+    ASSERT_NOT_NULL(packed, "Should read gzip back");
+
+    ArcStream *mem = arc_stream_from_memory(packed, packed_size, 0);
+    ArcStream *filter = arc_filter_gzip(mem, 0);
+    ASSERT_FALSE(arc_stream_is_seekable(filter), "Filters are forward-only");
+    ArcStream *spill = arc_stream_spill(filter, NULL, 0, PAYLOAD_SIZE);
+    ASSERT_NOT_NULL(spill, "Should create spill stream");
+
+    uint8_t buf[100];
+    ASSERT_EQ(arc_stream_seek(spill, -100, SEEK_END), 0, "Should seek relative to the end");
+    ASSERT_EQ(arc_stream_read(spill, buf, sizeof(buf)), 100, "Should read the tail");
+    ASSERT(memcmp(buf, payload + PAYLOAD_SIZE - 100, 100) == 0, "Tail should match");
+    ASSERT_EQ(arc_stream_seek(spill, 1000, SEEK_SET), 0, "Should seek back into the buffer");
+    ASSERT_EQ(arc_stream_read(spill, buf, sizeof(buf)), 100, "Should replay buffered bytes");
+    ASSERT(memcmp(buf, payload + 1000, 100) == 0, "Replayed bytes should match");
+    ASSERT_TRUE(arc_stream_is_seekable(spill), "Nothing dropped, so still seekable");
+    arc_stream_close(spill);
+    arc_stream_close(mem);
+
+    // Past its capacity the spill keeps streaming but can't go back
+    mem = arc_stream_from_memory(packed, packed_size, 0);
+    filter = arc_filter_gzip(mem, 0);
+    spill = arc_stream_spill(filter, "", 0, 4096);
+    ASSERT_EQ(arc_stream_seek(spill, 10000, SEEK_SET), 0, "Forward seeks read through");
+    ASSERT_EQ(arc_stream_read(spill, buf, sizeof(buf)), 100, "Should keep streaming");
+    ASSERT(memcmp(buf, payload + 10000, 100) == 0, "Streamed bytes should match");
+    ASSERT_FALSE(arc_stream_is_seekable(spill), "Dropped bytes make it forward-only");
+    ASSERT_EQ(arc_stream_seek(spill, 100, SEEK_SET), 0, "Buffered prefix is still reachable");
+    errno = 0;
+    ASSERT_EQ(arc_stream_seek(spill, 5000, SEEK_SET), -1, "Dropped range can't be reached");
+    ASSERT_EQ(errno, EFBIG, "Should report EFBIG");
+    arc_stream_close(spill);
+    arc_stream_close(mem);
+    free(packed);
+    return true;
+}
+
+bool test_stored_zip_in_zip() {
+    size_t inner_size = 0;
+    uint8_t *inner = build_inner_zip(&inner_size);
+    ASSERT_NOT_NULL(inner, "Should build inner zip");
+    FixtureEntry files[] = {
+        { "readme.txt", "outer", 5, '0' },
+        { "bundle/inner.zip", inner, inner_size, '0' },
+    };
+    bool ok = fixture_write_zip(archive("outer_stored.zip"), files, 2, false);
+    free(inner);
+    ASSERT_TRUE(ok, "Should write outer zip");
+
+    ArcReader *outer = arc_open_path(path_buf);
+    ASSERT_NOT_NULL(outer, "Should open outer zip");
+    ArcEntry entry;
+    ASSERT_EQ(arc_next(outer, &entry), 0, "Should read first entry");
+    arc_entry_free(&entry);
+    ASSERT_EQ(arc_next(outer, &entry), 0, "Should read nested entry");
+    arc_entry_free(&entry);
+    ArcStream *data = arc_open_data(outer);
+    ASSERT_TRUE(arc_stream_is_seekable(data), "Stored entries of a file are seekable as-is");
+    arc_stream_close(data);
+    arc_close(outer);
+
+    outer = arc_open_path(path_buf);
+    ok = check_nested_payload(outer, "bundle/inner.zip", "docs/payload.bin");
+    arc_close(outer);
+    return ok;
+}
+
+bool test_deflated_zip_in_zip() {
+    size_t inner_size = 0;
+    uint8_t *inner = build_inner_zip(&inner_size);
+    ASSERT_NOT_NULL(inner, "Should build inner zip");
+    FixtureEntry files[] = { { "inner.zip", inner, inner_size, '0' } };
+    bool ok = fixture_write_zip(archive("outer_deflate.zip"), files, 1, true);
+    free(inner);
+    ASSERT_TRUE(ok, "Should write outer zip");
+
+    ArcReader *outer = arc_open_path(path_buf);
+    ASSERT_NOT_NULL(outer, "Should open outer zip");
+    ok = check_nested_payload(outer, "inner.zip", "docs/payload.bin");
+    arc_close(outer);
+    return ok;
+}
+
+bool test_tar_gz_in_zip() {
+    FixtureEntry tar_files[] = { { "data/payload.bin", payload, PAYLOAD_SIZE, '0' } };
+    uint8_t *tar = NULL;
+    size_t tar_size = fixture_tar(tar_files, 1, &tar);
+    ASSERT(tar_size > 0, "Should build tar");
+    bool ok = fixture_write_gzip(archive("inner.tar.gz"), tar, tar_size);
+    free(tar);
+    size_t inner_size = 0;
+    uint8_t *inner = ok ? slurp(path_buf, &inner_size) : NULL;
+    ASSERT_NOT_NULL(inner, "Should build inner tar.gz");
+
+    FixtureEntry files[] = { { "logs.tar.gz", inner, inner_size, '0' } };
+    ok = fixture_write_zip(archive("outer_tgz.zip"), files, 1, true);
+    free(inner);
+    ASSERT_TRUE(ok, "Should write outer zip");
+
+    ArcReader *outer = arc_open_path(path_buf);
+    ASSERT_NOT_NULL(outer, "Should open outer zip");
+    ok = check_nested_payload(outer, "logs.tar.gz", "data/payload.bin");
+    arc_close(outer);
+    return ok;
+}
+
+bool test_zip_in_tar_gz() {
+    size_t inner_size = 0;
+    uint8_t *inner = build_inner_zip(&inner_size);
+    ASSERT_NOT_NULL(inner, "Should build inner zip");
+    FixtureEntry tar_files[] = {
+        { "first.txt", "first", 5, '0' },
+        { "bundle.zip", inner, inner_size, '0' },
+    };
+    uint8_t *tar = NULL;
+    size_t tar_size = fixture_tar(tar_files, 2, &tar);
+    free(inner);
+    bool ok = tar_size > 0 && fixture_write_gzip(archive("outer.tar.gz"), tar, tar_size);
+    free(tar);
+    ASSERT_TRUE(ok, "Should write outer tar.gz");
+
+    ArcReader *outer = arc_open_path(path_buf);
+    ASSERT_NOT_NULL(outer, "Should open outer tar.gz");
+    ok = check_nested_payload(outer, "bundle.zip", "docs/payload.bin");
+    arc_close(outer);
+    return ok;
+}
+
+bool test_nesting_limit() {
+    size_t inner_size = 0;
+    uint8_t *inner = build_inner_zip(&inner_size);
+    ASSERT_NOT_NULL(inner, "Should build inner zip");
+    FixtureEntry mid_files[] = { { "inner.zip", inner, inner_size, '0' } };
+    bool ok = fixture_write_zip(archive("mid.zip"), mid_files, 1, false);
+    free(inner);
+    size_t mid_size = 0;
+    uint8_t *mid = ok ? slurp(path_buf, &mid_size) : NULL;
+    ASSERT_NOT_NULL(mid, "Should build middle zip");
+    FixtureEntry files[] = { { "mid.zip", mid, mid_size, '0' } };
+    ok = fixture_write_zip(archive("outer_nested.zip"), files, 1, false);
+    free(mid);
+    ASSERT_TRUE(ok, "Should write outer zip");
+
+    ArcLimits limits;
+    memset(&limits, 0, sizeof(limits));
+    limits.max_archive_nesting = 1;
+    ArcReader *outer = arc_open_path_ex(path_buf, &limits);
+    ASSERT_NOT_NULL(outer, "Should open outer zip");
+    ArcEntry entry;
+    ASSERT_EQ(arc_next(outer, &entry), 0, "Should read outer entry");
+    arc_entry_free(&entry);
+    ArcReader *level1 = arc_open_nested(outer);
+    ASSERT_NOT_NULL(level1, "First nesting level is allowed");
+    ASSERT_EQ(arc_next(level1, &entry), 0, "Should read middle entry");
+    arc_entry_free(&entry);
+    errno = 0;
+    ArcReader *level2 = arc_open_nested(level1);
+    int saved = errno;
+    arc_close(level2);
+    arc_close(level1);
+    arc_close(outer);
+    ASSERT_NULL(level2, "Second nesting level exceeds the limit");
+    ASSERT_EQ(saved, ELOOP, "Should report ELOOP");
+
+    // Default limits allow it
+    outer = arc_open_path(path_buf);
+    ASSERT_NOT_NULL(outer, "Should reopen outer zip");
+    ASSERT_EQ(arc_next(outer, &entry), 0, "Should read outer entry");
+    arc_entry_free(&entry);
+    level1 = arc_open_nested(outer);
+    ASSERT_NOT_NULL(level1, "Should open middle zip");
+    ok = check_nested_payload(level1, "inner.zip", "docs/payload.bin");
+    arc_close(level1);
+    arc_close(outer);
+    return ok;
+}
+
+bool test_spill_limit() {
+    // archive("outer_deflate.zip") holds a 200 KiB inner ZIP behind deflate
+    ArcLimits limits;
+    memset(&limits, 0, sizeof(limits));
+    limits.max_nested_spill = 4096;
+    ArcReader *outer = arc_open_path_ex(archive("outer_deflate.zip"), &limits);
+    ASSERT_NOT_NULL(outer, "Should open outer zip");
+    ArcEntry entry;
+    ASSERT_EQ(arc_next(outer, &entry), 0, "Should read nested entry");
+    arc_entry_free(&entry);
+    errno = 0;
+    ArcReader *inner = arc_open_nested(outer);
+    int saved = errno;
+    arc_close(inner);
+    arc_close(outer);
+    ASSERT_NULL(inner, "Inner ZIP larger than the spill limit should fail");
+    ASSERT_EQ(saved, EFBIG, "Should report EFBIG");
+    return true;
+}
+
+bool test_open_stream_tar_gz() {
+    FixtureEntry files[] = { { "a.txt", "hello", 5, '0' } };
+    uint8_t *tar = NULL;
+    size_t tar_size = fixture_tar(files, 1, &tar);
+    bool ok = fixture_write_gzip(archive("stream.tar.gz"), tar, tar_size);
+    free(tar);
+    size_t packed_size = 0;
+    uint8_t *packed = ok ? slurp(path_buf, &packed_size) : NULL;
+    ASSERT_NOT_NULL(packed, "Should build tar.gz");
+
+    ArcReader *reader = arc_open_stream(arc_stream_from_memory(packed, packed_size, 0));
+    ASSERT_NOT_NULL(reader, "Should open tar.gz from a stream");
+    ArcEntry entry;
+    ASSERT_EQ(arc_next(reader, &entry), 0, "Should read first entry");
+    ASSERT_STR_EQ(entry.path, "a.txt", "Entry path should match");
+    arc_entry_free(&entry);
+    ASSERT_EQ(arc_next(reader, &entry), 1, "Should reach the end");
+    arc_close(reader);
+    free(packed);
+    return true;
+}
+
+int main() {
+    printf("=== Nested Archive Tests ===\n\n");
+
+    snprintf(base_dir, sizeof(base_dir), "/tmp/cupidarchive_nested_test_%ld", (long)getpid());
+    mkdir(base_dir, 0755);
+    payload = fixture_pattern(PAYLOAD_SIZE, 3);
+
+    RUN_TEST(test_spill_stream);
+    RUN_TEST(test_stored_zip_in_zip);
+    RUN_TEST(test_deflated_zip_in_zip);
+    RUN_TEST(test_tar_gz_in_zip);
+    RUN_TEST(test_zip_in_tar_gz);
+    RUN_TEST(test_nesting_limit);
+    RUN_TEST(test_spill_limit);
+    RUN_TEST(test_open_stream_tar_gz);
+
+    const char *names[] = { "payload.gz", "inner.zip", "outer_stored.zip", "outer_deflate.zip",
+                            "inner.tar.gz", "outer_tgz.zip", "outer.tar.gz", "mid.zip",
+                            "outer_nested.zip", "stream.tar.gz" };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        unlink(archive(names[i]));
+    }
+    rmdir(base_dir);
+    free(payload);
+
+    PRINT_SUMMARY();
+}
@@ -0,0 +1,371 @@
+#define _POSIX_C_SOURCE 200809L
+#include "test_runner.h"
+#include "test_fixtures.h"
+#include "../cupidarchive.h"
+#include "arc_base.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+static char base_dir[128];
+static char zip_path[192];
+static char tar_path[192];
+static char tgz_path[192];
+
+static const FixtureEntry files[] = {
+    { "docs/", NULL, 0, '5' },
+    { "docs/a.txt", "alpha\n", 6, '0' },
+    { "docs/b.txt", "bravo bravo\n", 12, '0' },
+};
+#define FILE_COUNT (sizeof(files) / sizeof(files[0]))
+
+// Walk every entry from the start, reading file data; returns entries seen or -1
+static int walk(ArcReader *reader) {
+    ArcEntry entry;
+    int n = 0;
+    int ret;
+    while ((ret = arc_next(reader, &entry)) == 0) {
+        if (entry.type == ARC_ENTRY_FILE) {
+            ArcStream *s = arc_open_data(reader);
+            char buf[64];
+            ssize_t got = s ? arc_stream_read(s, buf, sizeof(buf)) : -1;
+            arc_stream_close(s);
+            if (got != (ssize_t)entry.size) {
+                arc_entry_free(&entry);
+                return -1;
+            }
+        }
+        arc_entry_free(&entry);
+        n++;
+    }
+    return ret == 1 ? n : -1;
+}
+
+bool test_reuse_after_release() {
+    ArcReaderCache *cache = arc_reader_cache_new(0, 0, NULL);
+    ASSERT_NOT_NULL(cache, "Should create cache");
+
+    ArcReader *r1 = arc_reader_cache_acquire(cache, zip_path);
+    ASSERT_NOT_NULL(r1, "Should open zip");
+    ASSERT_EQ(walk(r1), (int)FILE_COUNT, "Should list every entry");
+    arc_reader_cache_release(cache, r1);
+
+    ArcReader *r2 = arc_reader_cache_acquire(cache, zip_path);
+    ASSERT(r2 == r1, "Idle reader should be reused");
+    ASSERT_EQ(walk(r2), (int)FILE_COUNT, "Reused reader should start from the first entry");
+    arc_reader_cache_release(cache, r2);
+
+    ArcReaderCacheStats stats;
+    arc_reader_cache_stats(cache, &stats);
+    ASSERT_EQ(stats.opens, 1, "Archive should be opened once");
+    ASSERT_EQ(stats.hits, 1, "Second acquire should be a hit");
+    ASSERT_EQ(stats.open_readers, 1, "One reader should be held");
+    ASSERT_EQ(stats.idle_readers, 1, "It should be idle");
+    ASSERT(stats.metadata_bytes > 0, "Central directory should be accounted");
+    arc_reader_cache_free(cache);
+    return true;
+}
+
+bool test_zip_clone_when_busy() {
+    ArcReaderCache *cache = arc_reader_cache_new(0, 0, NULL);
+    ASSERT_NOT_NULL(cache, "Should create cache");
+
+    ArcReader *r1 = arc_reader_cache_acquire(cache, zip_path);
+    ASSERT_NOT_NULL(r1, "Should open zip");
+    ArcEntry entry;
+    ASSERT_EQ(arc_next(r1, &entry), 0, "First cursor should advance");
+    arc_entry_free(&entry);
+
+    ArcReader *r2 = arc_reader_cache_acquire(cache, zip_path);
+    ASSERT_NOT_NULL(r2, "Should hand out a second cursor");
+    ASSERT(r2 != r1, "Busy reader must not be shared");
+    ASSERT_EQ(walk(r2), (int)FILE_COUNT, "Clone should start from the first entry");
+    ASSERT_EQ(walk(r1), (int)FILE_COUNT - 1, "Original cursor should be unaffected");
+
+    ArcReaderCacheStats stats;
+    arc_reader_cache_stats(cache, &stats);
+    ASSERT_EQ(stats.clones, 1, "Second cursor should be a clone");
+    ASSERT_EQ(stats.opens, 1, "Clone should not reparse the archive");
+
+    // Closing the original first must leave the shared directory alive
+    arc_reader_cache_invalidate(cache, zip_path);
+    arc_reader_cache_release(cache, r1);
+    ASSERT_EQ(walk(r2), 0, "Exhausted clone should stay usable");
+    arc_reader_cache_release(cache, r2);
+    arc_reader_cache_stats(cache, &stats);
+    ASSERT_EQ(stats.open_readers, 0, "Invalidated readers should be closed on release");
+    arc_reader_cache_free(cache);
+    return true;
+}
+
+bool test_clone_inherits_directory_charge() {
+    // One fd: releasing a reader evicts it while its clone still holds the directory
+    ArcReaderCache *cache = arc_reader_cache_new(1, 0, NULL);
+    ASSERT_NOT_NULL(cache, "Should create cache");
+
+    ArcReader *r1 = arc_reader_cache_acquire(cache, zip_path);
+    ASSERT_NOT_NULL(r1, "Should open zip");
+    ArcReaderCacheStats stats;
+    arc_reader_cache_stats(cache, &stats);
+    uint64_t single = stats.metadata_bytes;
+
+    ArcReader *r2 = arc_reader_cache_acquire(cache, zip_path);
+    ASSERT_NOT_NULL(r2, "Should clone the busy reader");
+    arc_reader_cache_release(cache, r1);
+    arc_reader_cache_stats(cache, &stats);
+    ASSERT_EQ(stats.clones, 1, "Second cursor should be a clone");
+    ASSERT_EQ(stats.evictions, 1, "Released original should be evicted");
+    ASSERT_EQ(stats.metadata_bytes, single, "Clone should carry the directory charge");
+
+    // And again from the clone, which now owns the charge
+    ArcReader *r3 = arc_reader_cache_acquire(cache, zip_path);
+    ASSERT_NOT_NULL(r3, "Should clone the clone");
+    arc_reader_cache_release(cache, r2);
+    arc_reader_cache_stats(cache, &stats);
+    ASSERT_EQ(stats.clones, 2, "Third cursor should be a clone");
+    ASSERT_EQ(stats.metadata_bytes, single, "Charge should move on again");
+    ASSERT_EQ(walk(r3), (int)FILE_COUNT, "Last clone should still list the archive");
+    arc_reader_cache_release(cache, r3);
+    arc_reader_cache_stats(cache, &stats);
+    ASSERT_EQ(stats.open_readers, 1, "Last clone should stay cached");
+    ASSERT_EQ(stats.metadata_bytes, single, "Idle clone keeps the charge");
+    arc_reader_cache_free(cache);
+    return true;
+}
+
+bool test_tar_rewind_and_tgz_reopen() {
+    ArcReaderCache *cache = arc_reader_cache_new(0, 0, NULL);
+    ASSERT_NOT_NULL(cache, "Should create cache");
+
+    for (int i = 0; i < 2; i++) {
+        ArcReader *r = arc_reader_cache_acquire(cache, tar_path);
+        ASSERT_NOT_NULL(r, "Should open tar");
+        ASSERT_EQ(walk(r), (int)FILE_COUNT, "Should list tar");
+        arc_reader_cache_release(cache, r);
+
+        r = arc_reader_cache_acquire(cache, tgz_path);
+        ASSERT_NOT_NULL(r, "Should open tar.gz");
+        ASSERT_EQ(walk(r), (int)FILE_COUNT, "Should list tar.gz");
+        arc_reader_cache_release(cache, r);
+    }
+    ArcReaderCacheStats stats;
+    arc_reader_cache_stats(cache, &stats);
+    ASSERT_EQ(stats.hits, 1, "Plain tar should rewind");
+    ASSERT_EQ(stats.opens, 3, "tar.gz can't rewind and should be reopened");
+    arc_reader_cache_free(cache);
+    return true;
+}
+
+bool test_invalidate_on_change() {
+    ArcReaderCache *cache = arc_reader_cache_new(0, 0, NULL);
+    ASSERT_NOT_NULL(cache, "Should create cache");
+
+    ArcReader *r = arc_reader_cache_acquire(cache, zip_path);
+    ASSERT_NOT_NULL(r, "Should open zip");
+    arc_reader_cache_release(cache, r);
+
+    // Rewrite with one more entry
+    FixtureEntry more[FILE_COUNT + 1];
+    memcpy(more, files, sizeof(files));
+    more[FILE_COUNT] = (FixtureEntry){ "docs/c.txt", "charlie\n", 8, '0' };
+    ASSERT_TRUE(fixture_write_zip(zip_path, more, FILE_COUNT + 1, false), "Should rewrite zip");
+
+    r = arc_reader_cache_acquire(cache, zip_path);
+    ASSERT_NOT_NULL(r, "Should reopen zip");
+    ASSERT_EQ(walk(r), (int)FILE_COUNT + 1, "Should see the new contents");
+    arc_reader_cache_release(cache, r);
+
+    ArcReaderCacheStats stats;
+    arc_reader_cache_stats(cache, &stats);
+    ASSERT_EQ(stats.invalidations, 1, "Stale reader should be dropped");
+    ASSERT_EQ(stats.opens, 2, "Changed file should be reopened");
+    ASSERT_EQ(stats.open_readers, 1, "Only the fresh reader should be held");
+
+    ASSERT_TRUE(fixture_write_zip(zip_path, files, FILE_COUNT, true), "Should restore zip");
+    arc_reader_cache_free(cache);
+    return true;
+}
+
+bool test_fd_bound_evicts_lru() {
+    ArcReaderCache *cache = arc_reader_cache_new(2, 0, NULL);
+    ASSERT_NOT_NULL(cache, "Should create cache");
+
+    const char *paths[] = { zip_path, tar_path, tgz_path };
+    for (size_t i = 0; i < 3; i++) {
+        ArcReader *r = arc_reader_cache_acquire(cache, paths[i]);
+        ASSERT_NOT_NULL(r, "Should open archive");
+        arc_reader_cache_release(cache, r);
+    }
+    ArcReaderCacheStats stats;
+    arc_reader_cache_stats(cache, &stats);
+    ASSERT_EQ(stats.open_readers, 2, "Cache should stay within the fd bound");
+    ASSERT_EQ(stats.evictions, 1, "Least recently used reader should be evicted");
+
+    // The zip was least recently used, so it's reopened; the tar is still there
+    ArcReader *r = arc_reader_cache_acquire(cache, tar_path);
+    arc_reader_cache_release(cache, r);
+    r = arc_reader_cache_acquire(cache, zip_path);
+    arc_reader_cache_release(cache, r);
+    arc_reader_cache_stats(cache, &stats);
+    ASSERT_EQ(stats.hits, 1, "Recently used tar should be a hit");
+    ASSERT_EQ(stats.opens, 4, "Evicted zip should be reopened");
+
+    // A metadata bound smaller than one reader keeps nothing idle
+    ArcReaderCache *tiny = arc_reader_cache_new(0, 1, NULL);
+    r = arc_reader_cache_acquire(tiny, zip_path);
+    ASSERT_NOT_NULL(r, "Checked-out reader may exceed the bound");
+    arc_reader_cache_release(tiny, r);
+    arc_reader_cache_stats(tiny, &stats);
+    ASSERT_EQ(stats.open_readers, 0, "Idle reader over the metadata bound should be closed");
+    arc_reader_cache_free(tiny);
+    arc_reader_cache_free(cache);
+    return true;
+}
+
+typedef struct WorkerArgs {
+    ArcReaderCache *cache;
+    int failures;
+} WorkerArgs;
+
+static void *worker(void *arg) {
+    WorkerArgs *args = arg;
+    for (int i = 0; i < 50; i++) {
+        ArcReader *r = arc_reader_cache_acquire(args->cache, zip_path);
+        if (!r || walk(r) != (int)FILE_COUNT) {
+            args->failures++;
+        }
+        arc_reader_cache_release(args->cache, r);
+    }
+    return NULL;
+}
+
+bool test_concurrent_acquire() {
+    ArcReaderCache *cache = arc_reader_cache_new(3, 0, NULL);
+    ASSERT_NOT_NULL(cache, "Should create cache");
+
+    pthread_t threads[4];
+    WorkerArgs args[4];
+    for (int i = 0; i < 4; i++) {
+        args[i].cache = cache;
+        args[i].failures = 0;
+        ASSERT_EQ(pthread_create(&threads[i], NULL, worker, &args[i]), 0, "Should start thread");
+    }
+    int failures = 0;
+    for (int i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+        failures += args[i].failures;
+    }
+    ASSERT_EQ(failures, 0, "Every cursor should see the full archive");
+
+    ArcReaderCacheStats stats;
+    arc_reader_cache_stats(cache, &stats);
+    ASSERT_EQ(stats.hits + stats.clones + stats.opens, 200, "Every acquire should be counted");
+    ASSERT(stats.open_readers <= 3, "Idle readers should respect the fd bound");
+    ASSERT_EQ(stats.open_readers, stats.idle_readers, "Nothing should remain checked out");
+    arc_reader_cache_free(cache);
+    return true;
+}
+
+typedef struct LimitsArgs {
+    ArcReaderCache *cache;
+    uint64_t max_entries;
+    int failures;
+} LimitsArgs;
+
+static void *limits_worker(void *arg) {
+    LimitsArgs *args = arg;
+    for (int i = 0; i < 50; i++) {
+        ArcReader *r = arc_reader_cache_acquire(args->cache, i % 2 ? zip_path : tar_path);
+        if (!r || ((ArcReaderBase *)r)->limits->max_entries != args->max_entries || walk(r) != (int)FILE_COUNT) {
+            args->failures++;
+        }
+        arc_reader_cache_release(args->cache, r);
+    }
+    return NULL;
+}
+
+bool test_limits_per_reader() {
+    // Each reader keeps the limits it was opened with
+    ArcLimits a = { .max_entries = 1000 };
+    ArcLimits b = { .max_entries = 2000 };
+    ArcReader *ra = arc_open_path_ex(zip_path, &a);
+    ArcReader *rb = arc_open_path_ex(zip_path, &b);
+    ASSERT_NOT_NULL(ra, "Should open with the first limits");
+    ASSERT_NOT_NULL(rb, "Should open with the second limits");
+    ASSERT_EQ(((ArcReaderBase *)ra)->limits->max_entries, 1000, "Later opens should not change earlier readers");
+    ASSERT_EQ(((ArcReaderBase *)ra)->limits->max_name, arc_default_limits()->max_name, "Zero fields take defaults");
+    ASSERT_EQ(((ArcReaderBase *)rb)->limits->max_entries, 2000, "Second reader should have its own limits");
+    arc_close(ra);
+    arc_close(rb);
+
+    // Caches with different limits opening and cloning on several threads
+    ArcReaderCache *caches[2] = { arc_reader_cache_new(2, 0, &a), arc_reader_cache_new(2, 0, &b) };
+    pthread_t threads[4];
+    LimitsArgs args[4];
+    for (int i = 0; i < 4; i++) {
+        args[i].cache = caches[i % 2];
+        args[i].max_entries = i % 2 ? 2000 : 1000;
+        args[i].failures = 0;
+        ASSERT_EQ(pthread_create(&threads[i], NULL, limits_worker, &args[i]), 0, "Should start thread");
+    }
+    int failures = 0;
+    for (int i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+        failures += args[i].failures;
+    }
+    ASSERT_EQ(failures, 0, "Every reader should keep its cache's limits");
+    arc_reader_cache_free(caches[0]);
+    arc_reader_cache_free(caches[1]);
+    return true;
+}
+
+bool test_invalid_args() {
+    ASSERT_NULL(arc_reader_cache_acquire(NULL, zip_path), "NULL cache should fail");
+    ArcReaderCache *cache = arc_reader_cache_new(0, 0, NULL);
+    ASSERT_NULL(arc_reader_cache_acquire(cache, "/nonexistent/archive.zip"), "Missing file should fail");
+    ArcReaderCacheStats stats;
+    arc_reader_cache_stats(cache, &stats);
+    ASSERT_EQ(stats.open_readers, 0, "Failed acquire should hold nothing");
+    arc_reader_cache_free(cache);
+    return true;
+}
+
+int main() {
+    printf("=== Reader Cache Tests ===\n\n");
+
+    snprintf(base_dir, sizeof(base_dir), "/tmp/cupidarchive_rcache_test_%ld", (long)getpid());
+    mkdir(base_dir, 0755);
+    snprintf(zip_path, sizeof(zip_path), "%s/a.zip", base_dir);
+    snprintf(tar_path, sizeof(tar_path), "%s/a.tar", base_dir);
+    snprintf(tgz_path, sizeof(tgz_path), "%s/a.tar.gz", base_dir);
+
+    uint8_t *tar = NULL;
+    size_t size = fixture_tar(files, FILE_COUNT, &tar);
+    if (!fixture_write_zip(zip_path, files, FILE_COUNT, true) ||
+        !fixture_write_file(tar_path, tar, size) ||
+        !fixture_write_gzip(tgz_path, tar, size)) {
+        printf("Could not write fixtures in %s\n", base_dir);
+        free(tar);
+        return 1;
+    }
+    free(tar);
+
+    RUN_TEST(test_reuse_after_release);
+    RUN_TEST(test_zip_clone_when_busy);
+    RUN_TEST(test_clone_inherits_directory_charge);
+    RUN_TEST(test_tar_rewind_and_tgz_reopen);
+    RUN_TEST(test_invalidate_on_change);
+    RUN_TEST(test_fd_bound_evicts_lru);
+    RUN_TEST(test_concurrent_acquire);
+    RUN_TEST(test_limits_per_reader);
+    RUN_TEST(test_invalid_args);
+
+    unlink(zip_path);
+    unlink(tar_path);
+    unlink(tgz_path);
+    rmdir(base_dir);
+
+    PRINT_SUMMARY();
+}
@@ -0,0 +1,380 @@
+#define _POSIX_C_SOURCE 200809L
+#include "test_runner.h"
+#include "test_fixtures.h"
+#include "../cupidarchive.h"
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#define SHARDS 8
+#define SAMPLES 5
+
+static char base_dir[128];
+static char paths[SHARDS + 2][256];
+static const char *path_list[SHARDS + 2];
+
+// Shard s: samples "s<s>/<i>" with fields "txt" and "cls" (odd shards are ZIP)
+static bool write_shard(size_t s) {
+    static char names[SAMPLES * 2][32];
+    static char texts[SAMPLES][32];
+    FixtureEntry entries[SAMPLES * 2];
+    for (size_t i = 0; i < SAMPLES; i++) {
+        snprintf(names[2 * i], sizeof(names[0]), "s%zu/%zu.txt", s, i);
+        snprintf(names[2 * i + 1], sizeof(names[0]), "s%zu/%zu.cls", s, i);
+        snprintf(texts[i], sizeof(texts[0]), "shard %zu sample %zu", s, i);
+        entries[2 * i] = (FixtureEntry){ names[2 * i], texts[i], strlen(texts[i]), '0' };
+        entries[2 * i + 1] = (FixtureEntry){ names[2 * i + 1], "", 0, '0' };
+    }
+    if (s % 2) {
+        snprintf(paths[s], sizeof(paths[0]), "%s/shard%zu.zip", base_dir, s);
+        return fixture_write_zip(paths[s], entries, SAMPLES * 2, true);
+    }
+    uint8_t *tar;
+    size_t tar_size = fixture_tar(entries, SAMPLES * 2, &tar);
+    snprintf(paths[s], sizeof(paths[0]), "%s/shard%zu.tar.gz", base_dir, s);
+    bool ok = fixture_write_gzip(paths[s], tar, tar_size);
+    free(tar);
+    return ok;
+}
+
+// Parse "s<s>/<i>" and check the sample's fields
+static bool check_sample(const ArcSample *sample, size_t *shard, size_t *index) {
+    if (sscanf(sample->key, "s%zu/%zu", shard, index) != 2 || *shard != sample->shard ||
+        sample->field_count != 2) {
+        return false;
+    }
+    char text[32];
+    snprintf(text, sizeof(text), "shard %zu sample %zu", *shard, *index);
+    const ArcSampleField *txt = arc_sample_field(sample, "txt");
+    const ArcSampleField *cls = arc_sample_field(sample, "cls");
+    return txt && cls && txt->size == strlen(text) && strcmp((char *)txt->data, text) == 0 &&
+           cls->size == 0 && cls->data[0] == '\0';
+}
+
+bool test_grouping() {
+    ArcShardSetOptions opts = { 1, 0, false, 0, NULL };
+    ArcShardSet *set = arc_shard_set_open(path_list, 2, &opts);
+    ASSERT_NOT_NULL(set, "Should open shard set");
+
+    ArcSample *sample;
+    for (size_t n = 0; n < 2 * SAMPLES; n++) {
+        ASSERT_EQ(arc_shard_set_next(set, &sample), 0, "Should read sample");
+        size_t shard, index;
+        ASSERT_TRUE(check_sample(sample, &shard, &index), "Sample should group both fields");
+        ASSERT_EQ(shard, n / SAMPLES, "One thread reads shards in order");
+        ASSERT_EQ(index, n % SAMPLES, "Samples keep their order");
+        ASSERT_STR_EQ(sample->fields[0].name, "txt", "Fields keep archive order");
+        ASSERT_NULL(arc_sample_field(sample, "jpg"), "No such field");
+        arc_sample_free(sample);
+    }
+    ASSERT_EQ(arc_shard_set_next(set, &sample), 1, "End of epoch");
+    ASSERT_NULL(sample, "No sample at the end");
+    ASSERT_EQ(arc_shard_set_next(set, &sample), 1, "End of epoch is sticky");
+    arc_shard_set_close(set);
+    return true;
+}
+
+bool test_shuffle_order() {
+    ArcShardSetOptions opts = { 1, 0, true, 42, NULL };
+    ArcShardSet *a = arc_shard_set_open(path_list, SHARDS, &opts);
+    ArcShardSet *b = arc_shard_set_open(path_list, SHARDS, &opts);
+    opts.seed = 43;
+    ArcShardSet *c = arc_shard_set_open(path_list, SHARDS, &opts);
+    ASSERT_TRUE(a && b && c, "Should open shard sets");
+
+    size_t order_a[SHARDS], order_b[SHARDS], order_c[SHARDS], order_next[SHARDS];
+    arc_shard_set_order(a, 3, order_a);
+    arc_shard_set_order(b, 3, order_b);
+    arc_shard_set_order(c, 3, order_c);
+    arc_shard_set_order(a, 4, order_next);
+    ASSERT_TRUE(memcmp(order_a, order_b, sizeof(order_a)) == 0, "Same seed and epoch, same order");
+    ASSERT_TRUE(memcmp(order_a, order_c, sizeof(order_a)) != 0, "Other seed, other order");
+    ASSERT_TRUE(memcmp(order_a, order_next, sizeof(order_a)) != 0, "Other epoch, other order");
+    bool seen[SHARDS] = { false };
+    for (size_t i = 0; i < SHARDS; i++) {
+        ASSERT_TRUE(order_a[i] < SHARDS && !seen[order_a[i]], "Order should be a permutation");
+        seen[order_a[i]] = true;
+    }
+
+    // One thread follows the epoch's shard order
+    ASSERT_EQ(arc_shard_set_start(a, 3), 0, "Should start epoch 3");
+    ArcSample *sample;
+    for (size_t n = 0; n < SHARDS * SAMPLES; n++) {
+        ASSERT_EQ(arc_shard_set_next(a, &sample), 0, "Should read sample");
+        ASSERT_EQ(sample->shard, order_a[n / SAMPLES], "Shards follow the shuffled order");
+        arc_sample_free(sample);
+    }
+    ASSERT_EQ(arc_shard_set_next(a, &sample), 1, "End of epoch");
+
+    arc_shard_set_close(a);
+    arc_shard_set_close(b);
+    arc_shard_set_close(c);
+
+    opts.shuffle = false;
+    ArcShardSet *d = arc_shard_set_open(path_list, SHARDS, &opts);
+    arc_shard_set_order(d, 7, order_a);
+    for (size_t i = 0; i < SHARDS; i++) {
+        ASSERT_EQ(order_a[i], i, "No shuffle, list order");
+    }
+    arc_shard_set_close(d);
+    return true;
+}
+
+bool test_parallel() {
+    ArcShardSetOptions opts = { 4, 2, true, 7, NULL };
+    ArcShardSet *set = arc_shard_set_open(path_list, SHARDS, &opts);
+    ASSERT_NOT_NULL(set, "Should open shard set");
+
+    for (uint64_t epoch = 0; epoch < 2; epoch++) {
+        ASSERT_EQ(arc_shard_set_start(set, epoch), 0, "Should start epoch");
+        size_t next_index[SHARDS] = { 0 };
+        size_t total = 0;
+        ArcSample *sample;
+        int rc;
+        while ((rc = arc_shard_set_next(set, &sample)) == 0) {
+            size_t shard, index;
+            ASSERT_TRUE(check_sample(sample, &shard, &index), "Sample should be complete");
+            ASSERT_EQ(index, next_index[shard], "Samples of a shard stay in order");
+            next_index[shard]++;
+            total++;
+            arc_sample_free(sample);
+        }
+        ASSERT_EQ(rc, 1, "Epoch should end");
+        ASSERT_EQ(total, SHARDS * SAMPLES, "Every sample once");
+    }
+    arc_shard_set_close(set);
+    return true;
+}
+
+typedef struct Consumer {
+    ArcShardSet *set;
+    size_t count;
+    bool ok;
+} Consumer;
+
+static void *consume(void *arg) {
+    Consumer *c = arg;
+    ArcSample *sample;
+    int rc;
+    while ((rc = arc_shard_set_next(c->set, &sample)) == 0) {
+        size_t shard, index;
+        c->ok = c->ok && check_sample(sample, &shard, &index);
+        c->count++;
+        arc_sample_free(sample);
+    }
+    c->ok = c->ok && rc == 1;
+    return NULL;
+}
+
+bool test_multiple_consumers() {
+    ArcShardSetOptions opts = { 3, 4, false, 0, NULL };
+    ArcShardSet *set = arc_shard_set_open(path_list, SHARDS, &opts);
+    ASSERT_NOT_NULL(set, "Should open shard set");
+    ASSERT_EQ(arc_shard_set_start(set, 0), 0, "Should start epoch");
+
+    Consumer consumers[3];
+    pthread_t threads[3];
+    for (int i = 0; i < 3; i++) {
+        consumers[i] = (Consumer){ set, 0, true };
+        ASSERT_EQ(pthread_create(&threads[i], NULL, consume, &consumers[i]), 0, "Should start consumer");
+    }
+    size_t total = 0;
+    for (int i = 0; i < 3; i++) {
+        pthread_join(threads[i], NULL);
+        ASSERT_TRUE(consumers[i].ok, "Consumer should see complete samples and the end");
+        total += consumers[i].count;
+    }
+    ASSERT_EQ(total, SHARDS * SAMPLES, "Consumers share every sample once");
+    arc_shard_set_close(set);
+    return true;
+}
+
+#define SMALL_SHARDS 200
+
+// Many one-sample shards on more workers than the prefetch depth: producers
+// keep racing for ring slots while consumers drain them
+bool test_many_small_shards() {
+    static char small_paths[SMALL_SHARDS][256];
+    const char *list[SMALL_SHARDS];
+    for (size_t s = 0; s < SMALL_SHARDS; s++) {
+        char name[32], text[32];
+        snprintf(name, sizeof(name), "s%zu/0.txt", s);
+        snprintf(text, sizeof(text), "shard %zu sample 0", s);
+        FixtureEntry entries[2] = { { name, text, strlen(text), '0' }, { "", "", 0, '0' } };
+        char cls[32];
+        snprintf(cls, sizeof(cls), "s%zu/0.cls", s);
+        entries[1].name = cls;
+        uint8_t *tar;
+        size_t tar_size = fixture_tar(entries, 2, &tar);
+        snprintf(small_paths[s], sizeof(small_paths[0]), "%s/small%zu.tar", base_dir, s);
+        ASSERT_TRUE(fixture_write_file(small_paths[s], tar, tar_size), "Should write shard");
+        free(tar);
+        list[s] = small_paths[s];
+    }
+
+    ArcShardSetOptions opts = { 8, 2, true, 3, NULL };
+    ArcShardSet *set = arc_shard_set_open(list, SMALL_SHARDS, &opts);
+    ASSERT_NOT_NULL(set, "Should open shard set");
+    for (uint64_t epoch = 0; epoch < 5; epoch++) {
+        ASSERT_EQ(arc_shard_set_start(set, epoch), 0, "Should start epoch");
+        Consumer consumers[3];
+        pthread_t threads[3];
+        for (int i = 0; i < 3; i++) {
+            consumers[i] = (Consumer){ set, 0, true };
+            ASSERT_EQ(pthread_create(&threads[i], NULL, consume, &consumers[i]), 0, "Should start consumer");
+        }
+        size_t total = 0;
+        for (int i = 0; i < 3; i++) {
+            pthread_join(threads[i], NULL);
+            ASSERT_TRUE(consumers[i].ok, "Consumer should see complete samples and the end");
+            total += consumers[i].count;
+        }
+        ASSERT_EQ(total, SMALL_SHARDS, "No sample lost to an early end of the epoch");
+    }
+    arc_shard_set_close(set);
+    for (size_t s = 0; s < SMALL_SHARDS; s++) {
+        unlink(small_paths[s]);
+    }
+    return true;
+}
+
+// A field larger than the initial buffer grows as its data arrives
+bool test_large_field() {
+    size_t size = 300 * 1024;
+    uint8_t *data = fixture_pattern(size, 7);
+    FixtureEntry entries[1] = { { "big/0.bin", (const char *)data, size, '0' } };
+    uint8_t *tar;
+    size_t tar_size = fixture_tar(entries, 1, &tar);
+    char path[256];
+    snprintf(path, sizeof(path), "%s/big.tar", base_dir);
+    ASSERT_TRUE(fixture_write_file(path, tar, tar_size), "Should write shard");
+    free(tar);
+
+    const char *list[1] = { path };
+    ArcShardSet *set = arc_shard_set_open(list, 1, NULL);
+    ASSERT_NOT_NULL(set, "Should open shard set");
+    ArcSample *sample;
+    ASSERT_EQ(arc_shard_set_next(set, &sample), 0, "Should read the sample");
+    const ArcSampleField *bin = arc_sample_field(sample, "bin");
+    ASSERT_NOT_NULL(bin, "Field should be present");
+    ASSERT_EQ(bin->size, size, "Whole field read");
+    ASSERT_TRUE(memcmp(bin->data, data, size) == 0, "Field data intact");
+    arc_sample_free(sample);
+    ASSERT_EQ(arc_shard_set_next(set, &sample), 1, "Epoch should end");
+    arc_shard_set_close(set);
+    unlink(path);
+    free(data);
+    return true;
+}
+
+bool test_bad_shards() {
+    const char *list[4] = { path_list[0], path_list[SHARDS], path_list[1], path_list[SHARDS + 1] };
+    ArcShardSetOptions opts = { 2, 0, false, 0, NULL };
+    ArcShardSet *set = arc_shard_set_open(list, 4, &opts);
+    ASSERT_NOT_NULL(set, "Paths are not checked up front");
+
+    size_t samples = 0, errors = 0;
+    ArcSample *sample;
+    int rc;
+    while ((rc = arc_shard_set_next(set, &sample)) != 1) {
+        if (rc < 0) {
+            ASSERT_NULL(sample, "No sample with an error");
+            ASSERT_NE(errno, 0, "Error should set errno");
+            errors++;
+            continue;
+        }
+        samples++;
+        arc_sample_free(sample);
+    }
+    ASSERT_EQ(errors, 2, "Missing and corrupt shards fail");
+    ASSERT_EQ(samples, 2 * SAMPLES, "The other shards are read");
+    arc_shard_set_close(set);
+    return true;
+}
+
+bool test_restart_and_close() {
+    ArcShardSetOptions opts = { 2, 1, false, 0, NULL };
+    ArcShardSet *set = arc_shard_set_open(path_list, SHARDS, &opts);
+    ASSERT_NOT_NULL(set, "Should open shard set");
+
+    ArcSample *sample;
+    ASSERT_EQ(arc_shard_set_next(set, &sample), 0, "Starts epoch 0 on first use");
+    arc_sample_free(sample);
+
+    // Abandon the epoch with workers blocked on a full queue
+    ASSERT_EQ(arc_shard_set_start(set, 1), 0, "Should restart");
+    size_t total = 0;
+    while (arc_shard_set_next(set, &sample) == 0) {
+        total++;
+        arc_sample_free(sample);
+    }
+    ASSERT_EQ(total, SHARDS * SAMPLES, "Restarted epoch is complete");
+
+    ASSERT_EQ(arc_shard_set_start(set, 2), 0, "Should restart again");
+    ASSERT_EQ(arc_shard_set_next(set, &sample), 0, "Should read sample");
+    arc_sample_free(sample);
+    arc_shard_set_close(set);  // Mid-epoch
+    return true;
+}
+
+bool test_invalid() {
+    ArcSample *sample;
+    errno = 0;
+    ASSERT_NULL(arc_shard_set_open(NULL, 1, NULL), "NULL paths");
+    ASSERT_EQ(errno, EINVAL, "Should report EINVAL");
+    ASSERT_NULL(arc_shard_set_open(path_list, 0, NULL), "No shards");
+    const char *list[2] = { path_list[0], NULL };
+    errno = 0;
+    ASSERT_NULL(arc_shard_set_open(list, 2, NULL), "NULL path");
+    ASSERT_EQ(errno, EINVAL, "Should report EINVAL");
+    ASSERT_EQ(arc_shard_set_next(NULL, &sample), -1, "NULL set");
+    ASSERT_EQ(arc_shard_set_start(NULL, 0), -1, "NULL set");
+    ASSERT_NULL(arc_sample_field(NULL, "txt"), "NULL sample");
+    arc_sample_free(NULL);
+    arc_shard_set_close(NULL);
+
+    // Defaults
+    ArcShardSet *set = arc_shard_set_open(path_list, 1, NULL);
+    ASSERT_NOT_NULL(set, "Default options");
+    ASSERT_EQ(arc_shard_set_next(set, NULL), -1, "NULL output");
+    arc_shard_set_close(set);
+    return true;
+}
+
+int main() {
+    printf("=== Shard Set Tests ===\n\n");
+
+    snprintf(base_dir, sizeof(base_dir), "/tmp/cupidarchive_shard_test_%ld", (long)getpid());
+    mkdir(base_dir, 0755);
+    for (size_t s = 0; s < SHARDS; s++) {
+        if (!write_shard(s)) {
+            fprintf(stderr, "Failed to write shard %zu\n", s);
+            return 1;
+        }
+        path_list[s] = paths[s];
+    }
+    snprintf(paths[SHARDS], sizeof(paths[0]), "%s/missing.tar", base_dir);
+    snprintf(paths[SHARDS + 1], sizeof(paths[0]), "%s/corrupt.tar.gz", base_dir);
+    fixture_write_file(paths[SHARDS + 1], "\x1f\x8b\x08\x00garbage", 12);
+    path_list[SHARDS] = paths[SHARDS];
+    path_list[SHARDS + 1] = paths[SHARDS + 1];
+
+    RUN_TEST(test_grouping);
+    RUN_TEST(test_shuffle_order);
+    RUN_TEST(test_parallel);
+    RUN_TEST(test_multiple_consumers);
+    RUN_TEST(test_many_small_shards);
+    RUN_TEST(test_large_field);
+    RUN_TEST(test_bad_shards);
+    RUN_TEST(test_restart_and_close);
+    RUN_TEST(test_invalid);
+
+    for (size_t s = 0; s < SHARDS + 2; s++) {
+        unlink(paths[s]);
+    }
+    rmdir(base_dir);
+
+    PRINT_SUMMARY();
+}
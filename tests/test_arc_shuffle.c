@@ -0,0 +1,269 @@
+#define _POSIX_C_SOURCE 200809L
+#include "test_runner.h"
+#include "test_fixtures.h"
+#include "../cupidarchive.h"
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <dirent.h>
+
+#define FILES 200
+
+static char base_dir[128];
+static char zip_path[256];
+static char tar_path[256];
+static char tgz_path[256];
+static char cache_dir[256];
+static char names[FILES][32];
+static char texts[FILES][32];
+
+// Visit a whole pass, recording file numbers (from "dir/fNNN.txt") and checking data
+static size_t run_pass(ArcShuffle *shuffle, size_t *files, bool *data_ok) {
+    size_t n = 0;
+    const ArcEntry *entry;
+    *data_ok = true;
+    while (arc_shuffle_next(shuffle, &entry) == 0) {
+        size_t file;
+        if (sscanf(entry->path, "dir/f%zu.txt", &file) != 1 || file >= FILES) {
+            *data_ok = false;
+            break;
+        }
+        files[n++] = file;
+        char buf[64];
+        ArcStream *data = arc_shuffle_open_data(shuffle);
+        ssize_t len = data ? arc_stream_read(data, buf, sizeof(buf)) : -1;
+        arc_stream_close(data);
+        if (len != (ssize_t)strlen(texts[file]) || memcmp(buf, texts[file], (size_t)len) != 0) {
+            *data_ok = false;
+        }
+    }
+    return n;
+}
+
+static bool check_full_pass(const char *path) {
+    ArcReader *r = arc_open_path(path);
+    ASSERT_NOT_NULL(r, "Should open archive");
+    ArcShuffleOptions opts = { 1234, 0, 16 };
+    ArcShuffle *shuffle = arc_shuffle_open(r, &opts);
+    ASSERT_NOT_NULL(shuffle, "Should open shuffle");
+    ASSERT_EQ(arc_shuffle_count(shuffle), FILES, "Directories are not visited");
+
+    size_t files[FILES];
+    bool data_ok;
+    ASSERT_EQ(run_pass(shuffle, files, &data_ok), FILES, "Every file visited");
+    ASSERT_TRUE(data_ok, "Data should match");
+    bool seen[FILES] = { false };
+    size_t in_place = 0;
+    for (size_t i = 0; i < FILES; i++) {
+        ASSERT_FALSE(seen[files[i]], "Each file once");
+        seen[files[i]] = true;
+        in_place += files[i] == i;
+        if (i % 16 != 0) {
+            ASSERT_TRUE(files[i] > files[i - 1], "Reads within a window go by offset");
+        }
+    }
+    ASSERT_TRUE(in_place < FILES / 4, "Order should be shuffled");
+    const ArcEntry *entry;
+    ASSERT_EQ(arc_shuffle_next(shuffle, &entry), 1, "End of pass");
+    ASSERT_NULL(arc_shuffle_open_data(shuffle), "No current entry at the end");
+
+    // Same seed, same pass
+    size_t again[FILES];
+    ASSERT_EQ(arc_shuffle_reset(shuffle, 1234), 0, "Should reset");
+    ASSERT_EQ(run_pass(shuffle, again, &data_ok), FILES, "Second pass complete");
+    ASSERT_TRUE(memcmp(files, again, sizeof(files)) == 0, "Same seed, same order");
+    ASSERT_EQ(arc_shuffle_reset(shuffle, 99), 0, "Should reset");
+    ASSERT_EQ(run_pass(shuffle, again, &data_ok), FILES, "Third pass complete");
+    ASSERT_TRUE(memcmp(files, again, sizeof(files)) != 0, "Other seed, other order");
+
+    arc_shuffle_close(shuffle);
+    arc_close(r);
+    return true;
+}
+
+bool test_zip_pass() {
+    return check_full_pass(zip_path);
+}
+
+bool test_tar_pass() {
+    return check_full_pass(tar_path);
+}
+
+// Compressed TAR is listed once and read back through a checkpoint index
+bool test_tar_gz_pass() {
+    return check_full_pass(tgz_path);
+}
+
+bool test_cached_tar_gz_pass() {
+    ASSERT_EQ(arc_listing_cache_enable(cache_dir), 0, "Should enable the listing cache");
+    ArcReader *r = arc_open_path(tgz_path);
+    ASSERT_NOT_NULL(r, "Should open tar.gz");
+    ArcEntry entry;
+    while (arc_next(r, &entry) == 0) {
+        arc_entry_free(&entry);
+    }
+    arc_close(r);
+    bool ok = check_full_pass(tgz_path);
+    arc_listing_cache_disable();
+
+    DIR *dir = opendir(cache_dir);
+    struct dirent *de;
+    size_t cached = 0;
+    char path[512];
+    while (dir && (de = readdir(dir)) != NULL) {
+        if (de->d_name[0] != '.') {
+            snprintf(path, sizeof(path), "%s/%s", cache_dir, de->d_name);
+            unlink(path);
+            cached++;
+        }
+    }
+    if (dir) {
+        closedir(dir);
+    }
+    ASSERT_EQ(cached, 1, "The pass should come from the listing cache");
+    return ok;
+}
+
+static int compare_size(const void *a, const void *b) {
+    size_t x = *(const size_t *)a, y = *(const size_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+bool test_window_keeps_permutation() {
+    ArcReader *r = arc_open_path(zip_path);
+    ArcShuffleOptions exact = { 5, 0, 1 };
+    ArcShuffleOptions windowed = { 5, 0, 32 };
+    ArcShuffle *a = arc_shuffle_open(r, &exact);
+    ArcShuffle *b = arc_shuffle_open(r, &windowed);
+    ASSERT_TRUE(a && b, "Should open shuffles");
+
+    size_t order[FILES], reordered[FILES];
+    bool data_ok;
+    ASSERT_EQ(run_pass(a, order, &data_ok), FILES, "Exact pass complete");
+    ASSERT_EQ(run_pass(b, reordered, &data_ok), FILES, "Windowed pass complete");
+    // Each window holds the same slice of the permutation, sorted by offset
+    for (size_t start = 0; start < FILES; start += 32) {
+        size_t n = FILES - start < 32 ? FILES - start : 32;
+        qsort(order + start, n, sizeof(size_t), compare_size);
+    }
+    ASSERT_TRUE(memcmp(order, reordered, sizeof(order)) == 0, "Windows reorder only within themselves");
+
+    arc_shuffle_close(a);
+    arc_shuffle_close(b);
+    arc_close(r);
+    return true;
+}
+
+bool test_sample() {
+    ArcReader *r = arc_open_path(zip_path);
+    ArcShuffleOptions opts = { 77, 10, 0 };
+    ArcShuffle *shuffle = arc_shuffle_open(r, &opts);
+    ASSERT_NOT_NULL(shuffle, "Should open shuffle");
+    ASSERT_EQ(arc_shuffle_count(shuffle), 10, "Sample size");
+
+    size_t files[FILES];
+    bool data_ok;
+    ASSERT_EQ(run_pass(shuffle, files, &data_ok), 10, "Ten files visited");
+    ASSERT_TRUE(data_ok, "Data should match");
+    for (size_t i = 1; i < 10; i++) {
+        ASSERT_TRUE(files[i] > files[i - 1], "Distinct files, read in offset order");
+    }
+    ASSERT_TRUE(files[9] - files[0] > 10, "Sample should spread over the archive");
+    arc_shuffle_close(shuffle);
+
+    opts.sample = FILES * 2;
+    shuffle = arc_shuffle_open(r, &opts);
+    ASSERT_EQ(arc_shuffle_count(shuffle), FILES, "Sample is capped at the file count");
+    arc_shuffle_close(shuffle);
+
+    // The reader is usable again after a rewind
+    ArcEntry entry;
+    ASSERT_EQ(arc_rewind(r), 0, "Should rewind");
+    ASSERT_EQ(arc_next(r, &entry), 0, "Should iterate");
+    arc_entry_free(&entry);
+    arc_close(r);
+    return true;
+}
+
+bool test_invalid() {
+    const ArcEntry *entry;
+    errno = 0;
+    ASSERT_NULL(arc_shuffle_open(NULL, NULL), "NULL reader");
+    ASSERT_EQ(errno, EINVAL, "Should report EINVAL");
+    ASSERT_EQ(arc_shuffle_next(NULL, &entry), -1, "NULL shuffle");
+    ASSERT_EQ(arc_shuffle_reset(NULL, 0), -1, "NULL shuffle");
+    ASSERT_EQ(arc_shuffle_count(NULL), 0, "NULL shuffle");
+    ASSERT_NULL(arc_shuffle_open_data(NULL), "NULL shuffle");
+    arc_shuffle_close(NULL);
+
+    // Nothing to reopen entries from once the reader is memory-backed
+    uint8_t *tgz = NULL;
+    size_t tgz_size = 0;
+    FILE *f = fopen(tgz_path, "rb");
+    ASSERT_NOT_NULL(f, "Should open tar.gz file");
+    tgz = malloc(1 << 20);
+    tgz_size = fread(tgz, 1, 1 << 20, f);
+    fclose(f);
+    ArcReader *r = arc_open_stream(arc_stream_from_memory(tgz, tgz_size, 0));
+    ASSERT_NOT_NULL(r, "Should open tar.gz from memory");
+    errno = 0;
+    ASSERT_NULL(arc_shuffle_open(r, NULL), "Memory-backed compressed TAR");
+    ASSERT_EQ(errno, ENOTSUP, "Should report ENOTSUP");
+    arc_close(r);
+    free(tgz);
+
+    r = arc_open_path(zip_path);
+    ArcShuffle *shuffle = arc_shuffle_open(r, NULL);
+    ASSERT_NOT_NULL(shuffle, "Default options");
+    errno = 0;
+    ASSERT_NULL(arc_shuffle_open_data(shuffle), "No current entry yet");
+    ASSERT_EQ(errno, EINVAL, "Should report EINVAL");
+    ASSERT_EQ(arc_shuffle_next(shuffle, NULL), -1, "NULL output");
+    arc_shuffle_close(shuffle);
+    arc_close(r);
+    return true;
+}
+
+int main() {
+    printf("=== Shuffle Tests ===\n\n");
+
+    snprintf(base_dir, sizeof(base_dir), "/tmp/cupidarchive_shuffle_test_%ld", (long)getpid());
+    mkdir(base_dir, 0755);
+    FixtureEntry entries[FILES + 1];
+    entries[0] = (FixtureEntry){ "dir/", NULL, 0, '5' };
+    for (size_t i = 0; i < FILES; i++) {
+        snprintf(names[i], sizeof(names[0]), "dir/f%03zu.txt", i);
+        snprintf(texts[i], sizeof(texts[0]), "contents of file %zu", i);
+        entries[i + 1] = (FixtureEntry){ names[i], texts[i], strlen(texts[i]), '0' };
+    }
+    snprintf(zip_path, sizeof(zip_path), "%s/data.zip", base_dir);
+    snprintf(tar_path, sizeof(tar_path), "%s/data.tar", base_dir);
+    snprintf(tgz_path, sizeof(tgz_path), "%s/data.tar.gz", base_dir);
+    snprintf(cache_dir, sizeof(cache_dir), "%s/cache", base_dir);
+    mkdir(cache_dir, 0755);
+    uint8_t *tar;
+    size_t tar_size = fixture_tar(entries, FILES + 1, &tar);
+    if (!fixture_write_zip(zip_path, entries, FILES + 1, true) || !fixture_write_file(tar_path, tar, tar_size) ||
+        !fixture_write_gzip(tgz_path, tar, tar_size)) {
+        fprintf(stderr, "Failed to write fixtures\n");
+        return 1;
+    }
+    free(tar);
+
+    RUN_TEST(test_zip_pass);
+    RUN_TEST(test_tar_pass);
+    RUN_TEST(test_tar_gz_pass);
+    RUN_TEST(test_cached_tar_gz_pass);
+    RUN_TEST(test_window_keeps_permutation);
+    RUN_TEST(test_sample);
+    RUN_TEST(test_invalid);
+
+    unlink(zip_path);
+    unlink(tar_path);
+    unlink(tgz_path);
+    rmdir(cache_dir);
+    rmdir(base_dir);
+
+    PRINT_SUMMARY();
+}
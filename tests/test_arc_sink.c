@@ -0,0 +1,465 @@
+#define _POSIX_C_SOURCE 200809L
+#include "test_runner.h"
+#include "test_fixtures.h"
+#include "../cupidarchive.h"
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+static char base_dir[128];
+static char tar_path[256];
+static char zip_path[256];
+
+static const FixtureEntry entries[] = {
+    { "top/", NULL, 0, '5' },
+    { "top/a.txt", "alpha", 5, '0' },
+    { "top/sub/b.txt", "bravo bravo", 11, '0' },   // "top/sub" has no entry of its own
+    { "top/copy.txt", "alpha", 5, '0' },
+    { "top/empty", "", 0, '0' },
+    { "top/link", "a.txt", 0, '2' },
+};
+#define ENTRY_COUNT (sizeof(entries) / sizeof(entries[0]))
+
+static bool read_file(const char *path, char *buf, size_t size, size_t *len) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return false;
+    }
+    *len = fread(buf, 1, size, f);
+    fclose(f);
+    return true;
+}
+
+static int extract(const char *path, ArcSink *sink, const ArcExtractOptions *opts, ArcExtractReport *report) {
+    ArcReader *reader = arc_open_path(path);
+    if (!reader) {
+        return -2;
+    }
+    int result = arc_extract_to_sink(reader, sink, opts, report);
+    arc_close(reader);
+    return result;
+}
+
+static bool test_memory_tree(void) {
+    ArcSink *sink = arc_sink_memory_new();
+    ASSERT_NOT_NULL(sink, "Memory sink should be created");
+    ASSERT_EQ(extract(tar_path, sink, NULL, NULL), 0, "Extraction should succeed");
+
+    // top, a.txt, sub (implicit), sub/b.txt, copy.txt, empty, link
+    ASSERT_EQ(arc_sink_memory_count(sink), 7, "Tree should have seven nodes");
+    const ArcMemoryNode *node = arc_sink_memory_node(sink, 0);
+    ASSERT_STR_EQ(node->path, "top", "Trailing slash should be stripped");
+    ASSERT_EQ(node->type, ARC_ENTRY_DIR, "top should be a directory");
+    ASSERT_EQ(node->mode, 0755, "Directories default to 0755");
+
+    node = arc_sink_memory_find(sink, "top/sub/");
+    ASSERT_NOT_NULL(node, "Missing parent should be created");
+    ASSERT_EQ(node->type, ARC_ENTRY_DIR, "Implicit parent should be a directory");
+    ASSERT_TRUE(node < arc_sink_memory_find(sink, "top/sub/b.txt"), "Parent should come before its child");
+
+    node = arc_sink_memory_find(sink, "./top/sub/b.txt");
+    ASSERT_NOT_NULL(node, "Nested file should be found");
+    ASSERT_EQ(node->type, ARC_ENTRY_FILE, "b.txt should be a file");
+    ASSERT_EQ(node->size, 11, "b.txt size");
+    ASSERT_TRUE(memcmp(node->data, "bravo bravo", 11) == 0, "b.txt contents");
+    ASSERT_EQ(node->mode, 0644, "Files default to 0644");
+    ASSERT_EQ(node->mtime, 0, "mtime is only set when preserved");
+
+    node = arc_sink_memory_find(sink, "top/empty");
+    ASSERT_NOT_NULL(node, "Empty file should be created");
+    ASSERT_EQ(node->size, 0, "Empty file has no data");
+
+    node = arc_sink_memory_find(sink, "top/link");
+    ASSERT_NOT_NULL(node, "Symlink should be created");
+    ASSERT_EQ(node->type, ARC_ENTRY_SYMLINK, "link should be a symlink");
+    ASSERT_STR_EQ(node->link_target, "a.txt", "Symlink target");
+
+    ASSERT_NULL(arc_sink_memory_find(sink, "top/missing"), "Unknown path should not be found");
+    ASSERT_NULL(arc_sink_memory_node(sink, 7), "Out-of-range index");
+
+    // A second extraction replaces contents rather than duplicating nodes
+    ASSERT_EQ(extract(zip_path, sink, NULL, NULL), 0, "Second extraction should succeed");
+    ASSERT_EQ(arc_sink_memory_count(sink), 7, "Rewritten paths should keep their nodes");
+    arc_sink_free(sink);
+    return true;
+}
+
+static bool test_memory_attributes(void) {
+    ArcSink *sink = arc_sink_memory_new();
+    ArcExtractOptions opts = {0};
+    opts.preserve_permissions = true;
+    opts.preserve_timestamps = true;
+    opts.hash_algorithms = ARC_HASH_SHA256;
+    ArcExtractReport report;
+    ASSERT_EQ(extract(tar_path, sink, &opts, &report), 0, "Extraction should succeed");
+
+    const ArcMemoryNode *node = arc_sink_memory_find(sink, "top/a.txt");
+    ASSERT_EQ(node->mtime, 1700000000, "Preserved mtime");
+    ASSERT_EQ(node->mode, 0644, "Preserved mode");
+    ASSERT_EQ(arc_sink_memory_find(sink, "top")->mtime, 1700000000, "Preserved directory mtime");
+
+    ASSERT_EQ(report.count, 4, "Report should list the four files");
+    ASSERT_EQ(report.total_bytes, 21, "Report total");
+    ASSERT_EQ(report.errors, 0, "No errors");
+    ASSERT_TRUE(report.files[0].digests.algorithms & ARC_HASH_SHA256, "Files should be hashed");
+    arc_extract_report_free(&report);
+    arc_sink_free(sink);
+    return true;
+}
+
+static size_t count_objects(const char *store) {
+    size_t count = 0;
+    DIR *dir = opendir(store);
+    struct dirent *de;
+    while (dir && (de = readdir(dir))) {
+        if (de->d_name[0] == '.') {
+            continue;
+        }
+        char sub[512];
+        snprintf(sub, sizeof(sub), "%s/%s", store, de->d_name);
+        DIR *inner = opendir(sub);
+        struct dirent *ie;
+        while (inner && (ie = readdir(inner))) {
+            count += ie->d_name[0] != '.';
+        }
+        if (inner) {
+            closedir(inner);
+        }
+    }
+    if (dir) {
+        closedir(dir);
+    }
+    return count;
+}
+
+static void remove_store(const char *store) {
+    DIR *dir = opendir(store);
+    struct dirent *de;
+    while (dir && (de = readdir(dir))) {
+        if (de->d_name[0] == '.' && (de->d_name[1] == '\0' || de->d_name[1] == '.')) {
+            continue;
+        }
+        char sub[512];
+        snprintf(sub, sizeof(sub), "%s/%s", store, de->d_name);
+        DIR *inner = opendir(sub);
+        struct dirent *ie;
+        while (inner && (ie = readdir(inner))) {
+            char file[768];
+            snprintf(file, sizeof(file), "%s/%s", sub, ie->d_name);
+            unlink(file);
+        }
+        if (inner) {
+            closedir(inner);
+        }
+        if (rmdir(sub) < 0) {
+            unlink(sub);
+        }
+    }
+    if (dir) {
+        closedir(dir);
+    }
+    rmdir(store);
+}
+
+static bool test_cas_store(void) {
+    char store[256];
+    snprintf(store, sizeof(store), "%s/store", base_dir);
+    mkdir(store, 0755);
+
+    ArcSink *sink = arc_sink_cas_new(store, 0);
+    ASSERT_NOT_NULL(sink, "CAS sink should be created");
+    ArcExtractOptions opts = {0};
+    opts.hash_algorithms = ARC_HASH_SHA256;
+    ArcExtractReport report;
+    ASSERT_EQ(extract(tar_path, sink, &opts, &report), 0, "Extraction should succeed");
+
+    // a.txt and copy.txt share an object: alpha, bravo bravo, empty
+    ASSERT_EQ(count_objects(store), 3, "Identical contents should be stored once");
+    ASSERT_EQ(arc_sink_cas_count(sink), ENTRY_COUNT, "Every entry should be recorded");
+
+    const ArcCasEntry *a = NULL;
+    const ArcCasEntry *copy = NULL;
+    for (size_t i = 0; i < arc_sink_cas_count(sink); i++) {
+        const ArcCasEntry *e = arc_sink_cas_entry(sink, i);
+        if (strcmp(e->path, "top/a.txt") == 0) {
+            a = e;
+        } else if (strcmp(e->path, "top/copy.txt") == 0) {
+            copy = e;
+        } else if (strcmp(e->path, "top/link") == 0) {
+            ASSERT_EQ(e->type, ARC_ENTRY_SYMLINK, "Symlink should be recorded");
+            ASSERT_STR_EQ(e->link_target, "a.txt", "Symlink target should be recorded");
+            ASSERT_NULL(e->digest, "Symlinks have no object");
+        } else if (strcmp(e->path, "top") == 0) {
+            ASSERT_EQ(e->type, ARC_ENTRY_DIR, "Directory should be recorded");
+        }
+    }
+    ASSERT_NOT_NULL(a, "a.txt should be recorded");
+    ASSERT_NOT_NULL(copy, "copy.txt should be recorded");
+    ASSERT_STR_EQ(a->digest, copy->digest, "Same contents, same digest");
+    ASSERT_EQ(a->size, 5, "Recorded size");
+    ASSERT_EQ(strlen(a->digest), 64, "SHA-256 hex digest");
+
+    char hex[65];
+    for (size_t i = 0; i < report.count; i++) {
+        if (strcmp(report.files[i].path, "top/a.txt") == 0) {
+            arc_digest_hex(&report.files[i].digests, ARC_HASH_SHA256, hex, sizeof(hex));
+            ASSERT_STR_EQ(a->digest, hex, "Object name should be the content digest");
+        }
+    }
+    arc_extract_report_free(&report);
+
+    char object[512];
+    char buf[64];
+    size_t len = 0;
+    snprintf(object, sizeof(object), "%s/%.2s/%s", store, a->digest, a->digest + 2);
+    ASSERT_TRUE(read_file(object, buf, sizeof(buf), &len), "Object should exist at <store>/ab/cd...");
+    ASSERT_TRUE(len == 5 && memcmp(buf, "alpha", 5) == 0, "Object contents");
+
+    // Extracting again adds no objects and leaves no temporaries
+    ASSERT_EQ(extract(zip_path, sink, NULL, NULL), 0, "Second extraction should succeed");
+    ASSERT_EQ(count_objects(store), 3, "Known contents should not be stored again");
+    ASSERT_EQ(arc_sink_cas_count(sink), 2 * ENTRY_COUNT, "Entries are recorded per extraction");
+    DIR *dir = opendir(store);
+    struct dirent *de;
+    size_t temporaries = 0;
+    while ((de = readdir(dir))) {
+        temporaries += strncmp(de->d_name, ".tmp-", 5) == 0;
+    }
+    closedir(dir);
+    ASSERT_EQ(temporaries, 0, "No temporary files should be left behind");
+    arc_sink_free(sink);
+
+    sink = arc_sink_cas_new(store, ARC_HASH_XXH3);
+    ASSERT_NOT_NULL(sink, "CAS sink with XXH3 should be created");
+    ASSERT_EQ(extract(tar_path, sink, NULL, NULL), 0, "XXH3 extraction should succeed");
+    ASSERT_EQ(strlen(arc_sink_cas_entry(sink, 1)->digest), 16, "XXH3 hex digest");
+    ASSERT_EQ(count_objects(store), 6, "XXH3 objects should be added");
+    arc_sink_free(sink);
+
+    remove_store(store);
+    return true;
+}
+
+static bool test_fs_sink(void) {
+    char dest[256];
+    snprintf(dest, sizeof(dest), "%s/out", base_dir);
+    mkdir(dest, 0755);
+    ArcSink *sink = arc_sink_fs_new(dest);
+    ASSERT_NOT_NULL(sink, "Filesystem sink should be created");
+    ArcExtractOptions opts = {0};
+    opts.preserve_timestamps = true;
+    ASSERT_EQ(extract(tar_path, sink, &opts, NULL), 0, "Extraction should succeed");
+    arc_sink_free(sink);
+
+    char path[512];
+    char buf[64];
+    size_t len = 0;
+    snprintf(path, sizeof(path), "%s/top/sub/b.txt", dest);
+    ASSERT_TRUE(read_file(path, buf, sizeof(buf), &len), "Nested file should exist");
+    ASSERT_TRUE(len == 11 && memcmp(buf, "bravo bravo", 11) == 0, "Nested file contents");
+    struct stat st;
+    ASSERT_EQ(stat(path, &st), 0, "stat nested file");
+    ASSERT_EQ(st.st_mtime, 1700000000, "Preserved mtime");
+
+    snprintf(path, sizeof(path), "%s/top/empty", dest);
+    ASSERT_EQ(stat(path, &st), 0, "Empty file should exist");
+    ASSERT_EQ(st.st_size, 0, "Empty file size");
+
+    snprintf(path, sizeof(path), "%s/top/link", dest);
+    char target[64];
+    ssize_t n = readlink(path, target, sizeof(target) - 1);
+    ASSERT_EQ(n, 5, "Symlink should exist");
+    target[n > 0 ? n : 0] = '\0';
+    ASSERT_STR_EQ(target, "a.txt", "Symlink target");
+
+    const char *names[] = { "top/link", "top/empty", "top/copy.txt", "top/sub/b.txt", "top/a.txt", "top/sub", "top" };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        snprintf(path, sizeof(path), "%s/%s", dest, names[i]);
+        if (unlink(path) < 0) {
+            rmdir(path);
+        }
+    }
+    rmdir(dest);
+    return true;
+}
+
+static bool test_patterns(void) {
+    ArcSink *sink = arc_sink_memory_new();
+    const char *include[] = { "top/sub", "*.txt" };
+    const char *exclude[] = { "top/copy*" };
+    ArcExtractOptions opts = {0};
+    opts.include = include;
+    opts.include_count = 2;
+    opts.exclude = exclude;
+    opts.exclude_count = 1;
+    ArcExtractReport report;
+    ASSERT_EQ(extract(zip_path, sink, &opts, &report), 0, "Filtered extraction should succeed");
+    ASSERT_EQ(report.count, 2, "Only a.txt and sub/b.txt should be written");
+    ASSERT_NOT_NULL(arc_sink_memory_find(sink, "top/a.txt"), "a.txt is included");
+    ASSERT_NOT_NULL(arc_sink_memory_find(sink, "top/sub/b.txt"), "sub/b.txt is included");
+    ASSERT_NULL(arc_sink_memory_find(sink, "top/copy.txt"), "copy.txt is excluded");
+    ASSERT_NULL(arc_sink_memory_find(sink, "top/link"), "link is not included");
+    arc_extract_report_free(&report);
+    arc_sink_free(sink);
+    return true;
+}
+
+// A sink that only counts calls and can fail writes
+typedef struct CountingSink {
+    ArcSink base;
+    int mkdirs;
+    int opens;
+    int closes_ok;
+    int closes_failed;
+    int attrs;
+    size_t bytes;
+    bool fail_writes;
+    bool freed;
+} CountingSink;
+
+static int counting_mkdir(ArcSink *sink, const char *path, const ArcEntry *entry) {
+    (void)path;
+    (void)entry;
+    ((CountingSink *)sink)->mkdirs++;
+    return 0;
+}
+
+static void *counting_open_file(ArcSink *sink, const char *path, const ArcEntry *entry) {
+    (void)entry;
+    ((CountingSink *)sink)->opens++;
+    return (void *)path;
+}
+
+static int counting_write(ArcSink *sink, void *file, const void *buf, size_t n) {
+    (void)file;
+    (void)buf;
+    CountingSink *cs = (CountingSink *)sink;
+    if (cs->fail_writes) {
+        errno = ENOSPC;
+        return -1;
+    }
+    cs->bytes += n;
+    return 0;
+}
+
+static int counting_set_attrs(ArcSink *sink, const char *path, void *file, const ArcEntry *entry, unsigned what) {
+    (void)path;
+    (void)file;
+    (void)entry;
+    ((CountingSink *)sink)->attrs += (what == (ARC_SINK_ATTR_MODE | ARC_SINK_ATTR_MTIME));
+    return 0;
+}
+
+static int counting_close(ArcSink *sink, void *file, bool ok) {
+    (void)file;
+    CountingSink *cs = (CountingSink *)sink;
+    if (ok) {
+        cs->closes_ok++;
+    } else {
+        cs->closes_failed++;
+    }
+    return 0;
+}
+
+static void counting_free(ArcSink *sink) {
+    ((CountingSink *)sink)->freed = true;
+}
+
+static const struct ArcSinkVtable counting_vtable = {
+    .mkdir = counting_mkdir,
+    .open_file = counting_open_file,
+    .write = counting_write,
+    .set_attrs = counting_set_attrs,
+    .close = counting_close,
+    .symlink = NULL,
+    .free = counting_free,
+};
+
+static bool test_custom_sink(void) {
+    CountingSink cs = { .base = { &counting_vtable, NULL } };
+    ArcExtractOptions opts = {0};
+    opts.preserve_permissions = true;
+    opts.preserve_timestamps = true;
+    ASSERT_EQ(extract(tar_path, &cs.base, &opts, NULL), 0, "Extraction should succeed");
+    ASSERT_EQ(cs.mkdirs, 1, "One directory entry");
+    ASSERT_EQ(cs.opens, 4, "Four files");
+    ASSERT_EQ(cs.closes_ok, 4, "Every file should be closed");
+    ASSERT_EQ(cs.attrs, 5, "Attributes for the files and the directory");
+    ASSERT_EQ(cs.bytes, 21, "All data should be written");
+
+    memset(&cs, 0, sizeof(cs));
+    cs.base.vtable = &counting_vtable;
+    cs.fail_writes = true;
+    ArcExtractReport report;
+    ASSERT_EQ(extract(tar_path, &cs.base, NULL, &report), -1, "Failed writes should fail the extraction");
+    ASSERT_EQ(report.errors, 3, "Three non-empty files fail");
+    ASSERT_EQ(report.count, 1, "The empty file still succeeds");
+    ASSERT_EQ(cs.closes_failed, 3, "Failed files should be closed as discarded");
+    ASSERT_EQ(cs.attrs, 0, "No attributes without preserve flags");
+    arc_extract_report_free(&report);
+
+    arc_sink_free(&cs.base);
+    ASSERT_TRUE(cs.freed, "arc_sink_free should call the vtable");
+    return true;
+}
+
+static bool test_invalid(void) {
+    ArcSink *memory = arc_sink_memory_new();
+    errno = 0;
+    ASSERT_EQ(arc_extract_to_sink(NULL, memory, NULL, NULL), -1, "NULL reader");
+    ASSERT_EQ(errno, EINVAL, "NULL reader sets EINVAL");
+    ArcReader *reader = arc_open_path(tar_path);
+    ASSERT_EQ(arc_extract_to_sink(reader, NULL, NULL, NULL), -1, "NULL sink");
+    ArcExtractOptions opts = {0};
+    opts.hash_algorithms = 0x80;
+    ASSERT_EQ(arc_extract_to_sink(reader, memory, &opts, NULL), -1, "Unknown hash algorithm");
+    arc_close(reader);
+
+    ASSERT_NULL(arc_sink_cas_new(base_dir, ARC_HASH_SHA256 | ARC_HASH_XXH3), "Several algorithms");
+    ASSERT_EQ(errno, EINVAL, "Several algorithms set EINVAL");
+    ASSERT_NULL(arc_sink_cas_new(NULL, 0), "NULL store");
+    ASSERT_NULL(arc_sink_fs_new(tar_path), "File as destination");
+    ASSERT_EQ(errno, ENOTDIR, "File as destination sets ENOTDIR");
+    ASSERT_NULL(arc_sink_cas_new(tar_path, 0), "File as store");
+    ASSERT_EQ(errno, ENOTDIR, "File as store sets ENOTDIR");
+
+    ASSERT_EQ(arc_sink_cas_count(memory), 0, "CAS accessors reject other sinks");
+    ASSERT_NULL(arc_sink_cas_entry(memory, 0), "CAS entry of another sink");
+    ASSERT_EQ(arc_sink_memory_count(NULL), 0, "NULL sink count");
+    ASSERT_NULL(arc_sink_memory_find(memory, "x"), "Empty memory sink");
+    arc_sink_free(memory);
+    arc_sink_free(NULL);
+    return true;
+}
+
+int main() {
+    printf("=== Sink Tests ===\n\n");
+
+    snprintf(base_dir, sizeof(base_dir), "/tmp/cupidarchive_sink_test_%ld", (long)getpid());
+    mkdir(base_dir, 0755);
+    snprintf(tar_path, sizeof(tar_path), "%s/data.tar", base_dir);
+    snprintf(zip_path, sizeof(zip_path), "%s/data.zip", base_dir);
+    uint8_t *tar;
+    size_t tar_size = fixture_tar(entries, ENTRY_COUNT, &tar);
+    if (!fixture_write_file(tar_path, tar, tar_size) || !fixture_write_zip(zip_path, entries, ENTRY_COUNT, true)) {
+        fprintf(stderr, "Failed to write fixtures\n");
+        return 1;
+    }
+    free(tar);
+
+    RUN_TEST(test_memory_tree);
+    RUN_TEST(test_memory_attributes);
+    RUN_TEST(test_cas_store);
+    RUN_TEST(test_fs_sink);
+    RUN_TEST(test_patterns);
+    RUN_TEST(test_custom_sink);
+    RUN_TEST(test_invalid);
+
+    unlink(tar_path);
+    unlink(zip_path);
+    rmdir(base_dir);
+
+    PRINT_SUMMARY();
+}
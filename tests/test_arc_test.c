@@ -0,0 +1,226 @@
+#define _POSIX_C_SOURCE 200809L
+#include "test_runner.h"
+#include "test_fixtures.h"
+#include "../cupidarchive.h"
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+static char base_dir[128];
+static char path_buf[256];
+
+#define ZIP_FILES 40
+#define FILE_SIZE 5000
+
+static char names[ZIP_FILES][16];
+static uint8_t *contents[ZIP_FILES];
+static FixtureEntry zip_entries[ZIP_FILES + 1];
+
+static const char *fixture_path(const char *name) {
+    snprintf(path_buf, sizeof(path_buf), "%s/%s", base_dir, name);
+    return path_buf;
+}
+
+static bool flip_byte(const char *path, long offset) {
+    FILE *f = fopen(path, "r+b");
+    if (!f) {
+        return false;
+    }
+    int c = (fseek(f, offset, SEEK_SET) == 0) ? fgetc(f) : EOF;
+    bool ok = c != EOF && fseek(f, offset, SEEK_SET) == 0 && fputc(c ^ 0x01, f) != EOF;
+    return fclose(f) == 0 && ok;
+}
+
+static int64_t test_path(const char *path, unsigned threads, ArcTestReport *report) {
+    ArcReader *r = arc_open_path(path);
+    if (!r) {
+        memset(report, 0, sizeof(*report));
+        return -2;
+    }
+    ArcTestOptions opts = { threads };
+    int64_t n = arc_test(r, &opts, report);
+    arc_close(r);
+    return n;
+}
+
+// Offset of a stored ZIP entry's data (fixture names are all the same length)
+static long stored_data_offset(size_t index) {
+    long per_entry = 30 + (long)strlen(names[0]) + FILE_SIZE;
+    return per_entry * (long)index + 30 + (long)strlen(names[0]);
+}
+
+bool test_zip_parallel_ok() {
+    const char *path = fixture_path("ok.zip");
+    ASSERT_TRUE(fixture_write_zip(path, zip_entries, ZIP_FILES + 1, true), "Should write zip");
+
+    ArcTestReport report;
+    ASSERT_EQ(test_path(path, 4, &report), 0, "Every entry should pass");
+    ASSERT_EQ(report.count, ZIP_FILES, "One result per regular file (directory skipped)");
+    ASSERT_EQ(report.failed, 0, "No failures");
+    ASSERT_EQ(report.total_bytes, (uint64_t)ZIP_FILES * FILE_SIZE, "All data decoded");
+    ASSERT_EQ(report.archive_status, ARC_TEST_OK, "Archive is intact");
+    bool all_checked = true;
+    for (size_t i = 0; i < report.count; i++) {
+        all_checked = all_checked && report.results[i].has_crc &&
+                      report.results[i].actual_crc == report.results[i].expected_crc;
+    }
+    ASSERT_TRUE(all_checked, "Every CRC was checked");
+    ASSERT_STR_EQ(report.results[0].path, names[0], "Results are in listing order");
+    ASSERT_STR_EQ(report.results[ZIP_FILES - 1].path, names[ZIP_FILES - 1], "Last result is the last file");
+    arc_test_report_free(&report);
+
+    ASSERT_EQ(test_path(path, 0, &report), 0, "Default thread count");
+    ASSERT_EQ(report.count, ZIP_FILES, "Same results with one worker per CPU");
+    arc_test_report_free(&report);
+    return true;
+}
+
+bool test_zip_bad_crc() {
+    const char *path = fixture_path("bad.zip");
+    ASSERT_TRUE(fixture_write_zip(path, zip_entries, ZIP_FILES, false), "Should write stored zip");
+    ASSERT_TRUE(flip_byte(path, stored_data_offset(7) + 100), "Should corrupt entry 7");
+    ASSERT_TRUE(flip_byte(path, stored_data_offset(31) + 4999), "Should corrupt entry 31");
+
+    unsigned thread_counts[] = { 1, 4 };
+    for (size_t t = 0; t < 2; t++) {
+        ArcTestReport report;
+        ASSERT_EQ(test_path(path, thread_counts[t], &report), 2, "Two entries should fail");
+        ASSERT_EQ(report.count, ZIP_FILES, "Every entry is reported");
+        ASSERT_EQ(report.results[7].status, ARC_TEST_BAD_CRC, "Entry 7 has a bad CRC");
+        ASSERT_EQ(report.results[31].status, ARC_TEST_BAD_CRC, "Entry 31 has a bad CRC");
+        ASSERT_NE(report.results[7].actual_crc, report.results[7].expected_crc, "CRCs differ");
+        ASSERT_EQ(report.results[8].status, ARC_TEST_OK, "Neighbours still pass");
+        ASSERT_EQ(report.results[7].size, FILE_SIZE, "Damaged entry still fully decoded");
+        arc_test_report_free(&report);
+    }
+    return true;
+}
+
+bool test_zip_bad_deflate() {
+    const char *path = fixture_path("bad.zip");
+    ASSERT_TRUE(fixture_write_zip(path, zip_entries, 2, true), "Should write deflated zip");
+    // Overwrite the start of the first entry's deflate stream with an invalid block type
+    FILE *f = fopen(path, "r+b");
+    ASSERT_NOT_NULL(f, "Should open zip");
+    fseek(f, 30 + (long)strlen(names[0]), SEEK_SET);
+    fputc(0x07, f);
+    fclose(f);
+
+    ArcTestReport report;
+    ASSERT_EQ(test_path(path, 2, &report), 1, "One entry should fail");
+    ASSERT_EQ(report.results[0].status, ARC_TEST_DECODE, "Corrupt deflate data is a decode error");
+    ASSERT_NE(report.results[0].error, 0, "An errno is recorded");
+    ASSERT_EQ(report.results[1].status, ARC_TEST_OK, "Second entry passes");
+    arc_test_report_free(&report);
+    return true;
+}
+
+bool test_gzip_trailer() {
+    FixtureEntry files[] = {
+        { "a.txt", contents[0], FILE_SIZE, '0' },
+        { "b.txt", contents[1], FILE_SIZE, '0' },
+    };
+    uint8_t *tar = NULL;
+    size_t size = fixture_tar(files, 2, &tar);
+    ASSERT_TRUE(size > 0, "Should build tar");
+    const char *path = fixture_path("trailer.tar.gz");
+    bool ok = fixture_write_gzip(path, tar, size);
+    free(tar);
+    ASSERT_TRUE(ok, "Should write tar.gz");
+
+    ArcTestReport report;
+    ASSERT_EQ(test_path(path, 4, &report), 0, "Intact tar.gz passes");
+    ASSERT_EQ(report.count, 2, "Two files");
+    ASSERT_FALSE(report.results[0].has_crc, "TAR stores no CRC");
+    arc_test_report_free(&report);
+
+    // Corrupt the CRC-32 in the gzip trailer: only the container check fails
+    struct stat st;
+    ASSERT_EQ(stat(path, &st), 0, "Should stat tar.gz");
+    ASSERT_TRUE(flip_byte(path, (long)st.st_size - 8), "Should corrupt trailer");
+    ASSERT_EQ(test_path(path, 4, &report), 1, "Trailer mismatch is one failure");
+    ASSERT_EQ(report.failed, 0, "Entries decoded fine");
+    ASSERT_EQ(report.archive_status, ARC_TEST_DECODE, "The archive itself is damaged");
+    ASSERT_NE(report.archive_error, 0, "An errno is recorded");
+    arc_test_report_free(&report);
+
+    // A lone .gz file: the trailer belongs to its only entry
+    path = fixture_path("single.txt.gz");
+    ASSERT_TRUE(fixture_write_gzip(path, contents[2], FILE_SIZE), "Should write .gz");
+    ASSERT_EQ(stat(path, &st), 0, "Should stat .gz");
+    ASSERT_EQ(test_path(path, 1, &report), 0, "Intact .gz passes");
+    ASSERT_EQ(report.count, 1, "One entry");
+    ASSERT_EQ(report.total_bytes, FILE_SIZE, "Decoded size");
+    arc_test_report_free(&report);
+    ASSERT_TRUE(flip_byte(path, (long)st.st_size - 8), "Should corrupt trailer");
+    ASSERT_EQ(test_path(path, 1, &report), 1, "Bad trailer fails the entry");
+    ASSERT_EQ(report.results[0].status, ARC_TEST_DECODE, "Reported as a decode error");
+    arc_test_report_free(&report);
+    return true;
+}
+
+bool test_7z_crc() {
+    static const char data[] = "7z entries carry a CRC-32 in the folder or substream digests";
+    bool layouts[] = { true, false };
+    for (size_t i = 0; i < 2; i++) {
+        const char *path = fixture_path("crc.7z");
+        ASSERT_TRUE(fixture_write_7z(path, "note.txt", data, sizeof(data) - 1, layouts[i]), "Should write 7z");
+
+        ArcTestReport report;
+        ASSERT_EQ(test_path(path, 4, &report), 0, "Intact 7z passes");
+        ASSERT_EQ(report.count, 1, "One entry");
+        ASSERT_STR_EQ(report.results[0].path, "note.txt", "Entry name");
+        ASSERT_TRUE(report.results[0].has_crc, "CRC comes from the header");
+        ASSERT_EQ(report.results[0].expected_crc, (uint32_t)crc32(0L, (const Bytef *)data, sizeof(data) - 1),
+                  "Stored CRC parsed");
+        arc_test_report_free(&report);
+
+        ASSERT_TRUE(flip_byte(path, 32 + 5), "Should corrupt packed data");
+        ASSERT_EQ(test_path(path, 4, &report), 1, "Corrupted 7z fails");
+        ASSERT_EQ(report.results[0].status, ARC_TEST_BAD_CRC, "Reported as a CRC mismatch");
+        arc_test_report_free(&report);
+    }
+    return true;
+}
+
+bool test_invalid() {
+    ArcTestReport report;
+    errno = 0;
+    ASSERT_EQ(arc_test(NULL, NULL, &report), -1, "NULL reader should fail");
+    ASSERT_EQ(errno, EINVAL, "Should report EINVAL");
+    arc_test_report_free(NULL);
+    return true;
+}
+
+int main() {
+    printf("=== Integrity Test Mode Tests ===\n\n");
+
+    snprintf(base_dir, sizeof(base_dir), "/tmp/cupidarchive_test_test_%ld", (long)getpid());
+    mkdir(base_dir, 0755);
+
+    for (size_t i = 0; i < ZIP_FILES; i++) {
+        snprintf(names[i], sizeof(names[i]), "file%02zu.txt", i);
+        contents[i] = fixture_pattern(FILE_SIZE, (uint32_t)i + 1);
+        zip_entries[i] = (FixtureEntry){ names[i], contents[i], FILE_SIZE, '0' };
+    }
+    zip_entries[ZIP_FILES] = (FixtureEntry){ "dir/", NULL, 0, '5' };
+
+    RUN_TEST(test_zip_parallel_ok);
+    RUN_TEST(test_zip_bad_crc);
+    RUN_TEST(test_zip_bad_deflate);
+    RUN_TEST(test_gzip_trailer);
+    RUN_TEST(test_7z_crc);
+    RUN_TEST(test_invalid);
+
+    for (size_t i = 0; i < ZIP_FILES; i++) {
+        free(contents[i]);
+    }
+    static const char *files[] = { "ok.zip", "bad.zip", "trailer.tar.gz", "single.txt.gz", "crc.7z" };
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+        unlink(fixture_path(files[i]));
+    }
+    rmdir(base_dir);
+
+    PRINT_SUMMARY();
+}
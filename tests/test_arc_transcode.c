@@ -0,0 +1,409 @@
+#define _POSIX_C_SOURCE 200809L
+#include "test_runner.h"
+#include "test_fixtures.h"
+#include "../cupidarchive.h"
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+static char base_dir[128];
+static char path_buf[256];
+
+#define BIG_SIZE (2 * 1024 * 1024 + 777)
+
+static uint8_t *big;
+
+static const char *fixture_path(const char *name) {
+    snprintf(path_buf, sizeof(path_buf), "%s/%s", base_dir, name);
+    return path_buf;
+}
+
+static int64_t check_archive(const char *path) {
+    ArcReader *r = arc_open_path(path);
+    if (!r) {
+        return -2;
+    }
+    ArcTestReport report;
+    int64_t n = arc_test(r, NULL, &report);
+    arc_test_report_free(&report);
+    arc_close(r);
+    return n;
+}
+
+// Read the next entry and its whole data
+static uint8_t *next_entry(ArcReader *r, ArcEntry *entry, size_t *len) {
+    *len = 0;
+    if (arc_next(r, entry) != 0) {
+        return NULL;
+    }
+    if (entry->size == 0) {
+        return malloc(1);
+    }
+    ArcStream *data = arc_open_data(r);
+    if (!data) {
+        return NULL;
+    }
+    size_t capacity = entry->size + 1;
+    uint8_t *buf = malloc(capacity);
+    ssize_t n;
+    while (buf && (n = arc_stream_read(data, buf + *len, capacity - *len)) > 0) {
+        *len += (size_t)n;
+    }
+    arc_stream_close(data);
+    return buf;
+}
+
+// Transcode the archive at src into a new file at dst
+static int64_t transcode_file(const char *src, const char *dst, const ArcWriterOptions *wopts,
+                              const ArcTranscodeOptions *opts, ArcTranscodeStats *stats) {
+    ArcReader *r = arc_open_path(src);
+    if (!r) {
+        return -2;
+    }
+    int fd = open(dst, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ArcWriter *w = fd >= 0 ? arc_writer_new(fd, wopts) : NULL;
+    int64_t n = w ? arc_transcode(r, w, opts, stats) : -2;
+    if (w && arc_writer_finish(w) < 0) {
+        n = -3;
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    arc_close(r);
+    return n;
+}
+
+// A ZIP written by the parallel writer: deflated files and a directory
+static bool write_source_zip(const char *path) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    ArcZipWriterOptions opts = { 6, false, 2, 256 * 1024, false };
+    ArcZipWriter *w = arc_zip_writer_new_ex(fd, &opts);
+    ArcZipEntryInfo dir = { S_IFDIR | 0750, 1600000000, 0 };
+    ArcZipEntryInfo file = { S_IFREG | 0600, 1600000000, BIG_SIZE };
+    ArcZipEntryInfo small = { S_IFREG | 0644, 1600000000, 11 };
+    ArcStream *big_data = arc_stream_from_memory(big, BIG_SIZE, 0);
+    ArcStream *small_data = arc_stream_from_memory("hello world", 11, 0);
+    bool ok = w && arc_zip_writer_add_stream(w, "dir", NULL, &dir) == 0 &&
+              arc_zip_writer_add_stream(w, "dir/big.bin", big_data, &file) == 0 &&
+              arc_zip_writer_add_stream(w, "small.txt", small_data, &small) == 0 &&
+              arc_zip_writer_add_stream(w, "empty", NULL, &small) == 0;
+    ok = w && arc_zip_writer_finish(w) == 0 && ok;
+    arc_stream_close(big_data);
+    arc_stream_close(small_data);
+    close(fd);
+    return ok;
+}
+
+bool test_tar_gz_to_zip() {
+    FixtureEntry entries[] = {
+        { "docs", NULL, 0, '5' },
+        { "docs/a.txt", "alpha", 5, '0' },
+        { "docs/big.bin", big, BIG_SIZE, '0' },
+        { "docs/link", "a.txt", 0, '2' },
+    };
+    uint8_t *tar;
+    size_t tar_size = fixture_tar(entries, 4, &tar);
+    char src[256];
+    snprintf(src, sizeof(src), "%s/source.tar.gz", base_dir);
+    ASSERT_TRUE(fixture_write_gzip(src, tar, tar_size), "Should write tar.gz fixture");
+    free(tar);
+
+    char dst[256];
+    snprintf(dst, sizeof(dst), "%s/out.zip", base_dir);
+    ArcWriterOptions wopts = { ARC_WRITER_ZIP, 6, false, 2 };
+    ArcTranscodeStats stats;
+    ASSERT_EQ(transcode_file(src, dst, &wopts, NULL, &stats), 4, "All entries transcoded");
+    ASSERT_EQ(stats.passed_through, 0, "Nothing to pass through from TAR");
+    ASSERT_EQ(stats.bytes, 5 + BIG_SIZE, "File bytes counted");
+    ASSERT_EQ(check_archive(dst), 0, "ZIP verifies");
+
+    ArcReader *r = arc_open_path(dst);
+    ASSERT_NOT_NULL(r, "Should open ZIP");
+    ArcEntry entry;
+    size_t len;
+    uint8_t *data = next_entry(r, &entry, &len);
+    ASSERT_EQ(entry.type, ARC_ENTRY_DIR, "Directory kept");
+    ASSERT_EQ(entry.mode & 07777, 0755, "Directory mode kept");
+    free(data);
+    arc_entry_free(&entry);
+
+    data = next_entry(r, &entry, &len);
+    ASSERT_STR_EQ(entry.path, "docs/a.txt", "File name kept");
+    ASSERT_TRUE(len == 5 && memcmp(data, "alpha", 5) == 0, "File data kept");
+    ASSERT_EQ(entry.mtime, 1700000000, "mtime kept (even second)");
+    free(data);
+    arc_entry_free(&entry);
+
+    data = next_entry(r, &entry, &len);
+    ASSERT_TRUE(len == BIG_SIZE && memcmp(data, big, len) == 0, "Large file data kept");
+    free(data);
+    arc_entry_free(&entry);
+
+    // The ZIP reader has no symlink type: Info-ZIP keeps the target as data
+    data = next_entry(r, &entry, &len);
+    ASSERT_STR_EQ(entry.path, "docs/link", "Symlink name kept");
+    ASSERT_EQ(entry.mode & S_IFMT, S_IFLNK, "Symlink type in the mode");
+    ASSERT_TRUE(len == 5 && memcmp(data, "a.txt", 5) == 0, "Symlink target stored as data");
+    free(data);
+    arc_entry_free(&entry);
+    arc_close(r);
+    unlink(src);
+    unlink(dst);
+    return true;
+}
+
+bool test_zip_passthrough() {
+    char src[256], dst[256];
+    snprintf(src, sizeof(src), "%s/source.zip", base_dir);
+    snprintf(dst, sizeof(dst), "%s/copy.zip", base_dir);
+    ASSERT_TRUE(write_source_zip(src), "Should write source ZIP");
+
+    ArcWriterOptions wopts = { ARC_WRITER_ZIP, 1, false, 1 };
+    ArcTranscodeStats stats;
+    ASSERT_EQ(transcode_file(src, dst, &wopts, NULL, &stats), 4, "All entries transcoded");
+    ASSERT_EQ(stats.passed_through, 2, "Deflated files copied without decoding");
+    ASSERT_EQ(stats.bytes, BIG_SIZE + 11, "Passed-through bytes counted");
+    ASSERT_EQ(check_archive(dst), 0, "Copied ZIP verifies");
+
+    // Level 1 would compress differently: same size means the original bytes
+    struct stat src_st, dst_st;
+    ASSERT_EQ(stat(src, &src_st), 0, "Should stat source");
+    ASSERT_EQ(stat(dst, &dst_st), 0, "Should stat copy");
+    ASSERT_EQ(src_st.st_size, dst_st.st_size, "Compressed data copied as is");
+
+    ArcReader *r = arc_open_path(dst);
+    ASSERT_NOT_NULL(r, "Should open copy");
+    ArcEntry entry;
+    size_t len;
+    uint8_t *data = next_entry(r, &entry, &len);
+    ASSERT_EQ(entry.type, ARC_ENTRY_DIR, "Directory kept");
+    ASSERT_EQ(entry.mode & 07777, 0750, "Directory mode kept");
+    free(data);
+    arc_entry_free(&entry);
+    data = next_entry(r, &entry, &len);
+    ASSERT_STR_EQ(entry.path, "dir/big.bin", "File name kept");
+    ASSERT_EQ(entry.mode & 07777, 0600, "File mode kept");
+    ASSERT_EQ(entry.mtime, 1600000000, "mtime kept");
+    ASSERT_TRUE(len == BIG_SIZE && memcmp(data, big, len) == 0, "Passed-through data decodes");
+    free(data);
+    arc_entry_free(&entry);
+    arc_close(r);
+
+    // Opting out re-encodes at level 1
+    ArcTranscodeOptions opts = { true };
+    ASSERT_EQ(transcode_file(src, dst, &wopts, &opts, &stats), 4, "Re-encoded copy");
+    ASSERT_EQ(stats.passed_through, 0, "Nothing passed through");
+    ASSERT_EQ(check_archive(dst), 0, "Re-encoded ZIP verifies");
+
+    // A stored target can't take deflated bytes
+    ArcWriterOptions store = { ARC_WRITER_ZIP, 0, true, 1 };
+    ASSERT_EQ(transcode_file(src, dst, &store, NULL, &stats), 4, "Stored copy");
+    ASSERT_EQ(stats.passed_through, 0, "Different method is decoded");
+    ASSERT_EQ(stat(dst, &dst_st), 0, "Should stat stored copy");
+    ASSERT_TRUE(dst_st.st_size > BIG_SIZE, "Data stored uncompressed");
+    ASSERT_EQ(check_archive(dst), 0, "Stored ZIP verifies");
+    unlink(dst);
+    return true;
+}
+
+bool test_zip_to_tar() {
+    const char *src = fixture_path("source.zip");
+    char dst[256];
+    snprintf(dst, sizeof(dst), "%s/out.tar.gz", base_dir);
+    ArcWriterOptions wopts = { ARC_WRITER_TAR_GZIP, 0, false, 2 };
+    ArcTranscodeStats stats;
+    ASSERT_EQ(transcode_file(src, dst, &wopts, NULL, &stats), 4, "All entries transcoded");
+    ASSERT_EQ(stats.passed_through, 0, "TAR targets decode everything");
+    ASSERT_EQ(check_archive(dst), 0, "tar.gz verifies");
+
+    ArcReader *r = arc_open_path(dst);
+    ASSERT_NOT_NULL(r, "Should open tar.gz");
+    ArcEntry entry;
+    size_t len;
+    uint8_t *data = next_entry(r, &entry, &len);
+    ASSERT_STR_EQ(entry.path, "dir/", "Directory kept");
+    ASSERT_EQ(entry.type, ARC_ENTRY_DIR, "Directory type kept");
+    free(data);
+    arc_entry_free(&entry);
+    data = next_entry(r, &entry, &len);
+    ASSERT_EQ(entry.mode & 07777, 0600, "File mode kept");
+    ASSERT_EQ(entry.mtime, 1600000000, "mtime kept");
+    ASSERT_TRUE(len == BIG_SIZE && memcmp(data, big, len) == 0, "Data kept");
+    free(data);
+    arc_entry_free(&entry);
+    data = next_entry(r, &entry, &len);
+    ASSERT_TRUE(len == 11 && memcmp(data, "hello world", 11) == 0, "Small file kept");
+    free(data);
+    arc_entry_free(&entry);
+    data = next_entry(r, &entry, &len);
+    ASSERT_STR_EQ(entry.path, "empty", "Empty file kept");
+    ASSERT_EQ(entry.size, 0, "Empty file has no data");
+    free(data);
+    arc_entry_free(&entry);
+    arc_close(r);
+    unlink(dst);
+    return true;
+}
+
+bool test_tar_metadata_and_lone_gzip() {
+    // Owner ids and hard links survive TAR to TAR
+    FixtureEntry entries[] = {
+        { "f.txt", "data", 4, '0' },
+        { "hard", "f.txt", 0, '1' },
+        { "sym", "f.txt", 0, '2' },
+    };
+    uint8_t *tar;
+    size_t tar_size = fixture_tar(entries, 3, &tar);
+    char src[256], dst[256];
+    snprintf(src, sizeof(src), "%s/source.tar", base_dir);
+    snprintf(dst, sizeof(dst), "%s/copy.tar", base_dir);
+    ASSERT_TRUE(fixture_write_file(src, tar, tar_size), "Should write TAR fixture");
+    free(tar);
+
+    ArcTranscodeStats stats;
+    ASSERT_EQ(transcode_file(src, dst, NULL, NULL, &stats), 3, "Every entry transcoded");
+    ASSERT_EQ(stats.entries, 3, "Hard link counted");
+    ArcReader *r = arc_open_path(dst);
+    ASSERT_NOT_NULL(r, "Should open copy");
+    ArcEntry entry;
+    size_t len;
+    uint8_t *data = next_entry(r, &entry, &len);
+    ASSERT_EQ(entry.uid, 1000, "uid kept");
+    ASSERT_EQ(entry.gid, 1000, "gid kept");
+    ASSERT_EQ(entry.mtime, 1700000000, "mtime kept");
+    free(data);
+    arc_entry_free(&entry);
+    data = next_entry(r, &entry, &len);
+    ASSERT_EQ(entry.type, ARC_ENTRY_HARDLINK, "Hard link kept");
+    ASSERT_STR_EQ(entry.link_target, "f.txt", "Hard link target kept");
+    free(data);
+    arc_entry_free(&entry);
+    data = next_entry(r, &entry, &len);
+    ASSERT_EQ(entry.type, ARC_ENTRY_SYMLINK, "Symlink kept");
+    ASSERT_STR_EQ(entry.link_target, "f.txt", "Symlink target kept");
+    free(data);
+    arc_entry_free(&entry);
+    arc_close(r);
+
+    // ZIP can't hold the hard link: the call fails instead of dropping it
+    char zip_dst[256];
+    snprintf(zip_dst, sizeof(zip_dst), "%s/copy.zip", base_dir);
+    ArcWriterOptions zip_opts = { ARC_WRITER_ZIP, 0, false, 1 };
+    r = arc_open_path(src);
+    ASSERT_NOT_NULL(r, "Should reopen source");
+    int fd = open(zip_dst, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ArcWriter *w = arc_writer_new(fd, &zip_opts);
+    ASSERT_NOT_NULL(w, "Should create ZIP writer");
+    errno = 0;
+    ASSERT_EQ(arc_transcode(r, w, NULL, &stats), -1, "Hard link into ZIP fails");
+    ASSERT_EQ(errno, ENOTSUP, "Should report ENOTSUP");
+    ASSERT_EQ(stats.entries, 1, "Only the file was written");
+    arc_writer_free(w);
+    close(fd);
+    arc_close(r);
+    unlink(zip_dst);
+    unlink(src);
+
+    // A lone .gz has no trustworthy size: it is spooled for TAR
+    snprintf(src, sizeof(src), "%s/payload.bin.gz", base_dir);
+    ASSERT_TRUE(fixture_write_gzip(src, big, BIG_SIZE), "Should write gzip fixture");
+    ASSERT_EQ(transcode_file(src, dst, NULL, NULL, &stats), 1, "Lone file transcoded");
+    ASSERT_EQ(stats.bytes, BIG_SIZE, "Spooled size");
+    r = arc_open_path(dst);
+    ASSERT_NOT_NULL(r, "Should open TAR");
+    data = next_entry(r, &entry, &len);
+    ASSERT_EQ(entry.size, BIG_SIZE, "Exact size in the header");
+    ASSERT_TRUE(len == BIG_SIZE && memcmp(data, big, len) == 0, "Data kept");
+    free(data);
+    arc_entry_free(&entry);
+    arc_close(r);
+
+    // ZIP takes it as a stream of unknown length
+    char zip[256];
+    snprintf(zip, sizeof(zip), "%s/payload.zip", base_dir);
+    ArcWriterOptions wopts = { ARC_WRITER_ZIP, 0, false, 1 };
+    ASSERT_EQ(transcode_file(src, zip, &wopts, NULL, NULL), 1, "Lone file into ZIP");
+    ASSERT_EQ(check_archive(zip), 0, "ZIP verifies");
+    unlink(zip);
+    unlink(src);
+    unlink(dst);
+    return true;
+}
+
+bool test_epoch_mtime() {
+    // An mtime of 0 is the epoch, not "unset": it must not become the current time
+    char dst[256];
+    snprintf(dst, sizeof(dst), "%s/epoch.tar", base_dir);
+    int fd = open(dst, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ArcWriter *w = arc_writer_new(fd, NULL);
+    ASSERT_NOT_NULL(w, "Should create TAR writer");
+    ArcEntry entry = { "old.txt", 1, 0644, 0, ARC_ENTRY_FILE, NULL, 0, 0 };
+    ArcStream *s = arc_stream_from_memory("x", 1, 0);
+    ASSERT_EQ(arc_writer_add(w, &entry, s), 0, "Should add entry");
+    arc_stream_close(s);
+    ASSERT_EQ(arc_writer_finish(w), 0, "Should finish");
+    close(fd);
+
+    ArcReader *r = arc_open_path(dst);
+    ASSERT_NOT_NULL(r, "Should open TAR");
+    ArcEntry read;
+    ASSERT_EQ(arc_next(r, &read), 0, "Should read entry");
+    ASSERT_EQ(read.mtime, 0, "Epoch mtime kept");
+    arc_entry_free(&read);
+    arc_close(r);
+    unlink(dst);
+    return true;
+}
+
+bool test_invalid() {
+    errno = 0;
+    ArcWriterOptions bad = { 7, 0, false, 0 };
+    ASSERT_NULL(arc_writer_new(STDOUT_FILENO, &bad), "Unknown format should fail");
+    ASSERT_EQ(errno, EINVAL, "Should report EINVAL");
+    ASSERT_NULL(arc_writer_new(-1, NULL), "Bad descriptor should fail");
+    ASSERT_EQ(arc_transcode(NULL, NULL, NULL, NULL), -1, "NULL arguments should fail");
+
+    int fd = open(fixture_path("tmp.tar"), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ArcWriter *w = arc_writer_new(fd, NULL);
+    ASSERT_NOT_NULL(w, "Should create TAR writer");
+    ASSERT_EQ(arc_writer_zip_method(w), -1, "TAR has no ZIP method");
+    ArcEntry entry = { "x", 1, 0644, 0, ARC_ENTRY_FILE, NULL, 0, 0 };
+    ArcZipRawInfo raw = { 8, 0, 1, 1 };
+    ArcStream *s = arc_stream_from_memory("x", 1, 0);
+    errno = 0;
+    ASSERT_EQ(arc_writer_add_raw(w, &entry, s, &raw), -1, "Raw data needs a ZIP target");
+    ASSERT_EQ(errno, ENOTSUP, "Should report ENOTSUP");
+    entry.type = ARC_ENTRY_OTHER;
+    ASSERT_EQ(arc_writer_add(w, &entry, NULL), -1, "Special files can't be written");
+    arc_stream_close(s);
+    arc_writer_free(w);
+    close(fd);
+    unlink(fixture_path("tmp.tar"));
+    return true;
+}
+
+int main() {
+    printf("=== Transcode Tests ===\n\n");
+
+    snprintf(base_dir, sizeof(base_dir), "/tmp/cupidarchive_transcode_test_%ld", (long)getpid());
+    mkdir(base_dir, 0755);
+    big = fixture_pattern(BIG_SIZE, 9);
+
+    RUN_TEST(test_tar_gz_to_zip);
+    RUN_TEST(test_zip_passthrough);
+    RUN_TEST(test_zip_to_tar);
+    RUN_TEST(test_tar_metadata_and_lone_gzip);
+    RUN_TEST(test_epoch_mtime);
+    RUN_TEST(test_invalid);
+
+    free(big);
+    unlink(fixture_path("source.zip"));
+    rmdir(base_dir);
+
+    PRINT_SUMMARY();
+}
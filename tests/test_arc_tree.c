@@ -0,0 +1,136 @@
+#define _POSIX_C_SOURCE 200809L
+#include "test_runner.h"
+#include "test_fixtures.h"
+#include "../cupidarchive.h"
+#include <string.h>
+
+static ArcTree *build_fixture_tree(void) {
+    FixtureEntry files[] = {
+        { "a/b/c.txt", "c", 1, '0' },
+        { "a/x.txt", "x", 1, '0' },
+        { "z/", NULL, 0, '5' },
+        { "a/b/", NULL, 0, '5' },
+        { "readme", "r", 1, '0' },
+        { "./a/b/d.txt", "d", 1, '0' },
+    };
+    uint8_t *tar = NULL;
+    size_t size = fixture_tar(files, sizeof(files) / sizeof(files[0]), &tar);
+    ArcStream *stream = arc_stream_from_memory(tar, size, 0);
+    ArcReader *reader = arc_open_stream(stream);
+    if (!reader) {
+        arc_stream_close(stream);
+        free(tar);
+        return NULL;
+    }
+    ArcTree *tree = arc_tree_build(reader);
+    arc_close(reader);
+    free(tar);
+    return tree;
+}
+
+bool test_tree_root_children_sorted() {
+    ArcTree *tree = build_fixture_tree();
+    ASSERT_NOT_NULL(tree, "Should build tree");
+    ArcTreeNode first;
+    size_t n = arc_tree_children(tree, ARC_TREE_ROOT, &first);
+    ASSERT_EQ(n, 3, "Root should have a, readme, z");
+    ASSERT_STR_EQ(arc_tree_name(tree, first), "a", "First child should be a");
+    ASSERT_STR_EQ(arc_tree_name(tree, first + 1), "readme", "Second child should be readme");
+    ASSERT_STR_EQ(arc_tree_name(tree, first + 2), "z", "Third child should be z");
+    ASSERT_TRUE(arc_tree_is_dir(tree, first + 2), "z should be a directory");
+    ASSERT_FALSE(arc_tree_is_dir(tree, first + 1), "readme should be a file");
+    arc_tree_free(tree);
+    return true;
+}
+
+bool test_tree_implicit_parent() {
+    ArcTree *tree = build_fixture_tree();
+    ASSERT_NOT_NULL(tree, "Should build tree");
+    ArcTreeNode a = arc_tree_lookup(tree, "a");
+    ASSERT_NE(a, ARC_TREE_NONE, "Implicit directory should exist");
+    ASSERT_TRUE(arc_tree_is_dir(tree, a), "Implicit node should be a directory");
+    ASSERT_NULL(arc_tree_entry(tree, a), "Implicit directory has no entry");
+    ASSERT_EQ(arc_tree_entry_index(tree, a), -1, "Implicit directory has no index");
+
+    ArcTreeNode b = arc_tree_lookup(tree, "a/b/");
+    ASSERT_NE(b, ARC_TREE_NONE, "Explicit directory should exist");
+    ASSERT_NOT_NULL(arc_tree_entry(tree, b), "Explicit directory keeps its entry");
+    ASSERT_EQ(arc_tree_parent(tree, b), a, "Parent of a/b should be a");
+
+    ArcTreeNode first;
+    ASSERT_EQ(arc_tree_children(tree, b, &first), 2, "a/b should have two files");
+    ASSERT_STR_EQ(arc_tree_name(tree, first), "c.txt", "Children sorted by name");
+    ASSERT_STR_EQ(arc_tree_name(tree, first + 1), "d.txt", "./ prefix should be ignored");
+    arc_tree_free(tree);
+    return true;
+}
+
+bool test_tree_lookup_and_path() {
+    ArcTree *tree = build_fixture_tree();
+    ASSERT_NOT_NULL(tree, "Should build tree");
+    ArcTreeNode c = arc_tree_lookup(tree, "/a/b/c.txt");
+    ASSERT_NE(c, ARC_TREE_NONE, "Should find file");
+    const ArcEntry *e = arc_tree_entry(tree, c);
+    ASSERT_NOT_NULL(e, "File node should have an entry");
+    ASSERT_STR_EQ(e->path, "a/b/c.txt", "Entry path should match");
+    ASSERT_EQ(arc_tree_entry_index(tree, c), 0, "First listed entry");
+
+    char buf[64];
+    ASSERT_EQ(arc_tree_path(tree, c, buf, sizeof(buf)), strlen("a/b/c.txt"), "Path length");
+    ASSERT_STR_EQ(buf, "a/b/c.txt", "Reconstructed path");
+    char small[4];
+    arc_tree_path(tree, c, small, sizeof(small));
+    ASSERT_STR_EQ(small, "a/b", "Truncated path");
+
+    ASSERT_EQ(arc_tree_lookup(tree, ""), ARC_TREE_ROOT, "Empty path is the root");
+    ASSERT_EQ(arc_tree_lookup(tree, "a/missing"), ARC_TREE_NONE, "Missing path");
+    ASSERT_EQ(arc_tree_lookup(tree, "readme/x"), ARC_TREE_NONE, "Files have no children");
+    arc_tree_free(tree);
+    return true;
+}
+
+bool test_tree_many_entries() {
+    // Wide directories exercise the hash table growth and child sorting
+    size_t count = 5000;
+    ArcEntry *entries = calloc(count, sizeof(ArcEntry));
+    ASSERT_NOT_NULL(entries, "Should allocate entries");
+    char name[64];
+    for (size_t i = 0; i < count; i++) {
+        snprintf(name, sizeof(name), "d%zu/f%05zu", i % 10, count - i);
+        entries[i].path = strdup(name);
+        entries[i].type = ARC_ENTRY_FILE;
+    }
+    ArcTree *tree = arc_tree_build_entries(entries, count);
+    ASSERT_NOT_NULL(tree, "Should build tree");
+    ASSERT_EQ(arc_tree_node_count(tree), 1 + 10 + count, "Root + 10 dirs + files");
+    ArcTreeNode d3 = arc_tree_lookup(tree, "d3");
+    ArcTreeNode first;
+    size_t n = arc_tree_children(tree, d3, &first);
+    ASSERT_EQ(n, count / 10, "Each directory holds a tenth of the files");
+    for (size_t i = 1; i < n; i++) {
+        ASSERT(strcmp(arc_tree_name(tree, first + i - 1), arc_tree_name(tree, first + i)) < 0,
+               "Children should be sorted");
+    }
+    arc_tree_free(tree);
+    return true;
+}
+
+bool test_tree_null() {
+    ASSERT_NULL(arc_tree_build(NULL), "NULL reader should fail");
+    ASSERT_EQ(arc_tree_children(NULL, ARC_TREE_ROOT, NULL), 0, "NULL tree has no children");
+    ASSERT_EQ(arc_tree_lookup(NULL, "a"), ARC_TREE_NONE, "NULL tree lookup");
+    arc_tree_free(NULL);
+    return true;
+}
+
+int main() {
+    printf("=== ArcTree Tests ===\n\n");
+
+    RUN_TEST(test_tree_root_children_sorted);
+    RUN_TEST(test_tree_implicit_parent);
+    RUN_TEST(test_tree_lookup_and_path);
+    RUN_TEST(test_tree_many_entries);
+    RUN_TEST(test_tree_null);
+
+    PRINT_SUMMARY();
+}
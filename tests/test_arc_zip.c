@@ -0,0 +1,206 @@
+#include "test_runner.h"
+#include "test_fixtures.h"
+#include "../cupidarchive.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// More records than the reader decodes on one thread (several chunks)
+#define LARGE_COUNT 70000
+#define FIXTURE_COUNT 40000
+
+static char zip_path[64];
+
+static void entry_name(char *buf, size_t len, size_t i) {
+    // Names of varying length so records don't share a stride
+    snprintf(buf, len, "dir%02zu/%.*sfile_%06zu.txt", i % 37, (int)(i % 23), "abcdefghijklmnopqrstuvw", i);
+}
+
+static FixtureEntry *fixture_entries(size_t count, char **names_out) {
+    FixtureEntry *entries = calloc(count, sizeof(FixtureEntry));
+    char *names = calloc(count, 64);
+    for (size_t i = 0; i < count; i++) {
+        entry_name(names + i * 64, 64, i);
+        entries[i].name = names + i * 64;
+        entries[i].data = names + i * 64;
+        entries[i].size = i % 5;
+        entries[i].type = '0';
+    }
+    *names_out = names;
+    return entries;
+}
+
+static bool list_all(ArcReader *r, size_t count, size_t (*size_of)(size_t)) {
+    ArcEntry entry;
+    char name[64];
+    size_t n = 0;
+    while (arc_next(r, &entry) == 0) {
+        entry_name(name, sizeof(name), n);
+        ASSERT_STR_EQ(entry.path, name, "Entry names in directory order");
+        ASSERT_EQ(entry.size, size_of(n), "Entry size");
+        arc_entry_free(&entry);
+        n++;
+    }
+    ASSERT_EQ(n, count, "Every record listed");
+    return true;
+}
+
+static size_t large_size(size_t i) {
+    return i % 1000 == 0 ? 10 : 0;
+}
+
+static size_t fixture_size(size_t i) {
+    return i % 5;
+}
+
+// A ZIP64 directory (more than 65535 records) written by the ZIP writer,
+// with ZIP64 extra fields on the entries of unknown size
+static bool test_large_directory(void) {
+    int fd = open(zip_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ASSERT_TRUE(fd >= 0, "Create archive");
+    ArcZipWriterOptions opts = { .store = true, .threads = 1 };
+    ArcZipWriter *w = arc_zip_writer_new_ex(fd, &opts);
+    ASSERT_NOT_NULL(w, "Writer");
+    char name[64];
+    for (size_t i = 0; i < LARGE_COUNT; i++) {
+        entry_name(name, sizeof(name), i);
+        ArcZipEntryInfo info = { .mtime = 1700000000, .size = 0 };
+        ArcStream *data = NULL;
+        if (i % 1000 == 0) {
+            info.size = ARC_ZIP_SIZE_UNKNOWN;
+            data = arc_stream_from_memory("0123456789", 10, 0);
+        } else {
+            data = arc_stream_from_memory("", 0, 0);
+        }
+        ASSERT_EQ(arc_zip_writer_add_stream(w, name, data, &info), 0, "Add entry");
+        arc_stream_close(data);
+    }
+    ASSERT_EQ(arc_zip_writer_finish(w), 0, "Finish");
+    close(fd);
+
+    ArcReader *r = arc_open_path(zip_path);
+    ASSERT_NOT_NULL(r, "Open ZIP64 archive");
+    ASSERT_TRUE(list_all(r, LARGE_COUNT, large_size), "Listing");
+    arc_close(r);
+
+    // The same archive from a memory stream
+    FILE *f = fopen(zip_path, "rb");
+    fseek(f, 0, SEEK_END);
+    size_t size = (size_t)ftell(f);
+    rewind(f);
+    uint8_t *buf = malloc(size);
+    ASSERT_EQ(fread(buf, 1, size, f), size, "Read archive");
+    fclose(f);
+    r = arc_open_stream(arc_stream_from_memory(buf, size, 0));  // Owns the stream
+    ASSERT_NOT_NULL(r, "Open from memory");
+    ASSERT_TRUE(list_all(r, LARGE_COUNT, large_size), "Listing from memory");
+    arc_close(r);
+    free(buf);
+    unlink(zip_path);
+    return true;
+}
+
+static uint8_t *load(size_t *size_out) {
+    FILE *f = fopen(zip_path, "rb");
+    fseek(f, 0, SEEK_END);
+    size_t size = (size_t)ftell(f);
+    rewind(f);
+    uint8_t *buf = malloc(size);
+    if (fread(buf, 1, size, f) != size) {
+        size = 0;
+    }
+    fclose(f);
+    *size_out = size;
+    return buf;
+}
+
+// End records that disagree with the records, and damaged records
+static bool test_directory_mismatch(void) {
+    char *names = NULL;
+    FixtureEntry *entries = fixture_entries(FIXTURE_COUNT, &names);
+    ASSERT_TRUE(fixture_write_zip(zip_path, entries, FIXTURE_COUNT, false), "Write archive");
+    size_t size = 0;
+    uint8_t *buf = load(&size);
+    uint8_t *eocd = buf + size - 22;
+    ASSERT_EQ(eocd[0], 'P', "End record at the end");
+    uint32_t cd_size = (uint32_t)eocd[12] | ((uint32_t)eocd[13] << 8) | ((uint32_t)eocd[14] << 16) |
+                       ((uint32_t)eocd[15] << 24);
+    uint32_t cd_offset = (uint32_t)eocd[16] | ((uint32_t)eocd[17] << 8) | ((uint32_t)eocd[18] << 16) |
+                         ((uint32_t)eocd[19] << 24);
+
+    // Understated directory size: the records are still read one by one
+    fixture_le32(eocd + 12, cd_size - 100);
+    ArcReader *r = arc_open_stream(arc_stream_from_memory(buf, size, 0));
+    ASSERT_NOT_NULL(r, "Open with a short directory size");
+    ASSERT_TRUE(list_all(r, FIXTURE_COUNT, fixture_size), "Listing");
+    arc_close(r);
+    fixture_le32(eocd + 12, cd_size);
+
+    // A broken record signature in a later chunk fails the open
+    uint8_t *record = buf + cd_offset;
+    for (size_t i = 0; i < FIXTURE_COUNT - 10; i++) {
+        record += 46 + (record[28] | (record[29] << 8)) + (record[30] | (record[31] << 8)) +
+                  (record[32] | (record[33] << 8));
+    }
+    record[1] = 'X';
+    ArcStream *mem = arc_stream_from_memory(buf, size, 0);
+    r = arc_open_stream(mem);
+    ASSERT_NULL(r, "Damaged record rejected");
+    arc_stream_close(mem);
+
+    free(buf);
+    free(entries);
+    free(names);
+    unlink(zip_path);
+    return true;
+}
+
+// Limits are checked on every record, whichever chunk it falls into
+static bool test_limits(void) {
+    char *names = NULL;
+    FixtureEntry *entries = fixture_entries(FIXTURE_COUNT, &names);
+    char long_name[160];
+    memset(long_name, 'n', sizeof(long_name) - 1);
+    long_name[sizeof(long_name) - 1] = '\0';
+    entries[FIXTURE_COUNT - 3].name = long_name;
+    ASSERT_TRUE(fixture_write_zip(zip_path, entries, FIXTURE_COUNT, false), "Write archive");
+
+    ArcLimits limits = *arc_default_limits();
+    limits.max_name = 100;
+    errno = 0;
+    ArcReader *r = arc_open_path_ex(zip_path, &limits);
+    ASSERT_NULL(r, "Long name rejected");
+    ASSERT_EQ(errno, EOVERFLOW, "Limit error");
+
+    limits.max_name = 200;
+    r = arc_open_path_ex(zip_path, &limits);
+    ASSERT_NOT_NULL(r, "Within the limit");
+    ArcEntry entry;
+    size_t n = 0;
+    while (arc_next(r, &entry) == 0) {
+        if (n == FIXTURE_COUNT - 3) {
+            ASSERT_STR_EQ(entry.path, long_name, "Long name intact");
+        }
+        arc_entry_free(&entry);
+        n++;
+    }
+    ASSERT_EQ(n, FIXTURE_COUNT, "Every record listed");
+    arc_close(r);
+
+    free(entries);
+    free(names);
+    unlink(zip_path);
+    return true;
+}
+
+int main(void) {
+    printf("=== ZIP Central Directory Tests ===\n\n");
+
+    snprintf(zip_path, sizeof(zip_path), "/tmp/cupidarchive_zipcd_%ld.zip", (long)getpid());
+
+    RUN_TEST(test_large_directory);
+    RUN_TEST(test_directory_mismatch);
+    RUN_TEST(test_limits);
+
+    PRINT_SUMMARY();
+}
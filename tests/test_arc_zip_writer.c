@@ -0,0 +1,554 @@
+#define _XOPEN_SOURCE 700
+#include "test_runner.h"
+#include "test_fixtures.h"
+#include "../cupidarchive.h"
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/stat.h>
+
+static char base_dir[128];
+static char path_buf[256];
+
+#define FILE_COUNT 24
+
+static char names[FILE_COUNT][32];
+static uint8_t *contents[FILE_COUNT];
+static size_t sizes[FILE_COUNT];
+
+static const char *fixture_path(const char *name) {
+    snprintf(path_buf, sizeof(path_buf), "%s/%s", base_dir, name);
+    return path_buf;
+}
+
+static int64_t check_archive(const char *path) {
+    ArcReader *r = arc_open_path(path);
+    if (!r) {
+        return -2;
+    }
+    ArcTestOptions opts = { 4 };
+    ArcTestReport report;
+    int64_t n = arc_test(r, &opts, &report);
+    arc_test_report_free(&report);
+    arc_close(r);
+    return n;
+}
+
+// Read the next entry and its whole data
+static uint8_t *next_entry(ArcReader *r, ArcEntry *entry, size_t *len) {
+    *len = 0;
+    if (arc_next(r, entry) != 0) {
+        return NULL;
+    }
+    if (entry->size == 0) {
+        return malloc(1);
+    }
+    ArcStream *data = arc_open_data(r);
+    if (!data) {
+        return NULL;
+    }
+    size_t capacity = entry->size + 1;
+    uint8_t *buf = malloc(capacity);
+    ssize_t n;
+    while (buf && (n = arc_stream_read(data, buf + *len, capacity - *len)) > 0) {
+        *len += (size_t)n;
+    }
+    arc_stream_close(data);
+    return buf;
+}
+
+static bool write_files(int fd, const ArcZipWriterOptions *opts) {
+    ArcZipWriter *w = arc_zip_writer_new_ex(fd, opts);
+    if (!w) {
+        return false;
+    }
+    for (size_t i = 0; i < FILE_COUNT; i++) {
+        ArcStream *data = arc_stream_from_memory(contents[i], sizes[i], 0);
+        ArcZipEntryInfo info = { 0100640, 1600000000, sizes[i] };
+        int rc = data ? arc_zip_writer_add_stream(w, names[i], data, &info) : -1;
+        arc_stream_close(data);
+        if (rc < 0) {
+            arc_zip_writer_free(w);
+            return false;
+        }
+    }
+    return arc_zip_writer_finish(w) == 0;
+}
+
+static bool verify_files(const char *path) {
+    ArcReader *r = arc_open_path(path);
+    ASSERT_NOT_NULL(r, "Should open written zip");
+    for (size_t i = 0; i < FILE_COUNT; i++) {
+        ArcEntry entry;
+        size_t len;
+        uint8_t *data = next_entry(r, &entry, &len);
+        ASSERT_NOT_NULL(data, "Should read entry data");
+        bool same = len == sizes[i] && memcmp(data, contents[i], len) == 0;
+        free(data);
+        ASSERT_STR_EQ(entry.path, names[i], "Entries keep their order");
+        ASSERT_EQ(entry.size, sizes[i], "Size recorded");
+        ASSERT_EQ(entry.mode, 0100640, "Mode recorded");
+        ASSERT_EQ(entry.mtime, 1600000000, "Mtime recorded (even seconds)");
+        arc_entry_free(&entry);
+        ASSERT_TRUE(same, "Content roundtrips");
+    }
+    ArcEntry entry;
+    ASSERT_EQ(arc_next(r, &entry), 1, "No extra entries");
+    arc_close(r);
+    ASSERT_EQ(check_archive(path), 0, "CRCs verify");
+    return true;
+}
+
+bool test_parallel_chunks() {
+    const char *path = fixture_path("parallel.zip");
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ASSERT_TRUE(fd >= 0, "Should create zip");
+    // 4 KiB chunks: the large files span dozens of chained chunks
+    ArcZipWriterOptions opts = { 6, false, 4, 4096, false };
+    bool ok = write_files(fd, &opts);
+    close(fd);
+    ASSERT_TRUE(ok, "Should write zip on 4 threads");
+    return verify_files(path);
+}
+
+bool test_store_and_inline() {
+    const char *path = fixture_path("store.zip");
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ASSERT_TRUE(fd >= 0, "Should create zip");
+    ArcZipWriterOptions opts = { 0, true, 1, 0, false };
+    bool ok = write_files(fd, &opts);
+    struct stat st;
+    fstat(fd, &st);
+    close(fd);
+    ASSERT_TRUE(ok, "Should write stored zip on the calling thread");
+    size_t total = 0;
+    for (size_t i = 0; i < FILE_COUNT; i++) {
+        total += sizes[i];
+    }
+    ASSERT_TRUE((size_t)st.st_size > total, "Stored data is not compressed");
+    if (!verify_files(path)) {
+        return false;
+    }
+
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ASSERT_TRUE(fd >= 0, "Should recreate zip");
+    ASSERT_TRUE(write_files(fd, NULL), "Should write with defaults");
+    fstat(fd, &st);
+    close(fd);
+    ASSERT_TRUE((size_t)st.st_size < total, "Default options deflate");
+    return verify_files(path);
+}
+
+typedef struct PipeCopy {
+    int in;
+    int out;
+} PipeCopy;
+
+static void *copy_pipe(void *arg) {
+    PipeCopy *copy = arg;
+    char buf[8192];
+    ssize_t n;
+    while ((n = read(copy->in, buf, sizeof(buf))) > 0) {
+        if (write(copy->out, buf, (size_t)n) != n) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+bool test_pipe_data_descriptors() {
+    const char *path = fixture_path("pipe.zip");
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0, "Should create pipe");
+    PipeCopy copy = { fds[0], open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644) };
+    ASSERT_TRUE(copy.out >= 0, "Should create zip");
+    pthread_t thread;
+    ASSERT_EQ(pthread_create(&thread, NULL, copy_pipe, &copy), 0, "Should start copier");
+
+    ArcZipWriterOptions opts = { 1, false, 3, 8192, false };
+    bool ok = write_files(fds[1], &opts);
+    close(fds[1]);
+    pthread_join(thread, NULL);
+    close(fds[0]);
+    close(copy.out);
+    ASSERT_TRUE(ok, "Should write zip to a pipe");
+
+    // Entries written to a pipe announce a data descriptor
+    uint8_t header[8];
+    FILE *f = fopen(path, "rb");
+    ASSERT_NOT_NULL(f, "Should open zip");
+    ASSERT_EQ(fread(header, 1, sizeof(header), f), sizeof(header), "Should read local header");
+    fclose(f);
+    ASSERT_EQ(header[6] & 0x08, 0x08, "General purpose bit 3 set");
+    return verify_files(path);
+}
+
+bool test_unknown_size() {
+    const char *path = fixture_path("unknown.zip");
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ASSERT_TRUE(fd >= 0, "Should create zip");
+    ArcZipWriter *w = arc_zip_writer_new(fd);
+    ASSERT_NOT_NULL(w, "Should create writer");
+    ArcStream *data = arc_stream_from_memory(contents[3], sizes[3], 0);
+    ArcZipEntryInfo info = { 0, 0, ARC_ZIP_SIZE_UNKNOWN };
+    ASSERT_EQ(arc_zip_writer_add_stream(w, "stream.bin", data, &info), 0, "Should add stream");
+    arc_stream_close(data);
+    data = arc_stream_from_memory(NULL, 0, 0);
+    ASSERT_EQ(arc_zip_writer_add_stream(w, "empty", data, NULL), 0, "Should add empty stream");
+    arc_stream_close(data);
+    ASSERT_EQ(arc_zip_writer_finish(w), 0, "Should finish");
+    close(fd);
+
+    // Sizes live in the ZIP64 extra of the local header
+    uint8_t header[30];
+    FILE *f = fopen(path, "rb");
+    ASSERT_NOT_NULL(f, "Should open zip");
+    ASSERT_EQ(fread(header, 1, sizeof(header), f), sizeof(header), "Should read local header");
+    fclose(f);
+    ASSERT_EQ(header[4], 45, "Version 4.5 needed for ZIP64");
+    ASSERT_EQ(header[28], 20, "ZIP64 extra present");
+
+    ArcReader *r = arc_open_path(path);
+    ASSERT_NOT_NULL(r, "Should open zip");
+    ArcEntry entry;
+    size_t len;
+    uint8_t *read = next_entry(r, &entry, &len);
+    bool same = read && len == sizes[3] && memcmp(read, contents[3], len) == 0;
+    free(read);
+    ASSERT_EQ(entry.mode, 0100644, "Default mode");
+    struct tm dos_epoch = { .tm_mday = 1, .tm_year = 80, .tm_isdst = -1 };
+    ASSERT_EQ(entry.mtime, (uint64_t)mktime(&dos_epoch), "mtime 0 is kept, as early as DOS goes");
+    arc_entry_free(&entry);
+    ASSERT_TRUE(same, "Content roundtrips");
+    read = next_entry(r, &entry, &len);
+    free(read);
+    ASSERT_EQ(entry.size, 0, "Empty entry");
+    ASSERT_TRUE(entry.mtime + 10 > (uint64_t)time(NULL), "No info: mtime is now");
+    arc_entry_free(&entry);
+    arc_close(r);
+    ASSERT_EQ(check_archive(path), 0, "CRCs verify");
+    return true;
+}
+
+bool test_add_file() {
+    char src[192];
+    snprintf(src, sizeof(src), "%s/src", base_dir);
+    mkdir(src, 0750);
+    char file[256], link[256], fifo[256];
+    snprintf(file, sizeof(file), "%s/data.bin", src);
+    snprintf(link, sizeof(link), "%s/link", src);
+    snprintf(fifo, sizeof(fifo), "%s/fifo", src);
+    ASSERT_TRUE(fixture_write_file(file, contents[5], sizes[5]), "Should write source file");
+    chmod(file, 0600);
+    struct timespec times[2] = { { 1500000000, 0 }, { 1500000000, 0 } };
+    utimensat(AT_FDCWD, file, times, 0);
+    unlink(link);
+    ASSERT_EQ(symlink("data.bin", link), 0, "Should create symlink");
+    mkfifo(fifo, 0644);
+
+    const char *path = fixture_path("files.zip");
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ASSERT_TRUE(fd >= 0, "Should create zip");
+    ArcZipWriterOptions opts = { 0, false, 2, 0, false };
+    ArcZipWriter *w = arc_zip_writer_new_ex(fd, &opts);
+    ASSERT_NOT_NULL(w, "Should create writer");
+    ASSERT_EQ(arc_zip_writer_add_file(w, "top", src), 0, "Should add directory");
+    ASSERT_EQ(arc_zip_writer_add_file(w, "top/data.bin", file), 0, "Should add file");
+    ASSERT_EQ(arc_zip_writer_add_file(w, "top/link", link), 0, "Should add symlink");
+    ASSERT_EQ(arc_zip_writer_add_file(w, "top/fifo", fifo), -1, "FIFOs are not supported");
+    ASSERT_EQ(errno, ENOTSUP, "Should report ENOTSUP");
+    ASSERT_EQ(arc_zip_writer_add_file(w, NULL, file), 0, "Should add file under its own path");
+    ASSERT_EQ(arc_zip_writer_finish(w), 0, "Should finish");
+    close(fd);
+
+    ArcReader *r = arc_open_path(path);
+    ASSERT_NOT_NULL(r, "Should open zip");
+    ArcEntry entry;
+    size_t len;
+    uint8_t *read = next_entry(r, &entry, &len);
+    free(read);
+    ASSERT_STR_EQ(entry.path, "top/", "Directory name ends in '/'");
+    ASSERT_EQ(entry.type, ARC_ENTRY_DIR, "Directory entry");
+    ASSERT_EQ(entry.mode, S_IFDIR | 0750, "Directory mode");
+    arc_entry_free(&entry);
+
+    read = next_entry(r, &entry, &len);
+    bool same = read && len == sizes[5] && memcmp(read, contents[5], len) == 0;
+    free(read);
+    ASSERT_EQ(entry.mode, S_IFREG | 0600, "File mode");
+    ASSERT_EQ(entry.mtime, 1500000000, "File mtime");
+    arc_entry_free(&entry);
+    ASSERT_TRUE(same, "File content");
+
+    read = next_entry(r, &entry, &len);
+    same = read && len == 8 && memcmp(read, "data.bin", 8) == 0;
+    free(read);
+    ASSERT_EQ(entry.mode & S_IFMT, S_IFLNK, "Symlink type in mode");
+    arc_entry_free(&entry);
+    ASSERT_TRUE(same, "Symlink target stored as data");
+
+    read = next_entry(r, &entry, &len);
+    free(read);
+    ASSERT_STR_EQ(entry.path, file + 1, "Leading '/' dropped from the default name");
+    arc_entry_free(&entry);
+    arc_close(r);
+
+    unlink(file);
+    unlink(link);
+    unlink(fifo);
+    rmdir(src);
+    return true;
+}
+
+bool test_zip64_entry_count() {
+    const char *path = fixture_path("many.zip");
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ASSERT_TRUE(fd >= 0, "Should create zip");
+    ArcZipWriterOptions opts = { 0, false, 1, 0, false };
+    ArcZipWriter *w = arc_zip_writer_new_ex(fd, &opts);
+    ASSERT_NOT_NULL(w, "Should create writer");
+    ArcZipEntryInfo info = { 0, 1600000000, 0 };
+    bool ok = true;
+    for (size_t i = 0; i < 70000 && ok; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "e%zu", i);
+        ArcStream *data = arc_stream_from_memory(name, 1, 0);
+        ok = arc_zip_writer_add_stream(w, name, data, &info) == 0;
+        arc_stream_close(data);
+    }
+    ASSERT_TRUE(ok, "Should add 70000 entries");
+    ASSERT_EQ(arc_zip_writer_finish(w), 0, "Should finish");
+    close(fd);
+
+    ArcReader *r = arc_open_path(path);
+    ASSERT_NOT_NULL(r, "ZIP64 end of central directory is read");
+    ArcEntry *entries = NULL;
+    size_t count = 0;
+    ASSERT_EQ(arc_list_entries(r, &entries, &count), 0, "Should list entries");
+    ASSERT_EQ(count, 70000, "More than 65535 entries");
+    ASSERT_STR_EQ(entries[69999].path, "e69999", "Last entry");
+    arc_entries_free(entries, count);
+    arc_close(r);
+    return true;
+}
+
+static uint8_t *read_file(const char *path, size_t *size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    *size = (size_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *data = malloc(*size + 1);
+    if (data && fread(data, 1, *size, f) != *size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    return data;
+}
+
+// Central directory offset from a plain (non-ZIP64) end record
+static uint32_t eocd_cd_offset(const uint8_t *zip, size_t size) {
+    const uint8_t *eocd = zip + size - 22;
+    return (uint32_t)eocd[16] | (uint32_t)eocd[17] << 8 | (uint32_t)eocd[18] << 16 | (uint32_t)eocd[19] << 24;
+}
+
+static bool add_memory(ArcZipWriter *w, const char *name, const void *data, size_t size) {
+    ArcStream *s = arc_stream_from_memory(data, size, 0);
+    ArcZipEntryInfo info = { 0100600, 1600000000, size };
+    bool ok = s && arc_zip_writer_add_stream(w, name, s, &info) == 0;
+    arc_stream_close(s);
+    return ok;
+}
+
+bool test_update_append() {
+    const char *path = fixture_path("update.zip");
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    ASSERT_TRUE(fd >= 0, "Should create zip");
+    ArcZipWriterOptions opts = { 6, false, 2, 0, false };
+    ASSERT_TRUE(write_files(fd, &opts), "Should write initial archive");
+    size_t old_size;
+    uint8_t *old = read_file(path, &old_size);
+    ASSERT_NOT_NULL(old, "Should read initial archive");
+    uint32_t data_end = eocd_cd_offset(old, old_size);
+
+    ArcZipWriter *w = arc_zip_writer_open(fd, &opts);
+    ASSERT_NOT_NULL(w, "Should open archive for update");
+    ASSERT_TRUE(add_memory(w, "added.txt", "appended entry", 14), "Should add entry");
+    ASSERT_EQ(arc_zip_writer_finish(w), 0, "Should rewrite the directory");
+    close(fd);
+
+    size_t new_size;
+    uint8_t *updated = read_file(path, &new_size);
+    ASSERT_NOT_NULL(updated, "Should read updated archive");
+    bool same = new_size > old_size && memcmp(old, updated, data_end) == 0;
+    ASSERT_TRUE(eocd_cd_offset(updated, new_size) > data_end, "Directory moved past the new entry");
+    free(old);
+    free(updated);
+    ASSERT_TRUE(same, "Existing entries are not rewritten");
+
+    // Kept entries keep their attributes; the new one comes last
+    ASSERT_EQ(check_archive(path), 0, "Updated archive verifies");
+    ArcReader *r = arc_open_path(path);
+    ASSERT_NOT_NULL(r, "Should open updated archive");
+    ArcEntry *entries = NULL;
+    size_t count = 0;
+    ASSERT_EQ(arc_list_entries(r, &entries, &count), 0, "Should list entries");
+    ASSERT_EQ(count, FILE_COUNT + 1, "One entry added");
+    ASSERT_STR_EQ(entries[0].path, names[0], "Old entries first");
+    ASSERT_EQ(entries[1].mode, 0100640, "Old mode kept");
+    ASSERT_STR_EQ(entries[FILE_COUNT].path, "added.txt", "New entry last");
+    arc_entries_free(entries, count);
+    arc_close(r);
+
+    // An empty file becomes a new archive
+    const char *fresh = fixture_path("fresh.zip");
+    fd = open(fresh, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    w = arc_zip_writer_open(fd, NULL);
+    ASSERT_NOT_NULL(w, "Should open empty file");
+    ASSERT_TRUE(add_memory(w, "a", "a", 1), "Should add entry");
+    ASSERT_EQ(arc_zip_writer_finish(w), 0, "Should finish");
+    close(fd);
+    ASSERT_EQ(check_archive(fresh), 0, "New archive verifies");
+    unlink(fresh);
+    return true;
+}
+
+bool test_update_replace_compact() {
+    // Entries with data descriptors, as written to a pipe
+    size_t size;
+    uint8_t *pipe_zip = read_file(fixture_path("pipe.zip"), &size);
+    ASSERT_NOT_NULL(pipe_zip, "Should read pipe.zip");
+    const char *path = fixture_path("compact.zip");
+    ASSERT_TRUE(fixture_write_file(path, pipe_zip, size), "Should copy archive");
+    free(pipe_zip);
+
+    int fd = open(path, O_RDWR);
+    ArcZipWriter *w = arc_zip_writer_open(fd, NULL);
+    ASSERT_NOT_NULL(w, "Should open archive for update");
+    ASSERT_TRUE(add_memory(w, names[4], "replaced", 8), "Should replace entry");
+    ASSERT_EQ(arc_zip_writer_remove(w, names[8]), 0, "Should remove entry");
+    errno = 0;
+    ASSERT_EQ(arc_zip_writer_remove(w, names[8]), -1, "Removed entry is gone");
+    ASSERT_EQ(errno, ENOENT, "Should report ENOENT");
+    ASSERT_EQ(arc_zip_writer_remove(w, "dir0"), -1, "No such directory");
+    ASSERT_EQ(arc_zip_writer_finish(w), 0, "Should finish");
+    struct stat st;
+    fstat(fd, &st);
+    off_t dead_size = st.st_size;
+
+    for (int pass = 0; pass < 2; pass++) {
+        ASSERT_EQ(check_archive(path), 0, "Updated archive verifies");
+        ArcReader *r = arc_open_path(path);
+        ASSERT_NOT_NULL(r, "Should open updated archive");
+        size_t found = 0;
+        bool same = true;
+        ArcEntry entry;
+        size_t len;
+        uint8_t *data;
+        while ((data = next_entry(r, &entry, &len)) != NULL) {
+            size_t i = 0;
+            while (i < FILE_COUNT && strcmp(entry.path, names[i]) != 0) {
+                i++;
+            }
+            if (i == 4) {
+                same = same && len == 8 && memcmp(data, "replaced", 8) == 0;
+            } else {
+                same = same && i < FILE_COUNT && i != 8 && len == sizes[i] &&
+                       memcmp(data, contents[i], len) == 0;
+            }
+            found++;
+            free(data);
+            arc_entry_free(&entry);
+        }
+        arc_close(r);
+        ASSERT_EQ(found, FILE_COUNT - 1, "One replaced, one removed");
+        ASSERT_TRUE(same, "Live entries have the right data");
+        if (pass == 1) {
+            break;
+        }
+
+        // Compaction moves the live entries over the dead space
+        ArcZipWriterOptions opts = { 0, false, 1, 4096, true };
+        w = arc_zip_writer_open(fd, &opts);
+        ASSERT_NOT_NULL(w, "Should reopen for compaction");
+        ASSERT_EQ(arc_zip_writer_finish(w), 0, "Should compact");
+        fstat(fd, &st);
+        ASSERT_TRUE(st.st_size + (off_t)sizes[4] / 2 < dead_size, "Dead space reclaimed");
+    }
+    close(fd);
+    return true;
+}
+
+bool test_invalid() {
+    errno = 0;
+    ASSERT_NULL(arc_zip_writer_new(-1), "Bad descriptor should fail");
+    ASSERT_EQ(errno, EINVAL, "Should report EINVAL");
+    ArcZipWriterOptions opts = { 10, false, 1, 0, false };
+    ASSERT_NULL(arc_zip_writer_new_ex(STDOUT_FILENO, &opts), "Bad level should fail");
+    ASSERT_EQ(arc_zip_writer_finish(NULL), -1, "NULL writer should fail");
+
+    const char *path = fixture_path("not.zip");
+    ASSERT_TRUE(fixture_write_file(path, "not a zip archive at all", 24), "Should write file");
+    int fd = open(path, O_RDWR);
+    errno = 0;
+    ASSERT_NULL(arc_zip_writer_open(fd, NULL), "Non-ZIP file can't be updated");
+    ASSERT_EQ(errno, EINVAL, "Should report EINVAL");
+    close(fd);
+    unlink(path);
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0, "Should create pipe");
+    errno = 0;
+    ASSERT_NULL(arc_zip_writer_open(fds[1], NULL), "Pipe can't be updated");
+    ASSERT_EQ(errno, ESPIPE, "Should report ESPIPE");
+    ArcZipWriter *w = arc_zip_writer_new(fds[1]);
+    errno = 0;
+    ASSERT_EQ(arc_zip_writer_remove(w, "x"), -1, "New archives have nothing to remove");
+    ASSERT_EQ(errno, ENOTSUP, "Should report ENOTSUP");
+    arc_zip_writer_free(w);
+    close(fds[0]);
+    close(fds[1]);
+    arc_zip_writer_free(NULL);
+    return true;
+}
+
+int main() {
+    printf("=== ZIP Writer Tests ===\n\n");
+
+    snprintf(base_dir, sizeof(base_dir), "/tmp/cupidarchive_zipw_test_%ld", (long)getpid());
+    mkdir(base_dir, 0755);
+
+    // Mix of empty, small and multi-chunk files
+    for (size_t i = 0; i < FILE_COUNT; i++) {
+        snprintf(names[i], sizeof(names[i]), "dir%zu/file%02zu.bin", i % 3, i);
+        sizes[i] = i == 0 ? 0 : (i % 4 == 0 ? 150000 + i * 997 : i * 311);
+        contents[i] = fixture_pattern(sizes[i] ? sizes[i] : 1, (uint32_t)i + 7);
+    }
+
+    RUN_TEST(test_parallel_chunks);
+    RUN_TEST(test_store_and_inline);
+    RUN_TEST(test_pipe_data_descriptors);
+    RUN_TEST(test_unknown_size);
+    RUN_TEST(test_add_file);
+    RUN_TEST(test_zip64_entry_count);
+    RUN_TEST(test_update_append);
+    RUN_TEST(test_update_replace_compact);
+    RUN_TEST(test_invalid);
+
+    for (size_t i = 0; i < FILE_COUNT; i++) {
+        free(contents[i]);
+    }
+    static const char *files[] = { "parallel.zip", "store.zip", "pipe.zip", "unknown.zip", "files.zip", "many.zip",
+                                   "update.zip", "compact.zip" };
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+        unlink(fixture_path(files[i]));
+    }
+    rmdir(base_dir);
+
+    PRINT_SUMMARY();
+}
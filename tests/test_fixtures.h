@@ -0,0 +1,288 @@
+#ifndef TEST_FIXTURES_H
+#define TEST_FIXTURES_H
+
+/**
+ * Helpers to build small archives on the fly (ustar, gzip, ZIP, 7z), so tests
+ * don't depend on external tools or checked-in binaries.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <zlib.h>
+
+typedef struct FixtureEntry {
+    const char *name;
+    const void *data;   // File contents (NULL for directories)
+    size_t size;
+    char type;          // '0' = file, '5' = directory, '2' = symlink, '1' = hard link (data = target)
+} FixtureEntry;
+
+static inline void fixture_octal(char *field, size_t len, uint64_t value) {
+    snprintf(field, len, "%0*llo", (int)(len - 1), (unsigned long long)value);
+}
+
+// Build a ustar archive in memory with the given permission bits per entry
+// (modes may be NULL; 0 = 0644, 0755 for directories). Returns the size;
+// *out must be freed.
+static inline size_t fixture_tar_modes(const FixtureEntry *entries, const unsigned *modes, size_t count,
+                                       uint8_t **out) {
+    size_t total = 1024; // End-of-archive blocks
+    for (size_t i = 0; i < count; i++) {
+        size_t body = entries[i].type == '0' ? entries[i].size : 0;
+        total += 512 + (body + 511) / 512 * 512;
+    }
+    uint8_t *buf = calloc(1, total);
+    if (!buf) {
+        return 0;
+    }
+    size_t pos = 0;
+    for (size_t i = 0; i < count; i++) {
+        const FixtureEntry *e = &entries[i];
+        uint8_t *hdr = buf + pos;
+        size_t body = e->type == '0' ? e->size : 0;
+        strncpy((char *)hdr, e->name, 100);
+        unsigned mode = modes && modes[i] ? modes[i] : (e->type == '5' ? 0755 : 0644);
+        fixture_octal((char *)hdr + 100, 8, mode);
+        fixture_octal((char *)hdr + 108, 8, 1000);
+        fixture_octal((char *)hdr + 116, 8, 1000);
+        fixture_octal((char *)hdr + 124, 12, body);
+        fixture_octal((char *)hdr + 136, 12, 1700000000);
+        hdr[156] = (uint8_t)e->type;
+        if ((e->type == '2' || e->type == '1') && e->data) {
+            strncpy((char *)hdr + 157, (const char *)e->data, 100);
+        }
+        memcpy(hdr + 257, "ustar", 6);
+        memcpy(hdr + 263, "00", 2);
+        memset(hdr + 148, ' ', 8);
+        unsigned sum = 0;
+        for (size_t j = 0; j < 512; j++) {
+            sum += hdr[j];
+        }
+        snprintf((char *)hdr + 148, 8, "%06o", sum);
+        pos += 512;
+        if (body) {
+            memcpy(buf + pos, e->data, body);
+            pos += (body + 511) / 512 * 512;
+        }
+    }
+    *out = buf;
+    return total;
+}
+
+// Build a ustar archive in memory. Returns the size; *out must be freed.
+static inline size_t fixture_tar(const FixtureEntry *entries, size_t count, uint8_t **out) {
+    return fixture_tar_modes(entries, NULL, count, out);
+}
+
+static inline bool fixture_write_file(const char *path, const void *data, size_t size) {
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        return false;
+    }
+    bool ok = fwrite(data, 1, size, f) == size;
+    return fclose(f) == 0 && ok;
+}
+
+static inline bool fixture_write_gzip(const char *path, const void *data, size_t size) {
+    gzFile gz = gzopen(path, "wb1");
+    if (!gz) {
+        return false;
+    }
+    bool ok = gzwrite(gz, data, (unsigned)size) == (int)size;
+    return gzclose(gz) == Z_OK && ok;
+}
+
+static inline void fixture_le16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void fixture_le32(uint8_t *p, uint32_t v) {
+    fixture_le16(p, (uint16_t)v);
+    fixture_le16(p + 2, (uint16_t)(v >> 16));
+}
+
+// Write a ZIP archive (store or deflate every file entry).
+static inline bool fixture_write_zip(const char *path, const FixtureEntry *entries, size_t count, bool compress) {
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        return false;
+    }
+    uint8_t *central = calloc(count ? count : 1, 46 + 256);
+    size_t central_size = 0;
+    uint32_t offset = 0;
+    bool ok = central != NULL;
+
+    for (size_t i = 0; ok && i < count; i++) {
+        const FixtureEntry *e = &entries[i];
+        uint16_t name_len = (uint16_t)strlen(e->name);
+        const uint8_t *data = (const uint8_t *)e->data;
+        size_t size = e->type == '0' ? e->size : 0;
+        uint32_t crc = (uint32_t)crc32(0L, data, (uInt)size);
+        uint16_t method = (compress && size > 0) ? 8 : 0;
+
+        uint8_t *stored = (uint8_t *)data;
+        size_t stored_size = size;
+        uint8_t *packed = NULL;
+        if (method == 8) {
+            uLong bound = compressBound((uLong)size) + 64;
+            packed = malloc(bound);
+            z_stream zs;
+            memset(&zs, 0, sizeof(zs));
+            ok = packed && deflateInit2(&zs, 6, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+            if (ok) {
+                zs.next_in = (Bytef *)data;
+                zs.avail_in = (uInt)size;
+                zs.next_out = packed;
+                zs.avail_out = (uInt)bound;
+                ok = deflate(&zs, Z_FINISH) == Z_STREAM_END;
+                stored_size = zs.total_out;
+                deflateEnd(&zs);
+            }
+            stored = packed;
+        }
+
+        uint8_t local[30] = {0};
+        fixture_le32(local, 0x04034b50);
+        fixture_le16(local + 4, 20);
+        fixture_le16(local + 8, method);
+        fixture_le16(local + 12, 0x5821); // 2024-01-01
+        fixture_le32(local + 14, crc);
+        fixture_le32(local + 18, (uint32_t)stored_size);
+        fixture_le32(local + 22, (uint32_t)size);
+        fixture_le16(local + 26, name_len);
+        ok = ok && fwrite(local, 1, 30, f) == 30 &&
+             fwrite(e->name, 1, name_len, f) == name_len &&
+             (stored_size == 0 || fwrite(stored, 1, stored_size, f) == stored_size);
+        free(packed);
+
+        uint8_t *cd = central + central_size;
+        fixture_le32(cd, 0x02014b50);
+        fixture_le16(cd + 4, 0x0314); // Unix, 2.0
+        fixture_le16(cd + 6, 20);
+        fixture_le16(cd + 10, method);
+        fixture_le16(cd + 14, 0x5821);
+        fixture_le32(cd + 16, crc);
+        fixture_le32(cd + 20, (uint32_t)stored_size);
+        fixture_le32(cd + 24, (uint32_t)size);
+        fixture_le16(cd + 28, name_len);
+        fixture_le32(cd + 38, (uint32_t)((e->type == '5' ? 040755u : 0100644u) << 16));
+        fixture_le32(cd + 42, offset);
+        memcpy(cd + 46, e->name, name_len);
+        central_size += 46 + name_len;
+        offset += 30 + name_len + (uint32_t)stored_size;
+    }
+
+    uint8_t eocd[22] = {0};
+    fixture_le32(eocd, 0x06054b50);
+    fixture_le16(eocd + 8, (uint16_t)count);
+    fixture_le16(eocd + 10, (uint16_t)count);
+    fixture_le32(eocd + 12, (uint32_t)central_size);
+    fixture_le32(eocd + 16, offset);
+    ok = ok && fwrite(central, 1, central_size, f) == central_size &&
+         fwrite(eocd, 1, sizeof(eocd), f) == sizeof(eocd);
+
+    free(central);
+    return fclose(f) == 0 && ok;
+}
+
+// 7z variable-length integer (values below 2^14 are enough for fixtures)
+static inline size_t fixture_7z_number(uint8_t *p, uint64_t v) {
+    if (v < 0x80) {
+        p[0] = (uint8_t)v;
+        return 1;
+    }
+    p[0] = (uint8_t)(0x80 | (v >> 8));
+    p[1] = (uint8_t)v;
+    return 2;
+}
+
+// Write a single-file 7z archive with the copy method. The data's CRC goes
+// in the folder digests (folder_crc) or in SubStreamsInfo, as 7-Zip does.
+static inline bool fixture_write_7z(const char *path, const char *name, const void *data, size_t size, bool folder_crc) {
+    uint32_t crc = (uint32_t)crc32(0L, (const Bytef *)data, (uInt)size);
+    uint8_t hdr[512];
+    size_t n = 0;
+    hdr[n++] = 0x01;                         // Header
+    hdr[n++] = 0x04;                         // MainStreamsInfo
+    hdr[n++] = 0x06;                         // PackInfo
+    hdr[n++] = 0x00;                         // pack_pos
+    hdr[n++] = 0x01;                         // One pack stream
+    hdr[n++] = 0x09;                         // Size
+    n += fixture_7z_number(hdr + n, size);
+    hdr[n++] = 0x00;
+    hdr[n++] = 0x07;                         // UnpackInfo
+    hdr[n++] = 0x0B;                         // Folder
+    hdr[n++] = 0x01;                         // One folder
+    hdr[n++] = 0x00;                         // Not external
+    hdr[n++] = 0x01;                         // One coder
+    hdr[n++] = 0x01;                         // Simple coder, 1-byte id
+    hdr[n++] = 0x00;                         // Copy
+    hdr[n++] = 0x0C;                         // CodersUnpackSize
+    n += fixture_7z_number(hdr + n, size);
+    if (folder_crc) {
+        hdr[n++] = 0x0A;                     // CRC, all defined
+        hdr[n++] = 0x01;
+        fixture_le32(hdr + n, crc);
+        n += 4;
+    }
+    hdr[n++] = 0x00;
+    if (!folder_crc) {
+        hdr[n++] = 0x08;                     // SubStreamsInfo
+        hdr[n++] = 0x0A;
+        hdr[n++] = 0x01;
+        fixture_le32(hdr + n, crc);
+        n += 4;
+        hdr[n++] = 0x00;
+    }
+    hdr[n++] = 0x00;                         // End of streams info
+    size_t name_len = strlen(name);
+    if (name_len > 100) {
+        return false;
+    }
+    hdr[n++] = 0x05;                         // FilesInfo
+    hdr[n++] = 0x01;                         // One file
+    hdr[n++] = 0x11;                         // Name
+    n += fixture_7z_number(hdr + n, 1 + 2 * (name_len + 1));
+    hdr[n++] = 0x00;                         // Not external
+    for (size_t i = 0; i <= name_len; i++) {
+        fixture_le16(hdr + n, (uint8_t)name[i]);
+        n += 2;
+    }
+    hdr[n++] = 0x00;
+    hdr[n++] = 0x00;                         // End of header
+
+    uint8_t start[32] = { 0x37, 0x7A, 0xBC, 0xAF, 0x27, 0x1C, 0x00, 0x04 };
+    fixture_le32(start + 12, (uint32_t)size);  // Next header offset
+    fixture_le32(start + 20, (uint32_t)n);     // Next header size
+    fixture_le32(start + 28, (uint32_t)crc32(0L, hdr, (uInt)n));
+    fixture_le32(start + 8, (uint32_t)crc32(0L, start + 12, 20));
+
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        return false;
+    }
+    bool ok = fwrite(start, 1, sizeof(start), f) == sizeof(start) &&
+              (size == 0 || fwrite(data, 1, size, f) == size) &&
+              fwrite(hdr, 1, n, f) == n;
+    return fclose(f) == 0 && ok;
+}
+
+// Deterministic, moderately compressible filler (deflate emits many blocks)
+static inline uint8_t *fixture_pattern(size_t size, uint32_t seed) {
+    uint8_t *buf = malloc(size ? size : 1);
+    if (!buf) {
+        return NULL;
+    }
+    uint32_t x = seed ? seed : 1;
+    for (size_t i = 0; i < size; i++) {
+        x = x * 1103515245u + 12345u;
+        buf[i] = (uint8_t)('a' + ((x >> 16) % 16));
+    }
+    return buf;
+}
+
+#endif // TEST_FIXTURES_H